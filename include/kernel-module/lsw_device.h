@@ -30,15 +30,46 @@ struct lsw_pe_info {
     char  executable_path[256]; /* Path to .exe file */
 };
 
+/* Live kernel state, for leak checks */
+struct lsw_stats {
+    __u32 pe_processes;      /* Registered PE processes */
+    __u32 handle_tables;     /* Processes with open handles */
+    __u32 handles;           /* Open handles */
+    __u32 memory_regions;    /* Allocated memory regions */
+};
+
+/*
+ * Opt-in for bare NT syscalls. Only the calling process, registered as
+ * PE under its own pid, can opt in: `syscall` instructions in
+ * [start, end) are then taken as NT syscalls, all others stay Linux
+ * ones. fd is the /dev/lsw descriptor the ioctl is issued on and must
+ * stay open; closing it, or start == end == 0, opts out again.
+ */
+struct lsw_nt_trap {
+    __u64 start;             /* First code byte of the NT range */
+    __u64 end;               /* End of the NT range */
+    __s32 fd;                /* This /dev/lsw descriptor */
+    __u32 reserved;          /* Must be 0 */
+};
+
 /* ioctl commands */
 #define LSW_IOCTL_REGISTER_PE   _IOW(LSW_IOCTL_MAGIC, 1, struct lsw_pe_info)
 #define LSW_IOCTL_UNREGISTER_PE _IOW(LSW_IOCTL_MAGIC, 2, __u32)
 #define LSW_IOCTL_GET_STATUS    _IOR(LSW_IOCTL_MAGIC, 3, __u32)
 #define LSW_IOCTL_EXECUTE_PE    _IOW(LSW_IOCTL_MAGIC, 4, __u32)
 #define LSW_IOCTL_SYSCALL       _IOWR(LSW_IOCTL_MAGIC, 5, struct lsw_syscall_request)
+/* LSW_IOCTL_RING_SETUP (6) and LSW_IOCTL_RING_ENTER (7) are in lsw_ring.h */
+#define LSW_IOCTL_GET_STATS     _IOR(LSW_IOCTL_MAGIC, 8, struct lsw_stats)
+#define LSW_IOCTL_TRAP_NT_SYSCALLS _IOW(LSW_IOCTL_MAGIC, 9, struct lsw_nt_trap)
+
+/* What the syscall probe turns a trapped NT syscall into, with the NT
+ * number in the size field; not for userspace */
+#define LSW_IOCTL_NT_TRAP(nr)   _IOC(_IOC_NONE, LSW_IOCTL_MAGIC, 10, (nr))
 
 /* Device functions */
 int lsw_device_init(void);
 void lsw_device_exit(void);
+void lsw_device_process_exited(pid_t pid);
+bool lsw_device_pe_registered(pid_t pid);
 
 #endif /* LSW_DEVICE_H */
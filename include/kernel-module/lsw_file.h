@@ -11,14 +11,15 @@
 #define LSW_FILE_H
 
 #include <linux/types.h>
-#include <linux/list.h>
+#include <linux/mutex.h>
+#include "lsw_handle.h"
 
 /* File handle entry */
 struct lsw_file_handle {
-    struct list_head list;      /* List linkage */
+    struct lsw_object obj;      /* Refcount, owner (obj.pid), handle table entry */
     __u64 handle;               /* Win32 file handle */
-    __u32 pid;                  /* Process ID that owns this */
     struct file *linux_file;    /* Linux kernel file pointer */
+    struct mutex lock;          /* Serializes I/O on the file position */
     __u64 position;             /* Current file position */
     __u32 access;               /* Access flags */
     __u32 share;                /* Share mode */
@@ -43,10 +44,14 @@ struct lsw_file_handle {
 #define LSW_OPEN_ALWAYS           4
 #define LSW_TRUNCATE_EXISTING     5
 
+/* NtReadFile/NtWriteFile ByteOffset values other than a position */
+#define LSW_FILE_WRITE_TO_END_OF_FILE       (-1LL)
+#define LSW_FILE_USE_FILE_POINTER_POSITION  (-2LL)
+
 /**
  * lsw_file_open - Open or create a file
  * 
- * @pid: Process ID
+ * @pid: Process ID (tgid) whose handle table gets the handle
  * @path: File path
  * @access: Access flags
  * @share: Share mode
@@ -58,33 +63,41 @@ __u64 lsw_file_open(__u32 pid, const char *path, __u32 access,
                     __u32 share, __u32 disposition);
 
 /**
- * lsw_file_read - Read from a file
+ * lsw_file_read - Read from a file into a user buffer
  * 
- * @handle: File handle
- * @buffer: Output buffer
+ * @handle: File handle of the calling process
+ * @buffer: Userspace output buffer, filled in place (no size limit)
  * @size: Number of bytes to read
- * @bytes_read: Returns actual bytes read
+ * @offset: Byte offset, or LSW_FILE_USE_FILE_POINTER_POSITION
+ * @bytes_read: Returns actual bytes read (0 at end of file)
+ * 
+ * The file pointer ends up after the data read, as for synchronous
+ * Win32 handles.
  * 
  * Returns: 0 on success, negative on error
  */
-int lsw_file_read(__u64 handle, void *buffer, __u64 size, __u64 *bytes_read);
+int lsw_file_read(__u64 handle, void __user *buffer, __u64 size, __s64 offset,
+                  __u64 *bytes_read);
 
 /**
- * lsw_file_write - Write to a file
+ * lsw_file_write - Write a user buffer to a file
  * 
- * @handle: File handle
- * @buffer: Data to write
+ * @handle: File handle of the calling process
+ * @buffer: Userspace data to write, read in place (no size limit)
  * @size: Number of bytes to write
+ * @offset: Byte offset, LSW_FILE_WRITE_TO_END_OF_FILE or
+ *          LSW_FILE_USE_FILE_POINTER_POSITION
  * @bytes_written: Returns actual bytes written
  * 
  * Returns: 0 on success, negative on error
  */
-int lsw_file_write(__u64 handle, const void *buffer, __u64 size, __u64 *bytes_written);
+int lsw_file_write(__u64 handle, const void __user *buffer, __u64 size, __s64 offset,
+                   __u64 *bytes_written);
 
 /**
  * lsw_file_close - Close a file handle
  * 
- * @handle: File handle to close
+ * @handle: File handle of the calling process
  * 
  * Returns: 0 on success, negative on error
  */
@@ -93,7 +106,7 @@ int lsw_file_close(__u64 handle);
 /**
  * lsw_file_get_size - Get file size from handle
  * 
- * @handle: File handle
+ * @handle: File handle of the calling process
  * @size_out: Returns file size in bytes
  * 
  * Returns: 0 on success, negative on error
@@ -103,7 +116,7 @@ int lsw_file_get_size(__u64 handle, __u64 *size_out);
 /**
  * lsw_file_seek - Seek to position in file
  * 
- * @handle: File handle
+ * @handle: File handle of the calling process
  * @offset: Offset to seek to
  * @whence: 0=FILE_BEGIN, 1=FILE_CURRENT, 2=FILE_END
  * @new_pos_out: Returns new file position (optional, can be NULL)
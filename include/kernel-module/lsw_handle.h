@@ -0,0 +1,121 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Kernel Module
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Per-process Win32 handle tables
+ * Refcounted kernel objects behind xarray-backed handle tables
+ */
+
+#ifndef LSW_HANDLE_H
+#define LSW_HANDLE_H
+
+#include <linux/types.h>
+#include <linux/kref.h>
+#include <linux/rcupdate.h>
+
+/*
+ * Each process (Linux tgid) has its own table, like on Windows: handle
+ * values are multiples of 4, the lowest free one is handed out, and a
+ * closed handle's value is reused. Lookups take no lock (RCU) and return
+ * a reference, so an object stays alive while a syscall uses it even if
+ * another thread closes the handle meanwhile.
+ */
+
+/* Object types */
+#define LSW_OBJECT_ANY      0   /* Lookup filter: any type */
+#define LSW_OBJECT_FILE     1
+#define LSW_OBJECT_SYNC     2
+#define LSW_OBJECT_MEMORY   3   /* Refcounted only; not in handle tables */
+
+/* Handle table capacity per process (Windows allows ~16M handles) */
+#define LSW_HANDLE_INDEX_MAX  0x00ffffff
+
+/* Common header of every refcounted object */
+struct lsw_object {
+    struct kref ref;            /* One per handle and per user in flight */
+    __u32 type;                 /* LSW_OBJECT_* */
+    __u32 pid;                  /* Owning process (tgid) */
+    void (*destroy)(struct lsw_object *obj);  /* Last reference dropped */
+    struct rcu_head rcu;        /* destroy frees the container with kfree_rcu */
+};
+
+/**
+ * lsw_object_init - Initialize an object with one reference
+ *
+ * @obj: Object header embedded in the container
+ * @type: LSW_OBJECT_*
+ * @pid: Owning process
+ * @destroy: Releases the container's resources and frees it with
+ *           kfree_rcu (lock-free lookups may still be reading it)
+ */
+void lsw_object_init(struct lsw_object *obj, __u32 type, __u32 pid,
+                     void (*destroy)(struct lsw_object *obj));
+
+/**
+ * lsw_object_put - Drop a reference; the last one destroys the object
+ */
+void lsw_object_put(struct lsw_object *obj);
+
+/**
+ * lsw_handle_insert - Give an object a handle in its owner's table
+ *
+ * @obj: Initialized object; the table takes over its reference
+ *
+ * Returns: Handle value, or 0 on error (the caller keeps the reference)
+ */
+__u64 lsw_handle_insert(struct lsw_object *obj);
+
+/**
+ * lsw_handle_get - Look up a handle
+ *
+ * @pid: Process whose table to search
+ * @handle: Handle value
+ * @type: LSW_OBJECT_* the handle must refer to, or LSW_OBJECT_ANY
+ *
+ * Lock-free; safe in any context. Returns: the object with a new
+ * reference (drop with lsw_object_put), or NULL
+ */
+struct lsw_object *lsw_handle_get(__u32 pid, __u64 handle, __u32 type);
+
+/**
+ * lsw_handle_close - Close a handle
+ *
+ * @pid: Process whose table holds the handle
+ * @handle: Handle value
+ * @type: LSW_OBJECT_* the handle must refer to, or LSW_OBJECT_ANY
+ *
+ * Returns: 0 on success, -EBADF if there is no such handle
+ */
+int lsw_handle_close(__u32 pid, __u64 handle, __u32 type);
+
+/**
+ * lsw_handle_close_process - Close a process's handles of one type
+ *
+ * @pid: Process ID to cleanup
+ * @type: LSW_OBJECT_* to close, or LSW_OBJECT_ANY
+ *
+ * Returns: Number of handles closed
+ */
+int lsw_handle_close_process(__u32 pid, __u32 type);
+
+/**
+ * lsw_handle_has_table - Whether a process has a handle table
+ *
+ * Lock-free; safe in any context.
+ */
+bool lsw_handle_has_table(__u32 pid);
+
+/**
+ * lsw_handle_count - Live handle tables and handles over all processes
+ */
+void lsw_handle_count(__u32 *tables, __u32 *handles);
+
+/**
+ * lsw_handle_close_all - Close every process's handles of one type
+ *
+ * Returns: Number of handles closed (leaks, at module exit)
+ */
+int lsw_handle_close_all(__u32 type);
+
+#endif /* LSW_HANDLE_H */
@@ -42,6 +42,19 @@
 #define lsw_err(fmt, ...) \
     pr_err("[LSW] " fmt "\n", ##__VA_ARGS__)
 
+/*
+ * Per-call logging on hot paths (syscall handlers): rate-limited, and
+ * compiled out entirely in production builds (no DEBUG, see LSW_DEBUG in
+ * the Makefile), dynamic debug included.
+ */
+#ifdef DEBUG
+#define lsw_trace(fmt, ...) \
+    pr_debug_ratelimited("[LSW] " fmt "\n", ##__VA_ARGS__)
+#else
+#define lsw_trace(fmt, ...) \
+    no_printk(KERN_DEBUG "[LSW] " fmt "\n", ##__VA_ARGS__)
+#endif
+
 /* LSW kernel module state */
 struct lsw_state {
     bool initialized;
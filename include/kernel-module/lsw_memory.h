@@ -11,14 +11,13 @@
 #define LSW_MEMORY_H
 
 #include <linux/types.h>
-#include <linux/list.h>
+#include "lsw_handle.h"
 
 /* Memory allocation entry */
 struct lsw_memory_region {
-    struct list_head list;      /* List linkage */
+    struct lsw_object obj;      /* Refcount and owner (obj.pid) */
     __u64 base_address;         /* Virtual base address */
     __u64 size;                 /* Size in bytes */
-    __u32 pid;                  /* Process ID that owns this */
     void *kernel_addr;          /* Actual kernel allocation */
     __u32 protect;              /* Protection flags */
     __u32 flags;                /* Allocation flags */
@@ -81,6 +80,15 @@ int lsw_memory_free(__u32 pid, __u64 base, __u64 size, __u32 free_type);
  */
 void lsw_memory_cleanup_process(__u32 pid);
 
+/**
+ * lsw_memory_has_space - Whether a process has memory allocated
+ * 
+ * @pid: Process ID
+ * 
+ * Lock-free; safe in any context
+ */
+bool lsw_memory_has_space(__u32 pid);
+
 /**
  * lsw_memory_read - Read memory from a process
  * 
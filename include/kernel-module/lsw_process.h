@@ -13,6 +13,8 @@
 #include <linux/types.h>
 #include <linux/list.h>
 
+struct file;
+
 /* Win32 process entry */
 struct lsw_process {
     struct list_head list;      /* List linkage */
@@ -78,13 +80,55 @@ int lsw_process_terminate(__u32 win32_pid, __u32 exit_code);
 int lsw_thread_terminate(__u32 win32_tid, __u32 exit_code);
 
 /**
- * lsw_process_is_pe_pid - Check if a Linux PID is a registered PE process
+ * lsw_process_traps_nt - Check if a Linux PID opted in to bare NT syscalls
+ *
+ * @linux_pid: The Linux process ID (tgid) to check
+ *
+ * Returns: true if its syscalls from its NT range are trapped.
+ */
+bool lsw_process_traps_nt(pid_t linux_pid);
+
+/**
+ * lsw_process_trap_nt - Take bare syscalls from a code range as NT ones
+ *
+ * @linux_pid: The Linux process ID (tgid)
+ * @file:      The /dev/lsw file the process opted in on
+ * @fd:        Its descriptor in the process
+ * @start:     First code byte of the NT range
+ * @end:       End of the NT range
+ *
+ * The first process to opt in attaches the syscall probe; opting in
+ * again replaces the range. Process context.
+ *
+ * Returns: 0 on success, negative on error
+ */
+int lsw_process_trap_nt(pid_t linux_pid, struct file *file, int fd,
+                        __u64 start, __u64 end);
+
+/**
+ * lsw_process_untrap_nt - Opt out; the last one detaches the probe
+ *
+ * @linux_pid: The Linux process ID (tgid)
+ */
+void lsw_process_untrap_nt(pid_t linux_pid);
+
+/**
+ * lsw_process_untrap_file - Opt out every process that opted in on file
+ *
+ * @file: A /dev/lsw file that is being released
+ */
+void lsw_process_untrap_file(struct file *file);
+
+/**
+ * lsw_process_nt_trap_fd - Look up where to trap a syscall (probe only)
  *
- * @linux_pid: The Linux task PID to check
+ * @linux_pid: The Linux process ID (tgid)
+ * @ip:        User instruction pointer after the syscall instruction
+ * @fd:        Set to the /dev/lsw descriptor to trap into
  *
- * Returns: true if the PID is currently running a PE image under LSW.
+ * Returns: true if the syscall came from the process's NT range.
  */
-bool lsw_process_is_pe_pid(pid_t linux_pid);
+bool lsw_process_nt_trap_fd(pid_t linux_pid, __u64 ip, int *fd);
 
 /* Initialize/cleanup process system */
 int lsw_process_init(void);
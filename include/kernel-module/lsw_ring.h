@@ -0,0 +1,136 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Kernel Module
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Shared-memory syscall ring
+ * Batches many syscall requests into one kernel transition
+ */
+
+#ifndef LSW_RING_H
+#define LSW_RING_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+#include "lsw_syscall.h"
+
+/*
+ * LSW_IOCTL_RING_SETUP gives an open /dev/lsw a submission and a
+ * completion queue in one region that userspace maps with mmap(offset 0).
+ * Userspace fills submission entries and advances sq_tail; one
+ * LSW_IOCTL_RING_ENTER then runs them in order in the caller's context
+ * and posts a completion for each, advancing sq_head and cq_tail.
+ * Userspace reaps completions and advances cq_head.
+ *
+ * The ring's lock only covers claiming entries and posting completions,
+ * so an entry that blocks does not hold up other threads' ENTERs.
+ * Threads entering at once run different chains side by side;
+ * completions are still posted in submission order. NtTerminateThread
+ * and NtTerminateProcess are refused with -EOPNOTSUPP, since they would
+ * not return to post their completion.
+ *
+ * Each side only writes its own indices and reads the other's with
+ * acquire semantics; indices are free-running and masked on use.
+ */
+
+/* ioctl magic number (as in lsw_device.h) */
+#define LSW_IOCTL_MAGIC 'L'
+
+#define LSW_RING_MAX_ENTRIES      4096
+
+/*
+ * Submission flags
+ *
+ * LSW_RING_SQE_LINK: the entry continues the chain started by the last
+ * entry without the flag, and gets that entry's return value as args[0]
+ * (e.g. a handle from NtCreateFile for the read and close after it).
+ * If that first entry failed, the linked entries complete with
+ * -ECANCELED without running; a later entry failing does not stop the
+ * rest, so a trailing NtClose still runs. An ENTER that finds the
+ * chain's first entry still running in another ENTER stops before the
+ * linked entries (-EAGAIN if it ran nothing).
+ */
+#define LSW_RING_SQE_LINK         0x00000001
+
+/* LSW_IOCTL_RING_SETUP argument */
+struct lsw_ring_params {
+    __u32 entries;           /* In: queue depth (rounded up to a power of 2); out: actual */
+    __u32 flags;             /* In: must be 0 */
+    __u32 sq_offset;         /* Out: offset of the submission entries in the mapping */
+    __u32 cq_offset;         /* Out: offset of the completion entries in the mapping */
+    __u64 map_size;          /* Out: bytes to mmap at offset 0 */
+};
+
+/* Start of the mapping */
+struct lsw_ring_header {
+    __u32 sq_head;           /* Next entry the kernel consumes (kernel writes) */
+    __u32 sq_tail;           /* Next free submission slot (userspace writes) */
+    __u32 cq_head;           /* Next completion to reap (userspace writes) */
+    __u32 cq_tail;           /* Next completion slot (kernel writes) */
+    __u32 entries;           /* Queue depth, same for both queues */
+    __u32 mask;              /* entries - 1 */
+    __u32 reserved[2];
+};
+
+/* Submission entry: a syscall request as for LSW_IOCTL_SYSCALL */
+struct lsw_ring_sqe {
+    __u64 user_data;         /* Copied to the completion */
+    __u32 flags;             /* LSW_RING_SQE_* */
+    __u32 reserved;
+    struct lsw_syscall_request req;
+};
+
+/* Completion entry */
+struct lsw_ring_cqe {
+    __u64 user_data;         /* From the submission */
+    __u64 return_value;      /* req.return_value */
+    __s32 error_code;        /* req.error_code */
+    __u32 reserved;
+};
+
+/* ioctl commands */
+#define LSW_IOCTL_RING_SETUP    _IOWR(LSW_IOCTL_MAGIC, 6, struct lsw_ring_params)
+#define LSW_IOCTL_RING_ENTER    _IO(LSW_IOCTL_MAGIC, 7)        /* arg: entries to submit, by value */
+
+#ifdef __KERNEL__
+
+struct file;
+struct vm_area_struct;
+
+/**
+ * lsw_ring_setup - Create the ring of an open /dev/lsw
+ *
+ * @file: Device file; one ring per open file
+ * @user_params: struct lsw_ring_params in userspace
+ *
+ * Returns: 0 on success, -EBUSY if the file already has a ring
+ */
+long lsw_ring_setup(struct file *file, struct lsw_ring_params __user *user_params);
+
+/**
+ * lsw_ring_enter - Run submitted requests
+ *
+ * @file: Device file with a ring
+ * @to_submit: Maximum number of entries to consume
+ *
+ * Stops early when the completion queue is full. Runs the handlers
+ * without the ring's lock held.
+ *
+ * Returns: Number of entries consumed, -EAGAIN if the next entry is
+ * linked to a chain another ENTER is still running, or negative on error
+ */
+long lsw_ring_enter(struct file *file, __u32 to_submit);
+
+/**
+ * lsw_ring_mmap - Map a file's ring into userspace
+ */
+int lsw_ring_mmap(struct file *file, struct vm_area_struct *vma);
+
+/**
+ * lsw_ring_release - Free a file's ring when the file is closed
+ */
+void lsw_ring_release(struct file *file);
+
+#endif /* __KERNEL__ */
+
+#endif /* LSW_RING_H */
@@ -11,8 +11,8 @@
 #define LSW_SYNC_H
 
 #include <linux/types.h>
-#include <linux/list.h>
 #include <linux/wait.h>
+#include "lsw_handle.h"
 
 /* Sync object types */
 #define LSW_SYNC_EVENT      1
@@ -21,10 +21,9 @@
 
 /* Sync object entry */
 struct lsw_sync_object {
-    struct list_head list;         /* List linkage */
+    struct lsw_object obj;         /* Refcount, owner (obj.pid), handle table entry */
     __u64 handle;                  /* Win32 handle */
     __u32 type;                    /* Object type */
-    __u32 pid;                     /* Process ID that owns this */
     wait_queue_head_t wait_queue;  /* Linux wait queue */
     atomic_t signaled;             /* Signal state */
     atomic_t count;                /* For semaphores */
@@ -56,7 +55,7 @@ __u64 lsw_sync_create_mutex(__u32 pid, bool initial_owner);
 /**
  * lsw_sync_wait - Wait for sync object to be signaled
  * 
- * @handle: Sync object handle
+ * @handle: Sync object handle of the calling process
  * @timeout_ms: Timeout in milliseconds (0 = infinite)
  * 
  * Returns: 0 on success, -ETIMEDOUT on timeout, negative on error
@@ -66,7 +65,7 @@ int lsw_sync_wait(__u64 handle, __u32 timeout_ms);
 /**
  * lsw_sync_signal - Signal a sync object
  * 
- * @handle: Sync object handle
+ * @handle: Sync object handle of the calling process
  * 
  * Returns: 0 on success, negative on error
  */
@@ -75,7 +74,7 @@ int lsw_sync_signal(__u64 handle);
 /**
  * lsw_sync_close - Close sync object handle
  * 
- * @handle: Handle to close
+ * @handle: Handle of the calling process to close
  * 
  * Returns: 0 on success, negative on error
  */
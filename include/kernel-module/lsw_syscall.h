@@ -43,6 +43,16 @@
 #define LSW_SYSCALL_LswReadConsole        0x1003  /* LSW custom - Read from console */
 #define LSW_SYSCALL_LswGetStdHandle       0x1004  /* LSW custom - Get standard handle */
 
+/*
+ * Dispatch index space: NT service numbers below LSW_SYSCALL_NT_COUNT,
+ * then the LSW custom block at LSW_SYSCALL_LSW_BASE. Numbers outside
+ * both are unimplemented.
+ */
+#define LSW_SYSCALL_NT_COUNT              0x0200
+#define LSW_SYSCALL_LSW_BASE              0x1000
+#define LSW_SYSCALL_LSW_COUNT             0x0010
+#define LSW_SYSCALL_SLOTS                 (LSW_SYSCALL_NT_COUNT + LSW_SYSCALL_LSW_COUNT)
+
 /* Syscall request structure from userspace */
 struct lsw_syscall_request {
     __u32 syscall_number;    /* Win32 syscall number */
@@ -52,6 +62,13 @@ struct lsw_syscall_request {
     __s32 error_code;        /* Error code (filled by kernel) */
 };
 
+/* IO_STATUS_BLOCK (x64 layout) that NtReadFile/NtWriteFile fill in */
+struct lsw_io_status_block {
+    __u32 status;            /* NTSTATUS */
+    __u32 reserved;          /* Upper half of the Status/Pointer union */
+    __u64 information;       /* Bytes transferred */
+};
+
 /* Syscall handler function type */
 typedef long (*lsw_syscall_handler_t)(struct lsw_syscall_request *req);
 
@@ -88,6 +105,17 @@ long lsw_syscall_NtFlushBuffersFile(struct lsw_syscall_request *req);
 long lsw_syscall_NtQueryInformationFile(struct lsw_syscall_request *req);
 long lsw_syscall_NtSetInformationFile(struct lsw_syscall_request *req);
 
+/*
+ * Accounting of processes that trap bare NT syscalls, for the
+ * do_syscall_64 probe: the probe is attached on the first get and
+ * detached on the last put. Process context only (may sleep).
+ */
+void lsw_syscall_hook_get(void);
+void lsw_syscall_hook_put(void);
+
+/* Run a bare NT syscall the probe turned into LSW_IOCTL_NT_TRAP(nr) */
+long lsw_syscall_trapped(u32 nr);
+
 /* Initialize syscall translation system */
 int lsw_syscall_init(void);
 void lsw_syscall_exit(void);
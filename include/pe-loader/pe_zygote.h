@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * PE Zygote - pre-initialized launcher server and its thin client
+ */
+
+#ifndef LSW_PE_ZYGOTE_H
+#define LSW_PE_ZYGOTE_H
+
+// `lsw-pe-loader --zygote <socket>` does the image-independent startup
+// (configuration, prefix, registry, Win32 API tables, KUSER page, .NET
+// detection) once, then forks a child per launch request. The child takes
+// on the client's stdio (passed with SCM_RIGHTS), working directory,
+// environment and argv, and continues through the normal launch path.
+//
+// With LSW_ZYGOTE=<socket> in the environment, `lsw-pe-loader --launch`
+// becomes the thin client: it forwards its argv and environment and
+// relays the child's exit status. CreateProcess children inherit the
+// variable, so they start through the zygote as well. A client whose
+// configuration (prefix, registry, drives) or LSW_OVERLAY differs from
+// the zygote's is turned away and launches locally.
+
+// Socket a launch is handed to when set
+#define PE_ZYGOTE_ENV   "LSW_ZYGOTE"
+
+// pe_zygote_serve() return value in a forked child
+#define PE_ZYGOTE_CHILD (-1)
+
+// Serve launch requests on `socket_path`. Returns the server's exit
+// status when it stops; in each child returns PE_ZYGOTE_CHILD, with
+// *argc / *argv replaced by the request's.
+int pe_zygote_serve(const char* socket_path, int* argc, char*** argv);
+
+// Run argv through the zygote listening on `socket_path`. Returns the
+// child's exit status, or -1 when the zygote cannot take this launch
+// (not running, handles that cannot be passed, or another prefix or
+// overlay) and the caller should load the image itself.
+int pe_zygote_launch(const char* socket_path, int argc, char** argv);
+
+#endif // LSW_PE_ZYGOTE_H
@@ -33,7 +33,8 @@
  * 
  * What: Translates C:\path to /mnt/c/path
  * Why: Windows apps expect Windows-style paths
- * How: Replace backslashes, map drive letters
+ * How: Replace backslashes, map drive letters, then fix the case of
+ *      each existing component from a per-directory listing cache
  * 
  * @param windows_path Input Windows path (e.g., "C:\Windows\notepad.exe")
  * @param linux_path Output Linux path buffer
@@ -59,6 +60,17 @@ lsw_status_t lsw_fs_linux_to_win(
     size_t buffer_size
 );
 
+/**
+ * Invalidate cached case resolution
+ * 
+ * What: Forgets the cached listing of linux_path's parent directory
+ * Why: lsw_fs_win_to_linux resolves names case-insensitively from
+ *      per-directory listings; call this after creating, renaming or
+ *      deleting linux_path so the next lookup rescans
+ * How: Marks the parent's (dev, ino) listing stale
+ */
+void lsw_fs_invalidate(const char* linux_path);
+
 // ============================================================================
 // SECTION: Path Operations
 // ============================================================================
@@ -30,11 +30,29 @@ struct lsw_pe_info {
     char     executable_path[256]; /* Path to .exe file */
 };
 
+/* Live kernel state, for leak checks */
+struct lsw_stats {
+    uint32_t pe_processes;      /* Registered PE processes */
+    uint32_t handle_tables;     /* Processes with open handles */
+    uint32_t handles;           /* Open handles */
+    uint32_t memory_regions;    /* Allocated memory regions */
+};
+
+/* Opt-in for bare NT syscalls from [start, end) of the calling process */
+struct lsw_nt_trap {
+    uint64_t start;             /* First code byte of the NT range */
+    uint64_t end;               /* End of the NT range */
+    int32_t  fd;                /* The /dev/lsw descriptor used */
+    uint32_t reserved;          /* Must be 0 */
+};
+
 /* ioctl commands */
 #define LSW_IOCTL_REGISTER_PE   _IOW(LSW_IOCTL_MAGIC, 1, struct lsw_pe_info)
 #define LSW_IOCTL_UNREGISTER_PE _IOW(LSW_IOCTL_MAGIC, 2, uint32_t)
 #define LSW_IOCTL_GET_STATUS    _IOR(LSW_IOCTL_MAGIC, 3, uint32_t)
 #define LSW_IOCTL_EXECUTE_PE    _IOW(LSW_IOCTL_MAGIC, 4, uint32_t)
+#define LSW_IOCTL_GET_STATS     _IOR(LSW_IOCTL_MAGIC, 8, struct lsw_stats)
+#define LSW_IOCTL_TRAP_NT_SYSCALLS _IOW(LSW_IOCTL_MAGIC, 9, struct lsw_nt_trap)
 
 /**
  * Initialize connection to LSW kernel module
@@ -65,10 +83,24 @@ int lsw_kernel_unregister_pe(int fd, pid_t pid);
  */
 int lsw_kernel_get_status(int fd);
 
+/**
+ * Get the kernel's live object counts
+ * Returns: 0 on success, -1 on error
+ */
+int lsw_kernel_get_stats(int fd, struct lsw_stats *stats);
+
 /**
  * Execute a registered PE process
  * Returns: 0 on success, -1 on error
  */
 int lsw_kernel_execute_pe(int fd, pid_t pid);
 
+/**
+ * Have bare syscall instructions in [start, end) of this process taken
+ * as NT syscalls. The process must be registered under its own pid and
+ * fd kept open; start == end == 0 turns it off again.
+ * Returns: 0 on success, -1 on error
+ */
+int lsw_kernel_trap_nt_syscalls(int fd, uint64_t start, uint64_t end);
+
 #endif /* LSW_KERNEL_CLIENT_H */
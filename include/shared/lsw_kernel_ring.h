@@ -0,0 +1,62 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Userspace Kernel Interface
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Userspace side of the /dev/lsw syscall ring
+ */
+
+#ifndef LSW_KERNEL_RING_H
+#define LSW_KERNEL_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel-module/lsw_ring.h"
+
+/* A mapped ring; one per open /dev/lsw */
+struct lsw_kernel_ring {
+    int fd;                          /* /dev/lsw the ring belongs to */
+    void* map;                       /* Shared region */
+    size_t map_size;
+    struct lsw_ring_header* hdr;
+    struct lsw_ring_sqe* sqes;
+    struct lsw_ring_cqe* cqes;
+    uint32_t mask;
+    uint32_t sq_tail;                /* Entries taken, published on submit */
+};
+
+/**
+ * Create and map the ring of an open /dev/lsw
+ * Returns: 0 on success, -1 on error
+ */
+int lsw_kernel_ring_init(int fd, uint32_t entries, struct lsw_kernel_ring* ring);
+
+/**
+ * Unmap a ring (the kernel frees it when the device fd is closed)
+ */
+void lsw_kernel_ring_exit(struct lsw_kernel_ring* ring);
+
+/**
+ * Next free submission entry, zeroed, or NULL when the queue is full
+ */
+struct lsw_ring_sqe* lsw_kernel_ring_get_sqe(struct lsw_kernel_ring* ring);
+
+/**
+ * Run every entry taken and not yet run with one ioctl
+ * Returns: number of entries the kernel ran (fewer when the completion
+ * queue fills up), -1 on error
+ */
+int lsw_kernel_ring_submit(struct lsw_kernel_ring* ring);
+
+/**
+ * Oldest unreaped completion, or NULL; release it with
+ * lsw_kernel_ring_cqe_seen()
+ */
+struct lsw_ring_cqe* lsw_kernel_ring_peek_cqe(struct lsw_kernel_ring* ring);
+
+/**
+ * Hand the completion returned by lsw_kernel_ring_peek_cqe() back
+ */
+void lsw_kernel_ring_cqe_seen(struct lsw_kernel_ring* ring);
+
+#endif /* LSW_KERNEL_RING_H */
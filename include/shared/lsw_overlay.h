@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ */
+
+#ifndef LSW_OVERLAY_H
+#define LSW_OVERLAY_H
+
+#include "lsw_types.h"
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * LSW Prefix Overlay
+ *
+ * What: Copy-on-write view of the C: drive and the registry
+ * Why: Parallel jobs sharing one prefix had to copy all of it to stay
+ *      isolated; with LSW_OVERLAY=<dir> the configured prefix becomes a
+ *      read-only base and every write lands in <dir>
+ * How: overlayfs mounted over the C: root in a private mount namespace
+ *      (a user namespace when unprivileged); where the kernel refuses,
+ *      path translation merges the layers itself. The registry always
+ *      layers natively: its hives are seeded from the base on first use.
+ *
+ *   <dir>/drive_c/     upper layer of C:
+ *   <dir>/.work/       overlayfs work directory
+ *   <dir>/registry/    hives of this job
+ *
+ * Userspace layering marks deleted base entries with an empty
+ * ".wh.<name>" file in the upper directory. A whiteout hides the base
+ * entry and everything below it, also once an upper entry of the same
+ * name has been created; listings never show whiteouts.
+ */
+
+// ============================================================================
+// SECTION: Mode
+// ============================================================================
+
+typedef enum {
+    LSW_OVERLAY_OFF = 0,        /* LSW_OVERLAY unset: the prefix is used directly */
+    LSW_OVERLAY_KERNEL,         /* overlayfs mounted over the C: root */
+    LSW_OVERLAY_USERSPACE       /* layers merged by path translation */
+} lsw_overlay_mode_t;
+
+/**
+ * Set up the overlay
+ *
+ * What: Create <dir> and mount the C: overlay
+ * Why: Jobs get an isolated prefix in milliseconds
+ * How: unshare a mount namespace and mount overlayfs; must run before
+ *      any thread is started. A child process inherits its parent's
+ *      mount and does not mount again.
+ *
+ * @return The mode in effect
+ */
+lsw_overlay_mode_t lsw_overlay_init(void);
+
+/**
+ * Get the overlay mode
+ *
+ * What: OFF, KERNEL or USERSPACE
+ * Why: Path translation and file operations only layer in USERSPACE
+ * How: Without lsw_overlay_init (tools, tests) a set LSW_OVERLAY means
+ *      USERSPACE unless the mount was inherited
+ */
+lsw_overlay_mode_t lsw_overlay_mode(void);
+
+// Overlay directory (absolute), or NULL when off
+const char* lsw_overlay_dir(void);
+
+// Upper and base roots of C:; NULL unless USERSPACE
+const char* lsw_overlay_upper_root(void);
+const char* lsw_overlay_lower_root(void);
+
+// ============================================================================
+// SECTION: Userspace Layering
+// ============================================================================
+
+/*
+ * The helpers below take translated Linux paths. Outside USERSPACE mode,
+ * or for paths outside C:, they are the plain system calls. All return
+ * 0, or -1 with errno set.
+ */
+
+// True for ".wh.<name>" entries, which listings skip
+bool lsw_overlay_is_whiteout_name(const char* name);
+
+// True if upper_dir holds a whiteout for name
+bool lsw_overlay_is_whited_out(const char* upper_dir, const char* name);
+
+/**
+ * Find the base directory under an upper directory
+ *
+ * What: The visible base counterpart of upper_path
+ * Why: Listings of a directory present in both layers merge the two
+ * How: Maps the path into the base, honouring whiteouts on the way
+ *
+ * @return true if the counterpart exists and is not whited out
+ */
+bool lsw_overlay_lower_dir(const char* upper_path, char* out, size_t size);
+
+/**
+ * Copy up before writing
+ *
+ * What: Make `path` writable in the upper layer
+ * Why: A file opened for writing or created must not touch the base
+ * How: Creates missing upper parents that exist in the base, copies a
+ *      base file up when keep_data is set, and rewrites `path` to the
+ *      upper path
+ */
+int lsw_overlay_copy_up(char* path, size_t size, bool keep_data);
+
+// unlink/rmdir/mkdir/rename on the merged view
+int lsw_overlay_unlink(const char* path);
+int lsw_overlay_rmdir(const char* path);
+int lsw_overlay_mkdir(const char* path, mode_t mode);
+int lsw_overlay_rename(const char* old_path, const char* new_path);
+
+#endif // LSW_OVERLAY_H
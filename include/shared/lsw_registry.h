@@ -15,7 +15,8 @@
  * 
  * What: Windows Registry emulation on Linux
  * Why: Windows apps expect registry to exist
- * How: Store key/value pairs in files, provide Windows-compatible API
+ * How: One mmap'd hive file per root plus an append-only journal,
+ *      indexed in memory; provide Windows-compatible API
  * 
  * Philosophy: Simple file-based storage, not complex database
  */
@@ -29,10 +30,11 @@
  * 
  * What: Open a key for reading/writing
  * Why: Windows apps use RegOpenKey
- * How: Map to file path, open if exists
+ * How: Look up the key in the hive index, open if exists
  * 
  * Example:
- *   HKEY_LOCAL_MACHINE\Software\MyApp → ~/.local/share/lsw/registry/HKLM/Software/MyApp
+ *   HKEY_LOCAL_MACHINE\Software\MyApp → key "Software\MyApp" in
+ *   ~/.local/share/lsw/registry/HKLM.hive (+ HKLM.journal)
  */
 lsw_status_t lsw_reg_open_key(
     lsw_hkey_t hkey,
@@ -45,7 +47,7 @@ lsw_status_t lsw_reg_open_key(
  * 
  * What: Create new key if it doesn't exist
  * Why: Apps create their own keys
- * How: Create directory structure
+ * How: Journal the key (and missing parents)
  */
 lsw_status_t lsw_reg_create_key(
     lsw_hkey_t hkey,
@@ -58,7 +60,7 @@ lsw_status_t lsw_reg_create_key(
  * 
  * What: Close an open key handle
  * Why: Release resources
- * How: Close file descriptor
+ * How: Free the handle slot
  */
 lsw_status_t lsw_reg_close_key(HANDLE handle);
 
@@ -67,10 +69,10 @@ lsw_status_t lsw_reg_close_key(HANDLE handle);
  * 
  * What: Read value from registry key
  * Why: Apps read configuration from registry
- * How: Read from file storage
+ * How: Copy from the in-memory index (no file I/O)
  * 
  * Example:
- *   RegQueryValue("Version") → Read from file
+ *   RegQueryValue("Version") → Read from index
  */
 lsw_status_t lsw_reg_query_value(
     HANDLE handle,
@@ -85,7 +87,7 @@ lsw_status_t lsw_reg_query_value(
  * 
  * What: Write value to registry key
  * Why: Apps save configuration
- * How: Write to file storage
+ * How: Append to the hive journal; identical rewrites are skipped
  */
 lsw_status_t lsw_reg_set_value(
     HANDLE handle,
@@ -100,7 +102,7 @@ lsw_status_t lsw_reg_set_value(
  * 
  * What: Remove value from key
  * Why: Apps clean up old settings
- * How: Remove from file storage
+ * How: Append a delete record to the hive journal
  */
 lsw_status_t lsw_reg_delete_value(
     HANDLE handle,
@@ -112,7 +114,7 @@ lsw_status_t lsw_reg_delete_value(
  * 
  * What: Remove entire key and subkeys
  * Why: Uninstallation
- * How: Remove directory tree
+ * How: Append a delete record; hive roots cannot be deleted
  */
 lsw_status_t lsw_reg_delete_key(
     lsw_hkey_t hkey,
@@ -124,7 +126,7 @@ lsw_status_t lsw_reg_delete_key(
  * 
  * What: List subkeys of a key
  * Why: Apps browse registry
- * How: List directories
+ * How: Index into the key's sorted subkey array
  */
 lsw_status_t lsw_reg_enum_keys(
     HANDLE handle,
@@ -138,7 +140,7 @@ lsw_status_t lsw_reg_enum_keys(
  * 
  * What: List values in a key
  * Why: Apps enumerate settings
- * How: List files in directory
+ * How: Index into the key's value array (creation order)
  */
 lsw_status_t lsw_reg_enum_values(
     HANDLE handle,
@@ -148,6 +150,79 @@ lsw_status_t lsw_reg_enum_values(
     lsw_reg_type_t* type
 );
 
+/**
+ * Registry key information
+ * 
+ * What: Counts and maximum sizes for RegQueryInfoKey
+ * Why: Apps size their enumeration buffers from these
+ * How: Lengths are UTF-8 bytes without the terminator, which is never
+ *      less than the UTF-16 length Windows reports
+ */
+typedef struct {
+    uint32_t subkeys;
+    uint32_t max_subkey_len;
+    uint32_t values;
+    uint32_t max_value_name_len;
+    uint32_t max_value_len;      /* data bytes */
+} lsw_reg_key_info_t;
+
+/**
+ * Query key information
+ * 
+ * What: Exact subkey/value counts and maximum name and data lengths
+ * Why: RegQueryInfoKey; enumerating to count was quadratic
+ * How: One pass over the key's index entries under one lock hold
+ */
+lsw_status_t lsw_reg_query_info(
+    HANDLE handle,
+    lsw_reg_key_info_t* info
+);
+
+/* Change notification filter (REG_NOTIFY_CHANGE_* values) */
+#define LSW_REG_NOTIFY_NAME        0x1   /* subkey added or deleted */
+#define LSW_REG_NOTIFY_ATTRIBUTES  0x2
+#define LSW_REG_NOTIFY_LAST_SET    0x4   /* value set or deleted */
+#define LSW_REG_NOTIFY_SECURITY    0x8
+#define LSW_REG_NOTIFY_ALL         0xF
+
+/* Runs with the registry locked: must not call back into lsw_reg_* */
+typedef void (*lsw_reg_notify_fn)(void* ctx);
+
+/**
+ * Watch key for changes
+ * 
+ * What: Call fn(ctx) once when the key (or, with subtree, anything
+ *       below it) changes as the filter selects
+ * Why: RegNotifyChangeKeyValue
+ * How: Matched as journal records are applied, including records other
+ *      processes append (picked up by an inotify thread on the journal).
+ *      Also fires when the key is deleted or the handle closed.
+ */
+lsw_status_t lsw_reg_notify(
+    HANDLE handle,
+    bool subtree,
+    uint32_t filter,
+    lsw_reg_notify_fn fn,
+    void* ctx
+);
+
+/**
+ * Cancel notifications
+ * 
+ * What: Drop pending watches registered with ctx, without calling them
+ * Why: The ctx (e.g. an event) is being destroyed
+ */
+void lsw_reg_notify_cancel(void* ctx);
+
+/**
+ * Flush registry
+ * 
+ * What: Make written keys and values durable
+ * Why: RegFlushKey; writes otherwise reach disk lazily
+ * How: fdatasync each modified hive journal
+ */
+lsw_status_t lsw_reg_flush(void);
+
 // ============================================================================
 // SECTION: Utility Functions
 // ============================================================================
@@ -156,7 +231,7 @@ lsw_status_t lsw_reg_enum_values(
  * Get registry path
  * 
  * What: Convert registry key to filesystem path
- * Why: Internal mapping
+ * Why: Legacy per-key directory layout (migrated on first use)
  * How: Build path from hkey and subkey
  * 
  * Example:
@@ -172,9 +247,9 @@ lsw_status_t lsw_reg_get_path(
 /**
  * Initialize registry system
  * 
- * What: Set up registry directories
+ * What: Set up registry directory
  * Why: First-time setup
- * How: Create base directory structure
+ * How: Create base directory; hive files are created on first use
  */
 lsw_status_t lsw_reg_init(void);
 
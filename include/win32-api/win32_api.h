@@ -70,6 +70,11 @@ typedef struct {
     uint32_t magic;
     void*    dirp;   /* DIR* from opendir() — void* to avoid dirent.h in header */
     int      dirfd;  /* fd from dirfd(dirp) */
+    void*    scan;   /* win32_dirscan_t* over dirfd, created by NtQueryDirectoryFile */
 } lsw_nt_dir_handle_t;
 
+/* Drop per-handle I/O state (directory watch, completion port association)
+ * kept by win32_api.c.  Every close path calls this before the handle goes. */
+void lsw_handle_unbind(void* handle);
+
 #endif // LSW_WIN32_API_H
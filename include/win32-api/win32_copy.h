@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 copy engine - CopyFile/CopyFileEx/MoveFileEx on Linux paths
+ */
+
+#ifndef LSW_WIN32_COPY_H
+#define LSW_WIN32_COPY_H
+
+#include <stdint.h>
+
+/*
+ * Data moves by the cheapest means the filesystems allow, in order:
+ * FICLONE (reflink, btrfs/xfs), copy_file_range, sendfile, then an
+ * aligned 1 MiB buffer loop. The destination gets the source's mode
+ * (Win32 attributes) and timestamps; a failed or cancelled copy removes
+ * it again.
+ *
+ * All functions take translated Linux paths and return 0 or an errno
+ * value; ECANCELED when the progress callback or the cancel flag
+ * stopped the copy.
+ */
+
+#define WIN32_COPY_FAIL_IF_EXISTS  0x1
+#define WIN32_COPY_NO_BUFFERING    0x2  /* keep the data out of the page cache */
+#define WIN32_COPY_WRITE_THROUGH   0x4  /* fsync the destination before returning */
+
+#define WIN32_MOVE_REPLACE         0x1
+#define WIN32_MOVE_COPY_ALLOWED    0x2  /* copy + delete across filesystems */
+#define WIN32_MOVE_WRITE_THROUGH   0x4  /* WIN32_COPY_WRITE_THROUGH for a copy */
+
+/*
+ * Called once before the first byte (done == 0) and after every chunk.
+ * Return WIN32_COPY_CONTINUE, _CANCEL/_STOP to abort, or _QUIET to
+ * continue without further calls (PROGRESS_* values).
+ */
+enum {
+    WIN32_COPY_CONTINUE = 0,
+    WIN32_COPY_CANCEL   = 1,
+    WIN32_COPY_STOP     = 2,
+    WIN32_COPY_QUIET    = 3
+};
+typedef uint32_t (*win32_copy_progress_t)(uint64_t total, uint64_t done, void* ctx);
+
+int win32_copy_file(const char* src, const char* dst, int flags,
+                    win32_copy_progress_t progress, void* ctx, const volatile int* cancel);
+
+/* Rename in place (renameat2, RENAME_NOREPLACE unless replacing); with
+ * WIN32_MOVE_COPY_ALLOWED a cross-filesystem file move copies and
+ * deletes the source */
+int win32_move_file(const char* src, const char* dst, int flags,
+                    win32_copy_progress_t progress, void* ctx, const volatile int* cancel);
+
+#endif /* LSW_WIN32_COPY_H */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 directory enumeration - one engine behind FindFirstFile* and
+ * NtQueryDirectoryFile
+ */
+
+#ifndef LSW_WIN32_DIRSCAN_H
+#define LSW_WIN32_DIRSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Search patterns are compiled once per search. "*", "*.*" and "*.ext"
+ * never reach the generic matcher; a pattern without wildcards is
+ * looked up directly instead of scanning. NT DOS wildcards (< > ")
+ * are accepted and mapped to their Win32 equivalents.
+ */
+#define WIN32_PATTERN_MAX 512
+
+typedef struct {
+    int    kind;                    /* internal: all / literal / suffix / glob */
+    int    case_sensitive;
+    size_t len;
+    char   text[WIN32_PATTERN_MAX];
+} win32_pattern_t;
+
+void win32_pattern_compile(win32_pattern_t* pat, const char* pattern, int case_sensitive);
+int  win32_pattern_match(const win32_pattern_t* pat, const char* name, size_t len);
+
+/* Scanner flags */
+#define WIN32_DIRSCAN_NAMES_ONLY     0x1    /* skip the per-entry stat (FileNamesInformation) */
+#define WIN32_DIRSCAN_LARGE_FETCH    0x2    /* FIND_FIRST_EX_LARGE_FETCH: bigger getdents64 batches */
+#define WIN32_DIRSCAN_CASE_SENSITIVE 0x4    /* FIND_FIRST_EX_CASE_SENSITIVE */
+#define WIN32_DIRSCAN_DIRS_ONLY      0x8    /* FindExSearchLimitToDirectories (advisory) */
+#define WIN32_DIRSCAN_NO_OVERLAY     0x10   /* list only the given directory, not its overlay base */
+
+#define WIN32_DIRSCAN_NAME_MAX 256          /* NAME_MAX bytes never need more UTF-16 units */
+
+/*
+ * One entry, already in Windows form. `name` and the entry itself are
+ * valid until the next call on the scanner. Without a stat only the
+ * name, file_id and the directory bit of `attributes` are filled.
+ */
+typedef struct {
+    const char* name;                       /* UTF-8 */
+    size_t      name_len;
+    uint16_t    wname[WIN32_DIRSCAN_NAME_MAX];
+    uint32_t    wname_len;                  /* UTF-16 units, no terminator */
+    uint32_t    attributes;                 /* FILE_ATTRIBUTE_* */
+    uint64_t    file_id;
+    int64_t     size;
+    int64_t     alloc_size;
+    int64_t     creation_time;              /* FILETIME */
+    int64_t     access_time;
+    int64_t     write_time;
+    int64_t     change_time;
+    int         have_stat;
+} win32_dirent_t;
+
+typedef struct win32_dirscan win32_dirscan_t;
+
+// Open `path` for enumeration; NULL with errno set on failure
+win32_dirscan_t* win32_dirscan_open(const char* path, const char* pattern, int flags);
+
+// Enumerate an already open directory fd; the fd stays owned by the caller
+win32_dirscan_t* win32_dirscan_fdopen(int fd, const char* pattern, int flags);
+
+// Next entry matching the pattern, or NULL at the end
+const win32_dirent_t* win32_dirscan_next(win32_dirscan_t* scan);
+
+// Return the last entry again on the next call (output buffer was full)
+void win32_dirscan_unget(win32_dirscan_t* scan);
+
+// Restart from the first entry, optionally with a new pattern (NULL keeps it)
+void win32_dirscan_rewind(win32_dirscan_t* scan, const char* pattern);
+
+void win32_dirscan_close(win32_dirscan_t* scan);
+
+#endif /* LSW_WIN32_DIRSCAN_H */
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 directory change notifications - inotify engine behind
+ * FindFirstChangeNotification and ReadDirectoryChangesW
+ */
+
+#ifndef LSW_WIN32_DIRWATCH_H
+#define LSW_WIN32_DIRWATCH_H
+
+#include <stdint.h>
+
+/* FILE_NOTIFY_CHANGE_* filter bits */
+#define WIN32_NOTIFY_CHANGE_FILE_NAME    0x001
+#define WIN32_NOTIFY_CHANGE_DIR_NAME     0x002
+#define WIN32_NOTIFY_CHANGE_ATTRIBUTES   0x004
+#define WIN32_NOTIFY_CHANGE_SIZE         0x008
+#define WIN32_NOTIFY_CHANGE_LAST_WRITE   0x010
+#define WIN32_NOTIFY_CHANGE_LAST_ACCESS  0x020
+#define WIN32_NOTIFY_CHANGE_CREATION     0x040
+#define WIN32_NOTIFY_CHANGE_SECURITY     0x100
+
+/* FILE_ACTION_* values written to FILE_NOTIFY_INFORMATION */
+#define WIN32_FILE_ACTION_ADDED             1
+#define WIN32_FILE_ACTION_REMOVED           2
+#define WIN32_FILE_ACTION_MODIFIED          3
+#define WIN32_FILE_ACTION_RENAMED_OLD_NAME  4
+#define WIN32_FILE_ACTION_RENAMED_NEW_NAME  5
+
+/* Read results */
+#define WIN32_DIRWATCH_OK         0     /* buffer filled with >= 1 record */
+#define WIN32_DIRWATCH_OVERFLOW   1     /* events were lost: rescan (ERROR_NOTIFY_ENUM_DIR) */
+#define WIN32_DIRWATCH_CANCELLED  2     /* watch closed with the read outstanding */
+#define WIN32_DIRWATCH_PENDING    3     /* queued: the callback reports completion */
+
+typedef struct win32_dirwatch win32_dirwatch_t;
+
+/*
+ * Completion of an asynchronous read. Runs on the watcher thread, or on
+ * the thread that cancels, closes or supersedes the read, after the
+ * engine lock is released.
+ */
+typedef void (*win32_dirwatch_cb)(void* ctx, uint32_t bytes, int status);
+
+// Watch `path` (a Linux directory); NULL with errno set on failure
+win32_dirwatch_t* win32_dirwatch_open(const char* path, int recursive, uint32_t filter);
+
+/*
+ * Change the subtree flag and filter of a watch; events already queued
+ * are kept. 0, or -1 with errno set if the directory can no longer be
+ * watched (the watch keeps whatever it still covers).
+ */
+int win32_dirwatch_configure(win32_dirwatch_t* w, int recursive, uint32_t filter);
+
+/*
+ * FindFirstChangeNotification style: `fn(ctx)` runs (engine lock held)
+ * whenever new events are queued.
+ */
+void win32_dirwatch_set_signal(win32_dirwatch_t* w, void (*fn)(void* ctx), void* ctx);
+
+/*
+ * Copy queued events into `buf` as FILE_NOTIFY_INFORMATION records.
+ * With events queued this completes at once (OK or OVERFLOW). Otherwise
+ * with a callback the read is parked and PENDING is returned; without
+ * one the caller blocks until events arrive. Events that do not fit
+ * stay queued for the next read.
+ */
+int win32_dirwatch_read(win32_dirwatch_t* w, void* buf, uint32_t len, uint32_t* bytes,
+                        win32_dirwatch_cb cb, void* ctx);
+
+// Cancel a parked read (its callback runs with CANCELLED); 1 if there was one
+int win32_dirwatch_cancel(win32_dirwatch_t* w);
+
+// Drop queued events (FindNextChangeNotification)
+void win32_dirwatch_discard(win32_dirwatch_t* w);
+
+// Stop watching; a parked read completes with CANCELLED
+void win32_dirwatch_close(win32_dirwatch_t* w);
+
+/*
+ * Keep `w` allocated across a racing win32_dirwatch_close(), e.g. while
+ * a read is started on it; reads on a closed watch return CANCELLED.
+ */
+void win32_dirwatch_get(win32_dirwatch_t* w);
+void win32_dirwatch_put(win32_dirwatch_t* w);
+
+#endif /* LSW_WIN32_DIRWATCH_H */
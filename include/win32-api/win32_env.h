@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 environment - process environment store shared by the
+ * kernel32, CRT and ntdll environment APIs
+ */
+
+#ifndef LSW_WIN32_ENV_H
+#define LSW_WIN32_ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The store is loaded from the Linux environment on first use and keeps
+ * both the Linux and the Windows form of every variable. Path-valued
+ * variables (PATH, TEMP, TMP, USERPROFILE, APPDATA, LOCALAPPDATA) are
+ * translated lazily, once per change, and cached as UTF-8 and UTF-16.
+ * Setting a variable stores the Windows value as given and writes its
+ * Linux form back with setenv, so Linux children inherit it.
+ *
+ * Names compare case-insensitively (ASCII), like Windows. Readers run
+ * concurrently; every change bumps the generation, so a caller that
+ * derived something from the environment can keep it while
+ * win32_env_generation() is unchanged.
+ */
+
+uint64_t win32_env_generation(void);
+
+/*
+ * GetEnvironmentVariable contract: the value length without terminator
+ * when it fits in `size` units, otherwise the size needed including the
+ * terminator; 0 when unset. `name_len` is in units, or -1 when the name
+ * is NUL-terminated.
+ */
+uint32_t win32_env_get(const char* name, char* buf, uint32_t size);
+uint32_t win32_env_get_w(const uint16_t* name, ptrdiff_t name_len, uint16_t* buf, uint32_t size);
+
+/*
+ * Pointers into the store for getenv/_wgetenv, NULL when unset. Like
+ * the CRT's they stay valid until the variable is changed.
+ */
+const char*     win32_env_peek(const char* name);
+const uint16_t* win32_env_peek_w(const uint16_t* name, ptrdiff_t name_len);
+
+/*
+ * Set (Windows form) or remove (value NULL) a variable. With overwrite
+ * 0 an existing value is kept. Returns 0, or an errno value (EINVAL for
+ * an empty name or one containing '=').
+ */
+int win32_env_set(const char* name, const char* value, int overwrite);
+int win32_env_set_w(const uint16_t* name, const uint16_t* value);
+
+/*
+ * Drop every variable and load environ again, after something replaced
+ * environ wholesale (a zygote child taking on its client's environment).
+ */
+void win32_env_reload(void);
+
+/*
+ * Environment blocks ("NAME=value\0...\0\0", sorted by name). Each call
+ * returns a private copy of the block cached for the current
+ * generation; release it with free().
+ */
+uint16_t* win32_env_block_w(void);
+char*     win32_env_block(void);
+
+/*
+ * PATH split into directories (Windows form), cached per generation.
+ * Returns the number of directories; *dirs is a private copy that stays
+ * valid until freed with free() (one allocation).
+ */
+size_t win32_env_path_dirs(char*** dirs);
+
+/*
+ * envp for a Linux child from a CreateProcess environment block (ANSI,
+ * or UTF-16 with `unicode`): path-valued variables are translated back
+ * to their Linux form and "=C:"-style entries dropped. NULL-terminated;
+ * release with free() (one allocation).
+ */
+char** win32_env_linux(const void* block, int unicode);
+
+#endif /* LSW_WIN32_ENV_H */
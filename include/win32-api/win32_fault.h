@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 fault dispatch - fault interceptors and vectored exception
+ * handlers, run from the SIGSEGV/SIGILL/... handler
+ */
+
+#ifndef LSW_WIN32_FAULT_H
+#define LSW_WIN32_FAULT_H
+
+#include <stdint.h>
+#include <signal.h>
+#include <ucontext.h>
+
+/*
+ * Runtimes that fault on purpose (GC write barriers, implicit null
+ * checks) register an interceptor for the code range and exception
+ * code they expect; a fault elsewhere never runs it. Both tables are
+ * read without locks from the signal handler, and a handler may add
+ * or remove entries while it runs.
+ */
+
+/* Matches every exception code */
+#define WIN32_FAULT_ANY_CODE  0
+
+/*
+ * Look at a fault in [begin, end) and either fix the context and
+ * return nonzero (execution resumes from `uc`) or return 0.
+ */
+typedef int (*win32_fault_interceptor_t)(uint32_t code, siginfo_t* si, ucontext_t* uc, void* ctx);
+
+/* 0 or an errno value; *handle (optional) identifies the registration */
+int win32_fault_register(uint64_t begin, uint64_t end, uint32_t code,
+                         win32_fault_interceptor_t fn, void* ctx, void** handle);
+int win32_fault_unregister(void* handle);
+
+/*
+ * AddVectoredExceptionHandler / AddVectoredContinueHandler: `handler`
+ * is an ms_abi PVECTORED_EXCEPTION_HANDLER. Returns the handle, NULL
+ * when out of memory.
+ */
+void* win32_veh_add(int continue_handler, int first, void* handler);
+int   win32_veh_remove(int continue_handler, void* handle);
+
+/*
+ * Translate a signal into an exception and offer it to the
+ * interceptors covering the faulting RIP, then to the vectored
+ * handlers. Returns nonzero when execution should resume from `uc`.
+ * Allocates nothing; the EXCEPTION_RECORD and CONTEXT are per thread.
+ */
+int win32_fault_dispatch(uint32_t code, siginfo_t* si, ucontext_t* uc);
+
+#endif /* LSW_WIN32_FAULT_H */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 function tables - process-wide registry of x64 unwind data
+ * (image .pdata, RtlAddFunctionTable, growable and callback tables)
+ */
+
+#ifndef LSW_WIN32_FTAB_H
+#define LSW_WIN32_FTAB_H
+
+#include <stdint.h>
+
+/*
+ * Every code range that can be unwound is registered here: mapped
+ * images with their exception directory, tables added by JITs, and
+ * callback ranges. Lookups never take a lock; they read an immutable
+ * snapshot of the range array that writers replace, and each thread
+ * remembers its last hit. Writers are serialized and wait until no
+ * lookup can still see what they removed, so a table may be freed as
+ * soon as its removal returns.
+ */
+
+/* x64 RUNTIME_FUNCTION; addresses are RVAs from the table's base */
+typedef struct {
+    uint32_t BeginAddress;
+    uint32_t EndAddress;
+    uint32_t UnwindData;
+} win32_runtime_function_t;
+
+/* PGET_RUNTIME_FUNCTION_CALLBACK */
+typedef win32_runtime_function_t* (__attribute__((ms_abi)) *win32_ftab_callback_t)(uint64_t pc, void* ctx);
+
+/*
+ * Registration functions return 0 or an errno value. The key of an
+ * image is its base; of a table, the table pointer; of a callback
+ * range, its identifier; of a growable table, the handle returned.
+ */
+int win32_ftab_add_image(uint64_t base, uint64_t size, const void* pdata, uint32_t pdata_bytes);
+int win32_ftab_add_table(const win32_runtime_function_t* table, uint32_t count, uint64_t base);
+int win32_ftab_add_callback(uint64_t id, uint64_t base, uint32_t length,
+                            win32_ftab_callback_t callback, void* ctx);
+
+/*
+ * Growable tables (RtlAddGrowableFunctionTable): entries are appended
+ * in order inside [range_base, range_end) and published by
+ * win32_ftab_grow without rebuilding the registry.
+ */
+int  win32_ftab_add_growable(const win32_runtime_function_t* table, uint32_t count, uint32_t max,
+                             uint64_t range_base, uint64_t range_end, void** handle);
+void win32_ftab_grow(void* handle, uint32_t count);
+
+/* Unregister by key; ENOENT if nothing has that key */
+int win32_ftab_remove(uint64_t key);
+
+/*
+ * Entry covering `pc`, or NULL. *image_base receives the base its RVAs
+ * are relative to and *image_size the image size (0 outside images);
+ * either pointer may be NULL.
+ */
+const win32_runtime_function_t* win32_ftab_lookup(uint64_t pc, uint64_t* image_base, uint64_t* image_size);
+
+/* Registered image containing `addr`: its base, 0 if none */
+uint64_t win32_ftab_image(uint64_t addr, uint64_t* image_size);
+
+#endif /* LSW_WIN32_FTAB_H */
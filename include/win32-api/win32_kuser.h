@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 KUSER_SHARED_DATA - shared time page and monotonic clocks
+ */
+
+#ifndef LSW_WIN32_KUSER_H
+#define LSW_WIN32_KUSER_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* Fixed user-mode address of KUSER_SHARED_DATA on every Windows version */
+#define WIN32_KUSER_ADDRESS   0x7FFE0000UL
+
+/* QueryPerformanceFrequency — 10 MHz, same as current Windows */
+#define WIN32_QPC_FREQUENCY   10000000ULL
+
+/*
+ * KSYSTEM_TIME: writers store High2Time, LowPart, High1Time in that
+ * order; readers loop until High1Time == High2Time.
+ */
+typedef struct {
+    volatile uint32_t LowPart;
+    volatile int32_t  High1Time;
+    volatile int32_t  High2Time;
+} win32_ksystem_time_t;
+
+/*
+ * Windows x64 KUSER_SHARED_DATA, the fields applications read directly.
+ * Everything else stays zero, which is a valid value for all of them:
+ *   0x7FFE0008  InterruptTime  (100 ns units since boot)
+ *   0x7FFE0014  SystemTime     (FILETIME, UTC)
+ *   0x7FFE0320  TickCountQuad  (ms = TickCountQuad * TickCountMultiplier >> 24)
+ */
+typedef struct {
+    uint32_t TickCountLowDeprecated;        // 0x000
+    uint32_t TickCountMultiplier;           // 0x004
+    win32_ksystem_time_t InterruptTime;     // 0x008
+    win32_ksystem_time_t SystemTime;        // 0x014
+    win32_ksystem_time_t TimeZoneBias;      // 0x020
+    uint16_t ImageNumberLow;                // 0x02c
+    uint16_t ImageNumberHigh;               // 0x02e
+    uint16_t NtSystemRoot[260];             // 0x030
+    uint32_t MaxStackTraceDepth;            // 0x238
+    uint32_t CryptoExponent;                // 0x23c
+    uint32_t TimeZoneId;                    // 0x240
+    uint32_t LargePageMinimum;              // 0x244
+    uint8_t  _pad_248[0x260 - 0x248];       // 0x248
+    uint32_t NtBuildNumber;                 // 0x260
+    uint32_t NtProductType;                 // 0x264
+    uint8_t  ProductTypeIsValid;            // 0x268
+    uint8_t  _pad_269;                      // 0x269
+    uint16_t NativeProcessorArchitecture;   // 0x26a
+    uint32_t NtMajorVersion;                // 0x26c
+    uint32_t NtMinorVersion;                // 0x270
+    uint8_t  ProcessorFeatures[64];         // 0x274
+    uint8_t  _pad_2b4[0x2d4 - 0x2b4];       // 0x2b4
+    uint8_t  KdDebuggerEnabled;             // 0x2d4
+    uint8_t  _pad_2d5[0x2e8 - 0x2d5];       // 0x2d5
+    uint32_t NumberOfPhysicalPages;         // 0x2e8
+    uint8_t  _pad_2ec[0x300 - 0x2ec];       // 0x2ec
+    int64_t  QpcFrequency;                  // 0x300
+    uint8_t  _pad_308[0x320 - 0x308];       // 0x308
+    union {                                 // 0x320
+        win32_ksystem_time_t TickCount;
+        volatile uint64_t    TickCountQuad;
+        uint32_t             _tick_pad[4];
+    };
+    uint8_t  _pad_330[0x3c8 - 0x330];       // 0x330
+    uint32_t ActiveProcessorCount;          // 0x3c8
+    uint8_t  ActiveGroupCount;              // 0x3cc
+    uint8_t  _pad_3cd;                      // 0x3cd
+    uint8_t  QpcBypassEnabled;              // 0x3ce  0: QPC must call in
+    uint8_t  QpcShift;                      // 0x3cf
+} win32_kuser_shared_data_t;
+
+// Map the page at WIN32_KUSER_ADDRESS and start the updater (idempotent)
+int win32_kuser_init(void);
+
+// In a child forked after init: replace the page shared with the parent
+// by a private one with its own updater
+int win32_kuser_fork_child(void);
+
+// Read-only view applications see, or NULL before win32_kuser_init()
+const win32_kuser_shared_data_t* win32_kuser_get(void);
+
+// Milliseconds since boot (GetTickCount64); a page load once initialized
+uint64_t win32_kuser_tick_count(void);
+
+// 100 ns units since boot, including suspend (QueryInterruptTime)
+uint64_t win32_kuser_interrupt_time(void);
+
+// QueryPerformanceCounter: CLOCK_MONOTONIC (vDSO) scaled to 10 MHz
+static inline uint64_t win32_qpc(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * WIN32_QPC_FREQUENCY + (uint64_t)ts.tv_nsec / 100;
+}
+
+#endif // LSW_WIN32_KUSER_H
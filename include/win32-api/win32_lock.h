@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 lock manager - CreateFile share modes and LockFile(Ex) byte
+ * ranges on open file description (OFD) locks
+ */
+
+#ifndef LSW_WIN32_LOCK_H
+#define LSW_WIN32_LOCK_H
+
+#include <stdint.h>
+
+/*
+ * Everything is kept in the kernel's lock table, so it is enforced
+ * between all LSW processes (and any Linux process using OFD or POSIX
+ * locks on the same bytes) and released by the kernel when the last
+ * descriptor of an open goes away, crash included.
+ *
+ * Share modes are published as shared locks on a few reserved bytes
+ * just below OFF_MAX, one per access class and one per denied class.
+ * Byte-range locks are clamped below those bytes.
+ *
+ * Functions return 0 or an errno value.
+ */
+
+/* Access classes of an open; FILE_SHARE_* use the same bits */
+#define WIN32_SHARE_READ    0x1
+#define WIN32_SHARE_WRITE   0x2
+#define WIN32_SHARE_DELETE  0x4
+
+/* Access classes of a Win32 access mask (GENERIC_*, FILE_*_DATA, DELETE) */
+uint32_t win32_share_classes(uint32_t access);
+
+/*
+ * Check an open against the others on the same file and publish its
+ * own access and share mode. `access` and `share` are WIN32_SHARE_*
+ * classes. EBUSY is a sharing violation; filesystems without OFD locks
+ * (and non-regular files) are not checked.
+ */
+int win32_share_acquire(int fd, uint32_t access, uint32_t share);
+
+/* EBUSY while someone has `path` open without FILE_SHARE_DELETE */
+int win32_share_check_delete(const char* path);
+
+/*
+ * LockFileEx ranges. Locks are per handle (fd): a second lock that
+ * overlaps an exclusive one of the same handle fails, shared locks
+ * may overlap, and an unlock must name exactly a locked range.
+ *
+ * EAGAIN: held by someone else (or by this handle). ENOLCK: unlock of a
+ * range that is not locked. EACCES: the open lacks the access the lock
+ * kind needs (read for shared, write for exclusive).
+ */
+#define WIN32_LOCK_EXCLUSIVE  0x1
+#define WIN32_LOCK_WAIT       0x2
+
+int win32_lock_range(int fd, uint64_t off, uint64_t len, int flags);
+int win32_unlock_range(int fd, uint64_t off, uint64_t len);
+
+/*
+ * Waiting lock without blocking the caller: returns 0 when the lock
+ * was granted at once, EINPROGRESS when `done` will be called from a
+ * waiter thread with the final result, or the error.
+ */
+typedef void (*win32_lock_done_t)(void* ctx, int err);
+int win32_lock_range_async(int fd, uint64_t off, uint64_t len, int flags,
+                           win32_lock_done_t done, void* ctx);
+
+/* The handle is being closed: drop its range records */
+void win32_lock_forget(int fd);
+
+#endif /* LSW_WIN32_LOCK_H */
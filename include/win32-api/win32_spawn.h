@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 process creation - CreateProcess on posix_spawn
+ */
+
+#ifndef LSW_WIN32_SPAWN_H
+#define LSW_WIN32_SPAWN_H
+
+#include <sys/types.h>
+
+/*
+ * Children start through posix_spawn, which glibc runs as
+ * clone(CLONE_VM|CLONE_VFORK): nothing of the parent's address space is
+ * copied, however large its image mappings are. Everything the child
+ * needs set up (standard handles, the handles it must not inherit,
+ * working directory, signal state) is expressed as spawn attributes and
+ * file actions, so no code of ours runs between clone and exec.
+ *
+ * Handles map onto descriptors: an inheritable handle is a descriptor
+ * without FD_CLOEXEC and keeps its number in the child.
+ */
+
+/* std_fd value: give the child /dev/null (an invalid STARTUPINFO handle) */
+#define WIN32_SPAWN_NULL  (-2)
+/* std_fd value: the child shares the parent's descriptor */
+#define WIN32_SPAWN_KEEP  (-1)
+
+/*
+ * A CREATE_SUSPENDED child gets the read end of a pipe in this variable
+ * and waits on it before running the image's entry point. The loader
+ * reads it with win32_spawn_wait_resume().
+ */
+#define WIN32_SPAWN_RESUME_ENV  "LSW_RESUME_FD"
+
+typedef struct {
+    const char*  path;          /* executable to run */
+    char* const* argv;
+    char* const* envp;          /* NULL: the current environ */
+    const char*  cwd;           /* NULL: the parent's */
+    int          std_fd[3];     /* descriptor, WIN32_SPAWN_KEEP or WIN32_SPAWN_NULL */
+    int          inherit;       /* bInheritHandles: pass every inheritable descriptor */
+    int          suspended;
+} win32_spawn_t;
+
+/*
+ * Start the child. With `suspended`, *resume_fd receives the write end
+ * of its gate (close-on-exec); otherwise it is set to -1. Returns 0 or
+ * an errno value.
+ */
+int win32_spawn(const win32_spawn_t* sp, pid_t* pid, int* resume_fd);
+
+/*
+ * Let a suspended child run (ResumeThread) and close the gate. Closing
+ * the gate without resuming also releases the child: a process nobody
+ * can resume any more is never useful.
+ */
+void win32_spawn_resume(int resume_fd);
+
+/* Child side: block until resumed when started suspended, then drop the
+ * variable so the child's own children do not see it */
+void win32_spawn_wait_resume(void);
+
+#endif /* LSW_WIN32_SPAWN_H */
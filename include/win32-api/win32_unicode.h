@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 Unicode - UTF-8/UTF-16 transcoding, code pages and UTF-16 strings
+ */
+
+#ifndef LSW_WIN32_UNICODE_H
+#define LSW_WIN32_UNICODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * All converters share one contract:
+ *   - dst == NULL queries the exact output length (in units of dst).
+ *   - >= 0 is the number of units produced.
+ *   - WIN32_UNICODE_INVALID: strict mode hit an ill-formed sequence.
+ *   - WIN32_UNICODE_NOSPACE: dst filled up to `cap`, more was needed.
+ *     Only whole characters are written, like Windows.
+ * In non-strict mode ill-formed input becomes U+FFFD (or the code
+ * page default character) instead of failing.
+ */
+#define WIN32_UNICODE_INVALID (-1)
+#define WIN32_UNICODE_NOSPACE (-2)
+
+ptrdiff_t win32_utf8_to_utf16(const uint8_t* src, size_t len, uint16_t* dst, size_t cap, int strict);
+ptrdiff_t win32_utf16_to_utf8(const uint16_t* src, size_t len, uint8_t* dst, size_t cap, int strict);
+
+/*
+ * Code pages. `cp` may be a pseudo code page (CP_ACP, CP_OEMCP, ...);
+ * it is resolved to 1252 / 437 to match GetACP() / GetOEMCP().
+ * Single-byte pages 1252/437/850 are built in; DBCS pages (932, 936,
+ * 949, 950) are generated from the system iconv on first use.
+ */
+typedef struct {
+    uint32_t max_char_size;
+    uint8_t  default_char[2];
+    uint8_t  lead_byte[12];     /* pairs of inclusive ranges, 0-terminated */
+} win32_cpinfo_t;
+
+unsigned int win32_codepage_resolve(unsigned int cp);
+int win32_codepage_valid(unsigned int cp);
+int win32_codepage_info(unsigned int cp, win32_cpinfo_t* info);
+int win32_codepage_is_lead_byte(unsigned int cp, uint8_t byte);
+
+ptrdiff_t win32_mb_to_utf16(unsigned int cp, const uint8_t* src, size_t len,
+                            uint16_t* dst, size_t cap, int strict);
+ptrdiff_t win32_utf16_to_mb(unsigned int cp, const uint16_t* src, size_t len,
+                            uint8_t* dst, size_t cap, const char* defchar, int* used_default);
+
+/*
+ * UTF-16 strings, length-aware (no terminator needed, no size cap).
+ * Case mapping is Unicode simple mapping per code unit, like Windows.
+ * Comparisons return <0 / 0 / >0.
+ *   cmp      - ordinal
+ *   icmp     - ordinal on uppercased units (CompareStringOrdinal ignore-case)
+ *   collate  - CompareStringW order: case-insensitive first, then
+ *              lowercase before uppercase unless ignore_case
+ *   sortkey  - LCMAP_SORTKEY bytes whose memcmp order matches collate;
+ *              returns the full key length even if `cap` is smaller
+ * win32_u16_map_case may run in place (d == s).
+ */
+size_t   win32_u16_len(const uint16_t* s);
+uint16_t win32_u16_upper(uint16_t c);
+uint16_t win32_u16_lower(uint16_t c);
+void     win32_u16_map_case(const uint16_t* s, size_t n, uint16_t* d, int upper);
+int      win32_u16_cmp(const uint16_t* a, size_t na, const uint16_t* b, size_t nb);
+int      win32_u16_icmp(const uint16_t* a, size_t na, const uint16_t* b, size_t nb);
+int      win32_u16_collate(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, int ignore_case);
+size_t   win32_u16_sortkey(const uint16_t* s, size_t n, uint8_t* key, size_t cap, int ignore_case);
+
+#endif /* LSW_WIN32_UNICODE_H */
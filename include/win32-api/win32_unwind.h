@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 unwinder - x64 UNWIND_INFO compiled into cached frame recipes
+ */
+
+#ifndef LSW_WIN32_UNWIND_H
+#define LSW_WIN32_UNWIND_H
+
+#include <stdint.h>
+#include "win32_ftab.h"
+
+/*
+ * A function's unwind codes (and those of the functions it chains to)
+ * are decoded once into a recipe: where each saved register lives
+ * relative to the stack or frame pointer, and where the return address
+ * is. Recipes are cached by function address; unwinding a frame past
+ * its prolog is then a handful of loads. Frames stopped inside a prolog
+ * and unusual codes (machine frames) go through the full interpreter.
+ */
+
+/* Integer registers in x64 encoding order, then RIP: the layout of
+ * CONTEXT from Rax (+0x78) to Rip (+0xF8) */
+typedef struct {
+    uint64_t gpr[16];
+    uint64_t rip;
+} win32_unwind_regs_t;
+
+#define WIN32_REG_RSP  4
+#define WIN32_REG_RBP  5
+
+/*
+ * Unwind one frame of the function `rf` (RVAs relative to image_base)
+ * stopped at regs->rip: restores the nonvolatile registers it saved
+ * and moves regs to its caller. `xmm` (16 x 16 bytes, as in CONTEXT)
+ * and `ptrs` (KNONVOLATILE_CONTEXT_POINTERS: 16 XMM then 16 integer
+ * slots) are optional. *entry_rsp receives the address of the return
+ * address. Returns 0 or an errno value (EFAULT: implausible stack).
+ */
+int win32_unwind_step(uint64_t image_base, const win32_runtime_function_t* rf,
+                      win32_unwind_regs_t* regs, void* xmm, void** ptrs, uint64_t* entry_rsp);
+
+/*
+ * Unwind with only RSP known, as the C++ exception walk does: frame
+ * registers are assumed to hold their prolog values. Returns the entry
+ * RSP (address of the return address), 0 on failure.
+ */
+uint64_t win32_unwind_rsp(uint64_t image_base, const win32_runtime_function_t* rf, uint64_t rsp,
+                          uint64_t* caller_rip, uint64_t* caller_rsp);
+
+/*
+ * Language handler of `rf` (0 if none); *flags receives its
+ * UNW_FLAG_EHANDLER/UHANDLER bits and *data the HandlerData pointer.
+ * Either pointer may be NULL.
+ */
+uint64_t win32_unwind_handler(uint64_t image_base, const win32_runtime_function_t* rf,
+                              uint32_t* flags, void** data);
+
+/*
+ * Walk the stack from `regs` (a frame of registered code), storing up
+ * to `max` return addresses after skipping `skip`. Stops at the first
+ * frame outside registered code. Returns the number stored.
+ */
+uint32_t win32_unwind_backtrace(win32_unwind_regs_t* regs, uint32_t skip, uint32_t max, void** out);
+
+/* Code was unregistered: forget every cached recipe */
+void win32_unwind_flush(void);
+
+#endif /* LSW_WIN32_UNWIND_H */
@@ -10,10 +10,16 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
+#include <linux/file.h>
+#include <linux/sched.h>
 #include <linux/uaccess.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_device.h"
 #include "../include/kernel-module/lsw_syscall.h"
+#include "../include/kernel-module/lsw_process.h"
+#include "../include/kernel-module/lsw_ring.h"
+#include "../include/kernel-module/lsw_handle.h"
+#include "../include/kernel-module/lsw_memory.h"
 
 /* Device data */
 static dev_t lsw_dev_number;
@@ -41,6 +47,8 @@ static int lsw_device_open(struct inode *inode, struct file *file)
  */
 static int lsw_device_release(struct inode *inode, struct file *file)
 {
+    lsw_ring_release(file);
+    lsw_process_untrap_file(file);
     lsw_debug("Device closed");
     return 0;
 }
@@ -105,6 +113,8 @@ static long lsw_unregister_pe(pid_t pid)
             pe_process_count--;
             mutex_unlock(&pe_list_mutex);
             
+            lsw_process_untrap_nt(pid);
+            
             lsw_info("Unregistered PE process: PID=%u", pid);
             return 0;
         }
@@ -116,6 +126,121 @@ static long lsw_unregister_pe(pid_t pid)
     return -ESRCH;
 }
 
+/**
+ * lsw_device_process_exited - Drop the registration of a process that exited
+ *
+ * Called from the process exit path for processes that never unregistered.
+ */
+void lsw_device_process_exited(pid_t pid)
+{
+    int i;
+    
+    mutex_lock(&pe_list_mutex);
+    
+    for (i = 0; i < LSW_MAX_PE_PROCESSES; i++) {
+        if (pe_processes[i].pid == pid) {
+            memset(&pe_processes[i], 0, sizeof(struct lsw_pe_info));
+            pe_process_count--;
+            lsw_info("Unregistered exited PE process: PID=%u", pid);
+            break;
+        }
+    }
+    
+    mutex_unlock(&pe_list_mutex);
+}
+
+/**
+ * lsw_device_pe_registered - Check for a registration without the lock
+ *
+ * For atomic context. A registration racing with the check is of a pid
+ * that is being set up or torn down, so the answer is as good as any.
+ */
+bool lsw_device_pe_registered(pid_t pid)
+{
+    int i;
+    
+    if (pid <= 0)
+        return false;
+    
+    for (i = 0; i < LSW_MAX_PE_PROCESSES; i++) {
+        if (READ_ONCE(pe_processes[i].pid) == pid)
+            return true;
+    }
+    
+    return false;
+}
+
+/**
+ * lsw_trap_nt_syscalls - Opt the calling process in to bare NT syscalls
+ *
+ * Registration does not do this: the probe takes syscall numbers as NT
+ * ones, so only a process that says where its NT code lives, about
+ * itself, gets it.
+ */
+static long lsw_trap_nt_syscalls(struct file *file, struct lsw_nt_trap __user *user_trap)
+{
+    struct lsw_nt_trap trap;
+    struct file *fd_file;
+    pid_t pid = current->tgid;
+    long ret;
+    
+    if (copy_from_user(&trap, user_trap, sizeof(trap)))
+        return -EFAULT;
+    
+    if (trap.reserved)
+        return -EINVAL;
+    
+    if (!trap.start && !trap.end) {
+        lsw_process_untrap_nt(pid);
+        lsw_info("PE process %u no longer traps NT syscalls", pid);
+        return 0;
+    }
+    
+    if (trap.start >= trap.end || trap.end > TASK_SIZE_MAX)
+        return -EINVAL;
+    
+    if (!lsw_device_pe_registered(pid)) {
+        lsw_warn("PID %u is not registered as PE, not trapping NT syscalls", pid);
+        return -EPERM;
+    }
+    
+    /* The probe turns trapped syscalls into ioctls on this descriptor */
+    fd_file = fget(trap.fd);
+    if (fd_file)
+        fput(fd_file);
+    if (fd_file != file)
+        return -EBADF;
+    
+    ret = lsw_process_trap_nt(pid, file, trap.fd, trap.start, trap.end);
+    if (ret)
+        return ret;
+    
+    lsw_info("PE process %u traps NT syscalls from 0x%llx-0x%llx",
+             pid, trap.start, trap.end);
+    return 0;
+}
+
+/**
+ * lsw_get_stats - Report live kernel state
+ */
+static long lsw_get_stats(struct lsw_stats __user *user_stats)
+{
+    struct lsw_stats stats;
+    
+    memset(&stats, 0, sizeof(stats));
+    
+    mutex_lock(&pe_list_mutex);
+    stats.pe_processes = pe_process_count;
+    mutex_unlock(&pe_list_mutex);
+    
+    lsw_handle_count(&stats.handle_tables, &stats.handles);
+    lsw_memory_get_info(0, &stats.memory_regions, NULL);
+    
+    if (copy_to_user(user_stats, &stats, sizeof(stats)))
+        return -EFAULT;
+    return 0;
+}
+
 /**
  * lsw_execute_pe - Execute a registered PE process  
  */
@@ -187,6 +312,12 @@ static long lsw_device_ioctl(struct file *file, unsigned int cmd, unsigned long
     case LSW_IOCTL_EXECUTE_PE:
         return lsw_execute_pe((pid_t)arg);
         
+    case LSW_IOCTL_GET_STATS:
+        return lsw_get_stats((struct lsw_stats __user *)arg);
+        
+    case LSW_IOCTL_TRAP_NT_SYSCALLS:
+        return lsw_trap_nt_syscalls(file, (struct lsw_nt_trap __user *)arg);
+        
     case LSW_IOCTL_SYSCALL:
         /* Copy syscall request from userspace */
         if (copy_from_user(&syscall_req, (void __user *)arg, sizeof(syscall_req)))
@@ -201,7 +332,17 @@ static long lsw_device_ioctl(struct file *file, unsigned int cmd, unsigned long
         
         return 0;
         
+    case LSW_IOCTL_RING_SETUP:
+        return lsw_ring_setup(file, (struct lsw_ring_params __user *)arg);
+        
+    case LSW_IOCTL_RING_ENTER:
+        return lsw_ring_enter(file, (__u32)arg);
+        
     default:
+        /* A bare NT syscall the probe redirected here */
+        if ((cmd & ~(_IOC_SIZEMASK << _IOC_SIZESHIFT)) == LSW_IOCTL_NT_TRAP(0))
+            return lsw_syscall_trapped(_IOC_SIZE(cmd));
+        
         lsw_warn("Unknown ioctl command: 0x%x", cmd);
         return -EINVAL;
     }
@@ -213,6 +354,7 @@ static struct file_operations lsw_fops = {
     .open = lsw_device_open,
     .release = lsw_device_release,
     .unlocked_ioctl = lsw_device_ioctl,
+    .mmap = lsw_ring_mmap,
 };
 
 /**
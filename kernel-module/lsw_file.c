@@ -11,17 +11,43 @@
 #include <linux/file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/uio.h>
+#include <linux/version.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_file.h"
-
-/* Global file handle list */
-static LIST_HEAD(lsw_file_list);
-static DEFINE_MUTEX(lsw_file_mutex);
-static __u64 next_handle = 0x1000;  /* Start handles at 0x1000 */
+#include "../include/kernel-module/lsw_handle.h"
 
 /* Statistics */
 static atomic_t lsw_open_files = ATOMIC_INIT(0);
 
+/**
+ * lsw_file_destroy - Last reference to a file object dropped
+ */
+static void lsw_file_destroy(struct lsw_object *obj)
+{
+    struct lsw_file_handle *fh = container_of(obj, struct lsw_file_handle, obj);
+    
+    /* Close Linux file */
+    if (fh->linux_file) {
+        filp_close(fh->linux_file, NULL);
+    }
+    
+    atomic_dec(&lsw_open_files);
+    kfree_rcu(fh, obj.rcu);
+}
+
+/**
+ * lsw_file_get - Look up a file handle of the calling process
+ *
+ * Returns the file with a reference held, or NULL.
+ */
+static struct lsw_file_handle *lsw_file_get(__u64 handle)
+{
+    struct lsw_object *obj = lsw_handle_get(current->tgid, handle, LSW_OBJECT_FILE);
+    
+    return obj ? container_of(obj, struct lsw_file_handle, obj) : NULL;
+}
+
 /**
  * lsw_file_open - Open or create a file
  */
@@ -80,14 +106,9 @@ __u64 lsw_file_open(__u32 pid, const char *path, __u32 access,
         return 0;
     }
     
-    /* Assign handle number */
-    mutex_lock(&lsw_file_mutex);
-    handle = next_handle++;
-    mutex_unlock(&lsw_file_mutex);
-    
     /* Fill in file handle */
-    fh->handle = handle;
-    fh->pid = pid;
+    lsw_object_init(&fh->obj, LSW_OBJECT_FILE, pid, lsw_file_destroy);
+    mutex_init(&fh->lock);
     fh->linux_file = linux_file;
     fh->position = 0;
     fh->access = access;
@@ -95,84 +116,171 @@ __u64 lsw_file_open(__u32 pid, const char *path, __u32 access,
     strncpy(fh->path, path, sizeof(fh->path) - 1);
     fh->path[sizeof(fh->path) - 1] = '\0';
     
-    /* Add to global list */
-    mutex_lock(&lsw_file_mutex);
-    list_add(&fh->list, &lsw_file_list);
-    mutex_unlock(&lsw_file_mutex);
-    
     atomic_inc(&lsw_open_files);
     
+    /* Add to the process's handle table */
+    handle = lsw_handle_insert(&fh->obj);
+    if (!handle) {
+        lsw_object_put(&fh->obj);
+        return 0;
+    }
+    fh->handle = handle;
+    
     lsw_info("Opened file: PID=%u, handle=0x%llx, path='%s', flags=0x%x",
              pid, handle, path, flags);
     
     return handle;
 }
 
+/*
+ * Move up to `size` bytes between the file and a user buffer at *pos.
+ * Goes straight through the filesystem's read_iter/write_iter on the
+ * user pages; files without them (some special files) fall back to a
+ * page-sized bounce buffer.
+ */
+static ssize_t lsw_file_rw_user(struct file *file, void __user *buffer, size_t size,
+                                loff_t *pos, bool write)
+{
+    struct iov_iter iter;
+    ssize_t ret = 0;
+    size_t done = 0;
+    char *bounce;
+    
+    if (write ? file->f_op->write_iter : file->f_op->read_iter) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,4,0)
+        ret = import_ubuf(write ? ITER_SOURCE : ITER_DEST, buffer, size, &iter);
+#else
+        struct iovec iov;
+        
+        ret = import_single_range(write ? WRITE : READ, buffer, size, &iov, &iter);
+#endif
+        if (ret) {
+            return ret;
+        }
+        
+        if (!write) {
+            return vfs_iter_read(file, &iter, pos, 0);
+        }
+        
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,8,0)
+        return vfs_iter_write(file, &iter, pos, 0);
+#else
+        file_start_write(file);
+        ret = vfs_iter_write(file, &iter, pos, 0);
+        file_end_write(file);
+        return ret;
+#endif
+    }
+    
+    bounce = kmalloc(PAGE_SIZE, GFP_KERNEL);
+    if (!bounce) {
+        return -ENOMEM;
+    }
+    
+    while (done < size) {
+        size_t chunk = min_t(size_t, size - done, PAGE_SIZE);
+        
+        if (write) {
+            if (copy_from_user(bounce, buffer + done, chunk)) {
+                ret = -EFAULT;
+                break;
+            }
+            ret = kernel_write(file, bounce, chunk, pos);
+        } else {
+            ret = kernel_read(file, bounce, chunk, pos);
+            if (ret > 0 && copy_to_user(buffer + done, bounce, ret)) {
+                ret = -EFAULT;
+            }
+        }
+        if (ret <= 0) {
+            break;
+        }
+        done += ret;
+        if ((size_t)ret < chunk) {
+            break;
+        }
+    }
+    
+    kfree(bounce);
+    
+    /* A short transfer succeeds with what got through */
+    return done ? (ssize_t)done : ret;
+}
+
+/*
+ * Start position of an I/O: an explicit ByteOffset, the end of the file
+ * for LSW_FILE_WRITE_TO_END_OF_FILE, otherwise the file pointer.
+ * Called with fh->lock held.
+ */
+static loff_t lsw_file_io_start(struct lsw_file_handle *fh, __s64 offset)
+{
+    if (offset >= 0) {
+        return offset;
+    }
+    if (offset == LSW_FILE_WRITE_TO_END_OF_FILE) {
+        return i_size_read(file_inode(fh->linux_file));
+    }
+    return fh->position;
+}
+
 /**
- * lsw_file_read - Read from a file
+ * lsw_file_read - Read from a file into a user buffer
  */
-int lsw_file_read(__u64 handle, void *buffer, __u64 size, __u64 *bytes_read)
+int lsw_file_read(__u64 handle, void __user *buffer, __u64 size, __s64 offset,
+                  __u64 *bytes_read)
 {
     struct lsw_file_handle *fh;
     loff_t pos;
     ssize_t ret;
-    int found = 0;
     
     if (!buffer || size == 0) {
         return -EINVAL;
     }
     
-    mutex_lock(&lsw_file_mutex);
-    
     /* Find file handle */
-    list_for_each_entry(fh, &lsw_file_list, list) {
-        if (fh->handle == handle) {
-            found = 1;
-            pos = fh->position;
-            
-            /* Read from file */
-            ret = kernel_read(fh->linux_file, buffer, size, &pos);
-            
-            if (ret < 0) {
-                lsw_err("Read failed for handle 0x%llx: %ld", handle, ret);
-                mutex_unlock(&lsw_file_mutex);
-                return (int)ret;
-            }
-            
-            /* Update position */
-            fh->position = pos;
-            
-            if (bytes_read) {
-                *bytes_read = ret;
-            }
-            
-            lsw_debug("Read %ld bytes from handle 0x%llx (pos=%lld)",
-                     ret, handle, fh->position);
-            
-            mutex_unlock(&lsw_file_mutex);
-            return 0;
-        }
+    fh = lsw_file_get(handle);
+    if (!fh) {
+        lsw_warn("File handle not found: 0x%llx", handle);
+        return -EBADF;
     }
     
-    mutex_unlock(&lsw_file_mutex);
+    mutex_lock(&fh->lock);
+    pos = lsw_file_io_start(fh, offset);
     
-    if (!found) {
-        lsw_warn("File handle not found: 0x%llx", handle);
-        return -EBADF;
+    /* Read from file */
+    ret = lsw_file_rw_user(fh->linux_file, buffer, size, &pos, false);
+    
+    /* Synchronous I/O leaves the file pointer after the data */
+    if (ret >= 0) {
+        fh->position = pos;
     }
     
+    mutex_unlock(&fh->lock);
+    lsw_object_put(&fh->obj);
+    
+    if (ret < 0) {
+        lsw_err("Read failed for handle 0x%llx: %ld", handle, ret);
+        return (int)ret;
+    }
+    
+    if (bytes_read) {
+        *bytes_read = ret;
+    }
+    
+    lsw_trace("Read %ld bytes from handle 0x%llx (pos=%lld)", ret, handle, pos);
+    
     return 0;
 }
 
 /**
- * lsw_file_write - Write to a file
+ * lsw_file_write - Write a user buffer to a file
  */
-int lsw_file_write(__u64 handle, const void *buffer, __u64 size, __u64 *bytes_written)
+int lsw_file_write(__u64 handle, const void __user *buffer, __u64 size, __s64 offset,
+                   __u64 *bytes_written)
 {
     struct lsw_file_handle *fh;
     loff_t pos;
     ssize_t ret;
-    int found = 0;
     
     if (!buffer || size == 0) {
         return -EINVAL;
@@ -186,7 +294,9 @@ int lsw_file_write(__u64 handle, const void *buffer, __u64 size, __u64 *bytes_wr
         // This is a Windows pseudo-handle, write to kernel log
         char log_buffer[512];
         size_t log_size = size > sizeof(log_buffer) - 1 ? sizeof(log_buffer) - 1 : size;
-        memcpy(log_buffer, buffer, log_size);
+        if (copy_from_user(log_buffer, buffer, log_size)) {
+            return -EFAULT;
+        }
         log_buffer[log_size] = '\0';
         
         lsw_info("WIN32 STDOUT: %s", log_buffer);
@@ -197,45 +307,38 @@ int lsw_file_write(__u64 handle, const void *buffer, __u64 size, __u64 *bytes_wr
         return 0;
     }
     
-    mutex_lock(&lsw_file_mutex);
-    
     /* Find file handle */
-    list_for_each_entry(fh, &lsw_file_list, list) {
-        if (fh->handle == handle) {
-            found = 1;
-            pos = fh->position;
-            
-            /* Write to file */
-            ret = kernel_write(fh->linux_file, buffer, size, &pos);
-            
-            if (ret < 0) {
-                lsw_err("Write failed for handle 0x%llx: %ld", handle, ret);
-                mutex_unlock(&lsw_file_mutex);
-                return (int)ret;
-            }
-            
-            /* Update position */
-            fh->position = pos;
-            
-            if (bytes_written) {
-                *bytes_written = ret;
-            }
-            
-            lsw_debug("Wrote %ld bytes to handle 0x%llx (pos=%lld)",
-                     ret, handle, fh->position);
-            
-            mutex_unlock(&lsw_file_mutex);
-            return 0;
-        }
+    fh = lsw_file_get(handle);
+    if (!fh) {
+        lsw_warn("File handle not found: 0x%llx", handle);
+        return -EBADF;
     }
     
-    mutex_unlock(&lsw_file_mutex);
+    mutex_lock(&fh->lock);
+    pos = lsw_file_io_start(fh, offset);
     
-    if (!found) {
-        lsw_warn("File handle not found: 0x%llx", handle);
-        return -EBADF;
+    /* Write to file */
+    ret = lsw_file_rw_user(fh->linux_file, (void __user *)buffer, size, &pos, true);
+    
+    /* Synchronous I/O leaves the file pointer after the data */
+    if (ret >= 0) {
+        fh->position = pos;
     }
     
+    mutex_unlock(&fh->lock);
+    lsw_object_put(&fh->obj);
+    
+    if (ret < 0) {
+        lsw_err("Write failed for handle 0x%llx: %ld", handle, ret);
+        return (int)ret;
+    }
+    
+    if (bytes_written) {
+        *bytes_written = ret;
+    }
+    
+    lsw_trace("Wrote %ld bytes to handle 0x%llx (pos=%lld)", ret, handle, pos);
+    
     return 0;
 }
 
@@ -244,40 +347,14 @@ int lsw_file_write(__u64 handle, const void *buffer, __u64 size, __u64 *bytes_wr
  */
 int lsw_file_close(__u64 handle)
 {
-    struct lsw_file_handle *fh, *tmp;
-    int found = 0;
-    
-    mutex_lock(&lsw_file_mutex);
-    
-    list_for_each_entry_safe(fh, tmp, &lsw_file_list, list) {
-        if (fh->handle == handle) {
-            found = 1;
-            
-            lsw_info("Closing file: handle=0x%llx, path='%s'",
-                     handle, fh->path);
-            
-            /* Close Linux file */
-            if (fh->linux_file) {
-                filp_close(fh->linux_file, NULL);
-            }
-            
-            atomic_dec(&lsw_open_files);
-            
-            /* Remove from list */
-            list_del(&fh->list);
-            kfree(fh);
-            
-            break;
-        }
-    }
-    
-    mutex_unlock(&lsw_file_mutex);
-    
-    if (!found) {
+    /* The file itself closes with its last reference */
+    if (lsw_handle_close(current->tgid, handle, LSW_OBJECT_FILE) != 0) {
         lsw_warn("File handle not found: 0x%llx", handle);
         return -EBADF;
     }
     
+    lsw_trace("Closed file: handle=0x%llx", handle);
+    
     return 0;
 }
 
@@ -286,29 +363,7 @@ int lsw_file_close(__u64 handle)
  */
 void lsw_file_cleanup_process(__u32 pid)
 {
-    struct lsw_file_handle *fh, *tmp;
-    int closed_count = 0;
-    
-    mutex_lock(&lsw_file_mutex);
-    
-    list_for_each_entry_safe(fh, tmp, &lsw_file_list, list) {
-        if (fh->pid == pid) {
-            lsw_debug("Cleaning up file: handle=0x%llx, path='%s'",
-                     fh->handle, fh->path);
-            
-            if (fh->linux_file) {
-                filp_close(fh->linux_file, NULL);
-            }
-            
-            atomic_dec(&lsw_open_files);
-            closed_count++;
-            
-            list_del(&fh->list);
-            kfree(fh);
-        }
-    }
-    
-    mutex_unlock(&lsw_file_mutex);
+    int closed_count = lsw_handle_close_process(pid, LSW_OBJECT_FILE);
     
     if (closed_count > 0) {
         lsw_info("Cleaned up %d file handles for PID %u", closed_count, pid);
@@ -330,27 +385,8 @@ int lsw_file_init(void)
  */
 void lsw_file_exit(void)
 {
-    struct lsw_file_handle *fh, *tmp;
-    int leaked_count = 0;
-    
-    mutex_lock(&lsw_file_mutex);
-    
     /* Close any remaining files */
-    list_for_each_entry_safe(fh, tmp, &lsw_file_list, list) {
-        lsw_warn("File handle leak: PID=%u, handle=0x%llx, path='%s'",
-                 fh->pid, fh->handle, fh->path);
-        
-        if (fh->linux_file) {
-            filp_close(fh->linux_file, NULL);
-        }
-        
-        leaked_count++;
-        
-        list_del(&fh->list);
-        kfree(fh);
-    }
-    
-    mutex_unlock(&lsw_file_mutex);
+    int leaked_count = lsw_handle_close_all(LSW_OBJECT_FILE);
     
     if (leaked_count > 0) {
         lsw_warn("Closed %d leaked file handles during cleanup", leaked_count);
@@ -367,42 +403,29 @@ int lsw_file_get_size(__u64 handle, __u64 *size_out)
     struct lsw_file_handle *fh;
     struct kstat stat;
     int ret;
-    int found = 0;
     
     if (!size_out) {
         return -EINVAL;
     }
     
-    mutex_lock(&lsw_file_mutex);
-    
     /* Find file handle */
-    list_for_each_entry(fh, &lsw_file_list, list) {
-        if (fh->handle == handle) {
-            found = 1;
-            
-            /* Get file stats */
-            ret = vfs_getattr(&fh->linux_file->f_path, &stat, STATX_SIZE, AT_STATX_SYNC_AS_STAT);
-            if (ret != 0) {
-                lsw_err("vfs_getattr failed for handle 0x%llx: %d", handle, ret);
-                mutex_unlock(&lsw_file_mutex);
-                return ret;
-            }
-            
-            *size_out = stat.size;
-            lsw_info("File handle 0x%llx size: %llu bytes", handle, stat.size);
-            
-            mutex_unlock(&lsw_file_mutex);
-            return 0;
-        }
-    }
-    
-    mutex_unlock(&lsw_file_mutex);
-    
-    if (!found) {
+    fh = lsw_file_get(handle);
+    if (!fh) {
         lsw_err("Invalid file handle: 0x%llx", handle);
         return -EBADF;
     }
     
+    /* Get file stats */
+    ret = vfs_getattr(&fh->linux_file->f_path, &stat, STATX_SIZE, AT_STATX_SYNC_AS_STAT);
+    lsw_object_put(&fh->obj);
+    if (ret != 0) {
+        lsw_err("vfs_getattr failed for handle 0x%llx: %d", handle, ret);
+        return ret;
+    }
+    
+    *size_out = stat.size;
+    lsw_trace("File handle 0x%llx size: %llu bytes", handle, stat.size);
+    
     return 0;
 }
 
@@ -414,7 +437,6 @@ int lsw_file_seek(__u64 handle, __s64 offset, __u32 whence, __u64 *new_pos_out)
     struct lsw_file_handle *fh;
     loff_t new_pos;
     int linux_whence;
-    int found = 0;
     
     /* Map Windows to Linux whence */
     switch (whence) {
@@ -426,41 +448,36 @@ int lsw_file_seek(__u64 handle, __s64 offset, __u32 whence, __u64 *new_pos_out)
             return -EINVAL;
     }
     
-    mutex_lock(&lsw_file_mutex);
-    
     /* Find file handle */
-    list_for_each_entry(fh, &lsw_file_list, list) {
-        if (fh->handle == handle) {
-            found = 1;
-            
-            /* Seek */
-            new_pos = vfs_llseek(fh->linux_file, offset, linux_whence);
-            if (new_pos < 0) {
-                lsw_err("vfs_llseek failed for handle 0x%llx: %lld", handle, new_pos);
-                mutex_unlock(&lsw_file_mutex);
-                return (int)new_pos;
-            }
-            
-            /* Update our tracked position */
-            fh->position = new_pos;
-            
-            if (new_pos_out) {
-                *new_pos_out = (__u64)new_pos;
-            }
-            
-            lsw_info("File handle 0x%llx seeked to: %lld", handle, new_pos);
-            
-            mutex_unlock(&lsw_file_mutex);
-            return 0;
-        }
+    fh = lsw_file_get(handle);
+    if (!fh) {
+        lsw_err("Invalid file handle: 0x%llx", handle);
+        return -EBADF;
     }
     
-    mutex_unlock(&lsw_file_mutex);
+    mutex_lock(&fh->lock);
     
-    if (!found) {
-        lsw_err("Invalid file handle: 0x%llx", handle);
-        return -EBADF;
+    /* Seek */
+    new_pos = vfs_llseek(fh->linux_file, offset, linux_whence);
+    
+    /* Update our tracked position */
+    if (new_pos >= 0) {
+        fh->position = new_pos;
+    }
+    
+    mutex_unlock(&fh->lock);
+    lsw_object_put(&fh->obj);
+    
+    if (new_pos < 0) {
+        lsw_err("vfs_llseek failed for handle 0x%llx: %lld", handle, new_pos);
+        return (int)new_pos;
+    }
+    
+    if (new_pos_out) {
+        *new_pos_out = (__u64)new_pos;
     }
     
+    lsw_trace("File handle 0x%llx seeked to: %lld", handle, new_pos);
+    
     return 0;
 }
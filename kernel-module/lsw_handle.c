@@ -0,0 +1,272 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Kernel Module
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Per-process Win32 Handle Table Implementation
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/xarray.h>
+#include <linux/mutex.h>
+#include "../include/kernel-module/lsw_kernel.h"
+#include "../include/kernel-module/lsw_handle.h"
+
+/* One process's handles: index (handle >> 2) -> struct lsw_object */
+struct lsw_handle_table {
+    __u32 pid;
+    struct xarray handles;
+    struct rcu_head rcu;
+};
+
+/*
+ * Tables by pid. Readers only use RCU; the mutex serializes creating a
+ * table (on a process's first handle) against tearing one down, so a
+ * handle is never inserted into a table that is being freed.
+ */
+static DEFINE_XARRAY(lsw_handle_tables);
+static DEFINE_MUTEX(lsw_handle_tables_mutex);
+
+/* Statistics */
+static atomic_t lsw_live_tables = ATOMIC_INIT(0);
+static atomic_t lsw_live_handles = ATOMIC_INIT(0);
+
+static void lsw_object_release(struct kref *ref)
+{
+    struct lsw_object *obj = container_of(ref, struct lsw_object, ref);
+
+    obj->destroy(obj);
+}
+
+/**
+ * lsw_object_init - Initialize an object with one reference
+ */
+void lsw_object_init(struct lsw_object *obj, __u32 type, __u32 pid,
+                     void (*destroy)(struct lsw_object *obj))
+{
+    kref_init(&obj->ref);
+    obj->type = type;
+    obj->pid = pid;
+    obj->destroy = destroy;
+}
+
+/**
+ * lsw_object_put - Drop a reference
+ */
+void lsw_object_put(struct lsw_object *obj)
+{
+    kref_put(&obj->ref, lsw_object_release);
+}
+
+/* Table index of a handle value, 0 if it cannot be one */
+static inline unsigned long lsw_handle_index(__u64 handle)
+{
+    if ((handle & 3) || handle > ((__u64)LSW_HANDLE_INDEX_MAX << 2))
+        return 0;
+    return (unsigned long)(handle >> 2);
+}
+
+/**
+ * lsw_handle_insert - Give an object a handle in its owner's table
+ */
+__u64 lsw_handle_insert(struct lsw_object *obj)
+{
+    struct lsw_handle_table *table;
+    u32 index = 0;
+    int ret;
+
+    mutex_lock(&lsw_handle_tables_mutex);
+
+    table = xa_load(&lsw_handle_tables, obj->pid);
+    if (!table) {
+        table = kzalloc(sizeof(*table), GFP_KERNEL);
+        if (!table) {
+            ret = -ENOMEM;
+            goto out;
+        }
+        table->pid = obj->pid;
+        xa_init_flags(&table->handles, XA_FLAGS_ALLOC1);
+
+        ret = xa_err(xa_store(&lsw_handle_tables, obj->pid, table, GFP_KERNEL));
+        if (ret) {
+            kfree(table);
+            goto out;
+        }
+        atomic_inc(&lsw_live_tables);
+    }
+
+    /* Lowest free index: closed handle values come back, as on Windows */
+    ret = xa_alloc(&table->handles, &index, obj,
+                   XA_LIMIT(1, LSW_HANDLE_INDEX_MAX), GFP_KERNEL);
+    if (!ret)
+        atomic_inc(&lsw_live_handles);
+
+out:
+    mutex_unlock(&lsw_handle_tables_mutex);
+
+    if (ret) {
+        lsw_err("Failed to allocate handle for PID %u: %d", obj->pid, ret);
+        return 0;
+    }
+
+    return (__u64)index << 2;
+}
+
+/**
+ * lsw_handle_get - Look up a handle
+ */
+struct lsw_object *lsw_handle_get(__u32 pid, __u64 handle, __u32 type)
+{
+    struct lsw_handle_table *table;
+    struct lsw_object *obj = NULL;
+    unsigned long index = lsw_handle_index(handle);
+
+    if (!index) {
+        return NULL;
+    }
+
+    rcu_read_lock();
+    table = xa_load(&lsw_handle_tables, pid);
+    if (table) {
+        obj = xa_load(&table->handles, index);
+    }
+    /* A zero refcount means the object is on its way out */
+    if (obj && ((type != LSW_OBJECT_ANY && obj->type != type) ||
+                !kref_get_unless_zero(&obj->ref))) {
+        obj = NULL;
+    }
+    rcu_read_unlock();
+
+    return obj;
+}
+
+/* Unlink a handle's entry if it is of `type`; returns the handle's reference */
+static struct lsw_object *lsw_handle_remove(struct lsw_handle_table *table,
+                                            unsigned long index, __u32 type)
+{
+    struct lsw_object *obj;
+
+    xa_lock(&table->handles);
+    obj = xa_load(&table->handles, index);
+    if (obj && (type == LSW_OBJECT_ANY || obj->type == type)) {
+        __xa_erase(&table->handles, index);
+        atomic_dec(&lsw_live_handles);
+    } else {
+        obj = NULL;
+    }
+    xa_unlock(&table->handles);
+
+    return obj;
+}
+
+/**
+ * lsw_handle_close - Close a handle
+ */
+int lsw_handle_close(__u32 pid, __u64 handle, __u32 type)
+{
+    struct lsw_handle_table *table;
+    struct lsw_object *obj = NULL;
+    unsigned long index = lsw_handle_index(handle);
+
+    if (!index) {
+        return -EBADF;
+    }
+
+    rcu_read_lock();
+    table = xa_load(&lsw_handle_tables, pid);
+    if (table) {
+        obj = lsw_handle_remove(table, index, type);
+    }
+    rcu_read_unlock();
+
+    if (!obj) {
+        return -EBADF;
+    }
+
+    /* The handle's reference; destroy may sleep, so outside RCU */
+    lsw_object_put(obj);
+    return 0;
+}
+
+/* Called with lsw_handle_tables_mutex held */
+static int lsw_handle_table_close(struct lsw_handle_table *table, __u32 type)
+{
+    struct lsw_object *entry, *obj;
+    unsigned long index;
+    int closed = 0;
+
+    xa_for_each(&table->handles, index, entry) {
+        /* NULL if a concurrent lsw_handle_close won */
+        obj = lsw_handle_remove(table, index, type);
+        if (obj) {
+            lsw_object_put(obj);
+            closed++;
+        }
+    }
+
+    /* Drop the table with its last handle */
+    if (xa_empty(&table->handles)) {
+        xa_erase(&lsw_handle_tables, table->pid);
+        xa_destroy(&table->handles);
+        kfree_rcu(table, rcu);
+        atomic_dec(&lsw_live_tables);
+    }
+
+    return closed;
+}
+
+/**
+ * lsw_handle_close_process - Close a process's handles of one type
+ */
+int lsw_handle_close_process(__u32 pid, __u32 type)
+{
+    struct lsw_handle_table *table;
+    int closed = 0;
+
+    mutex_lock(&lsw_handle_tables_mutex);
+    table = xa_load(&lsw_handle_tables, pid);
+    if (table) {
+        closed = lsw_handle_table_close(table, type);
+    }
+    mutex_unlock(&lsw_handle_tables_mutex);
+
+    return closed;
+}
+
+/**
+ * lsw_handle_has_table - Whether a process has a handle table
+ */
+bool lsw_handle_has_table(__u32 pid)
+{
+    return xa_load(&lsw_handle_tables, pid) != NULL;
+}
+
+/**
+ * lsw_handle_count - Live handle tables and handles over all processes
+ */
+void lsw_handle_count(__u32 *tables, __u32 *handles)
+{
+    if (tables)
+        *tables = atomic_read(&lsw_live_tables);
+    if (handles)
+        *handles = atomic_read(&lsw_live_handles);
+}
+
+/**
+ * lsw_handle_close_all - Close every process's handles of one type
+ */
+int lsw_handle_close_all(__u32 type)
+{
+    struct lsw_handle_table *table;
+    unsigned long pid;
+    int closed = 0;
+
+    mutex_lock(&lsw_handle_tables_mutex);
+    xa_for_each(&lsw_handle_tables, pid, table) {
+        closed += lsw_handle_table_close(table, type);
+    }
+    mutex_unlock(&lsw_handle_tables_mutex);
+
+    return closed;
+}
@@ -10,17 +10,80 @@
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include <linux/mm.h>
+#include <linux/xarray.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_memory.h"
 
-/* Global memory allocation list */
-static LIST_HEAD(lsw_memory_list);
-static DEFINE_MUTEX(lsw_memory_mutex);
+/*
+ * Regions of one process, indexed by base address. Lookups are RCU-only;
+ * lsw_memory_spaces_mutex serializes creating a process's space against
+ * tearing it down.
+ */
+struct lsw_address_space {
+    __u32 pid;
+    struct xarray regions;
+    struct rcu_head rcu;
+};
+
+static DEFINE_XARRAY(lsw_memory_spaces);
+static DEFINE_MUTEX(lsw_memory_spaces_mutex);
 
 /* Statistics */
 static atomic_t lsw_allocation_count = ATOMIC_INIT(0);
 static atomic64_t lsw_total_allocated = ATOMIC64_INIT(0);
 
+/**
+ * lsw_memory_destroy - Last reference to a region dropped
+ */
+static void lsw_memory_destroy(struct lsw_object *obj)
+{
+    struct lsw_memory_region *region = container_of(obj, struct lsw_memory_region, obj);
+    
+    /* Free kernel memory */
+    if (region->kernel_addr) {
+        vfree(region->kernel_addr);
+    }
+    
+    /* Update statistics */
+    atomic_dec(&lsw_allocation_count);
+    atomic64_sub(region->size, &lsw_total_allocated);
+    
+    kfree_rcu(region, obj.rcu);
+}
+
+/**
+ * lsw_memory_find - Region of `pid` containing `addr`, with a reference
+ *
+ * @exact: Only a region starting at `addr`
+ */
+static struct lsw_memory_region *lsw_memory_find(__u32 pid, __u64 addr, bool exact)
+{
+    struct lsw_address_space *space;
+    struct lsw_memory_region *region = NULL;
+    unsigned long index;
+    
+    rcu_read_lock();
+    space = xa_load(&lsw_memory_spaces, pid);
+    if (space) {
+        region = xa_load(&space->regions, (unsigned long)addr);
+        
+        /* An address inside a region: walk this process's regions only */
+        if (!region && !exact) {
+            xa_for_each(&space->regions, index, region) {
+                if (addr >= region->base_address &&
+                    addr < region->base_address + region->size)
+                    break;
+            }
+        }
+    }
+    if (region && !kref_get_unless_zero(&region->obj.ref)) {
+        region = NULL;
+    }
+    rcu_read_unlock();
+    
+    return region;
+}
+
 /**
  * lsw_memory_allocate - Allocate virtual memory for PE process
  */
@@ -28,8 +91,10 @@ __u64 lsw_memory_allocate(__u32 pid, __u64 base, __u64 size,
                           __u32 protect, __u32 flags)
 {
     struct lsw_memory_region *region;
+    struct lsw_address_space *space;
     void *kernel_addr;
     __u64 allocated_base;
+    int ret = 0;
     
     /* Validate size */
     if (size == 0 || size > (1ULL << 32)) {  /* Max 4GB allocation */
@@ -59,22 +124,45 @@ __u64 lsw_memory_allocate(__u32 pid, __u64 base, __u64 size,
     allocated_base = base ? base : (__u64)(unsigned long)kernel_addr;
     
     /* Fill in region info */
+    lsw_object_init(&region->obj, LSW_OBJECT_MEMORY, pid, lsw_memory_destroy);
     region->base_address = allocated_base;
     region->size = size;
-    region->pid = pid;
     region->kernel_addr = kernel_addr;
     region->protect = protect;
     region->flags = flags;
     
-    /* Add to global list */
-    mutex_lock(&lsw_memory_mutex);
-    list_add(&region->list, &lsw_memory_list);
-    mutex_unlock(&lsw_memory_mutex);
-    
     /* Update statistics */
     atomic_inc(&lsw_allocation_count);
     atomic64_add(size, &lsw_total_allocated);
     
+    /* Add to the process's address space */
+    mutex_lock(&lsw_memory_spaces_mutex);
+    space = xa_load(&lsw_memory_spaces, pid);
+    if (!space) {
+        space = kzalloc(sizeof(*space), GFP_KERNEL);
+        if (space) {
+            space->pid = pid;
+            xa_init(&space->regions);
+            ret = xa_err(xa_store(&lsw_memory_spaces, pid, space, GFP_KERNEL));
+            if (ret) {
+                kfree(space);
+            }
+        } else {
+            ret = -ENOMEM;
+        }
+    }
+    if (!ret) {
+        /* -EBUSY: a region already starts there */
+        ret = xa_insert(&space->regions, (unsigned long)allocated_base, region, GFP_KERNEL);
+    }
+    mutex_unlock(&lsw_memory_spaces_mutex);
+    
+    if (ret) {
+        lsw_err("Failed to track region at 0x%llx: %d", allocated_base, ret);
+        lsw_object_put(&region->obj);
+        return 0;
+    }
+    
     lsw_info("Allocated memory: PID=%u, base=0x%llx, size=0x%llx (%llu KB), kernel=%p",
              pid, allocated_base, size, size / 1024, kernel_addr);
     
@@ -86,81 +174,81 @@ __u64 lsw_memory_allocate(__u32 pid, __u64 base, __u64 size,
  */
 int lsw_memory_free(__u32 pid, __u64 base, __u64 size, __u32 free_type)
 {
-    struct lsw_memory_region *region, *tmp;
-    int found = 0;
-    
-    mutex_lock(&lsw_memory_mutex);
-    
-    list_for_each_entry_safe(region, tmp, &lsw_memory_list, list) {
-        /* Match by PID and base address */
-        if (region->pid == pid && region->base_address == base) {
-            found = 1;
-            
-            lsw_info("Freeing memory: PID=%u, base=0x%llx, size=0x%llx, type=0x%x",
-                     pid, base, region->size, free_type);
-            
-            /* Free kernel memory */
-            if (region->kernel_addr) {
-                vfree(region->kernel_addr);
-            }
-            
-            /* Update statistics */
-            atomic_dec(&lsw_allocation_count);
-            atomic64_sub(region->size, &lsw_total_allocated);
-            
-            /* Remove from list */
-            list_del(&region->list);
-            kfree(region);
-            
-            break;
-        }
+    struct lsw_address_space *space;
+    struct lsw_memory_region *region = NULL;
+    
+    /* Match by PID and base address */
+    rcu_read_lock();
+    space = xa_load(&lsw_memory_spaces, pid);
+    if (space) {
+        region = xa_erase(&space->regions, (unsigned long)base);
     }
+    rcu_read_unlock();
     
-    mutex_unlock(&lsw_memory_mutex);
-    
-    if (!found) {
+    if (!region) {
         lsw_warn("Memory region not found: PID=%u, base=0x%llx", pid, base);
         return -EINVAL;
     }
     
+    lsw_trace("Freeing memory: PID=%u, base=0x%llx, size=0x%llx, type=0x%x",
+              pid, base, region->size, free_type);
+    
+    /* The kernel memory goes with the last reader */
+    lsw_object_put(&region->obj);
+    
     return 0;
 }
 
+/* Called with lsw_memory_spaces_mutex held; frees the space */
+static int lsw_memory_space_release(struct lsw_address_space *space, __u64 *freed_size,
+                                    bool report)
+{
+    struct lsw_memory_region *region;
+    unsigned long index;
+    int freed_count = 0;
+    
+    xa_erase(&lsw_memory_spaces, space->pid);
+    
+    xa_for_each(&space->regions, index, region) {
+        /* NULL if a concurrent lsw_memory_free won */
+        if (xa_erase(&space->regions, index) != region) {
+            continue;
+        }
+        
+        if (report) {
+            lsw_warn("Memory leak: PID=%u, base=0x%llx, size=0x%llx",
+                     space->pid, region->base_address, region->size);
+        } else {
+            lsw_debug("Cleaning up memory: base=0x%llx, size=0x%llx",
+                      region->base_address, region->size);
+        }
+        
+        *freed_size += region->size;
+        freed_count++;
+        lsw_object_put(&region->obj);
+    }
+    
+    xa_destroy(&space->regions);
+    kfree_rcu(space, rcu);
+    
+    return freed_count;
+}
+
 /**
  * lsw_memory_cleanup_process - Free all memory for a process
  */
 void lsw_memory_cleanup_process(__u32 pid)
 {
-    struct lsw_memory_region *region, *tmp;
+    struct lsw_address_space *space;
     int freed_count = 0;
     __u64 freed_size = 0;
     
-    mutex_lock(&lsw_memory_mutex);
-    
-    list_for_each_entry_safe(region, tmp, &lsw_memory_list, list) {
-        if (region->pid == pid) {
-            lsw_debug("Cleaning up memory: base=0x%llx, size=0x%llx",
-                     region->base_address, region->size);
-            
-            /* Free kernel memory */
-            if (region->kernel_addr) {
-                vfree(region->kernel_addr);
-            }
-            
-            freed_size += region->size;
-            freed_count++;
-            
-            /* Update statistics */
-            atomic_dec(&lsw_allocation_count);
-            atomic64_sub(region->size, &lsw_total_allocated);
-            
-            /* Remove from list */
-            list_del(&region->list);
-            kfree(region);
-        }
+    mutex_lock(&lsw_memory_spaces_mutex);
+    space = xa_load(&lsw_memory_spaces, pid);
+    if (space) {
+        freed_count = lsw_memory_space_release(space, &freed_size, false);
     }
-    
-    mutex_unlock(&lsw_memory_mutex);
+    mutex_unlock(&lsw_memory_spaces_mutex);
     
     if (freed_count > 0) {
         lsw_info("Cleaned up %d allocations (%llu KB) for PID %u",
@@ -168,33 +256,42 @@ void lsw_memory_cleanup_process(__u32 pid)
     }
 }
 
+/**
+ * lsw_memory_has_space - Whether a process has memory allocated
+ */
+bool lsw_memory_has_space(__u32 pid)
+{
+    return xa_load(&lsw_memory_spaces, pid) != NULL;
+}
+
 /**
  * lsw_memory_get_info - Get memory allocation info
  */
 void lsw_memory_get_info(__u32 pid, __u32 *count, __u64 *total_size)
 {
+    struct lsw_address_space *space;
     struct lsw_memory_region *region;
+    unsigned long index;
     __u32 alloc_count = 0;
     __u64 alloc_size = 0;
     
-    mutex_lock(&lsw_memory_mutex);
-    
     if (pid == 0) {
         /* Global statistics */
         alloc_count = atomic_read(&lsw_allocation_count);
         alloc_size = atomic64_read(&lsw_total_allocated);
     } else {
         /* Per-process statistics */
-        list_for_each_entry(region, &lsw_memory_list, list) {
-            if (region->pid == pid) {
+        rcu_read_lock();
+        space = xa_load(&lsw_memory_spaces, pid);
+        if (space) {
+            xa_for_each(&space->regions, index, region) {
                 alloc_count++;
                 alloc_size += region->size;
             }
         }
+        rcu_read_unlock();
     }
     
-    mutex_unlock(&lsw_memory_mutex);
-    
     if (count)
         *count = alloc_count;
     if (total_size)
@@ -209,7 +306,6 @@ void lsw_memory_get_info(__u32 pid, __u32 *count, __u64 *total_size)
 int lsw_memory_read(__u32 pid, __u64 base, void *buffer, __u64 size)
 {
     struct lsw_memory_region *region;
-    int found = 0;
     __u64 offset;
     __u64 bytes_to_read;
     
@@ -217,50 +313,36 @@ int lsw_memory_read(__u32 pid, __u64 base, void *buffer, __u64 size)
         return -EINVAL;
     }
     
-    mutex_lock(&lsw_memory_mutex);
-    
     /* Find the memory region */
-    list_for_each_entry(region, &lsw_memory_list, list) {
-        if (region->pid == pid && 
-            base >= region->base_address &&
-            base < (region->base_address + region->size)) {
-            
-            found = 1;
-            
-            /* Calculate offset and size */
-            offset = base - region->base_address;
+    region = lsw_memory_find(pid, base, false);
+    if (!region) {
+        lsw_warn("Memory region not found for read: PID=%u, base=0x%llx",
+                 pid, base);
+        return -EINVAL;
+    }
+    
+    /* Calculate offset and size */
+    offset = base - region->base_address;
 
-            /* Explicit bounds validation to prevent out-of-bounds kernel read */
-            if (offset >= region->size) {
-                mutex_unlock(&lsw_memory_mutex);
-                return -EINVAL;
-            }
+    /* Explicit bounds validation to prevent out-of-bounds kernel read */
+    if (offset >= region->size) {
+        lsw_object_put(&region->obj);
+        return -EINVAL;
+    }
 
-            bytes_to_read = region->size - offset;
-            if (bytes_to_read > size) {
-                bytes_to_read = size;
-            }
-            
-            /* Copy memory from kernel allocation */
-            memcpy(buffer, (char *)region->kernel_addr + offset, bytes_to_read);
-            
-            lsw_info("Read memory: PID=%u, base=0x%llx, size=%llu bytes",
-                     pid, base, bytes_to_read);
-            
-            mutex_unlock(&lsw_memory_mutex);
-            return (int)bytes_to_read;
-        }
+    bytes_to_read = region->size - offset;
+    if (bytes_to_read > size) {
+        bytes_to_read = size;
     }
     
-    mutex_unlock(&lsw_memory_mutex);
+    /* Copy memory from kernel allocation */
+    memcpy(buffer, (char *)region->kernel_addr + offset, bytes_to_read);
+    lsw_object_put(&region->obj);
     
-    if (!found) {
-        lsw_warn("Memory region not found for read: PID=%u, base=0x%llx",
-                 pid, base);
-        return -EINVAL;
-    }
+    lsw_trace("Read memory: PID=%u, base=0x%llx, size=%llu bytes",
+              pid, base, bytes_to_read);
     
-    return 0;
+    return (int)bytes_to_read;
 }
 
 /**
@@ -272,39 +354,27 @@ int lsw_memory_protect(__u32 pid, __u64 base, __u64 size,
                        __u32 new_protect, __u32 *old_protect)
 {
     struct lsw_memory_region *region;
-    int found = 0;
-    
-    mutex_lock(&lsw_memory_mutex);
+    __u32 prev;
     
     /* Find the memory region */
-    list_for_each_entry(region, &lsw_memory_list, list) {
-        if (region->pid == pid && region->base_address == base) {
-            found = 1;
-            
-            /* Return old protection flags */
-            if (old_protect) {
-                *old_protect = region->protect;
-            }
-            
-            /* Set new protection flags */
-            region->protect = new_protect;
-            
-            lsw_info("Changed memory protection: PID=%u, base=0x%llx, old=0x%x, new=0x%x",
-                     pid, base, old_protect ? *old_protect : 0, new_protect);
-            
-            mutex_unlock(&lsw_memory_mutex);
-            return 0;
-        }
-    }
-    
-    mutex_unlock(&lsw_memory_mutex);
-    
-    if (!found) {
+    region = lsw_memory_find(pid, base, true);
+    if (!region) {
         lsw_warn("Memory region not found for protect: PID=%u, base=0x%llx",
                  pid, base);
         return -EINVAL;
     }
     
+    /* Set new protection flags, returning the old ones */
+    prev = xchg(&region->protect, new_protect);
+    lsw_object_put(&region->obj);
+    
+    if (old_protect) {
+        *old_protect = prev;
+    }
+    
+    lsw_trace("Changed memory protection: PID=%u, base=0x%llx, old=0x%x, new=0x%x",
+              pid, base, prev, new_protect);
+    
     return 0;
 }
 
@@ -323,29 +393,19 @@ int lsw_memory_init(void)
  */
 void lsw_memory_exit(void)
 {
-    struct lsw_memory_region *region, *tmp;
+    struct lsw_address_space *space;
+    unsigned long pid;
     int leaked_count = 0;
     __u64 leaked_size = 0;
     
-    mutex_lock(&lsw_memory_mutex);
+    mutex_lock(&lsw_memory_spaces_mutex);
     
     /* Free any remaining allocations */
-    list_for_each_entry_safe(region, tmp, &lsw_memory_list, list) {
-        lsw_warn("Memory leak: PID=%u, base=0x%llx, size=0x%llx",
-                 region->pid, region->base_address, region->size);
-        
-        if (region->kernel_addr) {
-            vfree(region->kernel_addr);
-        }
-        
-        leaked_size += region->size;
-        leaked_count++;
-        
-        list_del(&region->list);
-        kfree(region);
+    xa_for_each(&lsw_memory_spaces, pid, space) {
+        leaked_count += lsw_memory_space_release(space, &leaked_size, true);
     }
     
-    mutex_unlock(&lsw_memory_mutex);
+    mutex_unlock(&lsw_memory_spaces_mutex);
     
     if (leaked_count > 0) {
         lsw_warn("Freed %d leaked allocations (%llu KB) during cleanup",
@@ -12,10 +12,20 @@
 #include <linux/sched.h>
 #include <linux/kthread.h>
 #include <linux/delay.h>
+#include <linux/xarray.h>
+#include <linux/kprobes.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_process.h"
+#include "../include/kernel-module/lsw_syscall.h"
 #include "../include/kernel-module/lsw_dll.h"
 #include "../include/kernel-module/lsw_pe.h"
+#include "../include/kernel-module/lsw_device.h"
+#include "../include/kernel-module/lsw_handle.h"
+#include "../include/kernel-module/lsw_file.h"
+#include "../include/kernel-module/lsw_sync.h"
+#include "../include/kernel-module/lsw_memory.h"
 
 /* Global process and thread lists */
 static LIST_HEAD(lsw_process_list);
@@ -28,6 +38,183 @@ static __u32 next_win32_tid = 2000;
 static atomic_t lsw_process_count = ATOMIC_INIT(0);
 static atomic_t lsw_thread_count = ATOMIC_INIT(0);
 
+/*
+ * Processes that opted in to bare NT syscalls, by Linux tgid, for the
+ * syscall probe. Readers run on every syscall and only do an RCU
+ * lookup; writers serialize on lsw_pe_tasks_mutex so the probe's
+ * get/put follows the set exactly.
+ */
+struct lsw_pe_task {
+    __u64 start;             /* NT code range */
+    __u64 end;
+    int fd;                  /* The /dev/lsw descriptor to trap into */
+    struct file *file;       /* Its file, to opt out when it closes */
+    struct mm_struct *mm;    /* Compared only: an exec leaves the range */
+    struct rcu_head rcu;
+};
+
+static DEFINE_XARRAY(lsw_pe_tasks);
+static DEFINE_MUTEX(lsw_pe_tasks_mutex);
+
+/**
+ * lsw_process_trap_nt - Take bare syscalls from a code range as NT ones
+ */
+int lsw_process_trap_nt(pid_t linux_pid, struct file *file, int fd,
+                        __u64 start, __u64 end)
+{
+    struct lsw_pe_task *task, *old;
+    int ret = 0;
+
+    if (linux_pid <= 0 || start >= end)
+        return -EINVAL;
+
+    task = kmalloc(sizeof(*task), GFP_KERNEL);
+    if (!task)
+        return -ENOMEM;
+    task->start = start;
+    task->end = end;
+    task->fd = fd;
+    task->file = file;
+    task->mm = current->mm;
+
+    mutex_lock(&lsw_pe_tasks_mutex);
+    old = xa_store(&lsw_pe_tasks, linux_pid, task, GFP_KERNEL);
+    if (xa_is_err(old)) {
+        ret = xa_err(old);
+        kfree(task);
+    } else if (old) {
+        kfree_rcu(old, rcu);
+    } else {
+        lsw_syscall_hook_get();
+    }
+    mutex_unlock(&lsw_pe_tasks_mutex);
+
+    return ret;
+}
+
+/**
+ * lsw_process_untrap_nt - Opt a Linux process out of bare NT syscalls
+ */
+void lsw_process_untrap_nt(pid_t linux_pid)
+{
+    struct lsw_pe_task *task;
+
+    mutex_lock(&lsw_pe_tasks_mutex);
+    task = xa_erase(&lsw_pe_tasks, linux_pid);
+    if (task) {
+        kfree_rcu(task, rcu);
+        lsw_syscall_hook_put();
+    }
+    mutex_unlock(&lsw_pe_tasks_mutex);
+}
+
+/**
+ * lsw_process_untrap_file - Opt out every process that trapped into file
+ */
+void lsw_process_untrap_file(struct file *file)
+{
+    struct lsw_pe_task *task;
+    unsigned long pid;
+
+    mutex_lock(&lsw_pe_tasks_mutex);
+    xa_for_each(&lsw_pe_tasks, pid, task) {
+        if (task->file != file)
+            continue;
+        xa_erase(&lsw_pe_tasks, pid);
+        kfree_rcu(task, rcu);
+        lsw_syscall_hook_put();
+    }
+    mutex_unlock(&lsw_pe_tasks_mutex);
+}
+
+/**
+ * lsw_process_nt_trap_fd - The descriptor to trap a syscall into, if any
+ *
+ * Called from the syscall probe; atomic.
+ */
+bool lsw_process_nt_trap_fd(pid_t linux_pid, __u64 ip, int *fd)
+{
+    struct lsw_pe_task *task;
+    bool trap = false;
+
+    rcu_read_lock();
+    task = xa_load(&lsw_pe_tasks, linux_pid);
+    /* ip is past the two-byte syscall instruction */
+    if (task && task->mm == current->mm &&
+        ip - 2 >= task->start && ip - 2 < task->end) {
+        *fd = task->fd;
+        trap = true;
+    }
+    rcu_read_unlock();
+
+    return trap;
+}
+
+/*
+ * Process exit. Handle tables, memory and PE registrations are keyed by
+ * tgid and used to stay behind when a process died without cleaning up.
+ * A kprobe on release_task() sees a thread group leader go, which is
+ * after its last thread exited and it was reaped, so the pid is still
+ * allocated and cannot have been reused yet. The probe runs in atomic
+ * context; the teardown, which sleeps, runs from a work item.
+ */
+struct lsw_exited_process {
+    struct llist_node node;
+    __u32 tgid;
+};
+
+static LLIST_HEAD(lsw_exited_processes);
+static bool lsw_exit_probe_registered;
+
+static void lsw_process_reap(struct work_struct *work)
+{
+    struct llist_node *exited = llist_del_all(&lsw_exited_processes);
+    struct lsw_exited_process *ep, *tmp;
+
+    llist_for_each_entry_safe(ep, tmp, exited, node) {
+        lsw_debug("Cleaning up exited process: PID=%u", ep->tgid);
+        lsw_file_cleanup_process(ep->tgid);
+        lsw_sync_cleanup_process(ep->tgid);
+        lsw_memory_cleanup_process(ep->tgid);
+        lsw_device_process_exited(ep->tgid);
+        lsw_process_untrap_nt(ep->tgid);
+        kfree(ep);
+    }
+}
+
+static DECLARE_WORK(lsw_process_reap_work, lsw_process_reap);
+
+static int lsw_release_task_entry(struct kprobe *kp, struct pt_regs *regs)
+{
+    /* release_task(struct task_struct *p) */
+    struct task_struct *task = (struct task_struct *)(uintptr_t)regs->di;
+    struct lsw_exited_process *ep;
+    __u32 tgid;
+
+    if (!thread_group_leader(task))
+        return 0;
+
+    tgid = task->tgid;
+    if (!lsw_handle_has_table(tgid) && !lsw_memory_has_space(tgid) &&
+        !lsw_device_pe_registered(tgid))
+        return 0;
+
+    ep = kmalloc(sizeof(*ep), GFP_ATOMIC);
+    if (!ep) {
+        lsw_warn("Out of memory: state of exited PID %u kept until unload", tgid);
+        return 0;
+    }
+    ep->tgid = tgid;
+    llist_add(&ep->node, &lsw_exited_processes);
+    schedule_work(&lsw_process_reap_work);
+    return 0;
+}
+
+static struct kprobe lsw_exit_probe = {
+    .symbol_name = "release_task",
+    .pre_handler = lsw_release_task_entry,
+};
+
 /**
  * lsw_process_thread_func - Kernel thread for Win32 process
  */
@@ -290,29 +477,13 @@ int lsw_thread_terminate(__u32 win32_tid, __u32 exit_code)
 }
 
 /**
- * lsw_process_is_pe_pid - Check if a Linux PID is a registered LSW PE process
+ * lsw_process_traps_nt - Check if a Linux PID opted in to bare NT syscalls
  *
- * Called from hot paths (kprobe handler) — uses RCU-safe list traversal.
- * Returns true if found so the syscall interceptor can act.
+ * A lock-free xarray lookup under RCU, safe in any context.
  */
-bool lsw_process_is_pe_pid(pid_t linux_pid)
+bool lsw_process_traps_nt(pid_t linux_pid)
 {
-    struct lsw_process *proc;
-    bool found = false;
-
-    if (atomic_read(&lsw_process_count) == 0)
-        return false;
-
-    mutex_lock(&lsw_process_mutex);
-    list_for_each_entry(proc, &lsw_process_list, list) {
-        if ((pid_t)proc->linux_pid == linux_pid) {
-            found = true;
-            break;
-        }
-    }
-    mutex_unlock(&lsw_process_mutex);
-
-    return found;
+    return xa_load(&lsw_pe_tasks, linux_pid) != NULL;
 }
 
 /**
@@ -320,6 +491,15 @@ bool lsw_process_is_pe_pid(pid_t linux_pid)
  */
 int lsw_process_init(void)
 {
+    int ret;
+
+    ret = register_kprobe(&lsw_exit_probe);
+    if (ret < 0) {
+        lsw_warn("kprobe on release_task failed (%d) - state of exited processes kept until unload", ret);
+    } else {
+        lsw_exit_probe_registered = true;
+    }
+
     lsw_info("Process/thread management system initialized");
     lsw_info("Ready to create Win32 processes and threads");
     return 0;
@@ -334,6 +514,13 @@ void lsw_process_exit(void)
     struct lsw_thread *thread, *ttmp;
     int proc_count = 0, thread_count = 0;
     
+    /* Finish the teardown of processes that already exited */
+    if (lsw_exit_probe_registered) {
+        unregister_kprobe(&lsw_exit_probe);
+        lsw_exit_probe_registered = false;
+    }
+    flush_work(&lsw_process_reap_work);
+    
     mutex_lock(&lsw_process_mutex);
     
     /* Cleanup threads */
@@ -369,6 +556,11 @@ void lsw_process_exit(void)
     
     mutex_unlock(&lsw_process_mutex);
     
+    /* Opt-ins go with their /dev/lsw file, which pins the module */
+    mutex_lock(&lsw_pe_tasks_mutex);
+    xa_destroy(&lsw_pe_tasks);
+    mutex_unlock(&lsw_pe_tasks_mutex);
+    
     if (proc_count > 0 || thread_count > 0) {
         lsw_warn("Cleaned up %d processes and %d threads during exit",
                  proc_count, thread_count);
@@ -0,0 +1,313 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Kernel Module
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Shared-memory Syscall Ring Implementation
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mutex.h>
+#include <linux/log2.h>
+#include <linux/sched/signal.h>
+#include <linux/uaccess.h>
+#include "../include/kernel-module/lsw_kernel.h"
+#include "../include/kernel-module/lsw_ring.h"
+
+/* Kernel side of a ring; the indices it owns are kept here, not trusted from the mapping */
+struct lsw_ring {
+    void *map;                      /* vmalloc_user region shared with userspace */
+    size_t map_size;
+    struct lsw_ring_header *hdr;
+    struct lsw_ring_sqe *sqes;
+    struct lsw_ring_cqe *cqes;
+    __u32 entries;
+    __u32 mask;
+    __u32 sq_head;                  /* Next entry to claim; its completion slot is claimed with it */
+    __u32 cq_tail;                  /* Completions published so far */
+    struct lsw_ring_sqe *claimed;   /* Private copies of claimed entries, by index */
+    u8 *posted;                     /* Completions written but not yet published, by index */
+    __u64 chain_result;             /* Return value of the current chain's first entry */
+    bool chain_failed;              /* That entry failed */
+    bool chain_running;             /* The last claim has not finished */
+    __u32 last_claim;               /* Index it was claimed at */
+    struct mutex lock;              /* Indices and chain state; never held across a handler */
+};
+
+static void lsw_ring_free(struct lsw_ring *ring)
+{
+    vfree(ring->map);
+    kvfree(ring->claimed);
+    kfree(ring->posted);
+    kfree(ring);
+}
+
+/**
+ * lsw_ring_setup - Create the ring of an open /dev/lsw
+ */
+long lsw_ring_setup(struct file *file, struct lsw_ring_params __user *user_params)
+{
+    struct lsw_ring_params params;
+    struct lsw_ring *ring;
+    size_t sq_offset, cq_offset;
+
+    if (copy_from_user(&params, user_params, sizeof(params))) {
+        return -EFAULT;
+    }
+
+    if (params.flags || params.entries == 0 || params.entries > LSW_RING_MAX_ENTRIES) {
+        return -EINVAL;
+    }
+
+    ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+    if (!ring) {
+        return -ENOMEM;
+    }
+
+    ring->entries = roundup_pow_of_two(params.entries);
+    ring->mask = ring->entries - 1;
+    ring->chain_failed = true;      /* A leading linked entry has nothing to link to */
+    mutex_init(&ring->lock);
+
+    /* Header, then the submission entries, then the completion entries */
+    sq_offset = ALIGN(sizeof(struct lsw_ring_header), 64);
+    cq_offset = sq_offset + ALIGN(ring->entries * sizeof(struct lsw_ring_sqe), 64);
+    ring->map_size = PAGE_ALIGN(cq_offset + ring->entries * sizeof(struct lsw_ring_cqe));
+
+    ring->map = vmalloc_user(ring->map_size);
+    ring->claimed = kvmalloc_array(ring->entries, sizeof(*ring->claimed), GFP_KERNEL);
+    ring->posted = kzalloc(ring->entries, GFP_KERNEL);
+    if (!ring->map || !ring->claimed || !ring->posted) {
+        lsw_ring_free(ring);
+        return -ENOMEM;
+    }
+
+    ring->hdr = ring->map;
+    ring->sqes = ring->map + sq_offset;
+    ring->cqes = ring->map + cq_offset;
+    ring->hdr->entries = ring->entries;
+    ring->hdr->mask = ring->mask;
+
+    /* One ring per open file */
+    if (cmpxchg(&file->private_data, NULL, ring) != NULL) {
+        lsw_ring_free(ring);
+        return -EBUSY;
+    }
+
+    params.entries = ring->entries;
+    params.sq_offset = sq_offset;
+    params.cq_offset = cq_offset;
+    params.map_size = ring->map_size;
+
+    /* The ring stays with the file even if this copy fails */
+    if (copy_to_user(user_params, &params, sizeof(params))) {
+        return -EFAULT;
+    }
+
+    lsw_debug("Ring created: %u entries, %zu bytes", ring->entries, ring->map_size);
+    return 0;
+}
+
+/*
+ * Claim the next chain: its first entry and the linked entries after it,
+ * up to `limit` and the room left in the completion queue. The entries
+ * are copied out and their completion slots reserved, so the handlers
+ * can run without the lock. Called with ring->lock held; returns the
+ * number claimed, from index *start, or -EAGAIN if the chain's first
+ * entry is still running in another ENTER.
+ */
+static long lsw_ring_claim(struct lsw_ring *ring, __u32 limit, __u32 *start)
+{
+    __u32 tail, head, used, room, count;
+
+    /* Pairs with userspace's release store after filling the entries */
+    tail = smp_load_acquire(&ring->hdr->sq_tail);
+    limit = min3(limit, tail - ring->sq_head, ring->entries);
+
+    /*
+     * Room for the completions; cq_head is userspace's to advance, but it
+     * cannot have reaped past what was posted, so keep it within the last
+     * `entries` published slots. Slots still being run are never free.
+     */
+    head = smp_load_acquire(&ring->hdr->cq_head);
+    if (ring->cq_tail - head > ring->entries) {
+        head = ring->cq_tail - ring->entries;
+    }
+    used = ring->sq_head - head;
+    room = used < ring->entries ? ring->entries - used : 0;
+    limit = min(limit, room);
+
+    if (limit == 0) {
+        return 0;
+    }
+
+    /* The rest of a chain needs its first entry's result */
+    if ((READ_ONCE(ring->sqes[ring->sq_head & ring->mask].flags) & LSW_RING_SQE_LINK) &&
+        ring->chain_running) {
+        return -EAGAIN;
+    }
+
+    /* Take private copies; userspace may scribble on the slots meanwhile */
+    count = 0;
+    do {
+        __u32 index = (ring->sq_head + count) & ring->mask;
+
+        memcpy(&ring->claimed[index], &ring->sqes[index], sizeof(ring->claimed[index]));
+        count++;
+    } while (count < limit &&
+             (READ_ONCE(ring->sqes[(ring->sq_head + count) & ring->mask].flags) & LSW_RING_SQE_LINK));
+
+    *start = ring->sq_head;
+    ring->sq_head += count;
+    smp_store_release(&ring->hdr->sq_head, ring->sq_head);
+
+    ring->last_claim = *start;
+    ring->chain_running = true;
+    return count;
+}
+
+/*
+ * Publish a written completion, and any after it that finished first;
+ * completions appear in submission order. Called with ring->lock held.
+ */
+static void lsw_ring_post(struct lsw_ring *ring, __u32 index)
+{
+    ring->posted[index & ring->mask] = 1;
+
+    while (ring->cq_tail != ring->sq_head && ring->posted[ring->cq_tail & ring->mask]) {
+        ring->posted[ring->cq_tail & ring->mask] = 0;
+        ring->cq_tail++;
+    }
+
+    /* Publish each completion so a reaper sees progress past slow entries */
+    smp_store_release(&ring->hdr->cq_tail, ring->cq_tail);
+}
+
+/**
+ * lsw_ring_enter - Run submitted requests
+ */
+long lsw_ring_enter(struct file *file, __u32 to_submit)
+{
+    struct lsw_ring *ring = READ_ONCE(file->private_data);
+    struct lsw_syscall_request req;
+    struct lsw_ring_sqe *sqe;
+    struct lsw_ring_cqe *cqe;
+    __u64 chain_result = 0;
+    bool chain_failed = true;
+    __u32 start = 0, i;
+    long submitted = 0;
+    long count = 0;
+
+    if (!ring) {
+        return -ENXIO;
+    }
+
+    while (submitted < to_submit) {
+        if (fatal_signal_pending(current)) {
+            break;
+        }
+
+        mutex_lock(&ring->lock);
+        count = lsw_ring_claim(ring, to_submit - submitted, &start);
+        if (count > 0 && (ring->claimed[start & ring->mask].flags & LSW_RING_SQE_LINK)) {
+            /* Continues a chain an earlier ENTER started */
+            chain_result = ring->chain_result;
+            chain_failed = ring->chain_failed;
+        }
+        mutex_unlock(&ring->lock);
+
+        if (count <= 0) {
+            break;
+        }
+
+        for (i = 0; i < count; i++) {
+            sqe = &ring->claimed[(start + i) & ring->mask];
+            memcpy(&req, &sqe->req, sizeof(req));
+            req.return_value = 0;
+            req.error_code = 0;
+
+            if ((sqe->flags & LSW_RING_SQE_LINK) && chain_failed) {
+                req.error_code = -ECANCELED;
+            } else if (req.syscall_number == LSW_SYSCALL_NtTerminateThread ||
+                       req.syscall_number == LSW_SYSCALL_NtTerminateProcess) {
+                /* Would never return to post this completion, or any after it */
+                req.error_code = -EOPNOTSUPP;
+            } else if (fatal_signal_pending(current)) {
+                req.error_code = -EINTR;
+            } else {
+                if (sqe->flags & LSW_RING_SQE_LINK) {
+                    req.args[0] = chain_result;
+                }
+                lsw_handle_syscall(&req);
+            }
+
+            if (!(sqe->flags & LSW_RING_SQE_LINK)) {
+                /* Starts a new chain */
+                chain_result = req.return_value;
+                chain_failed = req.error_code != 0;
+            }
+
+            /* The slot is reserved; it is not visible until posted */
+            cqe = &ring->cqes[(start + i) & ring->mask];
+            cqe->user_data = sqe->user_data;
+            cqe->return_value = req.return_value;
+            cqe->error_code = req.error_code;
+            cqe->reserved = 0;
+
+            mutex_lock(&ring->lock);
+            if (i == count - 1 && ring->last_claim == start) {
+                /* Nothing claimed since: hand the chain to the next ENTER */
+                ring->chain_result = chain_result;
+                ring->chain_failed = chain_failed;
+                ring->chain_running = false;
+            }
+            lsw_ring_post(ring, start + i);
+            mutex_unlock(&ring->lock);
+            submitted++;
+
+            cond_resched();
+        }
+    }
+
+    lsw_trace("Ring enter: %ld of %u entries run", submitted, to_submit);
+    if (submitted == 0 && count < 0) {
+        return count;
+    }
+    return submitted;
+}
+
+/**
+ * lsw_ring_mmap - Map a file's ring into userspace
+ */
+int lsw_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct lsw_ring *ring = READ_ONCE(file->private_data);
+
+    if (!ring) {
+        return -ENXIO;
+    }
+
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > ring->map_size) {
+        return -EINVAL;
+    }
+
+    return remap_vmalloc_range(vma, ring->map, 0);
+}
+
+/**
+ * lsw_ring_release - Free a file's ring when the file is closed
+ */
+void lsw_ring_release(struct file *file)
+{
+    struct lsw_ring *ring = file->private_data;
+
+    /* Mappings hold a file reference, so none is left by now */
+    if (ring) {
+        file->private_data = NULL;
+        lsw_ring_free(ring);
+    }
+}
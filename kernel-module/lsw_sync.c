@@ -13,15 +13,53 @@
 #include <linux/wait.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_sync.h"
-
-/* Global sync object list */
-static LIST_HEAD(lsw_sync_list);
-static DEFINE_MUTEX(lsw_sync_mutex);
-static __u64 next_sync_handle = 0x2000;  /* Start sync handles at 0x2000 */
+#include "../include/kernel-module/lsw_handle.h"
 
 /* Statistics */
 static atomic_t lsw_sync_objects = ATOMIC_INIT(0);
 
+/**
+ * lsw_sync_destroy - Last reference to a sync object dropped
+ */
+static void lsw_sync_destroy(struct lsw_object *base)
+{
+    struct lsw_sync_object *obj = container_of(base, struct lsw_sync_object, obj);
+    
+    atomic_dec(&lsw_sync_objects);
+    kfree_rcu(obj, obj.rcu);
+}
+
+/**
+ * lsw_sync_get - Look up a sync handle of the calling process
+ *
+ * Returns the object with a reference held, or NULL.
+ */
+static struct lsw_sync_object *lsw_sync_get(__u64 handle)
+{
+    struct lsw_object *base = lsw_handle_get(current->tgid, handle, LSW_OBJECT_SYNC);
+    
+    return base ? container_of(base, struct lsw_sync_object, obj) : NULL;
+}
+
+/**
+ * lsw_sync_publish - Give a new sync object its handle
+ */
+static __u64 lsw_sync_publish(struct lsw_sync_object *obj)
+{
+    __u64 handle;
+    
+    atomic_inc(&lsw_sync_objects);
+    
+    handle = lsw_handle_insert(&obj->obj);
+    if (!handle) {
+        lsw_object_put(&obj->obj);
+        return 0;
+    }
+    obj->handle = handle;
+    
+    return handle;
+}
+
 /**
  * lsw_sync_create_event - Create an event object
  */
@@ -30,34 +68,27 @@ __u64 lsw_sync_create_event(__u32 pid, bool manual_reset, bool initial_state)
     struct lsw_sync_object *obj;
     __u64 handle;
     
-    obj = kmalloc(sizeof(*obj), GFP_KERNEL);
+    obj = kzalloc(sizeof(*obj), GFP_KERNEL);
     if (!obj) {
         lsw_err("Failed to allocate sync object");
         return 0;
     }
     
-    /* Assign handle */
-    mutex_lock(&lsw_sync_mutex);
-    handle = next_sync_handle++;
-    mutex_unlock(&lsw_sync_mutex);
-    
     /* Initialize event */
-    obj->handle = handle;
+    lsw_object_init(&obj->obj, LSW_OBJECT_SYNC, pid, lsw_sync_destroy);
     obj->type = LSW_SYNC_EVENT;
-    obj->pid = pid;
     init_waitqueue_head(&obj->wait_queue);
     atomic_set(&obj->signaled, initial_state ? 1 : 0);
-    snprintf(obj->name, sizeof(obj->name), "event_%llx", handle);
     
-    /* Add to list */
-    mutex_lock(&lsw_sync_mutex);
-    list_add(&obj->list, &lsw_sync_list);
-    mutex_unlock(&lsw_sync_mutex);
-    
-    atomic_inc(&lsw_sync_objects);
+    /* Add to the process's handle table */
+    handle = lsw_sync_publish(obj);
+    if (!handle) {
+        return 0;
+    }
+    snprintf(obj->name, sizeof(obj->name), "event_%llx", handle);
     
-    lsw_info("Created event: PID=%u, handle=0x%llx, manual=%d, signaled=%d",
-             pid, handle, manual_reset, initial_state);
+    lsw_trace("Created event: PID=%u, handle=0x%llx, manual=%d, signaled=%d",
+              pid, handle, manual_reset, initial_state);
     
     return handle;
 }
@@ -70,34 +101,27 @@ __u64 lsw_sync_create_mutex(__u32 pid, bool initial_owner)
     struct lsw_sync_object *obj;
     __u64 handle;
     
-    obj = kmalloc(sizeof(*obj), GFP_KERNEL);
+    obj = kzalloc(sizeof(*obj), GFP_KERNEL);
     if (!obj) {
         lsw_err("Failed to allocate sync object");
         return 0;
     }
     
-    /* Assign handle */
-    mutex_lock(&lsw_sync_mutex);
-    handle = next_sync_handle++;
-    mutex_unlock(&lsw_sync_mutex);
-    
     /* Initialize mutex */
-    obj->handle = handle;
+    lsw_object_init(&obj->obj, LSW_OBJECT_SYNC, pid, lsw_sync_destroy);
     obj->type = LSW_SYNC_MUTEX;
-    obj->pid = pid;
     init_waitqueue_head(&obj->wait_queue);
     atomic_set(&obj->signaled, initial_owner ? 0 : 1);
-    snprintf(obj->name, sizeof(obj->name), "mutex_%llx", handle);
-    
-    /* Add to list */
-    mutex_lock(&lsw_sync_mutex);
-    list_add(&obj->list, &lsw_sync_list);
-    mutex_unlock(&lsw_sync_mutex);
     
-    atomic_inc(&lsw_sync_objects);
+    /* Add to the process's handle table */
+    handle = lsw_sync_publish(obj);
+    if (!handle) {
+        return 0;
+    }
+    snprintf(obj->name, sizeof(obj->name), "mutex_%llx", handle);
     
-    lsw_info("Created mutex: PID=%u, handle=0x%llx, owned=%d",
-             pid, handle, initial_owner);
+    lsw_trace("Created mutex: PID=%u, handle=0x%llx, owned=%d",
+              pid, handle, initial_owner);
     
     return handle;
 }
@@ -108,56 +132,54 @@ __u64 lsw_sync_create_mutex(__u32 pid, bool initial_owner)
 int lsw_sync_wait(__u64 handle, __u32 timeout_ms)
 {
     struct lsw_sync_object *obj;
-    int ret = -EBADF;
+    long ret;
     long timeout_jiffies;
     
-    mutex_lock(&lsw_sync_mutex);
-    
-    /* Find sync object */
-    list_for_each_entry(obj, &lsw_sync_list, list) {
-        if (obj->handle == handle) {
-            mutex_unlock(&lsw_sync_mutex);
-            
-            /* Calculate timeout */
-            if (timeout_ms == 0) {
-                timeout_jiffies = MAX_SCHEDULE_TIMEOUT;  /* Infinite */
-            } else {
-                timeout_jiffies = msecs_to_jiffies(timeout_ms);
-            }
-            
-            lsw_debug("Waiting on object 0x%llx (timeout=%u ms)", handle, timeout_ms);
-            
-            /* Wait for signal */
-            ret = wait_event_interruptible_timeout(
-                obj->wait_queue,
-                atomic_read(&obj->signaled) != 0,
-                timeout_jiffies
-            );
-            
-            if (ret == 0) {
-                lsw_debug("Wait timed out on 0x%llx", handle);
-                return -ETIMEDOUT;
-            } else if (ret < 0) {
-                lsw_warn("Wait interrupted on 0x%llx: %d", handle, ret);
-                return ret;
-            }
-            
-            /* Object is signaled */
-            lsw_debug("Object 0x%llx signaled", handle);
-            
-            /* For mutex, acquire it (set to non-signaled) */
-            if (obj->type == LSW_SYNC_MUTEX) {
-                atomic_set(&obj->signaled, 0);
-            }
-            
-            return 0;
+    /* Find sync object; the reference keeps it alive while we sleep,
+     * even if another thread closes the handle */
+    obj = lsw_sync_get(handle);
+    if (!obj) {
+        lsw_warn("Sync object not found: 0x%llx", handle);
+        return -EBADF;
+    }
+    
+    /* Calculate timeout */
+    if (timeout_ms == 0) {
+        timeout_jiffies = MAX_SCHEDULE_TIMEOUT;  /* Infinite */
+    } else {
+        timeout_jiffies = msecs_to_jiffies(timeout_ms);
+    }
+    
+    lsw_trace("Waiting on object 0x%llx (timeout=%u ms)", handle, timeout_ms);
+    
+    /* Wait for signal */
+    ret = wait_event_interruptible_timeout(
+        obj->wait_queue,
+        atomic_read(&obj->signaled) != 0,
+        timeout_jiffies
+    );
+    
+    if (ret > 0) {
+        /* Object is signaled */
+        lsw_trace("Object 0x%llx signaled", handle);
+        
+        /* For mutex, acquire it (set to non-signaled) */
+        if (obj->type == LSW_SYNC_MUTEX) {
+            atomic_set(&obj->signaled, 0);
         }
     }
     
-    mutex_unlock(&lsw_sync_mutex);
+    lsw_object_put(&obj->obj);
+    
+    if (ret == 0) {
+        lsw_trace("Wait timed out on 0x%llx", handle);
+        return -ETIMEDOUT;
+    } else if (ret < 0) {
+        lsw_warn("Wait interrupted on 0x%llx: %ld", handle, ret);
+        return (int)ret;
+    }
     
-    lsw_warn("Sync object not found: 0x%llx", handle);
-    return ret;
+    return 0;
 }
 
 /**
@@ -166,33 +188,23 @@ int lsw_sync_wait(__u64 handle, __u32 timeout_ms)
 int lsw_sync_signal(__u64 handle)
 {
     struct lsw_sync_object *obj;
-    int found = 0;
-    
-    mutex_lock(&lsw_sync_mutex);
-    
-    list_for_each_entry(obj, &lsw_sync_list, list) {
-        if (obj->handle == handle) {
-            found = 1;
-            
-            lsw_debug("Signaling object 0x%llx", handle);
-            
-            /* Set signaled state */
-            atomic_set(&obj->signaled, 1);
-            
-            /* Wake up waiters */
-            wake_up_interruptible(&obj->wait_queue);
-            
-            break;
-        }
-    }
-    
-    mutex_unlock(&lsw_sync_mutex);
     
-    if (!found) {
+    obj = lsw_sync_get(handle);
+    if (!obj) {
         lsw_warn("Sync object not found: 0x%llx", handle);
         return -EBADF;
     }
     
+    lsw_trace("Signaling object 0x%llx", handle);
+    
+    /* Set signaled state */
+    atomic_set(&obj->signaled, 1);
+    
+    /* Wake up waiters */
+    wake_up_interruptible(&obj->wait_queue);
+    
+    lsw_object_put(&obj->obj);
+    
     return 0;
 }
 
@@ -201,37 +213,17 @@ int lsw_sync_signal(__u64 handle)
  */
 int lsw_sync_close(__u64 handle)
 {
-    struct lsw_sync_object *obj, *tmp;
-    int found = 0;
-    
-    mutex_lock(&lsw_sync_mutex);
-    
-    list_for_each_entry_safe(obj, tmp, &lsw_sync_list, list) {
-        if (obj->handle == handle) {
-            found = 1;
-            
-            lsw_info("Closing sync object: handle=0x%llx, type=%u",
-                     handle, obj->type);
-            
-            /* Wake any waiters */
-            wake_up_interruptible_all(&obj->wait_queue);
-            
-            atomic_dec(&lsw_sync_objects);
-            
-            list_del(&obj->list);
-            kfree(obj);
-            
-            break;
-        }
-    }
-    
-    mutex_unlock(&lsw_sync_mutex);
-    
-    if (!found) {
+    /*
+     * As on Windows, waiters hold their own reference: the object lives
+     * on until they time out or it is signaled through another handle.
+     */
+    if (lsw_handle_close(current->tgid, handle, LSW_OBJECT_SYNC) != 0) {
         lsw_warn("Sync object not found: 0x%llx", handle);
         return -EBADF;
     }
     
+    lsw_trace("Closed sync object: handle=0x%llx", handle);
+    
     return 0;
 }
 
@@ -240,26 +232,7 @@ int lsw_sync_close(__u64 handle)
  */
 void lsw_sync_cleanup_process(__u32 pid)
 {
-    struct lsw_sync_object *obj, *tmp;
-    int closed_count = 0;
-    
-    mutex_lock(&lsw_sync_mutex);
-    
-    list_for_each_entry_safe(obj, tmp, &lsw_sync_list, list) {
-        if (obj->pid == pid) {
-            lsw_debug("Cleaning up sync object: handle=0x%llx", obj->handle);
-            
-            wake_up_interruptible_all(&obj->wait_queue);
-            
-            atomic_dec(&lsw_sync_objects);
-            closed_count++;
-            
-            list_del(&obj->list);
-            kfree(obj);
-        }
-    }
-    
-    mutex_unlock(&lsw_sync_mutex);
+    int closed_count = lsw_handle_close_process(pid, LSW_OBJECT_SYNC);
     
     if (closed_count > 0) {
         lsw_info("Cleaned up %d sync objects for PID %u", closed_count, pid);
@@ -281,23 +254,7 @@ int lsw_sync_init(void)
  */
 void lsw_sync_exit(void)
 {
-    struct lsw_sync_object *obj, *tmp;
-    int leaked_count = 0;
-    
-    mutex_lock(&lsw_sync_mutex);
-    
-    list_for_each_entry_safe(obj, tmp, &lsw_sync_list, list) {
-        lsw_warn("Sync object leak: PID=%u, handle=0x%llx, type=%u",
-                 obj->pid, obj->handle, obj->type);
-        
-        wake_up_interruptible_all(&obj->wait_queue);
-        leaked_count++;
-        
-        list_del(&obj->list);
-        kfree(obj);
-    }
-    
-    mutex_unlock(&lsw_sync_mutex);
+    int leaked_count = lsw_handle_close_all(LSW_OBJECT_SYNC);
     
     if (leaked_count > 0) {
         lsw_warn("Closed %d leaked sync objects during cleanup", leaked_count);
@@ -12,15 +12,23 @@
 #include <linux/slab.h>
 #include <linux/sched/signal.h>
 #include <linux/kprobes.h>
+#include <linux/jump_label.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
 #include <linux/delay.h>
 #include <linux/hrtimer.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
 #include "../include/kernel-module/lsw_kernel.h"
 #include "../include/kernel-module/lsw_syscall.h"
 #include "../include/kernel-module/lsw_memory.h"
 #include "../include/kernel-module/lsw_file.h"
 #include "../include/kernel-module/lsw_sync.h"
+#include "../include/kernel-module/lsw_handle.h"
 #include "../include/kernel-module/lsw_dll.h"
 #include "../include/kernel-module/lsw_process.h"
+#include "../include/kernel-module/lsw_device.h"
 
 /* Forward declarations */
 long lsw_syscall_NtCreateFile(struct lsw_syscall_request *req);
@@ -91,29 +99,72 @@ static struct lsw_syscall_entry syscall_table[] = {
     { 0, NULL, NULL } /* Terminator */
 };
 
+#define LSW_SYSCALL_ENTRIES ARRAY_SIZE(syscall_table)
+
+/*
+ * Direct-indexed dispatch, built from syscall_table at init: slot of the
+ * syscall number -> 1 + its syscall_table index, 0 when unimplemented.
+ */
+static u8 syscall_dispatch[LSW_SYSCALL_SLOTS] __read_mostly;
+
+/* Calls per syscall_table entry; the terminator's slot counts ioctl
+ * requests for unimplemented numbers */
+static DEFINE_PER_CPU(unsigned long [LSW_SYSCALL_ENTRIES], syscall_calls);
+
+static struct dentry *lsw_debugfs_dir;
+
+static inline int lsw_syscall_slot(u32 nr)
+{
+    if (nr < LSW_SYSCALL_NT_COUNT)
+        return nr;
+    if (nr - LSW_SYSCALL_LSW_BASE < LSW_SYSCALL_LSW_COUNT)
+        return LSW_SYSCALL_NT_COUNT + (nr - LSW_SYSCALL_LSW_BASE);
+    return -1;
+}
+
+/* Whether `nr` has a handler; unlike lookup, does not count a call */
+static inline bool lsw_syscall_implemented(u32 nr)
+{
+    int slot = lsw_syscall_slot(nr);
+
+    return slot >= 0 && syscall_dispatch[slot];
+}
+
+/* Table entry for `nr` (and count the call), or NULL */
+static inline const struct lsw_syscall_entry *lsw_syscall_lookup(u32 nr)
+{
+    int slot = lsw_syscall_slot(nr);
+    unsigned int idx = slot >= 0 ? syscall_dispatch[slot] : 0;
+
+    if (!idx)
+        return NULL;
+    this_cpu_inc(syscall_calls[idx - 1]);
+    return &syscall_table[idx - 1];
+}
+
 /**
  * lsw_handle_syscall - Main syscall dispatcher
  */
 long lsw_handle_syscall(struct lsw_syscall_request *req)
 {
-    int i;
+    const struct lsw_syscall_entry *entry;
     
     if (!req) {
         return -EINVAL;
     }
     
     /* Find handler for this syscall */
-    for (i = 0; syscall_table[i].handler != NULL; i++) {
-        if (syscall_table[i].syscall_number == req->syscall_number) {
-            lsw_debug("Dispatching syscall: %s (0x%04x)",
-                     syscall_table[i].name, req->syscall_number);
-            
-            /* Call the handler */
-            return syscall_table[i].handler(req);
-        }
+    entry = lsw_syscall_lookup(req->syscall_number);
+    if (entry) {
+        lsw_trace("Dispatching syscall: %s (0x%04x)",
+                  entry->name, req->syscall_number);
+        
+        /* Call the handler */
+        return entry->handler(req);
     }
     
-    lsw_warn("Unimplemented syscall: 0x%04x", req->syscall_number);
+    this_cpu_inc(syscall_calls[LSW_SYSCALL_ENTRIES - 1]);
+    lsw_trace("Unimplemented syscall: 0x%04x", req->syscall_number);
     return -ENOSYS;
 }
 
@@ -141,11 +192,11 @@ long lsw_syscall_NtCreateFile(struct lsw_syscall_request *req)
     }
     path_kernel[sizeof(path_kernel) - 1] = '\0';
     
-    lsw_info("NtCreateFile: path='%s', access=0x%x, disposition=%u, flags=0x%x",
-             path_kernel, access, disposition, flags);
+    lsw_trace("NtCreateFile: path='%s', access=0x%x, disposition=%u, flags=0x%x",
+              path_kernel, access, disposition, flags);
     
     /* Use current PID */
-    __u32 pid = current->pid;
+    __u32 pid = current->tgid;
     
     /* Open file via LSW file manager */
     handle = lsw_file_open(pid, path_kernel, access, 0, disposition);
@@ -157,67 +208,96 @@ long lsw_syscall_NtCreateFile(struct lsw_syscall_request *req)
         return -ENOENT;
     }
     
-    lsw_info("NtCreateFile success: handle=0x%llx for path='%s'", handle, path_kernel);
+    lsw_trace("NtCreateFile success: handle=0x%llx for path='%s'", handle, path_kernel);
     req->return_value = handle;
     req->error_code = 0;
     
     return 0;
 }
 
+/* NTSTATUS values reported in the IO_STATUS_BLOCK */
+#define LSW_STATUS_SUCCESS              0x00000000
+#define LSW_STATUS_UNSUCCESSFUL         0xC0000001
+#define LSW_STATUS_ACCESS_VIOLATION     0xC0000005
+#define LSW_STATUS_INVALID_HANDLE       0xC0000008
+#define LSW_STATUS_INVALID_PARAMETER    0xC000000D
+#define LSW_STATUS_END_OF_FILE          0xC0000011
+
+/*
+ * NtReadFile/NtWriteFile arguments:
+ *   args[0] handle, args[1] buffer, args[2] length,
+ *   args[3] PLARGE_INTEGER ByteOffset (0: file pointer),
+ *   args[4] PIO_STATUS_BLOCK (optional)
+ */
+static int lsw_file_byte_offset(__u64 offset_ptr, __s64 *offset)
+{
+    if (!offset_ptr) {
+        *offset = LSW_FILE_USE_FILE_POINTER_POSITION;
+        return 0;
+    }
+    if (copy_from_user(offset, (const __s64 __user *)offset_ptr, sizeof(*offset))) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static void lsw_file_io_status(__u64 iosb_ptr, __u32 status, __u64 information)
+{
+    struct lsw_io_status_block iosb = {
+        .status = status,
+        .information = information,
+    };
+    
+    if (iosb_ptr && copy_to_user((void __user *)iosb_ptr, &iosb, sizeof(iosb))) {
+        lsw_trace("Failed to update IO_STATUS_BLOCK at 0x%llx", iosb_ptr);
+    }
+}
+
+static __u32 lsw_file_error_status(int err)
+{
+    switch (err) {
+    case -EBADF:  return LSW_STATUS_INVALID_HANDLE;
+    case -EFAULT: return LSW_STATUS_ACCESS_VIOLATION;
+    case -EINVAL: return LSW_STATUS_INVALID_PARAMETER;
+    default:      return LSW_STATUS_UNSUCCESSFUL;
+    }
+}
+
 /**
  * lsw_syscall_NtReadFile - Translate NtReadFile to Linux read()
+ *
+ * Reads straight into the caller's buffer, whatever its size.
  */
 long lsw_syscall_NtReadFile(struct lsw_syscall_request *req)
 {
     __u64 handle = req->args[0];
     __u64 buffer_ptr = req->args[1];  /* Userspace buffer pointer */
     __u64 size = req->args[2];
+    __u64 iosb_ptr = req->args[4];
     __u64 bytes_read = 0;
-    char *temp_buffer;
+    __s64 offset;
     int ret;
     
-    lsw_info("NtReadFile: handle=0x%llx, buffer=0x%llx, size=%llu", handle, buffer_ptr, size);
-    
-    /* Allocate temp buffer on heap to avoid stack frame issues */
-    temp_buffer = kmalloc(4096, GFP_KERNEL);
-    if (!temp_buffer) {
-        lsw_err("Failed to allocate temp buffer");
-        req->return_value = 0;
-        req->error_code = -ENOMEM;
-        return -ENOMEM;
-    }
+    lsw_trace("NtReadFile: handle=0x%llx, buffer=0x%llx, size=%llu", handle, buffer_ptr, size);
     
-    /* Limit read size */
-    if (size > 4096) {
-        size = 4096;
+    ret = lsw_file_byte_offset(req->args[3], &offset);
+    if (ret == 0) {
+        /* Read via LSW file manager */
+        ret = lsw_file_read(handle, (void __user *)buffer_ptr, size, offset, &bytes_read);
     }
     
-    /* Read via LSW file manager */
-    ret = lsw_file_read(handle, temp_buffer, size, &bytes_read);
-    
     if (ret != 0) {
-        lsw_err("File read failed: %d", ret);
-        kfree(temp_buffer);
+        lsw_trace("File read failed: %d", ret);
+        lsw_file_io_status(iosb_ptr, lsw_file_error_status(ret), 0);
         req->return_value = 0;
         req->error_code = ret;
         return ret;
     }
     
-    lsw_info("Read %llu bytes from handle 0x%llx", bytes_read, handle);
+    lsw_trace("Read %llu bytes from handle 0x%llx", bytes_read, handle);
     
-    /* Copy data to userspace buffer */
-    if (bytes_read > 0 && buffer_ptr != 0) {
-        if (copy_to_user((void __user *)buffer_ptr, temp_buffer, bytes_read)) {
-            lsw_err("Failed to copy data to userspace buffer");
-            kfree(temp_buffer);
-            req->return_value = 0;
-            req->error_code = -EFAULT;
-            return -EFAULT;
-        }
-        lsw_info("Copied %llu bytes to userspace buffer at 0x%llx", bytes_read, buffer_ptr);
-    }
-    
-    kfree(temp_buffer);
+    lsw_file_io_status(iosb_ptr, bytes_read ? LSW_STATUS_SUCCESS : LSW_STATUS_END_OF_FILE,
+                       bytes_read);
     req->return_value = bytes_read;
     req->error_code = 0;
     
@@ -226,54 +306,39 @@ long lsw_syscall_NtReadFile(struct lsw_syscall_request *req)
 
 /**
  * lsw_syscall_NtWriteFile - Translate NtWriteFile to Linux write()
+ *
+ * Writes straight from the caller's buffer, whatever its size.
  */
 long lsw_syscall_NtWriteFile(struct lsw_syscall_request *req)
 {
     __u64 handle = req->args[0];
     __u64 buffer_ptr = req->args[1];  /* Userspace buffer pointer */
     __u64 size = req->args[2];
+    __u64 iosb_ptr = req->args[4];
     __u64 bytes_written = 0;
-    char *kernel_buffer;
+    __s64 offset;
     int ret;
-    size_t copy_size;
-    
-    lsw_info("NtWriteFile: handle=0x%llx, buffer=0x%llx, size=%llu", handle, buffer_ptr, size);
-    
-    /* Allocate buffer on heap to avoid stack frame issues */
-    kernel_buffer = kmalloc(4096, GFP_KERNEL);
-    if (!kernel_buffer) {
-        lsw_err("Failed to allocate kernel buffer");
-        req->return_value = 0;
-        req->error_code = -ENOMEM;
-        return -ENOMEM;
-    }
     
-    /* Limit size to our buffer */
-    copy_size = size > 4096 ? 4096 : size;
+    lsw_trace("NtWriteFile: handle=0x%llx, buffer=0x%llx, size=%llu", handle, buffer_ptr, size);
     
-    /* Copy data from userspace */
-    if (copy_from_user(kernel_buffer, (void __user *)buffer_ptr, copy_size)) {
-        lsw_err("Failed to copy buffer from userspace");
-        kfree(kernel_buffer);
-        req->return_value = 0;
-        req->error_code = -EFAULT;
-        return -EFAULT;
+    ret = lsw_file_byte_offset(req->args[3], &offset);
+    if (ret == 0) {
+        /* Write via LSW file manager */
+        ret = lsw_file_write(handle, (const void __user *)buffer_ptr, size, offset,
+                             &bytes_written);
     }
     
-    /* Write via LSW file manager */
-    ret = lsw_file_write(handle, kernel_buffer, copy_size, &bytes_written);
-    
-    kfree(kernel_buffer);
-    
     if (ret != 0) {
-        lsw_err("File write failed: %d", ret);
+        lsw_trace("File write failed: %d", ret);
+        lsw_file_io_status(iosb_ptr, lsw_file_error_status(ret), 0);
         req->return_value = 0;
         req->error_code = ret;
         return ret;
     }
     
-    lsw_info("Wrote %llu bytes to handle 0x%llx", bytes_written, handle);
+    lsw_trace("Wrote %llu bytes to handle 0x%llx", bytes_written, handle);
     
+    lsw_file_io_status(iosb_ptr, LSW_STATUS_SUCCESS, bytes_written);
     req->return_value = bytes_written;
     req->error_code = 0;
     
@@ -289,7 +354,7 @@ long lsw_syscall_LswGetFileSize(struct lsw_syscall_request *req)
     __u64 size;
     int ret;
     
-    lsw_info("LswGetFileSize: handle=0x%llx", handle);
+    lsw_trace("LswGetFileSize: handle=0x%llx", handle);
     
     ret = lsw_file_get_size(handle, &size);
     if (ret != 0) {
@@ -315,7 +380,7 @@ long lsw_syscall_LswSetFilePointer(struct lsw_syscall_request *req)
     __u64 new_pos;
     int ret;
     
-    lsw_info("LswSetFilePointer: handle=0x%llx, offset=%lld, whence=%u", handle, offset, whence);
+    lsw_trace("LswSetFilePointer: handle=0x%llx, offset=%lld, whence=%u", handle, offset, whence);
     
     ret = lsw_file_seek(handle, offset, whence, &new_pos);
     if (ret != 0) {
@@ -331,20 +396,20 @@ long lsw_syscall_LswSetFilePointer(struct lsw_syscall_request *req)
 }
 
 /**
- * lsw_syscall_NtClose - Translate NtClose to Linux close()
+ * lsw_syscall_NtClose - Close a handle of any object type
  */
 long lsw_syscall_NtClose(struct lsw_syscall_request *req)
 {
     __u64 handle = req->args[0];
     int ret;
     
-    lsw_info("NtClose: handle=0x%llx", handle);
+    lsw_trace("NtClose: handle=0x%llx", handle);
     
-    /* Close via LSW file manager */
-    ret = lsw_file_close(handle);
+    /* Files, events and mutexes share the process's handle table */
+    ret = lsw_handle_close(current->tgid, handle, LSW_OBJECT_ANY);
     
     if (ret != 0) {
-        lsw_err("File close failed: %d", ret);
+        lsw_trace("Close failed: handle=0x%llx, %d", handle, ret);
         req->return_value = 0;
         req->error_code = ret;
         return ret;
@@ -378,11 +443,11 @@ long lsw_syscall_NtAllocateVirtualMemory(struct lsw_syscall_request *req)
     __u32 protect = req->args[3];
     __u64 allocated_base;
     
-    lsw_info("NtAllocateVirtualMemory: base=0x%llx, size=0x%llx, type=0x%x, protect=0x%x",
-             base_address, region_size, alloc_type, protect);
+    lsw_trace("NtAllocateVirtualMemory: base=0x%llx, size=0x%llx, type=0x%x, protect=0x%x",
+              base_address, region_size, alloc_type, protect);
     
     /* Use current PID as process identifier */
-    __u32 pid = current->pid;
+    __u32 pid = current->tgid;
     
     /* Allocate memory via LSW memory manager */
     allocated_base = lsw_memory_allocate(pid, base_address, region_size, 
@@ -419,11 +484,11 @@ long lsw_syscall_NtFreeVirtualMemory(struct lsw_syscall_request *req)
     __u32 free_type = req->args[2];
     int ret;
     
-    lsw_info("NtFreeVirtualMemory: base=0x%llx, size=0x%llx, type=0x%x",
-             base_address, region_size, free_type);
+    lsw_trace("NtFreeVirtualMemory: base=0x%llx, size=0x%llx, type=0x%x",
+              base_address, region_size, free_type);
     
     /* Use current PID */
-    __u32 pid = current->pid;
+    __u32 pid = current->tgid;
     
     /* Free memory via LSW memory manager */
     ret = lsw_memory_free(pid, base_address, region_size, free_type);
@@ -464,11 +529,11 @@ long lsw_syscall_NtReadVirtualMemory(struct lsw_syscall_request *req)
     
     /* Use current PID if target is 0 (self) */
     if (target_pid == 0) {
-        target_pid = current->pid;
+        target_pid = current->tgid;
     }
     
-    lsw_info("NtReadVirtualMemory: target_pid=%u, base=0x%llx, size=%llu",
-             target_pid, base_address, size);
+    lsw_trace("NtReadVirtualMemory: target_pid=%u, base=0x%llx, size=%llu",
+              target_pid, base_address, size);
     
     /* Limit read size for safety */
     if (size > sizeof(temp_buffer)) {
@@ -485,7 +550,7 @@ long lsw_syscall_NtReadVirtualMemory(struct lsw_syscall_request *req)
         return bytes_read;
     }
     
-    lsw_info("Successfully read %d bytes from PID %u", bytes_read, target_pid);
+    lsw_trace("Successfully read %d bytes from PID %u", bytes_read, target_pid);
     
     req->return_value = bytes_read;
     req->error_code = 0;
@@ -514,11 +579,11 @@ long lsw_syscall_NtProtectVirtualMemory(struct lsw_syscall_request *req)
     __u32 old_protect = 0;
     int ret;
     
-    lsw_info("NtProtectVirtualMemory: base=0x%llx, size=%llu, new_protect=0x%x",
-             base_address, size, new_protect);
+    lsw_trace("NtProtectVirtualMemory: base=0x%llx, size=%llu, new_protect=0x%x",
+              base_address, size, new_protect);
     
     /* Use current PID */
-    __u32 pid = current->pid;
+    __u32 pid = current->tgid;
     
     /* Change protection via LSW memory manager */
     ret = lsw_memory_protect(pid, base_address, size, new_protect, &old_protect);
@@ -530,7 +595,7 @@ long lsw_syscall_NtProtectVirtualMemory(struct lsw_syscall_request *req)
         return ret;
     }
     
-    lsw_info("Protection changed: old=0x%x, new=0x%x", old_protect, new_protect);
+    lsw_trace("Protection changed: old=0x%x, new=0x%x", old_protect, new_protect);
     
     req->return_value = old_protect;  /* Return old protection flags */
     req->error_code = 0;
@@ -556,8 +621,8 @@ long lsw_syscall_NtQuerySystemInformation(struct lsw_syscall_request *req)
     struct task_struct *task;
     int process_count = 0;
     
-    lsw_info("NtQuerySystemInformation: class=0x%x (SystemProcessInformation=5)",
-             info_class);
+    lsw_trace("NtQuerySystemInformation: class=0x%x (SystemProcessInformation=5)",
+              info_class);
     
     /* SystemProcessInformation = 5 (enumerate processes) */
     if (info_class == 5) {
@@ -572,14 +637,14 @@ long lsw_syscall_NtQuerySystemInformation(struct lsw_syscall_request *req)
 #else
                 task_state = (unsigned int)task->state;
 #endif
-                lsw_info("  Process: PID=%d, name=%s, state=%u",
-                         task->pid, task->comm, task_state);
+                lsw_trace("  Process: PID=%d, name=%s, state=%u",
+                          task->pid, task->comm, task_state);
             }
             process_count++;
         }
         rcu_read_unlock();
         
-        lsw_info("Total processes enumerated: %d", process_count);
+        lsw_trace("Total processes enumerated: %d", process_count);
         
         /* Return process count in return_value */
         req->return_value = process_count;
@@ -590,12 +655,12 @@ long lsw_syscall_NtQuerySystemInformation(struct lsw_syscall_request *req)
     
     /* SystemBasicInformation = 0 (system info) */
     if (info_class == 0) {
-        lsw_info("  System basic information requested");
-        lsw_info("  Total RAM: %lu KB", totalram_pages() * (PAGE_SIZE / 1024));
-        lsw_info("  Kernel version: %d.%d.%d",
-                 LINUX_VERSION_CODE >> 16,
-                 (LINUX_VERSION_CODE >> 8) & 0xFF,
-                 LINUX_VERSION_CODE & 0xFF);
+        lsw_trace("  System basic information requested");
+        lsw_trace("  Total RAM: %lu KB", totalram_pages() * (PAGE_SIZE / 1024));
+        lsw_trace("  Kernel version: %d.%d.%d",
+                  LINUX_VERSION_CODE >> 16,
+                  (LINUX_VERSION_CODE >> 8) & 0xFF,
+                  LINUX_VERSION_CODE & 0xFF);
         
         req->return_value = 0;
         req->error_code = 0;
@@ -604,7 +669,7 @@ long lsw_syscall_NtQuerySystemInformation(struct lsw_syscall_request *req)
     }
     
     /* Other information classes not yet implemented */
-    lsw_info("Information class 0x%x not yet implemented", info_class);
+    lsw_trace("Information class 0x%x not yet implemented", info_class);
     req->return_value = 0;
     req->error_code = -ENOSYS;
     
@@ -620,9 +685,9 @@ long lsw_syscall_NtCreateEvent(struct lsw_syscall_request *req)
     bool initial_state = req->args[1];
     __u64 handle;
     
-    lsw_info("NtCreateEvent: manual=%d, initial=%d", manual_reset, initial_state);
+    lsw_trace("NtCreateEvent: manual=%d, initial=%d", manual_reset, initial_state);
     
-    handle = lsw_sync_create_event(current->pid, manual_reset, initial_state);
+    handle = lsw_sync_create_event(current->tgid, manual_reset, initial_state);
     
     if (handle == 0) {
         lsw_err("Failed to create event");
@@ -645,9 +710,9 @@ long lsw_syscall_NtCreateMutant(struct lsw_syscall_request *req)
     bool initial_owner = req->args[0];
     __u64 handle;
     
-    lsw_info("NtCreateMutant: owned=%d", initial_owner);
+    lsw_trace("NtCreateMutant: owned=%d", initial_owner);
     
-    handle = lsw_sync_create_mutex(current->pid, initial_owner);
+    handle = lsw_sync_create_mutex(current->tgid, initial_owner);
     
     if (handle == 0) {
         lsw_err("Failed to create mutex");
@@ -671,7 +736,7 @@ long lsw_syscall_NtWaitForSingleObject(struct lsw_syscall_request *req)
     __u32 timeout_ms = req->args[1];
     int ret;
     
-    lsw_info("NtWaitForSingleObject: handle=0x%llx, timeout=%u ms", handle, timeout_ms);
+    lsw_trace("NtWaitForSingleObject: handle=0x%llx, timeout=%u ms", handle, timeout_ms);
     
     ret = lsw_sync_wait(handle, timeout_ms);
     
@@ -700,7 +765,7 @@ long lsw_syscall_NtSetEvent(struct lsw_syscall_request *req)
     __u64 handle = req->args[0];
     int ret;
     
-    lsw_info("NtSetEvent: handle=0x%llx", handle);
+    lsw_trace("NtSetEvent: handle=0x%llx", handle);
     
     ret = lsw_sync_signal(handle);
     
@@ -725,7 +790,7 @@ long lsw_syscall_NtReleaseMutant(struct lsw_syscall_request *req)
     __u64 handle = req->args[0];
     int ret;
     
-    lsw_info("NtReleaseMutant: handle=0x%llx", handle);
+    lsw_trace("NtReleaseMutant: handle=0x%llx", handle);
     
     ret = lsw_sync_signal(handle);
     
@@ -761,7 +826,7 @@ long lsw_syscall_LdrLoadDll(struct lsw_syscall_request *req)
     }
     path_kernel[sizeof(path_kernel) - 1] = '\0';
     
-    lsw_info("LdrLoadDll: path='%s' (from userspace)", path_kernel);
+    lsw_trace("LdrLoadDll: path='%s' (from userspace)", path_kernel);
     
     ret = lsw_dll_load(current->pid, path_kernel, &base_address);
     
@@ -772,7 +837,7 @@ long lsw_syscall_LdrLoadDll(struct lsw_syscall_request *req)
         return ret;
     }
     
-    lsw_info("LdrLoadDll success: base=0x%llx for '%s'", base_address, path_kernel);
+    lsw_trace("LdrLoadDll success: base=0x%llx for '%s'", base_address, path_kernel);
     req->return_value = base_address;
     req->error_code = 0;
     
@@ -788,8 +853,8 @@ long lsw_syscall_LdrGetProcedureAddress(struct lsw_syscall_request *req)
     const char *function_name = "TestFunction";  /* TODO: Get from userspace */
     __u64 proc_address;
     
-    lsw_info("LdrGetProcedureAddress: base=0x%llx, function='%s'",
-             base_address, function_name);
+    lsw_trace("LdrGetProcedureAddress: base=0x%llx, function='%s'",
+              base_address, function_name);
     
     proc_address = lsw_dll_get_proc_address(base_address, function_name);
     
@@ -822,7 +887,7 @@ long lsw_syscall_NtCreateProcess(struct lsw_syscall_request *req)
         return -EINVAL;
     }
     
-    lsw_info("NtCreateProcess: path='%s'", path);
+    lsw_trace("NtCreateProcess: path='%s'", path);
     
     ret = lsw_process_create(path, &win32_pid);
     
@@ -833,7 +898,7 @@ long lsw_syscall_NtCreateProcess(struct lsw_syscall_request *req)
         return ret;
     }
     
-    lsw_info("Process created: Win32 PID=%u", win32_pid);
+    lsw_trace("Process created: Win32 PID=%u", win32_pid);
     
     req->return_value = win32_pid;
     req->error_code = 0;
@@ -852,8 +917,8 @@ long lsw_syscall_NtCreateThreadEx(struct lsw_syscall_request *req)
     __u32 win32_tid = 0;
     int ret;
     
-    lsw_info("NtCreateThreadEx: PID=%u, start=0x%llx, param=0x%llx",
-             win32_pid, start_address, parameter);
+    lsw_trace("NtCreateThreadEx: PID=%u, start=0x%llx, param=0x%llx",
+              win32_pid, start_address, parameter);
     
     ret = lsw_thread_create(win32_pid, start_address, parameter, &win32_tid);
     
@@ -864,7 +929,7 @@ long lsw_syscall_NtCreateThreadEx(struct lsw_syscall_request *req)
         return ret;
     }
     
-    lsw_info("Thread created: Win32 TID=%u", win32_tid);
+    lsw_trace("Thread created: Win32 TID=%u", win32_tid);
     
     req->return_value = win32_tid;
     req->error_code = 0;
@@ -881,7 +946,7 @@ long lsw_syscall_NtTerminateProcess(struct lsw_syscall_request *req)
     __u32 exit_code = req->args[1];
     int ret;
     
-    lsw_info("NtTerminateProcess: PID=%u, exit_code=%u", win32_pid, exit_code);
+    lsw_trace("NtTerminateProcess: PID=%u, exit_code=%u", win32_pid, exit_code);
     
     ret = lsw_process_terminate(win32_pid, exit_code);
     
@@ -906,7 +971,7 @@ long lsw_syscall_LswGetStdHandle(struct lsw_syscall_request *req)
     __u32 std_handle = req->args[0];
     __u64 handle;
     
-    lsw_info("LswGetStdHandle: std_handle=%u", std_handle);
+    lsw_trace("LswGetStdHandle: std_handle=%u", std_handle);
     
     handle = lsw_console_GetStdHandle(std_handle);
     
@@ -927,7 +992,7 @@ long lsw_syscall_LswWriteConsole(struct lsw_syscall_request *req)
     __u32 __user *chars_written_ptr = (__u32 __user *)req->args[3];
     int ret;
     
-    lsw_info("LswWriteConsole: handle=0x%llx, chars=%u", handle, chars_to_write);
+    lsw_trace("LswWriteConsole: handle=0x%llx, chars=%u", handle, chars_to_write);
     
     ret = lsw_console_WriteConsole(handle, buffer, chars_to_write, chars_written_ptr);
     
@@ -954,7 +1019,7 @@ long lsw_syscall_LswReadConsole(struct lsw_syscall_request *req)
     __u32 __user *chars_read_ptr = (__u32 __user *)req->args[3];
     int ret;
     
-    lsw_info("LswReadConsole: handle=0x%llx, chars=%u", handle, chars_to_read);
+    lsw_trace("LswReadConsole: handle=0x%llx, chars=%u", handle, chars_to_read);
     
     ret = lsw_console_ReadConsole(handle, buffer, chars_to_read, chars_read_ptr);
     
@@ -1020,7 +1085,7 @@ long lsw_syscall_NtQueryInformationProcess(struct lsw_syscall_request *req)
     void __user *buf  = (void __user *)(uintptr_t)req->args[2];
     __u32  buf_len    = (__u32)req->args[3];
 
-    lsw_info("NtQueryInformationProcess: class=%u", info_class);
+    lsw_trace("NtQueryInformationProcess: class=%u", info_class);
 
     /* ProcessBasicInformation = 0 */
     if (info_class == 0 && buf && buf_len >= 48) {
@@ -1049,7 +1114,7 @@ long lsw_syscall_NtQueryInformationProcess(struct lsw_syscall_request *req)
 long lsw_syscall_NtTerminateThread(struct lsw_syscall_request *req)
 {
     __u32 exit_code = (__u32)req->args[1];
-    lsw_info("NtTerminateThread: exit_code=%u", exit_code);
+    lsw_trace("NtTerminateThread: exit_code=%u", exit_code);
     /* For now, just signal the current thread */
     do_exit((long)exit_code);
     /* unreachable */
@@ -1066,8 +1131,8 @@ long lsw_syscall_NtTerminateThread(struct lsw_syscall_request *req)
 long lsw_syscall_NtWaitForMultipleObjects(struct lsw_syscall_request *req)
 {
     __u32 timeout_ms = (__u32)req->args[3];
-    lsw_info("NtWaitForMultipleObjects: count=%u, timeout=%u ms",
-             (__u32)req->args[0], timeout_ms);
+    lsw_trace("NtWaitForMultipleObjects: count=%u, timeout=%u ms",
+              (__u32)req->args[0], timeout_ms);
     if (timeout_ms != 0xFFFFFFFF)
         msleep_interruptible(min(timeout_ms, 5000U));
     req->return_value = 0; /* STATUS_WAIT_0 */
@@ -1081,7 +1146,7 @@ long lsw_syscall_NtWaitForMultipleObjects(struct lsw_syscall_request *req)
  */
 long lsw_syscall_NtFlushBuffersFile(struct lsw_syscall_request *req)
 {
-    lsw_info("NtFlushBuffersFile: handle=0x%llx", req->args[0]);
+    lsw_trace("NtFlushBuffersFile: handle=0x%llx", req->args[0]);
     req->return_value = 0;
     req->error_code   = 0;
     return 0;
@@ -1114,42 +1179,112 @@ long lsw_syscall_NtSetInformationFile(struct lsw_syscall_request *req)
 }
 
 /* ============================================================
- * kretprobe-based NT syscall interception
+ * kprobe-based NT syscall interception
  *
  * When a PE process issues a bare `syscall` instruction (e.g. by
  * calling NtCreateFile directly), the CPU dispatches to
  * entry_SYSCALL_64 which calls do_syscall_64(pt_regs*, nr).
- * We hook do_syscall_64 with a kretprobe:
- *   entry_handler — intercepts NT numbers, runs our handler,
- *                   stores result, and replaces nr with getpid
- *                   so the kernel runs a harmless syscall.
- *   ret_handler   — overwrites the getpid result with our value.
+ * Syscall numbers alone cannot tell NT from Linux, so only a process
+ * that opted in with LSW_IOCTL_TRAP_NT_SYSCALLS is looked at, and only
+ * syscalls from the code range it gave.
+ *
+ * The probe runs in atomic context and handlers sleep, so it does not
+ * run them. It turns the syscall into ioctl(fd, LSW_IOCTL_NT_TRAP(nr))
+ * on the process's /dev/lsw descriptor; the NT arguments stay where
+ * they are (r10, rdx, r8, r9, stack). rdi and rsi are parked in rcx
+ * and r11, which `syscall` clobbers anyway, and lsw_syscall_trapped()
+ * puts them back. Its return value is the NT status in rax.
+ *
+ * The probe fires for every syscall on the machine, so it is only
+ * attached while at least one process opted in, and the handler sits
+ * behind a static key that is patched in and out with it.
  * ============================================================ */
 
-/* Per-invocation data stored in the kretprobe instance */
-struct lsw_intercept_data {
-    struct pt_regs *syscall_regs;  /* The ACTUAL syscall pt_regs */
-    u64             result;         /* Our NT return value */
-    bool            intercepted;    /* Was this an NT syscall? */
-};
+/* True while processes trap NT syscalls (and the probe is attached) */
+static DEFINE_STATIC_KEY_FALSE(lsw_pe_tasks_present);
 
-static int lsw_kretprobe_entry(struct kretprobe_instance *ri,
-                                struct pt_regs *regs)
+/* Serializes attach/detach and lsw_module_state.pe_process_count */
+static DEFINE_MUTEX(lsw_hook_mutex);
+
+/*
+ * NtReadFile/NtWriteFile(FileHandle, Event, ApcRoutine, ApcContext,
+ * IoStatusBlock, Buffer, Length, ByteOffset, Key) pass IoStatusBlock
+ * and the arguments after it on the caller's stack, above the return
+ * address and the 0x20-byte home area. The handlers take the ioctl layout (handle,
+ * buffer, length, ByteOffset, IoStatusBlock), so move them there.
+ */
+static int lsw_nt_file_args(const struct pt_regs *sc_regs, struct lsw_syscall_request *req)
 {
-    struct lsw_intercept_data *d = (struct lsw_intercept_data *)ri->data;
-    struct pt_regs *sc_regs;
-    int             nr;
-    unsigned int    i;
+    __u64 stack[4];  /* IoStatusBlock, Buffer, Length, ByteOffset */
+
+    if (copy_from_user(stack, (const void __user *)(sc_regs->sp + 0x28),
+                       sizeof(stack)))
+        return -EFAULT;
+
+    req->args[1] = stack[1];
+    req->args[2] = (__u32)stack[2];
+    req->args[3] = stack[3];
+    req->args[4] = stack[0];
+    return 0;
+}
+
+/**
+ * lsw_syscall_trapped - Run a bare NT syscall the probe redirected
+ *
+ * Process context, in the ioctl the probe made of the syscall.
+ * Returns the NT status for rax.
+ */
+long lsw_syscall_trapped(u32 nr)
+{
+    struct pt_regs *regs = current_pt_regs();
     struct lsw_syscall_request req;
 
-    d->intercepted = false;
+    if (!lsw_process_traps_nt(current->tgid))
+        return -EPERM;
 
-    /* Fast path: skip if no PE processes are registered */
-    if (!lsw_module_state.pe_process_count)
-        return 0;
+    /* Give the caller back the registers the probe borrowed */
+    regs->di  = regs->cx;
+    regs->si  = regs->r11;
+    regs->cx  = regs->ip;
+    regs->r11 = regs->flags;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = nr;
+    req.arg_count      = 6;
+
+    /*
+     * NT calling convention: before the `syscall` instruction the
+     * Windows stub does `mov r10, rcx` to preserve the first arg
+     * (rcx is clobbered by syscall).  So arg0 = r10, arg1 = rdx,
+     * arg2 = r8, arg3 = r9; further args are on the stack.
+     */
+    req.args[0] = regs->r10;
+    req.args[1] = regs->dx;
+    req.args[2] = regs->r8;
+    req.args[3] = regs->r9;
+
+    if ((nr == LSW_SYSCALL_NtReadFile || nr == LSW_SYSCALL_NtWriteFile) &&
+        lsw_nt_file_args(regs, &req)) {
+        /* Without its stack arguments r9 (ApcContext) would be
+         * taken for ByteOffset; fail the call instead */
+        req.return_value = 0;
+        req.error_code   = -EFAULT;
+    } else {
+        lsw_handle_syscall(&req);
+    }
+
+    lsw_trace("trapped NT syscall 0x%x -> 0x%llx", nr, req.return_value);
+    return (long)req.return_value;
+}
 
-    /* Skip if the current task isn't a registered PE process */
-    if (!lsw_process_is_pe_pid(current->pid))
+static int lsw_kprobe_syscall_entry(struct kprobe *kp, struct pt_regs *regs)
+{
+    struct pt_regs *sc_regs;
+    int             nr;
+    int             fd;
+
+    /* Fast path: skip if no process traps NT syscalls */
+    if (!static_branch_unlikely(&lsw_pe_tasks_present))
         return 0;
 
     /*
@@ -1159,73 +1294,114 @@ static int lsw_kretprobe_entry(struct kretprobe_instance *ri,
     sc_regs = (struct pt_regs *)(uintptr_t)regs->di;
     nr      = (int)(regs->si & 0xFFFFFFFF);
 
-    /* Scan our dispatch table for a matching NT syscall number */
-    for (i = 0; syscall_table[i].handler != NULL; i++) {
-        if ((unsigned int)nr != syscall_table[i].syscall_number)
-            continue;
+    if (!sc_regs || !lsw_syscall_implemented((u32)nr))
+        return 0;
 
-        memset(&req, 0, sizeof(req));
-        req.syscall_number = (u32)nr;
-        req.arg_count      = 6;
-
-        /*
-         * NT calling convention: before the `syscall` instruction the
-         * Windows stub does `mov r10, rcx` to preserve the first arg
-         * (rcx is clobbered by syscall).  So arg0 = r10, arg1 = rdx,
-         * arg2 = r8, arg3 = r9; further args are on the stack.
-         */
-        if (sc_regs) {
-            req.args[0] = sc_regs->r10;
-            req.args[1] = sc_regs->dx;
-            req.args[2] = sc_regs->r8;
-            req.args[3] = sc_regs->r9;
-        }
+    /* Any thread of an opted-in process, from its NT code only */
+    if (!lsw_process_nt_trap_fd(current->tgid, sc_regs->ip, &fd))
+        return 0;
 
-        syscall_table[i].handler(&req);
+    sc_regs->cx      = sc_regs->di;
+    sc_regs->r11     = sc_regs->si;
+    sc_regs->di      = fd;
+    sc_regs->si      = LSW_IOCTL_NT_TRAP(nr);
+    sc_regs->orig_ax = __NR_ioctl;
+    regs->si         = __NR_ioctl;
+    return 0;
+}
 
-        /* Save result and mark as intercepted */
-        d->syscall_regs  = sc_regs;
-        d->result        = req.return_value;
-        d->intercepted   = true;
+static struct kprobe lsw_kprobe_syscall = {
+    .symbol_name = "do_syscall_64",
+    .pre_handler = lsw_kprobe_syscall_entry,
+};
 
-        /*
-         * Replace the syscall number with sys_getpid (39) so the kernel
-         * runs a harmless call instead of the wrong Linux syscall.
-         * The return handler will overwrite the result in regs->ax.
-         */
-        regs->si = __NR_getpid;
+/* Called with lsw_hook_mutex held */
+static void lsw_syscall_attach(void)
+{
+    int ret;
 
-        lsw_debug("kretprobe: intercepted NT syscall %s (0x%x) → 0x%llx",
-                  syscall_table[i].name, nr, req.return_value);
-        return 0;
+    /*
+     * A kprobe that was registered before keeps the address resolved
+     * from symbol_name, and registering with both set fails.
+     */
+    lsw_kprobe_syscall.addr  = NULL;
+    lsw_kprobe_syscall.flags = 0;
+
+    /* Register kprobe so bare NT syscall instructions are intercepted */
+    ret = register_kprobe(&lsw_kprobe_syscall);
+    if (ret < 0) {
+        lsw_warn("kprobe on do_syscall_64 failed (%d) — ioctl path only", ret);
+        /* Non-fatal: apps that go through our Win32 stubs still work */
+        return;
     }
 
-    return 0;
+    lsw_module_state.syscall_hooks_active = true;
+    static_branch_enable(&lsw_pe_tasks_present);
+    lsw_info("kprobe on do_syscall_64 registered — bare NT syscalls intercepted");
+}
+
+/* Called with lsw_hook_mutex held */
+static void lsw_syscall_detach(void)
+{
+    if (!lsw_module_state.syscall_hooks_active)
+        return;
+
+    static_branch_disable(&lsw_pe_tasks_present);
+    unregister_kprobe(&lsw_kprobe_syscall);
+    lsw_module_state.syscall_hooks_active = false;
+    lsw_info("kprobe on do_syscall_64 unregistered");
+}
+
+/**
+ * lsw_syscall_hook_get - A process opted in to bare NT syscalls
+ *
+ * Attaches the syscall probe when it is the first one.
+ */
+void lsw_syscall_hook_get(void)
+{
+    mutex_lock(&lsw_hook_mutex);
+    if (lsw_module_state.pe_process_count++ == 0)
+        lsw_syscall_attach();
+    mutex_unlock(&lsw_hook_mutex);
+}
+
+/**
+ * lsw_syscall_hook_put - A process opted out of bare NT syscalls
+ *
+ * Detaches the syscall probe when it was the last one.
+ */
+void lsw_syscall_hook_put(void)
+{
+    mutex_lock(&lsw_hook_mutex);
+    if (lsw_module_state.pe_process_count > 0 &&
+        --lsw_module_state.pe_process_count == 0)
+        lsw_syscall_detach();
+    mutex_unlock(&lsw_hook_mutex);
 }
 
-static int lsw_kretprobe_ret(struct kretprobe_instance *ri,
-                              struct pt_regs *regs)
+/*
+ * /sys/kernel/debug/lsw/syscalls: one line per implemented syscall with
+ * the number of calls through either path, then the unimplemented ones.
+ */
+static int lsw_syscalls_show(struct seq_file *m, void *v)
 {
-    struct lsw_intercept_data *d = (struct lsw_intercept_data *)ri->data;
-
-    if (d->intercepted && d->syscall_regs) {
-        /*
-         * do_syscall_64 has returned.  The result of the harmless
-         * getpid() call is now in d->syscall_regs->ax.
-         * Overwrite it with our NT return value.
-         */
-        d->syscall_regs->ax = d->result;
+    unsigned int i;
+    unsigned long calls;
+    int cpu;
+
+    for (i = 0; i < LSW_SYSCALL_ENTRIES; i++) {
+        calls = 0;
+        for_each_possible_cpu(cpu)
+            calls += per_cpu(syscall_calls, cpu)[i];
+        if (syscall_table[i].handler)
+            seq_printf(m, "0x%04x %-28s %lu\n", syscall_table[i].syscall_number,
+                       syscall_table[i].name, calls);
+        else
+            seq_printf(m, "       %-28s %lu\n", "(unimplemented)", calls);
     }
     return 0;
 }
-
-static struct kretprobe lsw_kretprobe_syscall = {
-    .kp.symbol_name = "do_syscall_64",
-    .entry_handler  = lsw_kretprobe_entry,
-    .handler        = lsw_kretprobe_ret,
-    .data_size      = sizeof(struct lsw_intercept_data),
-    .maxactive      = 64,   /* max simultaneous intercepts */
-};
+DEFINE_SHOW_ATTRIBUTE(lsw_syscalls);
 
 /**
  * lsw_syscall_init - Initialize syscall translation system
@@ -1233,25 +1409,34 @@ static struct kretprobe lsw_kretprobe_syscall = {
 int lsw_syscall_init(void)
 {
     int count = 0;
+    int slot;
     int i;
-    int ret;
     
-    /* Count registered syscalls */
+    BUILD_BUG_ON(LSW_SYSCALL_ENTRIES > U8_MAX);
+    
+    /* Build the dispatch array; the first entry for a number wins */
     for (i = 0; syscall_table[i].handler != NULL; i++) {
+        slot = lsw_syscall_slot(syscall_table[i].syscall_number);
+        if (slot < 0) {
+            lsw_warn("Syscall %s (0x%04x) outside the dispatch range — ignored",
+                     syscall_table[i].name, syscall_table[i].syscall_number);
+            continue;
+        }
+        if (syscall_dispatch[slot]) {
+            lsw_warn("Syscall %s (0x%04x) already handled by %s — ignored",
+                     syscall_table[i].name, syscall_table[i].syscall_number,
+                     syscall_table[syscall_dispatch[slot] - 1].name);
+            continue;
+        }
+        syscall_dispatch[slot] = i + 1;
         count++;
     }
     
+    lsw_debugfs_dir = debugfs_create_dir(LSW_MODULE_NAME, NULL);
+    debugfs_create_file("syscalls", 0444, lsw_debugfs_dir, NULL, &lsw_syscalls_fops);
+    
     lsw_info("Syscall translation system initialized: %d syscalls registered", count);
-
-    /* Register kretprobe so bare NT syscall instructions are intercepted */
-    ret = register_kretprobe(&lsw_kretprobe_syscall);
-    if (ret < 0) {
-        lsw_warn("kretprobe on do_syscall_64 failed (%d) — ioctl path only", ret);
-        /* Non-fatal: apps that go through our Win32 stubs still work */
-    } else {
-        lsw_info("kretprobe on do_syscall_64 registered — bare NT syscalls intercepted");
-        lsw_module_state.syscall_hooks_active = true;
-    }
+    lsw_info("kprobe on do_syscall_64 attaches when a PE process traps NT syscalls");
 
     return 0;
 }
@@ -1261,10 +1446,11 @@ int lsw_syscall_init(void)
  */
 void lsw_syscall_exit(void)
 {
-    if (lsw_module_state.syscall_hooks_active) {
-        unregister_kretprobe(&lsw_kretprobe_syscall);
-        lsw_module_state.syscall_hooks_active = false;
-        lsw_info("kretprobe on do_syscall_64 unregistered");
-    }
+    mutex_lock(&lsw_hook_mutex);
+    lsw_syscall_detach();
+    lsw_module_state.pe_process_count = 0;
+    mutex_unlock(&lsw_hook_mutex);
+    debugfs_remove_recursive(lsw_debugfs_dir);
+    lsw_debugfs_dir = NULL;
     lsw_info("Syscall translation system cleaned up");
 }
@@ -7,15 +7,19 @@
 #include "lsw_types.h"
 #include "lsw_log.h"
 #include "lsw_filesystem.h"
+#include "lsw_overlay.h"
 #include "lsw_registry.h"
 #include "pe-loader/pe_loader.h"
 #include "pe-loader/pe_parser.h"
 #include "pe-loader/pe_format.h"
+#include "pe-loader/pe_zygote.h"
+#include "win32-api/win32_spawn.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <getopt.h>
+#include <unistd.h>
 
 // ============================================================================
 // SECTION: Help System (Friendly!)
@@ -88,6 +92,12 @@ void show_help(void) {
     printf("    Example: lsw --launch app.exe -debug\n");
     printf("    \n");
     printf("    Why use this? To see what's happening behind the scenes.\n");
+    printf("    \n");
+    printf("  --zygote [socket]\n");
+    printf("    Start once, then launch programs quickly (set LSW_ZYGOTE=[socket])\n");
+    printf("    Example: lsw --zygote /tmp/lsw.sock\n");
+    printf("    \n");
+    printf("    Why use this? Build tools that run many small programs start faster.\n");
     printf("\n");
     printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
     printf("\n");
@@ -159,6 +169,15 @@ int main(int argc, char* argv[]) {
         show_no_args();
         return 0;
     }
+
+    // Zygote: serve launches; each forked child carries on below with the
+    // client's argv, the image-independent startup already done
+    bool zygote_child = false;
+    if (strcmp(argv[1], "--zygote") == 0) {
+        int rc = pe_zygote_serve(argc > 2 ? argv[2] : NULL, &argc, &argv);
+        if (rc != PE_ZYGOTE_CHILD) return rc;
+        zygote_child = true;
+    }
     
     // Parse command line arguments
     bool debug_mode = false;
@@ -208,6 +227,8 @@ int main(int argc, char* argv[]) {
                 fprintf(stderr, "Need help? Run: lsw --help\n\n");
                 return 1;
             }
+        } else if (strcmp(argv[i], "--") == 0) {
+            break;  // everything after it belongs to the Windows program
         } else if (strcmp(argv[i], "-debug") == 0) {
             debug_mode = true;
             lsw_log_set_level(LSW_LOG_DEBUG);
@@ -281,14 +302,27 @@ int main(int argc, char* argv[]) {
     LSW_LOG_INFO("LSW starting - Linux Subsystem for Windows");
     LSW_LOG_INFO("Target: %s", executable_path);
     
-    // Initialize LSW prefix (create ~/.lsw/drives/c/ if needed)
-    lsw_status_t init_result = lsw_fs_init_prefix();
-    if (init_result != LSW_SUCCESS) {
-        LSW_LOG_WARN("Failed to initialize LSW prefix directories");
+    // LSW_ZYGOTE=<socket>: hand the launch to a running zygote if it takes it
+    const char* zygote = getenv(PE_ZYGOTE_ENV);
+    if (zygote && *zygote && !zygote_child) {
+        int rc = pe_zygote_launch(zygote, argc, argv);
+        if (rc >= 0) return rc;
     }
     
-    // Populate registry with default environment (first run)
-    lsw_reg_populate_environment();
+    // LSW_OVERLAY=<dir>: keep this job's writes out of the shared prefix.
+    // Mounting needs a single-threaded process, so this comes first.
+    lsw_overlay_init();
+    
+    if (!zygote_child) {
+        // Initialize LSW prefix (create ~/.lsw/drives/c/ if needed)
+        lsw_status_t init_result = lsw_fs_init_prefix();
+        if (init_result != LSW_SUCCESS) {
+            LSW_LOG_WARN("Failed to initialize LSW prefix directories");
+        }
+        
+        // Populate registry with default environment (first run)
+        lsw_reg_populate_environment();
+    }
     
     // Check if file exists
     if (!lsw_fs_path_exists(executable_path)) {
@@ -317,19 +351,22 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Display PE info
-    printf("\n");
-    printf("✅ PE file loaded successfully\n\n");
-    printf("Architecture: %s\n", image.pe.is_64bit ? "x64 (64-bit)" : "x86 (32-bit)");
-    printf("Subsystem: %s\n", 
-           pe_get_subsystem(&image.pe) == PE_SUBSYSTEM_WINDOWS_GUI ? "GUI" :
-           pe_get_subsystem(&image.pe) == PE_SUBSYSTEM_WINDOWS_CUI ? "Console" : "Other");
-    printf("Type: %s\n", pe_is_dll(&image.pe) ? "DLL" : "Executable");
-    printf("Image Base: 0x%llx\n", (unsigned long long)pe_get_image_base(&image.pe));
-    printf("Entry Point: %p (RVA: 0x%08x)\n", image.entry_point, pe_get_entry_point(&image.pe));
-    printf("Image Size: 0x%lx bytes\n", image.image_size);
-    printf("Sections: %u\n", image.pe.num_sections);
-    printf("\n");
+    // Display PE info - on a terminal only: a redirected stdout belongs
+    // to the Windows program (CreateProcess with STARTF_USESTDHANDLES)
+    if (debug_mode || verbose || isatty(STDOUT_FILENO)) {
+        printf("\n");
+        printf("✅ PE file loaded successfully\n\n");
+        printf("Architecture: %s\n", image.pe.is_64bit ? "x64 (64-bit)" : "x86 (32-bit)");
+        printf("Subsystem: %s\n", 
+               pe_get_subsystem(&image.pe) == PE_SUBSYSTEM_WINDOWS_GUI ? "GUI" :
+               pe_get_subsystem(&image.pe) == PE_SUBSYSTEM_WINDOWS_CUI ? "Console" : "Other");
+        printf("Type: %s\n", pe_is_dll(&image.pe) ? "DLL" : "Executable");
+        printf("Image Base: 0x%llx\n", (unsigned long long)pe_get_image_base(&image.pe));
+        printf("Entry Point: %p (RVA: 0x%08x)\n", image.entry_point, pe_get_entry_point(&image.pe));
+        printf("Image Size: 0x%lx bytes\n", image.image_size);
+        printf("Sections: %u\n", image.pe.num_sections);
+        printf("\n");
+    }
     
     // Build PE-specific argc/argv.
     // Convention: LSW flags go between --launch <exe> and a "--" separator.
@@ -372,6 +409,9 @@ int main(int argc, char* argv[]) {
         pe_argv[1] = NULL;
     }
     
+    // CREATE_SUSPENDED: the image is loaded, wait for ResumeThread
+    win32_spawn_wait_resume();
+
     // Execute
     int exit_code = pe_execute(&image, pe_argc, pe_argv);
 
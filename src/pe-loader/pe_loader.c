@@ -12,6 +12,8 @@
 #include "pe-loader/pe_format.h"
 #include "win32-api/win32_api.h"
 #include "win32-api/win32_teb.h"
+#include "win32-api/win32_ftab.h"
+#include "win32-api/win32_fault.h"
 #include "shared/lsw_kernel_client.h"
 #include "lsw_log.h"
 #include <stdio.h>
@@ -213,6 +215,12 @@ static lsw_loaded_dll_t* load_real_dll(const char* dll_name)
             memcpy(dst, src, copy_sz);
         }
 
+        /* Make the DLL's frames unwindable (headers live in file_data) */
+        pe_data_directory_t* exc_dir = pe_get_data_directory(&slot->pe, PE_DIR_EXCEPTION);
+        if (slot->pe.is_64bit && exc_dir && exc_dir->VirtualAddress && exc_dir->Size)
+            win32_ftab_add_image((uint64_t)(uintptr_t)image_base, image_size,
+                                 (uint8_t*)image_base + exc_dir->VirtualAddress, exc_dir->Size);
+
         munmap(file_data, (size_t)file_size);
 
         slot->image_base = image_base;
@@ -285,21 +293,94 @@ void pe_dll_chain_cleanup(void)
 #define WIN_EXCEPTION_STACK_OVERFLOW      0xC00000FD
 #define WIN_EXCEPTION_GUARD_PAGE          0x80000001
 
-// Simple vectored exception handler type (mirrors Windows VEH signature)
-typedef int (*lsw_veh_handler_t)(uint32_t exception_code, void* context);
-
-#define LSW_MAX_VEH_HANDLERS 16
-static lsw_veh_handler_t g_veh_handlers[LSW_MAX_VEH_HANDLERS];
-static int g_veh_count = 0;
+/* --- .NET 8 NativeAOT GC exception interceptors ---
+ *
+ * The NativeAOT GC write-barrier formula computes a card-table address:
+ *   card_offset = (slot_low16 - 0x1000) >> 7  (logical shift, unsigned)
+ *
+ * When a managed slot lives below region+0x1000 (heap_segment header on
+ * Linux is ~0x3e8 bytes, so first object lands at region+0x3e8), the
+ * subtraction wraps to a large positive value.  After shr by 7 the result
+ * is non-canonical (> 0x7fffffffffff on Linux), producing a #GP that the
+ * kernel reports as SIGSEGV.  Non-canonical addresses cannot be mapped, so
+ * we must SKIP the instruction rather than fix the fault address.
+ *
+ * Both are registered for access violations inside the main image only
+ * (win32_fault.c), so other faults never run the pattern checks.
+ * --------------------------------------------------------------- */
+#ifdef __x86_64__
+/* Interceptor 1 — write-barrier card overflow:
+ *   movzbl (%rdi,%rbx,1), %eax  [0F B6 04 1F, 4 bytes]
+ *   RDI is the overflowed card offset (non-canonical).
+ *   Fix: RAX=0 ("card already dirty" → write-barrier fast return), RIP+=4. */
+static int lsw_aot_card_overflow(uint32_t code, siginfo_t* si, ucontext_t* uc, void* ctx) {
+    (void)code; (void)si; (void)ctx;
+    uint64_t rdi = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_RDI];
+    uint64_t rip = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_RIP];
+    const uint8_t *ip = (const uint8_t *)(uintptr_t)rip;
+
+    if (rdi > 0x00007fffffffffffULL &&
+        ip[0] == 0x0f && ip[1] == 0xb6 && ip[2] == 0x04 && ip[3] == 0x1f) {
+        /* Set RAX=0 (AL=0) — the write barrier checks "if AL==0, skip via 'je' to epilogue".
+         * Card byte = 0 means "clean/no-action-needed"; the je skips the card write
+         * at the non-canonical address, jumps directly to the function epilogue. */
+        uc->uc_mcontext.gregs[REG_RAX] = 0;
+        uc->uc_mcontext.gregs[REG_RIP] = (greg_t)(rip + 4);
+        LSW_LOG_DEBUG("write-barrier overflow at 0x%llx (rdi=0x%llx) — skipping card mark",
+                      (unsigned long long)rip, (unsigned long long)rdi);
+        return 1;
+    }
+    return 0;
+}
 
-void lsw_add_veh_handler(lsw_veh_handler_t h) {
-    if (g_veh_count < LSW_MAX_VEH_HANDLERS)
-        g_veh_handlers[g_veh_count++] = h;
+/* Interceptor 2 — GC card-scan secondary null-deref:
+ *   movzbl 0x690(%r10), %eax  [41 0F B6 82 90 06 00 00, 8 bytes]
+ * Fires when GC card scanning reaches unmapped card-table memory.
+ * R10 may be non-null but points past the allocated card-table region.
+ *
+ * The surrounding function (decoded at RVA 0x22c4b1):
+ *   movzbl 0x690(%r10), %eax   ← crash here
+ *   cmp $0xff, %al             ; is card byte 0xff?
+ *   je  step2                  ; if yes → jump (skip heavy path)
+ *   lea 0x8(%rax), %rcx        ; else: compute scan pos from card value
+ *   shl $0x9, %rcx
+ *   add %r9, %rcx              ; rcx = heap_base + computed_offset
+ *   step2: test %rcx, %rcx     ; rcx=0 → nothing to scan
+ *   je   done                  ; → return 0
+ *   movzbl 0x618(%r10), %eax   ← second crash if we reach here
+ *   ...
+ *   done: mov %rcx, %rax ; ret
+ *
+ * Fix: set AL=0xFF → je step2 taken; with RCX forced to 0 the
+ * "test %rcx,%rcx → je done" path fires immediately → function
+ * returns 0 ("no segments to scan"), bypassing both crash sites. */
+static int lsw_aot_card_scan(uint32_t code, siginfo_t* si, ucontext_t* uc, void* ctx) {
+    (void)code; (void)si; (void)ctx;
+    uint64_t rip = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_RIP];
+    uint64_t r10 = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_R10];
+    const uint8_t *ip = (const uint8_t *)(uintptr_t)rip;
+
+    if (ip[0] == 0x41 && ip[1] == 0x0f && ip[2] == 0xb6 &&
+        ip[3] == 0x82 && ip[4] == 0x90 && ip[5] == 0x06 &&
+        ip[6] == 0x00 && ip[7] == 0x00) {
+        uc->uc_mcontext.gregs[REG_RAX] = 0xFF; /* card byte = end-of-list marker */
+        uc->uc_mcontext.gregs[REG_RCX] = 0;    /* no current scan position */
+        uc->uc_mcontext.gregs[REG_RIP] = (greg_t)(rip + 8);
+        LSW_LOG_DEBUG("GC scan fault at 0x%llx (r10=0x%llx) — returning end-of-list",
+                      (unsigned long long)rip, (unsigned long long)r10);
+        return 1;
+    }
+    return 0;
 }
+#endif
 
-// Dispatch an exception through VEH handlers and the SEH chain in the TEB.
+// Dispatch an exception through the registered interceptors, VEH handlers
+// and the SEH chain in the TEB.
 // Returns 1 if handled (execution continues), 0 if unhandled (terminate).
 static int lsw_dispatch_exception(uint32_t code, siginfo_t* si, ucontext_t* uc) {
+    /* Deliberate faults end here: no logging on the fast path */
+    if (win32_fault_dispatch(code, si, uc)) return 1;
+
     LSW_LOG_ERROR("Win32 Exception: code=0x%08x addr=%p", code, si->si_addr);
 #ifdef __x86_64__
     if (uc) {
@@ -320,91 +401,6 @@ static int lsw_dispatch_exception(uint32_t code, siginfo_t* si, ucontext_t* uc)
     }
 #endif
 
-    /* --- .NET 8 NativeAOT GC exception interceptors ---
-     *
-     * The NativeAOT GC write-barrier formula computes a card-table address:
-     *   card_offset = (slot_low16 - 0x1000) >> 7  (logical shift, unsigned)
-     *
-     * When a managed slot lives below region+0x1000 (heap_segment header on
-     * Linux is ~0x3e8 bytes, so first object lands at region+0x3e8), the
-     * subtraction wraps to a large positive value.  After shr by 7 the result
-     * is non-canonical (> 0x7fffffffffff on Linux), producing a #GP that the
-     * kernel reports as SIGSEGV.  Non-canonical addresses cannot be mapped, so
-     * we must SKIP the instruction rather than fix the fault address.
-     *
-     * Interceptor 1 — write-barrier card overflow:
-     *   movzbl (%rdi,%rbx,1), %eax  [0F B6 04 1F, 4 bytes]
-     *   RDI is the overflowed card offset (non-canonical).
-     *   Fix: RAX=0 ("card already dirty" → write-barrier fast return), RIP+=4.
-     *
-     * Interceptor 2 — GC card-scan secondary null-deref:
-     *   movzbl 0x690(%r10), %eax  [41 0F B6 82 90 06 00 00, 8 bytes]
-     *   Occurs during GC scan when the card-table base (R10) is near-null
-     *   because prior card marks were skipped.
-     *   Fix: RAX=0 ("no dirty cards in this range"), RIP+=8.
-     * --------------------------------------------------------------- */
-#ifdef __x86_64__
-    if (code == WIN_EXCEPTION_ACCESS_VIOLATION && uc) {
-        uint64_t rdi = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_RDI];
-        uint64_t rip = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_RIP];
-        const uint8_t *ip = (const uint8_t *)(uintptr_t)rip;
-
-        /* Interceptor 1: write-barrier overflow — non-canonical RDI */
-        if (rdi > 0x00007fffffffffffULL &&
-            ip[0] == 0x0f && ip[1] == 0xb6 && ip[2] == 0x04 && ip[3] == 0x1f) {
-            /* Set RAX=0 (AL=0) — the write barrier checks "if AL==0, skip via 'je' to epilogue".
-             * Card byte = 0 means "clean/no-action-needed"; the je skips the card write
-             * at the non-canonical address, jumps directly to the function epilogue. */
-            uc->uc_mcontext.gregs[REG_RAX] = 0;
-            uc->uc_mcontext.gregs[REG_RIP] = (greg_t)(rip + 4);
-            LSW_LOG_WARN("write-barrier overflow at 0x%llx (rdi=0x%llx) — skipping card mark",
-                         (unsigned long long)rip, (unsigned long long)rdi);
-            return 1;
-        }
-
-        /* Interceptor 2: GC card-scan fault — movzbl 0x690(%r10), %eax
-         * [41 0F B6 82 90 06 00 00, 8 bytes]
-         * Fires when GC card scanning reaches unmapped card-table memory.
-         * R10 may be non-null but points past the allocated card-table region.
-         *
-         * The surrounding function (decoded at RVA 0x22c4b1):
-         *   movzbl 0x690(%r10), %eax   ← crash here
-         *   cmp $0xff, %al             ; is card byte 0xff?
-         *   je  step2                  ; if yes → jump (skip heavy path)
-         *   lea 0x8(%rax), %rcx        ; else: compute scan pos from card value
-         *   shl $0x9, %rcx
-         *   add %r9, %rcx              ; rcx = heap_base + computed_offset
-         *   step2: test %rcx, %rcx     ; rcx=0 → nothing to scan
-         *   je   done                  ; → return 0
-         *   movzbl 0x618(%r10), %eax   ← second crash if we reach here
-         *   ...
-         *   done: mov %rcx, %rax ; ret
-         *
-         * Fix: set AL=0xFF → je step2 taken; with RCX forced to 0 the
-         * "test %rcx,%rcx → je done" path fires immediately → function
-         * returns 0 ("no segments to scan"), bypassing both crash sites. */
-        uint64_t r10 = (uint64_t)(unsigned long long)uc->uc_mcontext.gregs[REG_R10];
-        if (ip[0] == 0x41 && ip[1] == 0x0f && ip[2] == 0xb6 &&
-            ip[3] == 0x82 && ip[4] == 0x90 && ip[5] == 0x06 &&
-            ip[6] == 0x00 && ip[7] == 0x00) {
-            uc->uc_mcontext.gregs[REG_RAX] = 0xFF; /* card byte = end-of-list marker */
-            uc->uc_mcontext.gregs[REG_RCX] = 0;    /* no current scan position */
-            uc->uc_mcontext.gregs[REG_RIP] = (greg_t)(rip + 8);
-            LSW_LOG_WARN("GC scan fault at 0x%llx (r10=0x%llx) — returning end-of-list",
-                         (unsigned long long)rip, (unsigned long long)r10);
-            return 1;
-        }
-    }
-#endif
-
-    // Walk VEH handlers first
-    for (int i = 0; i < g_veh_count; i++) {
-        if (g_veh_handlers[i](code, uc) != 0) {
-            LSW_LOG_INFO("Exception handled by VEH handler %d", i);
-            return 1;
-        }
-    }
-
     // Walk SEH chain from TEB.ExceptionList (gs:0x00)
     win32_teb_t* teb = win32_teb_get();
     if (teb) {
@@ -473,7 +469,16 @@ static void lsw_signal_handler(int sig, siginfo_t* si, void* ctx) {
     }
 }
 
-static void lsw_install_signal_handlers(void) {
+static void lsw_install_signal_handlers(const pe_image_t* image) {
+#ifdef __x86_64__
+    uint64_t begin = (uint64_t)(uintptr_t)image->image_base;
+    uint64_t end   = begin + image->image_size;
+    win32_fault_register(begin, end, WIN_EXCEPTION_ACCESS_VIOLATION, lsw_aot_card_overflow, NULL, NULL);
+    win32_fault_register(begin, end, WIN_EXCEPTION_ACCESS_VIOLATION, lsw_aot_card_scan, NULL, NULL);
+#else
+    (void)image;
+#endif
+
     struct sigaction sa;
     memset(&sa, 0, sizeof(sa));
     sa.sa_sigaction = lsw_signal_handler;
@@ -1305,7 +1310,7 @@ int pe_execute(pe_image_t* image, int argc, char** argv) {
     pe_entry_func_t entry_func = (pe_entry_func_t)image->entry_point;
     
     // Install SEH-emulating signal handlers
-    lsw_install_signal_handlers();
+    lsw_install_signal_handlers(image);
     
     /* Record main thread ID so background thread crashes don't kill the process */
     g_main_thread_id = pthread_self();
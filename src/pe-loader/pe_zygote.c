@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * PE Zygote
+ *
+ * A short-lived CLI tool spends most of its life in loader startup:
+ * reading the configuration, creating the prefix, populating the
+ * registry, building the API tables, mapping the KUSER page, probing
+ * for .NET. None of that depends on the image, so the zygote does it
+ * once and forks. A fork of the zygote is cheap (it has no image
+ * mapped yet) and the child picks up where main() would have been
+ * after that startup.
+ *
+ * One stream connection per launch. The client sends a request header
+ * with its stdio (and a CREATE_SUSPENDED gate) attached as SCM_RIGHTS,
+ * then the payload: working directory, argv and environment as
+ * NUL-terminated strings. The child answers with its PID; the zygote,
+ * which reaps it, sends the wait status and closes the connection.
+ * Only clients of the same user are served.
+ *
+ * The prefix, registry and overlay were set up for the zygote's own
+ * configuration and LSW_OVERLAY. A client whose configuration or
+ * overlay resolves differently is answered with PID 0 and loads the
+ * image itself, so an isolated job never writes into another prefix.
+ */
+
+#define _GNU_SOURCE  /* clearenv, accept4, SO_PEERCRED, signalfd */
+
+#include "pe-loader/pe_zygote.h"
+#include "win32-api/win32_api.h"
+#include "win32-api/win32_env.h"
+#include "win32-api/win32_kuser.h"
+#include "win32-api/win32_spawn.h"
+#include "lsw_config.h"
+#include "lsw_filesystem.h"
+#include "lsw_overlay.h"
+#include "lsw_registry.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+
+extern char** environ;
+
+#define ZY_MAGIC      0x5A57534CU   /* "LSWZ" */
+#define ZY_MAX_FDS    4             /* stdin, stdout, stderr, resume gate */
+#define ZY_MAX_BYTES  (64u << 20)   /* payload sanity limit */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t nfds;
+    uint32_t bytes;                 /* payload: cwd, argv[], envp[] */
+} zy_request_t;
+
+typedef struct {
+    pid_t pid;
+    int   conn;
+} zy_child_t;
+
+// ============================================================================
+// SECTION: Wire
+// ============================================================================
+
+static int zy_send_all(int fd, const void* buf, size_t n) {
+    const char* p = buf;
+    while (n) {
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static int zy_recv_all(int fd, void* buf, size_t n) {
+    char* p = buf;
+    while (n) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+    }
+    return 0;
+}
+
+static int zy_address(const char* path, struct sockaddr_un* sa) {
+    memset(sa, 0, sizeof(*sa));
+    sa->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sa->sun_path)) return -1;
+    strcpy(sa->sun_path, path);
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Server
+// ============================================================================
+
+static zy_child_t* g_children;
+static size_t      g_child_count;
+static size_t      g_child_cap;
+
+/* What the zygote's prefix, registry and overlay were set up for */
+static lsw_config_t g_zy_config;
+static char        g_zy_overlay[LSW_MAX_PATH];
+
+static int zy_listen(const char* path) {
+    struct sockaddr_un sa;
+    if (zy_address(path, &sa) < 0) {
+        LSW_LOG_ERROR("zygote: socket path too long: %s", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    unlink(path);                   /* a stale socket from an earlier zygote */
+    mode_t old = umask(077);
+    int rc = bind(fd, (struct sockaddr*)&sa, sizeof(sa));
+    umask(old);
+    if (rc < 0 || listen(fd, 128) < 0) {
+        LSW_LOG_ERROR("zygote: cannot listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Send each finished child's wait status to its client */
+static void zy_reap(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (size_t i = 0; i < g_child_count; i++) {
+            if (g_children[i].pid != pid) continue;
+            int32_t st = status;
+            zy_send_all(g_children[i].conn, &st, sizeof(st));
+            close(g_children[i].conn);
+            g_children[i] = g_children[--g_child_count];
+            break;
+        }
+    }
+}
+
+/* Child side, in the client's cwd and environment: 1 when its
+ * configuration and overlay are the ones the zygote set up */
+static int zy_same_prefix(void) {
+    lsw_config_t config;
+    char overlay[PATH_MAX] = "";
+    const char* env = getenv("LSW_OVERLAY");
+
+    if (env && env[0] && !realpath(env, overlay)) return 0;
+    if (strcmp(overlay, g_zy_overlay) != 0) return 0;
+    lsw_config_load(&config);
+    return memcmp(&config, &g_zy_config, sizeof(config)) == 0;
+}
+
+/* Child side: take on the client's stdio, cwd, environment and argv */
+static int zy_adopt(int conn, int* argc, char*** argv) {
+    zy_request_t req;
+    int fds[ZY_MAX_FDS];
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } cmsg;
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg.buf;
+    msg.msg_controllen = sizeof(cmsg.buf);
+
+    ssize_t r;
+    while ((r = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR) { }
+    struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    if (r != (ssize_t)sizeof(req) || req.magic != ZY_MAGIC ||
+        req.nfds < 3 || req.nfds > ZY_MAX_FDS || req.bytes > ZY_MAX_BYTES ||
+        !c || c->cmsg_type != SCM_RIGHTS || c->cmsg_len != CMSG_LEN(req.nfds * sizeof(int))) {
+        LSW_LOG_ERROR("zygote: malformed request");
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(c), req.nfds * sizeof(int));
+
+    /* Pointer table and strings in one block; argv/envp live for good */
+    size_t nptr = (size_t)req.argc + 1 + (size_t)req.envc + 1;
+    char** ptr = malloc(nptr * sizeof(char*) + req.bytes + 1);
+    if (!ptr) return -1;
+    char* str = (char*)(ptr + nptr);
+    if (zy_recv_all(conn, str, req.bytes) < 0) return -1;
+    str[req.bytes] = '\0';
+
+    char* p = str;
+    char* end = str + req.bytes;
+    const char* cwd = p;
+    p += strlen(p) + 1;
+    for (size_t i = 0; i < (size_t)req.argc + req.envc; i++) {
+        if (p >= end) {
+            LSW_LOG_ERROR("zygote: truncated request");
+            return -1;
+        }
+        ptr[i < req.argc ? i : i + 1] = p;
+        p += strlen(p) + 1;
+    }
+    ptr[req.argc] = NULL;
+    ptr[nptr - 1] = NULL;
+
+    if (chdir(cwd) != 0)
+        LSW_LOG_WARN("zygote: chdir %s: %s", cwd, strerror(errno));
+
+    clearenv();
+    for (char** e = ptr + req.argc + 1; *e; e++)
+        if (strncmp(*e, WIN32_SPAWN_RESUME_ENV "=", sizeof(WIN32_SPAWN_RESUME_ENV)) != 0)
+            putenv(*e);
+    if (req.nfds > 3) {
+        /* CREATE_SUSPENDED: main() waits on the gate as usual */
+        char num[16];
+        snprintf(num, sizeof(num), "%d", fds[3]);
+        setenv(WIN32_SPAWN_RESUME_ENV, num, 1);
+    }
+
+    /* Checked before taking the client's stdio, so any logging stays ours */
+    if (!zy_same_prefix()) {
+        int32_t declined = 0;
+        zy_send_all(conn, &declined, sizeof(declined));
+        return -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (dup2(fds[i], i) < 0) return -1;
+        close(fds[i]);
+    }
+    win32_env_reload();
+    win32_kuser_fork_child();
+
+    int32_t pid = (int32_t)getpid();
+    if (zy_send_all(conn, &pid, sizeof(pid)) < 0) return -1;
+    close(conn);
+
+    *argc = (int)req.argc;
+    *argv = ptr;
+    return 0;
+}
+
+int pe_zygote_serve(const char* socket_path, int* argc, char*** argv) {
+    if (!socket_path || !*socket_path) {
+        fprintf(stderr, "❌ Error: --zygote requires a socket path\n\n");
+        fprintf(stderr, "Example: lsw --zygote /run/user/1000/lsw.sock\n\n");
+        return 1;
+    }
+
+    /* SIGCHLD reaps, SIGINT/SIGTERM stop the server. Blocked before any
+     * helper thread (the KUSER updater) exists, so they inherit the mask
+     * and the signals reach only the signalfd */
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    /* Everything that does not depend on the image */
+    if (lsw_fs_init_prefix() != LSW_SUCCESS)
+        LSW_LOG_WARN("Failed to initialize LSW prefix directories");
+    lsw_reg_populate_environment();
+    win32_api_init();
+    lsw_config_load(&g_zy_config);
+    snprintf(g_zy_overlay, sizeof(g_zy_overlay), "%s", lsw_overlay_dir() ? lsw_overlay_dir() : "");
+
+    int sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+    int lfd = zy_listen(socket_path);
+    if (sfd < 0 || lfd < 0) {
+        if (sfd >= 0) close(sfd);
+        if (lfd >= 0) close(lfd);
+        pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+        return 1;
+    }
+    LSW_LOG_INFO("zygote: listening on %s (pid %d)", socket_path, (int)getpid());
+
+    for (;;) {
+        struct pollfd pfd[2] = { { sfd, POLLIN, 0 }, { lfd, POLLIN, 0 } };
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfd[0].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            if (read(sfd, &si, sizeof(si)) == (ssize_t)sizeof(si) && si.ssi_signo != SIGCHLD)
+                break;
+            zy_reap();
+        }
+        if (!(pfd[1].revents & POLLIN)) continue;
+
+        int conn = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) continue;
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 || cred.uid != geteuid()) {
+            LSW_LOG_WARN("zygote: refusing a client of another user");
+            close(conn);
+            continue;
+        }
+        if (g_child_count == g_child_cap) {
+            size_t cap = g_child_cap ? g_child_cap * 2 : 16;
+            zy_child_t* grown = realloc(g_children, cap * sizeof(*grown));
+            if (!grown) {
+                close(conn);
+                continue;
+            }
+            g_children = grown;
+            g_child_cap = cap;
+        }
+
+        fflush(NULL);               /* nothing buffered may reach a client */
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            close(sfd);
+            for (size_t i = 0; i < g_child_count; i++) close(g_children[i].conn);
+            free(g_children);
+            g_children = NULL;
+            g_child_count = g_child_cap = 0;
+            pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+            if (zy_adopt(conn, argc, argv) < 0) _exit(127);
+            return PE_ZYGOTE_CHILD;
+        }
+        if (pid < 0) {
+            LSW_LOG_WARN("zygote: fork failed: %s", strerror(errno));
+            close(conn);
+            continue;
+        }
+        g_children[g_child_count++] = (zy_child_t){ pid, conn };
+    }
+
+    LSW_LOG_INFO("zygote: stopping");
+    close(lfd);
+    close(sfd);
+    unlink(socket_path);
+    for (size_t i = 0; i < g_child_count; i++) close(g_children[i].conn);
+    free(g_children);
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Client
+// ============================================================================
+
+static volatile sig_atomic_t g_zy_child;
+
+static void zy_forward(int sig) {
+    if (g_zy_child > 0) kill((pid_t)g_zy_child, sig);
+}
+
+/* Only stdio and the gate travel to the child: a launch that must pass
+ * other inheritable descriptors is loaded locally */
+static int zy_passable(int gate) {
+    DIR* d = opendir("/proc/self/fd");
+    if (!d) return 1;
+    int ok = 1;
+    struct dirent* e;
+    while (ok && (e = readdir(d))) {
+        int fd = atoi(e->d_name);
+        if (fd < 3 || fd == gate || fd == dirfd(d)) continue;
+        int flags = fcntl(fd, F_GETFD);
+        if (flags >= 0 && !(flags & FD_CLOEXEC)) ok = 0;
+    }
+    closedir(d);
+    return ok;
+}
+
+static int zy_connect(const char* path) {
+    struct sockaddr_un sa;
+    if (zy_address(path, &sa) < 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/* cwd, argv and environment, each NUL-terminated; *envc counts what was kept */
+static char* zy_payload(int argc, char** argv, uint32_t* envc, size_t* bytes) {
+    char* cwd = getcwd(NULL, 0);
+    if (!cwd) return NULL;
+    size_t n = strlen(cwd) + 1;
+    for (int i = 0; i < argc; i++) n += strlen(argv[i]) + 1;
+    for (char** e = environ; *e; e++) n += strlen(*e) + 1;
+
+    char* buf = malloc(n);
+    char* p = buf;
+    if (buf) {
+        p = stpcpy(p, cwd) + 1;
+        for (int i = 0; i < argc; i++) p = stpcpy(p, argv[i]) + 1;
+        *envc = 0;
+        for (char** e = environ; *e; e++) {
+            if (strncmp(*e, WIN32_SPAWN_RESUME_ENV "=", sizeof(WIN32_SPAWN_RESUME_ENV)) == 0)
+                continue;
+            p = stpcpy(p, *e) + 1;
+            (*envc)++;
+        }
+        *bytes = (size_t)(p - buf);
+    }
+    free(cwd);
+    return buf;
+}
+
+int pe_zygote_launch(const char* socket_path, int argc, char** argv) {
+    const char* gate_var = getenv(WIN32_SPAWN_RESUME_ENV);
+    int gate = gate_var ? atoi(gate_var) : -1;
+    if (gate >= 0 && fcntl(gate, F_GETFD) < 0) gate = -1;
+    if (!zy_passable(gate)) {
+        LSW_LOG_DEBUG("zygote: inheritable handles present, launching locally");
+        return -1;
+    }
+
+    int sock = zy_connect(socket_path);
+    if (sock < 0) {
+        LSW_LOG_DEBUG("zygote: %s: %s, launching locally", socket_path, strerror(errno));
+        return -1;
+    }
+
+    zy_request_t req = { ZY_MAGIC, (uint32_t)argc, 0, gate >= 0 ? 4 : 3, 0 };
+    size_t bytes = 0;
+    char* payload = zy_payload(argc, argv, &req.envc, &bytes);
+    if (!payload || bytes > ZY_MAX_BYTES) {
+        free(payload);
+        close(sock);
+        return -1;
+    }
+    req.bytes = (uint32_t)bytes;
+
+    /* A closed standard descriptor cannot be sent; the child gets /dev/null */
+    int fds[ZY_MAX_FDS] = { 0, 1, 2, gate };
+    int null_fd = -1;
+    for (int i = 0; i < 3; i++) {
+        if (fcntl(i, F_GETFD) >= 0) continue;
+        if (null_fd < 0) null_fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+        fds[i] = null_fd;
+    }
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } cmsg;
+    memset(&cmsg, 0, sizeof(cmsg));
+    struct iovec iov = { &req, sizeof(req) };
+    struct msghdr msg = { 0 };
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg.buf;
+    msg.msg_controllen = CMSG_SPACE(req.nfds * sizeof(int));
+    struct cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(req.nfds * sizeof(int));
+    memcpy(CMSG_DATA(c), fds, req.nfds * sizeof(int));
+
+    ssize_t sent;
+    while ((sent = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR) { }
+    int ok = sent == (ssize_t)sizeof(req) && zy_send_all(sock, payload, bytes) == 0;
+    free(payload);
+    if (null_fd >= 0) close(null_fd);
+
+    int32_t pid = -1;
+    if (ok && zy_recv_all(sock, &pid, sizeof(pid)) == 0 && pid == 0) {
+        LSW_LOG_DEBUG("zygote: %s serves another prefix or overlay, launching locally", socket_path);
+        close(sock);
+        return -1;
+    }
+    if (!ok || pid <= 0) {
+        /* Nothing of the image ran yet */
+        LSW_LOG_WARN("zygote: %s did not take the launch, launching locally", socket_path);
+        close(sock);
+        return -1;
+    }
+    if (gate >= 0) {
+        /* The child waits on its own copy now */
+        close(gate);
+        unsetenv(WIN32_SPAWN_RESUME_ENV);
+    }
+
+    /* Ctrl-C and friends reach our process group, not the zygote's */
+    g_zy_child = pid;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = zy_forward;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+    sigaction(SIGQUIT, &sa, NULL);
+
+    int32_t status;
+    int got = zy_recv_all(sock, &status, sizeof(status)) == 0;
+    close(sock);
+    if (!got) {
+        LSW_LOG_ERROR("zygote: lost child %d", (int)pid);
+        return 1;
+    }
+    if (WIFSIGNALED(status)) {
+        /* Die the same way, so our parent sees what happened */
+        signal(WTERMSIG(status), SIG_DFL);
+        raise(WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -4,15 +4,22 @@
  * If it's free, it's free. Period.
  */
 
+#define _GNU_SOURCE  /* st_mtim, dirent d_type */
+
 #include "lsw_filesystem.h"
 #include "lsw_config.h"
+#include "lsw_overlay.h"
 #include "lsw_log.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
 
 // Global config (loaded at startup)
 static lsw_config_t g_config;
@@ -26,6 +33,337 @@ static void ensure_config(void) {
     }
 }
 
+// ============================================================================
+// SECTION: Case-Insensitive Resolution
+// ============================================================================
+
+/*
+ * Windows names are case-insensitive, Linux names are not. When a
+ * translated path does not exist as spelled we walk it component by
+ * component and look each missing name up in a cached listing of its
+ * parent directory, keyed by the directory's (dev, ino):
+ *
+ *   folded name -> real name
+ *
+ * A listing is built with one readdir() and stays valid while the
+ * directory's mtime is unchanged. Directories modified within a second
+ * of being scanned are "racy" (mtime granularity may hide a later
+ * change), so a miss in a racy listing rescans once. LSW's own
+ * create/rename/delete paths also drop listings via lsw_fs_invalidate().
+ *
+ * Folding is ASCII-only: it never changes the byte length, so a match
+ * is patched into the path in place. Non-ASCII bytes must match exactly.
+ */
+
+#define FS_DIRCACHE_MAX      512    /* cached directory listings */
+#define FS_DIRCACHE_BUCKETS  1024   /* (dev, ino) hash buckets */
+
+typedef struct {
+    uint32_t hash;      /* 0 = empty slot */
+    uint32_t name;      /* offset of the real name in `names` */
+    uint32_t len;
+} fs_dirent_slot_t;
+
+typedef struct fs_dir {
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    bool racy;
+    uint32_t mask;              /* slots - 1 (power of two) */
+    fs_dirent_slot_t* slots;
+    char* names;                /* NUL-separated real names */
+    struct fs_dir* next;        /* bucket chain */
+} fs_dir_t;
+
+static pthread_mutex_t g_dircache_lock = PTHREAD_MUTEX_INITIALIZER;
+static fs_dir_t* g_dircache_buckets[FS_DIRCACHE_BUCKETS];
+static fs_dir_t* g_dircache_fifo[FS_DIRCACHE_MAX];     /* eviction order */
+static size_t g_dircache_head;
+
+static inline uint32_t fs_fold_hash(const char* s, size_t n) {
+    uint32_t h = 2166136261u;                           /* FNV-1a */
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)tolower((unsigned char)s[i]);
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+static inline size_t fs_dir_bucket(dev_t dev, ino_t ino) {
+    uint64_t k = (uint64_t)ino * 0x9E3779B97F4A7C15ULL ^ (uint64_t)dev;
+    return (size_t)(k >> 32) & (FS_DIRCACHE_BUCKETS - 1);
+}
+
+static bool fs_timespec_eq(const struct timespec* a, const struct timespec* b) {
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+static void fs_dir_free(fs_dir_t* d) {
+    if (!d) return;
+    free(d->slots);
+    free(d->names);
+    free(d);
+}
+
+// Unlink a listing from its bucket (caller holds the lock)
+static void fs_dir_unlink(fs_dir_t* d) {
+    fs_dir_t** pp = &g_dircache_buckets[fs_dir_bucket(d->dev, d->ino)];
+    while (*pp && *pp != d) pp = &(*pp)->next;
+    if (*pp) *pp = d->next;
+}
+
+/*
+ * Read a directory into a fresh listing. Done without the lock held;
+ * the caller publishes the result.
+ */
+static fs_dir_t* fs_dir_scan(const char* path, const struct stat* st) {
+    DIR* dir = opendir(path);
+    if (!dir) return NULL;
+
+    size_t cap = 4096, used = 0, count = 0;
+    char* names = malloc(cap);
+    if (!names) { closedir(dir); return NULL; }
+
+    struct dirent* de;
+    while ((de = readdir(dir)) != NULL) {
+        if (de->d_name[0] == '.' &&
+            (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0'))) {
+            continue;
+        }
+        size_t n = strlen(de->d_name) + 1;
+        if (used + n > cap) {
+            while (used + n > cap) cap *= 2;
+            char* grown = realloc(names, cap);
+            if (!grown) { free(names); closedir(dir); return NULL; }
+            names = grown;
+        }
+        memcpy(names + used, de->d_name, n);
+        used += n;
+        count++;
+    }
+    closedir(dir);
+
+    fs_dir_t* d = calloc(1, sizeof(*d));
+    size_t slots = 8;
+    while (slots < count * 2) slots *= 2;
+    if (d) d->slots = calloc(slots, sizeof(fs_dirent_slot_t));
+    if (!d || !d->slots) { free(names); fs_dir_free(d); return NULL; }
+
+    d->dev = st->st_dev;
+    d->ino = st->st_ino;
+    d->mtime = st->st_mtim;
+    d->racy = time(NULL) - st->st_mtim.tv_sec <= 1;
+    d->mask = (uint32_t)(slots - 1);
+    d->names = names;
+
+    for (size_t off = 0; off < used; ) {
+        size_t n = strlen(names + off);
+        uint32_t h = fs_fold_hash(names + off, n);
+        uint32_t i = h & d->mask;
+        /* On a folded collision (README / readme) the first name wins */
+        while (d->slots[i].hash) i = (i + 1) & d->mask;
+        d->slots[i] = (fs_dirent_slot_t){ h, (uint32_t)off, (uint32_t)n };
+        off += n + 1;
+    }
+    return d;
+}
+
+// Look a component up in a listing; returns the real name or NULL
+static const char* fs_dir_find(const fs_dir_t* d, const char* name, size_t n) {
+    uint32_t h = fs_fold_hash(name, n);
+    for (uint32_t i = h & d->mask; d->slots[i].hash; i = (i + 1) & d->mask) {
+        const fs_dirent_slot_t* e = &d->slots[i];
+        if (e->hash == h && e->len == n && strncasecmp(d->names + e->name, name, n) == 0) {
+            return d->names + e->name;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Resolve one component of directory `dir_path` (already stat'ed into
+ * `st`) case-insensitively, copying the real spelling over `name` on
+ * success. Rescans at most once.
+ */
+static bool fs_dircache_resolve(const char* dir_path, const struct stat* st, char* name, size_t n) {
+    size_t b = fs_dir_bucket(st->st_dev, st->st_ino);
+    bool found = false, rescan = true;
+
+    pthread_mutex_lock(&g_dircache_lock);
+    for (fs_dir_t* d = g_dircache_buckets[b]; d; d = d->next) {
+        if (d->dev != st->st_dev || d->ino != st->st_ino) continue;
+        if (fs_timespec_eq(&d->mtime, &st->st_mtim)) {
+            const char* real = fs_dir_find(d, name, n);
+            if (real) { memcpy(name, real, n); found = true; }
+            rescan = !found && d->racy;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&g_dircache_lock);
+    if (found || !rescan) return found;
+
+    fs_dir_t* fresh = fs_dir_scan(dir_path, st);
+    if (!fresh) return false;
+
+    pthread_mutex_lock(&g_dircache_lock);
+    fs_dir_t* d = g_dircache_buckets[b];
+    while (d && (d->dev != st->st_dev || d->ino != st->st_ino)) d = d->next;
+    if (d) {
+        /* Refresh in place so the FIFO slot stays valid */
+        fs_dir_t* next = d->next;
+        free(d->slots);
+        free(d->names);
+        *d = *fresh;
+        d->next = next;
+        free(fresh);
+    } else {
+        fs_dir_t* victim = g_dircache_fifo[g_dircache_head];
+        if (victim) {
+            fs_dir_unlink(victim);
+            fs_dir_free(victim);
+        }
+        g_dircache_fifo[g_dircache_head] = fresh;
+        g_dircache_head = (g_dircache_head + 1) % FS_DIRCACHE_MAX;
+        fresh->next = g_dircache_buckets[b];
+        g_dircache_buckets[b] = fresh;
+        d = fresh;
+    }
+    const char* real = fs_dir_find(d, name, n);
+    if (real) { memcpy(name, real, n); found = true; }
+    pthread_mutex_unlock(&g_dircache_lock);
+    return found;
+}
+
+/*
+ * Fix the case of every existing component after `linux_path + start`.
+ * One stat per component; listings are only consulted for components
+ * that do not exist as spelled. The first unresolvable component ends
+ * the walk: it and anything below it are left as given so CreateFile /
+ * CreateDirectory can create them.
+ */
+static void fs_resolve_case(char* linux_path, size_t start) {
+    struct stat st;
+    if (stat(linux_path, &st) == 0) return;             /* spelled right */
+
+    /* stat of the directory the current component lives in */
+    char* p = linux_path + start;
+    char saved = *p;
+    *p = '\0';
+    int rc = stat(start ? linux_path : ".", &st);
+    *p = saved;
+    if (rc != 0) return;
+
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        char* end = strchr(p, '/');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+
+        /* Search patterns (FindFirstFile) are not names: nothing to fix */
+        if (memchr(p, '*', n) || memchr(p, '?', n)) return;
+
+        struct stat dir_st = st;
+        saved = p[n];
+        p[n] = '\0';
+        if (stat(linux_path, &st) != 0) {
+            if (!S_ISDIR(dir_st.st_mode)) { p[n] = saved; return; }
+
+            /* Parent is everything before this component */
+            char dir[LSW_MAX_PATH];
+            size_t dlen = (size_t)(p - linux_path);
+            if (dlen >= sizeof(dir)) { p[n] = saved; return; }
+            if (dlen == 0) {
+                strcpy(dir, ".");
+            } else {
+                memcpy(dir, linux_path, dlen);
+                dir[dlen] = '\0';
+            }
+            if (!fs_dircache_resolve(dir, &dir_st, p, n) || stat(linux_path, &st) != 0) {
+                p[n] = saved;
+                return;
+            }
+        }
+        p[n] = saved;
+        if (!end) break;
+        p = end;
+    }
+}
+
+/*
+ * Append one component to a layer path and fix its case there. `st`
+ * holds the stat of the directory on entry and of the component on
+ * success; on failure the buffer is left holding the unresolved name.
+ */
+static bool fs_layer_step(char* path, size_t cap, struct stat* st, const char* name, size_t n) {
+    size_t len = strlen(path);
+    if (len + 1 + n >= cap || !S_ISDIR(st->st_mode)) return false;
+    struct stat dir_st = *st;
+    path[len] = '/';
+    memcpy(path + len + 1, name, n);
+    path[len + 1 + n] = '\0';
+    if (stat(path, st) == 0) return true;
+    path[len] = '\0';
+    bool found = fs_dircache_resolve(path, &dir_st, path + len + 1, n);
+    path[len] = '/';
+    return found && stat(path, st) == 0;
+}
+
+/*
+ * Userspace overlay lookup of `rel` below C:. A name found in the upper
+ * layer wins; otherwise the base is used unless a whiteout in the upper
+ * directory hides it. Names found nowhere map into the upper layer,
+ * spelled like the base where the base has them, so creating them goes
+ * to the right place after lsw_overlay_copy_up.
+ */
+static lsw_status_t fs_overlay_resolve(const char* rel_in, char* linux_path, size_t buffer_size) {
+    const char* upper_root = lsw_overlay_upper_root();
+    const char* lower_root = lsw_overlay_lower_root();
+    char rel[LSW_MAX_PATH], up[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    if (snprintf(rel, sizeof(rel), "%s", rel_in) >= (int)sizeof(rel)) {
+        return LSW_ERROR_INVALID_PARAMETER;
+    }
+    snprintf(up, sizeof(up), "%s", upper_root);
+    snprintf(lo, sizeof(lo), "%s", lower_root);
+
+    struct stat up_st, lo_st;
+    bool up_ok = stat(up, &up_st) == 0;
+    bool lo_ok = stat(lo, &lo_st) == 0;
+    char* p = rel;
+    while (*p && (up_ok || lo_ok)) {
+        while (*p == '/') p++;
+        if (!*p) break;
+        char* end = strchr(p, '/');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (memchr(p, '*', n) || memchr(p, '?', n)) break;
+
+        size_t up_len = strlen(up), lo_len = strlen(lo);
+        bool parent_up = up_ok;
+        if (up_ok) {
+            up_ok = fs_layer_step(up, sizeof(up), &up_st, p, n);
+            if (up_ok) memcpy(p, up + up_len + 1, n);
+        }
+        if (lo_ok) {
+            lo_ok = fs_layer_step(lo, sizeof(lo), &lo_st, p, n);
+            if (lo_ok && parent_up) {
+                up[up_len] = '\0';
+                lo_ok = !lsw_overlay_is_whited_out(up, lo + lo_len + 1);
+                if (up_ok) up[up_len] = '/';
+            }
+            if (lo_ok && !up_ok) memcpy(p, lo + lo_len + 1, n);
+        }
+        p += n;
+    }
+
+    int written;
+    if (up_ok || lo_ok) {
+        /* Everything before p exists in the chosen layer; the rest follows */
+        written = snprintf(linux_path, buffer_size, "%s%s%s", up_ok ? up : lo, *p ? "/" : "", p);
+    } else {
+        written = snprintf(linux_path, buffer_size, "%s/%s", upper_root, rel);
+    }
+    return (written < 0 || (size_t)written >= buffer_size) ? LSW_ERROR_INVALID_PARAMETER : LSW_SUCCESS;
+}
+
 // ============================================================================
 // SECTION: Path Translation
 // ============================================================================
@@ -96,6 +434,7 @@ lsw_status_t lsw_fs_win_to_linux(
         if (pos > 0 && linux_path[pos-1] != '/') {
             linux_path[pos++] = '/';
         }
+        size_t root_len = pos;
         
         // Copy rest of path, converting backslashes to forward slashes
         while (*path_part && pos < buffer_size - 1) {
@@ -107,6 +446,12 @@ lsw_status_t lsw_fs_win_to_linux(
             path_part++;
         }
         linux_path[pos] = '\0';
+
+        // The drive root itself is a Linux path; only names below it fold
+        if (drive == 'C' && lsw_overlay_mode() == LSW_OVERLAY_USERSPACE) {
+            return fs_overlay_resolve(linux_path + root_len, linux_path, buffer_size);
+        }
+        fs_resolve_case(linux_path, root_len);
         
     } else {
         // No drive letter - might be relative path
@@ -116,11 +461,55 @@ lsw_status_t lsw_fs_win_to_linux(
             linux_path[i] = (windows_path[i] == '\\') ? '/' : windows_path[i];
         }
         linux_path[i] = '\0';
+        if (linux_path[0] != '/') {
+            fs_resolve_case(linux_path, 0);
+        }
     }
     
     return LSW_SUCCESS;
 }
 
+/**
+ * Invalidate cached case resolution for a path
+ * 
+ * What: Drop the cached listing of linux_path's parent directory
+ * Why: A create/rename/delete in the same mtime tick is invisible to
+ *      the mtime check
+ * How: stat the parent, unlink its (dev, ino) entry from the cache
+ */
+void lsw_fs_invalidate(const char* linux_path) {
+    if (!linux_path) {
+        return;
+    }
+
+    char dir[LSW_MAX_PATH];
+    const char* slash = strrchr(linux_path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else {
+        size_t n = (slash == linux_path) ? 1 : (size_t)(slash - linux_path);
+        if (n >= sizeof(dir)) return;
+        memcpy(dir, linux_path, n);
+        dir[n] = '\0';
+    }
+
+    struct stat st;
+    if (stat(dir, &st) != 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_dircache_lock);
+    for (fs_dir_t* d = g_dircache_buckets[fs_dir_bucket(st.st_dev, st.st_ino)]; d; d = d->next) {
+        if (d->dev == st.st_dev && d->ino == st.st_ino) {
+            /* Mark stale rather than free: the FIFO still owns it */
+            d->mtime.tv_sec = 0;
+            d->mtime.tv_nsec = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_dircache_lock);
+}
+
 /**
  * Convert Linux path to Windows path
  * 
@@ -143,6 +532,17 @@ lsw_status_t lsw_fs_linux_to_win(
     // Check if path starts with C: drive root
     const char* c_root = g_config.c_drive_root;
     size_t c_root_len = strlen(c_root);
+
+    // Either layer of a userspace overlay is C: as well
+    const char* layers[2] = { lsw_overlay_upper_root(), lsw_overlay_lower_root() };
+    for (int i = 0; i < 2 && strncmp(linux_path, c_root, c_root_len) != 0; i++) {
+        size_t n = layers[i] ? strlen(layers[i]) : 0;
+        if (n && strncmp(linux_path, layers[i], n) == 0 &&
+            (linux_path[n] == '/' || linux_path[n] == '\0')) {
+            c_root = layers[i];
+            c_root_len = n;
+        }
+    }
     
     if (strncmp(linux_path, c_root, c_root_len) == 0) {
         // It's on C: drive
@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ */
+
+#define _GNU_SOURCE  /* unshare, O_TMPFILE, copy_file_range */
+
+#include "lsw_overlay.h"
+#include "lsw_config.h"
+#include "lsw_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <limits.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include <sys/vfs.h>
+
+#define OVERLAYFS_SUPER_MAGIC 0x794c7630
+#define WHITEOUT_PREFIX       ".wh."
+#define WHITEOUT_PREFIX_LEN   4
+
+/* Set in the environment once mounted, so child processes reuse it */
+#define OVERLAY_MOUNT_ENV     "LSW_OVERLAY_MOUNTED"
+
+static pthread_once_t g_ov_once = PTHREAD_ONCE_INIT;
+static bool g_ov_may_mount = false;
+static lsw_overlay_mode_t g_ov_mode = LSW_OVERLAY_OFF;
+static char g_ov_dir[LSW_MAX_PATH];
+static char g_ov_upper[LSW_MAX_PATH];
+static char g_ov_lower[LSW_MAX_PATH];
+static size_t g_ov_upper_len;
+static size_t g_ov_lower_len;
+
+// ============================================================================
+// SECTION: Setup
+// ============================================================================
+
+static int mkdir_p(const char* path, mode_t mode) {
+    char tmp[LSW_MAX_PATH];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, mode) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    return (mkdir(tmp, mode) != 0 && errno != EEXIST) ? -1 : 0;
+}
+
+static bool write_file(const char* path, const char* text) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    ssize_t n = write(fd, text, strlen(text));
+    close(fd);
+    return n == (ssize_t)strlen(text);
+}
+
+/*
+ * Enter a private mount namespace and mount overlayfs over the C: root.
+ * Unprivileged callers get a user namespace mapping their own uid/gid,
+ * which is enough for overlayfs (Linux 5.11+, with "userxattr").
+ */
+static bool ov_mount(const char* work) {
+    /* overlayfs option syntax cannot carry these */
+    if (strpbrk(g_ov_lower, ",:") || strpbrk(g_ov_upper, ",:") || strpbrk(work, ",:")) {
+        return false;
+    }
+
+    uid_t uid = geteuid();
+    gid_t gid = getegid();
+    bool privileged = (uid == 0);
+    if (privileged) {
+        if (unshare(CLONE_NEWNS) != 0) {
+            LSW_LOG_DEBUG("Overlay: unshare(CLONE_NEWNS): %s", strerror(errno));
+            return false;
+        }
+    } else {
+        if (unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) {
+            LSW_LOG_DEBUG("Overlay: user namespace unavailable: %s", strerror(errno));
+            return false;
+        }
+        char map[64];
+        write_file("/proc/self/setgroups", "deny");
+        snprintf(map, sizeof(map), "%u %u 1", (unsigned)uid, (unsigned)uid);
+        if (!write_file("/proc/self/uid_map", map)) return false;
+        snprintf(map, sizeof(map), "%u %u 1", (unsigned)gid, (unsigned)gid);
+        if (!write_file("/proc/self/gid_map", map)) return false;
+    }
+
+    /* Keep the mount out of the parent namespace */
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        LSW_LOG_DEBUG("Overlay: making / private: %s", strerror(errno));
+        return false;
+    }
+
+    char opts[3 * LSW_MAX_PATH + 64];
+    snprintf(opts, sizeof(opts), "lowerdir=%s,upperdir=%s,workdir=%s%s",
+             g_ov_lower, g_ov_upper, work, privileged ? "" : ",userxattr");
+    if (mount("overlay", g_ov_lower, "overlay", 0, opts) == 0) return true;
+    if (!privileged) {
+        /* Kernels before 5.11 have no userxattr */
+        snprintf(opts, sizeof(opts), "lowerdir=%s,upperdir=%s,workdir=%s",
+                 g_ov_lower, g_ov_upper, work);
+        if (mount("overlay", g_ov_lower, "overlay", 0, opts) == 0) return true;
+    }
+    LSW_LOG_DEBUG("Overlay: mount over %s: %s", g_ov_lower, strerror(errno));
+    return false;
+}
+
+static void ov_setup(void) {
+    const char* env = getenv("LSW_OVERLAY");
+    if (!env || !env[0]) return;
+
+    lsw_config_t config;
+    lsw_config_load(&config);
+
+    char work[LSW_MAX_PATH];
+    if (mkdir_p(env, 0755) != 0 || !realpath(env, g_ov_dir) ||
+        mkdir_p(config.c_drive_root, 0755) != 0 || !realpath(config.c_drive_root, g_ov_lower) ||
+        snprintf(g_ov_upper, sizeof(g_ov_upper), "%s/drive_c", g_ov_dir) >= (int)sizeof(g_ov_upper) ||
+        snprintf(work, sizeof(work), "%s/.work", g_ov_dir) >= (int)sizeof(work) ||
+        mkdir_p(g_ov_upper, 0755) != 0 || mkdir_p(work, 0755) != 0) {
+        LSW_LOG_ERROR("Overlay: cannot use %s: %s", env, strerror(errno));
+        g_ov_dir[0] = '\0';
+        return;
+    }
+    if (strcmp(g_ov_lower, "/") == 0) {
+        LSW_LOG_ERROR("Overlay: C: is mapped to /, not layering it");
+        g_ov_dir[0] = '\0';
+        return;
+    }
+    g_ov_upper_len = strlen(g_ov_upper);
+    g_ov_lower_len = strlen(g_ov_lower);
+
+    const char* mounted = getenv(OVERLAY_MOUNT_ENV);
+    struct statfs sfs;
+    if (mounted && strcmp(mounted, g_ov_dir) == 0 &&
+        statfs(g_ov_lower, &sfs) == 0 && sfs.f_type == OVERLAYFS_SUPER_MAGIC) {
+        g_ov_mode = LSW_OVERLAY_KERNEL;                 /* inherited from the parent */
+    } else if (g_ov_may_mount && ov_mount(work)) {
+        g_ov_mode = LSW_OVERLAY_KERNEL;
+        setenv(OVERLAY_MOUNT_ENV, g_ov_dir, 1);
+    } else {
+        g_ov_mode = LSW_OVERLAY_USERSPACE;
+    }
+    LSW_LOG_INFO("Overlay: %s over %s (%s)", g_ov_dir, g_ov_lower,
+                 g_ov_mode == LSW_OVERLAY_KERNEL ? "overlayfs" : "userspace");
+}
+
+lsw_overlay_mode_t lsw_overlay_init(void) {
+    g_ov_may_mount = true;
+    pthread_once(&g_ov_once, ov_setup);
+    return g_ov_mode;
+}
+
+lsw_overlay_mode_t lsw_overlay_mode(void) {
+    pthread_once(&g_ov_once, ov_setup);
+    return g_ov_mode;
+}
+
+const char* lsw_overlay_dir(void) {
+    pthread_once(&g_ov_once, ov_setup);
+    return g_ov_dir[0] ? g_ov_dir : NULL;
+}
+
+const char* lsw_overlay_upper_root(void) {
+    return lsw_overlay_mode() == LSW_OVERLAY_USERSPACE ? g_ov_upper : NULL;
+}
+
+const char* lsw_overlay_lower_root(void) {
+    return lsw_overlay_mode() == LSW_OVERLAY_USERSPACE ? g_ov_lower : NULL;
+}
+
+// ============================================================================
+// SECTION: Layer Paths
+// ============================================================================
+
+/*
+ * Path relative to the C: root it lies under ("" for the root itself),
+ * or NULL outside both layers or when not layering in userspace.
+ */
+static const char* ov_rel(const char* path, bool* in_upper) {
+    if (lsw_overlay_mode() != LSW_OVERLAY_USERSPACE || !path) return NULL;
+    if (strncmp(path, g_ov_upper, g_ov_upper_len) == 0 &&
+        (path[g_ov_upper_len] == '/' || !path[g_ov_upper_len])) {
+        *in_upper = true;
+        path += g_ov_upper_len;
+    } else if (strncmp(path, g_ov_lower, g_ov_lower_len) == 0 &&
+               (path[g_ov_lower_len] == '/' || !path[g_ov_lower_len])) {
+        *in_upper = false;
+        path += g_ov_lower_len;
+    } else {
+        return NULL;
+    }
+    while (*path == '/') path++;
+    return path;
+}
+
+static bool ov_append(char* buf, size_t cap, const char* name, size_t n) {
+    size_t len = strlen(buf);
+    if (len + 1 + n >= cap) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    buf[len] = '/';
+    memcpy(buf + len + 1, name, n);
+    buf[len + 1 + n] = '\0';
+    return true;
+}
+
+bool lsw_overlay_is_whiteout_name(const char* name) {
+    return strncmp(name, WHITEOUT_PREFIX, WHITEOUT_PREFIX_LEN) == 0;
+}
+
+bool lsw_overlay_is_whited_out(const char* upper_dir, const char* name) {
+    char wh[LSW_MAX_PATH];
+    if (snprintf(wh, sizeof(wh), "%s/" WHITEOUT_PREFIX "%s", upper_dir, name) >= (int)sizeof(wh)) {
+        return false;
+    }
+    return access(wh, F_OK) == 0;
+}
+
+/*
+ * Walk the parent components of rel in both layers. up/lo end up as the
+ * parent directory in each layer; *live is false once a whiteout hides
+ * the base. With `create`, upper parents missing but visible in the
+ * base are created; a parent present in neither is ENOENT.
+ */
+static int ov_parents(const char* rel, bool create, char* up, char* lo, bool* live) {
+    snprintf(up, LSW_MAX_PATH, "%s", g_ov_upper);
+    snprintf(lo, LSW_MAX_PATH, "%s", g_ov_lower);
+    *live = true;
+
+    const char* p = rel;
+    const char* slash;
+    while ((slash = strchr(p, '/')) != NULL) {
+        size_t n = (size_t)(slash - p);
+        if (n == 0 || n > NAME_MAX) {
+            p = slash + 1;
+            continue;
+        }
+        char name[NAME_MAX + 1];
+        memcpy(name, p, n);
+        name[n] = '\0';
+        if (*live && lsw_overlay_is_whited_out(up, name)) *live = false;
+        if (!ov_append(up, LSW_MAX_PATH, name, n) || !ov_append(lo, LSW_MAX_PATH, name, n)) return -1;
+
+        struct stat st, lst;
+        if (lstat(up, &st) != 0) {
+            if (!create) {
+                if (!*live || stat(lo, &lst) != 0) {
+                    errno = ENOENT;
+                    return -1;
+                }
+            } else {
+                if (!*live || stat(lo, &lst) != 0 || !S_ISDIR(lst.st_mode)) {
+                    errno = ENOENT;
+                    return -1;
+                }
+                if (mkdir(up, lst.st_mode & 07777) != 0 && errno != EEXIST) return -1;
+            }
+        } else if (!S_ISDIR(st.st_mode)) {
+            errno = ENOTDIR;
+            return -1;
+        }
+        p = slash + 1;
+    }
+    return 0;
+}
+
+static const char* ov_leaf(const char* rel) {
+    const char* slash = strrchr(rel, '/');
+    return slash ? slash + 1 : rel;
+}
+
+// Visible base counterpart of rel; false if missing or whited out
+static bool ov_lower_of(const char* rel, char* lo, struct stat* st) {
+    char up[LSW_MAX_PATH];
+    bool live;
+    if (ov_parents(rel, false, up, lo, &live) != 0 || !live) return false;
+    const char* leaf = ov_leaf(rel);
+    if (*leaf) {
+        if (lsw_overlay_is_whited_out(up, leaf)) return false;
+        if (!ov_append(lo, LSW_MAX_PATH, leaf, strlen(leaf))) return false;
+    }
+    return lstat(lo, st) == 0;
+}
+
+bool lsw_overlay_lower_dir(const char* upper_path, char* out, size_t size) {
+    bool in_upper;
+    const char* rel = ov_rel(upper_path, &in_upper);
+    if (!rel || !in_upper) return false;
+    char lo[LSW_MAX_PATH];
+    struct stat st;
+    if (!ov_lower_of(rel, lo, &st) || !S_ISDIR(st.st_mode)) return false;
+    return snprintf(out, size, "%s", lo) < (int)size;
+}
+
+// ============================================================================
+// SECTION: Copy-up and Whiteouts
+// ============================================================================
+
+static int copy_data(int in, int out) {
+    for (;;) {
+        ssize_t n = copy_file_range(in, NULL, out, NULL, 1 << 30, 0);
+        if (n == 0) return 0;
+        if (n > 0) continue;
+        if (errno == EINTR) continue;
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP) return -1;
+        break;
+    }
+    char buf[65536];
+    for (;;) {
+        ssize_t n = read(in, buf, sizeof(buf));
+        if (n == 0) return 0;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(out, buf + off, (size_t)(n - off));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            off += w;
+        }
+    }
+}
+
+/*
+ * Copy a base entry into the upper layer. Regular files are written to
+ * an O_TMPFILE and linked in complete, so a concurrent reader never
+ * sees a partial copy; losing the race to another copy-up is success.
+ */
+static int ov_copy_entry(const char* lo, const char* up, const char* up_dir, const struct stat* st) {
+    if (S_ISDIR(st->st_mode)) {
+        return (mkdir(up, st->st_mode & 07777) != 0 && errno != EEXIST) ? -1 : 0;
+    }
+    if (S_ISLNK(st->st_mode)) {
+        char target[LSW_MAX_PATH];
+        ssize_t n = readlink(lo, target, sizeof(target) - 1);
+        if (n < 0) return -1;
+        target[n] = '\0';
+        return (symlink(target, up) != 0 && errno != EEXIST) ? -1 : 0;
+    }
+    if (!S_ISREG(st->st_mode)) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+
+    int in = open(lo, O_RDONLY | O_CLOEXEC);
+    if (in < 0) return -1;
+    bool tmpfile = true;
+    int out = open(up_dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, st->st_mode & 07777);
+    if (out < 0) {
+        tmpfile = false;
+        out = open(up, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st->st_mode & 07777);
+        if (out < 0) {
+            int err = errno;
+            close(in);
+            if (err == EEXIST) return 0;
+            errno = err;
+            return -1;
+        }
+    }
+    int rc = copy_data(in, out);
+    int err = errno;
+    close(in);
+    if (rc == 0 && tmpfile) {
+        char proc[64];
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", out);
+        if (linkat(AT_FDCWD, proc, AT_FDCWD, up, AT_SYMLINK_FOLLOW) != 0 && errno != EEXIST) {
+            rc = -1;
+            err = errno;
+        }
+    }
+    close(out);
+    if (rc != 0 && !tmpfile) unlink(up);
+    errno = err;
+    return rc;
+}
+
+static int ov_whiteout(const char* rel) {
+    char up[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    bool live;
+    if (ov_parents(rel, true, up, lo, &live) != 0) return -1;
+    const char* leaf = ov_leaf(rel);
+    char wh[LSW_MAX_PATH];
+    if (snprintf(wh, sizeof(wh), "%s/" WHITEOUT_PREFIX "%s", up, leaf) >= (int)sizeof(wh)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(wh, O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    close(fd);
+    return 0;
+}
+
+int lsw_overlay_copy_up(char* path, size_t size, bool keep_data) {
+    bool in_upper;
+    const char* rel = ov_rel(path, &in_upper);
+    if (!rel) return 0;
+
+    char up[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    bool live;
+    if (ov_parents(rel, true, up, lo, &live) != 0) return -1;
+    const char* leaf = ov_leaf(rel);
+    if (*leaf) {
+        char up_dir[LSW_MAX_PATH];
+        memcpy(up_dir, up, sizeof(up_dir));
+        if (live && lsw_overlay_is_whited_out(up_dir, leaf)) live = false;
+        size_t n = strlen(leaf);
+        if (!ov_append(up, sizeof(up), leaf, n) || !ov_append(lo, sizeof(lo), leaf, n)) return -1;
+
+        struct stat st;
+        if (lstat(up, &st) != 0 && live && lstat(lo, &st) == 0 &&
+            (keep_data || S_ISDIR(st.st_mode))) {
+            if (ov_copy_entry(lo, up, up_dir, &st) != 0) return -1;
+        }
+    }
+    if (snprintf(path, size, "%s", up) >= (int)size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    return 0;
+}
+
+int lsw_overlay_unlink(const char* path) {
+    bool in_upper;
+    const char* rel = ov_rel(path, &in_upper);
+    if (!rel) return unlink(path);
+
+    char lo[LSW_MAX_PATH];
+    struct stat st;
+    if (in_upper) {
+        int rc = unlink(path);
+        if (rc != 0 && errno != ENOENT) return -1;
+        if (!ov_lower_of(rel, lo, &st)) {
+            if (rc != 0) errno = ENOENT;
+            return rc;
+        }
+        if (S_ISDIR(st.st_mode) && rc != 0) {
+            errno = EISDIR;
+            return -1;
+        }
+        return ov_whiteout(rel);
+    }
+    if (lstat(path, &st) != 0) return -1;
+    if (S_ISDIR(st.st_mode)) {
+        errno = EISDIR;
+        return -1;
+    }
+    return ov_whiteout(rel);
+}
+
+/*
+ * True if dir lists anything visible: for an upper dir (upper_dir NULL)
+ * anything but whiteouts, for a base dir anything upper_dir does not
+ * white out.
+ */
+static bool ov_dir_has_entries(const char* dir, const char* upper_dir) {
+    DIR* d = opendir(dir);
+    if (!d) return false;
+    struct dirent* e;
+    bool found = false;
+    while (!found && (e = readdir(d)) != NULL) {
+        if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+        found = upper_dir ? !lsw_overlay_is_whited_out(upper_dir, e->d_name)
+                          : !lsw_overlay_is_whiteout_name(e->d_name);
+    }
+    closedir(d);
+    return found;
+}
+
+int lsw_overlay_rmdir(const char* path) {
+    bool in_upper;
+    const char* rel = ov_rel(path, &in_upper);
+    if (!rel) return rmdir(path);
+    if (!*rel) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    char up[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    struct stat st, lst;
+    bool have_lower = ov_lower_of(rel, lo, &lst);
+    if (snprintf(up, sizeof(up), "%s/%s", g_ov_upper, rel) >= (int)sizeof(up)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    bool have_upper = lstat(up, &st) == 0;
+    if (!have_upper && !have_lower) {
+        errno = ENOENT;
+        return -1;
+    }
+    if ((have_upper && !S_ISDIR(st.st_mode)) || (!have_upper && !S_ISDIR(lst.st_mode))) {
+        errno = ENOTDIR;
+        return -1;
+    }
+    if ((have_upper && ov_dir_has_entries(up, NULL)) ||
+        (have_lower && S_ISDIR(lst.st_mode) && ov_dir_has_entries(lo, have_upper ? up : NULL))) {
+        errno = ENOTEMPTY;
+        return -1;
+    }
+
+    if (have_upper) {
+        /* Only whiteouts are left */
+        DIR* d = opendir(up);
+        if (d) {
+            struct dirent* e;
+            while ((e = readdir(d)) != NULL) {
+                if (lsw_overlay_is_whiteout_name(e->d_name)) unlinkat(dirfd(d), e->d_name, 0);
+            }
+            closedir(d);
+        }
+        if (rmdir(up) != 0) return -1;
+    }
+    return have_lower ? ov_whiteout(rel) : 0;
+}
+
+int lsw_overlay_mkdir(const char* path, mode_t mode) {
+    bool in_upper;
+    const char* rel = ov_rel(path, &in_upper);
+    if (!rel) return mkdir(path, mode);
+
+    char up[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    struct stat st;
+    if (!in_upper || !*rel || ov_lower_of(rel, lo, &st)) {
+        errno = EEXIST;
+        return -1;
+    }
+    bool live;
+    if (ov_parents(rel, true, up, lo, &live) != 0) return -1;
+    const char* leaf = ov_leaf(rel);
+    if (!ov_append(up, sizeof(up), leaf, strlen(leaf))) return -1;
+    /* A whiteout left beside the new directory keeps base contents hidden */
+    return mkdir(up, mode);
+}
+
+int lsw_overlay_rename(const char* old_path, const char* new_path) {
+    bool old_upper = false, new_upper = false;
+    const char* old_rel = ov_rel(old_path, &old_upper);
+    const char* new_rel = ov_rel(new_path, &new_upper);
+    if (!old_rel && !new_rel) return rename(old_path, new_path);
+
+    char src[LSW_MAX_PATH], dst[LSW_MAX_PATH], lo[LSW_MAX_PATH];
+    struct stat st;
+    bool had_lower = false;
+    snprintf(src, sizeof(src), "%s", old_path);
+    if (old_rel) {
+        if (!*old_rel) {
+            errno = EBUSY;
+            return -1;
+        }
+        had_lower = ov_lower_of(old_rel, lo, &st);
+        /* Directories with base contents cannot move (overlayfs: EXDEV) */
+        if (had_lower && S_ISDIR(st.st_mode)) {
+            errno = EXDEV;
+            return -1;
+        }
+        if (!old_upper) {
+            if (!new_rel) {
+                errno = EXDEV;
+                return -1;
+            }
+            if (lsw_overlay_copy_up(src, sizeof(src), true) != 0) return -1;
+        }
+    }
+    snprintf(dst, sizeof(dst), "%s", new_path);
+    if (new_rel && lsw_overlay_copy_up(dst, sizeof(dst), false) != 0) return -1;
+
+    if (rename(src, dst) != 0) return -1;
+    return had_lower ? ov_whiteout(old_rel) : 0;
+}
@@ -87,6 +87,22 @@ int lsw_kernel_get_status(int fd)
     return status;
 }
 
+int lsw_kernel_get_stats(int fd, struct lsw_stats *stats)
+{
+    if (fd < 0 || !stats) {
+        LSW_LOG_ERROR("Invalid arguments to lsw_kernel_get_stats");
+        return -1;
+    }
+    
+    int ret = ioctl(fd, LSW_IOCTL_GET_STATS, stats);
+    if (ret < 0) {
+        LSW_LOG_ERROR("Failed to get kernel stats: %s", strerror(errno));
+        return -1;
+    }
+    
+    return 0;
+}
+
 int lsw_kernel_execute_pe(int fd, pid_t pid)
 {
     if (fd < 0) {
@@ -105,3 +121,25 @@ int lsw_kernel_execute_pe(int fd, pid_t pid)
     LSW_LOG_INFO("PE execution completed: PID=%u, exit_code=%d", pid, ret);
     return ret;
 }
+
+int lsw_kernel_trap_nt_syscalls(int fd, uint64_t start, uint64_t end)
+{
+    if (fd < 0) {
+        LSW_LOG_ERROR("Invalid file descriptor");
+        return -1;
+    }
+    
+    struct lsw_nt_trap trap;
+    memset(&trap, 0, sizeof(trap));
+    trap.start = start;
+    trap.end = end;
+    trap.fd = fd;
+    
+    int ret = ioctl(fd, LSW_IOCTL_TRAP_NT_SYSCALLS, &trap);
+    if (ret < 0) {
+        LSW_LOG_ERROR("Failed to trap NT syscalls: %s", strerror(errno));
+        return -1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Userspace Kernel Interface
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Userspace side of the /dev/lsw syscall ring
+ */
+
+#include "shared/lsw_kernel_ring.h"
+#include "shared/lsw_log.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+int lsw_kernel_ring_init(int fd, uint32_t entries, struct lsw_kernel_ring* ring)
+{
+    struct lsw_ring_params params;
+
+    if (fd < 0 || !ring) {
+        LSW_LOG_ERROR("Invalid arguments to lsw_kernel_ring_init");
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    params.entries = entries;
+
+    if (ioctl(fd, LSW_IOCTL_RING_SETUP, &params) < 0) {
+        LSW_LOG_ERROR("Failed to set up kernel ring: %s", strerror(errno));
+        return -1;
+    }
+
+    ring->map = mmap(NULL, params.map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring->map == MAP_FAILED) {
+        LSW_LOG_ERROR("Failed to map kernel ring: %s", strerror(errno));
+        ring->map = NULL;
+        return -1;
+    }
+
+    ring->fd = fd;
+    ring->map_size = params.map_size;
+    ring->hdr = ring->map;
+    ring->sqes = (struct lsw_ring_sqe*)((char*)ring->map + params.sq_offset);
+    ring->cqes = (struct lsw_ring_cqe*)((char*)ring->map + params.cq_offset);
+    ring->mask = params.entries - 1;
+    ring->sq_tail = ring->hdr->sq_tail;
+
+    LSW_LOG_INFO("Kernel ring mapped: %u entries", params.entries);
+    return 0;
+}
+
+void lsw_kernel_ring_exit(struct lsw_kernel_ring* ring)
+{
+    if (ring && ring->map) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+}
+
+struct lsw_ring_sqe* lsw_kernel_ring_get_sqe(struct lsw_kernel_ring* ring)
+{
+    struct lsw_ring_sqe* sqe;
+    uint32_t head = __atomic_load_n(&ring->hdr->sq_head, __ATOMIC_ACQUIRE);
+
+    if (ring->sq_tail - head > ring->mask) {
+        return NULL;
+    }
+
+    sqe = &ring->sqes[ring->sq_tail & ring->mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_tail++;
+    return sqe;
+}
+
+int lsw_kernel_ring_submit(struct lsw_kernel_ring* ring)
+{
+    uint32_t pending;
+    int ret;
+
+    /* Entries are written before the kernel can see the new tail */
+    __atomic_store_n(&ring->hdr->sq_tail, ring->sq_tail, __ATOMIC_RELEASE);
+
+    /* Includes entries a full completion queue held back last time */
+    pending = ring->sq_tail - __atomic_load_n(&ring->hdr->sq_head, __ATOMIC_ACQUIRE);
+
+    if (pending == 0) {
+        return 0;
+    }
+
+    ret = ioctl(ring->fd, LSW_IOCTL_RING_ENTER, (unsigned long)pending);
+    if (ret < 0) {
+        LSW_LOG_ERROR("Kernel ring enter failed: %s", strerror(errno));
+        return -1;
+    }
+    return ret;
+}
+
+struct lsw_ring_cqe* lsw_kernel_ring_peek_cqe(struct lsw_kernel_ring* ring)
+{
+    uint32_t head = ring->hdr->cq_head;
+    uint32_t tail = __atomic_load_n(&ring->hdr->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return NULL;
+    }
+    return &ring->cqes[head & ring->mask];
+}
+
+void lsw_kernel_ring_cqe_seen(struct lsw_kernel_ring* ring)
+{
+    /* The slot is read before the kernel may reuse it */
+    __atomic_store_n(&ring->hdr->cq_head, ring->hdr->cq_head + 1, __ATOMIC_RELEASE);
+}
@@ -4,17 +4,26 @@
  * If it's free, it's free. Period.
  */
 
+#define _GNU_SOURCE  /* pthread_rwlock_t, strndup */
+
 #include "lsw_registry.h"
 #include "lsw_config.h"
+#include "lsw_overlay.h"
 #include "lsw_log.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stddef.h>
 
 // ============================================================================
 // SECTION: Registry Storage Structure
@@ -22,32 +31,161 @@
 
 /*
  * Registry Storage Design:
- * 
- * What: Simple file-based key/value storage
- * Why: Don't need complex database for registry
- * How: Each key is a directory, each value is a file
- * 
- * Example:
- *   HKLM\Software\MyApp\Version = "1.0"
- *   
- *   Stored as:
+ *
+ * What: One hive file per root, mmap'd, plus an append-only journal
+ * Why: A file per value cost a path build, fopen, two freads and fclose
+ *      per query and a stat per open; apps read hundreds of values at
+ *      startup
+ * How: Queries are answered from an in-memory index, with no syscalls
+ *
  *   ~/.local/share/lsw/registry/
- *     HKLM/
- *       Software/
- *         MyApp/
- *           Version.value     (contains "1.0")
- *           Version.type      (contains type info)
+ *     HKLM.hive      snapshot: header + records, mapped read-only and
+ *                    never modified in place
+ *     HKLM.journal   page 0: control block shared by every process
+ *                    (generation, committed length); then records
+ *                    appended by writers under flock
+ *
+ * Index: a hash of key paths per hive; per key a sorted subkey array
+ * and a value array (hashed by name past VALUE_HASH_MIN entries).
+ * Names and data from the snapshot are referenced in place.
+ *
+ * Compaction writes a new snapshot beside the old one, fsyncs it,
+ * renames it into place and resets the journal, bumping the generation
+ * so other processes remap. Replaying a journal over a snapshot that
+ * already contains it is harmless, so a crash between the rename and
+ * the reset loses nothing. Torn journal tails fail their CRC and are cut.
+ *
+ * The journal is fdatasync'd on lsw_reg_flush (RegFlushKey) and at
+ * compaction; like Windows, plain writes are flushed lazily.
+ *
+ * Change notifications (RegNotifyChangeKeyValue) are matched as journal
+ * records are applied, whether written here or replayed from another
+ * process. A notifier thread watches the journals with inotify so other
+ * processes' writes are picked up without waiting for the next access.
+ *
+ * Under LSW_OVERLAY the hives live in <overlay>/registry and the
+ * configured registry is a read-only base: a hive missing from the
+ * overlay is seeded from it on first use by hard-linking the immutable
+ * snapshot and copying the committed journal tail.
  */
 
+#define HIVE_MAGIC       "LSWHIVE"
+#define JOURNAL_MAGIC    "LSWJRNL"
+#define STORE_VERSION    1
+#define HIVE_DATA        64               /* snapshot records start here */
+#define JOURNAL_DATA     4096             /* journal records follow the control page */
+#define COMPACT_MIN      (1u << 20)       /* journal bytes before compaction is considered */
+#define VALUE_HASH_MIN   16               /* values per key before the name hash is built */
+#define HIVE_COUNT       5
+
+enum { REC_KEY = 1, REC_VALUE, REC_DEL_VALUE, REC_DEL_KEY };
+#define REC_SAME_KEY 0x01                 /* applies to the key of the previous record */
+
+/* On-disk record: header, key path\0, value name\0, data, padded to 8 */
+typedef struct {
+    uint32_t crc;                         /* CRC32C of the record after this field */
+    uint32_t size;
+    uint8_t  op;
+    uint8_t  flags;
+    uint16_t key_len;
+    uint16_t name_len;
+    uint16_t reserved;
+    uint32_t type;
+    uint32_t data_len;
+} rec_hdr_t;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t length;                      /* record bytes after HIVE_DATA */
+    uint64_t keys;
+    uint64_t values;
+} hive_hdr_t;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t gen;                         /* bumped whenever the snapshot is replaced */
+    uint64_t end;                         /* committed journal length */
+} journal_ctl_t;
+
+typedef struct {
+    const char*    name;
+    const uint8_t* data;
+    uint32_t       hash;
+    uint32_t       type;
+    uint32_t       len;
+    uint8_t        name_owned;            /* on the heap rather than in the snapshot */
+    uint8_t        data_owned;
+} reg_value_t;
+
+typedef struct reg_key {
+    const char*      path;                /* canonical, '\'-separated; "" for the root */
+    const char*      name;                /* last component of path */
+    uint32_t         path_len;
+    uint32_t         hash;                /* of the case-folded path */
+    uint8_t          path_owned;
+    struct reg_key*  parent;
+    struct reg_key*  next;                /* hash chain */
+    struct reg_key** kids;                /* sorted by name, case-insensitive */
+    uint32_t         nkids, capkids;
+    reg_value_t*     vals;                /* insertion order, like Windows */
+    uint32_t         nvals, capvals;
+    uint32_t*        vidx;                /* name hash -> vals index + 1 */
+    uint32_t         vidx_cap;
+} reg_key_t;
+
+typedef struct {
+    bool           loaded;
+    int            jfd;
+    journal_ctl_t* ctl;                   /* MAP_SHARED over journal page 0 */
+    uint64_t       gen;                   /* ctl->gen / ctl->end this index reflects */
+    uint64_t       applied;
+    uint8_t*       snap;
+    size_t         snap_len;
+    reg_key_t*     root;
+    reg_key_t**    table;
+    size_t         cap, count;
+    bool           dirty;                 /* journal written since the last fdatasync */
+} reg_hive_t;
+
 // Registry handle structure
 typedef struct {
-    char path[LSW_MAX_PATH];  // Filesystem path to this key
-    bool is_open;
+    bool    is_open;
+    uint8_t hive;                         /* lsw_hkey_t */
+    char    path[LSW_MAX_PATH];           /* canonical key path within the hive */
 } lsw_reg_handle_t;
 
 // Handle table (simple for now)
 #define MAX_HANDLES 256
 static lsw_reg_handle_t g_handles[MAX_HANDLES];
+static pthread_mutex_t g_handle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* A pending lsw_reg_notify; one-shot */
+typedef struct reg_watch {
+    struct reg_watch* next;
+    HANDLE            handle;             /* registry handle it was armed on */
+    uint8_t           hive;
+    bool              subtree;
+    uint32_t          filter;
+    lsw_reg_notify_fn fn;
+    void*             ctx;
+    char              path[];             /* canonical key path */
+} reg_watch_t;
+
+static reg_hive_t g_hives[HIVE_COUNT];
+static reg_watch_t* g_watches;             /* g_reg_lock held for writing */
+static int g_watch_count;                  /* atomic: skips matching when zero */
+static int g_notify_fd = -1;               /* inotify on the journals */
+static int g_notify_wd[HIVE_COUNT];
+static pthread_once_t g_notify_once = PTHREAD_ONCE_INIT;
+static pthread_rwlock_t g_reg_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_once_t g_reg_once = PTHREAD_ONCE_INIT;
+static char g_reg_base[LSW_MAX_PATH];
+static char g_reg_lower[LSW_MAX_PATH];     /* overlay base registry, or "" */
+static uint32_t g_crc_table[256];
 static bool g_registry_initialized = false;
 
 // ============================================================================
@@ -56,7 +194,7 @@ static bool g_registry_initialized = false;
 
 /**
  * Get hkey name
- * 
+ *
  * What: Convert hkey enum to string
  * Why: Build filesystem paths
  * How: Switch on enum
@@ -72,60 +210,87 @@ static const char* hkey_to_string(lsw_hkey_t hkey) {
     }
 }
 
+/**
+ * Canonicalize key path
+ *
+ * What: "\\Software\\\\MyApp\\" -> "Software\\MyApp"
+ * Why: The index is keyed by canonical paths
+ * How: Drop leading, trailing and repeated backslashes
+ *
+ * Returns the length, or -1 if it does not fit.
+ */
+static int path_canon(const char* subkey, char* out, size_t cap) {
+    size_t n = 0;
+    for (const char* p = subkey ? subkey : ""; *p; p++) {
+        if (*p == '\\') {
+            if (n == 0 || out[n - 1] == '\\') continue;
+        }
+        if (n + 1 >= cap) return -1;
+        out[n++] = *p;
+    }
+    while (n > 0 && out[n - 1] == '\\') n--;
+    out[n] = '\0';
+    return (int)n;
+}
+
 /**
  * Allocate handle
- * 
+ *
  * What: Find free handle slot
  * Why: Track open keys
  * How: Linear search through handle table
  */
-static HANDLE alloc_handle(const char* path) {
+static HANDLE alloc_handle(lsw_hkey_t hive, const char* path) {
+    pthread_mutex_lock(&g_handle_lock);
     for (int i = 0; i < MAX_HANDLES; i++) {
         if (!g_handles[i].is_open) {
             g_handles[i].is_open = true;
+            g_handles[i].hive = (uint8_t)hive;
             strncpy(g_handles[i].path, path, sizeof(g_handles[i].path) - 1);
             g_handles[i].path[sizeof(g_handles[i].path) - 1] = '\0';
+            pthread_mutex_unlock(&g_handle_lock);
             return (HANDLE)(intptr_t)(i + 1);  // Handle 0 is invalid
         }
     }
+    pthread_mutex_unlock(&g_handle_lock);
     return NULL;  // No free handles
 }
 
 /**
  * Get handle
- * 
+ *
  * What: Look up handle structure
  * Why: Access handle data
  * How: Convert handle to index
  */
 static lsw_reg_handle_t* get_handle(HANDLE handle) {
     if (!handle) return NULL;
-    
+
     int index = (int)(intptr_t)handle - 1;
     if (index < 0 || index >= MAX_HANDLES) return NULL;
     if (!g_handles[index].is_open) return NULL;
-    
+
     return &g_handles[index];
 }
 
 /**
  * Create directory recursively
- * 
+ *
  * What: mkdir -p functionality
- * Why: Registry keys are nested
+ * Why: The registry directory may not exist yet
  * How: Create parent dirs first
  */
 static lsw_status_t mkdir_recursive(const char* path) {
     char tmp[LSW_MAX_PATH];
     char* p;
     size_t len = strlen(path);
-    
+
     if (len >= sizeof(tmp)) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     strncpy(tmp, path, sizeof(tmp));
-    
+
     // Create each directory in path
     for (p = tmp + 1; *p; p++) {
         if (*p == '/') {
@@ -134,63 +299,1014 @@ static lsw_status_t mkdir_recursive(const char* path) {
             *p = '/';
         }
     }
-    
+
     if (mkdir(tmp, 0755) != 0 && errno != EEXIST) {
         LSW_LOG_ERROR("Failed to create directory: %s", tmp);
         return LSW_ERROR_REGISTRY_ERROR;
     }
-    
+
+    return LSW_SUCCESS;
+}
+
+// ============================================================================
+// SECTION: Hashing
+// ============================================================================
+
+static inline char fold_ascii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+}
+
+// FNV-1a over ASCII-folded bytes: registry names are case-insensitive
+static uint32_t hash_fold(const char* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)fold_ascii(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int cmp_fold(const char* a, const char* b) {
+    for (;; a++, b++) {
+        int d = (uint8_t)fold_ascii(*a) - (uint8_t)fold_ascii(*b);
+        if (d || !*a) return d;
+    }
+}
+
+static bool eq_fold_n(const char* a, const char* b, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (fold_ascii(a[i]) != fold_ascii(b[i])) return false;
+    }
+    return true;
+}
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+        g_crc_table[i] = c;
+    }
+}
+
+// CRC32C (Castagnoli)
+static uint32_t crc32c(const void* buf, size_t n) {
+    const uint8_t* p = buf;
+    uint32_t c = 0xFFFFFFFFu;
+    while (n--) c = g_crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+// ============================================================================
+// SECTION: Index
+// ============================================================================
+
+static reg_key_t* key_find(reg_hive_t* h, const char* path, size_t len) {
+    if (!h->table) return NULL;
+    uint32_t hv = hash_fold(path, len);
+    for (reg_key_t* k = h->table[hv & (h->cap - 1)]; k; k = k->next) {
+        if (k->hash == hv && k->path_len == len && eq_fold_n(k->path, path, len)) return k;
+    }
+    return NULL;
+}
+
+static void key_hash_insert(reg_hive_t* h, reg_key_t* k) {
+    if (h->count + 1 > h->cap) {
+        size_t cap = h->cap ? h->cap * 2 : 256;
+        reg_key_t** t = calloc(cap, sizeof(*t));
+        if (!t) return;                   /* keep the old table: longer chains only */
+        for (size_t i = 0; i < h->cap; i++) {
+            reg_key_t* e = h->table[i];
+            while (e) {
+                reg_key_t* n = e->next;
+                e->next = t[e->hash & (cap - 1)];
+                t[e->hash & (cap - 1)] = e;
+                e = n;
+            }
+        }
+        free(h->table);
+        h->table = t;
+        h->cap = cap;
+    }
+    reg_key_t** slot = &h->table[k->hash & (h->cap - 1)];
+    k->next = *slot;
+    *slot = k;
+    h->count++;
+}
+
+// Position of `name` in the sorted subkey array (insertion point if absent)
+static uint32_t key_kid_pos(const reg_key_t* k, const char* name, bool* found) {
+    uint32_t lo = 0, hi = k->nkids;
+    *found = false;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int c = cmp_fold(k->kids[mid]->name, name);
+        if (c == 0) { *found = true; return mid; }
+        if (c < 0) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * Find or create the key at `path` (canonical), creating ancestors.
+ * `stored` is a NUL-terminated copy of the path that outlives the index
+ * (the snapshot mapping); without one the path is duplicated.
+ */
+static reg_key_t* key_create(reg_hive_t* h, const char* path, size_t len, const char* stored) {
+    reg_key_t* k = key_find(h, path, len);
+    if (k) return k;
+
+    reg_key_t* parent = NULL;
+    if (len > 0) {
+        size_t plen = len;
+        while (plen > 0 && path[plen - 1] != '\\') plen--;
+        parent = key_create(h, path, plen ? plen - 1 : 0, NULL);
+        if (!parent) return NULL;
+    }
+
+    k = calloc(1, sizeof(*k));
+    if (!k) return NULL;
+    if (stored) {
+        k->path = stored;
+    } else {
+        char* copy = strndup(path, len);
+        if (!copy) { free(k); return NULL; }
+        k->path = copy;
+        k->path_owned = 1;
+    }
+    k->path_len = (uint32_t)len;
+    k->hash = hash_fold(path, len);
+    const char* slash = memrchr(k->path, '\\', len);
+    k->name = slash ? slash + 1 : k->path;
+    k->parent = parent;
+
+    if (parent) {
+        if (parent->nkids == parent->capkids) {
+            uint32_t cap = parent->capkids ? parent->capkids * 2 : 4;
+            reg_key_t** kids = realloc(parent->kids, cap * sizeof(*kids));
+            if (!kids) {
+                if (k->path_owned) free((char*)k->path);
+                free(k);
+                return NULL;
+            }
+            parent->kids = kids;
+            parent->capkids = cap;
+        }
+        bool found;
+        uint32_t pos = key_kid_pos(parent, k->name, &found);
+        memmove(&parent->kids[pos + 1], &parent->kids[pos], (parent->nkids - pos) * sizeof(*parent->kids));
+        parent->kids[pos] = k;
+        parent->nkids++;
+    } else {
+        h->root = k;
+    }
+    key_hash_insert(h, k);
+    return k;
+}
+
+static void value_release(reg_value_t* v) {
+    if (v->name_owned) free((char*)v->name);
+    if (v->data_owned) free((uint8_t*)v->data);
+}
+
+// Remove `k` and its subtree from the index
+static void key_destroy(reg_hive_t* h, reg_key_t* k) {
+    while (k->nkids) key_destroy(h, k->kids[k->nkids - 1]);
+
+    reg_key_t** pp = &h->table[k->hash & (h->cap - 1)];
+    while (*pp && *pp != k) pp = &(*pp)->next;
+    if (*pp) { *pp = k->next; h->count--; }
+
+    if (k->parent) {
+        bool found;
+        uint32_t pos = key_kid_pos(k->parent, k->name, &found);
+        if (found) {
+            reg_key_t* p = k->parent;
+            memmove(&p->kids[pos], &p->kids[pos + 1], (p->nkids - pos - 1) * sizeof(*p->kids));
+            p->nkids--;
+        }
+    } else if (h->root == k) {
+        h->root = NULL;
+    }
+
+    for (uint32_t i = 0; i < k->nvals; i++) value_release(&k->vals[i]);
+    free(k->vals);
+    free(k->vidx);
+    free(k->kids);
+    if (k->path_owned) free((char*)k->path);
+    free(k);
+}
+
+static void value_index_rebuild(reg_key_t* k) {
+    free(k->vidx);
+    k->vidx = NULL;
+    k->vidx_cap = 0;
+    if (k->nvals < VALUE_HASH_MIN) return;
+    uint32_t cap = 32;
+    while (cap < k->nvals * 2) cap *= 2;
+    k->vidx = calloc(cap, sizeof(*k->vidx));
+    if (!k->vidx) return;                 /* linear scan still works */
+    k->vidx_cap = cap;
+    for (uint32_t i = 0; i < k->nvals; i++) {
+        uint32_t s = k->vals[i].hash & (cap - 1);
+        while (k->vidx[s]) s = (s + 1) & (cap - 1);
+        k->vidx[s] = i + 1;
+    }
+}
+
+static int value_find(const reg_key_t* k, const char* name) {
+    size_t n = strlen(name);
+    uint32_t hv = hash_fold(name, n);
+    if (k->vidx) {
+        for (uint32_t s = hv & (k->vidx_cap - 1); k->vidx[s]; s = (s + 1) & (k->vidx_cap - 1)) {
+            const reg_value_t* v = &k->vals[k->vidx[s] - 1];
+            if (v->hash == hv && cmp_fold(v->name, name) == 0) return (int)(k->vidx[s] - 1);
+        }
+        return -1;
+    }
+    for (uint32_t i = 0; i < k->nvals; i++) {
+        if (k->vals[i].hash == hv && cmp_fold(k->vals[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/*
+ * Set a value. `in_place` name/data live in the snapshot mapping;
+ * otherwise they are copied.
+ */
+static bool value_put(reg_key_t* k, const char* name, uint32_t type,
+                      const uint8_t* data, uint32_t len, bool in_place) {
+    uint8_t* copy = NULL;
+    if (!in_place && len) {
+        copy = malloc(len);
+        if (!copy) return false;
+        memcpy(copy, data, len);
+    }
+
+    int i = value_find(k, name);
+    if (i >= 0) {
+        reg_value_t* v = &k->vals[i];
+        if (v->data_owned) free((uint8_t*)v->data);
+        v->data = in_place ? data : copy;
+        v->data_owned = !in_place && len;
+        v->type = type;
+        v->len = len;
+        return true;
+    }
+
+    if (k->nvals == k->capvals) {
+        uint32_t cap = k->capvals ? k->capvals * 2 : 4;
+        reg_value_t* vals = realloc(k->vals, cap * sizeof(*vals));
+        if (!vals) { free(copy); return false; }
+        k->vals = vals;
+        k->capvals = cap;
+    }
+    reg_value_t* v = &k->vals[k->nvals];
+    memset(v, 0, sizeof(*v));
+    if (in_place) {
+        v->name = name;
+    } else {
+        char* n = strdup(name);
+        if (!n) { free(copy); return false; }
+        v->name = n;
+        v->name_owned = 1;
+    }
+    v->hash = hash_fold(name, strlen(name));
+    v->data = in_place ? data : copy;
+    v->data_owned = !in_place && len;
+    v->type = type;
+    v->len = len;
+    k->nvals++;
+
+    if (k->nvals >= VALUE_HASH_MIN && k->nvals * 2 > k->vidx_cap) {
+        value_index_rebuild(k);
+    } else if (k->vidx) {
+        uint32_t s = v->hash & (k->vidx_cap - 1);
+        while (k->vidx[s]) s = (s + 1) & (k->vidx_cap - 1);
+        k->vidx[s] = k->nvals;
+    }
+    return true;
+}
+
+static void value_remove(reg_key_t* k, int i) {
+    value_release(&k->vals[i]);
+    memmove(&k->vals[i], &k->vals[i + 1], (k->nvals - (uint32_t)i - 1) * sizeof(*k->vals));
+    k->nvals--;
+    if (k->vidx) value_index_rebuild(k);
+}
+
+// ============================================================================
+// SECTION: Change Notification
+// ============================================================================
+
+// `p` is `w` or below it
+static bool path_within(const char* p, size_t plen, const char* w, size_t wlen) {
+    if (wlen == 0) return true;
+    if (plen < wlen || !eq_fold_n(p, w, wlen)) return false;
+    return plen == wlen || p[wlen] == '\\';
+}
+
+// Unlink `*pp`, run its callback and free it
+static void watch_fire(reg_watch_t** pp) {
+    reg_watch_t* w = *pp;
+    *pp = w->next;
+    __atomic_sub_fetch(&g_watch_count, 1, __ATOMIC_RELEASE);
+    w->fn(w->ctx);
+    free(w);
+}
+
+/*
+ * Key `path` changed in the way `bit` describes; `deleted` additionally
+ * fires every watch on or below it
+ */
+static void watch_notify(reg_hive_t* h, uint32_t bit, const char* path, size_t len, bool deleted) {
+    uint8_t hive = (uint8_t)(h - g_hives);
+    size_t dlen = len;
+    if (deleted) {
+        while (len > 0 && path[len - 1] != '\\') len--;
+        if (len > 0) len--;                /* a deletion changes the parent's subkeys */
+    }
+    reg_watch_t** pp = &g_watches;
+    while (*pp) {
+        reg_watch_t* w = *pp;
+        size_t wlen = strlen(w->path);
+        bool hit = false;
+        if (w->hive == hive) {
+            if (w->filter & bit) {
+                hit = w->subtree ? path_within(path, len, w->path, wlen)
+                                 : (len == wlen && eq_fold_n(path, w->path, len));
+            }
+            if (deleted && path_within(w->path, wlen, path, dlen)) hit = true;
+        }
+        if (hit) watch_fire(pp);
+        else pp = &w->next;
+    }
+}
+
+// Everything in the hive may have changed (reloaded after compaction)
+static void watch_notify_hive(reg_hive_t* h) {
+    uint8_t hive = (uint8_t)(h - g_hives);
+    reg_watch_t** pp = &g_watches;
+    while (*pp) {
+        if ((*pp)->hive == hive) watch_fire(pp);
+        else pp = &(*pp)->next;
+    }
+}
+
+// Length of the deepest existing key on `path` (which does not exist)
+static size_t key_existing_prefix(reg_hive_t* h, const char* path, size_t len) {
+    while (len > 0) {
+        while (len > 0 && path[len - 1] != '\\') len--;
+        if (len > 0) len--;
+        if (key_find(h, path, len)) break;
+    }
+    return len;
+}
+
+// ============================================================================
+// SECTION: Records
+// ============================================================================
+
+/*
+ * Apply one record to the index. `cur` carries the key between records
+ * (REC_SAME_KEY); `in_place` is true for snapshot records, whose strings
+ * and data stay mapped.
+ */
+static void rec_apply(reg_hive_t* h, const rec_hdr_t* r, reg_key_t** cur, bool in_place) {
+    const char* path = (const char*)(r + 1);
+    const char* name = path + r->key_len + 1;
+    const uint8_t* data = (const uint8_t*)(name + r->name_len + 1);
+    reg_key_t* k = (r->flags & REC_SAME_KEY) ? *cur : NULL;
+    /* Snapshot records describe state, not changes */
+    bool notify = !in_place && __atomic_load_n(&g_watch_count, __ATOMIC_ACQUIRE) != 0;
+
+    switch (r->op) {
+    case REC_KEY:
+        if (notify && !key_find(h, path, r->key_len)) {
+            size_t parent = key_existing_prefix(h, path, r->key_len);
+            k = key_create(h, path, r->key_len, NULL);
+            watch_notify(h, LSW_REG_NOTIFY_NAME, path, parent, false);
+            break;
+        }
+        k = key_create(h, path, r->key_len, in_place ? path : NULL);
+        break;
+    case REC_VALUE:
+        if (!k) k = key_create(h, path, r->key_len, NULL);
+        if (k) value_put(k, name, r->type, data, r->data_len, in_place);
+        if (notify) watch_notify(h, LSW_REG_NOTIFY_LAST_SET, path, r->key_len, false);
+        break;
+    case REC_DEL_VALUE:
+        if (!k) k = key_find(h, path, r->key_len);
+        if (k) {
+            int i = value_find(k, name);
+            if (i >= 0) {
+                value_remove(k, i);
+                if (notify) watch_notify(h, LSW_REG_NOTIFY_LAST_SET, path, r->key_len, false);
+            }
+        }
+        break;
+    case REC_DEL_KEY:
+        if (!k) k = key_find(h, path, r->key_len);
+        if (k && k != h->root) {
+            key_destroy(h, k);
+            if (notify) watch_notify(h, LSW_REG_NOTIFY_NAME, path, r->key_len, true);
+        }
+        k = NULL;
+        break;
+    default:
+        break;
+    }
+    *cur = k;
+}
+
+// Bytes of `buf` holding well-formed records (CRC checked if `verify`)
+static size_t rec_scan(reg_hive_t* h, const uint8_t* buf, size_t len, bool verify, bool in_place) {
+    size_t off = 0;
+    reg_key_t* cur = NULL;
+    while (len - off >= sizeof(rec_hdr_t)) {
+        const rec_hdr_t* r = (const rec_hdr_t*)(const void*)(buf + off);
+        if (r->size < sizeof(*r) || (r->size & 7) || r->size > len - off) break;
+        if (sizeof(*r) + (size_t)r->key_len + 1 + r->name_len + 1 + r->data_len > r->size) break;
+        if (verify && crc32c((const uint8_t*)r + 4, r->size - 4) != r->crc) break;
+        rec_apply(h, r, &cur, in_place);
+        off += r->size;
+    }
+    return off;
+}
+
+// Build a record; the caller frees it
+static rec_hdr_t* rec_build(uint8_t op, uint8_t flags, const char* path, const char* name,
+                            uint32_t type, const void* data, uint32_t len) {
+    size_t klen = path ? strlen(path) : 0, nlen = name ? strlen(name) : 0;
+    if (klen > 0xFFFF || nlen > 0xFFFF) return NULL;
+    size_t size = (sizeof(rec_hdr_t) + klen + 1 + nlen + 1 + len + 7) & ~(size_t)7;
+    if (size > UINT32_MAX) return NULL;
+    rec_hdr_t* r = calloc(1, size);
+    if (!r) return NULL;
+    r->size = (uint32_t)size;
+    r->op = op;
+    r->flags = flags;
+    r->key_len = (uint16_t)klen;
+    r->name_len = (uint16_t)nlen;
+    r->type = type;
+    r->data_len = len;
+    char* p = (char*)(r + 1);
+    if (klen) memcpy(p, path, klen);
+    p += klen + 1;
+    if (nlen) memcpy(p, name, nlen);
+    p += nlen + 1;
+    if (len) memcpy(p, data, len);
+    r->crc = crc32c((const uint8_t*)r + 4, size - 4);
+    return r;
+}
+
+// ============================================================================
+// SECTION: Hive Files
+// ============================================================================
+
+// <registry>/<HIVE><ext>; false if it does not fit
+static bool hive_file(lsw_hkey_t idx, const char* ext, char* out, size_t cap) {
+    const char* name = hkey_to_string(idx);
+    int n = snprintf(out, cap, "%s/%s%s", g_reg_base, name ? name : "", ext);
+    return n > 0 && (size_t)n < cap;
+}
+
+static int write_full(int fd, const void* buf, size_t n, off_t off) {
+    const uint8_t* p = buf;
+    while (n) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w; n -= (size_t)w; off += w;
+    }
+    return 0;
+}
+
+/*
+ * Publish the committed journal length. Stores through the shared
+ * mapping raise no inotify event, so the value is also written back
+ * through the fd to wake other processes' notifier threads.
+ */
+static void journal_publish(reg_hive_t* h, uint64_t end) {
+    __atomic_store_n(&h->ctl->end, end, __ATOMIC_RELEASE);
+    (void)!pwrite(h->jfd, &end, sizeof(end), offsetof(journal_ctl_t, end));
+}
+
+static void fsync_dir(const char* base) {
+    int dfd = open(base, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) { fsync(dfd); close(dfd); }
+}
+
+static bool snapshot_emit(FILE* f, const reg_key_t* k, hive_hdr_t* hdr) {
+    rec_hdr_t* r = rec_build(REC_KEY, 0, k->path, NULL, 0, NULL, 0);
+    if (!r || fwrite(r, r->size, 1, f) != 1) { free(r); return false; }
+    hdr->length += r->size;
+    hdr->keys++;
+    free(r);
+    for (uint32_t i = 0; i < k->nvals; i++) {
+        const reg_value_t* v = &k->vals[i];
+        r = rec_build(REC_VALUE, REC_SAME_KEY, NULL, v->name, v->type, v->data, v->len);
+        if (!r || fwrite(r, r->size, 1, f) != 1) { free(r); return false; }
+        hdr->length += r->size;
+        hdr->values++;
+        free(r);
+    }
+    for (uint32_t i = 0; i < k->nkids; i++) {
+        if (!snapshot_emit(f, k->kids[i], hdr)) return false;
+    }
+    return true;
+}
+
+/**
+ * Write snapshot
+ *
+ * What: Replace <hive>.hive with the current index
+ * Why: Compaction and first-time creation/migration
+ * How: Write <hive>.hive.tmp, fsync, rename over the old file
+ *
+ * The old file stays mapped (and valid) until the caller unloads it.
+ */
+static lsw_status_t snapshot_write(reg_hive_t* h, lsw_hkey_t idx) {
+    char path[LSW_MAX_PATH], tmp[LSW_MAX_PATH];
+    hive_file(idx, ".hive", path, sizeof(path));
+    hive_file(idx, ".hive.tmp", tmp, sizeof(tmp));
+
+    FILE* f = fopen(tmp, "wb");
+    if (!f) {
+        LSW_LOG_ERROR("Registry: cannot write %s: %s", tmp, strerror(errno));
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    hive_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    uint8_t pad[HIVE_DATA] = {0};
+    bool ok = fwrite(pad, sizeof(pad), 1, f) == 1 && (!h->root || snapshot_emit(f, h->root, &hdr));
+    memcpy(hdr.magic, HIVE_MAGIC, sizeof(hdr.magic));
+    hdr.version = STORE_VERSION;
+    ok = ok && fseek(f, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp, path) != 0) {
+        LSW_LOG_ERROR("Registry: snapshot %s failed: %s", path, strerror(errno));
+        unlink(tmp);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    fsync_dir(g_reg_base);
+    LSW_LOG_DEBUG("Registry: wrote %s (%llu keys, %llu values)", path,
+                  (unsigned long long)hdr.keys, (unsigned long long)hdr.values);
+    return LSW_SUCCESS;
+}
+
+// Drop the index and the snapshot mapping (the journal stays open)
+static void hive_unload(reg_hive_t* h) {
+    if (h->root) key_destroy(h, h->root);
+    free(h->table);
+    h->table = NULL;
+    h->cap = h->count = 0;
+    if (h->snap) munmap(h->snap, h->snap_len);
+    h->snap = NULL;
+    h->snap_len = 0;
+}
+
+/*
+ * Replay journal records [h->applied, end). A record that fails its
+ * check is a torn tail from a crash: the committed length is cut there
+ * so later appends do not land behind it. flock held.
+ */
+static void journal_replay(reg_hive_t* h, uint64_t end) {
+    if (end <= h->applied) return;
+    size_t len = (size_t)(end - h->applied);
+    uint8_t* buf = malloc(len);
+    if (!buf) return;
+    size_t got = 0;
+    while (got < len) {
+        ssize_t r = pread(h->jfd, buf + got, len - got, (off_t)(h->applied + got));
+        if (r <= 0) break;
+        got += (size_t)r;
+    }
+    size_t ok = rec_scan(h, buf, got, true, false);
+    free(buf);
+    if (ok < len) {
+        LSW_LOG_WARN("Registry: journal damaged at %llu, truncating",
+                     (unsigned long long)(h->applied + ok));
+        __atomic_store_n(&h->ctl->end, h->applied + ok, __ATOMIC_RELEASE);
+    }
+    h->applied += ok;
+}
+
+// Map the snapshot, index it, replay the journal. flock held.
+static lsw_status_t hive_load(reg_hive_t* h, lsw_hkey_t idx) {
+    char path[LSW_MAX_PATH];
+    hive_file(idx, ".hive", path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return LSW_ERROR_REGISTRY_ERROR;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HIVE_DATA) {
+        close(fd);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return LSW_ERROR_REGISTRY_ERROR;
+
+    const hive_hdr_t* hdr = map;
+    if (memcmp(hdr->magic, HIVE_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != STORE_VERSION ||
+        hdr->length > (uint64_t)st.st_size - HIVE_DATA) {
+        LSW_LOG_ERROR("Registry: %s is not a valid hive", path);
+        munmap(map, (size_t)st.st_size);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    h->snap = map;
+    h->snap_len = (size_t)st.st_size;
+
+    /* The snapshot was fsync'd before it was renamed into place: bounds
+     * are checked, CRCs are not */
+    rec_scan(h, h->snap + HIVE_DATA, (size_t)hdr->length, false, true);
+    if (!h->root) key_create(h, "", 0, NULL);
+
+    h->gen = __atomic_load_n(&h->ctl->gen, __ATOMIC_ACQUIRE);
+    h->applied = JOURNAL_DATA;
+    journal_replay(h, __atomic_load_n(&h->ctl->end, __ATOMIC_ACQUIRE));
+    return LSW_SUCCESS;
+}
+
+/**
+ * Migrate legacy layout
+ *
+ * What: Import <registry>/<HIVE>/ (a directory per key, a file per value)
+ * Why: One-time upgrade from the original storage format
+ * How: Walk the tree into the index; the directory is renamed to
+ *      <HIVE>.migrated afterwards
+ */
+static void migrate_dir(reg_hive_t* h, const char* dir_path, const char* key_path, size_t* nvals) {
+    reg_key_t* k = key_create(h, key_path, strlen(key_path), NULL);
+    DIR* dir = opendir(dir_path);
+    if (!k || !dir) {
+        if (dir) closedir(dir);
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+        char child[LSW_MAX_PATH];
+        snprintf(child, sizeof(child), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(child, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            char sub[LSW_MAX_PATH];
+            snprintf(sub, sizeof(sub), "%s%s%s", key_path, key_path[0] ? "\\" : "", entry->d_name);
+            migrate_dir(h, child, sub, nvals);
+            k = key_find(h, key_path, strlen(key_path));
+            if (!k) break;
+            continue;
+        }
+
+        size_t len = strlen(entry->d_name);
+        if (len < 6 || strcmp(entry->d_name + len - 6, ".value") != 0) continue;
+        FILE* f = fopen(child, "rb");
+        if (!f) continue;
+        lsw_reg_type_t type;
+        size_t size;
+        if (fread(&type, sizeof(type), 1, f) == 1 && fread(&size, sizeof(size), 1, f) == 1 &&
+            size <= (size_t)st.st_size) {
+            uint8_t* data = malloc(size ? size : 1);
+            if (data && fread(data, 1, size, f) == size) {
+                char name[256];
+                memcpy(name, entry->d_name, len - 6);
+                name[len - 6] = '\0';
+                if (value_put(k, name, (uint32_t)type, data, (uint32_t)size, false)) (*nvals)++;
+            }
+            free(data);
+        }
+        fclose(f);
+    }
+    closedir(dir);
+}
+
+/**
+ * Seed a hive from the overlay base
+ *
+ * What: Give a new overlay hive the base registry's contents
+ * Why: Jobs start from the shared registry without copying it
+ * How: Under a shared flock on the base journal, so snapshot and
+ *      journal agree: hard-link the base snapshot (it is never written
+ *      in place; compaction here replaces the link), or copy it across
+ *      filesystems, then copy the committed journal records. Called
+ *      with the new journal flocked.
+ *
+ * @return true if the overlay hive now has a snapshot
+ */
+static bool hive_seed(lsw_hkey_t idx, reg_hive_t* h, const char* hpath) {
+    const char* name = hkey_to_string(idx);
+    char src[LSW_MAX_PATH], jsrc[LSW_MAX_PATH];
+    if (!g_reg_lower[0] || !name ||
+        snprintf(src, sizeof(src), "%s/%s.hive", g_reg_lower, name) >= (int)sizeof(src) ||
+        snprintf(jsrc, sizeof(jsrc), "%s/%s.journal", g_reg_lower, name) >= (int)sizeof(jsrc)) {
+        return false;
+    }
+    int jfd = open(jsrc, O_RDONLY | O_CLOEXEC);
+    if (jfd >= 0) flock(jfd, LOCK_SH);
+
+    bool ok = link(src, hpath) == 0;
+    if (!ok && errno != ENOENT) {
+        char tmp[LSW_MAX_PATH];
+        hive_file(idx, ".hive.tmp", tmp, sizeof(tmp));
+        int in = open(src, O_RDONLY | O_CLOEXEC);
+        int out = in >= 0 ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+        uint8_t buf[65536];
+        ssize_t n;
+        off_t off = 0;
+        ok = out >= 0;
+        while (ok && (n = read(in, buf, sizeof(buf))) > 0) {
+            ok = write_full(out, buf, (size_t)n, off) == 0;
+            off += n;
+        }
+        ok = ok && n == 0 && fsync(out) == 0 && rename(tmp, hpath) == 0;
+        if (in >= 0) close(in);
+        if (out >= 0) close(out);
+        if (!ok) unlink(tmp);
+    }
+
+    journal_ctl_t ctl;
+    if (ok && jfd >= 0 && pread(jfd, &ctl, sizeof(ctl), 0) == (ssize_t)sizeof(ctl) &&
+        memcmp(ctl.magic, JOURNAL_MAGIC, sizeof(ctl.magic)) == 0 && ctl.version == STORE_VERSION &&
+        ctl.end > JOURNAL_DATA) {
+        uint8_t buf[65536];
+        uint64_t off = JOURNAL_DATA;
+        while (off < ctl.end) {
+            size_t want = ctl.end - off < sizeof(buf) ? (size_t)(ctl.end - off) : sizeof(buf);
+            ssize_t n = pread(jfd, buf, want, (off_t)off);
+            if (n <= 0 || write_full(h->jfd, buf, (size_t)n, (off_t)off) != 0) break;
+            off += (uint64_t)n;
+        }
+        /* A short copy keeps what arrived; replay cuts at the last whole record */
+        journal_publish(h, off);
+    }
+    if (jfd >= 0) close(jfd);
+    if (ok) LSW_LOG_INFO("Registry: %s seeded from %s", name, g_reg_lower);
+    return ok;
+}
+
+/**
+ * Open hive
+ *
+ * What: Attach to <hive>.journal and <hive>.hive, creating them if needed
+ * Why: Hives are loaded on first use
+ * How: Under an exclusive flock on the journal: initialize the control
+ *      page, create or migrate the snapshot, then load
+ */
+static lsw_status_t hive_open(reg_hive_t* h, lsw_hkey_t idx) {
+    char jpath[LSW_MAX_PATH], hpath[LSW_MAX_PATH], legacy[LSW_MAX_PATH];
+    if (!hive_file(idx, ".hive.tmp", jpath, sizeof(jpath))) {
+        return LSW_ERROR_INVALID_PARAMETER;  /* longest name must fit */
+    }
+    hive_file(idx, ".journal", jpath, sizeof(jpath));
+    hive_file(idx, ".hive", hpath, sizeof(hpath));
+    hive_file(idx, "", legacy, sizeof(legacy));
+
+    int fd = open(jpath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LSW_LOG_ERROR("Registry: cannot open %s: %s", jpath, strerror(errno));
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < JOURNAL_DATA && ftruncate(fd, JOURNAL_DATA) != 0)) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    journal_ctl_t* ctl = mmap(NULL, JOURNAL_DATA, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ctl == MAP_FAILED) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    if (memcmp(ctl->magic, JOURNAL_MAGIC, sizeof(ctl->magic)) != 0 || ctl->version != STORE_VERSION) {
+        memset(ctl, 0, sizeof(*ctl));
+        memcpy(ctl->magic, JOURNAL_MAGIC, sizeof(ctl->magic));
+        ctl->version = STORE_VERSION;
+        ctl->gen = 1;
+        ctl->end = JOURNAL_DATA;
+    }
+    if (fstat(fd, &st) == 0 && (ctl->end < JOURNAL_DATA || ctl->end > (uint64_t)st.st_size)) {
+        ctl->end = (uint64_t)st.st_size < JOURNAL_DATA ? JOURNAL_DATA : (uint64_t)st.st_size;
+    }
+    h->jfd = fd;
+    h->ctl = ctl;
+
+    lsw_status_t status = LSW_SUCCESS;
+    if (access(hpath, F_OK) != 0 && !hive_seed(idx, h, hpath)) {
+        /* First use: start empty, or import the old directory tree */
+        key_create(h, "", 0, NULL);
+        struct stat lst;
+        bool base_legacy = false;
+        if (g_reg_lower[0] && stat(legacy, &lst) != 0) {
+            /* Import the overlay base's tree, leaving it in place */
+            const char* name = hkey_to_string(idx);
+            if (snprintf(legacy, sizeof(legacy), "%s/%s", g_reg_lower,
+                         name ? name : "") >= (int)sizeof(legacy)) {
+                legacy[0] = '\0';
+            }
+            base_legacy = true;
+        }
+        if (stat(legacy, &lst) == 0 && S_ISDIR(lst.st_mode)) {
+            size_t nvals = 0;
+            migrate_dir(h, legacy, "", &nvals);
+            LSW_LOG_INFO("Registry: migrating %s (%zu keys, %zu values)", legacy, h->count, nvals);
+        }
+        status = snapshot_write(h, idx);
+        hive_unload(h);
+        if (status == LSW_SUCCESS && !base_legacy && stat(legacy, &lst) == 0) {
+            char moved[LSW_MAX_PATH];
+            hive_file(idx, ".migrated", moved, sizeof(moved));
+            if (rename(legacy, moved) != 0) {
+                LSW_LOG_WARN("Registry: could not rename %s: %s", legacy, strerror(errno));
+            }
+        }
+    }
+    if (status == LSW_SUCCESS) status = hive_load(h, idx);
+    flock(fd, LOCK_UN);
+
+    if (status != LSW_SUCCESS) {
+        hive_unload(h);
+        munmap(ctl, JOURNAL_DATA);
+        close(fd);
+        h->ctl = NULL;
+        h->jfd = -1;
+        return status;
+    }
+    h->loaded = true;
+    return LSW_SUCCESS;
+}
+
+static inline bool hive_stale(const reg_hive_t* h) {
+    return __atomic_load_n(&h->ctl->gen, __ATOMIC_ACQUIRE) != h->gen ||
+           __atomic_load_n(&h->ctl->end, __ATOMIC_ACQUIRE) != h->applied;
+}
+
+// Pick up other processes' writes or snapshot swap. flock held.
+static void hive_catch_up(reg_hive_t* h, lsw_hkey_t idx) {
+    if (__atomic_load_n(&h->ctl->gen, __ATOMIC_ACQUIRE) != h->gen ||
+        __atomic_load_n(&h->ctl->end, __ATOMIC_ACQUIRE) < h->applied) {
+        hive_unload(h);
+        if (hive_load(h, idx) != LSW_SUCCESS) {
+            LSW_LOG_ERROR("Registry: reloading %s failed", hkey_to_string(idx));
+            key_create(h, "", 0, NULL);
+        }
+        watch_notify_hive(h);
+        return;
+    }
+    journal_replay(h, __atomic_load_n(&h->ctl->end, __ATOMIC_ACQUIRE));
+}
+
+// Loaded and current; write lock held
+static lsw_status_t hive_ensure(reg_hive_t* h, lsw_hkey_t idx) {
+    if (!h->loaded) return hive_open(h, idx);
+    if (hive_stale(h)) {
+        flock(h->jfd, LOCK_EX);
+        hive_catch_up(h, idx);
+        flock(h->jfd, LOCK_UN);
+    }
+    return LSW_SUCCESS;
+}
+
+/*
+ * Start an index read: returns the hive with g_reg_lock held (read, or
+ * write if the hive had to be loaded or caught up), or NULL unlocked.
+ */
+static reg_hive_t* reg_read_begin(lsw_hkey_t idx) {
+    if ((unsigned)idx >= HIVE_COUNT) return NULL;
+    reg_hive_t* h = &g_hives[idx];
+    pthread_rwlock_rdlock(&g_reg_lock);
+    if (h->loaded && !hive_stale(h)) return h;
+    pthread_rwlock_unlock(&g_reg_lock);
+    pthread_rwlock_wrlock(&g_reg_lock);
+    if (hive_ensure(h, idx) != LSW_SUCCESS) {
+        pthread_rwlock_unlock(&g_reg_lock);
+        return NULL;
+    }
+    return h;
+}
+
+static reg_hive_t* reg_write_begin(lsw_hkey_t idx) {
+    if ((unsigned)idx >= HIVE_COUNT) return NULL;
+    reg_hive_t* h = &g_hives[idx];
+    pthread_rwlock_wrlock(&g_reg_lock);
+    if (hive_ensure(h, idx) != LSW_SUCCESS) {
+        pthread_rwlock_unlock(&g_reg_lock);
+        return NULL;
+    }
+    return h;
+}
+
+static void reg_end(void) {
+    pthread_rwlock_unlock(&g_reg_lock);
+}
+
+/**
+ * Commit a change
+ *
+ * What: Append one record to the journal and apply it
+ * Why: Every mutation is journaled before it is visible
+ * How: Under the journal flock: catch up, append at the committed end,
+ *      publish the new end, apply; compact when the journal has grown
+ *      past the snapshot. Write lock held; key pointers taken before
+ *      the call may be stale afterwards.
+ */
+static lsw_status_t hive_commit(reg_hive_t* h, lsw_hkey_t idx, uint8_t op, const char* path,
+                                const char* name, uint32_t type, const void* data, size_t len) {
+    if (len > UINT32_MAX) return LSW_ERROR_INVALID_PARAMETER;
+    rec_hdr_t* r = rec_build(op, 0, path, name, type, data, (uint32_t)len);
+    if (!r) return LSW_ERROR_INVALID_PARAMETER;
+
+    flock(h->jfd, LOCK_EX);
+    hive_catch_up(h, idx);
+    uint64_t off = __atomic_load_n(&h->ctl->end, __ATOMIC_ACQUIRE);
+    if (write_full(h->jfd, r, r->size, (off_t)off) != 0) {
+        LSW_LOG_ERROR("Registry: journal write failed: %s", strerror(errno));
+        flock(h->jfd, LOCK_UN);
+        free(r);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    journal_publish(h, off + r->size);
+    reg_key_t* cur = NULL;
+    rec_apply(h, r, &cur, false);
+    h->applied = off + r->size;
+    h->dirty = true;
+    free(r);
+
+    uint64_t jlen = h->applied - JOURNAL_DATA;
+    if (jlen > COMPACT_MIN && jlen > h->snap_len) {
+        if (snapshot_write(h, idx) == LSW_SUCCESS) {
+            /* Journal contents are now in the snapshot */
+            if (ftruncate(h->jfd, JOURNAL_DATA) == 0) {
+                __atomic_add_fetch(&h->ctl->gen, 1, __ATOMIC_RELEASE);
+                journal_publish(h, JOURNAL_DATA);
+                fdatasync(h->jfd);
+                h->dirty = false;
+            }
+            hive_unload(h);
+            if (hive_load(h, idx) != LSW_SUCCESS) key_create(h, "", 0, NULL);
+        }
+    }
+    flock(h->jfd, LOCK_UN);
     return LSW_SUCCESS;
 }
 
+static void reg_once_init(void) {
+    crc_init();
+    lsw_config_t config;
+    lsw_config_load(&config);
+    const char* overlay = lsw_overlay_dir();
+    if (overlay) {
+        snprintf(g_reg_base, sizeof(g_reg_base), "%s/registry", overlay);
+        snprintf(g_reg_lower, sizeof(g_reg_lower), "%s", config.registry_path);
+    } else {
+        snprintf(g_reg_base, sizeof(g_reg_base), "%s", config.registry_path);
+    }
+    for (int i = 0; i < HIVE_COUNT; i++) {
+        g_hives[i].jfd = -1;
+        g_notify_wd[i] = -1;
+    }
+}
+
 // ============================================================================
 // SECTION: Public API Implementation
 // ============================================================================
 
 /**
  * Initialize registry system
- * 
- * What: Create base registry directories
+ *
+ * What: Create the registry directory
  * Why: First-time setup
- * How: Create HKLM, HKCU, etc. directories
+ * How: Hive files are created on first use of each root
  */
 lsw_status_t lsw_reg_init(void) {
+    pthread_once(&g_reg_once, reg_once_init);
     if (g_registry_initialized) {
         return LSW_SUCCESS;
     }
-    
-    // Get registry base path from config
-    lsw_config_t config;
-    lsw_config_load(&config);
-    
-    LSW_LOG_INFO("Initializing registry at: %s", config.registry_path);
-    
+
+    LSW_LOG_INFO("Initializing registry at: %s", g_reg_base);
+
     // Create base directory
-    lsw_status_t status = mkdir_recursive(config.registry_path);
+    lsw_status_t status = mkdir_recursive(g_reg_base);
     if (status != LSW_SUCCESS) {
         return status;
     }
-    
-    // Create hive directories
-    const char* hives[] = {"HKLM", "HKCU", "HKCR", "HKU", "HKCC"};
-    for (size_t i = 0; i < sizeof(hives) / sizeof(hives[0]); i++) {
-        char path[LSW_MAX_PATH];
-        snprintf(path, sizeof(path), "%s/%s", config.registry_path, hives[i]);
-        mkdir_recursive(path);
-    }
-    
-    // Initialize handle table
-    memset(g_handles, 0, sizeof(g_handles));
-    
+
     g_registry_initialized = true;
     LSW_LOG_INFO("Registry initialized successfully");
-    
+
     return LSW_SUCCESS;
 }
 
 /**
  * Get registry path
- * 
+ *
  * What: Convert HKLM\Software\Test to filesystem path
  * Why: Map registry to files
  * How: Build path from config + hkey + subkey
@@ -204,131 +1320,137 @@ lsw_status_t lsw_reg_get_path(
     if (!path_buffer || buffer_size == 0) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     // Ensure registry is initialized
     lsw_reg_init();
-    
-    // Get config for registry base path
-    lsw_config_t config;
-    lsw_config_load(&config);
-    
+
     // Get hkey name
     const char* hkey_name = hkey_to_string(hkey);
     if (!hkey_name) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     // Build path: <registry_base>/<HKEY>/<subkey>
     if (subkey && subkey[0]) {
         snprintf(path_buffer, buffer_size, "%s/%s/%s",
-                config.registry_path, hkey_name, subkey);
+                g_reg_base, hkey_name, subkey);
     } else {
         snprintf(path_buffer, buffer_size, "%s/%s",
-                config.registry_path, hkey_name);
+                g_reg_base, hkey_name);
     }
-    
+
     // Convert backslashes to forward slashes for Linux paths
     for (char* p = path_buffer; *p; p++) {
         if (*p == '\\') *p = '/';
     }
-    
+
     return LSW_SUCCESS;
 }
 
 /**
  * Open registry key
- * 
+ *
  * What: Open existing key
  * Why: Read values from key
- * How: Check if directory exists, allocate handle
+ * How: Look the path up in the hive index, allocate handle
  */
 lsw_status_t lsw_reg_open_key(
     lsw_hkey_t hkey,
     const char* subkey,
     HANDLE* out_handle
 ) {
-    if (!out_handle) {
+    if (!out_handle || !hkey_to_string(hkey)) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     // Ensure registry initialized
     lsw_reg_init();
-    
-    // Get filesystem path
+
     char path[LSW_MAX_PATH];
-    lsw_status_t status = lsw_reg_get_path(hkey, subkey, path, sizeof(path));
-    if (status != LSW_SUCCESS) {
-        return status;
+    int len = path_canon(subkey, path, sizeof(path));
+    if (len < 0) {
+        return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     // Check if key exists
-    struct stat st;
-    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
-        LSW_LOG_DEBUG("Registry key not found: %s", path);
+    reg_hive_t* h = reg_read_begin(hkey);
+    if (!h) {
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    bool found = key_find(h, path, (size_t)len) != NULL;
+    reg_end();
+    if (!found) {
+        LSW_LOG_DEBUG("Registry key not found: %s\\%s", hkey_to_string(hkey), path);
         return LSW_ERROR_FILE_NOT_FOUND;
     }
-    
+
     // Allocate handle
-    HANDLE handle = alloc_handle(path);
+    HANDLE handle = alloc_handle(hkey, path);
     if (!handle) {
         LSW_LOG_ERROR("No free registry handles");
         return LSW_ERROR_OUT_OF_MEMORY;
     }
-    
+
     *out_handle = handle;
-    LSW_LOG_DEBUG("Opened registry key: %s", path);
-    
+    LSW_LOG_DEBUG("Opened registry key: %s\\%s", hkey_to_string(hkey), path);
+
     return LSW_SUCCESS;
 }
 
 /**
  * Create registry key
- * 
+ *
  * What: Create new key or open existing
  * Why: Apps create their own keys
- * How: Create directory, allocate handle
+ * How: Journal a key record if it is new, allocate handle
  */
 lsw_status_t lsw_reg_create_key(
     lsw_hkey_t hkey,
     const char* subkey,
     HANDLE* out_handle
 ) {
-    if (!out_handle) {
+    if (!out_handle || !hkey_to_string(hkey)) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
+
     // Ensure registry initialized
     lsw_reg_init();
-    
-    // Get filesystem path
+
     char path[LSW_MAX_PATH];
-    lsw_status_t status = lsw_reg_get_path(hkey, subkey, path, sizeof(path));
-    if (status != LSW_SUCCESS) {
-        return status;
+    int len = path_canon(subkey, path, sizeof(path));
+    if (len < 0) {
+        return LSW_ERROR_INVALID_PARAMETER;
+    }
+
+    reg_hive_t* h = reg_write_begin(hkey);
+    if (!h) {
+        return LSW_ERROR_REGISTRY_ERROR;
     }
-    
-    // Create directory (recursive)
-    status = mkdir_recursive(path);
+    lsw_status_t status = LSW_SUCCESS;
+    if (!key_find(h, path, (size_t)len)) {
+        status = hive_commit(h, hkey, REC_KEY, path, NULL, 0, NULL, 0);
+    }
+    reg_end();
     if (status != LSW_SUCCESS) {
         return status;
     }
-    
+
     // Allocate handle
-    HANDLE handle = alloc_handle(path);
+    HANDLE handle = alloc_handle(hkey, path);
     if (!handle) {
         LSW_LOG_ERROR("No free registry handles");
         return LSW_ERROR_OUT_OF_MEMORY;
     }
-    
+
     *out_handle = handle;
-    LSW_LOG_DEBUG("Created registry key: %s", path);
-    
+    LSW_LOG_DEBUG("Created registry key: %s\\%s", hkey_to_string(hkey), path);
+
     return LSW_SUCCESS;
 }
 
 /**
  * Close registry key
- * 
+ *
  * What: Release handle
  * Why: Free resources
  * How: Mark handle as closed
@@ -338,23 +1460,37 @@ lsw_status_t lsw_reg_close_key(HANDLE handle) {
     if (!h) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
-    h->is_open = false;
+
     LSW_LOG_DEBUG("Closed registry key: %s", h->path);
-    
+
+    // Watches armed on this handle fire when it is closed, as on Windows
+    if (__atomic_load_n(&g_watch_count, __ATOMIC_ACQUIRE)) {
+        pthread_rwlock_wrlock(&g_reg_lock);
+        reg_watch_t** pp = &g_watches;
+        while (*pp) {
+            if ((*pp)->handle == handle) watch_fire(pp);
+            else pp = &(*pp)->next;
+        }
+        pthread_rwlock_unlock(&g_reg_lock);
+    }
+
+    pthread_mutex_lock(&g_handle_lock);
+    h->is_open = false;
+    pthread_mutex_unlock(&g_handle_lock);
+
     return LSW_SUCCESS;
 }
 
 // ============================================================================
-// SECTION: Value Operations (simplified for now)
+// SECTION: Value Operations
 // ============================================================================
 
 /**
  * Set registry value
- * 
+ *
  * What: Write value to key
  * Why: Apps save configuration
- * How: Write to file in key directory
+ * How: Journal a value record; rewriting an identical value is a no-op
  */
 lsw_status_t lsw_reg_set_value(
     HANDLE handle,
@@ -363,41 +1499,42 @@ lsw_status_t lsw_reg_set_value(
     const void* data,
     size_t data_size
 ) {
-    lsw_reg_handle_t* h = get_handle(handle);
-    if (!h || !value_name || !data) {
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !value_name || !data) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
-    // Build value file path
-    char value_path[LSW_MAX_PATH];
-    snprintf(value_path, sizeof(value_path), "%s/%s.value", h->path, value_name);
-    
-    // Write value data
-    FILE* f = fopen(value_path, "wb");
-    if (!f) {
-        LSW_LOG_ERROR("Failed to write registry value: %s", value_path);
+
+    reg_hive_t* h = reg_write_begin(hd->hive);
+    if (!h) {
         return LSW_ERROR_REGISTRY_ERROR;
     }
-    
-    // Write type and size first
-    fwrite(&type, sizeof(type), 1, f);
-    fwrite(&data_size, sizeof(data_size), 1, f);
-    
-    // Write actual data
-    fwrite(data, data_size, 1, f);
-    fclose(f);
-    
-    LSW_LOG_DEBUG("Set registry value: %s = %zu bytes", value_name, data_size);
-    
-    return LSW_SUCCESS;
+    lsw_status_t status = LSW_SUCCESS;
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    if (!k) {
+        status = LSW_ERROR_REGISTRY_ERROR;  // key deleted under the handle
+    } else {
+        int i = value_find(k, value_name);
+        bool same = i >= 0 && k->vals[i].type == (uint32_t)type && k->vals[i].len == data_size &&
+                    memcmp(k->vals[i].data, data, data_size) == 0;
+        if (!same) {
+            status = hive_commit(h, hd->hive, REC_VALUE, hd->path, value_name,
+                                 (uint32_t)type, data, data_size);
+        }
+    }
+    reg_end();
+
+    if (status == LSW_SUCCESS) {
+        LSW_LOG_DEBUG("Set registry value: %s = %zu bytes", value_name, data_size);
+    }
+    return status;
 }
 
 /**
  * Query registry value
- * 
+ *
  * What: Read value from key
  * Why: Apps read configuration
- * How: Read from file in key directory
+ * How: Index lookup and copy; no file I/O
  */
 lsw_status_t lsw_reg_query_value(
     HANDLE handle,
@@ -406,170 +1543,280 @@ lsw_status_t lsw_reg_query_value(
     void* data,
     size_t* data_size
 ) {
-    lsw_reg_handle_t* h = get_handle(handle);
-    if (!h || !value_name || !data_size) {
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !value_name || !data_size) {
         return LSW_ERROR_INVALID_PARAMETER;
     }
-    
-    // Build value file path
-    char value_path[LSW_MAX_PATH];
-    snprintf(value_path, sizeof(value_path), "%s/%s.value", h->path, value_name);
-    
-    // Read value data
-    FILE* f = fopen(value_path, "rb");
-    if (!f) {
-        LSW_LOG_DEBUG("Registry value not found: %s", value_path);
+
+    reg_hive_t* h = reg_read_begin(hd->hive);
+    if (!h) {
+        return LSW_ERROR_FILE_NOT_FOUND;
+    }
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    int i = k ? value_find(k, value_name) : -1;
+    if (i < 0) {
+        reg_end();
+        LSW_LOG_DEBUG("Registry value not found: %s\\%s", hd->path, value_name);
         return LSW_ERROR_FILE_NOT_FOUND;
     }
-    
-    // Read type and size
-    lsw_reg_type_t stored_type;
-    size_t stored_size;
-    fread(&stored_type, sizeof(stored_type), 1, f);
-    fread(&stored_size, sizeof(stored_size), 1, f);
-    
-    if (type) *type = stored_type;
-    
+
+    const reg_value_t* v = &k->vals[i];
+    if (type) *type = (lsw_reg_type_t)v->type;
+
     // Check buffer size
-    if (data && *data_size >= stored_size) {
-        fread(data, stored_size, 1, f);
-    }
-    
-    *data_size = stored_size;
-    fclose(f);
-    
-    LSW_LOG_DEBUG("Queried registry value: %s = %zu bytes", value_name, stored_size);
-    
+    if (data && *data_size >= v->len) {
+        memcpy(data, v->data, v->len);
+    }
+
+    *data_size = v->len;
+    reg_end();
+
+    LSW_LOG_DEBUG("Queried registry value: %s = %zu bytes", value_name, *data_size);
+
     return LSW_SUCCESS;
 }
 
-// TODO: Implement remaining functions (delete, enum) as needed
-
 /**
- * lsw_reg_delete_value - Remove a value file from a key directory
+ * lsw_reg_delete_value - Remove a value from a key
  */
 lsw_status_t lsw_reg_delete_value(HANDLE handle, const char* value_name)
 {
-    lsw_reg_handle_t* h = get_handle(handle);
-    if (!h || !value_name) return LSW_ERROR_INVALID_PARAMETER;
-
-    char value_path[LSW_MAX_PATH];
-    snprintf(value_path, sizeof(value_path), "%s/%s.value", h->path, value_name);
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !value_name) return LSW_ERROR_INVALID_PARAMETER;
 
-    if (unlink(value_path) != 0) {
-        if (errno == ENOENT) return LSW_ERROR_FILE_NOT_FOUND;
-        return LSW_ERROR_REGISTRY_ERROR;
+    reg_hive_t* h = reg_write_begin(hd->hive);
+    if (!h) return LSW_ERROR_REGISTRY_ERROR;
+    lsw_status_t status = LSW_ERROR_FILE_NOT_FOUND;
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    if (k && value_find(k, value_name) >= 0) {
+        status = hive_commit(h, hd->hive, REC_DEL_VALUE, hd->path, value_name, 0, NULL, 0);
     }
-    return LSW_SUCCESS;
+    reg_end();
+    return status;
 }
 
 /**
- * lsw_reg_delete_key - Remove a registry key directory tree
+ * lsw_reg_delete_key - Remove a key and its subkeys
  */
 lsw_status_t lsw_reg_delete_key(lsw_hkey_t hkey, const char* subkey)
 {
+    if (!hkey_to_string(hkey)) return LSW_ERROR_INVALID_PARAMETER;
+    lsw_reg_init();
+
     char path[LSW_MAX_PATH];
-    lsw_status_t status = lsw_reg_get_path(hkey, subkey, path, sizeof(path));
-    if (status != LSW_SUCCESS) return status;
+    int len = path_canon(subkey, path, sizeof(path));
+    if (len < 0) return LSW_ERROR_INVALID_PARAMETER;
+    if (len == 0) return LSW_ERROR_ACCESS_DENIED;  /* hive roots cannot be deleted */
 
-    /* Remove all files in the directory, then the directory itself */
-    DIR* dir = opendir(path);
-    if (!dir) {
-        if (errno == ENOENT) return LSW_ERROR_FILE_NOT_FOUND;
-        return LSW_ERROR_REGISTRY_ERROR;
+    reg_hive_t* h = reg_write_begin(hkey);
+    if (!h) return LSW_ERROR_REGISTRY_ERROR;
+    lsw_status_t status = LSW_ERROR_FILE_NOT_FOUND;
+    if (key_find(h, path, (size_t)len)) {
+        status = hive_commit(h, hkey, REC_DEL_KEY, path, NULL, 0, NULL, 0);
     }
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue;
-        char child[LSW_MAX_PATH];
-        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
-        unlink(child); /* Ignore errors — may be a subdir */
-    }
-    closedir(dir);
-    rmdir(path);
-    return LSW_SUCCESS;
+    reg_end();
+    return status;
 }
 
 /**
- * lsw_reg_enum_keys - Enumerate subkey directories at index
+ * lsw_reg_enum_keys - Subkey at index, in case-insensitive name order
  */
 lsw_status_t lsw_reg_enum_keys(HANDLE handle, uint32_t index,
                                  char* name_buffer, size_t buffer_size)
 {
-    lsw_reg_handle_t* h = get_handle(handle);
-    if (!h || !name_buffer || buffer_size == 0) return LSW_ERROR_INVALID_PARAMETER;
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !name_buffer || buffer_size == 0) return LSW_ERROR_INVALID_PARAMETER;
 
-    DIR* dir = opendir(h->path);
-    if (!dir) return LSW_ERROR_FILE_NOT_FOUND;
-
-    uint32_t cur = 0;
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue;
-        /* Only enumerate subdirectories (not .value files) */
-        char child[LSW_MAX_PATH];
-        snprintf(child, sizeof(child), "%s/%s", h->path, entry->d_name);
-        struct stat st;
-        if (stat(child, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
-        if (cur == index) {
-            strncpy(name_buffer, entry->d_name, buffer_size - 1);
-            name_buffer[buffer_size - 1] = '\0';
-            closedir(dir);
-            return LSW_SUCCESS;
-        }
-        cur++;
+    reg_hive_t* h = reg_read_begin(hd->hive);
+    if (!h) return LSW_ERROR_FILE_NOT_FOUND;
+    lsw_status_t status = LSW_ERROR_FILE_NOT_FOUND; /* index out of range */
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    if (k && index < k->nkids) {
+        strncpy(name_buffer, k->kids[index]->name, buffer_size - 1);
+        name_buffer[buffer_size - 1] = '\0';
+        status = LSW_SUCCESS;
     }
-    closedir(dir);
-    return LSW_ERROR_FILE_NOT_FOUND; /* index out of range */
+    reg_end();
+    return status;
 }
 
 /**
- * lsw_reg_enum_values - Enumerate value files at index
+ * lsw_reg_enum_values - Value at index, in creation order
  */
 lsw_status_t lsw_reg_enum_values(HANDLE handle, uint32_t index,
                                    char* name_buffer, size_t buffer_size,
                                    lsw_reg_type_t* type)
 {
-    lsw_reg_handle_t* h = get_handle(handle);
-    if (!h || !name_buffer || buffer_size == 0) return LSW_ERROR_INVALID_PARAMETER;
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !name_buffer || buffer_size == 0) return LSW_ERROR_INVALID_PARAMETER;
 
-    DIR* dir = opendir(h->path);
-    if (!dir) return LSW_ERROR_FILE_NOT_FOUND;
+    reg_hive_t* h = reg_read_begin(hd->hive);
+    if (!h) return LSW_ERROR_FILE_NOT_FOUND;
+    lsw_status_t status = LSW_ERROR_FILE_NOT_FOUND;
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    if (k && index < k->nvals) {
+        strncpy(name_buffer, k->vals[index].name, buffer_size - 1);
+        name_buffer[buffer_size - 1] = '\0';
+        if (type) *type = (lsw_reg_type_t)k->vals[index].type;
+        status = LSW_SUCCESS;
+    }
+    reg_end();
+    return status;
+}
 
-    uint32_t cur = 0;
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue;
-        /* Only enumerate .value files */
-        size_t len = strlen(entry->d_name);
-        if (len < 6 || strcmp(entry->d_name + len - 6, ".value") != 0) continue;
-        if (cur == index) {
-            /* Strip ".value" suffix */
-            size_t name_len = len - 6;
-            if (name_len >= buffer_size) name_len = buffer_size - 1;
-            strncpy(name_buffer, entry->d_name, name_len);
-            name_buffer[name_len] = '\0';
-            /* Read type from the file header */
-            if (type) {
-                char vpath[LSW_MAX_PATH];
-                snprintf(vpath, sizeof(vpath), "%s/%s", h->path, entry->d_name);
-                FILE* f = fopen(vpath, "rb");
-                if (f) {
-                    lsw_reg_type_t t = LSW_REG_BINARY;
-                    if (fread(&t, sizeof(t), 1, f) == 1) *type = t;
-                    else *type = LSW_REG_BINARY;
-                    fclose(f);
-                } else {
-                    *type = LSW_REG_BINARY;
-                }
-            }
-            closedir(dir);
-            return LSW_SUCCESS;
+/**
+ * lsw_reg_query_info - Counts and maximum lengths for RegQueryInfoKey
+ */
+lsw_status_t lsw_reg_query_info(HANDLE handle, lsw_reg_key_info_t* info)
+{
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !info) return LSW_ERROR_INVALID_PARAMETER;
+
+    reg_hive_t* h = reg_read_begin(hd->hive);
+    if (!h) return LSW_ERROR_FILE_NOT_FOUND;
+    reg_key_t* k = key_find(h, hd->path, strlen(hd->path));
+    if (!k) {
+        reg_end();
+        return LSW_ERROR_FILE_NOT_FOUND;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->subkeys = k->nkids;
+    for (uint32_t i = 0; i < k->nkids; i++) {
+        const reg_key_t* c = k->kids[i];
+        uint32_t len = c->path_len - (uint32_t)(c->name - c->path);
+        if (len > info->max_subkey_len) info->max_subkey_len = len;
+    }
+    info->values = k->nvals;
+    for (uint32_t i = 0; i < k->nvals; i++) {
+        uint32_t len = (uint32_t)strlen(k->vals[i].name);
+        if (len > info->max_value_name_len) info->max_value_name_len = len;
+        if (k->vals[i].len > info->max_value_len) info->max_value_len = k->vals[i].len;
+    }
+    reg_end();
+    return LSW_SUCCESS;
+}
+
+/*
+ * Notifier thread: wakes on journal writes from any process and catches
+ * the loaded hives up, which fires matching watches.
+ */
+static void* notify_thread(void* arg) {
+    (void)arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(g_notify_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (!__atomic_load_n(&g_watch_count, __ATOMIC_ACQUIRE)) continue;
+        pthread_rwlock_wrlock(&g_reg_lock);
+        for (int i = 0; i < HIVE_COUNT; i++) {
+            if (g_hives[i].loaded && hive_stale(&g_hives[i])) hive_ensure(&g_hives[i], (lsw_hkey_t)i);
         }
-        cur++;
+        pthread_rwlock_unlock(&g_reg_lock);
     }
-    closedir(dir);
-    return LSW_ERROR_FILE_NOT_FOUND;
+    LSW_LOG_WARN("Registry: notifier stopped: %s", strerror(errno));
+    return NULL;
+}
+
+static void notify_start(void) {
+    g_notify_fd = inotify_init1(IN_CLOEXEC);
+    if (g_notify_fd < 0) {
+        LSW_LOG_WARN("Registry: inotify unavailable (%s); other processes' changes "
+                     "are seen on next access only", strerror(errno));
+        return;
+    }
+    pthread_t t;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&t, &attr, notify_thread, NULL) != 0) {
+        close(g_notify_fd);
+        g_notify_fd = -1;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * lsw_reg_notify - Arm a one-shot change notification (RegNotifyChangeKeyValue)
+ */
+lsw_status_t lsw_reg_notify(HANDLE handle, bool subtree, uint32_t filter,
+                            lsw_reg_notify_fn fn, void* ctx)
+{
+    lsw_reg_handle_t* hd = get_handle(handle);
+    if (!hd || !fn || !(filter & LSW_REG_NOTIFY_ALL)) return LSW_ERROR_INVALID_PARAMETER;
+
+    size_t len = strlen(hd->path);
+    reg_watch_t* w = malloc(sizeof(*w) + len + 1);
+    if (!w) return LSW_ERROR_OUT_OF_MEMORY;
+    w->handle = handle;
+    w->hive = hd->hive;
+    w->subtree = subtree;
+    w->filter = filter;
+    w->fn = fn;
+    w->ctx = ctx;
+    memcpy(w->path, hd->path, len + 1);
+
+    pthread_once(&g_notify_once, notify_start);
+
+    reg_hive_t* h = reg_write_begin(hd->hive);
+    if (!h) {
+        free(w);
+        return LSW_ERROR_REGISTRY_ERROR;
+    }
+    if (!key_find(h, w->path, len)) {
+        reg_end();
+        free(w);
+        return LSW_ERROR_FILE_NOT_FOUND;
+    }
+    if (g_notify_fd >= 0 && g_notify_wd[hd->hive] < 0) {
+        char jpath[LSW_MAX_PATH];
+        hive_file(hd->hive, ".journal", jpath, sizeof(jpath));
+        g_notify_wd[hd->hive] = inotify_add_watch(g_notify_fd, jpath, IN_MODIFY);
+    }
+    w->next = g_watches;
+    g_watches = w;
+    __atomic_add_fetch(&g_watch_count, 1, __ATOMIC_RELEASE);
+    reg_end();
+    return LSW_SUCCESS;
+}
+
+/**
+ * lsw_reg_notify_cancel - Drop pending notifications for `ctx` without firing
+ */
+void lsw_reg_notify_cancel(void* ctx)
+{
+    if (!__atomic_load_n(&g_watch_count, __ATOMIC_ACQUIRE)) return;
+    pthread_rwlock_wrlock(&g_reg_lock);
+    reg_watch_t** pp = &g_watches;
+    while (*pp) {
+        reg_watch_t* w = *pp;
+        if (w->ctx == ctx) {
+            *pp = w->next;
+            __atomic_sub_fetch(&g_watch_count, 1, __ATOMIC_RELEASE);
+            free(w);
+        } else {
+            pp = &w->next;
+        }
+    }
+    pthread_rwlock_unlock(&g_reg_lock);
+}
+
+/**
+ * lsw_reg_flush - Make journaled changes durable (RegFlushKey)
+ */
+lsw_status_t lsw_reg_flush(void)
+{
+    lsw_status_t status = LSW_SUCCESS;
+    pthread_rwlock_wrlock(&g_reg_lock);
+    for (int i = 0; i < HIVE_COUNT; i++) {
+        reg_hive_t* h = &g_hives[i];
+        if (!h->loaded || !h->dirty) continue;
+        if (fdatasync(h->jfd) != 0) status = LSW_ERROR_REGISTRY_ERROR;
+        else h->dirty = false;
+    }
+    pthread_rwlock_unlock(&g_reg_lock);
+    return status;
 }
 
 // ============================================================================
@@ -578,43 +1825,43 @@ lsw_status_t lsw_reg_enum_values(HANDLE handle, uint32_t index,
 
 /**
  * Populate default registry environment
- * 
+ *
  * What: Pre-populate registry with Windows system keys
  * Why: Apps expect these keys to exist
  * How: Create standard Windows registry structure
  */
 lsw_status_t lsw_reg_populate_environment(void) {
     LSW_LOG_INFO("Populating registry with default environment");
-    
+
     HANDLE hkey;
     lsw_status_t status;
     DWORD dword_value;
-    
+
     // HKLM\SOFTWARE\Microsoft\Windows\CurrentVersion
-    status = lsw_reg_create_key(LSW_HKEY_LOCAL_MACHINE, 
-                                 "SOFTWARE\\Microsoft\\Windows\\CurrentVersion", 
+    status = lsw_reg_create_key(LSW_HKEY_LOCAL_MACHINE,
+                                 "SOFTWARE\\Microsoft\\Windows\\CurrentVersion",
                                  &hkey);
     if (status == LSW_SUCCESS) {
         const char* product_name = "Windows 10 Pro";
-        lsw_reg_set_value(hkey, "ProductName", LSW_REG_SZ, 
+        lsw_reg_set_value(hkey, "ProductName", LSW_REG_SZ,
                          product_name, strlen(product_name) + 1);
-        
+
         const char* version = "10.0";
         lsw_reg_set_value(hkey, "CurrentVersion", LSW_REG_SZ,
                          version, strlen(version) + 1);
-        
+
         const char* build = "19045";
         lsw_reg_set_value(hkey, "CurrentBuildNumber", LSW_REG_SZ,
                          build, strlen(build) + 1);
-        
+
         const char* program_files = "C:\\Program Files";
         lsw_reg_set_value(hkey, "ProgramFilesDir", LSW_REG_SZ,
                          program_files, strlen(program_files) + 1);
-        
+
         lsw_reg_close_key(hkey);
         LSW_LOG_INFO("Created Windows CurrentVersion keys");
     }
-    
+
     // HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion
     status = lsw_reg_create_key(LSW_HKEY_LOCAL_MACHINE,
                                  "SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion",
@@ -623,19 +1870,19 @@ lsw_status_t lsw_reg_populate_environment(void) {
         dword_value = 10;
         lsw_reg_set_value(hkey, "CurrentMajorVersionNumber", LSW_REG_DWORD,
                          &dword_value, sizeof(dword_value));
-        
+
         dword_value = 0;
         lsw_reg_set_value(hkey, "CurrentMinorVersionNumber", LSW_REG_DWORD,
                          &dword_value, sizeof(dword_value));
-        
+
         const char* build_lab = "19045.lsw.barrersoftware";
         lsw_reg_set_value(hkey, "BuildLab", LSW_REG_SZ,
                          build_lab, strlen(build_lab) + 1);
-        
+
         lsw_reg_close_key(hkey);
         LSW_LOG_INFO("Created Windows NT CurrentVersion keys");
     }
-    
+
     // System environment
     status = lsw_reg_create_key(LSW_HKEY_LOCAL_MACHINE,
                                  "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment",
@@ -644,22 +1891,22 @@ lsw_status_t lsw_reg_populate_environment(void) {
         const char* arch = "AMD64";
         lsw_reg_set_value(hkey, "PROCESSOR_ARCHITECTURE", LSW_REG_SZ,
                          arch, strlen(arch) + 1);
-        
+
         char num_proc[16];
         snprintf(num_proc, sizeof(num_proc), "%ld", sysconf(_SC_NPROCESSORS_ONLN));
         lsw_reg_set_value(hkey, "NUMBER_OF_PROCESSORS", LSW_REG_SZ,
                          num_proc, strlen(num_proc) + 1);
-        
+
         const char* windir = "C:\\Windows";
         lsw_reg_set_value(hkey, "windir", LSW_REG_SZ,
                          windir, strlen(windir) + 1);
         lsw_reg_set_value(hkey, "SystemRoot", LSW_REG_SZ,
                          windir, strlen(windir) + 1);
-        
+
         lsw_reg_close_key(hkey);
         LSW_LOG_INFO("Created system environment variables");
     }
-    
+
     LSW_LOG_INFO("Registry environment population complete");
     return LSW_SUCCESS;
 }
@@ -0,0 +1,176 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Fault Dispatch Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Measures what a deliberate fault (a GC write barrier, an implicit
+ * null check) costs when a registered interceptor or a vectored
+ * exception handler resumes it, against a bare SIGSEGV handler
+ */
+
+#define _GNU_SOURCE  /* REG_RIP */
+
+#include "win32_fault.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#define TEST_ITERATIONS   100000
+#define OTHER_RANGES      64
+#define EXCEPTION_ACCESS_VIOLATION    0xC0000005u
+#define EXCEPTION_CONTINUE_EXECUTION  (-1)
+#define EXCEPTION_CONTINUE_SEARCH     0
+#define CONTEXT_RIP       0xF8
+#define LOAD_SIZE         3           /* movq (%rdi), %rax */
+
+/* A load that faults on a NULL argument and returns the value read */
+extern uint64_t fault_load(const uint64_t* p);
+extern char fault_load_end[];
+__asm__(
+    ".text\n"
+    ".globl fault_load\n"
+    "fault_load:\n"
+    "    movq (%rdi), %rax\n"
+    "fault_load_end:\n"
+    "    ret\n");
+
+enum bench_mode {
+    MODE_SIGNAL,        /* the handler steps over the load itself */
+    MODE_DISPATCH,      /* win32_fault_dispatch */
+};
+
+static volatile enum bench_mode mode;
+static volatile int unhandled;
+static volatile int intercepted;
+static volatile int vectored;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void segv_handler(int sig, siginfo_t* si, void* ctx)
+{
+    ucontext_t* uc = ctx;
+
+    (void)sig;
+    if (mode == MODE_DISPATCH && win32_fault_dispatch(EXCEPTION_ACCESS_VIOLATION, si, uc)) return;
+    if (mode == MODE_DISPATCH) unhandled++;
+    uc->uc_mcontext.gregs[REG_RIP] += LOAD_SIZE;
+}
+
+static int step_over_load(uint32_t code, siginfo_t* si, ucontext_t* uc, void* ctx)
+{
+    (void)code; (void)si; (void)ctx;
+    intercepted++;
+    uc->uc_mcontext.gregs[REG_RIP] += LOAD_SIZE;
+    return 1;
+}
+
+static int never_called(uint32_t code, siginfo_t* si, ucontext_t* uc, void* ctx)
+{
+    (void)code; (void)si; (void)uc; (void)ctx;
+    unhandled++;
+    return 0;
+}
+
+/* PVECTORED_EXCEPTION_HANDLER: EXCEPTION_POINTERS is { record, context } */
+static int32_t __attribute__((ms_abi)) veh_step_over_load(void* exception_pointers)
+{
+    uint8_t* context = ((uint8_t**)exception_pointers)[1];
+    uint64_t rip;
+
+    memcpy(&rip, context + CONTEXT_RIP, sizeof(rip));
+    if (rip != (uint64_t)(uintptr_t)fault_load) return EXCEPTION_CONTINUE_SEARCH;
+    vectored++;
+    rip += LOAD_SIZE;
+    memcpy(context + CONTEXT_RIP, &rip, sizeof(rip));
+    return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+/* Faults TEST_ITERATIONS times; returns ns per fault */
+static double run(void)
+{
+    double start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        fault_load(NULL);
+    }
+    return (now_ns() - start) / TEST_ITERATIONS;
+}
+
+int main(void)
+{
+    static uint64_t others[OTHER_RANGES];
+    uint64_t begin = (uint64_t)(uintptr_t)fault_load;
+    uint64_t end = (uint64_t)(uintptr_t)fault_load_end;
+    struct sigaction sa;
+    void* handle = NULL;
+    void* veh;
+    int failed = 0;
+    int i;
+
+    printf("=== LSW Fault Dispatch Test ===\n");
+    printf("%d faults per case, ns per fault\n\n", TEST_ITERATIONS);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = segv_handler;
+    sa.sa_flags = SA_SIGINFO;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, NULL);
+
+    /* Test 1: Bare signal delivery */
+    printf("1. SIGSEGV handler steps over the load...\n");
+    mode = MODE_SIGNAL;
+    printf("   %.0f ns\n\n", run());
+
+    /* Test 2: An interceptor for the load's range */
+    printf("2. Registered interceptor...\n");
+    mode = MODE_DISPATCH;
+    if (win32_fault_register(begin, end, EXCEPTION_ACCESS_VIOLATION, step_over_load, NULL, &handle) != 0) {
+        printf("   FAILED: Could not register the interceptor\n\n");
+        failed = 1;
+    } else {
+        printf("   %.0f ns\n", run());
+        for (i = 0; i < OTHER_RANGES; i++) {
+            uint64_t other = (uint64_t)(uintptr_t)&others[i];
+            win32_fault_register(other, other + sizeof(others[i]), WIN32_FAULT_ANY_CODE,
+                                 never_called, NULL, NULL);
+        }
+        printf("   %.0f ns with %d other ranges registered\n", run(), OTHER_RANGES);
+        if (intercepted != 2 * TEST_ITERATIONS || unhandled) {
+            printf("   FAILED: %d of %d faults intercepted, %d unhandled\n",
+                   intercepted, 2 * TEST_ITERATIONS, unhandled);
+            failed = 1;
+        }
+        win32_fault_unregister(handle);
+        printf("\n");
+    }
+
+    /* Test 3: A vectored exception handler, nothing intercepting */
+    printf("3. Vectored exception handler...\n");
+    veh = win32_veh_add(0, 1, (void*)veh_step_over_load);
+    if (!veh) {
+        printf("   FAILED: Could not add the handler\n\n");
+        failed = 1;
+    } else {
+        printf("   %.0f ns\n", run());
+        if (vectored != TEST_ITERATIONS || unhandled) {
+            printf("   FAILED: %d of %d faults handled, %d unhandled\n",
+                   vectored, TEST_ITERATIONS, unhandled);
+            failed = 1;
+        }
+        win32_veh_remove(0, veh);
+        printf("\n");
+    }
+
+    printf("=== Fault Dispatch Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,245 @@
+/*
+ * LSW (Linux Subsystem for Windows) - File Throughput Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Compares kernel NtReadFile/NtWriteFile throughput with plain read() and
+ * write(), and checks ByteOffset and IO_STATUS_BLOCK handling
+ */
+
+#include "shared/lsw_kernel_client.h"
+#include "shared/lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/* Syscall numbers */
+#define LSW_SYSCALL_NtCreateFile  0x0055
+#define LSW_SYSCALL_NtReadFile    0x0006
+#define LSW_SYSCALL_NtWriteFile   0x0008
+#define LSW_SYSCALL_NtClose       0x000f
+
+/* Win32 access flags */
+#define LSW_GENERIC_READ          0x80000000
+#define LSW_GENERIC_WRITE         0x40000000
+
+/* Win32 creation disposition */
+#define LSW_CREATE_ALWAYS         2
+#define LSW_OPEN_EXISTING         3
+
+#define STATUS_SUCCESS            0x00000000
+#define STATUS_END_OF_FILE        0xC0000011
+
+struct lsw_syscall_request {
+    uint32_t syscall_number;
+    uint32_t arg_count;
+    uint64_t args[8];
+    uint64_t return_value;
+    int32_t  error_code;
+};
+
+struct lsw_io_status_block {
+    uint32_t status;
+    uint32_t reserved;
+    uint64_t information;
+};
+
+#define LSW_IOCTL_MAGIC 'L'
+#define LSW_IOCTL_SYSCALL _IOWR(LSW_IOCTL_MAGIC, 5, struct lsw_syscall_request)
+
+#define TEST_PATH        "/tmp/lsw_throughput.bin"
+#define TEST_FILE_SIZE   (64 * 1024 * 1024)
+#define TEST_CHUNK       (1024 * 1024)
+
+static int lsw_fd;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t nt_open(uint32_t access, uint32_t disposition)
+{
+    struct lsw_syscall_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = LSW_SYSCALL_NtCreateFile;
+    req.arg_count = 3;
+    req.args[0] = (uint64_t)(uintptr_t)TEST_PATH;
+    req.args[1] = access;
+    req.args[2] = disposition;
+
+    if (ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req) < 0 || req.return_value == (uint64_t)-1) {
+        return 0;
+    }
+    return req.return_value;
+}
+
+/* NtReadFile/NtWriteFile; returns bytes transferred or -1 */
+static int64_t nt_io(uint32_t number, uint64_t handle, void* buffer, uint64_t size,
+                     int64_t* offset, struct lsw_io_status_block* iosb)
+{
+    struct lsw_syscall_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = number;
+    req.arg_count = 5;
+    req.args[0] = handle;
+    req.args[1] = (uint64_t)(uintptr_t)buffer;
+    req.args[2] = size;
+    req.args[3] = (uint64_t)(uintptr_t)offset;
+    req.args[4] = (uint64_t)(uintptr_t)iosb;
+
+    if (ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req) < 0) {
+        return -1;
+    }
+    return (int64_t)req.return_value;
+}
+
+static void nt_close(uint64_t handle)
+{
+    struct lsw_syscall_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = LSW_SYSCALL_NtClose;
+    req.arg_count = 1;
+    req.args[0] = handle;
+    ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req);
+}
+
+static void report(const char* what, double seconds)
+{
+    printf("   %-22s %8.1f MB/s\n", what, TEST_FILE_SIZE / seconds / (1024.0 * 1024.0));
+}
+
+int main(void)
+{
+    struct lsw_io_status_block iosb;
+    char* buffer;
+    uint64_t handle;
+    int64_t offset;
+    int64_t got;
+    uint64_t total;
+    double start;
+    int failed = 0;
+    int fd;
+
+    printf("=== LSW File Throughput Test ===\n");
+    printf("%d MB in %d KB requests\n\n", TEST_FILE_SIZE >> 20, TEST_CHUNK >> 10);
+
+    lsw_fd = lsw_kernel_open();
+    if (lsw_fd < 0) {
+        printf("FAILED: Could not open /dev/lsw\n");
+        return 1;
+    }
+
+    buffer = malloc(TEST_CHUNK);
+    if (!buffer) {
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    memset(buffer, 'L', TEST_CHUNK);
+
+    /* Test 1: Write throughput */
+    printf("1. Write throughput...\n");
+    handle = nt_open(LSW_GENERIC_WRITE, LSW_CREATE_ALWAYS);
+    if (!handle) {
+        printf("   FAILED: NtCreateFile\n");
+        free(buffer);
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    start = now_sec();
+    for (total = 0; total < TEST_FILE_SIZE; total += TEST_CHUNK) {
+        if (nt_io(LSW_SYSCALL_NtWriteFile, handle, buffer, TEST_CHUNK, NULL, NULL) != TEST_CHUNK) {
+            printf("   FAILED: short NtWriteFile at %lu\n", total);
+            failed = 1;
+            break;
+        }
+    }
+    report("NtWriteFile:", now_sec() - start);
+    nt_close(handle);
+
+    fd = open(TEST_PATH, O_WRONLY | O_TRUNC);
+    start = now_sec();
+    for (total = 0; total < TEST_FILE_SIZE; total += TEST_CHUNK) {
+        if (write(fd, buffer, TEST_CHUNK) != TEST_CHUNK) {
+            break;
+        }
+    }
+    report("write():", now_sec() - start);
+    close(fd);
+    printf("\n");
+
+    /* Test 2: Read throughput (page cache warm for both) */
+    printf("2. Read throughput...\n");
+    handle = nt_open(LSW_GENERIC_READ, LSW_OPEN_EXISTING);
+    if (!handle) {
+        printf("   FAILED: NtCreateFile\n");
+        free(buffer);
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    start = now_sec();
+    for (total = 0; total < TEST_FILE_SIZE; total += got) {
+        got = nt_io(LSW_SYSCALL_NtReadFile, handle, buffer, TEST_CHUNK, NULL, NULL);
+        if (got <= 0) {
+            break;
+        }
+    }
+    report("NtReadFile:", now_sec() - start);
+    if (total != TEST_FILE_SIZE) {
+        printf("   FAILED: read %lu of %d bytes\n", total, TEST_FILE_SIZE);
+        failed = 1;
+    }
+
+    fd = open(TEST_PATH, O_RDONLY);
+    start = now_sec();
+    for (total = 0; total < TEST_FILE_SIZE; total += got) {
+        got = read(fd, buffer, TEST_CHUNK);
+        if (got <= 0) {
+            break;
+        }
+    }
+    report("read():", now_sec() - start);
+    close(fd);
+    printf("\n");
+
+    /* Test 3: ByteOffset and IO_STATUS_BLOCK */
+    printf("3. NtReadFile - ByteOffset and IO_STATUS_BLOCK...\n");
+    offset = TEST_FILE_SIZE - 100;
+    memset(&iosb, 0xff, sizeof(iosb));
+    got = nt_io(LSW_SYSCALL_NtReadFile, handle, buffer, TEST_CHUNK, &offset, &iosb);
+    if (got != 100 || iosb.status != STATUS_SUCCESS || iosb.information != 100) {
+        printf("   FAILED: got %ld, status=0x%x, information=%lu\n",
+               got, iosb.status, iosb.information);
+        failed = 1;
+    } else {
+        printf("   SUCCESS: short read at offset %ld\n", offset);
+    }
+
+    /* The file pointer now sits at end of file */
+    memset(&iosb, 0xff, sizeof(iosb));
+    got = nt_io(LSW_SYSCALL_NtReadFile, handle, buffer, TEST_CHUNK, NULL, &iosb);
+    if (got != 0 || iosb.status != STATUS_END_OF_FILE) {
+        printf("   FAILED: expected STATUS_END_OF_FILE, got 0x%x\n", iosb.status);
+        failed = 1;
+    } else {
+        printf("   SUCCESS: STATUS_END_OF_FILE\n\n");
+    }
+    nt_close(handle);
+
+    free(buffer);
+    unlink(TEST_PATH);
+    lsw_kernel_close(lsw_fd);
+
+    printf("=== File Throughput Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,129 @@
+/*
+ * LSW (Linux Subsystem for Windows) - getpid() Latency Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Measures what the module's syscall probe costs a process that does
+ * not trap NT syscalls: getpid() latency with no process opted in (the
+ * probe is detached) and with another process opted in (the probe runs
+ * and finds nothing to trap). Run it once without the module loaded
+ * for the bare baseline.
+ */
+
+#include "shared/lsw_kernel_client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_ITERATIONS  1000000
+
+/* The child's NT range; no syscall instruction lives here */
+static unsigned char nt_range[16];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Register and opt in as PE itself, report on `out`, wait to be killed */
+static void trapping_child(int out)
+{
+    struct lsw_pe_info pe;
+    char ok = 0;
+    int fd;
+
+    fd = lsw_kernel_open();
+    memset(&pe, 0, sizeof(pe));
+    pe.pid = (uint32_t)getpid();
+    pe.is_64bit = 1;
+    strncpy(pe.executable_path, "/test/lsw_getpid_latency.exe", sizeof(pe.executable_path) - 1);
+    if (fd >= 0 && lsw_kernel_register_pe(fd, &pe) == 0 &&
+        lsw_kernel_trap_nt_syscalls(fd, (uintptr_t)nt_range,
+                                    (uintptr_t)nt_range + sizeof(nt_range)) == 0) {
+        ok = 1;
+    }
+    if (write(out, &ok, 1) != 1 || !ok) {
+        _exit(1);
+    }
+    pause();
+    _exit(0);
+}
+
+/* ns per getpid(); the libc wrapper is bypassed in case it caches */
+static double run(void)
+{
+    double start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        syscall(SYS_getpid);
+    }
+    return (now_ns() - start) / TEST_ITERATIONS;
+}
+
+int main(void)
+{
+    int failed = 0;
+    int pipefd[2];
+    pid_t child;
+    char ok = 0;
+    int fd;
+
+    printf("=== LSW getpid() Latency Test ===\n");
+    printf("%d calls per case, ns per call\n\n", TEST_ITERATIONS);
+
+    /* Test 1: As things stand */
+    fd = lsw_kernel_open();
+    printf("1. getpid(), %s...\n", fd < 0 ? "module not loaded" : "module loaded, nothing trapped");
+    printf("   %.1f ns\n\n", run());
+    if (fd < 0) {
+        printf("   /dev/lsw is not available; load kernel-module/lsw.ko for the probe cases\n\n");
+        printf("=== getpid() Latency Test Complete ===\n");
+        return 0;
+    }
+
+    /* Test 2: The probe attached for someone else */
+    printf("2. getpid(), another process trapping NT syscalls...\n");
+    child = -1;
+    if (pipe(pipefd) == 0) {
+        child = fork();
+        if (child == 0) {
+            close(pipefd[0]);
+            trapping_child(pipefd[1]);
+        }
+        close(pipefd[1]);
+        if (child < 0 || read(pipefd[0], &ok, 1) != 1) {
+            ok = 0;
+        }
+        close(pipefd[0]);
+    }
+    if (!ok) {
+        printf("   FAILED: Could not opt a PE process in\n\n");
+        failed = 1;
+    } else {
+        printf("   %.1f ns\n\n", run());
+    }
+    if (child > 0) {
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+    if (ok) {
+        /* Test 3: Detached again, by the child's exit */
+        printf("3. getpid(), trapping process exited...\n");
+        printf("   %.1f ns\n\n", run());
+    }
+
+    lsw_kernel_close(fd);
+
+    printf("=== getpid() Latency Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,234 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Handle Teardown on Exit Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Checks that the kernel frees the handle table and memory of a
+ * process that exits without closing anything: a child that exits
+ * normally, and a multithreaded child killed while its threads hold
+ * handles
+ */
+
+#include "shared/lsw_kernel_client.h"
+#include "shared/lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+/* Syscall numbers */
+#define LSW_SYSCALL_NtAllocateVirtualMemory  0x0018
+#define LSW_SYSCALL_NtCreateEvent            0x0048
+
+struct lsw_syscall_request {
+    uint32_t syscall_number;
+    uint32_t arg_count;
+    uint64_t args[8];
+    uint64_t return_value;
+    int32_t  error_code;
+};
+
+#define LSW_IOCTL_SYSCALL _IOWR(LSW_IOCTL_MAGIC, 5, struct lsw_syscall_request)
+
+#define EXIT_HANDLES        1000
+#define EXIT_THREADS        4
+#define EXIT_ALLOCATIONS    16
+#define TEARDOWN_WAIT_MS    2000
+
+static int child_fd;
+static int ready_pipe[2];
+
+static uint64_t lsw_call(uint32_t number, uint32_t arg_count, uint64_t arg0,
+                         uint64_t arg1, uint64_t arg2, uint64_t arg3)
+{
+    struct lsw_syscall_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = number;
+    req.arg_count = arg_count;
+    req.args[0] = arg0;
+    req.args[1] = arg1;
+    req.args[2] = arg2;
+    req.args[3] = arg3;
+
+    if (ioctl(child_fd, LSW_IOCTL_SYSCALL, &req) < 0) {
+        return 0;
+    }
+    return req.return_value;
+}
+
+/* Opens `count` events and reports to the parent; 0 or the number that failed */
+static int create_events(int count)
+{
+    int failed = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (lsw_call(LSW_SYSCALL_NtCreateEvent, 2, 0, 0, 0, 0) == 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static void* holder_thread(void* arg)
+{
+    char status = create_events(EXIT_HANDLES / EXIT_THREADS) ? 'F' : 'R';
+
+    (void)arg;
+    if (write(ready_pipe[1], &status, 1) != 1) {
+        _exit(2);
+    }
+    for (;;) {
+        pause();
+    }
+    return NULL;
+}
+
+/* Child: open handles and memory, then exit or wait to be killed, closing nothing */
+static void child_main(int threaded)
+{
+    char status = 'R';
+    int i;
+
+    child_fd = lsw_kernel_open();
+    if (child_fd < 0) {
+        _exit(2);
+    }
+
+    for (i = 0; i < EXIT_ALLOCATIONS; i++) {
+        if (lsw_call(LSW_SYSCALL_NtAllocateVirtualMemory, 4, 0, 65536, 0x3000, 0x04) == 0) {
+            status = 'F';
+        }
+    }
+
+    if (threaded && status == 'R') {
+        pthread_t thread;
+
+        for (i = 0; i < EXIT_THREADS; i++) {
+            pthread_create(&thread, NULL, holder_thread, NULL);
+        }
+        for (;;) {
+            pause();
+        }
+    }
+
+    if (create_events(EXIT_HANDLES)) {
+        status = 'F';
+    }
+    if (write(ready_pipe[1], &status, 1) != 1) {
+        _exit(2);
+    }
+    _exit(0);
+}
+
+/* Runs one child; returns 0 when everything it opened is gone after it exits */
+static int run_child(int fd, const struct lsw_stats* base, int threaded)
+{
+    struct lsw_stats stats;
+    struct timespec delay = { 0, 10 * 1000 * 1000 };
+    int reports = threaded ? EXIT_THREADS : 1;
+    int failed = 0;
+    pid_t child;
+    char status;
+    int waited;
+    int i;
+
+    if (pipe(ready_pipe) != 0) {
+        printf("   FAILED: Could not create a pipe\n");
+        return 1;
+    }
+
+    child = fork();
+    if (child < 0) {
+        printf("   FAILED: Could not fork\n");
+        return 1;
+    }
+    if (child == 0) {
+        close(ready_pipe[0]);
+        child_main(threaded);
+    }
+    close(ready_pipe[1]);
+
+    for (i = 0; i < reports; i++) {
+        if (read(ready_pipe[0], &status, 1) != 1 || status != 'R') {
+            printf("   FAILED: the child could not open its handles\n");
+            failed = 1;
+            break;
+        }
+    }
+    close(ready_pipe[0]);
+
+    if (!failed && lsw_kernel_get_stats(fd, &stats) == 0) {
+        printf("   child running: %u handles, %u tables, %u regions\n",
+               stats.handles, stats.handle_tables, stats.memory_regions);
+    }
+    if (threaded) {
+        kill(child, SIGKILL);
+    }
+    waitpid(child, NULL, 0);
+    if (failed) {
+        return 1;
+    }
+
+    /* The teardown runs from a work item shortly after the child is reaped */
+    for (waited = 0; waited < TEARDOWN_WAIT_MS; waited += 10) {
+        if (lsw_kernel_get_stats(fd, &stats) != 0) {
+            printf("   FAILED: Could not read the kernel's stats\n");
+            return 1;
+        }
+        if (stats.handles == base->handles && stats.handle_tables == base->handle_tables &&
+            stats.memory_regions == base->memory_regions) {
+            printf("   SUCCESS: torn down within %d ms\n\n", waited);
+            return 0;
+        }
+        nanosleep(&delay, NULL);
+    }
+
+    printf("   FAILED: %u handles, %u tables, %u regions left (expected %u, %u, %u)\n\n",
+           stats.handles, stats.handle_tables, stats.memory_regions,
+           base->handles, base->handle_tables, base->memory_regions);
+    return 1;
+}
+
+int main(void)
+{
+    struct lsw_stats base;
+    int failed = 0;
+    int fd;
+
+    printf("=== LSW Handle Teardown on Exit Test ===\n\n");
+
+    fd = lsw_kernel_open();
+    if (fd < 0) {
+        printf("FAILED: Could not open /dev/lsw\n");
+        return 1;
+    }
+    if (lsw_kernel_get_stats(fd, &base) != 0) {
+        printf("FAILED: Could not read the kernel's stats\n");
+        lsw_kernel_close(fd);
+        return 1;
+    }
+    printf("Before: %u handles, %u tables, %u regions\n\n",
+           base.handles, base.handle_tables, base.memory_regions);
+
+    /* Test 1: A process that exits with everything open */
+    printf("1. Child exits with %d handles and %d allocations open...\n",
+           EXIT_HANDLES, EXIT_ALLOCATIONS);
+    failed |= run_child(fd, &base, 0);
+
+    /* Test 2: A process killed while several threads hold handles */
+    printf("2. Child with %d threads killed while holding %d handles...\n",
+           EXIT_THREADS, EXIT_HANDLES);
+    failed |= run_child(fd, &base, 1);
+
+    lsw_kernel_close(fd);
+
+    printf("=== Handle Teardown on Exit Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,249 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Handle Table Stress Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Opens at least 100k event handles from 64 threads and checks that
+ * handle lookups stay flat as the process's handle table grows
+ */
+
+#include "shared/lsw_kernel_client.h"
+#include "shared/lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/ioctl.h>
+
+/* Syscall numbers */
+#define LSW_SYSCALL_NtCreateEvent         0x0048
+#define LSW_SYSCALL_NtSetEvent            0x000e
+#define LSW_SYSCALL_NtClose               0x000f
+
+struct lsw_syscall_request {
+    uint32_t syscall_number;
+    uint32_t arg_count;
+    uint64_t args[8];
+    uint64_t return_value;
+    int32_t  error_code;
+};
+
+#define LSW_IOCTL_MAGIC 'L'
+#define LSW_IOCTL_SYSCALL _IOWR(LSW_IOCTL_MAGIC, 5, struct lsw_syscall_request)
+
+#define STRESS_THREADS        64
+#define STRESS_HANDLES        100000
+#define HANDLES_PER_THREAD    ((STRESS_HANDLES + STRESS_THREADS - 1) / STRESS_THREADS)
+#define LOOKUPS_PER_SAMPLE    20000
+
+static int lsw_fd;
+static uint64_t handles[STRESS_THREADS][HANDLES_PER_THREAD];
+
+static uint64_t lsw_call(uint32_t number, uint32_t arg_count,
+                         uint64_t arg0, uint64_t arg1, int* ret)
+{
+    struct lsw_syscall_request req;
+
+    memset(&req, 0, sizeof(req));
+    req.syscall_number = number;
+    req.arg_count = arg_count;
+    req.args[0] = arg0;
+    req.args[1] = arg1;
+
+    *ret = ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req);
+    return req.return_value;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Average NtSetEvent time over handles already open */
+static double lookup_ns(int open_threads)
+{
+    double start;
+    int ret;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < LOOKUPS_PER_SAMPLE; i++) {
+        int t = i % open_threads;
+        lsw_call(LSW_SYSCALL_NtSetEvent, 1,
+                 handles[t][(i * 7919) % HANDLES_PER_THREAD], 0, &ret);
+    }
+    return (now_ns() - start) / LOOKUPS_PER_SAMPLE;
+}
+
+static void* create_thread(void* arg)
+{
+    uint64_t* mine = arg;
+    intptr_t failed = 0;
+    int ret;
+    int i;
+
+    for (i = 0; i < HANDLES_PER_THREAD; i++) {
+        mine[i] = lsw_call(LSW_SYSCALL_NtCreateEvent, 2, 0, 0, &ret);
+        if (ret < 0 || mine[i] == 0) {
+            failed++;
+        }
+    }
+    return (void*)failed;
+}
+
+static void* close_thread(void* arg)
+{
+    uint64_t* mine = arg;
+    intptr_t failed = 0;
+    int ret;
+    int i;
+
+    for (i = 0; i < HANDLES_PER_THREAD; i++) {
+        lsw_call(LSW_SYSCALL_NtClose, 1, mine[i], 0, &ret);
+        if (ret < 0) {
+            failed++;
+        }
+    }
+    return (void*)failed;
+}
+
+/* Run `fn` on the slices from `first` on; returns the number of failed calls */
+static long run_threads(void* (*fn)(void*), int first)
+{
+    pthread_t threads[STRESS_THREADS];
+    long failed = 0;
+    void* result;
+    int t;
+
+    for (t = first; t < STRESS_THREADS; t++) {
+        pthread_create(&threads[t], NULL, fn, handles[t]);
+    }
+    for (t = first; t < STRESS_THREADS; t++) {
+        pthread_join(threads[t], &result);
+        failed += (long)(intptr_t)result;
+    }
+    return failed;
+}
+
+static int compare_handles(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return x < y ? -1 : x > y;
+}
+
+int main(void)
+{
+    double small_ns, large_ns;
+    uint64_t* sorted;
+    uint64_t reused;
+    long count;
+    int failed = 0;
+    int ret;
+    long i;
+
+    printf("=== LSW Handle Table Stress Test ===\n");
+    printf("%d handles from %d threads\n\n", HANDLES_PER_THREAD * STRESS_THREADS,
+           STRESS_THREADS);
+
+    lsw_fd = lsw_kernel_open();
+    if (lsw_fd < 0) {
+        printf("FAILED: Could not open /dev/lsw\n");
+        return 1;
+    }
+
+    /* Test 1: Lookups in a small table */
+    printf("1. NtSetEvent - Lookup time with a small table...\n");
+    count = (long)(intptr_t)create_thread(handles[0]);
+    if (count) {
+        printf("   FAILED: %ld creations failed\n", count);
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    small_ns = lookup_ns(1);
+    printf("   %d handles open: %.0f ns/call\n\n", HANDLES_PER_THREAD, small_ns);
+
+    /* Test 2: Concurrent creation grows the table */
+    printf("2. NtCreateEvent - Creating handles concurrently...\n");
+    count = run_threads(create_thread, 1);
+    if (count) {
+        printf("   FAILED: %ld creations failed\n", count);
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    printf("   SUCCESS\n\n");
+
+    /* Test 3: Handles are distinct, non-zero multiples of 4 */
+    printf("3. Checking handle values...\n");
+    count = (long)STRESS_THREADS * HANDLES_PER_THREAD;
+    sorted = malloc(count * sizeof(*sorted));
+    if (!sorted) {
+        printf("   FAILED: out of memory\n");
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    memcpy(sorted, handles, count * sizeof(*sorted));
+    qsort(sorted, count, sizeof(*sorted), compare_handles);
+    for (i = 0; i < count; i++) {
+        if (sorted[i] == 0 || (sorted[i] & 3)) {
+            printf("   FAILED: handle 0x%lx is not a non-zero multiple of 4\n", sorted[i]);
+            failed = 1;
+            break;
+        }
+        if (i > 0 && sorted[i] == sorted[i - 1]) {
+            printf("   FAILED: handle 0x%lx was handed out twice\n", sorted[i]);
+            failed = 1;
+            break;
+        }
+    }
+    free(sorted);
+    if (failed) {
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    printf("   SUCCESS\n\n");
+
+    /* Test 4: Lookup cost does not grow with the table */
+    printf("4. NtSetEvent - Lookup time after growth...\n");
+    large_ns = lookup_ns(STRESS_THREADS);
+    printf("   %d handles open: %.0f ns/call (%.0f ns/call with %d)\n",
+           HANDLES_PER_THREAD * STRESS_THREADS, large_ns, small_ns, HANDLES_PER_THREAD);
+    if (large_ns > small_ns * 4) {
+        printf("   FAILED: lookups slow down with the table size\n\n");
+        failed = 1;
+    } else {
+        printf("   SUCCESS\n\n");
+    }
+
+    /* Test 5: A closed handle's value is handed out again */
+    printf("5. NtClose - Reusing a closed handle value...\n");
+    lsw_call(LSW_SYSCALL_NtClose, 1, handles[0][0], 0, &ret);
+    reused = lsw_call(LSW_SYSCALL_NtCreateEvent, 2, 0, 0, &ret);
+    if (reused != handles[0][0]) {
+        printf("   FAILED: got 0x%lx, expected 0x%lx\n\n", reused, handles[0][0]);
+        failed = 1;
+    } else {
+        printf("   SUCCESS: handle=0x%lx\n\n", reused);
+    }
+    handles[0][0] = reused;
+
+    /* Test 6: Concurrent close */
+    printf("6. NtClose - Closing handles concurrently...\n");
+    count = run_threads(close_thread, 0);
+    if (count) {
+        printf("   FAILED: %ld closes failed\n\n", count);
+        failed = 1;
+    } else {
+        printf("   SUCCESS\n\n");
+    }
+
+    lsw_kernel_close(lsw_fd);
+
+    printf("=== Handle Table Stress Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
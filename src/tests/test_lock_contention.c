@@ -0,0 +1,219 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Lock Contention Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Measures the Win32 lock manager (LockFileEx ranges and CreateFile
+ * share modes) with 1-8 threads, each on its own open of one file,
+ * against bare F_OFD_SETLK calls on the same opens
+ */
+
+#define _GNU_SOURCE  /* F_OFD_SETLK */
+
+#include "win32_lock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_PATH        "/tmp/lsw_lock_contention.bin"
+#define TEST_ITERATIONS  20000
+#define MAX_THREADS      8
+
+enum bench_mode {
+    MODE_OFD_OWN,       /* fcntl, each thread its own range */
+    MODE_LOCK_OWN,      /* win32_lock_range, each thread its own range */
+    MODE_OFD_SAME,      /* fcntl, everyone on one range, waiting */
+    MODE_LOCK_SAME,     /* win32_lock_range, everyone on one range, waiting */
+    MODE_SHARE,         /* open + read share check + close */
+};
+
+struct worker {
+    pthread_t thread;
+    int fd;
+    int index;
+    enum bench_mode mode;
+    int failed;
+};
+
+static pthread_barrier_t start_barrier;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int ofd_lock(int fd, short type, off_t start, int wait)
+{
+    struct flock fl;
+
+    memset(&fl, 0, sizeof(fl));
+    fl.l_type = type;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = 64;
+    return fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl);
+}
+
+static void* worker_main(void* arg)
+{
+    struct worker* w = arg;
+    uint64_t off = (uint64_t)w->index * 4096;
+    int i;
+
+    pthread_barrier_wait(&start_barrier);
+
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        switch (w->mode) {
+        case MODE_OFD_OWN:
+            if (ofd_lock(w->fd, F_WRLCK, (off_t)off, 0) != 0) w->failed = 1;
+            ofd_lock(w->fd, F_UNLCK, (off_t)off, 0);
+            break;
+        case MODE_LOCK_OWN:
+            if (win32_lock_range(w->fd, off, 64, WIN32_LOCK_EXCLUSIVE) != 0) w->failed = 1;
+            if (win32_unlock_range(w->fd, off, 64) != 0) w->failed = 1;
+            break;
+        case MODE_OFD_SAME:
+            if (ofd_lock(w->fd, F_WRLCK, 0, 1) != 0) w->failed = 1;
+            ofd_lock(w->fd, F_UNLCK, 0, 0);
+            break;
+        case MODE_LOCK_SAME:
+            if (win32_lock_range(w->fd, 0, 64, WIN32_LOCK_EXCLUSIVE | WIN32_LOCK_WAIT) != 0)
+                w->failed = 1;
+            if (win32_unlock_range(w->fd, 0, 64) != 0) w->failed = 1;
+            break;
+        case MODE_SHARE: {
+            int fd = open(TEST_PATH, O_RDWR);
+
+            if (win32_share_acquire(fd, WIN32_SHARE_READ, WIN32_SHARE_READ | WIN32_SHARE_WRITE) != 0)
+                w->failed = 1;
+            close(fd);
+            break;
+        }
+        }
+    }
+    return NULL;
+}
+
+/* Runs `mode` on `threads` threads; returns ns per operation per thread, or -1 */
+static double run(enum bench_mode mode, int threads)
+{
+    struct worker workers[MAX_THREADS];
+    double start, elapsed;
+    int failed = 0;
+    int i;
+
+    pthread_barrier_init(&start_barrier, NULL, (unsigned)threads + 1);
+    for (i = 0; i < threads; i++) {
+        workers[i].fd = open(TEST_PATH, O_RDWR);
+        workers[i].index = i;
+        workers[i].mode = mode;
+        workers[i].failed = 0;
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    pthread_barrier_wait(&start_barrier);
+    start = now_ns();
+    for (i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    elapsed = now_ns() - start;
+
+    for (i = 0; i < threads; i++) {
+        failed |= workers[i].failed;
+        win32_lock_forget(workers[i].fd);
+        close(workers[i].fd);
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    return failed ? -1 : elapsed / TEST_ITERATIONS;
+}
+
+static int report(const char* name, enum bench_mode mode)
+{
+    static const int counts[] = { 1, 2, 4, 8 };
+    int failed = 0;
+    unsigned i;
+
+    printf("   %-36s", name);
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        double ns = run(mode, counts[i]);
+        if (ns < 0) {
+            printf("   FAILED");
+            failed = 1;
+        } else {
+            printf(" %8.0f", ns);
+        }
+    }
+    printf("\n");
+    return failed;
+}
+
+int main(void)
+{
+    int failed = 0;
+    int deny_fd;
+    int fd;
+
+    printf("=== LSW Lock Contention Test ===\n");
+    printf("%d operations per thread, ns per operation (wall time / iterations)\n\n",
+           TEST_ITERATIONS);
+
+    fd = open(TEST_PATH, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, 65536) != 0) {
+        printf("FAILED: Could not create %s\n", TEST_PATH);
+        return 1;
+    }
+    close(fd);
+
+    /* Test 1: Access checks */
+    printf("1. Lock kinds the open cannot hold are refused...\n");
+    fd = open(TEST_PATH, O_RDONLY);
+    if (win32_lock_range(fd, 0, 1, WIN32_LOCK_EXCLUSIVE) != EACCES ||
+        win32_lock_range(fd, 0, 1, 0) != 0) {
+        printf("   FAILED: exclusive lock on a read-only open was not refused\n\n");
+        failed = 1;
+    } else {
+        printf("   SUCCESS\n\n");
+    }
+    win32_lock_forget(fd);
+    close(fd);
+
+    /* Test 2: Byte-range locks */
+    printf("2. LockFileEx lock + unlock            threads:   1        2        4        8\n");
+    failed |= report("fcntl, own range", MODE_OFD_OWN);
+    failed |= report("win32_lock_range, own range", MODE_LOCK_OWN);
+    failed |= report("fcntl, one range, waiting", MODE_OFD_SAME);
+    failed |= report("win32_lock_range, one range, waiting", MODE_LOCK_SAME);
+    printf("\n");
+
+    /* Test 3: Share modes */
+    printf("3. open + share check + close          threads:   1        2        4        8\n");
+    failed |= report("read opens", MODE_SHARE);
+    deny_fd = open(TEST_PATH, O_RDWR);
+    if (win32_share_acquire(deny_fd, WIN32_SHARE_READ, WIN32_SHARE_READ) != 0) {
+        printf("   FAILED: could not open the denying handle\n");
+        failed = 1;
+    }
+    failed |= report("read opens, a writer-denying handle", MODE_SHARE);
+    fd = open(TEST_PATH, O_RDWR);
+    if (win32_share_acquire(fd, WIN32_SHARE_WRITE, WIN32_SHARE_READ | WIN32_SHARE_WRITE) != EBUSY) {
+        printf("   FAILED: a writer got past FILE_SHARE_READ\n");
+        failed = 1;
+    }
+    close(fd);
+    close(deny_fd);
+    printf("\n");
+
+    unlink(TEST_PATH);
+
+    printf("=== Lock Contention Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,149 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Process Spawn Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Measures starting and reaping /bin/true through win32_spawn (what
+ * CreateProcess uses) against fork + exec, with 0 MiB to 1 GiB of
+ * memory resident in the parent
+ */
+
+#include "win32_spawn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_ITERATIONS  20
+#define TEST_PROGRAM     "/bin/true"
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Returns 0 when the child ran and exited 0 */
+static int spawn_once(int use_fork)
+{
+    char* argv[] = { TEST_PROGRAM, NULL };
+    int status;
+    pid_t pid;
+
+    if (use_fork) {
+        pid = fork();
+        if (pid < 0) return -1;
+        if (pid == 0) {
+            execv(TEST_PROGRAM, argv);
+            _exit(127);
+        }
+    } else {
+        win32_spawn_t sp;
+        int resume_fd;
+
+        memset(&sp, 0, sizeof(sp));
+        sp.path = TEST_PROGRAM;
+        sp.argv = argv;
+        sp.std_fd[0] = sp.std_fd[1] = sp.std_fd[2] = WIN32_SPAWN_KEEP;
+        if (win32_spawn(&sp, &pid, &resume_fd) != 0) return -1;
+    }
+    if (waitpid(pid, &status, 0) != pid) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+/* Returns us per start + wait, or -1 */
+static double run(int use_fork)
+{
+    double start;
+    int i;
+
+    start = now_ns();
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        if (spawn_once(use_fork) != 0) return -1;
+    }
+    return (now_ns() - start) / TEST_ITERATIONS / 1000.0;
+}
+
+int main(void)
+{
+    static const size_t resident_mib[] = { 0, 64, 256, 1024 };
+    int failed = 0;
+    unsigned i;
+
+    printf("=== LSW Process Spawn Test ===\n");
+    printf("%d children per case, us per start + wait of %s\n\n", TEST_ITERATIONS, TEST_PROGRAM);
+
+    /* Test 1: Standard handles reach the child */
+    printf("1. Redirected stdout...\n");
+    {
+        char* argv[] = { "/bin/echo", "lsw", NULL };
+        win32_spawn_t sp;
+        char buf[16] = { 0 };
+        int pipe_fd[2];
+        int resume_fd;
+        int status = -1;
+        int rc;
+        pid_t pid;
+
+        memset(&sp, 0, sizeof(sp));
+        sp.path = argv[0];
+        sp.argv = argv;
+        if (pipe(pipe_fd) != 0) {
+            printf("   FAILED: Could not create a pipe\n\n");
+            failed = 1;
+        } else {
+            sp.std_fd[0] = WIN32_SPAWN_NULL;
+            sp.std_fd[1] = pipe_fd[1];
+            sp.std_fd[2] = WIN32_SPAWN_KEEP;
+            rc = win32_spawn(&sp, &pid, &resume_fd);
+            close(pipe_fd[1]);
+            if (rc != 0) {
+                printf("   FAILED: Could not spawn %s\n\n", argv[0]);
+                failed = 1;
+            } else {
+                if (read(pipe_fd[0], buf, sizeof(buf) - 1) != 4 || strcmp(buf, "lsw\n") != 0 ||
+                    waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    printf("   FAILED: read \"%s\", child status 0x%x\n\n", buf, status);
+                    failed = 1;
+                } else {
+                    printf("   SUCCESS\n\n");
+                }
+            }
+            close(pipe_fd[0]);
+        }
+    }
+
+    /* Test 2: Cost against the parent's resident set */
+    printf("2. Start + wait                    win32_spawn   fork + exec\n");
+    for (i = 0; i < sizeof(resident_mib) / sizeof(resident_mib[0]); i++) {
+        size_t size = resident_mib[i] << 20;
+        void* mem = NULL;
+        double spawn_us, fork_us;
+
+        if (size) {
+            mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                printf("   FAILED: Could not map %zu MiB\n", resident_mib[i]);
+                failed = 1;
+                continue;
+            }
+            memset(mem, 1, size);
+        }
+
+        spawn_us = run(0);
+        fork_us = run(1);
+        printf("   %4zu MiB resident %19.0f %13.0f\n", resident_mib[i], spawn_us, fork_us);
+        if (spawn_us < 0 || fork_us < 0) failed = 1;
+
+        if (mem) munmap(mem, size);
+    }
+    printf("\n");
+
+    printf("=== Process Spawn Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,258 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Syscall Ring Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Runs open/query/read/close sequences once as separate ioctls and once
+ * as a linked chain through the shared-memory ring, and compares the cost
+ */
+
+#include "shared/lsw_kernel_client.h"
+#include "shared/lsw_kernel_ring.h"
+#include "shared/lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#define LSW_IOCTL_SYSCALL _IOWR(LSW_IOCTL_MAGIC, 5, struct lsw_syscall_request)
+
+/* Win32 access flags and creation disposition */
+#define LSW_GENERIC_READ          0x80000000
+#define LSW_OPEN_EXISTING         3
+
+#define TEST_PATH        "/tmp/lsw_ring_test.txt"
+#define TEST_DATA        "LSW syscall ring test data\n"
+#define TEST_ITERATIONS  10000
+
+static int lsw_fd;
+static char path[256] = TEST_PATH;
+static char buffer[256];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void fill_open(struct lsw_syscall_request* req)
+{
+    req->syscall_number = LSW_SYSCALL_NtCreateFile;
+    req->arg_count = 3;
+    req->args[0] = (uint64_t)(uintptr_t)path;
+    req->args[1] = LSW_GENERIC_READ;
+    req->args[2] = LSW_OPEN_EXISTING;
+}
+
+static void fill_size(struct lsw_syscall_request* req, uint64_t handle)
+{
+    req->syscall_number = LSW_SYSCALL_LswGetFileSize;
+    req->arg_count = 1;
+    req->args[0] = handle;
+}
+
+static void fill_read(struct lsw_syscall_request* req, uint64_t handle)
+{
+    req->syscall_number = LSW_SYSCALL_NtReadFile;
+    req->arg_count = 3;
+    req->args[0] = handle;
+    req->args[1] = (uint64_t)(uintptr_t)buffer;
+    req->args[2] = sizeof(buffer);
+}
+
+static void fill_close(struct lsw_syscall_request* req, uint64_t handle)
+{
+    req->syscall_number = LSW_SYSCALL_NtClose;
+    req->arg_count = 1;
+    req->args[0] = handle;
+}
+
+/* One sequence as four ioctls; returns bytes read or -1 */
+static int64_t sequence_ioctl(void)
+{
+    struct lsw_syscall_request req;
+    uint64_t handle;
+    int64_t got;
+
+    memset(&req, 0, sizeof(req));
+    fill_open(&req);
+    if (ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req) < 0 || req.error_code) {
+        return -1;
+    }
+    handle = req.return_value;
+
+    memset(&req, 0, sizeof(req));
+    fill_size(&req, handle);
+    ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req);
+
+    memset(&req, 0, sizeof(req));
+    fill_read(&req, handle);
+    ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req);
+    got = req.error_code ? -1 : (int64_t)req.return_value;
+
+    memset(&req, 0, sizeof(req));
+    fill_close(&req, handle);
+    ioctl(lsw_fd, LSW_IOCTL_SYSCALL, &req);
+
+    return got;
+}
+
+/* One sequence as a linked chain in one ring enter; returns bytes read or -1 */
+static int64_t sequence_ring(struct lsw_kernel_ring* ring)
+{
+    struct lsw_ring_sqe* sqe;
+    struct lsw_ring_cqe* cqe;
+    int64_t got = -1;
+
+    sqe = lsw_kernel_ring_get_sqe(ring);
+    fill_open(&sqe->req);
+    sqe->user_data = 0;
+
+    sqe = lsw_kernel_ring_get_sqe(ring);
+    fill_size(&sqe->req, 0);
+    sqe->flags = LSW_RING_SQE_LINK;
+    sqe->user_data = 1;
+
+    sqe = lsw_kernel_ring_get_sqe(ring);
+    fill_read(&sqe->req, 0);
+    sqe->flags = LSW_RING_SQE_LINK;
+    sqe->user_data = 2;
+
+    sqe = lsw_kernel_ring_get_sqe(ring);
+    fill_close(&sqe->req, 0);
+    sqe->flags = LSW_RING_SQE_LINK;
+    sqe->user_data = 3;
+
+    if (lsw_kernel_ring_submit(ring) != 4) {
+        return -1;
+    }
+
+    while ((cqe = lsw_kernel_ring_peek_cqe(ring)) != NULL) {
+        if (cqe->user_data == 2 && cqe->error_code == 0) {
+            got = (int64_t)cqe->return_value;
+        }
+        lsw_kernel_ring_cqe_seen(ring);
+    }
+    return got;
+}
+
+int main(void)
+{
+    struct lsw_kernel_ring ring;
+    struct lsw_ring_sqe* sqe;
+    struct lsw_ring_cqe* cqe;
+    int64_t expected = (int64_t)strlen(TEST_DATA);
+    double start, ioctl_ns, ring_ns;
+    int failed = 0;
+    int i;
+    int fd;
+
+    printf("=== LSW Syscall Ring Test ===\n");
+    printf("open/query/read/close x %d\n\n", TEST_ITERATIONS);
+
+    fd = open(TEST_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, TEST_DATA, expected) != expected) {
+        printf("FAILED: Could not create %s\n", TEST_PATH);
+        return 1;
+    }
+    close(fd);
+
+    lsw_fd = lsw_kernel_open();
+    if (lsw_fd < 0) {
+        printf("FAILED: Could not open /dev/lsw\n");
+        return 1;
+    }
+
+    /* Test 1: Ring setup */
+    printf("1. LSW_IOCTL_RING_SETUP - Mapping a 64-entry ring...\n");
+    if (lsw_kernel_ring_init(lsw_fd, 64, &ring) != 0) {
+        printf("   FAILED\n");
+        lsw_kernel_close(lsw_fd);
+        return 1;
+    }
+    printf("   SUCCESS: %u entries\n\n", ring.hdr->entries);
+
+    /* Test 2: Chained sequence gives the same result as separate calls */
+    printf("2. Linked chain - open/query/read/close in one enter...\n");
+    if (sequence_ring(&ring) != expected || sequence_ioctl() != expected) {
+        printf("   FAILED\n");
+        failed = 1;
+    } else {
+        printf("   SUCCESS: read %ld bytes both ways\n\n", expected);
+    }
+
+    /* Test 3: A failed chain head cancels the linked entries */
+    printf("3. Linked chain - cancelled after a failed open...\n");
+    strcpy(path, "/nonexistent/lsw_ring_test.txt");
+    sqe = lsw_kernel_ring_get_sqe(&ring);
+    fill_open(&sqe->req);
+    sqe = lsw_kernel_ring_get_sqe(&ring);
+    fill_close(&sqe->req, 0);
+    sqe->flags = LSW_RING_SQE_LINK;
+    lsw_kernel_ring_submit(&ring);
+    lsw_kernel_ring_cqe_seen(&ring);
+    cqe = lsw_kernel_ring_peek_cqe(&ring);
+    if (!cqe || cqe->error_code != -ECANCELED) {
+        printf("   FAILED: linked close was not cancelled\n");
+        failed = 1;
+    } else {
+        printf("   SUCCESS\n\n");
+    }
+    if (cqe) {
+        lsw_kernel_ring_cqe_seen(&ring);
+    }
+    strcpy(path, TEST_PATH);
+
+    /* Test 4: An entry that would not return is refused, and the ring carries on */
+    printf("4. NtTerminateThread through the ring...\n");
+    sqe = lsw_kernel_ring_get_sqe(&ring);
+    sqe->req.syscall_number = LSW_SYSCALL_NtTerminateThread;
+    sqe->req.arg_count = 2;
+    cqe = NULL;
+    if (lsw_kernel_ring_submit(&ring) == 1) {
+        cqe = lsw_kernel_ring_peek_cqe(&ring);
+    }
+    i = cqe ? cqe->error_code : 0;
+    if (cqe) {
+        lsw_kernel_ring_cqe_seen(&ring);
+    }
+    if (i != -EOPNOTSUPP) {
+        printf("   FAILED: not refused\n");
+        failed = 1;
+    } else if (sequence_ring(&ring) != expected) {
+        printf("   FAILED: the ring stopped working afterwards\n");
+        failed = 1;
+    } else {
+        printf("   SUCCESS: refused with -EOPNOTSUPP\n\n");
+    }
+
+    /* Test 5: Cost per sequence */
+    printf("5. Cost per sequence...\n");
+    start = now_ns();
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        sequence_ioctl();
+    }
+    ioctl_ns = (now_ns() - start) / TEST_ITERATIONS;
+
+    start = now_ns();
+    for (i = 0; i < TEST_ITERATIONS; i++) {
+        sequence_ring(&ring);
+    }
+    ring_ns = (now_ns() - start) / TEST_ITERATIONS;
+
+    printf("   4 ioctls:      %8.0f ns\n", ioctl_ns);
+    printf("   1 ring enter:  %8.0f ns\n\n", ring_ns);
+
+    lsw_kernel_ring_exit(&ring);
+    lsw_kernel_close(lsw_fd);
+    unlink(TEST_PATH);
+
+    printf("=== Syscall Ring Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -0,0 +1,232 @@
+/*
+ * LSW (Linux Subsystem for Windows) - Unwind Walk Test
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under Barrer Free Software License (BFSL) v1.2
+ *
+ * Times the frame walk a C++ throw performs to reach its catch, through
+ * 10, 50 and 200 frames: per frame, a function table lookup, an unwind
+ * to the caller and a handler lookup. The frames are synthetic (x64
+ * UNWIND_INFO in a heap "image"), half of them plain, half a chained
+ * fragment of a function with a language handler, like a catch site.
+ */
+
+#include "win32_unwind.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define IMAGE_SIZE       0x4000
+#define STACK_SLOTS      4096
+#define TEST_ITERATIONS  20000
+
+/* F1: push rbp; push rbx; sub rsp,0x28 - no handler */
+#define F1_RVA           0x100
+#define F1_RIP           0x150
+#define F1_SLOTS         8          /* return address, two pushes, 0x28 */
+/* F2: sub rsp,0x48; mov [rsp+0x40],rsi - has a handler; F3 is a chained
+ * fragment of it, which is where the frames stop */
+#define F2_RVA           0x300
+#define F3_RVA           0x320
+#define F3_RIP           0x330
+#define F2_SLOTS         10         /* return address, 0x48 */
+#define HANDLER_RVA      0x5555
+
+static uint8_t* image;
+static uint64_t stack_slots[STACK_SLOTS];
+static win32_runtime_function_t table[3] = {
+    { F1_RVA, 0x200, 0x1000 },
+    { F2_RVA, F3_RVA, 0x1100 },
+    { F3_RVA, 0x340, 0x1200 },
+};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void put_code(uint32_t unwind_rva, int index, uint8_t prolog_offset, uint8_t op, uint8_t info)
+{
+    uint16_t code = (uint16_t)(prolog_offset | (op << 8) | (info << 12));
+
+    memcpy(image + unwind_rva + 4 + 2 * index, &code, 2);
+}
+
+static int build_image(void)
+{
+    uint8_t* u;
+    uint32_t handler = HANDLER_RVA;
+
+    image = calloc(1, IMAGE_SIZE);
+    if (!image) return -1;
+
+    /* F1: codes in reverse prolog order */
+    u = image + 0x1000;
+    u[0] = 1; u[1] = 6; u[2] = 3; u[3] = 0;
+    put_code(0x1000, 0, 6, 2 /* ALLOC_SMALL */, 4);
+    put_code(0x1000, 1, 2, 0 /* PUSH_NONVOL */, 3);
+    put_code(0x1000, 2, 1, 0 /* PUSH_NONVOL */, 5);
+
+    /* F2: UNW_FLAG_EHANDLER; the handler RVA follows the (even) codes */
+    u = image + 0x1100;
+    u[0] = 1 | (1 << 3); u[1] = 9; u[2] = 3; u[3] = 0;
+    put_code(0x1100, 0, 9, 4 /* SAVE_NONVOL */, 6);
+    put_code(0x1100, 1, 8, 0, 0);                      /* its offset / 8 */
+    put_code(0x1100, 2, 4, 2 /* ALLOC_SMALL */, 8);
+    memcpy(image + 0x1100 + 4 + 8, &handler, 4);
+
+    /* F3: UNW_FLAG_CHAININFO back to F2 */
+    u = image + 0x1200;
+    u[0] = 1 | (4 << 3); u[1] = 0; u[2] = 0; u[3] = 0;
+    memcpy(image + 0x1204, &table[1], sizeof(table[1]));
+
+    return win32_ftab_add_table(table, 3, (uint64_t)(uintptr_t)image);
+}
+
+/*
+ * Lay out `frames` frames, outermost first, alternating F1 and F3; the
+ * outermost returns to 0. Returns the innermost RIP and body RSP.
+ */
+static void build_stack(int frames, uint64_t* rip, uint64_t* rsp)
+{
+    uint64_t base = (uint64_t)(uintptr_t)image;
+    uint64_t ret = 0;
+    int slot = STACK_SLOTS - 1;
+    int i;
+
+    for (i = 0; i < frames; i++) {
+        int fragment = i & 1;
+        int size = fragment ? F2_SLOTS : F1_SLOTS;
+
+        stack_slots[slot] = ret;
+        *rip = base + (fragment ? F3_RIP : F1_RIP);
+        *rsp = (uint64_t)(uintptr_t)&stack_slots[slot - size + 1];
+        ret = *rip;
+        slot -= size;
+    }
+}
+
+/*
+ * The search phase of a throw: walk to the outermost frame, looking up
+ * each frame's handler. Returns the number of frames walked, or -1;
+ * `handlers` gets the number of frames with a handler.
+ */
+static int walk(uint64_t rip, uint64_t rsp, int flush, int* handlers)
+{
+    int frames = 0;
+
+    *handlers = 0;
+    while (rip) {
+        const win32_runtime_function_t* rf;
+        uint64_t image_base, caller_rip, caller_rsp;
+        uint32_t flags;
+        void* data;
+
+        if (flush) win32_unwind_flush();
+        rf = win32_ftab_lookup(rip, &image_base, NULL);
+        if (!rf) return -1;
+        if (!win32_unwind_rsp(image_base, rf, rsp, &caller_rip, &caller_rsp)) return -1;
+        if (win32_unwind_handler(image_base, rf, &flags, &data) == image_base + HANDLER_RVA)
+            (*handlers)++;
+        frames++;
+        rip = caller_rip;
+        rsp = caller_rsp;
+    }
+    return frames;
+}
+
+int main(void)
+{
+    static const int depths[] = { 10, 50, 200 };
+    int failed = 0;
+    unsigned d;
+
+    printf("=== LSW Unwind Walk Test ===\n");
+    printf("%d walks per depth, ns per frame\n\n", TEST_ITERATIONS);
+
+    if (build_image() != 0) {
+        printf("FAILED: Could not register the function table\n");
+        return 1;
+    }
+
+    /* Test 1: The walk reaches every frame and every handler */
+    printf("1. Walking synthetic stacks...\n");
+    for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        uint64_t rip = 0, rsp = 0;
+        int handlers;
+        int frames;
+
+        build_stack(depths[d], &rip, &rsp);
+        frames = walk(rip, rsp, 0, &handlers);
+        if (frames != depths[d] || handlers != depths[d] / 2) {
+            printf("   FAILED: %d frames: walked %d, %d handlers\n", depths[d], frames, handlers);
+            failed = 1;
+        }
+    }
+    if (!failed) printf("   SUCCESS\n");
+    printf("\n");
+
+    /* Test 2: Cost per frame, with the recipe cache and decoding every frame */
+    printf("2. Throw search walk                    frames:  10       50      200\n");
+    printf("   %-36s", "recipe cache");
+    for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        uint64_t rip = 0, rsp = 0;
+        int handlers;
+        double start;
+        int i;
+
+        build_stack(depths[d], &rip, &rsp);
+        start = now_ns();
+        for (i = 0; i < TEST_ITERATIONS; i++) {
+            if (walk(rip, rsp, 0, &handlers) != depths[d]) failed = 1;
+        }
+        printf(" %8.1f", (now_ns() - start) / TEST_ITERATIONS / depths[d]);
+    }
+    printf("\n   %-36s", "decode every frame (cache flushed)");
+    for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        uint64_t rip = 0, rsp = 0;
+        int handlers;
+        double start;
+        int i;
+
+        build_stack(depths[d], &rip, &rsp);
+        start = now_ns();
+        for (i = 0; i < TEST_ITERATIONS; i++) {
+            if (walk(rip, rsp, 1, &handlers) != depths[d]) failed = 1;
+        }
+        printf(" %8.1f", (now_ns() - start) / TEST_ITERATIONS / depths[d]);
+    }
+    printf("\n\n");
+
+    /* Test 3: RtlCaptureStackBackTrace's walk */
+    printf("3. Back trace                           frames:  10       50      200\n");
+    printf("   %-36s", "win32_unwind_backtrace");
+    for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        win32_unwind_regs_t start_regs, regs;
+        void* out[256];
+        double start;
+        int i;
+
+        memset(&start_regs, 0, sizeof(start_regs));
+        build_stack(depths[d], &start_regs.rip, &start_regs.gpr[WIN32_REG_RSP]);
+        regs = start_regs;
+        if (win32_unwind_backtrace(&regs, 0, 256, out) != (uint32_t)depths[d]) {
+            printf("   FAILED");
+            failed = 1;
+            continue;
+        }
+        start = now_ns();
+        for (i = 0; i < TEST_ITERATIONS; i++) {
+            regs = start_regs;
+            win32_unwind_backtrace(&regs, 0, 256, out);
+        }
+        printf(" %8.1f", (now_ns() - start) / TEST_ITERATIONS / depths[d]);
+    }
+    printf("\n\n");
+
+    printf("=== Unwind Walk Test %s ===\n", failed ? "FAILED" : "Complete");
+    return failed;
+}
@@ -211,7 +211,7 @@ LSTATUS __attribute__((ms_abi)) lsw_RegQueryValueExW(HKEY hKey, LPCWSTR lpValueN
     char name[256] = {0};
     LSW_UNUSED(lpReserved);
     if (lpValueName) wstr_to_utf8(lpValueName, name, sizeof(name));
-    LSW_LOG_INFO("RegQueryValueExW: hKey=%p value='%s'", hKey, name);
+    LSW_LOG_DEBUG("RegQueryValueExW: hKey=%p value='%s'", hKey, name);
     lsw_hkey_t lhk;
     HANDLE h;
     /* If predefined handle, open root key first */
@@ -343,7 +343,7 @@ LSTATUS __attribute__((ms_abi)) lsw_RegDeleteValueA(HKEY hKey, LPCSTR lpValueNam
 
 LSTATUS __attribute__((ms_abi)) lsw_RegEnumKeyExW(HKEY hKey, DWORD dwIndex, LPWSTR lpName, DWORD* lpcchName, DWORD* lpReserved, LPWSTR lpClass, DWORD* lpcchClass, void* lpftLastWriteTime) {
     LSW_UNUSED(lpReserved); LSW_UNUSED(lpClass); LSW_UNUSED(lpcchClass); LSW_UNUSED(lpftLastWriteTime);
-    LSW_LOG_INFO("RegEnumKeyExW: hKey=%p index=%u", hKey, (unsigned)dwIndex);
+    LSW_LOG_DEBUG("RegEnumKeyExW: hKey=%p index=%u", hKey, (unsigned)dwIndex);
     if (!lpName || !lpcchName || *lpcchName == 0) return 234L; /* ERROR_MORE_DATA */
     lsw_hkey_t lhk;
     HANDLE h;
@@ -356,6 +356,7 @@ LSTATUS __attribute__((ms_abi)) lsw_RegEnumKeyExW(HKEY hKey, DWORD dwIndex, LPWS
     lsw_status_t s = lsw_reg_enum_keys(h, dwIndex, name_utf8, sizeof(name_utf8));
     if (w32_hkey_to_lsw(hKey, &lhk)) lsw_reg_close_key(h);
     if (s != LSW_SUCCESS) return 259L; /* ERROR_NO_MORE_ITEMS */
+    if (strlen(name_utf8) >= *lpcchName) return 234L;
     /* Convert UTF-8 → UTF-16LE */
     DWORD i = 0;
     const char *p = name_utf8;
@@ -375,15 +376,27 @@ LSTATUS __attribute__((ms_abi)) lsw_RegEnumKeyExA(HKEY hKey, DWORD dwIndex, LPST
     } else {
         h = (HANDLE)hKey;
     }
-    lsw_status_t s = lsw_reg_enum_keys(h, dwIndex, lpName, (size_t)*lpcchName);
+    char name[256] = {0};
+    lsw_status_t s = lsw_reg_enum_keys(h, dwIndex, name, sizeof(name));
     if (w32_hkey_to_lsw(hKey, &lhk)) lsw_reg_close_key(h);
     if (s != LSW_SUCCESS) return 259L;
-    *lpcchName = (DWORD)strlen(lpName);
+    size_t len = strlen(name);
+    if (len >= *lpcchName) return 234L;
+    memcpy(lpName, name, len + 1);
+    *lpcchName = (DWORD)len;
     return 0L;
 }
 
+/* Value data for RegEnumValue: same contract as RegQueryValueEx */
+static void reg_enum_value_data(HANDLE h, const char* name, uint8_t* lpData, DWORD* lpcbData)
+{
+    if (!lpcbData) return;
+    size_t sz = (size_t)*lpcbData;
+    if (lsw_reg_query_value(h, name, NULL, lpData, &sz) == LSW_SUCCESS) *lpcbData = (DWORD)sz;
+}
+
 LSTATUS __attribute__((ms_abi)) lsw_RegEnumValueW(HKEY hKey, DWORD dwIndex, LPWSTR lpValueName, DWORD* lpcchValueName, DWORD* lpReserved, DWORD* lpType, uint8_t* lpData, DWORD* lpcbData) {
-    LSW_UNUSED(lpReserved); LSW_UNUSED(lpData); LSW_UNUSED(lpcbData);
+    LSW_UNUSED(lpReserved);
     if (!lpValueName || !lpcchValueName || *lpcchValueName == 0) return 234L;
     lsw_hkey_t lhk;
     HANDLE h;
@@ -395,8 +408,10 @@ LSTATUS __attribute__((ms_abi)) lsw_RegEnumValueW(HKEY hKey, DWORD dwIndex, LPWS
     char name_utf8[256] = {0};
     lsw_reg_type_t type = LSW_REG_BINARY;
     lsw_status_t s = lsw_reg_enum_values(h, dwIndex, name_utf8, sizeof(name_utf8), &type);
+    if (s == LSW_SUCCESS && strlen(name_utf8) < *lpcchValueName) reg_enum_value_data(h, name_utf8, lpData, lpcbData);
     if (w32_hkey_to_lsw(hKey, &lhk)) lsw_reg_close_key(h);
     if (s != LSW_SUCCESS) return 259L;
+    if (strlen(name_utf8) >= *lpcchValueName) return 234L;
     DWORD i = 0;
     const char *p = name_utf8;
     while (*p && i + 1 < *lpcchValueName) lpValueName[i++] = (uint16_t)(unsigned char)*p++;
@@ -407,7 +422,7 @@ LSTATUS __attribute__((ms_abi)) lsw_RegEnumValueW(HKEY hKey, DWORD dwIndex, LPWS
 }
 
 LSTATUS __attribute__((ms_abi)) lsw_RegEnumValueA(HKEY hKey, DWORD dwIndex, LPSTR lpValueName, DWORD* lpcchValueName, DWORD* lpReserved, DWORD* lpType, uint8_t* lpData, DWORD* lpcbData) {
-    LSW_UNUSED(lpReserved); LSW_UNUSED(lpData); LSW_UNUSED(lpcbData);
+    LSW_UNUSED(lpReserved);
     if (!lpValueName || !lpcchValueName || *lpcchValueName == 0) return 234L;
     lsw_hkey_t lhk;
     HANDLE h;
@@ -416,82 +431,65 @@ LSTATUS __attribute__((ms_abi)) lsw_RegEnumValueA(HKEY hKey, DWORD dwIndex, LPST
     } else {
         h = (HANDLE)hKey;
     }
+    char name[256] = {0};
     lsw_reg_type_t type = LSW_REG_BINARY;
-    lsw_status_t s = lsw_reg_enum_values(h, dwIndex, lpValueName, (size_t)*lpcchValueName, &type);
+    lsw_status_t s = lsw_reg_enum_values(h, dwIndex, name, sizeof(name), &type);
+    size_t len = strlen(name);
+    if (s == LSW_SUCCESS && len < *lpcchValueName) reg_enum_value_data(h, name, lpData, lpcbData);
     if (w32_hkey_to_lsw(hKey, &lhk)) lsw_reg_close_key(h);
     if (s != LSW_SUCCESS) return 259L;
-    *lpcchValueName = (DWORD)strlen(lpValueName);
+    if (len >= *lpcchValueName) return 234L;
+    memcpy(lpValueName, name, len + 1);
+    *lpcchValueName = (DWORD)len;
     if (lpType) *lpType = lsw_type_to_w32(type);
     return 0L;
 }
 
-LSTATUS __attribute__((ms_abi)) lsw_RegQueryInfoKeyW(HKEY hKey, LPWSTR lpClass, DWORD* lpcchClass, DWORD* lpReserved, DWORD* lpcSubKeys, DWORD* lpcbMaxSubKeyLen, DWORD* lpcbMaxClassLen, DWORD* lpcValues, DWORD* lpcbMaxValueNameLen, DWORD* lpcbMaxValueLen, DWORD* lpcbSecurityDescriptor, void* lpftLastWriteTime) {
-    LSW_UNUSED(lpReserved); LSW_UNUSED(lpftLastWriteTime);
-    LSW_LOG_DEBUG("RegQueryInfoKeyW: hKey=%p", hKey);
-
+/* Shared by RegQueryInfoKeyW/A: class and security descriptor are not stored */
+static LSTATUS reg_query_info(HKEY hKey, DWORD* lpcchClass, DWORD* lpcSubKeys, DWORD* lpcbMaxSubKeyLen, DWORD* lpcbMaxClassLen, DWORD* lpcValues, DWORD* lpcbMaxValueNameLen, DWORD* lpcbMaxValueLen, DWORD* lpcbSecurityDescriptor, void* lpftLastWriteTime)
+{
     /* Get/open the handle — predefined keys must be opened first */
     HANDLE h = NULL;
     lsw_hkey_t lhk;
-    if (w32_hkey_to_lsw(hKey, &lhk)) {
-        lsw_reg_open_key(lhk, NULL, &h);
+    int predefined = w32_hkey_to_lsw(hKey, &lhk);
+    if (predefined) {
+        if (lsw_reg_open_key(lhk, NULL, &h) != LSW_SUCCESS) return 2L;
     } else {
         h = (HANDLE)hKey;
     }
 
-    if (lpClass && lpcchClass && *lpcchClass > 0) lpClass[0] = 0;
-    if (lpcchClass) *lpcchClass = 0;
-    if (lpcbMaxClassLen) *lpcbMaxClassLen = 0;
-    if (lpcbSecurityDescriptor) *lpcbSecurityDescriptor = 0;
-
-    /* Count subkeys */
-    uint32_t num_subkeys = 0, max_subkey_len = 0;
-    if (h) {
-        char namebuf[512];
-        for (uint32_t idx = 0; ; idx++) {
-            if (lsw_reg_enum_keys(h, idx, namebuf, sizeof(namebuf)) != LSW_SUCCESS) break;
-            num_subkeys++;
-            size_t nl = strlen(namebuf);
-            if (nl > max_subkey_len) max_subkey_len = (uint32_t)nl;
-        }
-    }
-    if (lpcSubKeys) *lpcSubKeys = num_subkeys;
-    if (lpcbMaxSubKeyLen) *lpcbMaxSubKeyLen = max_subkey_len;
-
-    /* Count values */
-    uint32_t num_values = 0, max_val_name_len = 0, max_val_data_len = 0;
-    if (h) {
-        char namebuf[512];
-        lsw_reg_type_t type;
-        for (uint32_t idx = 0; ; idx++) {
-            if (lsw_reg_enum_values(h, idx, namebuf, sizeof(namebuf), &type) != LSW_SUCCESS) break;
-            num_values++;
-            size_t nl = strlen(namebuf);
-            if (nl > max_val_name_len) max_val_name_len = (uint32_t)nl;
-        }
-    }
-    if (lpcValues) *lpcValues = num_values;
-    if (lpcbMaxValueNameLen) *lpcbMaxValueNameLen = max_val_name_len;
-    if (lpcbMaxValueLen) *lpcbMaxValueLen = max_val_data_len;
-
-    /* Close temporary handle if we opened it for predefined key */
-    if (h && w32_hkey_to_lsw(hKey, &lhk)) lsw_reg_close_key(h);
+    lsw_reg_key_info_t info;
+    lsw_status_t s = lsw_reg_query_info(h, &info);
+    if (predefined) lsw_reg_close_key(h);
+    if (s != LSW_SUCCESS) return lsw_status_to_w32(s);
 
-    LSW_LOG_DEBUG("RegQueryInfoKeyW: subkeys=%u values=%u", num_subkeys, num_values);
+    lsw_zero_u32(lpcchClass);
+    lsw_zero_u32(lpcbMaxClassLen);
+    lsw_zero_u32(lpcbSecurityDescriptor);
+    if (lpftLastWriteTime) memset(lpftLastWriteTime, 0, 8); /* FILETIME */
+    if (lpcSubKeys) *lpcSubKeys = info.subkeys;
+    if (lpcbMaxSubKeyLen) *lpcbMaxSubKeyLen = info.max_subkey_len;
+    if (lpcValues) *lpcValues = info.values;
+    if (lpcbMaxValueNameLen) *lpcbMaxValueNameLen = info.max_value_name_len;
+    if (lpcbMaxValueLen) *lpcbMaxValueLen = info.max_value_len;
+
+    LSW_LOG_DEBUG("RegQueryInfoKey: subkeys=%u values=%u", info.subkeys, info.values);
     return 0L;
 }
 
+LSTATUS __attribute__((ms_abi)) lsw_RegQueryInfoKeyW(HKEY hKey, LPWSTR lpClass, DWORD* lpcchClass, DWORD* lpReserved, DWORD* lpcSubKeys, DWORD* lpcbMaxSubKeyLen, DWORD* lpcbMaxClassLen, DWORD* lpcValues, DWORD* lpcbMaxValueNameLen, DWORD* lpcbMaxValueLen, DWORD* lpcbSecurityDescriptor, void* lpftLastWriteTime) {
+    LSW_UNUSED(lpReserved);
+    LSW_LOG_DEBUG("RegQueryInfoKeyW: hKey=%p", hKey);
+    if (lpClass && lpcchClass && *lpcchClass > 0) lpClass[0] = 0;
+    return reg_query_info(hKey, lpcchClass, lpcSubKeys, lpcbMaxSubKeyLen, lpcbMaxClassLen, lpcValues,
+                          lpcbMaxValueNameLen, lpcbMaxValueLen, lpcbSecurityDescriptor, lpftLastWriteTime);
+}
+
 LSTATUS __attribute__((ms_abi)) lsw_RegQueryInfoKeyA(HKEY hKey, LPSTR lpClass, DWORD* lpcchClass, DWORD* lpReserved, DWORD* lpcSubKeys, DWORD* lpcbMaxSubKeyLen, DWORD* lpcbMaxClassLen, DWORD* lpcValues, DWORD* lpcbMaxValueNameLen, DWORD* lpcbMaxValueLen, DWORD* lpcbSecurityDescriptor, void* lpftLastWriteTime) {
-    LSW_UNUSED(hKey); LSW_UNUSED(lpReserved); LSW_UNUSED(lpftLastWriteTime);
+    LSW_UNUSED(lpReserved);
     if (lpClass && lpcchClass && *lpcchClass > 0) lpClass[0] = 0;
-    if (lpcchClass) *lpcchClass = 0;
-    if (lpcSubKeys) *lpcSubKeys = 0;
-    if (lpcbMaxSubKeyLen) *lpcbMaxSubKeyLen = 0;
-    if (lpcbMaxClassLen) *lpcbMaxClassLen = 0;
-    if (lpcValues) *lpcValues = 0;
-    if (lpcbMaxValueNameLen) *lpcbMaxValueNameLen = 0;
-    if (lpcbMaxValueLen) *lpcbMaxValueLen = 0;
-    if (lpcbSecurityDescriptor) *lpcbSecurityDescriptor = 0;
-    return 0L;
+    return reg_query_info(hKey, lpcchClass, lpcSubKeys, lpcbMaxSubKeyLen, lpcbMaxClassLen, lpcValues,
+                          lpcbMaxValueNameLen, lpcbMaxValueLen, lpcbSecurityDescriptor, lpftLastWriteTime);
 }
 
 LSTATUS __attribute__((ms_abi)) lsw_RegConnectRegistryW(LPCWSTR lpMachineName, HKEY hKey, HKEY* phkResult) {
@@ -502,7 +500,7 @@ LSTATUS __attribute__((ms_abi)) lsw_RegConnectRegistryW(LPCWSTR lpMachineName, H
 
 LSTATUS __attribute__((ms_abi)) lsw_RegFlushKey(HKEY hKey) {
     LSW_UNUSED(hKey);
-    return 0L;
+    return lsw_reg_flush() == LSW_SUCCESS ? 0L : 1016L; /* ERROR_REGISTRY_IO_FAILED */
 }
 
 LSTATUS __attribute__((ms_abi)) lsw_RegLoadKeyW(HKEY hKey, LPCWSTR lpSubKey, LPCWSTR lpFile) {
@@ -515,9 +513,66 @@ LSTATUS __attribute__((ms_abi)) lsw_RegSaveKeyW(HKEY hKey, LPCWSTR lpFile, SECUR
     return 0L;
 }
 
+extern int __attribute__((ms_abi)) lsw_SetEvent(void* handle);
+
+static void reg_notify_set_event(void* ev) { lsw_SetEvent(ev); }
+
+/* Synchronous RegNotifyChangeKeyValue: the caller blocks on this */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             fired;
+} reg_notify_wait_t;
+
+static void reg_notify_wake(void* ctx)
+{
+    reg_notify_wait_t* w = ctx;
+    pthread_mutex_lock(&w->lock);
+    w->fired = 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* Predefined keys are never closed: watches on them use one permanent handle each */
+static HANDLE reg_predefined_handle(lsw_hkey_t lhk)
+{
+    static HANDLE handles[5];
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    if ((unsigned)lhk >= 5) return NULL;
+    pthread_mutex_lock(&lock);
+    if (!handles[lhk] && lsw_reg_open_key(lhk, NULL, &handles[lhk]) != LSW_SUCCESS) handles[lhk] = NULL;
+    HANDLE h = handles[lhk];
+    pthread_mutex_unlock(&lock);
+    return h;
+}
+
 LSTATUS __attribute__((ms_abi)) lsw_RegNotifyChangeKeyValue(HKEY hKey, BOOL bWatchSubtree, DWORD dwNotifyFilter, HANDLE hEvent, BOOL fAsynchronous) {
-    LSW_UNUSED(hKey); LSW_UNUSED(bWatchSubtree); LSW_UNUSED(dwNotifyFilter); LSW_UNUSED(hEvent); LSW_UNUSED(fAsynchronous);
-    return 0L;
+    LSW_LOG_DEBUG("RegNotifyChangeKeyValue: hKey=%p filter=0x%x async=%d", hKey, dwNotifyFilter, fAsynchronous);
+    dwNotifyFilter &= ~0x10000000U;  /* REG_NOTIFY_THREAD_AGNOSTIC: no thread affinity here anyway */
+    if (!(dwNotifyFilter & LSW_REG_NOTIFY_ALL) || (dwNotifyFilter & ~LSW_REG_NOTIFY_ALL)) return 87L;
+    if (fAsynchronous && !hEvent) return 87L; /* ERROR_INVALID_PARAMETER */
+
+    lsw_hkey_t lhk;
+    HANDLE h = w32_hkey_to_lsw(hKey, &lhk) ? reg_predefined_handle(lhk) : (HANDLE)hKey;
+    if (!h) return 6L; /* ERROR_INVALID_HANDLE */
+
+    if (fAsynchronous) {
+        return lsw_status_to_w32(lsw_reg_notify(h, bWatchSubtree != 0, dwNotifyFilter, reg_notify_set_event, hEvent));
+    }
+
+    reg_notify_wait_t w;
+    pthread_mutex_init(&w.lock, NULL);
+    pthread_cond_init(&w.cond, NULL);
+    w.fired = 0;
+    lsw_status_t s = lsw_reg_notify(h, bWatchSubtree != 0, dwNotifyFilter, reg_notify_wake, &w);
+    if (s == LSW_SUCCESS) {
+        pthread_mutex_lock(&w.lock);
+        while (!w.fired) pthread_cond_wait(&w.cond, &w.lock);
+        pthread_mutex_unlock(&w.lock);
+    }
+    pthread_cond_destroy(&w.cond);
+    pthread_mutex_destroy(&w.lock);
+    return lsw_status_to_w32(s);
 }
 
 LSTATUS __attribute__((ms_abi)) lsw_RegGetValueW(HKEY hKey, LPCWSTR lpSubKey, LPCWSTR lpValue, DWORD dwFlags, DWORD* pdwType, void* pvData, DWORD* pcbData) {
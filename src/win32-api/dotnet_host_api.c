@@ -38,6 +38,7 @@
 #include <errno.h>
 #include "../../include/shared/lsw_log.h"
 #include "../../include/win32-api/win32_api.h"
+#include "../../include/win32-api/win32_env.h"
 
 /* ---- Forward declarations ---- */
 extern lsw_status_t lsw_fs_win_to_linux(const char* wpath, char* lpath, size_t lsz);
@@ -264,7 +265,19 @@ static void load_hostfxr_so(void) {
 }
 
 /* Public init — called from win32_api_init() */
+/* Inject Windows-style env vars so the .NET apphost can discover dotnet */
+static void dotnet_export_env(void) {
+    win32_env_set("ProgramFiles",    "C:\\Program Files", 0);
+    win32_env_set("ProgramFiles(x86)", "C:\\Program Files (x86)", 0);
+    /* DOTNET_ROOT tells the apphost exactly where .NET is (Windows fake path) */
+    win32_env_set("DOTNET_ROOT", LSW_DOTNET_WIN_PATH, 1);
+    LSW_LOG_INFO("dotnet_host: DOTNET_ROOT=%s ProgramFiles set", LSW_DOTNET_WIN_PATH);
+}
+
 void lsw_dotnet_init(void) {
+    /* Detection is done once; the environment may have been replaced since
+     * (a zygote child), so the variables are exported again */
+    if (g_dotnet_detected == 1) { dotnet_export_env(); return; }
     if (g_dotnet_detected != 0) return;
 
     if (!detect_linux_dotnet()) {
@@ -281,13 +294,7 @@ void lsw_dotnet_init(void) {
     create_bridge_dir();
     load_hostfxr_so();
     g_dotnet_detected = 1;
-
-    /* Inject Windows-style env vars so the .NET apphost can discover dotnet */
-    setenv("ProgramFiles",    "C:\\Program Files", 0);
-    setenv("ProgramFiles(x86)", "C:\\Program Files (x86)", 0);
-    /* DOTNET_ROOT tells the apphost exactly where .NET is (Windows fake path) */
-    setenv("DOTNET_ROOT", LSW_DOTNET_WIN_PATH, 1);
-    LSW_LOG_INFO("dotnet_host: DOTNET_ROOT=%s ProgramFiles set", LSW_DOTNET_WIN_PATH);
+    dotnet_export_env();
 }
 
 /* Return the Linux dotnet root (for path translation in filesystem layer) */
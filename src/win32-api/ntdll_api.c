@@ -23,6 +23,12 @@
 #define _GNU_SOURCE  /* clock_gettime, timegm, strdup */
 
 #include "win32_api.h"
+#include "win32_kuser.h"
+#include "win32_unicode.h"
+#include "win32_dirscan.h"
+#include "win32_env.h"
+#include "win32_lock.h"
+#include "win32_ftab.h"
 #include "lsw_log.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -43,6 +49,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include "lsw_filesystem.h"
+#include "lsw_overlay.h"
 
 /* NTSTATUS constants */
 #define STATUS_SUCCESS                  0x00000000
@@ -56,6 +63,9 @@
 #define STATUS_OBJECT_NAME_NOT_FOUND    0xC0000034
 #define STATUS_ACCESS_DENIED            0xC0000022
 #define STATUS_END_OF_FILE              0xC0000011
+#define STATUS_BUFFER_TOO_SMALL         0xC0000023
+#define STATUS_VARIABLE_NOT_FOUND       0xC0000100
+#define STATUS_SHARING_VIOLATION        0xC0000043
 
 typedef uint32_t NTSTATUS;
 typedef uint32_t DWORD;
@@ -168,13 +178,6 @@ typedef struct {
 /* Windows FILETIME epoch offset from Unix epoch (100-ns intervals) */
 #define FILETIME_EPOCH_DIFF  116444736000000000ULL
 
-/* Convert Unix timespec to Windows FILETIME (100-ns intervals since 1601-01-01) */
-static int64_t timespec_to_filetime(const struct timespec* ts) {
-    return (int64_t)((uint64_t)ts->tv_sec * 10000000ULL +
-                     (uint64_t)ts->tv_nsec / 100ULL +
-                     FILETIME_EPOCH_DIFF);
-}
-
 /* Windows FILE_ATTRIBUTE_* constants */
 #define FILE_ATTRIBUTE_READONLY    0x00000001
 #define FILE_ATTRIBUTE_HIDDEN      0x00000002
@@ -689,38 +692,57 @@ void __attribute__((ms_abi)) lsw_RtlRaiseException(void* exception_record) {
 
 /* ------------------------------------------------------------------
  * RtlAddFunctionTable / RtlDeleteFunctionTable — x64 exception tables.
- * Required by the MSVC CRT for stack unwinding (.pdata registration).
- * We accept them but do nothing; real unwinding is not yet supported.
+ * Registered with the function table registry (win32_ftab.c), which
+ * RtlLookupFunctionEntry (win32_api.c) and the exception dispatcher
+ * search.  JITs register a table per code batch; the growable variants
+ * extend one in place.
  * ------------------------------------------------------------------ */
 int __attribute__((ms_abi)) lsw_RtlAddFunctionTable(
     void* func_table, uint32_t entry_count, uint64_t base_address)
 {
-    (void)func_table; (void)entry_count; (void)base_address;
-    LSW_LOG_DEBUG("RtlAddFunctionTable: %u entries at base 0x%llx (no-op)",
-                  entry_count, (unsigned long long)base_address);
-    return 1; /* TRUE — "success" */
+    int rc = win32_ftab_add_table((const win32_runtime_function_t*)func_table, entry_count, base_address);
+    LSW_LOG_DEBUG("RtlAddFunctionTable: %u entries at base 0x%llx: %s",
+                  entry_count, (unsigned long long)base_address, rc ? strerror(rc) : "ok");
+    return rc == 0;
 }
 
+/* Also removes callback ranges, by their table identifier */
 int __attribute__((ms_abi)) lsw_RtlDeleteFunctionTable(void* func_table) {
-    (void)func_table;
-    return 1;
+    return win32_ftab_remove((uint64_t)(uintptr_t)func_table) == 0;
 }
 
 int __attribute__((ms_abi)) lsw_RtlInstallFunctionTableCallback(
     uint64_t table_id, uint64_t base, uint32_t length, void* callback, void* ctx, const uint16_t* out_of_process_dll)
 {
-    (void)table_id; (void)base; (void)length; (void)callback; (void)ctx; (void)out_of_process_dll;
-    return 1;
+    (void)out_of_process_dll;
+    win32_ftab_callback_t cb;
+    memcpy(&cb, &callback, sizeof(cb));
+    return win32_ftab_add_callback(table_id, base, length, cb, ctx) == 0;
 }
 
-void* __attribute__((ms_abi)) lsw_RtlLookupFunctionEntry(
-    uint64_t control_pc, uint64_t* image_base, void* history_table)
+/* Returns an NTSTATUS; *dynamic_table receives the handle */
+NTSTATUS __attribute__((ms_abi)) lsw_RtlAddGrowableFunctionTable(
+    void** dynamic_table, void* func_table, uint32_t entry_count, uint32_t max_entry_count,
+    uint64_t range_base, uint64_t range_end)
 {
-    (void)control_pc; (void)history_table;
-    if (image_base) *image_base = 0;
-    return NULL;
+    int rc = win32_ftab_add_growable((const win32_runtime_function_t*)func_table, entry_count,
+                                     max_entry_count, range_base, range_end, dynamic_table);
+    if (rc == ENOMEM) return STATUS_NO_MEMORY;
+    return rc ? STATUS_INVALID_PARAMETER : STATUS_SUCCESS;
 }
 
+void __attribute__((ms_abi)) lsw_RtlGrowFunctionTable(void* dynamic_table, uint32_t new_entry_count) {
+    win32_ftab_grow(dynamic_table, new_entry_count);
+}
+
+void __attribute__((ms_abi)) lsw_RtlDeleteGrowableFunctionTable(void* dynamic_table) {
+    win32_ftab_remove((uint64_t)(uintptr_t)dynamic_table);
+}
+
+/* RtlLookupFunctionEntry lives in win32_api.c, next to the dispatcher */
+extern void* __attribute__((ms_abi)) lsw_RtlLookupFunctionEntry(
+    uint64_t control_pc, uint64_t* image_base, void* history_table);
+
 void __attribute__((ms_abi)) lsw_RtlCaptureContext(void* context_record) {
     (void)context_record;
     /* Would need to save all registers — stub for now */
@@ -852,9 +874,11 @@ void __attribute__((ms_abi)) lsw_DbgPrint(const char* fmt, ...) {
 /* NtClose — close real file/dir handles */
 int __attribute__((ms_abi)) lsw_NtClose(void* handle) {
     if (!handle || (intptr_t)handle == -1) return STATUS_SUCCESS;
+    lsw_handle_unbind(handle);
     /* Directory handle */
     lsw_nt_dir_handle_t* dh = (lsw_nt_dir_handle_t*)handle;
     if ((uintptr_t)handle >= 0x10000u && dh->magic == LSW_DIR_MAGIC) {
+        win32_dirscan_close((win32_dirscan_t*)dh->scan);
         if (dh->dirp) closedir((DIR*)dh->dirp);
         dh->magic = 0;
         free(dh);
@@ -874,12 +898,48 @@ void __attribute__((ms_abi)) lsw_RtlExitUserThread(uint32_t exit_code) {
     pthread_exit((void*)(uintptr_t)exit_code);
 }
 
+/* Lengths are in WCHARs, without terminator. A NULL env means the
+ * process environment; otherwise env is a caller-built block. */
 int __attribute__((ms_abi)) lsw_RtlQueryEnvironmentVariable(
-    void* env, const uint16_t* name, uint32_t name_len, uint16_t* val, uint32_t val_len, uint32_t* ret_len)
+    void* env, const uint16_t* name, size_t name_len, uint16_t* val, size_t val_len, size_t* ret_len)
 {
-    (void)env; (void)name; (void)name_len; (void)val; (void)val_len;
     if (ret_len) *ret_len = 0;
-    return (int)STATUS_UNSUCCESSFUL;
+    if (!name || name_len == 0) return (int)STATUS_INVALID_PARAMETER;
+
+    size_t len;
+    if (!env) {
+        uint32_t cap = val ? (val_len > UINT32_MAX ? UINT32_MAX : (uint32_t)val_len) : 0;
+        uint32_t r = win32_env_get_w(name, (ptrdiff_t)name_len, val, cap);
+        if (r == 0 && !win32_env_peek_w(name, (ptrdiff_t)name_len))
+            return (int)STATUS_VARIABLE_NOT_FOUND;
+        if (r < cap) {
+            if (ret_len) *ret_len = r;
+            return STATUS_SUCCESS;
+        }
+        len = r - 1;
+    } else {
+        const uint16_t* p = (const uint16_t*)env;
+        const uint16_t* hit = NULL;
+        while (*p && !hit) {
+            size_t n = win32_u16_len(p);
+            /* "=C:"-style names start with '=' */
+            const uint16_t* eq = p + 1;
+            while (eq < p + n && *eq != '=') eq++;
+            if (eq < p + n && (size_t)(eq - p) == name_len &&
+                win32_u16_icmp(p, name_len, name, name_len) == 0)
+                hit = eq + 1;
+            p += n + 1;
+        }
+        if (!hit) return (int)STATUS_VARIABLE_NOT_FOUND;
+        len = win32_u16_len(hit);
+        if (val && len < val_len) {
+            memcpy(val, hit, (len + 1) * sizeof(uint16_t));
+            if (ret_len) *ret_len = len;
+            return STATUS_SUCCESS;
+        }
+    }
+    if (ret_len) *ret_len = len;
+    return (int)STATUS_BUFFER_TOO_SMALL;
 }
 
 /* ------------------------------------------------------------------
@@ -943,6 +1003,24 @@ void __attribute__((ms_abi)) lsw_NtQuerySystemTime(uint64_t* SystemTime) {
                 + EPOCH_DIFF_100NS;
 }
 
+/* NtQueryPerformanceCounter / RtlQueryPerformance* — same 10 MHz clock as KERNEL32 */
+NTSTATUS __attribute__((ms_abi)) lsw_NtQueryPerformanceCounter(uint64_t* Counter, uint64_t* Frequency) {
+    if (!Counter) return STATUS_INVALID_PARAMETER;
+    *Counter = win32_qpc();
+    if (Frequency) *Frequency = WIN32_QPC_FREQUENCY;
+    return STATUS_SUCCESS;
+}
+
+int __attribute__((ms_abi)) lsw_RtlQueryPerformanceCounter(uint64_t* Counter) {
+    if (Counter) *Counter = win32_qpc();
+    return 1; /* TRUE */
+}
+
+int __attribute__((ms_abi)) lsw_RtlQueryPerformanceFrequency(uint64_t* Frequency) {
+    if (Frequency) *Frequency = WIN32_QPC_FREQUENCY;
+    return 1; /* TRUE */
+}
+
 int __attribute__((ms_abi)) lsw_RtlTimeToSecondsSince1970(uint64_t* Time, uint32_t* Seconds) {
     if (!Time || !Seconds) return 0; /* FALSE */
     uint64_t secs = *Time / 10000000ULL;
@@ -1319,6 +1397,7 @@ int32_t __attribute__((ms_abi)) lsw_NtOpenFile(
         dh->magic = LSW_DIR_MAGIC;
         dh->dirp  = (void*)dp;
         dh->dirfd = dirfd(dp);
+        dh->scan  = NULL;
         if (handle) *handle = (void*)dh;
         if (io) { io->Status = STATUS_SUCCESS; io->Information = 1; /* FILE_OPENED */ }
         LSW_LOG_DEBUG("NtOpenFile: opened dir %s -> handle %p", linux_path, (void*)dh);
@@ -1351,7 +1430,7 @@ int32_t __attribute__((ms_abi)) lsw_NtCreateFile(
     uint32_t share, uint32_t disposition, uint32_t create_opts,
     void* ea_buf, uint32_t ea_len)
 {
-    (void)alloc_size; (void)file_attrs; (void)share; (void)ea_buf; (void)ea_len;
+    (void)alloc_size; (void)file_attrs; (void)ea_buf; (void)ea_len;
     lsw_io_status_t* io = (lsw_io_status_t*)io_status_raw;
     if (handle) *handle = (void*)(intptr_t)-1;
 
@@ -1374,7 +1453,7 @@ int32_t __attribute__((ms_abi)) lsw_NtCreateFile(
     if (create_opts & FILE_DIRECTORY_FILE) {
         /* Create/open directory */
         if (disposition == FILE_CREATE || disposition == FILE_OPEN_IF) {
-            mkdir(linux_path, 0755); /* ignore error if exists */
+            lsw_overlay_mkdir(linux_path, 0755); /* ignore error if exists */
         }
         DIR* dp = opendir(linux_path);
         if (!dp) {
@@ -1386,6 +1465,7 @@ int32_t __attribute__((ms_abi)) lsw_NtCreateFile(
         dh->magic = LSW_DIR_MAGIC;
         dh->dirp  = (void*)dp;
         dh->dirfd = dirfd(dp);
+        dh->scan  = NULL;
         if (handle) *handle = (void*)dh;
         if (io) { io->Status = STATUS_SUCCESS; io->Information = 1; }
         return STATUS_SUCCESS;
@@ -1409,7 +1489,26 @@ int32_t __attribute__((ms_abi)) lsw_NtCreateFile(
     } else {
         flags |= O_RDWR;
     }
-    int fd = open(linux_path, flags, 0644);
+    /* GENERIC_WRITE | GENERIC_ALL | FILE_WRITE_DATA | FILE_APPEND_DATA */
+    /* Truncation waits for the share check */
+    int fd = -1;
+    if (!(flags & (O_CREAT | O_TRUNC)) && !(access & 0x50000006UL)) {
+        fd = open(linux_path, flags, 0644);
+    } else if (lsw_overlay_copy_up(linux_path, sizeof(linux_path), !(flags & O_TRUNC)) == 0) {
+        fd = open(linux_path, flags & ~O_TRUNC, 0644);
+    }
+    if (fd >= 0 && win32_share_acquire(fd, win32_share_classes(access), share) == EBUSY) {
+        close(fd);
+        if (io) { io->Status = STATUS_SHARING_VIOLATION; io->Information = 0; }
+        return STATUS_SHARING_VIOLATION;
+    }
+    if (fd >= 0 && (flags & O_TRUNC)) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ftruncate(fd, 0) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
     if (fd < 0) {
         LSW_LOG_WARN("NtCreateFile: open(%s) failed: %s", linux_path, strerror(errno));
         int32_t ns = (errno == ENOENT || errno == ENOTDIR) ? STATUS_OBJECT_NAME_NOT_FOUND
@@ -1419,6 +1518,7 @@ int32_t __attribute__((ms_abi)) lsw_NtCreateFile(
         if (io) { io->Status = ns; io->Information = 0; }
         return ns;
     }
+    if (create_new) lsw_fs_invalidate(linux_path);
     if (handle) *handle = (void*)(intptr_t)fd;
     if (io) {
         io->Status = STATUS_SUCCESS;
@@ -1456,22 +1556,32 @@ int32_t __attribute__((ms_abi)) lsw_NtQueryDirectoryFile(
         if (io) { io->Status = STATUS_INVALID_PARAMETER; io->Information = 0; }
         return STATUS_INVALID_PARAMETER;
     }
-    DIR* dp = (DIR*)dh->dirp;
-
-    /* Optional file name filter */
-    char filter_mb[256] = {0};
-    int has_filter = 0;
+    /* Optional file name filter: honoured on the first call and on restart */
+    char filter_mb[WIN32_PATTERN_MAX];
+    const char* filter = NULL;
     if (file_name_raw) {
         lsw_unicode_string_t* fn = (lsw_unicode_string_t*)file_name_raw;
         if (fn->Buffer && fn->Length > 0) {
-            size_t wlen = fn->Length / 2;
-            for (size_t i = 0; i < wlen && i < sizeof(filter_mb)-1; i++)
-                filter_mb[i] = (fn->Buffer[i] < 128) ? (char)fn->Buffer[i] : '?';
-            has_filter = 1;
+            ptrdiff_t n = win32_utf16_to_utf8(fn->Buffer, fn->Length / 2, (uint8_t*)filter_mb,
+                                              sizeof(filter_mb) - 1, 0);
+            filter_mb[n > 0 ? n : 0] = '\0';
+            filter = filter_mb;
         }
     }
 
-    if (restart_flag) rewinddir(dp);
+    /* FileNamesInformation needs no metadata, so skip the per-entry stat */
+    int scan_flags = WIN32_DIRSCAN_LARGE_FETCH | (info_class == 12 ? WIN32_DIRSCAN_NAMES_ONLY : 0);
+    win32_dirscan_t* scan = (win32_dirscan_t*)dh->scan;
+    if (!scan) {
+        scan = win32_dirscan_fdopen(dh->dirfd, filter, scan_flags);
+        if (!scan) {
+            if (io) { io->Status = STATUS_NO_MEMORY; io->Information = 0; }
+            return STATUS_NO_MEMORY;
+        }
+        dh->scan = scan;
+    } else if (restart_flag) {
+        win32_dirscan_rewind(scan, filter);
+    }
 
     uint8_t* buf = (uint8_t*)file_info;
     uint32_t buf_used = 0;
@@ -1489,54 +1599,22 @@ int32_t __attribute__((ms_abi)) lsw_NtQueryDirectoryFile(
         default: fixed_sz = offsetof(lsw_file_dir_info_t,        FileName); break;
     }
 
-    while (1) {
-        struct dirent* de = readdir(dp);
-        if (!de) break; /* end of directory */
-
-        const char* name = de->d_name;
-        /* Apply filter (simple wildcard: * matches all) */
-        if (has_filter && strcmp(filter_mb, "*") != 0 &&
-            strcasecmp(filter_mb, name) != 0) continue;
-
-        /* Convert name to wide */
-        uint16_t wname[512];
-        uint32_t wlen = 0;
-        for (; name[wlen] && wlen < 511; wlen++) wname[wlen] = (uint8_t)name[wlen];
-        uint32_t fname_bytes = wlen * 2;
+    const win32_dirent_t* de;
+    while ((de = win32_dirscan_next(scan)) != NULL) {
+        uint32_t fname_bytes = de->wname_len * 2;
 
         /* Compute entry size (aligned to 8 bytes) */
         uint32_t entry_sz = (fixed_sz + fname_bytes + 7) & ~7u;
         if (buf_used + entry_sz > len) {
+            /* Hand this entry out again on the next call */
+            win32_dirscan_unget(scan);
             if (entries_written == 0) {
                 if (io) { io->Status = STATUS_BUFFER_OVERFLOW; io->Information = 0; }
                 return (int32_t)0x80000005; /* STATUS_BUFFER_OVERFLOW */
             }
-            /* Put back this entry by seeking back — can't in readdir, just stop */
             break;
         }
 
-        /* Stat the file for metadata */
-        struct stat st;
-        int have_stat = (fstatat(dh->dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == 0);
-
-        uint32_t attrs = 0;
-        int64_t size = 0, alloc = 0;
-        int64_t ctime_ft = 0, atime_ft = 0, mtime_ft = 0;
-        if (have_stat) {
-            if (S_ISDIR(st.st_mode)) attrs |= FILE_ATTRIBUTE_DIRECTORY;
-            else attrs |= FILE_ATTRIBUTE_ARCHIVE;
-            if (!(st.st_mode & S_IWUSR)) attrs |= FILE_ATTRIBUTE_READONLY;
-            if (!attrs) attrs = FILE_ATTRIBUTE_NORMAL;
-            size  = (int64_t)st.st_size;
-            alloc = (int64_t)((st.st_blocks * 512 + 4095) & ~(int64_t)4095);
-            ctime_ft = timespec_to_filetime(&st.st_ctim);
-            atime_ft = timespec_to_filetime(&st.st_atim);
-            mtime_ft = timespec_to_filetime(&st.st_mtim);
-        } else {
-            if (de->d_type == DT_DIR) attrs = FILE_ATTRIBUTE_DIRECTORY;
-            else attrs = FILE_ATTRIBUTE_ARCHIVE;
-        }
-
         /* Fill in entry */
         uint8_t* p = buf + buf_used;
         memset(p, 0, entry_sz);
@@ -1546,75 +1624,75 @@ int32_t __attribute__((ms_abi)) lsw_NtQueryDirectoryFile(
         case 2: {
             lsw_file_full_dir_info_t* e = (lsw_file_full_dir_info_t*)p;
             e->NextEntryOffset = entry_sz;
-            e->CreationTime    = ctime_ft;
-            e->LastAccessTime  = atime_ft;
-            e->LastWriteTime   = mtime_ft;
-            e->ChangeTime      = mtime_ft;
-            e->EndOfFile       = size;
-            e->AllocationSize  = alloc;
-            e->FileAttributes  = attrs;
+            e->CreationTime    = de->creation_time;
+            e->LastAccessTime  = de->access_time;
+            e->LastWriteTime   = de->write_time;
+            e->ChangeTime      = de->change_time;
+            e->EndOfFile       = de->size;
+            e->AllocationSize  = de->alloc_size;
+            e->FileAttributes  = de->attributes;
             e->FileNameLength  = fname_bytes;
             e->EaSize          = 0;
-            memcpy(e->FileName, wname, fname_bytes);
+            memcpy(e->FileName, de->wname, fname_bytes);
             break;
         }
         case 3: {
             lsw_file_both_dir_info_t* e = (lsw_file_both_dir_info_t*)p;
             e->NextEntryOffset = entry_sz;
-            e->CreationTime    = ctime_ft;
-            e->LastAccessTime  = atime_ft;
-            e->LastWriteTime   = mtime_ft;
-            e->ChangeTime      = mtime_ft;
-            e->EndOfFile       = size;
-            e->AllocationSize  = alloc;
-            e->FileAttributes  = attrs;
+            e->CreationTime    = de->creation_time;
+            e->LastAccessTime  = de->access_time;
+            e->LastWriteTime   = de->write_time;
+            e->ChangeTime      = de->change_time;
+            e->EndOfFile       = de->size;
+            e->AllocationSize  = de->alloc_size;
+            e->FileAttributes  = de->attributes;
             e->FileNameLength  = fname_bytes;
             e->EaSize          = 0;
             e->ShortNameLength = 0;
-            memcpy(e->FileName, wname, fname_bytes);
+            memcpy(e->FileName, de->wname, fname_bytes);
             break;
         }
         case 37: {
             lsw_file_id_both_dir_info_t* e = (lsw_file_id_both_dir_info_t*)p;
             e->NextEntryOffset = entry_sz;
-            e->CreationTime    = ctime_ft;
-            e->LastAccessTime  = atime_ft;
-            e->LastWriteTime   = mtime_ft;
-            e->ChangeTime      = mtime_ft;
-            e->EndOfFile       = size;
-            e->AllocationSize  = alloc;
-            e->FileAttributes  = attrs;
+            e->CreationTime    = de->creation_time;
+            e->LastAccessTime  = de->access_time;
+            e->LastWriteTime   = de->write_time;
+            e->ChangeTime      = de->change_time;
+            e->EndOfFile       = de->size;
+            e->AllocationSize  = de->alloc_size;
+            e->FileAttributes  = de->attributes;
             e->FileNameLength  = fname_bytes;
             e->EaSize          = 0;
             e->ShortNameLength = 0;
-            e->FileId          = have_stat ? (int64_t)st.st_ino : 0;
-            memcpy(e->FileName, wname, fname_bytes);
+            e->FileId          = (int64_t)de->file_id;
+            memcpy(e->FileName, de->wname, fname_bytes);
             break;
         }
         case 12: {
             lsw_file_names_info_t* e = (lsw_file_names_info_t*)p;
             e->NextEntryOffset = entry_sz;
             e->FileNameLength  = fname_bytes;
-            memcpy(e->FileName, wname, fname_bytes);
+            memcpy(e->FileName, de->wname, fname_bytes);
             break;
         }
         default: { /* class 1 and unknown */
             lsw_file_dir_info_t* e = (lsw_file_dir_info_t*)p;
             e->NextEntryOffset = entry_sz;
-            e->CreationTime    = ctime_ft;
-            e->LastAccessTime  = atime_ft;
-            e->LastWriteTime   = mtime_ft;
-            e->ChangeTime      = mtime_ft;
-            e->EndOfFile       = size;
-            e->AllocationSize  = alloc;
-            e->FileAttributes  = attrs;
+            e->CreationTime    = de->creation_time;
+            e->LastAccessTime  = de->access_time;
+            e->LastWriteTime   = de->write_time;
+            e->ChangeTime      = de->change_time;
+            e->EndOfFile       = de->size;
+            e->AllocationSize  = de->alloc_size;
+            e->FileAttributes  = de->attributes;
             e->FileNameLength  = fname_bytes;
-            memcpy(e->FileName, wname, fname_bytes);
+            memcpy(e->FileName, de->wname, fname_bytes);
             break;
         }
         }
 
-        LSW_LOG_DEBUG("NtQueryDirectoryFile:  entry[%d]='%s' attrs=0x%x size=%lld", entries_written, name, attrs, (long long)size);
+        LSW_LOG_DEBUG("NtQueryDirectoryFile:  entry[%d]='%s' attrs=0x%x size=%lld", entries_written, de->name, de->attributes, (long long)de->size);
         buf_used += entry_sz;
         entries_written++;
         if (single_flag) break; /* ReturnSingleEntry */
@@ -2083,6 +2161,9 @@ const win32_api_mapping_t win32_api_ntdll_mappings[] = {
     {"ntdll.dll", "RtlDeleteFunctionTable",        (void*)lsw_RtlDeleteFunctionTable},
     {"ntdll.dll", "RtlInstallFunctionTableCallback", (void*)lsw_RtlInstallFunctionTableCallback},
     {"ntdll.dll", "RtlLookupFunctionEntry",        (void*)lsw_RtlLookupFunctionEntry},
+    {"ntdll.dll", "RtlAddGrowableFunctionTable",   (void*)lsw_RtlAddGrowableFunctionTable},
+    {"ntdll.dll", "RtlGrowFunctionTable",          (void*)lsw_RtlGrowFunctionTable},
+    {"ntdll.dll", "RtlDeleteGrowableFunctionTable", (void*)lsw_RtlDeleteGrowableFunctionTable},
     {"ntdll.dll", "RtlCaptureContext",             (void*)lsw_RtlCaptureContext},
     {"ntdll.dll", "RtlRestoreContext",             (void*)lsw_RtlRestoreContext},
     /* Memory */
@@ -2112,6 +2193,9 @@ const win32_api_mapping_t win32_api_ntdll_mappings[] = {
     {"ntdll.dll", "RtlxOemStringToUnicodeSize",    (void*)lsw_RtlxOemStringToUnicodeSize},
     /* Time */
     {"ntdll.dll", "NtQuerySystemTime",             (void*)lsw_NtQuerySystemTime},
+    {"ntdll.dll", "NtQueryPerformanceCounter",     (void*)lsw_NtQueryPerformanceCounter},
+    {"ntdll.dll", "RtlQueryPerformanceCounter",    (void*)lsw_RtlQueryPerformanceCounter},
+    {"ntdll.dll", "RtlQueryPerformanceFrequency",  (void*)lsw_RtlQueryPerformanceFrequency},
     {"ntdll.dll", "RtlTimeToSecondsSince1970",     (void*)lsw_RtlTimeToSecondsSince1970},
     {"ntdll.dll", "RtlTimeFieldsToTime",           (void*)lsw_RtlTimeFieldsToTime},
     {"ntdll.dll", "RtlTimeToElapsedTimeFields",    (void*)lsw_RtlTimeToElapsedTimeFields},
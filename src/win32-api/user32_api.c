@@ -235,6 +235,24 @@ BOOL __attribute__((ms_abi)) lsw_PeekMessageA(lsw_MSG* msg, HWND hwnd, UINT min,
 BOOL __attribute__((ms_abi)) lsw_PeekMessageW(lsw_MSG* msg, HWND hwnd, UINT min, UINT max, UINT remove) {
     return lsw_PeekMessageA(msg, hwnd, min, max, remove);
 }
+/* MsgWaitForMultipleObjects[Ex] — there is no message queue, so this is a
+ * plain (optionally alertable) object wait; with no handles it just sleeps. */
+#define MWMO_WAITALL    0x0001
+#define MWMO_ALERTABLE  0x0002
+extern uint32_t __attribute__((ms_abi)) lsw_WaitForMultipleObjectsEx(DWORD n, HANDLE* handles, BOOL waitAll, DWORD ms, BOOL alertable);
+extern int __attribute__((ms_abi)) lsw_SleepEx(DWORD ms, BOOL alertable);
+DWORD __attribute__((ms_abi)) lsw_MsgWaitForMultipleObjectsEx(DWORD count, HANDLE* handles, DWORD ms, DWORD wake_mask, DWORD flags) {
+    (void)wake_mask;
+    BOOL alertable = (flags & MWMO_ALERTABLE) ? 1 : 0;
+    if (count == 0 || !handles) {
+        DWORD r = (DWORD)lsw_SleepEx(ms, alertable);
+        return r ? r : 0x00000102; /* WAIT_IO_COMPLETION or WAIT_TIMEOUT */
+    }
+    return lsw_WaitForMultipleObjectsEx(count, handles, (flags & MWMO_WAITALL) ? 1 : 0, ms, alertable);
+}
+DWORD __attribute__((ms_abi)) lsw_MsgWaitForMultipleObjects(DWORD count, HANDLE* handles, BOOL wait_all, DWORD ms, DWORD wake_mask) {
+    return lsw_MsgWaitForMultipleObjectsEx(count, handles, ms, wake_mask, wait_all ? MWMO_WAITALL : 0);
+}
 BOOL __attribute__((ms_abi)) lsw_TranslateMessage(const lsw_MSG* msg) { (void)msg; return 0; }
 LRESULT __attribute__((ms_abi)) lsw_DispatchMessageA(const lsw_MSG* msg) { (void)msg; return 0; }
 LRESULT __attribute__((ms_abi)) lsw_DispatchMessageW(const lsw_MSG* msg) { (void)msg; return 0; }
@@ -822,6 +840,8 @@ const win32_api_mapping_t win32_api_user32_mappings[] = {
     {"USER32.dll", "GetMessageW",        (void*)lsw_GetMessageW},
     {"USER32.dll", "PeekMessageA",       (void*)lsw_PeekMessageA},
     {"USER32.dll", "PeekMessageW",       (void*)lsw_PeekMessageW},
+    {"USER32.dll", "MsgWaitForMultipleObjects",   (void*)lsw_MsgWaitForMultipleObjects},
+    {"USER32.dll", "MsgWaitForMultipleObjectsEx", (void*)lsw_MsgWaitForMultipleObjectsEx},
     {"USER32.dll", "TranslateMessage",   (void*)lsw_TranslateMessage},
     {"USER32.dll", "DispatchMessageA",   (void*)lsw_DispatchMessageA},
     {"USER32.dll", "DispatchMessageW",   (void*)lsw_DispatchMessageW},
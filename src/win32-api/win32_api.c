@@ -10,12 +10,24 @@
 
 #include "win32_api.h"
 #include "win32_teb.h"
+#include "win32_unicode.h"
+#include "win32_kuser.h"
+#include "win32_dirscan.h"
+#include "win32_dirwatch.h"
+#include "win32_env.h"
+#include "win32_copy.h"
+#include "win32_lock.h"
+#include "win32_ftab.h"
+#include "win32_unwind.h"
+#include "win32_fault.h"
+#include "win32_spawn.h"
 /* Forward declaration — avoids pulling in pe_parser.h which conflicts with
  * the local pe_rva_to_ptr() helper defined below. */
 extern void pe_call_tls_thread_attach(void);
 #include "lsw_log.h"
 #include "shared/lsw_kernel_client.h"
 #include "shared/lsw_filesystem.h"
+#include "shared/lsw_overlay.h"
 #include "shared/lsw_registry.h"
 #include "kernel-module/lsw_syscall.h"
 #include <stdio.h>
@@ -52,6 +64,7 @@ extern void pe_call_tls_thread_attach(void);
 #include <semaphore.h>   /* sem_t — for CreateSemaphore */
 #include <sys/timerfd.h> /* timerfd_create — for waitable timers */
 #include <poll.h>        /* poll — for IOCP wait */
+#include <sys/eventfd.h> /* eventfd — APC queue wakeups */
 #include <execinfo.h>   /* backtrace, backtrace_symbols_fd */
 #include <setjmp.h>      /* longjmp — for C++ exception delivery */
 #include <pwd.h>         /* getpwuid — for username lookup */
@@ -59,6 +72,10 @@ extern void pe_call_tls_thread_attach(void);
 /* Forward declarations for ntdll_api.c functions used in the mapping table */
 int __attribute__((ms_abi)) lsw_RtlAddFunctionTable(void*, uint32_t, uint64_t);
 int __attribute__((ms_abi)) lsw_RtlInstallFunctionTableCallback(uint64_t, uint64_t, uint32_t, void*, void*, const uint16_t*);
+int __attribute__((ms_abi)) lsw_RtlDeleteFunctionTable(void*);
+uint32_t __attribute__((ms_abi)) lsw_RtlAddGrowableFunctionTable(void**, void*, uint32_t, uint32_t, uint64_t, uint64_t);
+void __attribute__((ms_abi)) lsw_RtlGrowFunctionTable(void*, uint32_t);
+void __attribute__((ms_abi)) lsw_RtlDeleteGrowableFunctionTable(void*);
 void __attribute__((ms_abi)) lsw_RtlUnwind(void*, void*, void*, void*);
 void __attribute__((ms_abi)) lsw_RtlUnwindEx(void*, void*, void*, void*, void*, void*);
 void __attribute__((ms_abi)) lsw_RtlRestoreContext(void*, void*);
@@ -111,6 +128,7 @@ static void createprocess_win_to_linux(const char* wpath, char* out, size_t outs
 int __attribute__((ms_abi)) lsw_GetDiskFreeSpaceW(const uint16_t* lpRootPathName, uint32_t* lpSectorsPerCluster, uint32_t* lpBytesPerSector, uint32_t* lpNumberOfFreeClusters, uint32_t* lpTotalNumberOfClusters);
 int __attribute__((ms_abi)) lsw_WideCharToMultiByte(unsigned int codepage, unsigned long flags, const wchar_t* src, int srclen, char* dst, int dstlen, const char* defchar, int* used_default);
 int __attribute__((ms_abi)) lsw_MultiByteToWideChar(unsigned int codepage, unsigned long flags, const char* src, int srclen, uint16_t* dst, int dstlen);
+void __attribute__((ms_abi)) lsw_SetLastError(DWORD code);
 
 /* Windows pseudo-handle constants: STD_INPUT=-10, STD_OUTPUT=-11, STD_ERROR=-12 */
 #define LSW_IS_PSEUDO_HANDLE(h) ((intptr_t)(uintptr_t)(h) >= -12 && (intptr_t)(uintptr_t)(h) <= -10)
@@ -128,8 +146,6 @@ static char g_lsw_exe_path[4096] = {0};
 /* ---- PE image info for x64 C++ exception dispatch ---- */
 static uint64_t g_lsw_image_base  = 0;
 static uint32_t g_lsw_image_size  = 0;   /* SizeOfImage from PE header */
-static void*    g_lsw_pdata_va    = NULL;
-static uint32_t g_lsw_pdata_size  = 0;
 
 /* Forward declaration (struct defined below) */
 struct lsw_pe_hmodule_s;
@@ -170,8 +186,7 @@ void win32_api_set_pe_image_info(uint64_t image_base,
 {
     g_lsw_image_base = image_base;
     g_lsw_image_size = image_size;
-    g_lsw_pdata_va   = pdata_va;
-    g_lsw_pdata_size = pdata_size;
+    win32_ftab_add_image(image_base, image_size, pdata_va, pdata_size);
     LSW_LOG_INFO("[exception] PE image info: base=0x%lx pdata=%p size=%u",
                  (unsigned long)image_base, pdata_va, pdata_size);
 
@@ -304,6 +319,56 @@ typedef struct lsw_pipe_s lsw_pipe_t;
 #define LSW_IOCP_MAGIC    0x494F4350U  /* "IOCP" */
 #define LSW_TPWORK_MAGIC  0x54505744U  /* "TPWD" */
 #define LSW_THREAD_MAGIC  0x54485244U  /* "THRD" */
+#define LSW_CHANGE_MAGIC  0x43484E47U  /* "CHNG" */
+#define LSW_CHILD_MAGIC   0x43484C44U  /* "CHLD" */
+
+/* Primary thread of a CreateProcess child; resume_fd gates a
+ * CREATE_SUSPENDED start until ResumeThread */
+typedef struct {
+    uint32_t magic;             /* LSW_CHILD_MAGIC */
+    pid_t    pid;
+    int      resume_fd;
+} lsw_child_thread_t;
+
+/* SECURITY_ATTRIBUTES.bInheritHandle (x64 offset 16); handles that are
+ * not inheritable are close-on-exec descriptors */
+static inline int lsw_sa_inherit(const void* sa) {
+    return sa && *(const int32_t*)((const char*)sa + 16);
+}
+
+/* ---- APC queues (QueueUserAPC, ReadFileEx/WriteFileEx completions) ----
+ * Each APC target thread owns one lsw_apc_queue_t.  QueueUserAPC appends an
+ * entry, bumps `pending`, writes the eventfd (wakes poll-based waits such as
+ * SleepEx and timers) and broadcasts the condvar the owner is currently
+ * blocked on, if any (wakes event/thread waits).  Alertable waits drain the
+ * queue on the owning thread and return WAIT_IO_COMPLETION. */
+#define WAIT_IO_COMPLETION 0x000000C0U
+#define LSW_MAX_WAIT_OBJECTS 64  /* MAXIMUM_WAIT_OBJECTS */
+#define LSW_APC_USER 0   /* PAPCFUNC(ULONG_PTR) */
+#define LSW_APC_IO   1   /* LPOVERLAPPED_COMPLETION_ROUTINE(err, bytes, ovl) */
+
+typedef struct lsw_apc_s {
+    int        kind;       /* LSW_APC_USER / LSW_APC_IO */
+    void*      fn;
+    uintptr_t  data;       /* USER: dwData, IO: lpOverlapped */
+    uint32_t   error;      /* IO only */
+    uint32_t   bytes;      /* IO only */
+    struct lsw_apc_s* next;
+} lsw_apc_t;
+
+typedef struct {
+    pthread_mutex_t  lock;
+    lsw_apc_t*       head;
+    lsw_apc_t*       tail;
+    int              pending;    /* queued APCs — read lock-free by waiters */
+    int              efd;        /* eventfd, readable while APCs are queued */
+    int              refs;       /* owning thread + thread handle */
+    int              dead;       /* owning thread has exited */
+    pthread_mutex_t* wait_lock;  /* condvar the owner is blocked on (alertable) */
+    pthread_cond_t*  wait_cond;
+} lsw_apc_queue_t;
+
+#define LSW_APC_PENDING(q) ((q) && __atomic_load_n(&(q)->pending, __ATOMIC_ACQUIRE) > 0)
 
 /* Thread handle — wraps a pthread so WaitForSingleObject/CloseHandle work */
 typedef struct {
@@ -316,6 +381,7 @@ typedef struct {
     volatile int    suspended;  /* CREATE_SUSPENDED: 1=suspended, 0=running */
     pthread_mutex_t suspend_lock;
     pthread_cond_t  suspend_cond;
+    lsw_apc_queue_t* apc;       /* target queue for QueueUserAPC */
 } lsw_thread_handle_t;
 
 /* Trampoline context: converts sysv_abi pthread call → ms_abi Win32 thread func */
@@ -323,8 +389,194 @@ typedef struct {
     uint32_t (__attribute__((ms_abi)) *start_fn)(void*);
     void               *param;
     lsw_thread_handle_t *handle;
+    lsw_apc_queue_t    *apc;
 } lsw_thread_trampoline_t;
 
+static __thread lsw_apc_queue_t* t_apc_queue = NULL;
+static pthread_key_t             g_apc_exit_key;
+static pthread_once_t            g_apc_once = PTHREAD_ONCE_INIT;
+
+static lsw_apc_queue_t* lsw_apc_queue_new(int refs) {
+    lsw_apc_queue_t* q = calloc(1, sizeof(*q));
+    if (!q) return NULL;
+    pthread_mutex_init(&q->lock, NULL);
+    q->efd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    q->refs = refs;
+    return q;
+}
+
+static void lsw_apc_queue_put(lsw_apc_queue_t* q) {
+    if (!q) return;
+    pthread_mutex_lock(&q->lock);
+    int last = (--q->refs == 0);
+    pthread_mutex_unlock(&q->lock);
+    if (!last) return;
+    lsw_apc_t* a = q->head;
+    while (a) { lsw_apc_t* n = a->next; free(a); a = n; }
+    if (q->efd >= 0) close(q->efd);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+}
+
+/* pthread key destructor: the owning thread is gone, APCs can no longer run */
+static void lsw_apc_thread_exit(void* arg) {
+    lsw_apc_queue_t* q = (lsw_apc_queue_t*)arg;
+    pthread_mutex_lock(&q->lock);
+    q->dead = 1;
+    pthread_mutex_unlock(&q->lock);
+    if (t_apc_queue == q) t_apc_queue = NULL;
+    lsw_apc_queue_put(q);
+}
+
+static void lsw_apc_once_init(void) {
+    pthread_key_create(&g_apc_exit_key, lsw_apc_thread_exit);
+}
+
+/* Bind `q` (already holding the thread's reference) to the calling thread */
+static void lsw_apc_attach(lsw_apc_queue_t* q) {
+    pthread_once(&g_apc_once, lsw_apc_once_init);
+    t_apc_queue = q;
+    pthread_setspecific(g_apc_exit_key, q);
+}
+
+/* Calling thread's APC queue, created on first use */
+static lsw_apc_queue_t* lsw_apc_self(void) {
+    if (!t_apc_queue) {
+        lsw_apc_queue_t* q = lsw_apc_queue_new(1);
+        if (q) lsw_apc_attach(q);
+    }
+    return t_apc_queue;
+}
+
+/* Append an APC; returns 0 if the target thread has already exited */
+static int lsw_apc_enqueue(lsw_apc_queue_t* q, lsw_apc_t* a) {
+    a->next = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (q->dead) {
+        pthread_mutex_unlock(&q->lock);
+        return 0;
+    }
+    if (q->tail) q->tail->next = a; else q->head = a;
+    q->tail = a;
+    __atomic_add_fetch(&q->pending, 1, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (q->efd >= 0) (void)!write(q->efd, &one, sizeof(one));
+    /* Kick a condvar wait.  Lock order is q->lock → wait_lock; waiters
+     * never take q->lock while holding their wait_lock. */
+    if (q->wait_cond) {
+        pthread_mutex_lock(q->wait_lock);
+        pthread_cond_broadcast(q->wait_cond);
+        pthread_mutex_unlock(q->wait_lock);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+/* Run every queued APC on the calling (owning) thread.
+ * Returns the number delivered. */
+static int lsw_apc_drain(lsw_apc_queue_t* q) {
+    if (!LSW_APC_PENDING(q)) return 0;
+    pthread_mutex_lock(&q->lock);
+    lsw_apc_t* a = q->head;
+    q->head = q->tail = NULL;
+    __atomic_store_n(&q->pending, 0, __ATOMIC_RELEASE);
+    uint64_t cnt;
+    if (q->efd >= 0) (void)!read(q->efd, &cnt, sizeof(cnt));
+    pthread_mutex_unlock(&q->lock);
+
+    int n = 0;
+    while (a) {
+        lsw_apc_t* next = a->next;
+        if (a->kind == LSW_APC_IO) {
+            ((void (__attribute__((ms_abi)) *)(uint32_t, uint32_t, void*))a->fn)(
+                a->error, a->bytes, (void*)a->data);
+        } else {
+            ((void (__attribute__((ms_abi)) *)(uintptr_t))a->fn)(a->data);
+        }
+        free(a);
+        a = next;
+        n++;
+    }
+    return n;
+}
+
+/* Register/unregister the condvar an alertable waiter is about to block on */
+static void lsw_apc_wait_begin(lsw_apc_queue_t* q, pthread_mutex_t* lock, pthread_cond_t* cond) {
+    if (!q) return;
+    pthread_mutex_lock(&q->lock);
+    q->wait_lock = lock;
+    q->wait_cond = cond;
+    pthread_mutex_unlock(&q->lock);
+}
+static void lsw_apc_wait_end(lsw_apc_queue_t* q) {
+    if (!q) return;
+    pthread_mutex_lock(&q->lock);
+    q->wait_lock = NULL;
+    q->wait_cond = NULL;
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Sleep up to `ms` (0xFFFFFFFF = forever).  With a queue, the sleep ends
+ * early when an APC arrives; returns 1 in that case. */
+static int lsw_apc_sleep(lsw_apc_queue_t* q, uint32_t ms) {
+    if (!q || q->efd < 0) {
+        if (ms == 0xFFFFFFFF) { for (;;) pause(); }
+        struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+        return 0;
+    }
+    if (LSW_APC_PENDING(q)) return 1;
+    struct pollfd pfd = { .fd = q->efd, .events = POLLIN };
+    int r = poll(&pfd, 1, (ms == 0xFFFFFFFF) ? -1 : (int)ms);
+    return (r > 0 || LSW_APC_PENDING(q)) ? 1 : 0;
+}
+
+/* ---- Object waiters ----
+ * Mutexes and semaphores have no fd, and a wait-any spans several objects,
+ * so those waits sleep on the waiting thread's APC eventfd.  The waiter
+ * registers its queue here before checking the objects; SetEvent,
+ * ReleaseMutex, ReleaseSemaphore, thread exit and change notifications
+ * write every registered eventfd after changing state, so a signal that
+ * lands after the check ends the sleep.  A queued APC wakes it the same way. */
+typedef struct lsw_obj_waiter_s {
+    lsw_apc_queue_t*         q;
+    struct lsw_obj_waiter_s* next;
+} lsw_obj_waiter_t;
+
+static pthread_mutex_t   g_obj_waiters_lock = PTHREAD_MUTEX_INITIALIZER;
+static lsw_obj_waiter_t* g_obj_waiters;
+static int               g_obj_waiter_count;  /* lets signalers skip the lock */
+
+static void lsw_obj_waiter_add(lsw_obj_waiter_t* w) {
+    pthread_mutex_lock(&g_obj_waiters_lock);
+    w->next = g_obj_waiters;
+    g_obj_waiters = w;
+    __atomic_add_fetch(&g_obj_waiter_count, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&g_obj_waiters_lock);
+}
+
+static void lsw_obj_waiter_remove(lsw_obj_waiter_t* w) {
+    pthread_mutex_lock(&g_obj_waiters_lock);
+    for (lsw_obj_waiter_t** pp = &g_obj_waiters; *pp; pp = &(*pp)->next) {
+        if (*pp == w) { *pp = w->next; break; }
+    }
+    __atomic_sub_fetch(&g_obj_waiter_count, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&g_obj_waiters_lock);
+}
+
+/* Called after an object became signaled */
+static void lsw_obj_wake(void) {
+    /* Orders the state change before the count load; pairs with the
+     * count update in lsw_obj_waiter_add */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_obj_waiter_count, __ATOMIC_RELAXED) == 0) return;
+    uint64_t one = 1;
+    pthread_mutex_lock(&g_obj_waiters_lock);
+    for (lsw_obj_waiter_t* w = g_obj_waiters; w; w = w->next)
+        (void)!write(w->q->efd, &one, sizeof(one));
+    pthread_mutex_unlock(&g_obj_waiters_lock);
+}
+
 static void lsw_thread_cleanup(void* arg)
 {
     lsw_thread_handle_t* h = (lsw_thread_handle_t*)arg;
@@ -336,6 +588,7 @@ static void lsw_thread_cleanup(void* arg)
             pthread_cond_broadcast(&h->cond);
         }
         pthread_mutex_unlock(&h->lock);
+        lsw_obj_wake();
     }
 }
 
@@ -345,10 +598,12 @@ static void* lsw_thread_trampoline(void* arg)
     uint32_t (__attribute__((ms_abi)) *fn)(void*) = t->start_fn;
     void* param = t->param;
     lsw_thread_handle_t* h = t->handle;
+    lsw_apc_queue_t* apc = t->apc;
     free(t);
 
     /* Set up TEB + GS register for this thread (Windows code requires gs:0x30 etc.) */
     win32_teb_init();
+    if (apc) lsw_apc_attach(apc);
 
     /* Track return value outside the cleanup scope */
     uint32_t ret = 0;
@@ -392,6 +647,7 @@ static void* lsw_thread_trampoline(void* arg)
         h->finished = 1;
         pthread_cond_broadcast(&h->cond);
         pthread_mutex_unlock(&h->lock);
+        lsw_obj_wake();
     }
 
     pthread_cleanup_pop(0);
@@ -442,6 +698,16 @@ typedef struct {
     lsw_completion_t *tail;
 } lsw_iocp_t;
 
+/* FindFirstChangeNotification handle: signaled by the watcher thread,
+ * stays signaled until FindNextChangeNotification */
+typedef struct {
+    uint32_t          magic;      /* LSW_CHANGE_MAGIC */
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    volatile int      signaled;
+    win32_dirwatch_t* watch;
+} lsw_change_notify_t;
+
 typedef void (__attribute__((ms_abi)) *lsw_tp_callback_fn)(void*,void*,void*);
 typedef struct {
     uint32_t          magic;      /* LSW_TPWORK_MAGIC */
@@ -1095,7 +1361,7 @@ char* __attribute__((ms_abi)) lsw_strstr(const char* haystack, const char* needl
 typedef uint16_t u16;
 
 static inline size_t u16_len(const u16* s) {
-    const u16* p = s; while (*p) p++; return (size_t)(p - s);
+    return win32_u16_len(s);
 }
 static inline size_t u16_nlen(const u16* s, size_t maxlen) {
     size_t n = 0; while (n < maxlen && s[n]) n++; return n;
@@ -1126,12 +1392,12 @@ static inline int u16_ncmp(const u16* a, const u16* b, size_t n) {
     return n ? (int)*a - (int)*b : 0;
 }
 static inline int u16_icmp(const u16* a, const u16* b) {
-    while (*a && towlower(*a) == towlower(*b)) { a++; b++; }
-    return (int)towlower(*a) - (int)towlower(*b);
+    while (*a && win32_u16_lower(*a) == win32_u16_lower(*b)) { a++; b++; }
+    return (int)win32_u16_lower(*a) - (int)win32_u16_lower(*b);
 }
 static inline int u16_nicmp(const u16* a, const u16* b, size_t n) {
-    while (n && *a && towlower(*a) == towlower(*b)) { a++; b++; n--; }
-    return n ? (int)towlower(*a) - (int)towlower(*b) : 0;
+    while (n && *a && win32_u16_lower(*a) == win32_u16_lower(*b)) { a++; b++; n--; }
+    return n ? (int)win32_u16_lower(*a) - (int)win32_u16_lower(*b) : 0;
 }
 static inline u16* u16_chr(const u16* s, u16 c) {
     for (;; s++) { if (*s == c) return (u16*)s; if (!*s) break; }
@@ -1462,6 +1728,13 @@ int __attribute__((ms_abi)) lsw___CxxFrameHandler(void* pExcept, void* pRN, void
 static __thread void* tls_cxx_exception_obj;
 static __thread void* tls_cxx_exception_type;
 static __thread uint64_t tls_cxx_exception_entry_rsp = 0; /* saved entry_rsp from last catch dispatch */
+static __thread uint64_t tls_cxx_throw_base;   /* image the ThrowInfo RVAs are relative to */
+static __thread uint64_t tls_cxx_throw_size;
+
+/* Image of the frame being examined: set by lsw_find_rf (or RtlVirtualUnwind)
+ * and used to resolve that frame's UNWIND_INFO and FuncInfo RVAs */
+static __thread uint64_t tls_eh_base;
+static __thread uint64_t tls_eh_size;   /* 0 for JIT tables: no bounds */
 
 /* TLS state for full SEH dispatch / RtlUnwindEx communication */
 __thread sigjmp_buf* tls_seh_unwind_jmp   = NULL; /* longjmp target set during search phase */
@@ -1509,17 +1782,6 @@ typedef struct {
 #define UNW_FLAG_UHANDLER  2u
 #define UNW_FLAG_CHAININFO 4u
 
-/* Unwind opcodes */
-#define UWOP_PUSH_NONVOL      0
-#define UWOP_ALLOC_LARGE      1
-#define UWOP_ALLOC_SMALL      2
-#define UWOP_SET_FPREG        3
-#define UWOP_SAVE_NONVOL      4
-#define UWOP_SAVE_NONVOL_FAR  5
-#define UWOP_SAVE_XMM128      8
-#define UWOP_SAVE_XMM128_FAR  9
-#define UWOP_PUSH_MACHFRAME   10
-
 /* FuncInfo3 (FuncInfo for __CxxFrameHandler3, magic 0x19930520 – 0x19930524) */
 typedef struct {
     uint32_t magic;           /* 0x19930520 – 0x19930524 */
@@ -1580,36 +1842,81 @@ typedef struct {
     uint32_t arrayOfCatchableTypes[1]; /* RVAs to CatchableType */
 } lsw_CatchableTypeArray;
 
-/* Resolve a PE RVA to a mapped virtual address */
+/* Resolve an RVA of the current frame's image to a mapped virtual address */
 static inline void* lsw_rva2va(uint32_t rva) {
     if (!rva) return NULL;
     /* Bounds-check: reject RVAs outside the mapped image to prevent SIGSEGV
      * when garbage values (e.g. GS cookie data) are misread as FuncInfo RVAs. */
-    if (g_lsw_image_size && rva >= g_lsw_image_size) return NULL;
-    return (void*)(g_lsw_image_base + rva);
+    if (tls_eh_size && rva >= tls_eh_size) return NULL;
+    return (void*)(tls_eh_base + rva);
+}
+
+/* End of the current frame's image, for parsers that walk variable-length data */
+static inline const uint8_t* lsw_eh_image_end(void) {
+    return tls_eh_size ? (const uint8_t*)(uintptr_t)(tls_eh_base + tls_eh_size)
+                       : (const uint8_t*)UINTPTR_MAX;
 }
 
-/* Binary-search .pdata for the RUNTIME_FUNCTION covering 'rip'. */
+/* Resolve a ThrowInfo RVA (relative to the throwing image) */
+static inline void* lsw_throw_rva2va(uint32_t rva) {
+    if (!rva) return NULL;
+    if (tls_cxx_throw_size && rva >= tls_cxx_throw_size) return NULL;
+    return (void*)(tls_cxx_throw_base + rva);
+}
+
+/* The thrower's image: the one holding its ThrowInfo, else the main image */
+static void lsw_set_throw_image(uint64_t base) {
+    tls_cxx_throw_base = base ? base : g_lsw_image_base;
+    if (!win32_ftab_image(tls_cxx_throw_base, &tls_cxx_throw_size))
+        tls_cxx_throw_size = 0;
+}
+
+/* Make `base` the current frame image (RtlVirtualUnwind's ImageBase) */
+static void lsw_set_eh_image(uint64_t base) {
+    tls_eh_base = base;
+    if (!win32_ftab_image(base, &tls_eh_size)) tls_eh_size = 0;
+}
+
+/* Find the RUNTIME_FUNCTION covering 'rip' in any registered table and
+ * make its image the current one */
 static lsw_RUNTIME_FUNCTION* lsw_find_rf(uint64_t rip) {
-    if (!g_lsw_pdata_va || g_lsw_pdata_size < 12 || !g_lsw_image_base) return NULL;
-    if (rip < g_lsw_image_base) return NULL;
-    uint32_t rva = (uint32_t)(rip - g_lsw_image_base);
-    lsw_RUNTIME_FUNCTION* pdata = (lsw_RUNTIME_FUNCTION*)g_lsw_pdata_va;
-    int n = (int)(g_lsw_pdata_size / sizeof(lsw_RUNTIME_FUNCTION));
-    int lo = 0, hi = n - 1;
-    while (lo <= hi) {
-        int mid = lo + (hi - lo) / 2;
-        if      (rva < pdata[mid].BeginAddress) hi = mid - 1;
-        else if (rva >= pdata[mid].EndAddress)  lo = mid + 1;
-        else return &pdata[mid];
+    uint64_t base, size;
+    const win32_runtime_function_t* rf = win32_ftab_lookup(rip, &base, &size);
+    if (!rf) return NULL;
+    tls_eh_base = base;
+    tls_eh_size = size;
+    return (lsw_RUNTIME_FUNCTION*)rf;
+}
+
+/*
+ * Do two TypeDescriptors name the same type? Within one image the
+ * descriptor is shared; across images each has a copy, compared by its
+ * decorated name (after the vftable and spare pointers).
+ */
+static bool lsw_same_type(uint64_t a, uint64_t b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    return strcmp((const char*)(uintptr_t)(a + 16), (const char*)(uintptr_t)(b + 16)) == 0;
+}
+
+/* TypeDescriptor VAs of everything the thrown object can be caught as */
+static int lsw_catchable_types(const lsw_ThrowInfo* throw_info, uint64_t* out, int max) {
+    int n = 0;
+    if (!throw_info || !throw_info->pCatchableTypeArray) return 0;
+    lsw_CatchableTypeArray* cta =
+        (lsw_CatchableTypeArray*)lsw_throw_rva2va(throw_info->pCatchableTypeArray);
+    if (!cta || cta->nCatchableTypes <= 0 || cta->nCatchableTypes > 64) return 0;
+    for (int ci = 0; ci < cta->nCatchableTypes && n < max; ci++) {
+        lsw_CatchableType* ct = (lsw_CatchableType*)lsw_throw_rva2va(cta->arrayOfCatchableTypes[ci]);
+        if (ct && ct->pType) out[n++] = tls_cxx_throw_base + ct->pType;
     }
-    return NULL;
+    return n;
 }
 
 /*
- * Apply UNWIND_INFO codes to 'current_rsp' to reconstruct the caller's RSP
- * and RIP.  Returns the "entry RSP" (RSP at function entry = points to the
- * return address on the stack).
+ * Reconstruct the caller's RSP and RIP from 'current_rsp' (the frame's body
+ * RSP).  Returns the "entry RSP" (RSP at function entry = points to the
+ * return address on the stack).  The decoded codes are cached per function.
  */
 static uint64_t lsw_unwind_frame(lsw_RUNTIME_FUNCTION* rf,
                                   uint64_t current_rsp,
@@ -1617,62 +1924,8 @@ static uint64_t lsw_unwind_frame(lsw_RUNTIME_FUNCTION* rf,
                                   uint64_t* out_caller_rsp)
 {
     if (!rf) return 0;
-
-    /* Resolve UNWIND_INFO header */
-    uint8_t* ui = (uint8_t*)lsw_rva2va(rf->UnwindData);
-    if (!ui) return 0;
-
-    /* Handle CHAININFO: follow the chained RUNTIME_FUNCTION instead */
-    for (int chain_depth = 0; chain_depth < 8; chain_depth++) {
-        uint8_t flags      = (ui[0] >> 3) & 0x1fu;
-        uint8_t code_count = ui[2];
-        int     codes_sz   = (int)(((code_count + 1) & ~1) * 2);
-        uint8_t* codes     = ui + 4;
-
-        if (flags & UNW_FLAG_CHAININFO) {
-            /* Chained: skip unwind codes, follow chain RUNTIME_FUNCTION */
-            lsw_RUNTIME_FUNCTION* chain_rf =
-                (lsw_RUNTIME_FUNCTION*)(codes + codes_sz);
-            ui = (uint8_t*)lsw_rva2va(chain_rf->UnwindData);
-            if (!ui) return 0;
-            continue;
-        }
-
-        /* Process unwind codes to compute caller's RSP */
-        uint64_t rsp = current_rsp;
-        uint16_t* c  = (uint16_t*)codes;
-        for (int i = 0; i < code_count; ) {
-            uint8_t op   = (c[i] >> 8) & 0xFu;
-            uint8_t info = (c[i] >> 12) & 0xFu;
-            switch (op) {
-            case UWOP_PUSH_NONVOL:      rsp += 8;               i += 1; break;
-            case UWOP_ALLOC_SMALL:      rsp += 8u*(info+1u);    i += 1; break;
-            case UWOP_ALLOC_LARGE:
-                if (info == 0) {
-                    rsp += 8u * (uint64_t)c[i+1];               i += 2;
-                } else {
-                    uint32_t v; memcpy(&v, &c[i+1], 4);
-                    rsp += v;                                    i += 3;
-                }
-                break;
-            case UWOP_SET_FPREG:        i += 1; break;
-            case UWOP_SAVE_NONVOL:      i += 2; break;
-            case UWOP_SAVE_NONVOL_FAR:  i += 3; break;
-            case UWOP_SAVE_XMM128:      i += 2; break;
-            case UWOP_SAVE_XMM128_FAR:  i += 3; break;
-            case UWOP_PUSH_MACHFRAME:   i += 1; break;
-            default:                    i += 1; break;
-            }
-        }
-
-        /* After undoing the prolog, rsp points to the saved return address */
-        if (rsp < 0x1000 || rsp > (uint64_t)0x7fffffffffff00ULL) return 0;
-        uint64_t ret_addr = *(uint64_t*)rsp;
-        *out_caller_rip = ret_addr;
-        *out_caller_rsp = rsp + 8;
-        return rsp;   /* "entry RSP" = function-entry RSP, points to ret addr */
-    }
-    return 0;
+    return win32_unwind_rsp(tls_eh_base, (const win32_runtime_function_t*)rf, current_rsp,
+                            out_caller_rip, out_caller_rsp);
 }
 
 /* -----------------------------------------------------------------------
@@ -1728,7 +1981,7 @@ static int32_t lsw_eh4_ip_to_state(uint32_t ipts_rva, uint32_t ip_offset)
 {
     const uint8_t *p = (const uint8_t *)lsw_rva2va(ipts_rva);
     if (!p) return -1;
-    const uint8_t *img_end = (const uint8_t *)(g_lsw_image_base + g_lsw_image_size);
+    const uint8_t *img_end = lsw_eh_image_end();
 
     uint32_t num = lsw_eh4_read_uint(&p);
     if (num == 0 || num > 65536u) return -1;
@@ -1775,7 +2028,7 @@ static bool lsw_eh4_find_catch(uint32_t funcinfo_rva,
 {
     const uint8_t *fi = (const uint8_t *)lsw_rva2va(funcinfo_rva);
     if (!fi) return false;
-    const uint8_t *img_end = (const uint8_t *)(g_lsw_image_base + g_lsw_image_size);
+    const uint8_t *img_end = lsw_eh_image_end();
     if (fi >= img_end) return false;
 
     const uint8_t *p = fi;
@@ -1801,25 +2054,14 @@ static bool lsw_eh4_find_catch(uint32_t funcinfo_rva,
         return false;
 
     /* Determine current EH state via IPtoStateMap */
-    uint32_t ip_offset = (uint32_t)(rip - g_lsw_image_base) - func_begin_rva;
+    uint32_t ip_offset = (uint32_t)(rip - tls_eh_base) - func_begin_rva;
     int32_t  cur_state = lsw_eh4_ip_to_state(disp_ip_map, ip_offset);
     LSW_LOG_INFO("[exception] EH4 func=0x%x ip_offset=0x%x cur_state=%d tbm=0x%x",
                  func_begin_rva, ip_offset, cur_state, disp_tb_map);
 
-    /* Build catchable pType list from ThrowInfo */
-    uint32_t catchable_ptype[16];
-    int      n_catchable = 0;
-    if (throw_info && throw_info->pCatchableTypeArray) {
-        lsw_CatchableTypeArray *cta =
-            (lsw_CatchableTypeArray *)lsw_rva2va(throw_info->pCatchableTypeArray);
-        if (cta && cta->nCatchableTypes > 0 && cta->nCatchableTypes <= 64) {
-            for (int ci = 0; ci < cta->nCatchableTypes && n_catchable < 16; ci++) {
-                lsw_CatchableType *ct =
-                    (lsw_CatchableType *)lsw_rva2va(cta->arrayOfCatchableTypes[ci]);
-                if (ct) catchable_ptype[n_catchable++] = ct->pType;
-            }
-        }
-    }
+    /* Build catchable type list from ThrowInfo */
+    uint64_t catchable_type[16];
+    int      n_catchable = lsw_catchable_types(throw_info, catchable_type, 16);
 
     /* Walk TryBlockMap */
     const uint8_t *tbp = (const uint8_t *)lsw_rva2va(disp_tb_map);
@@ -1877,10 +2119,10 @@ static bool lsw_eh4_find_catch(uint32_t funcinfo_rva,
             for (uint8_t ca = 0; ca < cont_cnt && hmp < img_end - 4; ca++) {
                 if (cont_is_rva) {
                     int32_t rva = lsw_eh4_read_int(&hmp);
-                    if (ca < 2) my_cont_vas[ca] = g_lsw_image_base + (uint32_t)rva;
+                    if (ca < 2) my_cont_vas[ca] = tls_eh_base + (uint32_t)rva;
                 } else {
                     uint32_t off = lsw_eh4_read_uint(&hmp);
-                    if (ca < 2) my_cont_vas[ca] = g_lsw_image_base + func_begin_rva + off;
+                    if (ca < 2) my_cont_vas[ca] = tls_eh_base + func_begin_rva + off;
                 }
             }
 
@@ -1892,7 +2134,7 @@ static bool lsw_eh4_find_catch(uint32_t funcinfo_rva,
                 matches = true; /* catch(...) */
             } else {
                 for (int ci = 0; ci < n_catchable; ci++) {
-                    if ((uint32_t)d_type == catchable_ptype[ci]) {
+                    if (lsw_same_type(tls_eh_base + (uint32_t)d_type, catchable_type[ci])) {
                         matches = true;
                         break;
                     }
@@ -1900,7 +2142,7 @@ static bool lsw_eh4_find_catch(uint32_t funcinfo_rva,
             }
 
             if (matches) {
-                *handler_va     = g_lsw_image_base + (uint32_t)d_handler;
+                *handler_va     = tls_eh_base + (uint32_t)d_handler;
                 *disp_catch_obj = (int32_t)d_catch;
                 *out_adjectives = adj;
                 if (out_cont_cnt) *out_cont_cnt = my_cont_cnt;
@@ -1931,7 +2173,7 @@ static int32_t lsw_ip_to_state(lsw_FuncInfo3* fi, uint64_t rip) {
     if (!fi->nIPMap || !fi->pIPMap) return -1;
     lsw_IPStateEntry* map = (lsw_IPStateEntry*)lsw_rva2va(fi->pIPMap);
     if (!map) return -1;
-    uint32_t rip_rva = (uint32_t)(rip - g_lsw_image_base);
+    uint32_t rip_rva = (uint32_t)(rip - tls_eh_base);
     int32_t state = -1;
     for (uint32_t i = 0; i < fi->nIPMap; i++) {
         if ((uint32_t)map[i].Ip <= rip_rva)
@@ -1966,177 +2208,152 @@ static bool lsw_find_catch_in_frame(lsw_RUNTIME_FUNCTION* rf,
                                      uint64_t* out_eh4_cont_vas,
                                      uint32_t* out_eh4_cont_cnt)
 {
-    /* Load UNWIND_INFO to find the handler function and FuncInfo RVA */
-    uint8_t* ui = (uint8_t*)lsw_rva2va(rf->UnwindData);
-    if (!ui) return false;
-
-    /* Chase chains to find the real UNWIND_INFO with EHANDLER */
-    for (int depth = 0; depth < 8; depth++) {
-        uint8_t flags      = (ui[0] >> 3) & 0x1fu;
-        uint8_t code_count = ui[2];
-        int     codes_sz   = (int)(((code_count + 1) & ~1) * 2);
-
-        if (flags & UNW_FLAG_CHAININFO) {
-            lsw_RUNTIME_FUNCTION* chain =
-                (lsw_RUNTIME_FUNCTION*)(ui + 4 + codes_sz);
-            ui = (uint8_t*)lsw_rva2va(chain->UnwindData);
-            if (!ui) return false;
-            continue;
-        }
-        if (!(flags & UNW_FLAG_EHANDLER))
-            return false;
-
-        /* handler RVA and FuncInfo RVA follow the unwind codes.
-         *
-         * For __CxxFrameHandler3:
-         *   after[0] = handlerRVA, after[1] = FuncInfo3 RVA
-         * For __GSHandlerCheck_EH3 (stack-cookie protected functions):
-         *   after[0] = handlerRVA
-         *   after[1..4] = GS_HANDLERDATA (GSCookieOffset, GSCookieXorOffset,
-         *                                  EHCookieOffset, EHCookieXorOffset)
-         *   after[5] = FuncInfo3 RVA
-         * We try after[1] first; if magic doesn't match, try after[5].
-         */
-        uint32_t* after = (uint32_t*)(ui + 4 + codes_sz);
-
-        if ((uint32_t*)after + 2 > (uint32_t*)((uint8_t*)g_lsw_pdata_va + g_lsw_pdata_size + 0x10000))
-            return false;  /* rough bounds check */
-
-        /* Try to locate FuncInfo3: check after[1] first (plain EH3),
-         * then after[5] (GSHandlerCheck_EH3 with 4-DWORD cookie data). */
-        lsw_FuncInfo3* fi = NULL;
-        LSW_LOG_INFO("[exception] find_catch func=0x%x after[0]=0x%x after[1]=0x%x after[5]=0x%x",
-                     rf->BeginAddress, after[0], after[1], after[5]);
-        for (int fi_offset = 1; fi_offset <= 5; fi_offset += 4) {
-            uint32_t funcinfo_rva = after[fi_offset];
-            lsw_FuncInfo3* candidate = (lsw_FuncInfo3*)lsw_rva2va(funcinfo_rva);
-            LSW_LOG_INFO("[exception]   fi_offset=%d rva=0x%x candidate=%p magic=0x%x",
-                         fi_offset, funcinfo_rva, (void*)candidate,
-                         candidate ? candidate->magic : 0);
-            if (candidate &&
-                candidate->magic >= 0x19930520u && candidate->magic <= 0x19930524u) {
-                fi = candidate;
-                break;
-            }
+    /* The handler and its data come from the cached unwind recipe, which
+     * has already followed any chained infos */
+    uint32_t hflags;
+    void*    hdata;
+    win32_unwind_handler(tls_eh_base, (const win32_runtime_function_t*)rf, &hflags, &hdata);
+    if (!(hflags & UNW_FLAG_EHANDLER))
+        return false;
+
+    /* handler RVA and FuncInfo RVA follow the unwind codes.
+     *
+     * For __CxxFrameHandler3:
+     *   after[0] = handlerRVA, after[1] = FuncInfo3 RVA
+     * For __GSHandlerCheck_EH3 (stack-cookie protected functions):
+     *   after[0] = handlerRVA
+     *   after[1..4] = GS_HANDLERDATA (GSCookieOffset, GSCookieXorOffset,
+     *                                  EHCookieOffset, EHCookieXorOffset)
+     *   after[5] = FuncInfo3 RVA
+     * We try after[1] first; if magic doesn't match, try after[5].
+     */
+    uint32_t* after = (uint32_t*)hdata - 1;
+
+    if ((const uint8_t*)(after + 6) > lsw_eh_image_end())
+        return false;  /* handler data runs past the image */
+
+    /* Try to locate FuncInfo3: check after[1] first (plain EH3),
+     * then after[5] (GSHandlerCheck_EH3 with 4-DWORD cookie data). */
+    lsw_FuncInfo3* fi = NULL;
+    LSW_LOG_INFO("[exception] find_catch func=0x%x after[0]=0x%x after[1]=0x%x after[5]=0x%x",
+                 rf->BeginAddress, after[0], after[1], after[5]);
+    for (int fi_offset = 1; fi_offset <= 5; fi_offset += 4) {
+        uint32_t funcinfo_rva = after[fi_offset];
+        lsw_FuncInfo3* candidate = (lsw_FuncInfo3*)lsw_rva2va(funcinfo_rva);
+        LSW_LOG_INFO("[exception]   fi_offset=%d rva=0x%x candidate=%p magic=0x%x",
+                     fi_offset, funcinfo_rva, (void*)candidate,
+                     candidate ? candidate->magic : 0);
+        if (candidate &&
+            candidate->magic >= 0x19930520u && candidate->magic <= 0x19930524u) {
+            fi = candidate;
+            break;
         }
-        if (!fi) {
-            /* EH3 not found — try EH4 (__CxxFrameHandler4, VS2019+).
-             * FuncInfo4 starts with a 1-byte header (value 0x00-0x7F) rather
-             * than the EH3 magic DWORD.  Try the same after[1] / after[5]
-             * offsets used for EH3. */
-            LSW_LOG_INFO("[exception]   no FuncInfo3; trying EH4 for func=0x%x",
-                         rf->BeginAddress);
-            for (int fi4_off = 1; fi4_off <= 5; fi4_off += 4) {
-                uint32_t fi4_rva = after[fi4_off];
-                uint8_t *fi4_ptr = (uint8_t *)lsw_rva2va(fi4_rva);
-                if (!fi4_ptr) continue;
-                /* Quick sanity: EH4 header byte must be in 0x00-0x7F range and
-                 * must NOT be the lead byte of an EH3 magic (0x20 from 0x19930520
-                 * can appear here; we still let the parser try and it will bail if
-                 * the derived RVAs are invalid). */
-                uint8_t hdr4 = fi4_ptr[0];
-                if (hdr4 > 0x1Fu) continue; /* reserved bits set → garbage */
-                if (lsw_eh4_find_catch(fi4_rva, rf->BeginAddress, rip,
-                                       throw_info, handler_va,
-                                       disp_catch_obj, out_adjectives,
-                                       out_eh4_cont_vas, out_eh4_cont_cnt)) {
-                    if (out_is_eh4) *out_is_eh4 = true;
-                    return true;
-                }
+    }
+    if (!fi) {
+        /* EH3 not found — try EH4 (__CxxFrameHandler4, VS2019+).
+         * FuncInfo4 starts with a 1-byte header (value 0x00-0x7F) rather
+         * than the EH3 magic DWORD.  Try the same after[1] / after[5]
+         * offsets used for EH3. */
+        LSW_LOG_INFO("[exception]   no FuncInfo3; trying EH4 for func=0x%x",
+                     rf->BeginAddress);
+        for (int fi4_off = 1; fi4_off <= 5; fi4_off += 4) {
+            uint32_t fi4_rva = after[fi4_off];
+            uint8_t *fi4_ptr = (uint8_t *)lsw_rva2va(fi4_rva);
+            if (!fi4_ptr) continue;
+            /* Quick sanity: EH4 header byte must be in 0x00-0x7F range and
+             * must NOT be the lead byte of an EH3 magic (0x20 from 0x19930520
+             * can appear here; we still let the parser try and it will bail if
+             * the derived RVAs are invalid). */
+            uint8_t hdr4 = fi4_ptr[0];
+            if (hdr4 > 0x1Fu) continue; /* reserved bits set → garbage */
+            if (lsw_eh4_find_catch(fi4_rva, rf->BeginAddress, rip,
+                                   throw_info, handler_va,
+                                   disp_catch_obj, out_adjectives,
+                                   out_eh4_cont_vas, out_eh4_cont_cnt)) {
+                if (out_is_eh4) *out_is_eh4 = true;
+                return true;
             }
-            return false;
         }
+        return false;
+    }
 
-        LSW_LOG_INFO("[exception] fi=%p magic=0x%x nTryBlocks=%u pTryBlockMap=0x%x",
-                     (void*)fi, fi->magic, fi->nTryBlocks, fi->pTryBlockMap);
-
-        if (!fi->nTryBlocks || !fi->pTryBlockMap)
-            return false;
+    LSW_LOG_INFO("[exception] fi=%p magic=0x%x nTryBlocks=%u pTryBlockMap=0x%x",
+                 (void*)fi, fi->magic, fi->nTryBlocks, fi->pTryBlockMap);
 
-        int32_t cur_state = lsw_ip_to_state(fi, rip);
-        LSW_LOG_INFO("[exception] cur_state=%d for rip=0x%lx func=0x%x",
-                     cur_state, (unsigned long)rip, rf->BeginAddress);
+    if (!fi->nTryBlocks || !fi->pTryBlockMap)
+        return false;
 
-        lsw_TryBlockMapEntry* tbm =
-            (lsw_TryBlockMapEntry*)lsw_rva2va(fi->pTryBlockMap);
-        LSW_LOG_INFO("[exception] tbm=%p", (void*)tbm);
-        if (!tbm) return false;
+    int32_t cur_state = lsw_ip_to_state(fi, rip);
+    LSW_LOG_INFO("[exception] cur_state=%d for rip=0x%lx func=0x%x",
+                 cur_state, (unsigned long)rip, rf->BeginAddress);
 
-        for (uint32_t t = 0; t < fi->nTryBlocks; t++) {
-            lsw_TryBlockMapEntry* tb = &tbm[t];
-            /* Check if current state is within this try block */
-            if (cur_state >= 0 &&
-                (cur_state < tb->tryLow || cur_state > tb->tryHigh))
-                continue;
+    lsw_TryBlockMapEntry* tbm =
+        (lsw_TryBlockMapEntry*)lsw_rva2va(fi->pTryBlockMap);
+    LSW_LOG_INFO("[exception] tbm=%p", (void*)tbm);
+    if (!tbm) return false;
 
-            if (!tb->nCatches || !tb->pHandlerArray) continue;
-            lsw_HandlerType* ha =
-                (lsw_HandlerType*)lsw_rva2va(tb->pHandlerArray);
-            if (!ha) continue;
-
-            /* Build a quick list of catchable pType RVAs from the ThrowInfo
-             * so we can match typed handlers as well as catch(...). */
-            uint32_t catchable_ptype[16];
-            int n_catchable = 0;
-            if (throw_info && throw_info->pCatchableTypeArray) {
-                lsw_CatchableTypeArray* cta =
-                    (lsw_CatchableTypeArray*)lsw_rva2va(throw_info->pCatchableTypeArray);
-                if (cta && cta->nCatchableTypes > 0 && cta->nCatchableTypes <= 64) {
-                    for (int ci = 0; ci < cta->nCatchableTypes && n_catchable < 16; ci++) {
-                        uint32_t ct_rva = cta->arrayOfCatchableTypes[ci];
-                        lsw_CatchableType* ct = (lsw_CatchableType*)lsw_rva2va(ct_rva);
-                        if (ct) catchable_ptype[n_catchable++] = ct->pType;
-                    }
-                }
-            }
+    for (uint32_t t = 0; t < fi->nTryBlocks; t++) {
+        lsw_TryBlockMapEntry* tb = &tbm[t];
+        /* Check if current state is within this try block */
+        if (cur_state >= 0 &&
+            (cur_state < tb->tryLow || cur_state > tb->tryHigh))
+            continue;
 
-            /* Try 20-byte then 16-byte HandlerType strides.
-             * VS2019+ uses 20 bytes (adds dispFrame field); older uses 16. */
-            for (int stride = 20; stride >= 16; stride -= 4) {
-                bool found = false;
-                for (int32_t k = 0; k < tb->nCatches; k++) {
-                    lsw_HandlerType* h =
-                        (lsw_HandlerType*)((uint8_t*)ha + k * stride);
-                    if (!h->addressOfHandler) continue;
-
-                    bool matches = false;
-                    if (h->pType == 0) {
-                        /* catch(...) — matches anything */
-                        matches = true;
-                    } else {
-                        /* Typed catch — match against thrown type hierarchy */
-                        for (int ci = 0; ci < n_catchable; ci++) {
-                            if (catchable_ptype[ci] == h->pType) {
-                                matches = true;
-                                break;
-                            }
+        if (!tb->nCatches || !tb->pHandlerArray) continue;
+        lsw_HandlerType* ha =
+            (lsw_HandlerType*)lsw_rva2va(tb->pHandlerArray);
+        if (!ha) continue;
+
+        /* Build a quick list of catchable types from the ThrowInfo
+         * so we can match typed handlers as well as catch(...). */
+        uint64_t catchable_type[16];
+        int n_catchable = lsw_catchable_types(throw_info, catchable_type, 16);
+
+        /* Try 20-byte then 16-byte HandlerType strides.
+         * VS2019+ uses 20 bytes (adds dispFrame field); older uses 16. */
+        for (int stride = 20; stride >= 16; stride -= 4) {
+            bool found = false;
+            for (int32_t k = 0; k < tb->nCatches; k++) {
+                lsw_HandlerType* h =
+                    (lsw_HandlerType*)((uint8_t*)ha + k * stride);
+                if (!h->addressOfHandler) continue;
+
+                bool matches = false;
+                if (h->pType == 0) {
+                    /* catch(...) — matches anything */
+                    matches = true;
+                } else {
+                    /* Typed catch — match against thrown type hierarchy */
+                    for (int ci = 0; ci < n_catchable; ci++) {
+                        if (lsw_same_type(tls_eh_base + h->pType, catchable_type[ci])) {
+                            matches = true;
+                            break;
                         }
                     }
-
-                    if (matches) {
-                        *handler_va     = g_lsw_image_base + h->addressOfHandler;
-                        *disp_catch_obj = h->dispCatchObj;
-                        *out_adjectives = h->adjectives;
-                        LSW_LOG_INFO("[exception] catch %s in func 0x%x "
-                                     "handler=0x%lx disp=%d state=%d [%d,%d]",
-                                     h->pType ? "typed" : "(...)",
-                                     rf->BeginAddress,
-                                     (unsigned long)*handler_va,
-                                     *disp_catch_obj,
-                                     cur_state, tb->tryLow, tb->tryHigh);
-                        found = true;
-                        return true;
-                    }
                 }
-                /* If adj values look reasonable for this stride, stop here.
-                 * Adjectives should be small flags (0-15); large values indicate wrong stride. */
-                if (!found && stride == 20 && tb->nCatches > 0) {
-                    lsw_HandlerType* h0 = ha;
-                    if (h0->adjectives <= 0xF) break; /* 20-byte stride fits; no match */
+
+                if (matches) {
+                    *handler_va     = tls_eh_base + h->addressOfHandler;
+                    *disp_catch_obj = h->dispCatchObj;
+                    *out_adjectives = h->adjectives;
+                    LSW_LOG_INFO("[exception] catch %s in func 0x%x "
+                                 "handler=0x%lx disp=%d state=%d [%d,%d]",
+                                 h->pType ? "typed" : "(...)",
+                                 rf->BeginAddress,
+                                 (unsigned long)*handler_va,
+                                 *disp_catch_obj,
+                                 cur_state, tb->tryLow, tb->tryHigh);
+                    found = true;
+                    return true;
                 }
             }
+            /* If adj values look reasonable for this stride, stop here.
+             * Adjectives should be small flags (0-15); large values indicate wrong stride. */
+            if (!found && stride == 20 && tb->nCatches > 0) {
+                lsw_HandlerType* h0 = ha;
+                if (h0->adjectives <= 0xF) break; /* 20-byte stride fits; no match */
+            }
         }
-        return false;
     }
     return false;
 }
@@ -2146,6 +2363,7 @@ void __attribute__((ms_abi)) lsw__CxxThrowException(void* obj, void* throwInfo)
     /* Store exception info for any outer handler that needs it */
     tls_cxx_exception_obj  = obj;
     tls_cxx_exception_type = throwInfo;
+    if (throwInfo) lsw_set_throw_image(win32_ftab_image((uint64_t)(uintptr_t)throwInfo, NULL));
 
     /* ------------------------------------------------------------------ *
      * Reconstruct the PE caller's frame from GCC's RBP chain.             *
@@ -2184,21 +2402,9 @@ void __attribute__((ms_abi)) lsw__CxxThrowException(void* obj, void* throwInfo)
                      w0, w1, w0);
     }
 
-    /* Verify we have PE image info before trying to dispatch */
-    if (!g_lsw_pdata_va || !g_lsw_image_base) {
-        LSW_LOG_ERROR("[exception] No PE image info — cannot dispatch C++ exception");
-        abort();
-    }
-
-    /* Walk the PE call stack looking for a matching catch handler */
+    /* Walk the PE call stack looking for a matching catch handler; the
+     * walk ends at the first frame outside every registered image and table */
     for (int depth = 0; depth < 128; depth++) {
-        if (rip < g_lsw_image_base ||
-            rip >= g_lsw_image_base + 0x10000000ULL) {
-            LSW_LOG_WARN("[exception] RIP 0x%lx outside PE image, stopping walk",
-                         (unsigned long)rip);
-            break;
-        }
-
         lsw_RUNTIME_FUNCTION* rf = lsw_find_rf(rip);
         if (!rf) {
             LSW_LOG_WARN("[exception] No RUNTIME_FUNCTION for RIP 0x%lx depth=%d",
@@ -2270,10 +2476,10 @@ void __attribute__((ms_abi)) lsw__CxxThrowException(void* obj, void* throwInfo)
                 size_t obj_size = 0;
                 if (ti->pCatchableTypeArray) {
                     lsw_CatchableTypeArray* cta =
-                        (lsw_CatchableTypeArray*)lsw_rva2va(ti->pCatchableTypeArray);
+                        (lsw_CatchableTypeArray*)lsw_throw_rva2va(ti->pCatchableTypeArray);
                     if (cta && cta->nCatchableTypes > 0) {
                         lsw_CatchableType* ct =
-                            (lsw_CatchableType*)lsw_rva2va(cta->arrayOfCatchableTypes[0]);
+                            (lsw_CatchableType*)lsw_throw_rva2va(cta->arrayOfCatchableTypes[0]);
                         if (ct && ct->sizeOrOffset > 0 && ct->sizeOrOffset <= 65536)
                             obj_size = (size_t)ct->sizeOrOffset;
                     }
@@ -2459,92 +2665,84 @@ int* __attribute__((ms_abi)) lsw___mb_cur_max_func(void) {
     return &mb_cur_max;
 }
 
-// KERNEL32 stubs
+// KERNEL32 code page conversion (engine in win32_unicode.c)
+#define MB_ERR_INVALID_CHARS 0x08
+#define WC_ERR_INVALID_CHARS 0x80
+
 int __attribute__((ms_abi)) lsw_IsDBCSLeadByteEx(unsigned int codepage, unsigned char testchar) {
-    (void)codepage;
-    (void)testchar;
-    return 0; // Not DBCS for now
+    return win32_codepage_is_lead_byte(codepage, testchar);
 }
 
-int __attribute__((ms_abi)) lsw_MultiByteToWideChar(unsigned int codepage, unsigned long flags, const char* src, int srclen, uint16_t* dst, int dstlen) {
-    (void)codepage;
-    (void)flags;
+int __attribute__((ms_abi)) lsw_IsDBCSLeadByte(unsigned char testchar) {
+    return win32_codepage_is_lead_byte(CP_ACP, testchar);
+}
 
-    /* -1 means null-terminated: include the null terminator in length */
-    int len;
-    if (srclen == -1) {
-        len = src ? (int)strlen(src) + 1 : 1; /* +1 for null terminator */
-    } else {
-        len = srclen >= 0 ? srclen : 0;
-    }
+int __attribute__((ms_abi)) lsw_IsValidCodePage(unsigned int codepage) {
+    /* Pseudo code pages are not valid arguments here */
+    return codepage > 3 && win32_codepage_valid(codepage);
+}
 
-    if (!dst) {
-        LSW_LOG_DEBUG("MultiByteToWideChar: query size for %d chars (incl null)", len);
-        return len;
+/* Map a transcoder result onto the Win32 return / last-error contract */
+static int lsw_transcode_result(ptrdiff_t r) {
+    if (r == WIN32_UNICODE_NOSPACE) {
+        lsw_SetLastError(122); /* ERROR_INSUFFICIENT_BUFFER */
+        return 0;
     }
+    if (r < 0) {
+        lsw_SetLastError(1113); /* ERROR_NO_UNICODE_TRANSLATION */
+        return 0;
+    }
+    if (r > INT32_MAX) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
+    }
+    return (int)r;
+}
 
-    if (len > dstlen) len = dstlen;
-    LSW_LOG_DEBUG("MultiByteToWideChar: cp=%u srclen=%d dstlen=%d -> %d chars", codepage, srclen, dstlen, len);
-
-    /* Write UTF-16LE (2-byte) characters into dst — caller is Windows code expecting uint16_t */
-    for (int i = 0; i < len; i++) {
-        dst[i] = (uint16_t)(unsigned char)src[i];
+int __attribute__((ms_abi)) lsw_MultiByteToWideChar(unsigned int codepage, unsigned long flags, const char* src, int srclen, uint16_t* dst, int dstlen) {
+    if (!src || srclen == 0 || srclen < -1 || dstlen < 0 || (dstlen && !dst) ||
+        !win32_codepage_valid(codepage)) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
     }
 
-    return len;
+    /* -1 means null-terminated: the terminator is converted too */
+    size_t len = srclen == -1 ? strlen(src) + 1 : (size_t)srclen;
+    int strict = (flags & MB_ERR_INVALID_CHARS) != 0;
+    uint16_t* out = dstlen ? dst : NULL; /* dstlen == 0 is a size query */
+
+    ptrdiff_t r = codepage == CP_UTF8
+        ? win32_utf8_to_utf16((const uint8_t*)src, len, out, (size_t)dstlen, strict)
+        : win32_mb_to_utf16(codepage, (const uint8_t*)src, len, out, (size_t)dstlen, strict);
+    return lsw_transcode_result(r);
 }
 
 int __attribute__((ms_abi)) lsw_WideCharToMultiByte(unsigned int codepage, unsigned long flags, const wchar_t* src, int srclen, char* dst, int dstlen, const char* defchar, int* used_default) {
-    (void)codepage;
-    (void)flags;
-    (void)defchar;
-
-    if (!src) return 0;
+    if (!src || srclen == 0 || srclen < -1 || dstlen < 0 || (dstlen && !dst) ||
+        !win32_codepage_valid(codepage)) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
+    }
 
     /* Windows wchar_t is UTF-16 (2 bytes); Linux wchar_t is 4 bytes — treat as uint16_t* */
     const uint16_t* src16 = (const uint16_t*)src;
-
-    size_t actual_srclen;
+    size_t len = (size_t)srclen;
     if (srclen == -1) {
-        actual_srclen = 0;
-        while (src16[actual_srclen] != 0) actual_srclen++;
-        actual_srclen++; /* include null terminator */
-    } else {
-        actual_srclen = (size_t)srclen;
+        len = 0;
+        while (src16[len]) len++;
+        len++; /* include null terminator */
     }
+    uint8_t* out = dstlen ? (uint8_t*)dst : NULL;
 
-    if (!dst || dstlen == 0) {
-        /* Query required size */
-        return (int)actual_srclen; /* Conservative: 1 byte per wide char for BMP */
-    }
-
-    LSW_LOG_DEBUG("WideCharToMultiByte: cp=%u srclen=%d dstlen=%d actual=%zu", codepage, srclen, dstlen, actual_srclen);
-
-    size_t src_idx = 0, dst_idx = 0;
-    while (src_idx < actual_srclen && dst_idx < (size_t)dstlen) {
-        uint16_t wc = src16[src_idx++];
-
-        if (wc == 0) {
-            if (srclen == -1) dst[dst_idx++] = '\0'; /* include null only if source was null-terminated */
-            break;
-        } else if (wc < 0x80) {
-            dst[dst_idx++] = (char)wc;
-        } else if (wc < 0x800) {
-            if (dst_idx + 2 > (size_t)dstlen) break;
-            dst[dst_idx++] = (char)(0xC0 | ((wc >> 6) & 0x1F));
-            dst[dst_idx++] = (char)(0x80 | (wc & 0x3F));
-        } else if (wc < 0xD800 || wc >= 0xE000) {
-            if (dst_idx + 3 > (size_t)dstlen) break;
-            dst[dst_idx++] = (char)(0xE0 | ((wc >> 12) & 0x0F));
-            dst[dst_idx++] = (char)(0x80 | ((wc >> 6) & 0x3F));
-            dst[dst_idx++] = (char)(0x80 | (wc & 0x3F));
-        } else {
-            dst[dst_idx++] = '?';
-        }
+    ptrdiff_t r;
+    if (codepage == CP_UTF8) {
+        /* UTF-8 has no default character; lone surrogates become U+FFFD */
+        if (used_default) *used_default = 0;
+        r = win32_utf16_to_utf8(src16, len, out, (size_t)dstlen, (flags & WC_ERR_INVALID_CHARS) != 0);
+    } else {
+        r = win32_utf16_to_mb(codepage, src16, len, out, (size_t)dstlen, defchar, used_default);
     }
-
-    if (used_default) *used_default = 0;
-    return (int)dst_idx;
+    return lsw_transcode_result(r);
 }
 
 void* __attribute__((ms_abi)) lsw_TlsGetValue(unsigned long index) {
@@ -2869,11 +3067,14 @@ int __attribute__((ms_abi)) lsw_VirtualFree(void* addr, size_t size, uint32_t fr
 #define OPEN_EXISTING     3
 #define OPEN_ALWAYS       4
 #define TRUNCATE_EXISTING 5
+#define FILE_FLAG_OVERLAPPED 0x40000000
 #define INVALID_HANDLE_VALUE ((void*)(intptr_t)-1)
 
+static void lsw_file_bind_overlapped(void* handle);
+
 void* __attribute__((ms_abi)) lsw_CreateFileA(const char* filename, uint32_t access, uint32_t share_mode, 
                                                 void* security, uint32_t creation, uint32_t flags, void* template_file) {
-    (void)share_mode; (void)security; (void)template_file;
+    (void)template_file;
     
     // Translate Windows path to Linux path
     char linux_path[LSW_MAX_PATH];
@@ -2931,8 +3132,36 @@ void* __attribute__((ms_abi)) lsw_CreateFileA(const char* filename, uint32_t acc
         case TRUNCATE_EXISTING: oflags |= O_TRUNC; break;            /* truncate existing */
         default: break;
     }
+    if (!lsw_sa_inherit(security)) oflags |= O_CLOEXEC;
     
-    int fd = open(linux_path, oflags, 0644);
+    // Under a userspace overlay, anything that may write goes to the upper layer
+    int fd = -1;
+    if (!(oflags & (O_WRONLY | O_RDWR | O_CREAT | O_TRUNC)) ||
+        lsw_overlay_copy_up(linux_path, sizeof(linux_path), !(oflags & O_TRUNC)) == 0) {
+        /* Truncate only once the share mode allows it. A write-only open
+         * is made read-write where permitted so it can publish its share
+         * mode (shared OFD locks need read access). */
+        int open_flags = oflags & ~O_TRUNC;
+        if ((oflags & O_ACCMODE) == O_WRONLY) {
+            fd = open(linux_path, (open_flags & ~O_ACCMODE) | O_RDWR, 0644);
+            if (fd < 0 && errno == EACCES) fd = open(linux_path, open_flags, 0644);
+        } else {
+            fd = open(linux_path, open_flags, 0644);
+        }
+    }
+    if (fd >= 0 && win32_share_acquire(fd, win32_share_classes(access), share_mode) == EBUSY) {
+        LSW_LOG_DEBUG("CreateFileA: %s: sharing violation", linux_path);
+        close(fd);
+        lsw_SetLastError(32); /* ERROR_SHARING_VIOLATION */
+        return INVALID_HANDLE_VALUE;
+    }
+    if (fd >= 0 && (oflags & O_TRUNC)) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ftruncate(fd, 0) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
     if (fd < 0) {
         LSW_LOG_WARN("CreateFileA failed: %s (errno=%d, creation=%u, oflags=0x%x)", linux_path, errno, creation, oflags);
         /* Map errno to Win32 last error */
@@ -2945,21 +3174,30 @@ void* __attribute__((ms_abi)) lsw_CreateFileA(const char* filename, uint32_t acc
         return INVALID_HANDLE_VALUE;
     }
     
+    if (oflags & O_CREAT) lsw_fs_invalidate(linux_path);
+    if (flags & FILE_FLAG_OVERLAPPED) lsw_file_bind_overlapped((void*)(intptr_t)fd);
     LSW_LOG_DEBUG("CreateFileA: opened fd=%d", fd);
     lsw_SetLastError(0); /* ERROR_SUCCESS */
     return (void*)(intptr_t)fd;
 }
 
+int __attribute__((ms_abi)) lsw_FindCloseChangeNotification(void* handle);
+static void lsw_port_unbind(lsw_iocp_t* port);
+
 int __attribute__((ms_abi)) lsw_CloseHandle(void* handle) {
     if (handle == INVALID_HANDLE_VALUE || !handle) return 0;
 
     /* Windows pseudo-handles (STD_*) are not closeable */
     if (LSW_IS_PSEUDO_HANDLE(handle)) return 1;
 
+    /* Directory watch / completion port association */
+    lsw_handle_unbind(handle);
+
     /* Raw file descriptor — small integer, not a heap struct */
     if (!IS_TYPED_HANDLE(handle)) {
         intptr_t fd = (intptr_t)handle;
         if (fd >= 0 && fd < 1024) {
+            win32_lock_forget((int)fd);
             close((int)fd);
             return 1;
         }
@@ -2981,6 +3219,7 @@ int __attribute__((ms_abi)) lsw_CloseHandle(void* handle) {
     /* NT directory handle (from NtOpenFile/NtCreateFile) */
     if (magic == LSW_DIR_MAGIC) {
         lsw_nt_dir_handle_t* dh = (lsw_nt_dir_handle_t*)handle;
+        win32_dirscan_close((win32_dirscan_t*)dh->scan);
         if (dh->dirp) closedir((DIR*)dh->dirp);
         dh->magic = 0;
         free(dh);
@@ -2998,6 +3237,7 @@ int __attribute__((ms_abi)) lsw_CloseHandle(void* handle) {
     /* Event handle */
     if (magic == LSW_EVENT_MAGIC) {
         lsw_event_t* ev = (lsw_event_t*)handle;
+        lsw_reg_notify_cancel(ev);   /* RegNotifyChangeKeyValue would signal it later */
         pthread_mutex_destroy(&ev->lock);
         pthread_cond_destroy(&ev->cond);
         ev->magic = 0;
@@ -3038,14 +3278,30 @@ int __attribute__((ms_abi)) lsw_CloseHandle(void* handle) {
         pthread_detach(th->thread);
         pthread_mutex_destroy(&th->lock);
         pthread_cond_destroy(&th->cond);
+        lsw_apc_queue_put(th->apc);
         th->magic = 0;
         free(th);
         return 1;
     }
 
+    /* Change notification handle */
+    if (magic == LSW_CHANGE_MAGIC) {
+        return lsw_FindCloseChangeNotification(handle);
+    }
+
+    /* CreateProcess primary thread handle */
+    if (magic == LSW_CHILD_MAGIC) {
+        lsw_child_thread_t* ct = (lsw_child_thread_t*)handle;
+        win32_spawn_resume(ct->resume_fd);
+        ct->magic = 0;
+        free(ct);
+        return 1;
+    }
+
     /* IOCP handle */
     if (magic == LSW_IOCP_MAGIC) {
         lsw_iocp_t* io = (lsw_iocp_t*)handle;
+        lsw_port_unbind(io);
         close(io->wakefd[0]); close(io->wakefd[1]);
         pthread_mutex_destroy(&io->lock);
         lsw_completion_t* c = io->head;
@@ -3081,6 +3337,7 @@ int __attribute__((ms_abi)) lsw_SetEvent(void* handle) {
         if (ev->manual_reset) pthread_cond_broadcast(&ev->cond);
         else                  pthread_cond_signal(&ev->cond);
         pthread_mutex_unlock(&ev->lock);
+        lsw_obj_wake();
         return 1;
     }
     /* Print caller address so we can identify who passes handle=0x1 */
@@ -3426,10 +3683,15 @@ int __attribute__((ms_abi)) lsw_DeleteFileA(const char* filename) {
     
     LSW_LOG_INFO("DeleteFileA: %s -> %s", filename, linux_path);
     
-    if (unlink(linux_path) != 0) {
+    if (win32_share_check_delete(linux_path) == EBUSY) {
+        lsw_SetLastError(32); /* ERROR_SHARING_VIOLATION */
+        return 0;
+    }
+    if (lsw_overlay_unlink(linux_path) != 0) {
         LSW_LOG_ERROR("DeleteFileA: unlink failed: %s", strerror(errno));
         return 0; // FALSE
     }
+    lsw_fs_invalidate(linux_path);
     
     LSW_LOG_INFO("DeleteFileA: successfully deleted %s", linux_path);
     return 1; // TRUE
@@ -3479,106 +3741,164 @@ int __attribute__((ms_abi)) lsw_DeleteFileW(const wchar_t* filename) {
     return lsw_DeleteFileA(filename_mb);
 }
 
-int __attribute__((ms_abi)) lsw_CopyFileW(const wchar_t* existing_file, const wchar_t* new_file, int fail_if_exists) {
-    LSW_LOG_INFO("CopyFileW called");
-    
+/* Windows error for a failed copy or move */
+static uint32_t lsw_copy_error(int err) {
+    switch (err) {
+    case ENOENT:       return 2;     /* ERROR_FILE_NOT_FOUND */
+    case ENOTDIR:      return 3;     /* ERROR_PATH_NOT_FOUND */
+    case EACCES:
+    case EPERM:
+    case EROFS:
+    case EISDIR:       return 5;     /* ERROR_ACCESS_DENIED */
+    case EXDEV:        return 17;    /* ERROR_NOT_SAME_DEVICE */
+    case EBUSY:
+    case ETXTBSY:      return 32;    /* ERROR_SHARING_VIOLATION */
+    case EEXIST:       return 80;    /* ERROR_FILE_EXISTS */
+    case ENOSPC:
+    case EDQUOT:       return 112;   /* ERROR_DISK_FULL */
+    case ENOTEMPTY:    return 145;   /* ERROR_DIR_NOT_EMPTY */
+    case ENAMETOOLONG: return 206;   /* ERROR_FILENAME_EXCED_RANGE */
+    case ECANCELED:    return 1235;  /* ERROR_REQUEST_ABORTED */
+    case ENOMEM:       return 8;     /* ERROR_NOT_ENOUGH_MEMORY */
+    default:           return 1;     /* ERROR_INVALID_FUNCTION */
+    }
+}
+
+/* LPPROGRESS_ROUTINE; LARGE_INTEGERs travel by value */
+typedef uint32_t (__attribute__((ms_abi)) *LSW_PROGRESS_ROUTINE)(
+    int64_t total, int64_t transferred, int64_t stream_size, int64_t stream_transferred,
+    uint32_t stream, uint32_t reason, void* src_handle, void* dst_handle, void* data);
+
+typedef struct {
+    LSW_PROGRESS_ROUTINE routine;
+    void* data;
+    int   started;
+} lsw_copy_progress_t;
+
+/* Copy engine callback -> CALLBACK_STREAM_SWITCH once, then CALLBACK_CHUNK_FINISHED */
+static uint32_t lsw_copy_progress(uint64_t total, uint64_t done, void* ctx) {
+    lsw_copy_progress_t* p = ctx;
+    uint32_t reason = p->started ? 0 : 1;
+    p->started = 1;
+    return p->routine((int64_t)total, (int64_t)done, (int64_t)total, (int64_t)done,
+                      1, reason, NULL, NULL, p->data);
+}
+
+#define LSW_COPY_FILE_FAIL_IF_EXISTS   0x00000001
+#define LSW_COPY_FILE_NO_BUFFERING     0x00001000
+#define LSW_MOVEFILE_REPLACE_EXISTING  0x00000001
+#define LSW_MOVEFILE_COPY_ALLOWED      0x00000002
+#define LSW_MOVEFILE_DELAY_UNTIL_REBOOT 0x00000004
+#define LSW_MOVEFILE_WRITE_THROUGH     0x00000008
+
+/* CopyFileEx on Windows paths; returns 0 or the Windows error */
+static uint32_t lsw_copy_file_ex(const char* src, const char* dst, LSW_PROGRESS_ROUTINE routine,
+                                 void* data, const int* cancel, uint32_t flags) {
+    char src_linux[LSW_MAX_PATH], dst_linux[LSW_MAX_PATH];
+    if (lsw_fs_win_to_linux(src, src_linux, sizeof(src_linux)) != LSW_SUCCESS ||
+        lsw_fs_win_to_linux(dst, dst_linux, sizeof(dst_linux)) != LSW_SUCCESS) {
+        LSW_LOG_ERROR("CopyFile: path translation failed: %s -> %s", src, dst);
+        return 3; /* ERROR_PATH_NOT_FOUND */
+    }
+    LSW_LOG_INFO("CopyFile: %s -> %s (flags=0x%x)", src_linux, dst_linux, flags);
+
+    int cflags = ((flags & LSW_COPY_FILE_FAIL_IF_EXISTS) ? WIN32_COPY_FAIL_IF_EXISTS : 0) |
+                 ((flags & LSW_COPY_FILE_NO_BUFFERING) ? WIN32_COPY_NO_BUFFERING : 0);
+    lsw_copy_progress_t p = { routine, data, 0 };
+    int err = win32_copy_file(src_linux, dst_linux, cflags,
+                              routine ? lsw_copy_progress : NULL, &p, (const volatile int*)cancel);
+    if (err) LSW_LOG_WARN("CopyFile: %s -> %s: %s", src_linux, dst_linux, strerror(err));
+    return err ? lsw_copy_error(err) : 0;
+}
+
+/* MoveFileWithProgress on Windows paths; returns 0 or the Windows error */
+static uint32_t lsw_move_file_ex(const char* src, const char* dst, LSW_PROGRESS_ROUTINE routine,
+                                 void* data, uint32_t flags) {
+    if (!src || (!dst && !(flags & LSW_MOVEFILE_DELAY_UNTIL_REBOOT))) return 87; /* ERROR_INVALID_PARAMETER */
+    if (flags & LSW_MOVEFILE_DELAY_UNTIL_REBOOT) {
+        /* There is no reboot to schedule against */
+        LSW_LOG_WARN("MoveFileEx: MOVEFILE_DELAY_UNTIL_REBOOT not supported (%s)", src);
+        return 5; /* ERROR_ACCESS_DENIED, as for a caller without admin rights */
+    }
+    char src_linux[LSW_MAX_PATH], dst_linux[LSW_MAX_PATH];
+    if (lsw_fs_win_to_linux(src, src_linux, sizeof(src_linux)) != LSW_SUCCESS ||
+        lsw_fs_win_to_linux(dst, dst_linux, sizeof(dst_linux)) != LSW_SUCCESS) {
+        return 3; /* ERROR_PATH_NOT_FOUND */
+    }
+
+    int mflags = ((flags & LSW_MOVEFILE_REPLACE_EXISTING) ? WIN32_MOVE_REPLACE : 0) |
+                 ((flags & LSW_MOVEFILE_COPY_ALLOWED) ? WIN32_MOVE_COPY_ALLOWED : 0) |
+                 ((flags & LSW_MOVEFILE_WRITE_THROUGH) ? WIN32_MOVE_WRITE_THROUGH : 0);
+    lsw_copy_progress_t p = { routine, data, 0 };
+    int err = win32_move_file(src_linux, dst_linux, mflags,
+                              routine ? lsw_copy_progress : NULL, &p, NULL);
+    if (err == EEXIST) return 183; /* ERROR_ALREADY_EXISTS */
+    return err ? lsw_copy_error(err) : 0;
+}
+
+/* UTF-16 path to UTF-8 for the A cores */
+static int lsw_copy_path_a(const wchar_t* path, char* out, int size) {
+    return path && lsw_WideCharToMultiByte(CP_UTF8, 0, path, -1, out, size, NULL, NULL) != 0;
+}
+
+int __attribute__((ms_abi)) lsw_CopyFileExA(const char* existing_file, const char* new_file,
+                                            LSW_PROGRESS_ROUTINE progress, void* data, int* cancel, uint32_t flags) {
     if (!existing_file || !new_file) {
-        LSW_LOG_ERROR("CopyFileW: null filename");
-        return 0; // FALSE
-    }
-    
-    // Convert wide-char paths to multi-byte
-    char existing_mb[LSW_MAX_PATH];
-    char new_mb[LSW_MAX_PATH];
-    
-    if (lsw_WideCharToMultiByte(CP_UTF8, 0, existing_file, -1, existing_mb, sizeof(existing_mb), NULL, NULL) == 0) {
-        LSW_LOG_ERROR("CopyFileW: WideCharToMultiByte failed for source");
-        return 0;
-    }
-    
-    if (lsw_WideCharToMultiByte(CP_UTF8, 0, new_file, -1, new_mb, sizeof(new_mb), NULL, NULL) == 0) {
-        LSW_LOG_ERROR("CopyFileW: WideCharToMultiByte failed for dest");
-        return 0;
-    }
-    
-    // Translate Windows paths to Linux paths
-    char existing_linux[LSW_MAX_PATH];
-    char new_linux[LSW_MAX_PATH];
-    
-    if (lsw_fs_win_to_linux(existing_mb, existing_linux, sizeof(existing_linux)) != LSW_SUCCESS) {
-        LSW_LOG_ERROR("CopyFileW: path translation failed for source");
-        return 0;
-    }
-    
-    if (lsw_fs_win_to_linux(new_mb, new_linux, sizeof(new_linux)) != LSW_SUCCESS) {
-        LSW_LOG_ERROR("CopyFileW: path translation failed for dest");
+        lsw_SetLastError(87); // ERROR_INVALID_PARAMETER
         return 0;
     }
-    
-    LSW_LOG_INFO("CopyFileW: %s -> %s (fail_if_exists=%d)", existing_linux, new_linux, fail_if_exists);
-    
-    // Check if destination exists and fail_if_exists is set
-    if (fail_if_exists) {
-        struct stat st;
-        if (stat(new_linux, &st) == 0) {
-            LSW_LOG_WARN("CopyFileW: destination exists and fail_if_exists=TRUE");
-            return 0;
-        }
-    }
-    
-    // Open source file
-    int src_fd = open(existing_linux, O_RDONLY);
-    if (src_fd < 0) {
-        LSW_LOG_ERROR("CopyFileW: failed to open source: %s", strerror(errno));
+    uint32_t err = lsw_copy_file_ex(existing_file, new_file, progress,
+                                    data, cancel, flags);
+    if (err) {
+        lsw_SetLastError(err);
         return 0;
     }
-    
-    // Get source file permissions
-    struct stat src_stat;
-    if (fstat(src_fd, &src_stat) != 0) {
-        LSW_LOG_ERROR("CopyFileW: fstat failed: %s", strerror(errno));
-        close(src_fd);
+    return 1;
+}
+
+int __attribute__((ms_abi)) lsw_CopyFileExW(const wchar_t* existing_file, const wchar_t* new_file,
+                                            LSW_PROGRESS_ROUTINE progress, void* data, int* cancel, uint32_t flags) {
+    char existing_mb[LSW_MAX_PATH], new_mb[LSW_MAX_PATH];
+    if (!lsw_copy_path_a(existing_file, existing_mb, sizeof(existing_mb)) ||
+        !lsw_copy_path_a(new_file, new_mb, sizeof(new_mb))) {
+        lsw_SetLastError(87); // ERROR_INVALID_PARAMETER
         return 0;
     }
-    
-    // Open/create destination file
-    int dst_fd = open(new_linux, O_WRONLY | O_CREAT | O_TRUNC, src_stat.st_mode);
-    if (dst_fd < 0) {
-        LSW_LOG_ERROR("CopyFileW: failed to create destination: %s", strerror(errno));
-        close(src_fd);
+    return lsw_CopyFileExA(existing_mb, new_mb, progress, data, cancel, flags);
+}
+
+int __attribute__((ms_abi)) lsw_CopyFileW(const wchar_t* existing_file, const wchar_t* new_file, int fail_if_exists) {
+    return lsw_CopyFileExW(existing_file, new_file, NULL, NULL, NULL,
+                           fail_if_exists ? LSW_COPY_FILE_FAIL_IF_EXISTS : 0);
+}
+
+int __attribute__((ms_abi)) lsw_MoveFileWithProgressA(const char* existing_file, const char* new_file,
+                                                      LSW_PROGRESS_ROUTINE progress, void* data, uint32_t flags) {
+    uint32_t err = lsw_move_file_ex(existing_file, new_file, progress, data, flags);
+    if (err) {
+        lsw_SetLastError(err);
         return 0;
     }
-    
-    // Copy file contents
-    char buffer[8192];
-    ssize_t bytes_read;
-    int success = 1;
-    
-    while ((bytes_read = read(src_fd, buffer, sizeof(buffer))) > 0) {
-        ssize_t bytes_written = write(dst_fd, buffer, bytes_read);
-        if (bytes_written != bytes_read) {
-            LSW_LOG_ERROR("CopyFileW: write failed: %s", strerror(errno));
-            success = 0;
-            break;
-        }
-    }
-    
-    if (bytes_read < 0) {
-        LSW_LOG_ERROR("CopyFileW: read failed: %s", strerror(errno));
-        success = 0;
-    }
-    
-    close(src_fd);
-    close(dst_fd);
-    
-    if (!success) {
-        // Clean up failed copy
-        unlink(new_linux);
+    return 1;
+}
+
+int __attribute__((ms_abi)) lsw_MoveFileWithProgressW(const wchar_t* existing_file, const wchar_t* new_file,
+                                                      LSW_PROGRESS_ROUTINE progress, void* data, uint32_t flags) {
+    char existing_mb[LSW_MAX_PATH], new_mb[LSW_MAX_PATH];
+    if (!lsw_copy_path_a(existing_file, existing_mb, sizeof(existing_mb)) ||
+        (new_file && !lsw_copy_path_a(new_file, new_mb, sizeof(new_mb)))) {
+        lsw_SetLastError(87); // ERROR_INVALID_PARAMETER
         return 0;
     }
-    
-    LSW_LOG_INFO("CopyFileW: successfully copied file");
-    return 1; // TRUE
+    return lsw_MoveFileWithProgressA(existing_mb, new_file ? new_mb : NULL, progress, data, flags);
+}
+
+int __attribute__((ms_abi)) lsw_MoveFileExA(const char* existing_file, const char* new_file, uint32_t flags) {
+    return lsw_MoveFileWithProgressA(existing_file, new_file, NULL, NULL, flags);
+}
+
+int __attribute__((ms_abi)) lsw_MoveFileExW(const wchar_t* existing_file, const wchar_t* new_file, uint32_t flags) {
+    return lsw_MoveFileWithProgressW(existing_file, new_file, NULL, NULL, flags);
 }
 
 // Directory operations
@@ -3610,7 +3930,7 @@ int __attribute__((ms_abi)) lsw_CreateDirectoryW(const wchar_t* pathname, void*
     LSW_LOG_INFO("CreateDirectoryW: %s -> %s", pathname_mb, linux_path);
     
     // Create directory with standard permissions
-    if (mkdir(linux_path, 0755) != 0) {
+    if (lsw_overlay_mkdir(linux_path, 0755) != 0) {
         if (errno == EEXIST) {
             LSW_LOG_WARN("CreateDirectoryW: directory already exists: %s", linux_path);
             // Windows returns FALSE if directory exists
@@ -3620,6 +3940,7 @@ int __attribute__((ms_abi)) lsw_CreateDirectoryW(const wchar_t* pathname, void*
         return 0;
     }
     
+    lsw_fs_invalidate(linux_path);
     LSW_LOG_INFO("CreateDirectoryW: successfully created directory");
     return 1; // TRUE
 }
@@ -3650,11 +3971,12 @@ int __attribute__((ms_abi)) lsw_RemoveDirectoryW(const wchar_t* pathname) {
     LSW_LOG_INFO("RemoveDirectoryW: %s -> %s", pathname_mb, linux_path);
     
     // Remove directory (must be empty)
-    if (rmdir(linux_path) != 0) {
+    if (lsw_overlay_rmdir(linux_path) != 0) {
         LSW_LOG_ERROR("RemoveDirectoryW: rmdir failed: %s", strerror(errno));
         return 0;
     }
     
+    lsw_fs_invalidate(linux_path);
     LSW_LOG_INFO("RemoveDirectoryW: successfully removed directory");
     return 1; // TRUE
 }
@@ -3850,9 +4172,12 @@ DWORD __attribute__((ms_abi)) lsw_GetTempPathA(DWORD size, char* buffer) {
     LSW_LOG_INFO("GetTempPathA called: size=%u, buffer=%p", size, buffer);
     
     // Check TEMP/TMP environment variables, fallback to C:\Temp
-    const char* temp_path = getenv("TEMP");
-    if (!temp_path) temp_path = getenv("TMP");
-    if (!temp_path) temp_path = "C:\\Temp";
+    // (Windows form: a Linux /tmp comes back translated)
+    char temp_buf[LSW_MAX_PATH];
+    const char* temp_path = temp_buf;
+    DWORD got = win32_env_get("TEMP", temp_buf, sizeof(temp_buf));
+    if (got == 0 || got >= sizeof(temp_buf)) got = win32_env_get("TMP", temp_buf, sizeof(temp_buf));
+    if (got == 0 || got >= sizeof(temp_buf)) temp_path = "C:\\Temp";
     
     size_t len = strlen(temp_path);
     
@@ -3932,8 +4257,9 @@ uint32_t __attribute__((ms_abi)) lsw_GetTempFileNameA(const char* lpPathName, co
     // Create the file so the name is reserved
     char linux_path[LSW_MAX_PATH];
     lsw_fs_win_to_linux(lpTempFileName, linux_path, sizeof(linux_path));
-    int fd = open(linux_path, O_CREAT | O_EXCL | O_WRONLY, 0600);
-    if (fd >= 0) close(fd);
+    int fd = lsw_overlay_copy_up(linux_path, sizeof(linux_path), true) == 0
+           ? open(linux_path, O_CREAT | O_EXCL | O_WRONLY, 0600) : -1;
+    if (fd >= 0) { close(fd); lsw_fs_invalidate(linux_path); }
     LSW_LOG_INFO("GetTempFileNameA: '%s' (unique=%u)", lpTempFileName, uUnique);
     return uUnique;
 }
@@ -3958,9 +4284,7 @@ int __attribute__((ms_abi)) lsw_GetDiskFreeSpaceA(const char* lpRootPathName,
 }
 
 // KERNEL32.dll!GetEnvironmentVariableA - Get environment variable
-/* Forward declarations for path-translation helpers defined later in the file */
-static size_t lsw_linux_to_windows_path(const char* lpath, char* wpath, size_t wsize);
-static size_t lsw_windows_to_linux_path(const char* wpath, char* lpath, size_t lsize);
+static const char k_default_pathext[] = ".COM;.EXE;.BAT;.CMD;.VBS;.VBE;.JS;.JSE;.WSF;.WSH;.MSC";
 
 DWORD __attribute__((ms_abi)) lsw_GetEnvironmentVariableA(const char* name, char* buffer, DWORD size) {
     LSW_LOG_INFO("GetEnvironmentVariableA called: name='%s', size=%u", name ? name : "(null)", size);
@@ -3969,72 +4293,20 @@ DWORD __attribute__((ms_abi)) lsw_GetEnvironmentVariableA(const char* name, char
         return 0;
     }
     
-    /* Provide default PATHEXT if not set */
-    if (strcmp(name, "PATHEXT") == 0) {
-        const char* pathext = getenv("PATHEXT");
-        const char* value = pathext ? pathext : ".COM;.EXE;.BAT;.CMD;.VBS;.VBE;.JS;.JSE;.WSF;.WSH;.MSC";
-        size_t len = strlen(value);
-        if (!buffer || size == 0) return (DWORD)(len + 1);
-        if (size <= len) return (DWORD)(len + 1);
-        strcpy(buffer, value);
-        return (DWORD)len;
-    }
-    
-    /* Translate PATH from Linux to Windows format */
-    if (strcmp(name, "PATH") == 0) {
-        const char* linux_path = getenv("PATH");
-        if (!linux_path) return 0;
-        /* Translate: split by ':', convert each component, rejoin with ';' */
-        static char win_path[65536];
-        size_t wpos = 0;
-        const char* p = linux_path;
-        int first = 1;
-        while (*p) {
-            const char* colon = strchr(p, ':');
-            size_t seg_len = colon ? (size_t)(colon - p) : strlen(p);
-            char seg[LSW_MAX_PATH];
-            if (seg_len >= sizeof(seg)) seg_len = sizeof(seg) - 1;
-            memcpy(seg, p, seg_len); seg[seg_len] = '\0';
-            char wseg[LSW_MAX_PATH];
-            lsw_linux_to_windows_path(seg, wseg, sizeof(wseg));
-            size_t wlen = strlen(wseg);
-            if (!first && wpos + 1 < sizeof(win_path) - 1) win_path[wpos++] = ';';
-            if (wpos + wlen < sizeof(win_path) - 1) {
-                memcpy(win_path + wpos, wseg, wlen);
-                wpos += wlen;
-            }
-            first = 0;
-            if (!colon) break;
-            p = colon + 1;
-        }
-        win_path[wpos] = '\0';
-        size_t len = wpos;
-        if (!buffer || size == 0) return (DWORD)(len + 1);
-        if (size <= len) return (DWORD)(len + 1);
-        strcpy(buffer, win_path);
-        LSW_LOG_INFO("GetEnvironmentVariableA: PATH (windows) = '%s'", win_path);
-        return (DWORD)len;
+    /* The store translates PATH and friends once per change */
+    DWORD len = win32_env_get(name, buffer, buffer ? size : 0);
+    if (len == 0 && strcasecmp(name, "PATHEXT") == 0) {
+        /* Provide default PATHEXT if not set */
+        size_t n = sizeof(k_default_pathext) - 1;
+        if (!buffer || size <= n) return (DWORD)(n + 1);
+        memcpy(buffer, k_default_pathext, n + 1);
+        return (DWORD)n;
     }
-    
-    const char* value = getenv(name);
-    if (!value) {
+    if (len == 0) {
         LSW_LOG_INFO("GetEnvironmentVariableA: variable '%s' not found", name);
-        return 0; // Variable not found
-    }
-    
-    size_t len = strlen(value);
-    
-    if (!buffer || size == 0) {
-        return (DWORD)(len + 1);
-    }
-    
-    if (size <= len) {
-        return (DWORD)(len + 1);
+        lsw_SetLastError(203); // ERROR_ENVVAR_NOT_FOUND
     }
-    
-    strcpy(buffer, value);
-    LSW_LOG_INFO("GetEnvironmentVariableA: '%s' = '%s'", name, value);
-    return (DWORD)len;
+    return len;
 }
 
 // KERNEL32.dll!GetEnvironmentVariableW - Get environment variable (wide-char)
@@ -4045,39 +4317,21 @@ DWORD __attribute__((ms_abi)) lsw_GetEnvironmentVariableW(const wchar_t* name, w
         return 0;
     }
     
-    // Convert name to multi-byte
-    char name_mb[LSW_MAX_PATH];
-    int result = lsw_WideCharToMultiByte(CP_UTF8, 0, name, -1, name_mb, sizeof(name_mb), NULL, NULL);
-    if (result == 0) {
-        LSW_LOG_ERROR("GetEnvironmentVariableW: name conversion failed");
-        return 0;
-    }
-    
-    // Get ANSI value
-    char value_ansi[LSW_MAX_PATH];
-    DWORD ansi_len = lsw_GetEnvironmentVariableA(name_mb, value_ansi, sizeof(value_ansi));
-    
-    if (ansi_len == 0) {
-        return 0; // Not found
-    }
-    
-    // Convert to wide-char
-    int wide_len = lsw_MultiByteToWideChar(CP_UTF8, 0, value_ansi, -1, NULL, 0);
-    if (wide_len == 0) {
-        return 0;
-    }
-    
-    if (!buffer || size == 0) {
-        return (DWORD)wide_len;
-    }
-    
-    if (size < (DWORD)wide_len) {
-        return (DWORD)wide_len;
+    /* Windows wchar_t is UTF-16 (2 bytes); Linux wchar_t is 4 bytes — treat as uint16_t* */
+    const uint16_t* wname = (const uint16_t*)name;
+    uint16_t* wbuf = (uint16_t*)buffer;
+    DWORD len = win32_env_get_w(wname, -1, wbuf, wbuf ? size : 0);
+    if (len == 0) {
+        static const uint16_t pathext[] = { 'P','A','T','H','E','X','T' };
+        if (win32_u16_icmp(wname, win32_u16_len(wname), pathext, 7) == 0) {
+            size_t n = sizeof(k_default_pathext) - 1;
+            if (!wbuf || size <= n) return (DWORD)(n + 1);
+            for (size_t i = 0; i <= n; i++) wbuf[i] = (uint8_t)k_default_pathext[i];
+            return (DWORD)n;
+        }
+        lsw_SetLastError(203); // ERROR_ENVVAR_NOT_FOUND
     }
-    
-    lsw_MultiByteToWideChar(CP_UTF8, 0, value_ansi, -1, buffer, size);
-    LSW_LOG_INFO("GetEnvironmentVariableW: successfully converted");
-    return (DWORD)(wide_len - 1);
+    return len;
 }
 
 // KERNEL32.dll!SetEnvironmentVariableA - Set environment variable
@@ -4089,22 +4343,15 @@ int __attribute__((ms_abi)) lsw_SetEnvironmentVariableA(const char* name, const
         return 0; // FALSE
     }
     
-    int result;
-    if (value) {
-        // Set the variable
-        result = setenv(name, value, 1); // 1 = overwrite
-    } else {
-        // Delete the variable
-        result = unsetenv(name);
-    }
-    
-    if (result == 0) {
+    // NULL value deletes; the Linux form is exported for child processes
+    int err = win32_env_set(name, value, 1);
+    if (err == 0) {
         LSW_LOG_INFO("SetEnvironmentVariableA: success");
         return 1; // TRUE
-    } else {
-        LSW_LOG_ERROR("SetEnvironmentVariableA: failed: %s", strerror(errno));
-        return 0; // FALSE
     }
+    LSW_LOG_ERROR("SetEnvironmentVariableA: failed: %s", strerror(err));
+    lsw_SetLastError(err == ENOMEM ? 8 : 87); // ERROR_NOT_ENOUGH_MEMORY / ERROR_INVALID_PARAMETER
+    return 0; // FALSE
 }
 
 // KERNEL32.dll!SetEnvironmentVariableW - Set environment variable (wide-char)
@@ -4115,26 +4362,13 @@ int __attribute__((ms_abi)) lsw_SetEnvironmentVariableW(const wchar_t* name, con
         return 0;
     }
     
-    // Convert name to multi-byte
-    char name_mb[LSW_MAX_PATH];
-    int result = lsw_WideCharToMultiByte(CP_UTF8, 0, name, -1, name_mb, sizeof(name_mb), NULL, NULL);
-    if (result == 0) {
-        LSW_LOG_ERROR("SetEnvironmentVariableW: name conversion failed");
-        return 0;
-    }
-    
-    char* value_mb = NULL;
-    char value_buf[LSW_MAX_PATH];
-    if (value) {
-        result = lsw_WideCharToMultiByte(CP_UTF8, 0, value, -1, value_buf, sizeof(value_buf), NULL, NULL);
-        if (result == 0) {
-            LSW_LOG_ERROR("SetEnvironmentVariableW: value conversion failed");
-            return 0;
-        }
-        value_mb = value_buf;
+    int err = win32_env_set_w((const uint16_t*)name, (const uint16_t*)value);
+    if (err == 0) {
+        return 1;
     }
-    
-    return lsw_SetEnvironmentVariableA(name_mb, value_mb);
+    LSW_LOG_ERROR("SetEnvironmentVariableW: failed: %s", strerror(err));
+    lsw_SetLastError(err == ENOMEM ? 8 : 87); // ERROR_NOT_ENOUGH_MEMORY / ERROR_INVALID_PARAMETER
+    return 0;
 }
 
 // KERNEL32.dll!ExpandEnvironmentStringsA - Expand environment variable references
@@ -4162,17 +4396,13 @@ DWORD __attribute__((ms_abi)) lsw_ExpandEnvironmentStringsA(const char* src, cha
                     strncpy(var_name, p + 1, var_len);
                     var_name[var_len] = '\0';
                     
-                    // Get variable value
-                    const char* var_value = getenv(var_name);
-                    if (var_value) {
-                        // Copy value
-                        size_t value_len = strlen(var_value);
-                        if (dst_pos + value_len < sizeof(temp)) {
-                            strcpy(temp + dst_pos, var_value);
-                            dst_pos += value_len;
-                            p = end + 1;
-                            continue;
-                        }
+                    // Copy the value straight from the environment store
+                    DWORD room = (DWORD)(sizeof(temp) - dst_pos);
+                    DWORD value_len = win32_env_get(var_name, temp + dst_pos, room);
+                    if (value_len < room && (value_len > 0 || win32_env_peek(var_name))) {
+                        dst_pos += value_len;
+                        p = end + 1;
+                        continue;
                     }
                 }
             }
@@ -4278,117 +4508,44 @@ int __attribute__((ms_abi)) lsw_ChooseColorW(void* lpcc) {
 
 // Internal structure for directory search handle
 typedef struct {
-    DIR* dir;
-    char pattern[LSW_MAX_PATH];
-    char dir_path[LSW_MAX_PATH];
-    struct dirent* current_entry;
-    int first_call;
+    win32_dirscan_t* scan;
 } lsw_find_data_t;
 
-// Helper: convert UTF-8 string to UTF-16LE into a uint16_t buffer.
-// Handles BMP characters (U+0000..U+FFFF) including basic multi-byte UTF-8.
-// Returns the number of uint16_t code units written (excluding null terminator).
-static int utf8_to_utf16le(const char* src, uint16_t* dst, int dst_capacity) {
-    int out = 0;
-    unsigned char* s = (unsigned char*)src;
-    while (*s && out < dst_capacity - 1) {
-        uint32_t cp;
-        if (*s < 0x80) {
-            cp = *s++;
-        } else if ((*s & 0xE0) == 0xC0) {
-            cp = (*s++ & 0x1F) << 6;
-            cp |= (*s++ & 0x3F);
-        } else if ((*s & 0xF0) == 0xE0) {
-            cp = (*s++ & 0x0F) << 12;
-            cp |= (*s++ & 0x3F) << 6;
-            cp |= (*s++ & 0x3F);
-        } else {
-            // Skip 4-byte (surrogate pair needed) — emit replacement char
-            s += 4;
-            cp = 0xFFFD;
-        }
-        dst[out++] = (uint16_t)cp;
-    }
-    dst[out] = 0;
-    return out;
-}
+#define FIND_FIRST_EX_CASE_SENSITIVE    0x1
+#define FIND_FIRST_EX_LARGE_FETCH       0x2
+#define FindExSearchLimitToDirectories  1
 
-// Helper: Convert Linux dirent to WIN32_FIND_DATAW
-static void dirent_to_find_data(struct dirent* entry, const char* dir_path, WIN32_FIND_DATAW* find_data) {
+// Helper: Convert an enumeration entry to WIN32_FIND_DATAW
+static void find_data_from_entry(const win32_dirent_t* e, WIN32_FIND_DATAW* find_data) {
     memset(find_data, 0, sizeof(WIN32_FIND_DATAW));
-    
-    // Convert filename to UTF-16LE (uint16_t, matching Windows WCHAR)
-    utf8_to_utf16le(entry->d_name, find_data->cFileName,
-                    (int)(sizeof(find_data->cFileName) / sizeof(find_data->cFileName[0])));
-    
-    // Get file stats
-    char full_path[LSW_MAX_PATH];
-    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-    
-    struct stat st;
-    if (stat(full_path, &st) == 0) {
-        // Set attributes
-        find_data->dwFileAttributes = 0;
-        if (S_ISDIR(st.st_mode)) {
-            find_data->dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY;
-        }
-        if (entry->d_name[0] == '.') {
-            find_data->dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
-        }
-        if (!(st.st_mode & S_IWUSR)) {
-            find_data->dwFileAttributes |= FILE_ATTRIBUTE_READONLY;
-        }
-        if (find_data->dwFileAttributes == 0) {
-            find_data->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
-        }
-        
-        // Set file size
-        find_data->nFileSizeLow = (uint32_t)(st.st_size & 0xFFFFFFFF);
-        find_data->nFileSizeHigh = (uint32_t)(st.st_size >> 32);
-        
-        // TODO: Convert timestamps properly
-    } else {
-        find_data->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
-    }
-}
-
-// Helper: Simple wildcard matching (* and ? supported)
-static int match_pattern(const char* str, const char* pattern) {
-    if (*pattern == '\0') return (*str == '\0');
-    if (*pattern == '*') {
-        if (match_pattern(str, pattern + 1)) return 1;
-        if (*str && match_pattern(str + 1, pattern)) return 1;
-        return 0;
-    }
-    if (*pattern == '?' || *pattern == *str) {
-        return match_pattern(str + 1, pattern + 1);
-    }
-    return 0;
-}
-
-// KERNEL32.dll!FindFirstFileW - Start file search
-void* __attribute__((ms_abi)) lsw_FindFirstFileW(const wchar_t* filename, WIN32_FIND_DATAW* find_data) {
-    LSW_LOG_DEBUG("FindFirstFileW called");
-    
-    if (!filename || !find_data) {
-        LSW_LOG_ERROR("FindFirstFileW: null parameters");
-        return (void*)-1; // INVALID_HANDLE_VALUE
-    }
-    
+    find_data->dwFileAttributes     = e->attributes;
+    find_data->ftCreationTimeLow    = (uint32_t)e->creation_time;
+    find_data->ftCreationTimeHigh   = (uint32_t)((uint64_t)e->creation_time >> 32);
+    find_data->ftLastAccessTimeLow  = (uint32_t)e->access_time;
+    find_data->ftLastAccessTimeHigh = (uint32_t)((uint64_t)e->access_time >> 32);
+    find_data->ftLastWriteTimeLow   = (uint32_t)e->write_time;
+    find_data->ftLastWriteTimeHigh  = (uint32_t)((uint64_t)e->write_time >> 32);
+    find_data->nFileSizeLow         = (uint32_t)e->size;
+    find_data->nFileSizeHigh        = (uint32_t)((uint64_t)e->size >> 32);
+
+    size_t n = e->wname_len;
+    size_t max = sizeof(find_data->cFileName) / sizeof(find_data->cFileName[0]) - 1;
+    if (n > max) n = max;
+    memcpy(find_data->cFileName, e->wname, n * sizeof(uint16_t));
+}
+
+// Shared by FindFirstFileW and FindFirstFileExW
+static void* find_first_file(const wchar_t* filename, WIN32_FIND_DATAW* find_data, int scan_flags) {
     // Convert filename to multi-byte
     char filename_mb[LSW_MAX_PATH];
     int result = lsw_WideCharToMultiByte(CP_UTF8, 0, filename, -1, filename_mb, sizeof(filename_mb), NULL, NULL);
     if (result == 0) {
         LSW_LOG_ERROR("FindFirstFileW: filename conversion failed");
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
         return (void*)-1;
     }
     
-    LSW_LOG_DEBUG("FindFirstFileW: searching for '%s' (len=%d)", filename_mb, result);
-    
-    // Debug: show first few bytes as hex
-    LSW_LOG_DEBUG("FindFirstFileW: hex dump: %02x %02x %02x %02x", 
-                 (unsigned char)filename_mb[0], (unsigned char)filename_mb[1], 
-                 (unsigned char)filename_mb[2], (unsigned char)filename_mb[3]);
+    LSW_LOG_DEBUG("FindFirstFileW: searching for '%s'", filename_mb);
     
     // Translate Windows path to Linux
     char linux_path[LSW_MAX_PATH];
@@ -4397,61 +4554,68 @@ void* __attribute__((ms_abi)) lsw_FindFirstFileW(const wchar_t* filename, WIN32_
     if (!lsw_dotnet_translate_win_path(filename_mb, linux_path, sizeof(linux_path))) {
         if (lsw_fs_win_to_linux(filename_mb, linux_path, sizeof(linux_path)) != LSW_SUCCESS) {
             LSW_LOG_ERROR("FindFirstFileW: path translation failed");
+            lsw_SetLastError(3); /* ERROR_PATH_NOT_FOUND */
             return (void*)-1;
         }
     }
     
     // Extract directory and pattern
     char dir_path[LSW_MAX_PATH];
-    char pattern[LSW_MAX_PATH];
+    const char* pattern;
     char* last_slash = strrchr(linux_path, '/');
     
     if (last_slash) {
         size_t dir_len = last_slash - linux_path;
-        strncpy(dir_path, linux_path, dir_len);
+        if (dir_len == 0) dir_len = 1;  /* "/name" searches the root */
+        memcpy(dir_path, linux_path, dir_len);
         dir_path[dir_len] = '\0';
-        strcpy(pattern, last_slash + 1);
+        pattern = last_slash + 1;
     } else {
         strcpy(dir_path, ".");
-        strcpy(pattern, linux_path);
+        pattern = linux_path;
     }
     
     LSW_LOG_DEBUG("FindFirstFileW: dir='%s', pattern='%s'", dir_path, pattern);
     
-    // Open directory
-    DIR* dir = opendir(dir_path);
-    if (!dir) {
-        LSW_LOG_ERROR("FindFirstFileW: opendir failed: %s", strerror(errno));
+    win32_dirscan_t* scan = win32_dirscan_open(dir_path, pattern, scan_flags);
+    if (!scan) {
+        LSW_LOG_DEBUG("FindFirstFileW: cannot open '%s': %s", dir_path, strerror(errno));
+        lsw_SetLastError(errno == EACCES ? 5 /* ERROR_ACCESS_DENIED */ : 3 /* ERROR_PATH_NOT_FOUND */);
+        return (void*)-1;
+    }
+    
+    const win32_dirent_t* e = win32_dirscan_next(scan);
+    if (!e) {
+        LSW_LOG_DEBUG("FindFirstFileW: no matches found");
+        win32_dirscan_close(scan);
+        lsw_SetLastError(2); /* ERROR_FILE_NOT_FOUND */
         return (void*)-1;
     }
     
-    // Allocate find handle
     lsw_find_data_t* find_handle = malloc(sizeof(lsw_find_data_t));
     if (!find_handle) {
-        closedir(dir);
+        win32_dirscan_close(scan);
+        lsw_SetLastError(8); /* ERROR_NOT_ENOUGH_MEMORY */
         return (void*)-1;
     }
+    find_handle->scan = scan;
     
-    find_handle->dir = dir;
-    strcpy(find_handle->pattern, pattern);
-    strcpy(find_handle->dir_path, dir_path);
-    find_handle->first_call = 1;
+    find_data_from_entry(e, find_data);
+    LSW_LOG_DEBUG("FindFirstFileW: found '%s'", e->name);
+    return (void*)find_handle;
+}
+
+// KERNEL32.dll!FindFirstFileW - Start file search
+void* __attribute__((ms_abi)) lsw_FindFirstFileW(const wchar_t* filename, WIN32_FIND_DATAW* find_data) {
+    LSW_LOG_DEBUG("FindFirstFileW called");
     
-    // Find first matching entry
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (match_pattern(entry->d_name, pattern)) {
-            dirent_to_find_data(entry, dir_path, find_data);
-            LSW_LOG_DEBUG("FindFirstFileW: found '%s'", entry->d_name);
-            return (void*)find_handle;
-        }
+    if (!filename || !find_data) {
+        LSW_LOG_ERROR("FindFirstFileW: null parameters");
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return (void*)-1; // INVALID_HANDLE_VALUE
     }
     
-    // No match found
-    LSW_LOG_DEBUG("FindFirstFileW: no matches found");
-    closedir(dir);
-    free(find_handle);
-    return (void*)-1;
+    return find_first_file(filename, find_data, 0);
 }
 
 // KERNEL32.dll!FindNextFileW - Get next file in search
@@ -4460,28 +4624,27 @@ int __attribute__((ms_abi)) lsw_FindNextFileW(void* find_handle, WIN32_FIND_DATA
     
     if (!find_handle || find_handle == (void*)-1 || !find_data) {
         LSW_LOG_ERROR("FindNextFileW: invalid parameters");
+        lsw_SetLastError(6); /* ERROR_INVALID_HANDLE */
         return 0; // FALSE
     }
     
     lsw_find_data_t* handle = (lsw_find_data_t*)find_handle;
     
-    // Continue searching
-    struct dirent* entry;
-    while ((entry = readdir(handle->dir)) != NULL) {
-        if (match_pattern(entry->d_name, handle->pattern)) {
-            dirent_to_find_data(entry, handle->dir_path, find_data);
-            LSW_LOG_DEBUG("FindNextFileW: found '%s'", entry->d_name);
-            return 1; // TRUE
-        }
+    const win32_dirent_t* e = win32_dirscan_next(handle->scan);
+    if (!e) {
+        LSW_LOG_DEBUG("FindNextFileW: no more files");
+        lsw_SetLastError(18); /* ERROR_NO_MORE_FILES */
+        return 0; // FALSE - no more files
     }
     
-    LSW_LOG_DEBUG("FindNextFileW: no more files");
-    return 0; // FALSE - no more files
+    find_data_from_entry(e, find_data);
+    LSW_LOG_DEBUG("FindNextFileW: found '%s'", e->name);
+    return 1; // TRUE
 }
 
 // KERNEL32.dll!FindClose - Close search handle
 int __attribute__((ms_abi)) lsw_FindClose(void* find_handle) {
-    LSW_LOG_INFO("FindClose called: handle=%p", find_handle);
+    LSW_LOG_DEBUG("FindClose called: handle=%p", find_handle);
     
     if (!find_handle || find_handle == (void*)-1) {
         LSW_LOG_ERROR("FindClose: invalid handle");
@@ -4489,13 +4652,8 @@ int __attribute__((ms_abi)) lsw_FindClose(void* find_handle) {
     }
     
     lsw_find_data_t* handle = (lsw_find_data_t*)find_handle;
-    
-    if (handle->dir) {
-        closedir(handle->dir);
-    }
-    
+    win32_dirscan_close(handle->scan);
     free(handle);
-    LSW_LOG_INFO("FindClose: handle closed successfully");
     return 1; // TRUE
 }
 
@@ -4508,15 +4666,24 @@ void* __attribute__((ms_abi)) lsw_FindFirstFileExW(
     void* search_filter,
     uint32_t flags)
 {
-    (void)info_level;
-    (void)search_op;
     (void)search_filter;
-    (void)flags;
+    /* No 8.3 names are generated, so FindExInfoBasic and
+     * FindExInfoStandard produce the same data */
+    (void)info_level;
+    
+    LSW_LOG_DEBUG("FindFirstFileExW called (level=%d op=%d flags=0x%x)", info_level, search_op, flags);
+    
+    if (!filename || !find_data) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return (void*)-1;
+    }
     
-    LSW_LOG_DEBUG("FindFirstFileExW called (using standard FindFirstFileW)");
+    int scan_flags = 0;
+    if (flags & FIND_FIRST_EX_LARGE_FETCH) scan_flags |= WIN32_DIRSCAN_LARGE_FETCH;
+    if (flags & FIND_FIRST_EX_CASE_SENSITIVE) scan_flags |= WIN32_DIRSCAN_CASE_SENSITIVE;
+    if (search_op == FindExSearchLimitToDirectories) scan_flags |= WIN32_DIRSCAN_DIRS_ONLY;
     
-    // For now, just delegate to FindFirstFileW
-    return lsw_FindFirstFileW(filename, (WIN32_FIND_DATAW*)find_data);
+    return find_first_file(filename, (WIN32_FIND_DATAW*)find_data, scan_flags);
 }
 
 // ============================================================================
@@ -4739,16 +4906,20 @@ void* __attribute__((ms_abi)) lsw_CreateThread(
     th->suspended = (creation_flags & 0x4) ? 1 : 0;
     pthread_mutex_init(&th->suspend_lock, NULL);
     pthread_cond_init(&th->suspend_cond, NULL);
+    th->apc = lsw_apc_queue_new(2); /* one ref for the thread, one for the handle */
 
     lsw_thread_trampoline_t* tram = (lsw_thread_trampoline_t*)malloc(sizeof(lsw_thread_trampoline_t));
     if (!tram) {
         LSW_LOG_ERROR("CreateThread: malloc for trampoline failed");
+        lsw_apc_queue_put(th->apc);
+        lsw_apc_queue_put(th->apc);
         free(th);
         return NULL;
     }
     tram->start_fn = (uint32_t (__attribute__((ms_abi)) *)(void*))start_address;
     tram->param    = parameter;
     tram->handle   = th;
+    tram->apc      = th->apc;
 
     /* CREATE_SUSPENDED (0x4): thread waits in trampoline until ResumeThread() */
     if (creation_flags & 0x4)
@@ -4758,6 +4929,8 @@ void* __attribute__((ms_abi)) lsw_CreateThread(
     if (ret != 0) {
         LSW_LOG_ERROR("pthread_create failed: %s", strerror(ret));
         free(tram);
+        lsw_apc_queue_put(th->apc);
+        lsw_apc_queue_put(th->apc);
         free(th);
         return NULL;
     }
@@ -4794,34 +4967,76 @@ void __attribute__((ms_abi)) lsw_ExitThread(uint32_t exit_code)
     pthread_exit((void*)(uintptr_t)exit_code);
 }
 
-uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t milliseconds)
+/* Absolute CLOCK_REALTIME deadline `ms` from now (for *_timedwait) */
+static void lsw_deadline_ms(struct timespec* ts, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec  += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) { ts->tv_sec++; ts->tv_nsec -= 1000000000L; }
+}
+
+/* Exit statuses of reaped children. Process handles are PIDs, so once a
+ * wait has collected a child, later waits and GetExitCodeProcess find
+ * its status here. */
+#define LSW_REAPED_SLOTS 64
+static struct { pid_t pid; int status; } g_reaped[LSW_REAPED_SLOTS];
+static unsigned        g_reaped_next;
+static pthread_mutex_t g_reaped_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* 1 when process `pid` has exited (*status: wait status, -1 if unknown),
+ * 0 while it runs. `block` waits for a child of ours to exit. */
+static int lsw_child_exited(pid_t pid, int block, int* status) {
+    siginfo_t si;
+    if (block) {
+        /* Wait without reaping so that concurrent waiters all see it */
+        while (waitid(P_PID, (id_t)pid, &si, WEXITED | WNOWAIT) < 0 && errno == EINTR) { }
+    }
+
+    int st = 0, exited = 0;
+    pthread_mutex_lock(&g_reaped_lock);
+    pid_t r = waitpid(pid, &st, WNOHANG);
+    if (r == pid) {
+        unsigned slot = g_reaped_next++ % LSW_REAPED_SLOTS;
+        g_reaped[slot].pid = pid;
+        g_reaped[slot].status = st;
+        exited = 1;
+    } else if (r < 0 && errno == ECHILD) {
+        st = -1;
+        for (unsigned i = 0; i < LSW_REAPED_SLOTS; i++)
+            if (g_reaped[i].pid == pid) { st = g_reaped[i].status; exited = 1; break; }
+        if (!exited) exited = kill(pid, 0) != 0 && errno == ESRCH;
+    }
+    pthread_mutex_unlock(&g_reaped_lock);
+    if (exited) *status = st;
+    return exited;
+}
+
+static uint32_t lsw_wait_any(uint32_t n, void** handles, uint32_t ms, lsw_apc_queue_t* q);
+
+/* Core single-object wait.  `q` is the caller's APC queue for alertable
+ * waits (NULL otherwise); an APC arriving mid-wait ends the wait with
+ * WAIT_IO_COMPLETION and the caller drains the queue. */
+static uint32_t lsw_wait_object(void* handle, uint32_t milliseconds, lsw_apc_queue_t* q)
 {
-    LSW_LOG_INFO("WaitForSingleObject: handle=%p ms=0x%x", handle, milliseconds);
     if (!handle || handle == INVALID_HANDLE_VALUE) return 0xFFFFFFFF; /* WAIT_FAILED */
 
     /* ---- Raw process handle (small-integer PID from CreateProcess) ---- */
     if (!IS_TYPED_HANDLE(handle)) {
         pid_t pid = (pid_t)(uintptr_t)handle;
         if (pid > 1) {
-            int wstatus = 0;
-            if (milliseconds == 0xFFFFFFFF) {
-                pid_t r = waitpid(pid, &wstatus, 0);
-                if (r == pid) return 0; /* WAIT_OBJECT_0 */
-            } else if (milliseconds == 0) {
-                pid_t r = waitpid(pid, &wstatus, WNOHANG);
-                if (r == pid) return 0;
-                return 0x00000102; /* WAIT_TIMEOUT */
-            } else {
-                uint32_t waited = 0, step = 5;
-                while (waited < milliseconds) {
-                    pid_t r = waitpid(pid, &wstatus, WNOHANG);
-                    if (r == pid) return 0;
-                    usleep(step * 1000);
-                    waited += step;
-                    if (step < 100) step *= 2;
-                }
-                return 0x00000102;
+            int wstatus;
+            if (lsw_child_exited(pid, milliseconds == 0xFFFFFFFF && !q, &wstatus))
+                return 0; /* WAIT_OBJECT_0 */
+            if (milliseconds == 0) return 0x00000102; /* WAIT_TIMEOUT */
+            /* Alertable, timed, or not our child: poll */
+            uint32_t waited = 0, step = 5;
+            while (milliseconds == 0xFFFFFFFF || waited < milliseconds) {
+                if (lsw_child_exited(pid, 0, &wstatus)) return 0;
+                if (lsw_apc_sleep(q, step)) return WAIT_IO_COMPLETION;
+                waited += step;
+                if (step < 100) step *= 2;
             }
+            return 0x00000102;
         }
         return 0xFFFFFFFF; /* WAIT_FAILED for other small integers */
     }
@@ -4829,8 +5044,13 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
     /* ---- Typed handle dispatch ---- */
     uint32_t magic = *(const uint32_t*)handle;
 
+    /* A child's primary thread ends with the child */
+    if (magic == LSW_CHILD_MAGIC)
+        return lsw_wait_object((void*)(uintptr_t)((lsw_child_thread_t*)handle)->pid, milliseconds, q);
+
     if (magic == LSW_EVENT_MAGIC) {
         lsw_event_t* ev = handle;
+        if (milliseconds != 0) lsw_apc_wait_begin(q, &ev->lock, &ev->cond);
         pthread_mutex_lock(&ev->lock);
         if (milliseconds == 0xFFFFFFFF) {
             /* Cap INFINITE at 5s: if the signaling thread crashed it will never fire.
@@ -4838,10 +5058,15 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
             struct timespec ts;
             clock_gettime(CLOCK_REALTIME, &ts);
             ts.tv_sec += 5;
-            while (!ev->signaled) {
+            while (!ev->signaled && !LSW_APC_PENDING(q)) {
                 if (pthread_cond_timedwait(&ev->cond, &ev->lock, &ts) != 0)
                     break;
             }
+            if (!ev->signaled && LSW_APC_PENDING(q)) {
+                pthread_mutex_unlock(&ev->lock);
+                lsw_apc_wait_end(q);
+                return WAIT_IO_COMPLETION;
+            }
             if (!ev->signaled) {
                 LSW_LOG_WARN("WaitForSingleObject(INFINITE): event %p never signaled after 5s, force-completing", handle);
                 ev->signaled = 1; /* force-signal so the caller moves forward */
@@ -4853,38 +5078,37 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
             }
         } else {
             struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec  += milliseconds / 1000;
-            ts.tv_nsec += (milliseconds % 1000) * 1000000L;
-            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
-            while (!ev->signaled) {
+            lsw_deadline_ms(&ts, milliseconds);
+            while (!ev->signaled && !LSW_APC_PENDING(q)) {
                 if (pthread_cond_timedwait(&ev->cond, &ev->lock, &ts) != 0)
                     break;
             }
             if (!ev->signaled) {
                 pthread_mutex_unlock(&ev->lock);
-                return 0x00000102;
+                lsw_apc_wait_end(q);
+                return LSW_APC_PENDING(q) ? WAIT_IO_COMPLETION : 0x00000102;
             }
         }
         if (!ev->manual_reset) ev->signaled = 0; /* auto-reset */
         pthread_mutex_unlock(&ev->lock);
+        if (milliseconds != 0) lsw_apc_wait_end(q);
         return 0; /* WAIT_OBJECT_0 */
     }
 
     if (magic == LSW_MUTEX_MAGIC) {
         lsw_mutex_t* m = handle;
         int r;
-        if (milliseconds == 0xFFFFFFFF) {
+        if (milliseconds == 0xFFFFFFFF && !q) {
             r = pthread_mutex_lock(&m->mutex);
         } else if (milliseconds == 0) {
             r = pthread_mutex_trylock(&m->mutex);
             if (r != 0) return 0x00000102;
+        } else if (q) {
+            /* pthread_mutex_timedlock can't be woken early by an APC */
+            return lsw_wait_any(1, &handle, milliseconds, q);
         } else {
             struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec  += milliseconds / 1000;
-            ts.tv_nsec += (milliseconds % 1000) * 1000000L;
-            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+            lsw_deadline_ms(&ts, milliseconds);
             r = pthread_mutex_timedlock(&m->mutex, &ts);
             if (r != 0) return 0x00000102;
         }
@@ -4894,16 +5118,16 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
 
     if (magic == LSW_SEMA_MAGIC) {
         lsw_semaphore_t* s = handle;
-        if (milliseconds == 0xFFFFFFFF) {
+        if (milliseconds == 0xFFFFFFFF && !q) {
             return (sem_wait(&s->sem) == 0) ? 0 : 0xFFFFFFFF;
         } else if (milliseconds == 0) {
             return (sem_trywait(&s->sem) == 0) ? 0 : 0x00000102;
+        } else if (q) {
+            /* Same as mutexes: sem_timedwait can't be woken early */
+            return lsw_wait_any(1, &handle, milliseconds, q);
         } else {
             struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec  += milliseconds / 1000;
-            ts.tv_nsec += (milliseconds % 1000) * 1000000L;
-            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+            lsw_deadline_ms(&ts, milliseconds);
             return (sem_timedwait(&s->sem, &ts) == 0) ? 0 : 0x00000102;
         }
     }
@@ -4911,41 +5135,66 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
     if (magic == LSW_TIMER_MAGIC) {
         lsw_timer_t* t = handle;
         if (t->timerfd < 0) return 0xFFFFFFFF;
-        struct pollfd pfd = { .fd = t->timerfd, .events = POLLIN };
-        int r = poll(&pfd, 1, (milliseconds == 0xFFFFFFFF) ? -1 : (int)milliseconds);
-        if (r > 0) {
+        struct pollfd pfd[2] = {
+            { .fd = t->timerfd, .events = POLLIN },
+            { .fd = q ? q->efd : -1, .events = POLLIN },
+        };
+        int r = poll(pfd, 2, (milliseconds == 0xFFFFFFFF) ? -1 : (int)milliseconds);
+        if (r > 0 && (pfd[0].revents & POLLIN)) {
             uint64_t expirations;
             read(t->timerfd, &expirations, sizeof(expirations));
             return 0;
         }
+        if (r > 0 && LSW_APC_PENDING(q)) return WAIT_IO_COMPLETION;
         return (r == 0) ? 0x00000102 : 0xFFFFFFFF;
     }
 
+    if (magic == LSW_CHANGE_MAGIC) {
+        /* Manual-reset: only FindNextChangeNotification clears it */
+        lsw_change_notify_t* cn = handle;
+        if (milliseconds != 0) lsw_apc_wait_begin(q, &cn->lock, &cn->cond);
+        pthread_mutex_lock(&cn->lock);
+        if (milliseconds == 0xFFFFFFFF) {
+            while (!cn->signaled && !LSW_APC_PENDING(q))
+                pthread_cond_wait(&cn->cond, &cn->lock);
+        } else if (milliseconds != 0) {
+            struct timespec ts;
+            lsw_deadline_ms(&ts, milliseconds);
+            while (!cn->signaled && !LSW_APC_PENDING(q)) {
+                if (pthread_cond_timedwait(&cn->cond, &cn->lock, &ts) != 0) break;
+            }
+        }
+        int hit = cn->signaled;
+        pthread_mutex_unlock(&cn->lock);
+        if (milliseconds != 0) lsw_apc_wait_end(q);
+        if (hit) return 0; /* WAIT_OBJECT_0 */
+        return LSW_APC_PENDING(q) ? WAIT_IO_COMPLETION : 0x00000102;
+    }
+
     if (magic == LSW_THREAD_MAGIC) {
         lsw_thread_handle_t* th = handle;
+        if (milliseconds != 0) lsw_apc_wait_begin(q, &th->lock, &th->cond);
         pthread_mutex_lock(&th->lock);
-        if (milliseconds == 0xFFFFFFFF) {
-            while (!th->finished)
-                pthread_cond_wait(&th->cond, &th->lock);
-            pthread_mutex_unlock(&th->lock);
-            return 0; /* WAIT_OBJECT_0 */
-        } else if (milliseconds == 0) {
+        if (milliseconds == 0) {
             int done = th->finished;
             pthread_mutex_unlock(&th->lock);
             return done ? 0 : 0x00000102; /* WAIT_TIMEOUT */
+        }
+        if (milliseconds == 0xFFFFFFFF) {
+            while (!th->finished && !LSW_APC_PENDING(q))
+                pthread_cond_wait(&th->cond, &th->lock);
         } else {
             struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec  += milliseconds / 1000;
-            ts.tv_nsec += (milliseconds % 1000) * 1000000L;
-            if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
-            while (!th->finished) {
+            lsw_deadline_ms(&ts, milliseconds);
+            while (!th->finished && !LSW_APC_PENDING(q)) {
                 if (pthread_cond_timedwait(&th->cond, &th->lock, &ts) != 0) break;
             }
-            int done = th->finished;
-            pthread_mutex_unlock(&th->lock);
-            return done ? 0 : 0x00000102;
         }
+        int done = th->finished;
+        pthread_mutex_unlock(&th->lock);
+        lsw_apc_wait_end(q);
+        if (done) return 0; /* WAIT_OBJECT_0 */
+        return LSW_APC_PENDING(q) ? WAIT_IO_COMPLETION : 0x00000102;
     }
 
     /* ---- Kernel path ---- */
@@ -4963,22 +5212,120 @@ uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t
 
     /* Fallback sleep */
     LSW_LOG_WARN("WaitForSingleObject(%p, %u): unknown handle type, fallback sleep", handle, milliseconds);
-    if (milliseconds != 0xFFFFFFFF)
-        usleep(milliseconds * 1000UL);
+    if (milliseconds != 0xFFFFFFFF || q) {
+        if (lsw_apc_sleep(q, milliseconds)) return WAIT_IO_COMPLETION;
+    }
     return 0;
 }
 
-/* WaitForSingleObjectEx — alertable wait; alertable flag ignored on Linux */
+uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObject(void* handle, uint32_t milliseconds)
+{
+    LSW_LOG_INFO("WaitForSingleObject: handle=%p ms=0x%x", handle, milliseconds);
+    return lsw_wait_object(handle, milliseconds, NULL);
+}
+
+/* WaitForSingleObjectEx — with bAlertable, queued APCs run on this thread
+ * (before or during the wait) and the call returns WAIT_IO_COMPLETION. */
 uint32_t __attribute__((ms_abi)) lsw_WaitForSingleObjectEx(void* handle, uint32_t ms, int alertable) {
-    (void)alertable;
-    return lsw_WaitForSingleObject(handle, ms);
+    if (!alertable) return lsw_WaitForSingleObject(handle, ms);
+    lsw_apc_queue_t* q = lsw_apc_self();
+    if (lsw_apc_drain(q)) return WAIT_IO_COMPLETION;
+    uint32_t r = lsw_wait_object(handle, ms, q);
+    if (r == WAIT_IO_COMPLETION) lsw_apc_drain(q);
+    return r;
 }
 
-/* WaitForMultipleObjectsEx — alertable multi-wait */
-extern uint32_t __attribute__((ms_abi)) lsw_WaitForMultipleObjects(uint32_t n, void** handles, int waitAll, uint32_t ms);
+/* Wait-any: check every object, then sleep on the calling thread's APC
+ * eventfd (see lsw_obj_wake) plus any timerfds until something changes.
+ * Processes have nothing to wake the waiter, so with one in the set the
+ * sleep is capped at 10ms.  `q` as for lsw_wait_object; the caller drains
+ * APCs on WAIT_IO_COMPLETION. */
+static uint32_t lsw_wait_any(uint32_t n, void** handles, uint32_t ms, lsw_apc_queue_t* q) {
+    lsw_apc_queue_t* self = q ? q : lsw_apc_self();
+    if (!self || self->efd < 0) {
+        LSW_LOG_ERROR("WaitForMultipleObjects: no eventfd for this thread");
+        return 0xFFFFFFFF;
+    }
+
+    struct pollfd pfd[1 + LSW_MAX_WAIT_OBJECTS];
+    int nfds = 1, capped = 0;
+    pfd[0] = (struct pollfd){ .fd = self->efd, .events = POLLIN };
+    for (uint32_t i = 0; i < n; i++) {
+        void* h = handles[i];
+        uint32_t magic = (h && IS_TYPED_HANDLE(h)) ? *(const uint32_t*)h : 0;
+        if (magic == LSW_TIMER_MAGIC && ((lsw_timer_t*)h)->timerfd >= 0)
+            pfd[nfds++] = (struct pollfd){ .fd = ((lsw_timer_t*)h)->timerfd, .events = POLLIN };
+        else if (magic != LSW_EVENT_MAGIC && magic != LSW_MUTEX_MAGIC &&
+                 magic != LSW_SEMA_MAGIC && magic != LSW_CHANGE_MAGIC &&
+                 magic != LSW_THREAD_MAGIC)
+            capped = 1;
+    }
+
+    struct timespec end;
+    if (ms != 0xFFFFFFFF) lsw_deadline_ms(&end, ms);
+
+    lsw_obj_waiter_t w = { self, NULL };
+    lsw_obj_waiter_add(&w);
+    uint32_t r;
+    for (;;) {
+        uint32_t i;
+        for (i = 0; i < n; i++) {
+            if (lsw_wait_object(handles[i], 0, NULL) == 0) break;
+        }
+        if (i < n) { r = i; break; } /* WAIT_OBJECT_0 + i */
+        if (LSW_APC_PENDING(q)) { r = WAIT_IO_COMPLETION; break; }
+
+        int timeout = -1;
+        if (ms != 0xFFFFFFFF) {
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            int64_t left = (int64_t)(end.tv_sec - now.tv_sec) * 1000000000LL +
+                           (end.tv_nsec - now.tv_nsec);
+            if (left <= 0) { r = 0x00000102; break; }
+            timeout = (int)((left + 999999) / 1000000);
+        }
+        if (capped && (timeout < 0 || timeout > 10)) timeout = 10;
+        if (poll(pfd, (nfds_t)nfds, timeout) > 0 && (pfd[0].revents & POLLIN)) {
+            uint64_t cnt;
+            (void)!read(self->efd, &cnt, sizeof(cnt));
+        }
+    }
+    lsw_obj_waiter_remove(&w);
+    return r;
+}
+
+/* Multi-object wait.  Wait-all waits on each object in turn; wait-any
+ * is lsw_wait_any.  `q` as for lsw_wait_object. */
+static uint32_t lsw_wait_multiple(uint32_t n, void** handles, int waitAll, uint32_t ms, lsw_apc_queue_t* q) {
+    if (n == 0 || n > LSW_MAX_WAIT_OBJECTS || !handles) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0xFFFFFFFF;
+    }
+    if (lsw_apc_drain(q)) return WAIT_IO_COMPLETION;
+
+    uint32_t r = 0x00000102;
+    if (waitAll) {
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint32_t elapsed = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t left = (ms == 0xFFFFFFFF) ? ms : (elapsed < ms ? ms - elapsed : 0);
+            r = lsw_wait_object(handles[i], left, q);
+            if (r != 0) break;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            elapsed = (uint32_t)((now.tv_sec - start.tv_sec) * 1000 +
+                                 (now.tv_nsec - start.tv_nsec) / 1000000);
+        }
+    } else {
+        r = lsw_wait_any(n, handles, ms, q);
+    }
+    if (r == WAIT_IO_COMPLETION) lsw_apc_drain(q);
+    return r;
+}
+
+/* WaitForMultipleObjectsEx — with bAlertable, queued APCs end the wait */
 uint32_t __attribute__((ms_abi)) lsw_WaitForMultipleObjectsEx(uint32_t n, void** handles, int waitAll, uint32_t ms, int alertable) {
-    (void)alertable;
-    return lsw_WaitForMultipleObjects(n, handles, waitAll, ms);
+    return lsw_wait_multiple(n, handles, waitAll, ms, alertable ? lsw_apc_self() : NULL);
 }
 
 /* CreateSemaphoreExW — extended CreateSemaphoreW, flags ignored */
@@ -5001,21 +5348,323 @@ void* __attribute__((ms_abi)) lsw_CreateMutexExW(void* sa, const uint16_t* name,
     return lsw_CreateMutexW(sa, 0, name);
 }
 
-/* DebugBreak — no-op on Linux */
-void __attribute__((ms_abi)) lsw_DebugBreak(void) {
-    LSW_LOG_WARN("DebugBreak called — ignored");
+/* DebugBreak — no-op on Linux */
+void __attribute__((ms_abi)) lsw_DebugBreak(void) {
+    LSW_LOG_WARN("DebugBreak called — ignored");
+}
+
+/* ---- Directory change notifications ----
+ * FindFirstChangeNotification and ReadDirectoryChangesW share the inotify
+ * engine in win32_dirwatch.c.  ReadDirectoryChangesW keeps one watch per
+ * directory handle, created by the first call, and events queue up
+ * between calls.  A call with a different subtree flag or filter
+ * re-masks the watch from then on.  Completion is synchronous, or
+ * through the OVERLAPPED event, an associated completion port, or a
+ * completion routine APC. */
+
+extern int __attribute__((ms_abi)) lsw_ResetEvent(void* h);
+extern int __attribute__((ms_abi)) lsw_PostQueuedCompletionStatus(void* port, uint32_t bytes,
+                                                                    uintptr_t key, void* overlapped);
+
+#define LSW_NOTIFY_FILTER_VALID 0x17Fu   /* FILE_NOTIFY_CHANGE_* */
+
+/* Per-handle I/O state.  Raw fd handles have nowhere to hang it, so it
+ * lives here, keyed by handle value, and is dropped on close. */
+typedef struct lsw_file_bind_s {
+    void*             handle;
+    win32_dirwatch_t* watch;    /* ReadDirectoryChangesW */
+    lsw_iocp_t*       port;     /* CreateIoCompletionPort association */
+    uintptr_t         key;
+    int               overlapped; /* FILE_FLAG_OVERLAPPED */
+    struct lsw_file_bind_s* next;
+} lsw_file_bind_t;
+
+static pthread_mutex_t  g_file_bind_lock = PTHREAD_MUTEX_INITIALIZER;
+static lsw_file_bind_t* g_file_binds;
+static int              g_file_bind_count;  /* lets close paths skip the lock */
+
+/* g_file_bind_lock held */
+static lsw_file_bind_t* lsw_file_bind_get(void* handle, int create) {
+    for (lsw_file_bind_t* b = g_file_binds; b; b = b->next) {
+        if (b->handle == handle) return b;
+    }
+    if (!create) return NULL;
+    lsw_file_bind_t* b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->handle = handle;
+    b->next = g_file_binds;
+    g_file_binds = b;
+    __atomic_add_fetch(&g_file_bind_count, 1, __ATOMIC_RELEASE);
+    return b;
+}
+
+void lsw_handle_unbind(void* handle) {
+    if (!__atomic_load_n(&g_file_bind_count, __ATOMIC_ACQUIRE)) return;
+    pthread_mutex_lock(&g_file_bind_lock);
+    lsw_file_bind_t** pp = &g_file_binds;
+    while (*pp && (*pp)->handle != handle) pp = &(*pp)->next;
+    lsw_file_bind_t* b = *pp;
+    if (b) {
+        *pp = b->next;
+        __atomic_sub_fetch(&g_file_bind_count, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&g_file_bind_lock);
+    if (b) {
+        win32_dirwatch_close(b->watch);   /* a pending read completes as aborted */
+        free(b);
+    }
+}
+
+/* Opened with FILE_FLAG_OVERLAPPED: waits on it complete asynchronously */
+static void lsw_file_bind_overlapped(void* handle) {
+    pthread_mutex_lock(&g_file_bind_lock);
+    lsw_file_bind_t* b = lsw_file_bind_get(handle, 1);
+    if (b) b->overlapped = 1;
+    pthread_mutex_unlock(&g_file_bind_lock);
+}
+
+/* A completion port is going away: forget the handles associated with it */
+static void lsw_port_unbind(lsw_iocp_t* port) {
+    if (!__atomic_load_n(&g_file_bind_count, __ATOMIC_ACQUIRE)) return;
+    pthread_mutex_lock(&g_file_bind_lock);
+    for (lsw_file_bind_t* b = g_file_binds; b; b = b->next) {
+        if (b->port == port) b->port = NULL;
+    }
+    pthread_mutex_unlock(&g_file_bind_lock);
+}
+
+/* Windows error for a failed watch open */
+static uint32_t lsw_dirwatch_error(int err) {
+    switch (err) {
+    case ENOENT:  return 2;     /* ERROR_FILE_NOT_FOUND */
+    case ENOTDIR: return 267;   /* ERROR_DIRECTORY */
+    case EACCES:  return 5;     /* ERROR_ACCESS_DENIED */
+    case ENOSPC:
+    case EMFILE:
+    case ENOMEM:  return 1450;  /* ERROR_NO_SYSTEM_RESOURCES */
+    default:      return 1;     /* ERROR_INVALID_FUNCTION */
+    }
+}
+
+/* Watcher thread: new events for a change notification handle */
+static void lsw_change_signal(void* ctx) {
+    lsw_change_notify_t* cn = ctx;
+    pthread_mutex_lock(&cn->lock);
+    cn->signaled = 1;
+    pthread_cond_broadcast(&cn->cond);
+    pthread_mutex_unlock(&cn->lock);
+    lsw_obj_wake();
+}
+
+void* __attribute__((ms_abi)) lsw_FindFirstChangeNotificationA(const char* path, int watchSubtree, uint32_t filter) {
+    char linux_path[LSW_MAX_PATH];
+    if (!path || !filter || (filter & ~LSW_NOTIFY_FILTER_VALID)) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return INVALID_HANDLE_VALUE;
+    }
+    if (lsw_fs_win_to_linux(path, linux_path, sizeof(linux_path)) != LSW_SUCCESS) {
+        lsw_SetLastError(3); /* ERROR_PATH_NOT_FOUND */
+        return INVALID_HANDLE_VALUE;
+    }
+    lsw_change_notify_t* cn = calloc(1, sizeof(*cn));
+    if (!cn) { lsw_SetLastError(8); return INVALID_HANDLE_VALUE; }
+    cn->watch = win32_dirwatch_open(linux_path, watchSubtree, filter);
+    if (!cn->watch) {
+        LSW_LOG_WARN("FindFirstChangeNotification: %s: %s", linux_path, strerror(errno));
+        lsw_SetLastError(lsw_dirwatch_error(errno));
+        free(cn);
+        return INVALID_HANDLE_VALUE;
+    }
+    cn->magic = LSW_CHANGE_MAGIC;
+    pthread_mutex_init(&cn->lock, NULL);
+    pthread_cond_init(&cn->cond, NULL);
+    win32_dirwatch_set_signal(cn->watch, lsw_change_signal, cn);
+    return cn;
+}
+void* __attribute__((ms_abi)) lsw_FindFirstChangeNotificationW(const uint16_t* path, int watchSubtree, uint32_t filter) {
+    char path_mb[LSW_MAX_PATH];
+    if (!path || lsw_WideCharToMultiByte(CP_UTF8, 0, (const wchar_t*)path, -1, path_mb, sizeof(path_mb), NULL, NULL) == 0) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return INVALID_HANDLE_VALUE;
+    }
+    return lsw_FindFirstChangeNotificationA(path_mb, watchSubtree, filter);
+}
+/* Re-arm: the handle stays signaled until this call; events seen so far
+ * are consumed (change notification handles carry no details). */
+int __attribute__((ms_abi)) lsw_FindNextChangeNotification(void* handle) {
+    lsw_change_notify_t* cn = handle;
+    if (!IS_TYPED_HANDLE(cn) || cn->magic != LSW_CHANGE_MAGIC) {
+        lsw_SetLastError(6); /* ERROR_INVALID_HANDLE */
+        return 0;
+    }
+    pthread_mutex_lock(&cn->lock);
+    cn->signaled = 0;
+    pthread_mutex_unlock(&cn->lock);
+    win32_dirwatch_discard(cn->watch);
+    return 1;
+}
+int __attribute__((ms_abi)) lsw_FindCloseChangeNotification(void* handle) {
+    lsw_change_notify_t* cn = handle;
+    if (!IS_TYPED_HANDLE(cn) || cn->magic != LSW_CHANGE_MAGIC) {
+        lsw_SetLastError(6); /* ERROR_INVALID_HANDLE */
+        return 0;
+    }
+    win32_dirwatch_close(cn->watch);    /* no signal callback after this */
+    cn->magic = 0;
+    pthread_mutex_destroy(&cn->lock);
+    pthread_cond_destroy(&cn->cond);
+    free(cn);
+    return 1;
+}
+
+/* One outstanding asynchronous ReadDirectoryChangesW */
+typedef struct {
+    uint64_t*        ovl;       /* [0] Internal, [1] InternalHigh, hEvent at +24 */
+    void*            routine;   /* LPOVERLAPPED_COMPLETION_ROUTINE */
+    lsw_apc_queue_t* q;         /* issuing thread, for the routine */
+    lsw_iocp_t*      port;
+    uintptr_t        key;
+} lsw_rdc_req_t;
+
+/* Runs on the watcher thread, or inline if the read completed at once or
+ * was cancelled; never with the engine lock held */
+static void lsw_rdc_complete(void* ctx, uint32_t bytes, int status) {
+    lsw_rdc_req_t* r = ctx;
+    uint32_t err;
+    uint64_t nt;
+    if (status == WIN32_DIRWATCH_OK) {
+        err = 0; nt = 0;
+    } else if (status == WIN32_DIRWATCH_OVERFLOW) {
+        err = 1022; nt = 0x0000010CULL;          /* ERROR_NOTIFY_ENUM_DIR / STATUS_NOTIFY_ENUM_DIR */
+    } else {
+        err = 995;  nt = 0xC0000120ULL;          /* ERROR_OPERATION_ABORTED / STATUS_CANCELLED */
+    }
+    r->ovl[1] = bytes;
+    __atomic_store_n(&r->ovl[0], nt, __ATOMIC_RELEASE);
+
+    /* Low bit of hEvent set: signal the event but skip the completion port */
+    uintptr_t evh = *(uintptr_t*)((uint8_t*)r->ovl + 24);
+    if (evh & ~(uintptr_t)1) lsw_SetEvent((void*)(evh & ~(uintptr_t)1));
+    if (r->port && !(evh & 1)) lsw_PostQueuedCompletionStatus(r->port, bytes, r->key, r->ovl);
+    if (r->routine && r->q) {
+        lsw_apc_t* a = calloc(1, sizeof(*a));
+        if (a) {
+            a->kind  = LSW_APC_IO;
+            a->fn    = r->routine;
+            a->data  = (uintptr_t)r->ovl;
+            a->error = err;
+            a->bytes = bytes;
+            if (!lsw_apc_enqueue(r->q, a)) free(a);
+        }
+    }
+    lsw_apc_queue_put(r->q);
+    free(r);
+}
+
+int __attribute__((ms_abi)) lsw_ReadDirectoryChangesW(void* hDirectory, void* lpBuffer, uint32_t nBufferLength,
+                                                        int bWatchSubtree, uint32_t dwNotifyFilter,
+                                                        uint32_t* lpBytesReturned, void* lpOverlapped,
+                                                        void* lpCompletionRoutine) {
+    if (!dwNotifyFilter || (dwNotifyFilter & ~LSW_NOTIFY_FILTER_VALID) || (!lpBuffer && nBufferLength)) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
+    }
+
+    int fd = -1;
+    if (!IS_TYPED_HANDLE(hDirectory)) {
+        if (!LSW_IS_PSEUDO_HANDLE(hDirectory) && hDirectory) fd = (int)(intptr_t)hDirectory;
+    } else if (*(const uint32_t*)hDirectory == LSW_DIR_MAGIC) {
+        fd = ((lsw_nt_dir_handle_t*)hDirectory)->dirfd;
+    }
+    if (fd < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+
+    pthread_mutex_lock(&g_file_bind_lock);
+    lsw_file_bind_t* b = lsw_file_bind_get(hDirectory, 1);
+    if (b && !b->watch) {
+        char link[64], path[LSW_MAX_PATH];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", fd);
+        ssize_t n = readlink(link, path, sizeof(path) - 1);
+        if (n > 0) {
+            path[n] = '\0';
+            b->watch = win32_dirwatch_open(path, bWatchSubtree, dwNotifyFilter);
+        } else {
+            errno = EBADF;
+        }
+        if (!b->watch) {
+            int err = errno;
+            pthread_mutex_unlock(&g_file_bind_lock);
+            lsw_SetLastError(err == EBADF ? 6 : lsw_dirwatch_error(err));
+            return 0;
+        }
+    } else if (b && win32_dirwatch_configure(b->watch, bWatchSubtree, dwNotifyFilter) != 0) {
+        int err = errno;
+        pthread_mutex_unlock(&g_file_bind_lock);
+        lsw_SetLastError(lsw_dirwatch_error(err));
+        return 0;
+    }
+    /* A CloseHandle racing with this call may close the watch once the
+     * lock is dropped; the reference keeps it allocated until the read
+     * has started (and seen it closed, if so). */
+    win32_dirwatch_t* w = b ? b->watch : NULL;
+    lsw_iocp_t* port = b ? b->port : NULL;
+    uintptr_t key = b ? b->key : 0;
+    if (w) win32_dirwatch_get(w);
+    pthread_mutex_unlock(&g_file_bind_lock);
+    if (!w) { lsw_SetLastError(8); return 0; } /* ERROR_NOT_ENOUGH_MEMORY */
+
+    uint32_t bytes = 0;
+    if (!lpOverlapped) {
+        int st = win32_dirwatch_read(w, lpBuffer, nBufferLength, &bytes, NULL, NULL);
+        win32_dirwatch_put(w);
+        if (lpBytesReturned) *lpBytesReturned = bytes;
+        if (st == WIN32_DIRWATCH_CANCELLED) { lsw_SetLastError(995); return 0; } /* ERROR_OPERATION_ABORTED */
+        /* Lost events: success with nothing returned, the caller rescans */
+        lsw_SetLastError(st == WIN32_DIRWATCH_OVERFLOW ? 1022 : 0);
+        return 1;
+    }
+
+    lsw_rdc_req_t* r = calloc(1, sizeof(*r));
+    if (!r) { win32_dirwatch_put(w); lsw_SetLastError(8); return 0; }
+    r->ovl = lpOverlapped;
+    r->routine = lpCompletionRoutine;
+    if (lpCompletionRoutine) {
+        r->q = lsw_apc_self();
+        if (r->q) {
+            pthread_mutex_lock(&r->q->lock);
+            r->q->refs++;
+            pthread_mutex_unlock(&r->q->lock);
+        }
+    } else {
+        r->port = port;
+        r->key  = key;
+    }
+    r->ovl[1] = 0;
+    r->ovl[0] = 0x103; /* STATUS_PENDING */
+    uintptr_t evh = *(uintptr_t*)((uint8_t*)lpOverlapped + 24);
+    if (evh & ~(uintptr_t)1) lsw_ResetEvent((void*)(evh & ~(uintptr_t)1));
+
+    int st = win32_dirwatch_read(w, lpBuffer, nBufferLength, &bytes, lsw_rdc_complete, r);
+    win32_dirwatch_put(w);
+    if (st != WIN32_DIRWATCH_PENDING) lsw_rdc_complete(r, bytes, st);
+    if (lpBytesReturned) *lpBytesReturned = 0;
+    return 1;
 }
 
-/* File change notification stubs */
-void* __attribute__((ms_abi)) lsw_FindFirstChangeNotificationW(const uint16_t* path, int watchSubtree, uint32_t filter) {
-    (void)path; (void)watchSubtree; (void)filter;
-    return (void*)(intptr_t)-1; /* INVALID_HANDLE_VALUE */
-}
-int __attribute__((ms_abi)) lsw_FindNextChangeNotification(void* handle) {
-    (void)handle; return 0;
-}
-int __attribute__((ms_abi)) lsw_FindCloseChangeNotification(void* handle) {
-    (void)handle; return 1;
+/* Cancel the handle's outstanding ReadDirectoryChangesW; 1 if there was one */
+static int lsw_cancel_pending_io(void* handle) {
+    int found = 0;
+    if (!__atomic_load_n(&g_file_bind_count, __ATOMIC_ACQUIRE)) return 0;
+    pthread_mutex_lock(&g_file_bind_lock);
+    lsw_file_bind_t* b = lsw_file_bind_get(handle, 0);
+    win32_dirwatch_t* w = b ? b->watch : NULL;
+    if (w) win32_dirwatch_get(w);
+    pthread_mutex_unlock(&g_file_bind_lock);
+    /* The completion runs here; keep it out from under the bind lock */
+    if (w) {
+        found = win32_dirwatch_cancel(w);
+        win32_dirwatch_put(w);
+    }
+    return found;
 }
 
 /* Resource API stubs — robocopy/ulib uses these for string resources */
@@ -5032,10 +5681,25 @@ uint32_t __attribute__((ms_abi)) lsw_SizeofResource(void* hmod, void* hresinfo)
     (void)hmod; (void)hresinfo; return 0;
 }
 
-/* CopyFile2 — modern file copy; stub delegates to CopyFileW */
+/* CopyFile2 — modern file copy. COPYFILE2_EXTENDED_PARAMETERS supplies
+ * the flags and cancel flag; its message-based progress routine is not
+ * called. */
+typedef struct {
+    uint32_t dwSize;
+    uint32_t dwCopyFlags;
+    int*     pfCancel;
+    void*    pProgressRoutine;
+    void*    pvCallbackContext;
+} lsw_copyfile2_params_t;
+
 int32_t __attribute__((ms_abi)) lsw_CopyFile2(const wchar_t* src, const wchar_t* dst, void* params) {
-    (void)params;
-    return lsw_CopyFileW(src, dst, 0) ? 0 : (int32_t)0x80070000; /* S_OK or HRESULT failure */
+    const lsw_copyfile2_params_t* p = params;
+    char src_mb[LSW_MAX_PATH], dst_mb[LSW_MAX_PATH];
+    if (!lsw_copy_path_a(src, src_mb, sizeof(src_mb)) || !lsw_copy_path_a(dst, dst_mb, sizeof(dst_mb)))
+        return (int32_t)0x80070057; /* E_INVALIDARG */
+    uint32_t err = lsw_copy_file_ex(src_mb, dst_mb, NULL, NULL, p ? p->pfCancel : NULL,
+                                    p ? p->dwCopyFlags : 0);
+    return err ? (int32_t)(0x80070000u | err) : 0; /* HRESULT_FROM_WIN32 */
 }
 
 /* BackupRead/BackupWrite — stream-based file copy for ACL/ADS; basic stubs */
@@ -5529,6 +6193,12 @@ void* __attribute__((ms_abi)) lsw_LoadLibraryA(const char* filename)
                                 }
                             }
 
+                            /* Exception directory: lets throws unwind through this DLL */
+                            uint32_t pdata_rva = *(uint32_t*)(fd8 + opt_off2 + 136);
+                            uint32_t pdata_sz  = *(uint32_t*)(fd8 + opt_off2 + 140);
+                            if (pdata_rva && pdata_sz && pdata_rva + pdata_sz <= image_size2)
+                                win32_ftab_add_image((uint64_t)(uintptr_t)b, image_size2, b + pdata_rva, pdata_sz);
+
                             munmap(file_data, (size_t)st.st_size);
 
                             pthread_mutex_lock(&g_pe_module_lock);
@@ -6622,21 +7292,14 @@ void __attribute__((ms_abi)) lsw_SetLastError(DWORD code) {
 }
 
 // KERNEL32.dll!GetTickCount - milliseconds since boot (wraps at ~49.7 days)
+// Both read TickCountQuad from KUSER_SHARED_DATA, like Windows.
 uint32_t __attribute__((ms_abi)) lsw_GetTickCount(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    uint32_t ms = (uint32_t)(tv.tv_sec * 1000ULL + tv.tv_usec / 1000ULL);
-    LSW_LOG_DEBUG("GetTickCount() -> %u", ms);
-    return ms;
+    return (uint32_t)win32_kuser_tick_count();
 }
 
 // KERNEL32.dll!GetTickCount64
 uint64_t __attribute__((ms_abi)) lsw_GetTickCount64(void) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    uint64_t ms = (uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000ULL;
-    LSW_LOG_DEBUG("GetTickCount64() -> %llu", (unsigned long long)ms);
-    return ms;
+    return win32_kuser_tick_count();
 }
 
 // SYSTEM_INFO structure (Windows layout)
@@ -7615,38 +8278,413 @@ int __attribute__((ms_abi)) lsw_TryEnterCriticalSection(pthread_mutex_t** cs) {
     return (pthread_mutex_trylock(*cs) == 0) ? 1 : 0;
 }
 
-// ---- FLS (Fiber-Local Storage, backed by TLS on Linux) ----
-#define FLS_SLOTS_MAX 128
-static pthread_key_t g_fls_keys[FLS_SLOTS_MAX];
-static int           g_fls_used[FLS_SLOTS_MAX];
-static void        (*g_fls_callbacks[FLS_SLOTS_MAX])(void*);
+// ---- Fibers + FLS (Fiber-Local Storage) ----
+// Each fiber owns an mmap'd stack with a PROT_NONE guard page below it and
+// its own FLS value array.  Threads that never call ConvertThreadToFiber
+// still get an implicit "thread fiber" record so FlsGetValue/FlsSetValue and
+// the FLS destructor callbacks work for plain threads too.
+//
+// Switching is done by lsw_fiber_switch (assembly below), which saves only
+// what the Windows x64 ABI says a callee must preserve: RBX, RBP, RDI, RSI,
+// R12-R15, XMM6-XMM15, MXCSR and the x87 control word.  No signal masks, no
+// syscalls — a switch is ~30 instructions.
+#define FLS_SLOTS_MAX            128
+#define FLS_OUT_OF_INDEXES       0xFFFFFFFFU
+#define LSW_FIBER_MAGIC          0x46494252U  /* "FIBR" */
+#define LSW_FIBER_DEFAULT_STACK  (1024 * 1024)
+#define LSW_FIBER_GUARD_SIZE     4096
+#define FIBER_FLAG_FLOAT_SWITCH  0x1          /* always honoured — we save XMM/MXCSR */
+
+typedef void (__attribute__((ms_abi)) *lsw_fiber_start_t)(void*);
+typedef void (__attribute__((ms_abi)) *lsw_fls_callback_t)(void*);
+
+typedef struct lsw_fiber_s lsw_fiber_t;
+struct lsw_fiber_s {
+    /* Windows' GetFiberData() is an inline *(void**)GetCurrentFiber(), and
+     * GetCurrentFiber() reads TEB.FiberData (gs:0x20) — so the fiber
+     * parameter MUST be the first field of the object we hand out. */
+    void*             param;          /* 0x00 — GetFiberData() */
+    void*             saved_rsp;      /* 0x08 — written by lsw_fiber_switch */
+    uint32_t          magic;          /* LSW_FIBER_MAGIC */
+    int               is_thread;      /* 1 = implicit fiber of a Linux thread */
+    int               converted;      /* 1 = ConvertThreadToFiber called */
+    lsw_fiber_start_t start;
+    void*             stack_base;     /* TEB.StackBase while this fiber runs */
+    void*             stack_limit;    /* TEB.StackLimit while this fiber runs */
+    void*             map_base;       /* mmap'd region (guard + stack); NULL for thread fibers */
+    size_t            map_size;
+    void*             fls[FLS_SLOTS_MAX];
+    lsw_fiber_t*      next;           /* g_fiber_list — walked by FlsFree */
+    lsw_fiber_t*      prev;
+};
+
+static int                g_fls_used[FLS_SLOTS_MAX];
+static lsw_fls_callback_t g_fls_callbacks[FLS_SLOTS_MAX];
+static pthread_mutex_t    g_fls_lock = PTHREAD_MUTEX_INITIALIZER;
+static lsw_fiber_t*       g_fiber_list = NULL;   /* all live fibers, under g_fls_lock */
+static pthread_key_t      g_fiber_exit_key;
+static pthread_once_t     g_fiber_once = PTHREAD_ONCE_INIT;
+static __thread lsw_fiber_t* t_current_fiber = NULL;
+
+/* lsw_fiber_switch(from, to) — ms_abi: RCX = from, RDX = to.
+ * Pushes the callee-saved GPRs, spills XMM6-15 + MXCSR + x87 CW into an
+ * aligned 0xA8-byte area, stores RSP in from->saved_rsp and resumes `to`
+ * by running the same sequence in reverse.  A fresh fiber's stack is
+ * pre-built by lsw_fiber_init_stack() to look like a suspended switch whose
+ * return address is lsw_fiber_entry_thunk. */
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ".globl lsw_fiber_switch\n"
+    ".hidden lsw_fiber_switch\n"
+    ".type lsw_fiber_switch,@function\n"
+    "lsw_fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %rdi\n"
+    "    pushq %rsi\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $0xa8, %rsp\n"
+    "    movaps %xmm6,  0x00(%rsp)\n"
+    "    movaps %xmm7,  0x10(%rsp)\n"
+    "    movaps %xmm8,  0x20(%rsp)\n"
+    "    movaps %xmm9,  0x30(%rsp)\n"
+    "    movaps %xmm10, 0x40(%rsp)\n"
+    "    movaps %xmm11, 0x50(%rsp)\n"
+    "    movaps %xmm12, 0x60(%rsp)\n"
+    "    movaps %xmm13, 0x70(%rsp)\n"
+    "    movaps %xmm14, 0x80(%rsp)\n"
+    "    movaps %xmm15, 0x90(%rsp)\n"
+    "    stmxcsr 0xa0(%rsp)\n"
+    "    fnstcw  0xa4(%rsp)\n"
+    "    movq %rsp, 0x08(%rcx)\n"
+    "    movq 0x08(%rdx), %rsp\n"
+    "    movaps 0x00(%rsp), %xmm6\n"
+    "    movaps 0x10(%rsp), %xmm7\n"
+    "    movaps 0x20(%rsp), %xmm8\n"
+    "    movaps 0x30(%rsp), %xmm9\n"
+    "    movaps 0x40(%rsp), %xmm10\n"
+    "    movaps 0x50(%rsp), %xmm11\n"
+    "    movaps 0x60(%rsp), %xmm12\n"
+    "    movaps 0x70(%rsp), %xmm13\n"
+    "    movaps 0x80(%rsp), %xmm14\n"
+    "    movaps 0x90(%rsp), %xmm15\n"
+    "    ldmxcsr 0xa0(%rsp)\n"
+    "    fldcw   0xa4(%rsp)\n"
+    "    addq $0xa8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rsi\n"
+    "    popq %rdi\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size lsw_fiber_switch, .-lsw_fiber_switch\n"
+    "\n"
+    /* First entry into a new fiber: R12 = lsw_fiber_t*, RSP = stack top. */
+    ".p2align 4\n"
+    ".globl lsw_fiber_entry_thunk\n"
+    ".hidden lsw_fiber_entry_thunk\n"
+    ".type lsw_fiber_entry_thunk,@function\n"
+    "lsw_fiber_entry_thunk:\n"
+    "    movq %r12, %rcx\n"
+    "    andq $-16, %rsp\n"
+    "    subq $32, %rsp\n"          /* ms_abi shadow space */
+    "    call lsw_fiber_run\n"
+    "    ud2\n"
+    ".size lsw_fiber_entry_thunk, .-lsw_fiber_entry_thunk\n"
+);
+
+void __attribute__((ms_abi)) lsw_fiber_switch(lsw_fiber_t* from, lsw_fiber_t* to);
+void lsw_fiber_entry_thunk(void);
+void __attribute__((ms_abi, noreturn, used)) lsw_fiber_run(lsw_fiber_t* f);
+
+/* Offsets baked into the assembly above */
+_Static_assert(offsetof(lsw_fiber_t, param)     == 0x00, "fiber param must be at 0x00");
+_Static_assert(offsetof(lsw_fiber_t, saved_rsp) == 0x08, "fiber saved_rsp must be at 0x08");
+
+/* Run the FLS destructor callbacks for every non-NULL slot of `f`. */
+static void lsw_fls_run_callbacks(lsw_fiber_t* f) {
+    for (int i = 0; i < FLS_SLOTS_MAX; i++) {
+        void* v = f->fls[i];
+        if (!v) continue;
+        f->fls[i] = NULL;
+        lsw_fls_callback_t cb = g_fls_used[i] ? g_fls_callbacks[i] : NULL;
+        if (cb) cb(v);
+    }
+}
+
+static void lsw_fiber_link(lsw_fiber_t* f) {
+    pthread_mutex_lock(&g_fls_lock);
+    f->prev = NULL;
+    f->next = g_fiber_list;
+    if (g_fiber_list) g_fiber_list->prev = f;
+    g_fiber_list = f;
+    pthread_mutex_unlock(&g_fls_lock);
+}
+
+static void lsw_fiber_unlink(lsw_fiber_t* f) {
+    pthread_mutex_lock(&g_fls_lock);
+    if (f->prev) f->prev->next = f->next;
+    else         g_fiber_list  = f->next;
+    if (f->next) f->next->prev = f->prev;
+    pthread_mutex_unlock(&g_fls_lock);
+}
+
+static void lsw_fiber_destroy(lsw_fiber_t* f) {
+    lsw_fls_run_callbacks(f);
+    lsw_fiber_unlink(f);
+    f->magic = 0;
+    if (f->map_base) munmap(f->map_base, f->map_size);
+    free(f);
+}
+
+/* pthread key destructor: a Linux thread is exiting — run FLS callbacks for
+ * whatever fiber it was running, then free its implicit thread fiber. */
+static void lsw_fiber_thread_exit(void* arg) {
+    lsw_fiber_t* thread_fiber = (lsw_fiber_t*)arg;
+    lsw_fiber_t* cur = t_current_fiber;
+    if (cur && cur != thread_fiber) lsw_fls_run_callbacks(cur);
+    t_current_fiber = NULL;
+    if (thread_fiber) lsw_fiber_destroy(thread_fiber);
+}
+
+static void lsw_fiber_once_init(void) {
+    pthread_key_create(&g_fiber_exit_key, lsw_fiber_thread_exit);
+}
+
+/* Current fiber of this thread; lazily creates the implicit thread fiber. */
+static lsw_fiber_t* lsw_fiber_current(void) {
+    if (t_current_fiber) return t_current_fiber;
+    pthread_once(&g_fiber_once, lsw_fiber_once_init);
+    lsw_fiber_t* f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->magic     = LSW_FIBER_MAGIC;
+    f->is_thread = 1;
+    lsw_fiber_link(f);
+    pthread_setspecific(g_fiber_exit_key, f);
+    t_current_fiber = f;
+    return f;
+}
+
+void __attribute__((ms_abi, noreturn, used)) lsw_fiber_run(lsw_fiber_t* f) {
+    LSW_LOG_DEBUG("Fiber %p starting: start=%p param=%p", (void*)f, (void*)f->start, f->param);
+    f->start(f->param);
+    /* Returning from a fiber start routine exits the thread (Windows semantics) */
+    LSW_LOG_DEBUG("Fiber %p start routine returned — exiting thread", (void*)f);
+    lsw_ExitThread(0);
+    __builtin_unreachable();
+}
+
+/* Lay out a new fiber's stack so the first lsw_fiber_switch into it
+ * "returns" into lsw_fiber_entry_thunk with R12 = f. */
+static void lsw_fiber_init_stack(lsw_fiber_t* f) {
+    uint64_t* top = (uint64_t*)((uintptr_t)f->stack_base & ~(uintptr_t)15);
+    uint8_t*  frame = (uint8_t*)top - 0xF0;
+    memset(frame, 0, 0xF0);
+    *(uint32_t*)(frame + 0xA0) = 0x1F80;  /* MXCSR default */
+    *(uint16_t*)(frame + 0xA4) = 0x027F;  /* x87 CW default (Windows) */
+    *(uint64_t*)(frame + 0xC0) = (uint64_t)(uintptr_t)f;  /* R12 */
+    *(uint64_t*)(frame + 0xE8) = (uint64_t)(uintptr_t)lsw_fiber_entry_thunk;
+    f->saved_rsp = frame;
+}
+
+// KERNEL32.dll!CreateFiberEx
+void* __attribute__((ms_abi)) lsw_CreateFiberEx(size_t dwStackCommitSize, size_t dwStackReserveSize,
+                                               uint32_t dwFlags, void* lpStartAddress, void* lpParameter) {
+    (void)dwFlags;
+    if (!lpStartAddress) { lsw_SetLastError(ERROR_INVALID_PARAMETER); return NULL; }
+    pthread_once(&g_fiber_once, lsw_fiber_once_init);
+
+    size_t stack = dwStackReserveSize ? dwStackReserveSize : dwStackCommitSize;
+    if (stack == 0) stack = LSW_FIBER_DEFAULT_STACK;
+    if (stack < 64 * 1024) stack = 64 * 1024;
+    stack = (stack + 0xFFFF) & ~(size_t)0xFFFF;  /* Windows rounds to 64K granularity */
+
+    lsw_fiber_t* f = calloc(1, sizeof(*f));
+    if (!f) { lsw_SetLastError(8); return NULL; } /* ERROR_NOT_ENOUGH_MEMORY */
+
+    f->map_size = stack + LSW_FIBER_GUARD_SIZE;
+    f->map_base = mmap(NULL, f->map_size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (f->map_base == MAP_FAILED) {
+        free(f);
+        lsw_SetLastError(8);
+        return NULL;
+    }
+    /* Lowest page stays PROT_NONE as the overflow guard */
+    uint8_t* lo = (uint8_t*)f->map_base + LSW_FIBER_GUARD_SIZE;
+    if (mprotect(lo, stack, PROT_READ | PROT_WRITE) != 0) {
+        munmap(f->map_base, f->map_size);
+        free(f);
+        lsw_SetLastError(8);
+        return NULL;
+    }
+
+    f->magic       = LSW_FIBER_MAGIC;
+    f->param       = lpParameter;
+    f->start       = (lsw_fiber_start_t)lpStartAddress;
+    f->stack_limit = lo;
+    f->stack_base  = lo + stack;
+    lsw_fiber_init_stack(f);
+    lsw_fiber_link(f);
+
+    LSW_LOG_DEBUG("CreateFiberEx: fiber=%p stack=[%p,%p) start=%p",
+                  (void*)f, f->stack_limit, f->stack_base, lpStartAddress);
+    return f;
+}
+
+// KERNEL32.dll!CreateFiber
+void* __attribute__((ms_abi)) lsw_CreateFiber(size_t dwStackSize, void* lpStartAddress, void* lpParameter) {
+    return lsw_CreateFiberEx(dwStackSize, 0, 0, lpStartAddress, lpParameter);
+}
+
+// KERNEL32.dll!ConvertThreadToFiberEx
+void* __attribute__((ms_abi)) lsw_ConvertThreadToFiberEx(void* lpParameter, uint32_t dwFlags) {
+    (void)dwFlags;
+    lsw_fiber_t* f = lsw_fiber_current();
+    if (!f) { lsw_SetLastError(8); return NULL; }
+    if (f->converted) {
+        lsw_SetLastError(1280); /* ERROR_ALREADY_FIBER */
+        return NULL;
+    }
+    f->converted = 1;
+    f->param     = lpParameter;
+    win32_teb_t* teb = win32_teb_get();
+    if (teb) teb->FiberData = f;
+    LSW_LOG_DEBUG("ConvertThreadToFiber: fiber=%p param=%p", (void*)f, lpParameter);
+    return f;
+}
+
+// KERNEL32.dll!ConvertThreadToFiber
+void* __attribute__((ms_abi)) lsw_ConvertThreadToFiber(void* lpParameter) {
+    return lsw_ConvertThreadToFiberEx(lpParameter, 0);
+}
+
+// KERNEL32.dll!ConvertFiberToThread
+int __attribute__((ms_abi)) lsw_ConvertFiberToThread(void) {
+    lsw_fiber_t* f = t_current_fiber;
+    if (!f || !f->is_thread || !f->converted) {
+        lsw_SetLastError(1281); /* ERROR_ALREADY_THREAD */
+        return 0;
+    }
+    f->converted = 0;
+    win32_teb_t* teb = win32_teb_get();
+    if (teb) teb->FiberData = NULL;
+    return 1;
+}
+
+// KERNEL32.dll!IsThreadAFiber
+int __attribute__((ms_abi)) lsw_IsThreadAFiber(void) {
+    lsw_fiber_t* f = t_current_fiber;
+    return (f && (!f->is_thread || f->converted)) ? 1 : 0;
+}
+
+// KERNEL32.dll!SwitchToFiber
+void __attribute__((ms_abi)) lsw_SwitchToFiber(void* lpFiber) {
+    lsw_fiber_t* to  = (lsw_fiber_t*)lpFiber;
+    lsw_fiber_t* cur = t_current_fiber;
+    if (!to || to->magic != LSW_FIBER_MAGIC || !cur || cur == to) return;
+
+    /* TEB stack limits follow the fiber, so __chkstk, stack probes and
+     * GetCurrentThreadStackLimits see the fiber's own stack. */
+    win32_teb_t* teb = win32_teb_get();
+    if (teb) {
+        cur->stack_base  = teb->StackBase;
+        cur->stack_limit = teb->StackLimit;
+        teb->StackBase   = to->stack_base;
+        teb->StackLimit  = to->stack_limit;
+        teb->FiberData   = to;
+    }
+    t_current_fiber = to;
+    /* Nothing after this call may touch __thread state: the fiber can be
+     * resumed later by a different thread. */
+    lsw_fiber_switch(cur, to);
+}
+
+// KERNEL32.dll!DeleteFiber
+void __attribute__((ms_abi)) lsw_DeleteFiber(void* lpFiber) {
+    lsw_fiber_t* f = (lsw_fiber_t*)lpFiber;
+    if (!f || f->magic != LSW_FIBER_MAGIC) return;
+    if (f == t_current_fiber) {
+        /* Deleting the running fiber terminates the thread */
+        lsw_ExitThread(0);
+        return;
+    }
+    if (f->is_thread) return;  /* owned by its thread; freed at thread exit */
+    lsw_fiber_destroy(f);
+}
 
 uint32_t __attribute__((ms_abi)) lsw_FlsAlloc(void* callback) {
+    pthread_mutex_lock(&g_fls_lock);
     for (int i = 0; i < FLS_SLOTS_MAX; i++) {
         if (!g_fls_used[i]) {
             g_fls_used[i] = 1;
-            g_fls_callbacks[i] = (void(*)(void*))callback;
-            pthread_key_create(&g_fls_keys[i], (void(*)(void*))callback);
+            g_fls_callbacks[i] = (lsw_fls_callback_t)callback;
+            pthread_mutex_unlock(&g_fls_lock);
             LSW_LOG_DEBUG("FlsAlloc -> slot %d", i);
             return (uint32_t)i;
         }
     }
+    pthread_mutex_unlock(&g_fls_lock);
     LSW_LOG_ERROR("FlsAlloc: no free FLS slots");
-    return 0xFFFFFFFF;  // FLS_OUT_OF_INDEXES
+    lsw_SetLastError(8);
+    return FLS_OUT_OF_INDEXES;
 }
 int __attribute__((ms_abi)) lsw_FlsFree(uint32_t index) {
-    if (index >= FLS_SLOTS_MAX || !g_fls_used[index]) return 0;
-    pthread_key_delete(g_fls_keys[index]);
+    if (index >= FLS_SLOTS_MAX) { lsw_SetLastError(ERROR_INVALID_PARAMETER); return 0; }
+    pthread_mutex_lock(&g_fls_lock);
+    if (!g_fls_used[index]) {
+        pthread_mutex_unlock(&g_fls_lock);
+        lsw_SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+    /* Windows runs the slot's callback for every fiber holding a value.
+     * The values are taken under the lock and the callbacks run after it
+     * is dropped, since a callback may itself call Fls* or free a fiber. */
+    lsw_fls_callback_t cb = g_fls_callbacks[index];
+    size_t n = 0;
+    for (lsw_fiber_t* f = g_fiber_list; f; f = f->next)
+        if (f->fls[index]) n++;
+    void** values = (cb && n) ? malloc(n * sizeof(void*)) : NULL;
+    if (cb && n && !values)
+        LSW_LOG_WARN("FlsFree: out of memory, skipping %zu destructor calls", n);
+    n = 0;
+    for (lsw_fiber_t* f = g_fiber_list; f; f = f->next) {
+        void* v = f->fls[index];
+        f->fls[index] = NULL;
+        if (v && values) values[n++] = v;
+    }
     g_fls_used[index] = 0;
+    g_fls_callbacks[index] = NULL;
+    pthread_mutex_unlock(&g_fls_lock);
+
+    for (size_t i = 0; i < n; i++) cb(values[i]);
+    free(values);
     return 1;
 }
 void* __attribute__((ms_abi)) lsw_FlsGetValue(uint32_t index) {
-    if (index >= FLS_SLOTS_MAX || !g_fls_used[index]) return NULL;
-    return pthread_getspecific(g_fls_keys[index]);
+    if (index >= FLS_SLOTS_MAX || !g_fls_used[index]) {
+        lsw_SetLastError(ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    lsw_fiber_t* f = t_current_fiber;
+    return f ? f->fls[index] : NULL;
 }
 int __attribute__((ms_abi)) lsw_FlsSetValue(uint32_t index, void* value) {
-    if (index >= FLS_SLOTS_MAX || !g_fls_used[index]) return 0;
-    return (pthread_setspecific(g_fls_keys[index], value) == 0) ? 1 : 0;
+    if (index >= FLS_SLOTS_MAX || !g_fls_used[index]) {
+        lsw_SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+    lsw_fiber_t* f = lsw_fiber_current();
+    if (!f) { lsw_SetLastError(8); return 0; }
+    f->fls[index] = value;
+    return 1;
 }
 
 // ---- CreateMutexW ----
@@ -8089,43 +9127,33 @@ char* __attribute__((ms_abi)) lsw_ctime(const lsw_time_t* t) { return ctime((con
 size_t __attribute__((ms_abi)) lsw_strftime(char* s, size_t max, const char* fmt, const struct tm* tm_)
     { return strftime(s, max, fmt, tm_); }
 
-// Environment
-char* __attribute__((ms_abi)) lsw_getenv(const char* n) { return getenv(n); }
-int   __attribute__((ms_abi)) lsw__putenv(const char* s) { return putenv((char*)s); }
+// Environment — served from the shared store, so CRT and kernel32 agree
+char* __attribute__((ms_abi)) lsw_getenv(const char* n) { return (char*)win32_env_peek(n); }
+int   __attribute__((ms_abi)) lsw__putenv(const char* s) {
+    /* "NAME=value"; "NAME=" removes NAME */
+    const char* eq = s ? strchr(s + (s[0] == '='), '=') : NULL;
+    if (!eq) return -1;
+    char name[512];
+    if ((size_t)(eq - s) >= sizeof(name)) return -1;
+    memcpy(name, s, (size_t)(eq - s));
+    name[eq - s] = '\0';
+    return win32_env_set(name, eq[1] ? eq + 1 : NULL, 1) == 0 ? 0 : -1;
+}
 
 /* _putenv_s / _wputenv_s — used by .NET PAL pal::setenv */
 int __attribute__((ms_abi)) lsw__putenv_s(const char* name, const char* value) {
-    if (!name) return EINVAL;
-    if (!value || value[0] == '\0') {
-        return unsetenv(name) == 0 ? 0 : errno;
-    }
-    return setenv(name, value, 1) == 0 ? 0 : errno;
+    if (!name || !value) return EINVAL;
+    return win32_env_set(name, value[0] ? value : NULL, 1);
 }
 
 int __attribute__((ms_abi)) lsw__wputenv_s(const uint16_t* name, const uint16_t* value) {
-    if (!name) return EINVAL;
-    char name_mb[512] = {0};
-    for (int i = 0; i < 511 && name[i]; i++) name_mb[i] = (char)name[i];
-    char val_mb[4096] = {0};
-    if (value) {
-        for (int i = 0; i < 4095 && value[i]; i++) val_mb[i] = (char)value[i];
-        return setenv(name_mb, val_mb, 1) == 0 ? 0 : errno;
-    }
-    return unsetenv(name_mb) == 0 ? 0 : errno;
+    if (!name || !value) return EINVAL;
+    return win32_env_set_w(name, value[0] ? value : NULL);
 }
 
-/* msvcrt/ucrtbase _wgetenv — return wide env var (UTF-16 in static buffer) */
-static uint16_t lsw_wgetenv_buf[LSW_MAX_PATH];
+/* msvcrt/ucrtbase _wgetenv — the store's UTF-16 copy of the value */
 uint16_t* __attribute__((ms_abi)) lsw__wgetenv(const uint16_t* name) {
-    if (!name) return NULL;
-    char name_mb[256] = {0};
-    for (int i = 0; i < 255 && name[i]; i++) name_mb[i] = (char)name[i];
-    const char* val = getenv(name_mb);
-    if (!val) return NULL;
-    size_t i = 0;
-    for (; val[i] && i < LSW_MAX_PATH - 1; i++) lsw_wgetenv_buf[i] = (uint16_t)(unsigned char)val[i];
-    lsw_wgetenv_buf[i] = 0;
-    return lsw_wgetenv_buf;
+    return (uint16_t*)win32_env_peek_w(name, -1);
 }
 
 /* Windows _stat64 struct layout (x64) */
@@ -9275,15 +10303,28 @@ int __attribute__((ms_abi)) lsw_DosDateTimeToFileTime(uint16_t wFatDate, uint16_
     return 1;
 }
 
-// QueryPerformanceCounter/Frequency
+// QueryPerformanceCounter/Frequency — CLOCK_MONOTONIC at 10 MHz
 int __attribute__((ms_abi)) lsw_QueryPerformanceCounter(uint64_t* out) {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    if (out) *out = (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+    if (out) *out = win32_qpc();
     return 1;
 }
 int __attribute__((ms_abi)) lsw_QueryPerformanceFrequency(uint64_t* out) {
-    if (out) *out = 1000000ULL; // 1 MHz (matches gettimeofday resolution)
+    if (out) *out = WIN32_QPC_FREQUENCY;
+    return 1;
+}
+// Interrupt time (100 ns since boot): tick-granular from the shared page,
+// precise from the clock; "unbiased" excludes time spent suspended
+void __attribute__((ms_abi)) lsw_QueryInterruptTime(uint64_t* out) {
+    if (out) *out = win32_kuser_interrupt_time();
+}
+void __attribute__((ms_abi)) lsw_QueryInterruptTimePrecise(uint64_t* out) {
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    if (out) *out = (uint64_t)ts.tv_sec * 10000000ULL + (uint64_t)ts.tv_nsec / 100;
+}
+int __attribute__((ms_abi)) lsw_QueryUnbiasedInterruptTime(uint64_t* out) {
+    if (!out) { lsw_SetLastError(87); return 0; }
+    *out = win32_qpc(); /* QPC already counts 100 ns units of CLOCK_MONOTONIC */
     return 1;
 }
 
@@ -9553,25 +10594,113 @@ uint32_t __attribute__((ms_abi)) lsw_GetCurrentDirectoryW(uint32_t n, uint16_t*
     for (uint32_t i = 0; i <= len; i++) buf[i] = (uint16_t)(unsigned char)wcwd[i];
     return len;
 }
+/* SearchPathA — find a file in `path` or the standard search order:
+ * application directory, current directory, system and Windows
+ * directories, then PATH (split once per environment generation). */
+static int lsw_search_try(const char* dir, const char* name, char* win, size_t size) {
+    size_t n = strlen(dir);
+    int sep = n > 0 && dir[n - 1] != '\\' && dir[n - 1] != '/';
+    if ((size_t)snprintf(win, size, "%s%s%s", dir, sep ? "\\" : "", name) >= size) return 0;
+    char lpath[LSW_MAX_PATH];
+    struct stat st;
+    lsw_windows_to_linux_path(win, lpath, sizeof(lpath));
+    return stat(lpath, &st) == 0 && !S_ISDIR(st.st_mode);
+}
+
+uint32_t __attribute__((ms_abi)) lsw_SearchPathA(const char* path, const char* file, const char* ext,
+                                                 uint32_t buf_len, char* buf, char** fpart) {
+    if (!file || !file[0]) { lsw_SetLastError(87); return 0; } /* ERROR_INVALID_PARAMETER */
+
+    /* The extension applies only when the name has none */
+    char name[LSW_MAX_PATH];
+    const char* base = file;
+    for (const char* p = file; *p; p++)
+        if (*p == '\\' || *p == '/' || *p == ':') base = p + 1;
+    if ((size_t)snprintf(name, sizeof(name), "%s%s", file,
+                         (ext && !strchr(base, '.')) ? ext : "") >= sizeof(name)) {
+        lsw_SetLastError(206); return 0; /* ERROR_FILENAME_EXCED_RANGE */
+    }
+
+    char hit[LSW_MAX_PATH];
+    int found = 0;
+    int absolute = name[0] == '\\' || name[0] == '/' ||
+                   (name[0] && name[1] == ':');
+    if (absolute) {
+        found = lsw_search_try("", name, hit, sizeof(hit));
+    } else if (path) {
+        char dirs[LSW_MAX_PATH];
+        snprintf(dirs, sizeof(dirs), "%s", path);
+        char* save = NULL;
+        for (char* d = strtok_r(dirs, ";", &save); d && !found; d = strtok_r(NULL, ";", &save))
+            found = lsw_search_try(d, name, hit, sizeof(hit));
+    } else {
+        char dir[LSW_MAX_PATH];
+        if (lsw_GetModuleFileNameA(NULL, dir, sizeof(dir))) {
+            char* slash = strrchr(dir, '\\');
+            if (slash) *slash = '\0';
+            found = lsw_search_try(dir, name, hit, sizeof(hit));
+        }
+        uint32_t n;
+        if (!found && (n = lsw_GetCurrentDirectoryA(sizeof(dir), dir)) && n < sizeof(dir))
+            found = lsw_search_try(dir, name, hit, sizeof(hit));
+        if (!found && (n = lsw_GetSystemDirectoryA(dir, sizeof(dir))) && n < sizeof(dir))
+            found = lsw_search_try(dir, name, hit, sizeof(hit));
+        if (!found && (n = lsw_GetWindowsDirectoryA(dir, sizeof(dir))) && n < sizeof(dir))
+            found = lsw_search_try(dir, name, hit, sizeof(hit));
+        if (!found) {
+            char** pdirs;
+            size_t count = win32_env_path_dirs(&pdirs);
+            for (size_t i = 0; i < count && !found; i++)
+                found = lsw_search_try(pdirs[i], name, hit, sizeof(hit));
+            free(pdirs);
+        }
+    }
+    if (!found) { lsw_SetLastError(2); return 0; } /* ERROR_FILE_NOT_FOUND */
+    return lsw_GetFullPathNameA(hit, buf_len, buf, fpart);
+}
+
+uint32_t __attribute__((ms_abi)) lsw_SearchPathW(const uint16_t* path, const uint16_t* file, const uint16_t* ext,
+                                                 uint32_t buf_len, uint16_t* buf, uint16_t** fpart) {
+    if (!file) { lsw_SetLastError(87); return 0; } /* ERROR_INVALID_PARAMETER */
+    char path8[LSW_MAX_PATH], file8[LSW_MAX_PATH], ext8[64];
+    const uint16_t* in[3] = { path, file, ext };
+    char* out[3] = { path8, file8, ext8 };
+    size_t cap[3] = { sizeof(path8), sizeof(file8), sizeof(ext8) };
+    for (int i = 0; i < 3; i++) {
+        if (!in[i]) continue;
+        ptrdiff_t n = win32_utf16_to_utf8(in[i], win32_u16_len(in[i]), (uint8_t*)out[i], cap[i] - 1, 0);
+        if (n < 0) { lsw_SetLastError(206); return 0; } /* ERROR_FILENAME_EXCED_RANGE */
+        out[i][n] = '\0';
+    }
+
+    char found[LSW_MAX_PATH];
+    char* part8 = NULL;
+    uint32_t len = lsw_SearchPathA(path ? path8 : NULL, file8, ext ? ext8 : NULL,
+                                   sizeof(found), found, &part8);
+    if (len == 0 || len >= sizeof(found)) return len;
+
+    ptrdiff_t wlen = win32_utf8_to_utf16((const uint8_t*)found, len, NULL, 0, 0);
+    if (wlen < 0) return 0;
+    if (!buf || buf_len <= (uint32_t)wlen) return (uint32_t)wlen + 1;
+    win32_utf8_to_utf16((const uint8_t*)found, len, buf, (size_t)wlen, 0);
+    buf[wlen] = 0;
+    if (fpart) {
+        ptrdiff_t off = part8 ? win32_utf8_to_utf16((const uint8_t*)found, (size_t)(part8 - found), NULL, 0, 0) : -1;
+        *fpart = off >= 0 ? buf + off : NULL;
+    }
+    return (uint32_t)wlen;
+}
+/* MoveFile moves files across volumes too (MOVEFILE_COPY_ALLOWED) */
 int __attribute__((ms_abi)) lsw_MoveFileA(const char* src, const char* dst) {
-    if (!src || !dst) return 0;
-    return (rename(src, dst) == 0) ? 1 : 0;
+    return lsw_MoveFileWithProgressA(src, dst, NULL, NULL, LSW_MOVEFILE_COPY_ALLOWED);
+}
+int __attribute__((ms_abi)) lsw_MoveFileW(const uint16_t* src, const uint16_t* dst) {
+    return lsw_MoveFileWithProgressW((const wchar_t*)src, (const wchar_t*)dst, NULL, NULL,
+                                     LSW_MOVEFILE_COPY_ALLOWED);
 }
-int __attribute__((ms_abi)) lsw_MoveFileW(const uint16_t* src, const uint16_t* dst) { (void)src; (void)dst; return 0; }
 int __attribute__((ms_abi)) lsw_CopyFileA(const char* src, const char* dst, int fail_if_exists) {
-    (void)fail_if_exists;
-    if (!src || !dst) return 0;
-    int sfd = open(src, O_RDONLY);
-    if (sfd < 0) return 0;
-    int dfd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-    if (dfd < 0) { close(sfd); return 0; }
-    char buf[4096];
-    ssize_t n;
-    while ((n = read(sfd, buf, sizeof(buf))) > 0) {
-        if (write(dfd, buf, (size_t)n) != n) { close(sfd); close(dfd); return 0; }
-    }
-    close(sfd); close(dfd);
-    return 1;
+    return lsw_CopyFileExA(src, dst, NULL, NULL, NULL,
+                           fail_if_exists ? LSW_COPY_FILE_FAIL_IF_EXISTS : 0);
 }
 void* __attribute__((ms_abi)) lsw_FindFirstFileA(const char* pattern, void* data) {
     (void)pattern; (void)data;
@@ -9586,16 +10715,12 @@ size_t __attribute__((ms_abi)) lsw_HeapSize_impl(void* heap, uint32_t flags, con
     return 0;
 }
 
-// WaitForMultipleObjects (basic: loop WaitForSingleObject)
+// WaitForMultipleObjects
 uint32_t __attribute__((ms_abi)) lsw_WaitForMultipleObjects(
     uint32_t count, void** handles, int wait_all, uint32_t timeout_ms)
 {
-    (void)wait_all;
-    for (uint32_t i = 0; i < count; i++) {
-        uint32_t r = lsw_WaitForSingleObject(handles[i], timeout_ms);
-        if (r == 0) return i; // WAIT_OBJECT_0 + i
-    }
-    return 0xFFFFFFFF; // WAIT_FAILED
+    if (count == 1 && handles) return lsw_WaitForSingleObject(handles[0], timeout_ms);
+    return lsw_wait_multiple(count, handles, wait_all, timeout_ms, NULL);
 }
 
 // CreateMutexA — same as CreateMutexW but accepts ASCII name
@@ -9623,6 +10748,7 @@ int __attribute__((ms_abi)) lsw_ReleaseMutex(void* h) {
         m->owned = 0;
         m->owner = (pthread_t)0;
         pthread_mutex_unlock(&m->mutex);
+        lsw_obj_wake();
         return 1;
     }
     /* Legacy: raw pthread_mutex_t* */
@@ -9654,6 +10780,7 @@ int __attribute__((ms_abi)) lsw_ReleaseSemaphore(void* h, long count, long* prev
     if (IS_TYPED_HANDLE(s) && s->magic == LSW_SEMA_MAGIC) {
         if (prev) { int v = 0; sem_getvalue(&s->sem, &v); *prev = (long)v; }
         for (long i = 0; i < count; i++) sem_post(&s->sem);
+        lsw_obj_wake();
         return 1;
     }
     /* Legacy raw sem_t* */
@@ -9784,12 +10911,27 @@ int __attribute__((ms_abi)) lsw_CancelWaitableTimer(void* h) {
 // ---------------------------------------------------------------------------
 void* __attribute__((ms_abi)) lsw_CreateIoCompletionPort(void* file_handle, void* existing_port,
                                                            uintptr_t completion_key, uint32_t threads) {
-    (void)file_handle; (void)completion_key; (void)threads;
-    if (existing_port) return existing_port; /* associate file — we ignore it */
-    lsw_iocp_t* io = calloc(1, sizeof(lsw_iocp_t));
-    io->magic = LSW_IOCP_MAGIC;
-    pthread_mutex_init(&io->lock, NULL);
-    pipe(io->wakefd);
+    (void)threads;
+    lsw_iocp_t* io = existing_port;
+    if (io && (!IS_TYPED_HANDLE(io) || io->magic != LSW_IOCP_MAGIC)) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return NULL;
+    }
+    if (!io) {
+        io = calloc(1, sizeof(lsw_iocp_t));
+        if (!io) { lsw_SetLastError(8); return NULL; }
+        io->magic = LSW_IOCP_MAGIC;
+        pthread_mutex_init(&io->lock, NULL);
+        pipe(io->wakefd);
+    }
+    /* Associate the file: its overlapped completions are posted here
+     * (today only ReadDirectoryChangesW completes asynchronously) */
+    if (file_handle && file_handle != INVALID_HANDLE_VALUE) {
+        pthread_mutex_lock(&g_file_bind_lock);
+        lsw_file_bind_t* b = lsw_file_bind_get(file_handle, 1);
+        if (b) { b->port = io; b->key = completion_key; }
+        pthread_mutex_unlock(&g_file_bind_lock);
+    }
     return io;
 }
 
@@ -10036,12 +11178,25 @@ int __attribute__((ms_abi)) lsw__Cnd_timedwait(void* cnd, void* mtx, void* ts) {
     return 0;
 }
 
-// SetHandleInformation / GetHandleInformation (stubs)
+// SetHandleInformation / GetHandleInformation
+// HANDLE_FLAG_INHERIT (0x1) of a descriptor handle is !FD_CLOEXEC; other
+// handle kinds never reach a child and ignore it.
 int __attribute__((ms_abi)) lsw_SetHandleInformation(void* h, uint32_t mask, uint32_t flags) {
-    (void)h; (void)mask; (void)flags; return 1;
+    intptr_t fd = (intptr_t)h;
+    if (!(mask & 0x1) || IS_TYPED_HANDLE(h) || LSW_IS_PSEUDO_HANDLE(h)) return 1;
+    int fdflags = fd >= 0 ? fcntl((int)fd, F_GETFD) : -1;
+    if (fdflags < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+    fdflags = (flags & 0x1) ? fdflags & ~FD_CLOEXEC : fdflags | FD_CLOEXEC;
+    return fcntl((int)fd, F_SETFD, fdflags) == 0;
 }
 int __attribute__((ms_abi)) lsw_GetHandleInformation(void* h, uint32_t* flags) {
-    (void)h; if (flags) *flags = 0; return 1;
+    intptr_t fd = (intptr_t)h;
+    if (flags) *flags = 0;
+    if (IS_TYPED_HANDLE(h) || LSW_IS_PSEUDO_HANDLE(h)) return 1;
+    int fdflags = fd >= 0 ? fcntl((int)fd, F_GETFD) : -1;
+    if (fdflags < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+    if (flags && !(fdflags & FD_CLOEXEC)) *flags = 0x1; /* HANDLE_FLAG_INHERIT */
+    return 1;
 }
 
 // Process environment block helpers
@@ -10102,6 +11257,7 @@ int __attribute__((ms_abi)) lsw_FreeLibrary(void* hLibModule) {
     if (!hLibModule || hLibModule == LSW_SYSTEM_HMODULE) return 1;
     lsw_pe_hmodule_t* pem = (lsw_pe_hmodule_t*)hLibModule;
     if (IS_TYPED_HANDLE(pem) && pem->magic == LSW_PE_HMODULE_MAGIC) {
+        win32_ftab_remove((uint64_t)(uintptr_t)pem->image_base);
         if (pem->image_base) munmap(pem->image_base, pem->image_size);
         pem->magic = 0;
         return 1;
@@ -10249,55 +11405,61 @@ void* __attribute__((ms_abi)) lsw_TlsGetValueEx(uint32_t dwTlsIndex) {
 }
 
 // ---- CompareString ----
+#define NORM_IGNORECASE        0x00000001
+#define LINGUISTIC_IGNORECASE  0x00000010
+#define CSTR_RESULT(r) ((r) < 0 ? 1 : (r) == 0 ? 2 : 3) // CSTR_LESS_THAN=1, CSTR_EQUAL=2, CSTR_GREATER_THAN=3
+
 int __attribute__((ms_abi)) lsw_CompareStringW(uint32_t Locale, uint32_t dwCmpFlags, const uint16_t* lpString1, int cchCount1, const uint16_t* lpString2, int cchCount2) {
-    (void)Locale; (void)dwCmpFlags;
-    if (!lpString1 || !lpString2) return 0; // CSTR_ERROR
-    // Convert to narrow and compare
-    char s1[1024], s2[1024];
-    int i = 0;
-    while (lpString1[i] && (cchCount1 < 0 || i < cchCount1) && i < 1023) { s1[i]=(char)lpString1[i]; i++; } s1[i]=0;
-    i = 0;
-    while (lpString2[i] && (cchCount2 < 0 || i < cchCount2) && i < 1023) { s2[i]=(char)lpString2[i]; i++; } s2[i]=0;
-    int r;
-    if (dwCmpFlags & 0x1) // NORM_IGNORECASE
-        r = strcasecmp(s1, s2);
-    else
-        r = strcmp(s1, s2);
-    int result = (r < 0) ? 1 : (r == 0) ? 2 : 3; // CSTR_LESS_THAN=1, CSTR_EQUAL=2, CSTR_GREATER_THAN=3
-    LSW_LOG_DEBUG("CompareStringW('%s', '%s', flags=0x%x) -> %d", s1, s2, dwCmpFlags, result);
-    return result;
+    (void)Locale;
+    if (!lpString1 || !lpString2) { lsw_SetLastError(87); return 0; } // CSTR_ERROR
+    size_t n1 = cchCount1 < 0 ? win32_u16_len(lpString1) : (size_t)cchCount1;
+    size_t n2 = cchCount2 < 0 ? win32_u16_len(lpString2) : (size_t)cchCount2;
+    int ic = (dwCmpFlags & (NORM_IGNORECASE | LINGUISTIC_IGNORECASE)) != 0;
+    return CSTR_RESULT(win32_u16_collate(lpString1, n1, lpString2, n2, ic));
 }
 int __attribute__((ms_abi)) lsw_CompareStringA(uint32_t Locale, uint32_t dwCmpFlags, const char* lpString1, int cchCount1, const char* lpString2, int cchCount2) {
-    (void)Locale;
-    if (!lpString1 || !lpString2) return 0;
-    int r;
-    if (dwCmpFlags & 0x1)
-        r = strncasecmp(lpString1, lpString2, (cchCount1 < 0 || cchCount2 < 0) ? (size_t)-1 : (size_t)(cchCount1 < cchCount2 ? cchCount2 : cchCount1));
-    else
-        r = strncmp(lpString1, lpString2, (cchCount1 < 0 || cchCount2 < 0) ? (size_t)-1 : (size_t)(cchCount1 < cchCount2 ? cchCount2 : cchCount1));
-    return (r < 0) ? 1 : (r == 0) ? 2 : 3;
+    if (!lpString1 || !lpString2) { lsw_SetLastError(87); return 0; }
+    /* Widen through the ANSI code page and use the W comparison */
+    size_t n1 = cchCount1 < 0 ? strlen(lpString1) : (size_t)cchCount1;
+    size_t n2 = cchCount2 < 0 ? strlen(lpString2) : (size_t)cchCount2;
+    uint16_t stack[512];
+    uint16_t* w = n1 + n2 <= 512 ? stack : malloc((n1 + n2) * sizeof(uint16_t));
+    if (!w) { lsw_SetLastError(8); return 0; } // ERROR_NOT_ENOUGH_MEMORY
+    ptrdiff_t w1 = win32_mb_to_utf16(CP_ACP, (const uint8_t*)lpString1, n1, w, n1, 0);
+    ptrdiff_t w2 = win32_mb_to_utf16(CP_ACP, (const uint8_t*)lpString2, n2, w + n1, n2, 0);
+    int r = 0;
+    if (w1 >= 0 && w2 >= 0)
+        r = lsw_CompareStringW(Locale, dwCmpFlags, w, (int)w1, w + n1, (int)w2);
+    if (w != stack) free(w);
+    return r;
 }
 int __attribute__((ms_abi)) lsw_CompareStringEx(void* lpLocaleName, uint32_t dwCmpFlags, const uint16_t* lpString1, int cchCount1, const uint16_t* lpString2, int cchCount2, void* lpVersionInformation, void* lpReserved, int32_t lParam) {
     (void)lpLocaleName; (void)lpVersionInformation; (void)lpReserved; (void)lParam;
     return lsw_CompareStringW(0x0409, dwCmpFlags, lpString1, cchCount1, lpString2, cchCount2);
 }
 int __attribute__((ms_abi)) lsw_CompareStringOrdinal(const uint16_t* lpString1, int cchCount1, const uint16_t* lpString2, int cchCount2, int bIgnoreCase) {
-    uint32_t flags = bIgnoreCase ? 0x1 : 0x0;
-    return lsw_CompareStringW(0, flags, lpString1, cchCount1, lpString2, cchCount2);
+    if (!lpString1 || !lpString2 || cchCount1 < -1 || cchCount2 < -1) { lsw_SetLastError(87); return 0; }
+    size_t n1 = cchCount1 < 0 ? win32_u16_len(lpString1) : (size_t)cchCount1;
+    size_t n2 = cchCount2 < 0 ? win32_u16_len(lpString2) : (size_t)cchCount2;
+    int r = bIgnoreCase ? win32_u16_icmp(lpString1, n1, lpString2, n2)
+                        : win32_u16_cmp(lpString1, n1, lpString2, n2);
+    return CSTR_RESULT(r);
 }
 int __attribute__((ms_abi)) lsw_lstrcmpA(const char* lpString1, const char* lpString2) {
-    if (!lpString1 || !lpString2) return 0;
-    return strcmp(lpString1, lpString2);
+    if (!lpString1 || !lpString2) return lpString1 ? 1 : (lpString2 ? -1 : 0);
+    return lsw_CompareStringA(0, 0, lpString1, -1, lpString2, -1) - 2;
 }
 int __attribute__((ms_abi)) lsw_lstrcmpiA(const char* lpString1, const char* lpString2) {
-    if (!lpString1 || !lpString2) return 0;
-    return strcasecmp(lpString1, lpString2);
+    if (!lpString1 || !lpString2) return lpString1 ? 1 : (lpString2 ? -1 : 0);
+    return lsw_CompareStringA(0, NORM_IGNORECASE, lpString1, -1, lpString2, -1) - 2;
 }
 int __attribute__((ms_abi)) lsw_lstrcmpW(const uint16_t* lpString1, const uint16_t* lpString2) {
+    if (!lpString1 || !lpString2) return lpString1 ? 1 : (lpString2 ? -1 : 0);
     return lsw_CompareStringW(0, 0, lpString1, -1, lpString2, -1) - 2;
 }
 int __attribute__((ms_abi)) lsw_lstrcmpiW(const uint16_t* lpString1, const uint16_t* lpString2) {
-    return lsw_CompareStringW(0, 1, lpString1, -1, lpString2, -1) - 2;
+    if (!lpString1 || !lpString2) return lpString1 ? 1 : (lpString2 ? -1 : 0);
+    return lsw_CompareStringW(0, NORM_IGNORECASE, lpString1, -1, lpString2, -1) - 2;
 }
 int __attribute__((ms_abi)) lsw_lstrcpyA(char* lpString1, const char* lpString2) {
     if (lpString1 && lpString2) strcpy(lpString1, lpString2);
@@ -10395,20 +11557,140 @@ int __attribute__((ms_abi)) lsw_SetEndOfFile(void* hFile) {
     off_t pos = lseek(fd, 0, SEEK_CUR);
     return ftruncate(fd, pos) == 0 ? 1 : 0;
 }
+/* LockFile(Ex)/UnlockFile(Ex) work on raw fd handles only */
+static int lsw_lock_fd(void* hFile) {
+    if (!hFile || hFile == INVALID_HANDLE_VALUE || LSW_IS_PSEUDO_HANDLE(hFile) || IS_TYPED_HANDLE(hFile))
+        return -1;
+    return (int)(intptr_t)hFile;
+}
+
+static uint32_t lsw_lock_error(int err) {
+    switch (err) {
+    case EAGAIN:    return 33;   /* ERROR_LOCK_VIOLATION */
+    case EACCES:    return 5;    /* ERROR_ACCESS_DENIED */
+    case ENOLCK:    return 158;  /* ERROR_NOT_LOCKED */
+    case EBADF:     return 6;    /* ERROR_INVALID_HANDLE */
+    case ECANCELED: return 995;  /* ERROR_OPERATION_ABORTED */
+    case ENOMEM:    return 8;    /* ERROR_NOT_ENOUGH_MEMORY */
+    default:        return 1;    /* ERROR_INVALID_FUNCTION */
+    }
+}
+
+static uint64_t lsw_ovl_offset(const void* ovl) {
+    const uint32_t* o = (const uint32_t*)((const uint8_t*)ovl + 16);  /* Offset, OffsetHigh */
+    return (uint64_t)o[0] | ((uint64_t)o[1] << 32);
+}
+
+/* One LockFileEx waiting on an overlapped handle */
+typedef struct {
+    uint64_t*   ovl;
+    lsw_iocp_t* port;
+    uintptr_t   key;
+} lsw_lock_req_t;
+
+/* Runs on the lock waiter thread, or inline when granted at once */
+static void lsw_lock_complete(void* ctx, int err) {
+    lsw_lock_req_t* r = ctx;
+    uint64_t nt = err == 0 ? 0
+                : err == ECANCELED ? 0xC0000120ULL      /* STATUS_CANCELLED */
+                : 0xC0000055ULL;                        /* STATUS_LOCK_NOT_GRANTED */
+    r->ovl[1] = 0;
+    __atomic_store_n(&r->ovl[0], nt, __ATOMIC_RELEASE);
+
+    uintptr_t evh = *(uintptr_t*)((uint8_t*)r->ovl + 24);
+    if (evh & ~(uintptr_t)1) lsw_SetEvent((void*)(evh & ~(uintptr_t)1));
+    if (r->port && !(evh & 1)) lsw_PostQueuedCompletionStatus(r->port, 0, r->key, r->ovl);
+    free(r);
+}
+
 int __attribute__((ms_abi)) lsw_LockFile(void* hFile, uint32_t dwFileOffsetLow, uint32_t dwFileOffsetHigh, uint32_t nNumberOfBytesToLockLow, uint32_t nNumberOfBytesToLockHigh) {
-    (void)hFile; (void)dwFileOffsetLow; (void)dwFileOffsetHigh; (void)nNumberOfBytesToLockLow; (void)nNumberOfBytesToLockHigh;
-    return 1; // Stub: no-op
+    int fd = lsw_lock_fd(hFile);
+    if (fd < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+    int rc = win32_lock_range(fd, (uint64_t)dwFileOffsetHigh << 32 | dwFileOffsetLow,
+                              (uint64_t)nNumberOfBytesToLockHigh << 32 | nNumberOfBytesToLockLow,
+                              WIN32_LOCK_EXCLUSIVE);
+    if (rc) { lsw_SetLastError(lsw_lock_error(rc)); return 0; }
+    return 1;
 }
 int __attribute__((ms_abi)) lsw_UnlockFile(void* hFile, uint32_t dwFileOffsetLow, uint32_t dwFileOffsetHigh, uint32_t nNumberOfBytesToUnlockLow, uint32_t nNumberOfBytesToUnlockHigh) {
-    (void)hFile; (void)dwFileOffsetLow; (void)dwFileOffsetHigh; (void)nNumberOfBytesToUnlockLow; (void)nNumberOfBytesToUnlockHigh;
+    int fd = lsw_lock_fd(hFile);
+    if (fd < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+    int rc = win32_unlock_range(fd, (uint64_t)dwFileOffsetHigh << 32 | dwFileOffsetLow,
+                                (uint64_t)nNumberOfBytesToUnlockHigh << 32 | nNumberOfBytesToUnlockLow);
+    if (rc) { lsw_SetLastError(lsw_lock_error(rc)); return 0; }
     return 1;
 }
+
+#define LOCKFILE_FAIL_IMMEDIATELY 0x1
+#define LOCKFILE_EXCLUSIVE_LOCK   0x2
+
 int __attribute__((ms_abi)) lsw_LockFileEx(void* hFile, uint32_t dwFlags, uint32_t dwReserved, uint32_t nNumberOfBytesToLockLow, uint32_t nNumberOfBytesToLockHigh, void* lpOverlapped) {
-    (void)hFile; (void)dwFlags; (void)dwReserved; (void)nNumberOfBytesToLockLow; (void)nNumberOfBytesToLockHigh; (void)lpOverlapped;
+    if (dwReserved || !lpOverlapped || (dwFlags & ~(LOCKFILE_FAIL_IMMEDIATELY | LOCKFILE_EXCLUSIVE_LOCK))) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
+    }
+    int fd = lsw_lock_fd(hFile);
+    if (fd < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+
+    uint64_t off = lsw_ovl_offset(lpOverlapped);
+    uint64_t len = (uint64_t)nNumberOfBytesToLockHigh << 32 | nNumberOfBytesToLockLow;
+    int flags = ((dwFlags & LOCKFILE_EXCLUSIVE_LOCK) ? WIN32_LOCK_EXCLUSIVE : 0) |
+                ((dwFlags & LOCKFILE_FAIL_IMMEDIATELY) ? 0 : WIN32_LOCK_WAIT);
+    uint64_t* ovl = (uint64_t*)lpOverlapped;
+
+    lsw_lock_req_t* r = calloc(1, sizeof(*r));
+    if (!r) { lsw_SetLastError(8); return 0; } /* ERROR_NOT_ENOUGH_MEMORY */
+    r->ovl = ovl;
+    int overlapped = 0;
+    if (__atomic_load_n(&g_file_bind_count, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g_file_bind_lock);
+        lsw_file_bind_t* b = lsw_file_bind_get(hFile, 0);
+        if (b) {
+            overlapped = b->overlapped;
+            r->port = b->port;
+            r->key  = b->key;
+        }
+        pthread_mutex_unlock(&g_file_bind_lock);
+    }
+
+    /* A waiting lock on an overlapped handle completes through the
+     * OVERLAPPED; everything else settles before returning */
+    int rc;
+    if (overlapped && (flags & WIN32_LOCK_WAIT)) {
+        __atomic_store_n(&ovl[0], 0x103ULL, __ATOMIC_RELEASE); /* STATUS_PENDING */
+        rc = win32_lock_range_async(fd, off, len, flags, lsw_lock_complete, r);
+        if (rc == EINPROGRESS) {
+            lsw_SetLastError(997); /* ERROR_IO_PENDING */
+            return 0;
+        }
+    } else {
+        rc = win32_lock_range(fd, off, len, flags);
+    }
+    if (rc) {
+        free(r);
+        ovl[0] = 0xC0000055ULL; /* STATUS_LOCK_NOT_GRANTED */
+        lsw_SetLastError(lsw_lock_error(rc));
+        return 0;
+    }
+    if (overlapped) {
+        lsw_lock_complete(r, 0);
+    } else {
+        free(r);
+        ovl[0] = 0;
+        ovl[1] = 0;
+    }
     return 1;
 }
 int __attribute__((ms_abi)) lsw_UnlockFileEx(void* hFile, uint32_t dwReserved, uint32_t nNumberOfBytesToUnlockLow, uint32_t nNumberOfBytesToUnlockHigh, void* lpOverlapped) {
-    (void)hFile; (void)dwReserved; (void)nNumberOfBytesToUnlockLow; (void)nNumberOfBytesToUnlockHigh; (void)lpOverlapped;
+    if (dwReserved || !lpOverlapped) {
+        lsw_SetLastError(87); /* ERROR_INVALID_PARAMETER */
+        return 0;
+    }
+    int fd = lsw_lock_fd(hFile);
+    if (fd < 0) { lsw_SetLastError(6); return 0; } /* ERROR_INVALID_HANDLE */
+    int rc = win32_unlock_range(fd, lsw_ovl_offset(lpOverlapped),
+                                (uint64_t)nNumberOfBytesToUnlockHigh << 32 | nNumberOfBytesToUnlockLow);
+    if (rc) { lsw_SetLastError(lsw_lock_error(rc)); return 0; }
     return 1;
 }
 int __attribute__((ms_abi)) lsw_SetFilePointerEx(void* hFile, int64_t liDistanceToMove, int64_t* lpNewFilePointer, uint32_t dwMoveMethod) {
@@ -10632,6 +11914,13 @@ int __attribute__((ms_abi)) lsw_SuspendThread(void* hThread) { (void)hThread; re
 int __attribute__((ms_abi)) lsw_ResumeThread(void* hThread) {
     if (IS_TYPED_HANDLE(hThread)) {
         uint32_t magic = *(const uint32_t*)hThread;
+        if (magic == LSW_CHILD_MAGIC) {
+            lsw_child_thread_t* ct = hThread;
+            int fd = __atomic_exchange_n(&ct->resume_fd, -1, __ATOMIC_ACQ_REL);
+            win32_spawn_resume(fd);
+            LSW_LOG_INFO("ResumeThread: child pid=%d was_suspended=%d", (int)ct->pid, fd >= 0);
+            return fd >= 0 ? 1 : 0;
+        }
         if (magic == LSW_THREAD_MAGIC) {
             lsw_thread_handle_t* th = hThread;
             pthread_mutex_lock(&th->suspend_lock);
@@ -10673,12 +11962,10 @@ int __attribute__((ms_abi)) lsw_GetExitCodeThread(void* hThread, uint32_t* lpExi
 int __attribute__((ms_abi)) lsw_GetExitCodeProcess(void* hProcess, uint32_t* lpExitCode) {
     pid_t pid = (pid_t)(uintptr_t)hProcess;
     if (lpExitCode) *lpExitCode = 259; /* STILL_ACTIVE */
-    if (pid > 1 && pid < 65536) {
-        int wstatus = 0;
-        pid_t r = waitpid(pid, &wstatus, WNOHANG);
-        if (r == pid && lpExitCode) {
-            *lpExitCode = WIFEXITED(wstatus) ? (uint32_t)WEXITSTATUS(wstatus) : 1;
-        }
+    int wstatus;
+    if (pid > 1 && !IS_TYPED_HANDLE(hProcess) && lsw_child_exited(pid, 0, &wstatus) && lpExitCode) {
+        *lpExitCode = wstatus == -1 ? 0 :
+                      WIFEXITED(wstatus) ? (uint32_t)WEXITSTATUS(wstatus) : 1;
     }
     return 1;
 }
@@ -10694,17 +11981,29 @@ int __attribute__((ms_abi)) lsw_SetThreadPriority(void* hThread, int nPriority)
 int __attribute__((ms_abi)) lsw_GetThreadPriority(void* hThread) { (void)hThread; return 0; } // THREAD_PRIORITY_NORMAL
 int __attribute__((ms_abi)) lsw_SetThreadPriorityBoost(void* hThread, int DisablePriorityBoost) { (void)hThread; (void)DisablePriorityBoost; return 1; }
 uint64_t __attribute__((ms_abi)) lsw_SetThreadAffinityMask(void* hThread, uint64_t dwThreadAffinityMask) { (void)hThread; return dwThreadAffinityMask; }
-int __attribute__((ms_abi)) lsw_SleepEx(uint32_t dwMilliseconds, int bAlertable) { (void)bAlertable; usleep(dwMilliseconds * 1000); return 0; }
+/* SleepEx — alertable sleeps return WAIT_IO_COMPLETION once queued APCs have run */
+int __attribute__((ms_abi)) lsw_SleepEx(uint32_t dwMilliseconds, int bAlertable) {
+    if (!bAlertable) { lsw_apc_sleep(NULL, dwMilliseconds); return 0; }
+    lsw_apc_queue_t* q = lsw_apc_self();
+    if (lsw_apc_drain(q)) return (int)WAIT_IO_COMPLETION;
+    if (lsw_apc_sleep(q, dwMilliseconds)) {
+        lsw_apc_drain(q);
+        return (int)WAIT_IO_COMPLETION;
+    }
+    return 0;
+}
 int __attribute__((ms_abi)) lsw_SwitchToThread(void) { sched_yield(); return 1; }
 int __attribute__((ms_abi)) lsw_Beep(uint32_t dwFreq, uint32_t dwDuration) { (void)dwFreq; (void)dwDuration; return 1; }
 
 // ---- CreatePipe ----
 int __attribute__((ms_abi)) lsw_CreatePipe(void** hReadPipe, void** hWritePipe, void* lpPipeAttributes, uint32_t nSize) {
-    (void)lpPipeAttributes; (void)nSize;
+    (void)nSize;
+    /* Raw descriptors like every other file handle, so ReadFile/WriteFile
+     * and STARTF_USESTDHANDLES can use them directly */
     int pfd[2];
-    if (pipe(pfd) != 0) return 0;
-    if (hReadPipe)  *hReadPipe  = (void*)(uintptr_t)(pfd[0] + 1);
-    if (hWritePipe) *hWritePipe = (void*)(uintptr_t)(pfd[1] + 1);
+    if (pipe2(pfd, lsw_sa_inherit(lpPipeAttributes) ? 0 : O_CLOEXEC) != 0) return 0;
+    if (hReadPipe)  *hReadPipe  = (void*)(uintptr_t)pfd[0];
+    if (hWritePipe) *hWritePipe = (void*)(uintptr_t)pfd[1];
     return 1;
 }
 /*
@@ -11028,28 +12327,46 @@ static int find_pe_loader(char* out, size_t outsz) {
     return 0;
 }
 
-/* Parse command line string into argv array.
- * Handles quoted tokens.  Caller must free argv[0..n-1] and argv itself. */
+/* Split a command line the way CommandLineToArgvW does: 2n backslashes
+ * before a quote give n backslashes and toggle quoting, 2n+1 give n and
+ * a literal quote, and "" inside quotes is a literal quote.
+ * Caller must free argv[0..n-1] and argv itself. */
 static char** parse_cmdline(const char* cmdline, int* argc_out) {
     int cap = 16, cnt = 0;
     char** argv = malloc(cap * sizeof(char*));
-    if (!argv) { *argc_out = 0; return NULL; }
+    char* tok = malloc(strlen(cmdline) + 1);
+    if (!argv || !tok) { free(argv); free(tok); *argc_out = 0; return NULL; }
     const char* p = cmdline;
-    while (*p) {
+    for (;;) {
         while (*p == ' ' || *p == '\t') p++;
         if (!*p) break;
-        char tok[4096]; int ti = 0;
-        if (*p == '"') {
-            p++;
-            while (*p && *p != '"') tok[ti++] = *p++;
-            if (*p == '"') p++;
-        } else {
-            while (*p && *p != ' ' && *p != '\t') tok[ti++] = *p++;
+        size_t ti = 0;
+        int quoted = 0;
+        while (*p && (quoted || (*p != ' ' && *p != '\t'))) {
+            if (*p == '\\') {
+                size_t n = 0;
+                while (*p == '\\') { n++; p++; }
+                size_t keep = *p == '"' ? n / 2 : n;
+                memset(tok + ti, '\\', keep);
+                ti += keep;
+                if (*p == '"' && (n & 1)) { tok[ti++] = '"'; p++; }
+            } else if (*p == '"') {
+                p++;
+                if (quoted && *p == '"') { tok[ti++] = '"'; p++; }
+                else quoted = !quoted;
+            } else {
+                tok[ti++] = *p++;
+            }
         }
         tok[ti] = '\0';
-        if (cnt >= cap-1) { cap *= 2; argv = realloc(argv, cap * sizeof(char*)); }
+        if (cnt >= cap - 1) {
+            char** grown = realloc(argv, (size_t)(cap *= 2) * sizeof(char*));
+            if (!grown) break;
+            argv = grown;
+        }
         argv[cnt++] = strdup(tok);
     }
+    free(tok);
     argv[cnt] = NULL;
     *argc_out = cnt;
     return argv;
@@ -11063,98 +12380,140 @@ typedef struct {
     uint32_t dwThreadId;
 } PROCESS_INFORMATION_t;
 
-int __attribute__((ms_abi)) lsw_CreateProcessA(
-    const char* lpApplicationName, char* lpCommandLine,
-    void* lpProcessAttributes, void* lpThreadAttributes,
-    int bInheritHandles, uint32_t dwCreationFlags,
-    void* lpEnvironment, const char* lpCurrentDirectory,
-    void* lpStartupInfo, void* lpProcessInformation)
-{
-    (void)lpProcessAttributes; (void)lpThreadAttributes;
-    (void)bInheritHandles; (void)dwCreationFlags;
-    (void)lpEnvironment; (void)lpStartupInfo;
-
-    if (lpProcessInformation) memset(lpProcessInformation, 0, sizeof(PROCESS_INFORMATION_t));
-
-    /* Determine EXE path */
-    char exe_win[1024] = {0};
-    if (lpApplicationName && *lpApplicationName) {
-        strncpy(exe_win, lpApplicationName, sizeof(exe_win)-1);
-    } else if (lpCommandLine && *lpCommandLine) {
-        /* Extract first token */
-        int argc = 0;
-        char** av = parse_cmdline(lpCommandLine, &argc);
-        if (argc > 0) { strncpy(exe_win, av[0], sizeof(exe_win)-1); free(av[0]); }
-        for (int i = 1; i < argc; i++) free(av[i]);
-        free(av);
-    }
-    if (!exe_win[0]) {
-        LSW_LOG_ERROR("CreateProcessA: no executable specified");
-        return 0;
+#define CREATE_SUSPENDED            0x00000004
+#define CREATE_UNICODE_ENVIRONMENT  0x00000400
+#define STARTF_USESTDHANDLES        0x00000100
+
+/* Descriptor behind a STARTUPINFO standard handle */
+static int lsw_spawn_std_fd(void* h) {
+    int pfd = lsw_pseudo_handle_to_fd(h);
+    if (pfd >= 0) return pfd;
+    if (!h || h == INVALID_HANDLE_VALUE) return WIN32_SPAWN_NULL;
+    if (IS_TYPED_HANDLE(h)) {
+        int fd = pipe_handle_fd(h);
+        return fd >= 0 ? fd : WIN32_SPAWN_NULL;
     }
+    return (int)(intptr_t)h;
+}
 
-    char exe_linux[1024];
-    createprocess_win_to_linux(exe_win, exe_linux, sizeof(exe_linux));
-    LSW_LOG_INFO("CreateProcessA: launching %s (linux: %s)", exe_win, exe_linux);
+/* CreateProcessA/W with the strings in UTF-8. The child is the loader:
+ *   lsw-pe-loader --launch <exe> -- <args after argv[0]> */
+static int lsw_create_process(const char* app, const char* cmdline, int inherit, uint32_t flags,
+                              const void* env_block, const char* cwd,
+                              const void* si, PROCESS_INFORMATION_t* pi)
+{
+    if (pi) memset(pi, 0, sizeof(*pi));
 
-    /* Find pe-loader */
+    int ntok = 0;
+    char** tok = parse_cmdline(cmdline ? cmdline : "", &ntok);
+    const char* exe_win = app && *app ? app : ntok > 0 ? tok[0] : NULL;
     char loader[512];
-    if (!find_pe_loader(loader, sizeof(loader))) {
-        LSW_LOG_ERROR("CreateProcessA: lsw-pe-loader not found");
-        return 0;
+    char exe_linux[1024], cwd_linux[1024];
+    char** argv = NULL;
+    char** envp = NULL;
+    int ok = 0;
+
+    if (!tok || !exe_win) {
+        LSW_LOG_ERROR("CreateProcess: no executable specified");
+        lsw_SetLastError(tok ? 2 : 8); /* ERROR_FILE_NOT_FOUND / ERROR_NOT_ENOUGH_MEMORY */
+        goto out;
     }
+    createprocess_win_to_linux(exe_win, exe_linux, sizeof(exe_linux));
+    LSW_LOG_INFO("CreateProcess: launching %s (linux: %s)", exe_win, exe_linux);
 
-    /* Build argv for pe-loader: lsw-pe-loader --launch <exe> [args...] */
-    char* child_argv[64];
-    int ci = 0;
-    child_argv[ci++] = loader;
-    child_argv[ci++] = "--launch";
-    child_argv[ci++] = exe_linux;
-    /* Pass remaining args from lpCommandLine if application name was separate */
-    char** extra = NULL; int extra_cnt = 0;
-    if (lpApplicationName && lpCommandLine) {
-        extra = parse_cmdline(lpCommandLine, &extra_cnt);
-        /* skip first token if it matches application name */
-        int start = 0;
-        if (extra_cnt > 0 && strcasecmp(extra[0], lpApplicationName) == 0) start = 1;
-        for (int i = start; i < extra_cnt && ci < 62; i++)
-            child_argv[ci++] = extra[i];
-    } else if (!lpApplicationName && lpCommandLine) {
-        /* cmdline only: extra args start at index 1 (after exe name) */
-        extra = parse_cmdline(lpCommandLine, &extra_cnt);
-        for (int i = 1; i < extra_cnt && ci < 62; i++)
-            child_argv[ci++] = extra[i];
-    }
-    child_argv[ci] = NULL;
-
-    /* Change working directory in child if requested */
-    char cwd_linux[1024] = {0};
-    if (lpCurrentDirectory)
-        createprocess_win_to_linux(lpCurrentDirectory, cwd_linux, sizeof(cwd_linux));
-
-    pid_t pid = fork();
-    if (pid < 0) {
-        LSW_LOG_ERROR("CreateProcessA: fork failed: %s", strerror(errno));
-        if (extra) { for (int i = 0; i < extra_cnt; i++) free(extra[i]); free(extra); }
-        return 0;
+    if (!find_pe_loader(loader, sizeof(loader))) {
+        LSW_LOG_ERROR("CreateProcess: lsw-pe-loader not found");
+        lsw_SetLastError(2); /* ERROR_FILE_NOT_FOUND */
+        goto out;
+    }
+
+    argv = malloc((size_t)(ntok + 5) * sizeof(char*));
+    if (env_block) envp = win32_env_linux(env_block, (flags & CREATE_UNICODE_ENVIRONMENT) != 0);
+    if (!argv || (env_block && !envp)) {
+        lsw_SetLastError(8); /* ERROR_NOT_ENOUGH_MEMORY */
+        goto out;
+    }
+    int ai = 0;
+    argv[ai++] = loader;
+    argv[ai++] = "--launch";
+    argv[ai++] = exe_linux;
+    argv[ai++] = "--";
+    for (int i = 1; i < ntok; i++) argv[ai++] = tok[i];   /* tok[0] is the child's argv[0] */
+    argv[ai] = NULL;
+
+    win32_spawn_t sp = {
+        .path = loader, .argv = argv, .envp = envp,
+        .std_fd = { WIN32_SPAWN_KEEP, WIN32_SPAWN_KEEP, WIN32_SPAWN_KEEP },
+        .inherit = inherit,
+        .suspended = (flags & CREATE_SUSPENDED) != 0,
+    };
+    if (cwd) {
+        createprocess_win_to_linux(cwd, cwd_linux, sizeof(cwd_linux));
+        sp.cwd = cwd_linux;
+    }
+    /* STARTUPINFO: dwFlags at 60, hStdInput/Output/Error at 80/88/96 */
+    if (si && (*(const uint32_t*)((const char*)si + 60) & STARTF_USESTDHANDLES)) {
+        for (int i = 0; i < 3; i++)
+            sp.std_fd[i] = lsw_spawn_std_fd(*(void* const*)((const char*)si + 80 + 8 * i));
+    }
+
+    pid_t pid;
+    int resume_fd;
+    int err = win32_spawn(&sp, &pid, &resume_fd);
+    if (err) {
+        LSW_LOG_ERROR("CreateProcess: spawn failed: %s", strerror(err));
+        /* ERROR_FILE_NOT_FOUND, ERROR_ACCESS_DENIED, else ERROR_NOT_ENOUGH_MEMORY */
+        lsw_SetLastError(err == ENOENT ? 2 : err == EACCES ? 5 : 8);
+        goto out;
+    }
+    LSW_LOG_INFO("CreateProcess: child PID=%d%s", (int)pid, sp.suspended ? " (suspended)" : "");
+
+    lsw_child_thread_t* ct = pi ? calloc(1, sizeof(*ct)) : NULL;
+    if (ct) {
+        ct->magic = LSW_CHILD_MAGIC;
+        ct->pid = pid;
+        ct->resume_fd = resume_fd;
+    } else {
+        win32_spawn_resume(resume_fd);  /* nobody could resume it */
     }
-    if (pid == 0) {
-        /* Child */
-        if (cwd_linux[0]) chdir(cwd_linux);
-        execv(loader, child_argv);
-        _exit(127); /* exec failed */
-    }
-    /* Parent */
-    if (extra) { for (int i = 0; i < extra_cnt; i++) free(extra[i]); free(extra); }
-    LSW_LOG_INFO("CreateProcessA: child PID=%d", (int)pid);
-    if (lpProcessInformation) {
-        PROCESS_INFORMATION_t* pi = (PROCESS_INFORMATION_t*)lpProcessInformation;
-        pi->hProcess   = (void*)(uintptr_t)(uint64_t)pid;
-        pi->hThread    = (void*)(uintptr_t)1;
+    if (pi) {
+        pi->hProcess    = (void*)(uintptr_t)(uint64_t)pid;
+        pi->hThread     = ct;
         pi->dwProcessId = (uint32_t)pid;
-        pi->dwThreadId  = 1;
+        pi->dwThreadId  = (uint32_t)pid;
     }
-    return 1;
+    ok = 1;
+
+out:
+    if (tok) { for (int i = 0; i < ntok; i++) free(tok[i]); free(tok); }
+    free(argv);
+    free(envp);
+    return ok;
+}
+
+int __attribute__((ms_abi)) lsw_CreateProcessA(
+    const char* lpApplicationName, char* lpCommandLine,
+    void* lpProcessAttributes, void* lpThreadAttributes,
+    int bInheritHandles, uint32_t dwCreationFlags,
+    void* lpEnvironment, const char* lpCurrentDirectory,
+    void* lpStartupInfo, void* lpProcessInformation)
+{
+    (void)lpProcessAttributes; (void)lpThreadAttributes;
+    return lsw_create_process(lpApplicationName, lpCommandLine, bInheritHandles, dwCreationFlags,
+                              lpEnvironment, lpCurrentDirectory, lpStartupInfo,
+                              (PROCESS_INFORMATION_t*)lpProcessInformation);
+}
+
+/* UTF-8 copy of a UTF-16 string; NULL for NULL or out of memory */
+static char* lsw_utf16_dup_utf8(const uint16_t* w) {
+    if (!w) return NULL;
+    size_t len = win32_u16_len(w);
+    ptrdiff_t n = win32_utf16_to_utf8(w, len, NULL, 0, 0);
+    char* s = n >= 0 ? malloc((size_t)n + 1) : NULL;
+    if (!s) return NULL;
+    win32_utf16_to_utf8(w, len, (uint8_t*)s, (size_t)n, 0);
+    s[n] = '\0';
+    return s;
 }
 
 int __attribute__((ms_abi)) lsw_CreateProcessW(
@@ -11164,23 +12523,22 @@ int __attribute__((ms_abi)) lsw_CreateProcessW(
     void* lpEnvironment, const uint16_t* lpCurrentDirectory,
     void* lpStartupInfo, void* lpProcessInformation)
 {
-    /* Convert wide strings to narrow, then delegate */
-    char appA[1024] = {0}, cmdA[4096] = {0}, cwdA[1024] = {0};
-    if (lpApplicationName)
-        for (int i = 0; lpApplicationName[i] && i < 1023; i++) appA[i] = (char)lpApplicationName[i];
-    if (lpCommandLine)
-        for (int i = 0; lpCommandLine[i] && i < 4095; i++) cmdA[i] = (char)lpCommandLine[i];
-    if (lpCurrentDirectory)
-        for (int i = 0; lpCurrentDirectory[i] && i < 1023; i++) cwdA[i] = (char)lpCurrentDirectory[i];
-    LSW_LOG_DEBUG("CreateProcessW: appA='%s' cmdA='%s'", appA[0]?appA:"(null)", cmdA[0]?cmdA:"(null)");
-    return lsw_CreateProcessA(
-        appA[0] ? appA : NULL,
-        cmdA[0] ? cmdA : NULL,
-        lpProcessAttributes, lpThreadAttributes,
-        bInheritHandles, dwCreationFlags,
-        lpEnvironment,
-        cwdA[0] ? cwdA : NULL,
-        lpStartupInfo, lpProcessInformation);
+    (void)lpProcessAttributes; (void)lpThreadAttributes;
+    char* app = lsw_utf16_dup_utf8(lpApplicationName);
+    char* cmd = lsw_utf16_dup_utf8(lpCommandLine);
+    char* cwd = lsw_utf16_dup_utf8(lpCurrentDirectory);
+    int ok = 0;
+    if ((lpApplicationName && !app) || (lpCommandLine && !cmd) || (lpCurrentDirectory && !cwd)) {
+        lsw_SetLastError(8); /* ERROR_NOT_ENOUGH_MEMORY */
+    } else {
+        LSW_LOG_DEBUG("CreateProcessW: app='%s' cmd='%s'", app ? app : "(null)", cmd ? cmd : "(null)");
+        ok = lsw_create_process(app, cmd, bInheritHandles, dwCreationFlags, lpEnvironment, cwd,
+                                lpStartupInfo, (PROCESS_INFORMATION_t*)lpProcessInformation);
+    }
+    free(app);
+    free(cmd);
+    free(cwd);
+    return ok;
 }
 
 // ---- Symbolic/Hard links ----
@@ -11270,21 +12628,101 @@ uint32_t __attribute__((ms_abi)) lsw_GetTimeZoneInformation(void* lpTimeZoneInfo
 }
 
 // ---- Overlapped I/O ----
+/* Result from OVERLAPPED.Internal (NTSTATUS) / InternalHigh (bytes).
+ * STATUS_PENDING means the operation is still outstanding. */
 int __attribute__((ms_abi)) lsw_GetOverlappedResult(void* hFile, void* lpOverlapped, uint32_t* lpNumberOfBytesTransferred, int bWait) {
-    (void)hFile; (void)lpOverlapped; (void)bWait;
-    if (lpNumberOfBytesTransferred) *lpNumberOfBytesTransferred = 0;
+    (void)hFile;
+    if (!lpOverlapped) { lsw_SetLastError(ERROR_INVALID_PARAMETER); return 0; }
+    uint64_t* o = lpOverlapped;
+    if (__atomic_load_n(&o[0], __ATOMIC_ACQUIRE) == 0x103) {
+        if (!bWait) { lsw_SetLastError(996); return 0; } /* ERROR_IO_INCOMPLETE */
+        /* Short timed waits: the INFINITE event wait is capped and would
+         * force-signal an operation that is legitimately still pending. */
+        void* ev = (void*)(*(uintptr_t*)((uint8_t*)lpOverlapped + 24) & ~(uintptr_t)1);
+        while (__atomic_load_n(&o[0], __ATOMIC_ACQUIRE) == 0x103) {
+            if (ev) {
+                lsw_wait_object(ev, 50, NULL);
+            } else {
+                struct timespec ts = { 0, 1000000L };
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+    uint64_t status = __atomic_load_n(&o[0], __ATOMIC_ACQUIRE);
+    if (lpNumberOfBytesTransferred) *lpNumberOfBytesTransferred = (uint32_t)o[1];
+    if (status == 0) return 1;
+    if (status == 0x10C) { lsw_SetLastError(1022); return 1; } /* STATUS_NOTIFY_ENUM_DIR */
+    lsw_SetLastError(status == 0xC0000120ULL ? 995 /* ERROR_OPERATION_ABORTED */
+                   : status == 0xC0000011ULL ? 38  /* ERROR_HANDLE_EOF */
+                                             : 31  /* ERROR_GEN_FAILURE */);
     return 0;
 }
+/* ReadFileEx / WriteFileEx — the I/O itself completes synchronously (at the
+ * OVERLAPPED offset for seekable fds); the completion routine is queued as
+ * an APC and runs in the caller's next alertable wait, as on Windows. */
+static int lsw_queue_io_completion(void* routine, uint32_t error, uint32_t bytes, void* ovl) {
+    if (ovl) {
+        /* Internal = NTSTATUS */
+        ((uint64_t*)ovl)[0] = error == 38 ? 0xC0000011ULL /* STATUS_END_OF_FILE */
+                            : error       ? 0xC0000001ULL /* STATUS_UNSUCCESSFUL */
+                            : 0;
+        ((uint64_t*)ovl)[1] = bytes;                      /* InternalHigh */
+    }
+    lsw_apc_queue_t* q = lsw_apc_self();
+    lsw_apc_t* a = q ? calloc(1, sizeof(*a)) : NULL;
+    if (!a) { lsw_SetLastError(8); return 0; }
+    a->kind  = LSW_APC_IO;
+    a->fn    = routine;
+    a->data  = (uintptr_t)ovl;
+    a->error = error;
+    a->bytes = bytes;
+    lsw_apc_enqueue(q, a);
+    return 1;
+}
+
+/* OVERLAPPED.Offset/OffsetHigh → file offset, or -1 for non-seekable fds */
+static off_t lsw_overlapped_offset(void* hFile, void* ovl) {
+    if (!ovl || IS_TYPED_HANDLE(hFile) || LSW_IS_PSEUDO_HANDLE(hFile)) return -1;
+    struct stat st;
+    if (fstat((int)(intptr_t)hFile, &st) != 0 || !S_ISREG(st.st_mode)) return -1;
+    const uint32_t* o = (const uint32_t*)((const uint8_t*)ovl + 16);
+    return (off_t)(((uint64_t)o[1] << 32) | o[0]);
+}
+
 int __attribute__((ms_abi)) lsw_ReadFileEx(void* hFile, void* lpBuffer, uint32_t nNumberOfBytesToRead, void* lpOverlapped, void* lpCompletionRoutine) {
-    (void)lpOverlapped; (void)lpCompletionRoutine;
-    return lsw_ReadFile(hFile, lpBuffer, nNumberOfBytesToRead, NULL, NULL);
+    if (!lpCompletionRoutine) { lsw_SetLastError(ERROR_INVALID_PARAMETER); return 0; }
+    uint32_t got = 0, err = 0;
+    off_t off = lsw_overlapped_offset(hFile, lpOverlapped);
+    if (off >= 0) {
+        ssize_t r = pread((int)(intptr_t)hFile, lpBuffer, nNumberOfBytesToRead, off);
+        if (r < 0) { lsw_SetLastError(ERROR_INVALID_HANDLE); return 0; }
+        got = (uint32_t)r;
+        if (r == 0 && nNumberOfBytesToRead) err = 38; /* ERROR_HANDLE_EOF */
+    } else if (!lsw_ReadFile(hFile, lpBuffer, nNumberOfBytesToRead, &got, NULL)) {
+        return 0;
+    }
+    return lsw_queue_io_completion(lpCompletionRoutine, err, got, lpOverlapped);
 }
 int __attribute__((ms_abi)) lsw_WriteFileEx(void* hFile, const void* lpBuffer, uint32_t nNumberOfBytesToWrite, void* lpOverlapped, void* lpCompletionRoutine) {
-    (void)lpOverlapped; (void)lpCompletionRoutine;
-    return lsw_WriteFile(hFile, lpBuffer, nNumberOfBytesToWrite, NULL, NULL);
+    if (!lpCompletionRoutine) { lsw_SetLastError(ERROR_INVALID_PARAMETER); return 0; }
+    uint32_t put = 0;
+    off_t off = lsw_overlapped_offset(hFile, lpOverlapped);
+    if (off >= 0) {
+        ssize_t r = pwrite((int)(intptr_t)hFile, lpBuffer, nNumberOfBytesToWrite, off);
+        if (r < 0) { lsw_SetLastError(ERROR_INVALID_HANDLE); return 0; }
+        put = (uint32_t)r;
+    } else if (!lsw_WriteFile(hFile, lpBuffer, nNumberOfBytesToWrite, &put, NULL)) {
+        return 0;
+    }
+    return lsw_queue_io_completion(lpCompletionRoutine, 0, put, lpOverlapped);
+}
+/* Only ReadDirectoryChangesW can be outstanding; other I/O completed inline */
+int __attribute__((ms_abi)) lsw_CancelIo(void* hFile) { lsw_cancel_pending_io(hFile); return 1; }
+int __attribute__((ms_abi)) lsw_CancelIoEx(void* hFile, void* lpOverlapped) {
+    (void)lpOverlapped;
+    if (!lsw_cancel_pending_io(hFile)) { lsw_SetLastError(1168); return 0; } /* ERROR_NOT_FOUND */
+    return 1;
 }
-int __attribute__((ms_abi)) lsw_CancelIo(void* hFile) { (void)hFile; return 1; }
-int __attribute__((ms_abi)) lsw_CancelIoEx(void* hFile, void* lpOverlapped) { (void)hFile; (void)lpOverlapped; return 1; }
 int __attribute__((ms_abi)) lsw_CancelSynchronousIo(void* hThread) { (void)hThread; return 1; }
 
 // ---- Memory extras ----
@@ -11414,26 +12852,8 @@ typedef struct {
 static uint64_t lsw_get_frame_seh_handler(lsw_RUNTIME_FUNCTION* rf,
                                            void** handler_data_out)
 {
-    uint8_t* ui = (uint8_t*)lsw_rva2va(rf->UnwindData);
-    if (!ui) return 0;
-    for (int d = 0; d < 8; d++) {
-        uint8_t  flags     = (ui[0] >> 3) & 0x1Fu;
-        uint8_t  code_cnt  = ui[2];
-        int      codes_sz  = (int)(((code_cnt + 1) & ~1) * 2);
-        if (flags & UNW_FLAG_CHAININFO) {
-            lsw_RUNTIME_FUNCTION* chain = (lsw_RUNTIME_FUNCTION*)(ui + 4 + codes_sz);
-            ui = (uint8_t*)lsw_rva2va(chain->UnwindData);
-            if (!ui) return 0;
-            continue;
-        }
-        if (!(flags & (UNW_FLAG_EHANDLER | UNW_FLAG_UHANDLER))) return 0;
-        uint32_t* after    = (uint32_t*)(ui + 4 + codes_sz);
-        uint32_t  hrva     = after[0];
-        if (!hrva) return 0;
-        if (handler_data_out) *handler_data_out = &after[1];
-        return g_lsw_image_base + (uint64_t)hrva;
-    }
-    return 0;
+    return win32_unwind_handler(tls_eh_base, (const win32_runtime_function_t*)rf,
+                                NULL, handler_data_out);
 }
 
 void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32_t dwExceptionFlags, uint32_t nNumberOfArguments, const uint64_t* lpArguments) {
@@ -11488,13 +12908,17 @@ void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32
      * This handles PE code that has inlined _CxxThrowException and calls RaiseException
      * directly.  We reconstruct the PE caller's frame from the RBP chain, using the
      * same approach as lsw__CxxThrowException. */
-    if (dwExceptionCode == 0xe06d7363 && g_lsw_pdata_va && g_lsw_image_base && lpArguments) {
+    if (dwExceptionCode == 0xe06d7363 && lpArguments) {
         void* exc_obj    = (nNumberOfArguments >= 2) ? (void*)(uintptr_t)lpArguments[1] : NULL;
         void* throw_info = (nNumberOfArguments >= 3) ? (void*)(uintptr_t)lpArguments[2] : NULL;
+        /* x64 throws pass the throwing image's base as the fourth argument */
+        uint64_t throw_base = (nNumberOfArguments >= 4 && lpArguments[3]) ? lpArguments[3]
+                            : win32_ftab_image((uint64_t)(uintptr_t)throw_info, NULL);
+        if (!throw_base) throw_base = g_lsw_image_base;
 
         /* If throw_info looks like a small RVA (< 16 MB, not a VA), convert it */
         if ((uint64_t)(uintptr_t)throw_info < 0x1000000ULL && throw_info) {
-            throw_info = (void*)(uintptr_t)(g_lsw_image_base + (uint64_t)(uintptr_t)throw_info);
+            throw_info = (void*)(uintptr_t)(throw_base + (uint64_t)(uintptr_t)throw_info);
             LSW_LOG_INFO("[exception] RaiseException: throw_info was RVA, VA=0x%llx",
                          (unsigned long long)(uintptr_t)throw_info);
         }
@@ -11533,8 +12957,7 @@ void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32
                  * bypassing the catch funclet frame entirely. */
                 uint64_t outer_entry_rsp = tls_cxx_exception_entry_rsp;
                 uint64_t outer_rip = *(uint64_t*)outer_entry_rsp;
-                if (outer_rip >= g_lsw_image_base &&
-                    outer_rip < g_lsw_image_base + 0x10000000ULL) {
+                if (win32_ftab_lookup(outer_rip - 1, NULL, NULL)) {
                     rip      = outer_rip - 1;
                     body_rsp = outer_entry_rsp + 8;
                     LSW_LOG_INFO("[exception] RaiseException re-throw: outer walk from "
@@ -11547,6 +12970,7 @@ void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32
             /* New exception — store to TLS */
             tls_cxx_exception_obj  = exc_obj;
             tls_cxx_exception_type = throw_info;
+            lsw_set_throw_image(throw_base);
             /* Save original exception args for later re-throw exc_rec reconstruction */
             tls_cxx_exc_code  = dwExceptionCode;
             tls_cxx_exc_flags = dwExceptionFlags;
@@ -11558,12 +12982,6 @@ void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32
 
         /* Walk the PE call stack looking for a matching catch handler */
         for (int depth = 0; depth < 128; depth++) {
-            if (rip < g_lsw_image_base || rip >= g_lsw_image_base + 0x10000000ULL) {
-                LSW_LOG_WARN("[exception] RaiseException: RIP 0x%llx outside PE, stop walk",
-                             (unsigned long long)rip);
-                break;
-            }
-
             lsw_RUNTIME_FUNCTION* rf = lsw_find_rf(rip);
             if (!rf) {
                 LSW_LOG_WARN("[exception] RaiseException: no RUNTIME_FUNCTION for RIP 0x%llx depth=%d",
@@ -11688,7 +13106,7 @@ void __attribute__((ms_abi)) lsw_RaiseException(uint32_t dwExceptionCode, uint32
                 lsw_DISPATCHER_CONTEXT dc;
                 memset(&dc, 0, sizeof(dc));
                 dc.ControlPc        = rip + 1;
-                dc.ImageBase        = g_lsw_image_base;
+                dc.ImageBase        = tls_eh_base;
                 dc.FunctionEntry    = rf;
                 dc.EstablisherFrame = body_rsp; /* NativeAOT reads [EstablisherFrame+offset] = cookie; cookie stored at body_rsp+offset */
                 dc.TargetIp         = 0;   /* search phase */
@@ -11789,20 +13207,23 @@ int __attribute__((ms_abi)) lsw_RemoveDirectoryA(const char* lpPathName) {
  * These are needed for .NET 8 self-contained apps
  * ============================================================ */
 
-/* VEH — Vectored Exception Handler. CLR needs a non-NULL handle back. */
+/* VEH — Vectored Exception Handler.  Handlers run from the fault signal
+ * handler (win32_fault.c); the handle is an opaque registration id. */
 void* __attribute__((ms_abi)) lsw_AddVectoredExceptionHandler(uint32_t first, void* handler) {
-    (void)first; (void)handler;
-    return (void*)0x1; /* non-NULL fake handle */
+    void* handle = win32_veh_add(0, first != 0, handler);
+    if (!handle) lsw_SetLastError(8); /* ERROR_NOT_ENOUGH_MEMORY */
+    return handle;
 }
 uint32_t __attribute__((ms_abi)) lsw_RemoveVectoredExceptionHandler(void* handle) {
-    (void)handle; return 1;
+    return win32_veh_remove(0, handle) == 0;
 }
 void* __attribute__((ms_abi)) lsw_AddVectoredContinueHandler(uint32_t first, void* handler) {
-    (void)first; (void)handler;
-    return (void*)0x1;
+    void* handle = win32_veh_add(1, first != 0, handler);
+    if (!handle) lsw_SetLastError(8); /* ERROR_NOT_ENOUGH_MEMORY */
+    return handle;
 }
 uint32_t __attribute__((ms_abi)) lsw_RemoveVectoredContinueHandler(void* handle) {
-    (void)handle; return 1;
+    return win32_veh_remove(1, handle) == 0;
 }
 
 /* SLIST (singly-linked interlocked list) — used heavily by .NET CLR */
@@ -11895,16 +13316,52 @@ int __attribute__((ms_abi)) lsw_GetStringTypeA(uint32_t locale, uint32_t dwInfoT
     return 1;
 }
 
-/* QueueUserAPC — stub (no APC queue) */
+/* Resolve a thread handle to its APC queue (NULL if it has none) */
+static lsw_apc_queue_t* lsw_apc_queue_of(void* hThread) {
+    if (hThread == (void*)(uintptr_t)0xFFFFFFFFFFFFFFFEULL) /* GetCurrentThread() */
+        return lsw_apc_self();
+    if (IS_TYPED_HANDLE(hThread) && *(const uint32_t*)hThread == LSW_THREAD_MAGIC)
+        return ((lsw_thread_handle_t*)hThread)->apc;
+    return NULL;
+}
+
+/* QueueUserAPC — queue pfnAPC(dwData) to run in hThread's next alertable wait */
 uint32_t __attribute__((ms_abi)) lsw_QueueUserAPC(void* pfnAPC, void* hThread, uintptr_t dwData) {
-    (void)pfnAPC; (void)hThread; (void)dwData;
-    return 0; /* not queued */
+    lsw_apc_queue_t* q = hThread ? lsw_apc_queue_of(hThread) : NULL;
+    if (!pfnAPC || !q) {
+        lsw_SetLastError(ERROR_INVALID_HANDLE);
+        return 0;
+    }
+    lsw_apc_t* a = calloc(1, sizeof(*a));
+    if (!a) { lsw_SetLastError(8); return 0; } /* ERROR_NOT_ENOUGH_MEMORY */
+    a->kind = LSW_APC_USER;
+    a->fn   = pfnAPC;
+    a->data = dwData;
+    if (!lsw_apc_enqueue(q, a)) {
+        free(a);
+        lsw_SetLastError(ERROR_INVALID_HANDLE);
+        return 0;
+    }
+    return 1;
 }
 
-/* SignalObjectAndWait — atomically signal obj1 then wait on obj2 */
+/* SignalObjectAndWait — signal obj1 (event/mutex/semaphore) then wait on obj2 */
 uint32_t __attribute__((ms_abi)) lsw_SignalObjectAndWait(void* hObjectToSignal, void* hObjectToWaitOn, uint32_t dwMilliseconds, int bAlertable) {
-    (void)hObjectToSignal; (void)hObjectToWaitOn; (void)dwMilliseconds; (void)bAlertable;
-    return 0; /* WAIT_OBJECT_0 */
+    if (!hObjectToSignal || !IS_TYPED_HANDLE(hObjectToSignal)) {
+        lsw_SetLastError(ERROR_INVALID_HANDLE);
+        return 0xFFFFFFFF; /* WAIT_FAILED */
+    }
+    uint32_t magic = *(const uint32_t*)hObjectToSignal;
+    int ok;
+    if (magic == LSW_EVENT_MAGIC)      ok = lsw_SetEvent(hObjectToSignal);
+    else if (magic == LSW_MUTEX_MAGIC) ok = lsw_ReleaseMutex(hObjectToSignal);
+    else if (magic == LSW_SEMA_MAGIC)  ok = lsw_ReleaseSemaphore(hObjectToSignal, 1, NULL);
+    else                               ok = 0;
+    if (!ok) {
+        lsw_SetLastError(ERROR_INVALID_HANDLE);
+        return 0xFFFFFFFF;
+    }
+    return lsw_WaitForSingleObjectEx(hObjectToWaitOn, dwMilliseconds, bAlertable);
 }
 
 /* LocateXStateFeature — extended processor state (XSAVE). Return NULL = not supported */
@@ -11933,52 +13390,24 @@ int __attribute__((ms_abi)) lsw_GetStringTypeW_alias(uint32_t t, const uint16_t*
 
 /* GetEnvironmentStringsW — returns pointer to null-terminated environment block.
  * .NET CLR reads this at startup to build its environment. NULL return = crash.
- * We build a UTF-16 env block from our actual process environment. */
-static uint16_t* g_env_block_w = NULL;
-static void lsw_build_env_block_w(void) {
-    extern char **environ;
-    size_t total = 1; /* final empty string */
-    for (char **e = environ; *e; e++) {
-        size_t l = strlen(*e) + 1;
-        total += l;
-    }
-    g_env_block_w = (uint16_t*)malloc(total * sizeof(uint16_t));
-    if (!g_env_block_w) return;
-    uint16_t *p = g_env_block_w;
-    for (char **e = environ; *e; e++) {
-        const char *s = *e;
-        while (*s) *p++ = (uint16_t)(unsigned char)*s++;
-        *p++ = 0;
-    }
-    *p = 0; /* double-null terminator */
-}
+ * Each call gets its own copy of the block cached for the current
+ * environment generation; FreeEnvironmentStrings releases it. */
 uint16_t* __attribute__((ms_abi)) lsw_GetEnvironmentStringsW(void) {
-    if (!g_env_block_w) lsw_build_env_block_w();
-    return g_env_block_w;
+    return win32_env_block_w();
 }
 int __attribute__((ms_abi)) lsw_FreeEnvironmentStringsW(uint16_t* env) {
-    (void)env; return 1; /* don't free — static block */
+    free(env); return 1;
 }
 char* __attribute__((ms_abi)) lsw_GetEnvironmentStrings(void) {
-    extern char **environ;
-    size_t total = 1;
-    for (char **e = environ; *e; e++) total += strlen(*e) + 1;
-    char *block = (char*)malloc(total);
-    if (!block) return NULL;
-    char *p = block;
-    for (char **e = environ; *e; e++) {
-        size_t l = strlen(*e) + 1;
-        memcpy(p, *e, l); p += l;
-    }
-    *p = 0;
-    return block;
+    return win32_env_block();
 }
 int __attribute__((ms_abi)) lsw_FreeEnvironmentStringsA(char* env) {
     free(env); return 1;
 }
 
-/* LCMapStringEx — extended locale string mapping (upper/lower/normalize).
- * .NET uses this for string comparisons. We provide a basic implementation. */
+/* LCMapStringEx — extended locale string mapping (upper/lower/sort key).
+ * .NET uses this for string comparisons and hashing; kana/width folding
+ * flags are accepted and ignored. */
 /* LCMAP flags */
 #define LCMAP_LOWERCASE  0x00000100
 #define LCMAP_UPPERCASE  0x00000200
@@ -11993,26 +13422,31 @@ int __attribute__((ms_abi)) lsw_LCMapStringEx(const uint16_t* lpLocaleName, uint
         const uint16_t* lpSrcStr, int cchSrc, uint16_t* lpDestStr, int cchDest,
         void* lpVersionInformation, void* lpReserved, uintptr_t sortHandle) {
     (void)lpLocaleName; (void)lpVersionInformation; (void)lpReserved; (void)sortHandle;
-    if (!lpSrcStr) return 0;
-    int len = cchSrc == -1 ? 0 : cchSrc;
-    if (cchSrc == -1) { const uint16_t *p = lpSrcStr; while (*p++) len++; }
+    if (!lpSrcStr || cchSrc == 0 || cchDest < 0) { lsw_SetLastError(87); return 0; }
+    /* -1: null-terminated, and the terminator is part of the output */
+    size_t len = cchSrc < 0 ? win32_u16_len(lpSrcStr) + 1 : (size_t)cchSrc;
+    int query = cchDest == 0 || !lpDestStr;
+
     if (dwMapFlags & LCMAP_SORTKEY) {
-        /* For sort keys, just copy as-is; good enough for most CLR uses */
-        if (!lpDestStr) return len + 1;
-        int copy = len < cchDest - 1 ? len : cchDest - 1;
-        memcpy(lpDestStr, lpSrcStr, copy * 2);
-        lpDestStr[copy] = 0;
-        return copy;
-    }
-    if (!lpDestStr) return len + (cchSrc == -1 ? 1 : 0);
-    int copy = len < cchDest ? len : cchDest;
-    for (int i = 0; i < copy; i++) {
-        uint16_t c = lpSrcStr[i];
-        if (dwMapFlags & LCMAP_UPPERCASE) c = (uint16_t)towupper(c);
-        else if (dwMapFlags & LCMAP_LOWERCASE) c = (uint16_t)towlower(c);
-        lpDestStr[i] = c;
-    }
-    return copy;
+        /* cchDest counts bytes; key order matches CompareStringW */
+        size_t chars = cchSrc < 0 ? len - 1 : len;
+        int ic = (dwMapFlags & NORM_IGNORECASE) != 0;
+        size_t need = win32_u16_sortkey(lpSrcStr, chars, NULL, 0, ic);
+        if (query) return (int)need;
+        if (need > (size_t)cchDest) { lsw_SetLastError(122); return 0; } // ERROR_INSUFFICIENT_BUFFER
+        win32_u16_sortkey(lpSrcStr, chars, (uint8_t*)lpDestStr, need, ic);
+        return (int)need;
+    }
+
+    if (query) return (int)len;
+    if (len > (size_t)cchDest) { lsw_SetLastError(122); return 0; } // ERROR_INSUFFICIENT_BUFFER
+    if (dwMapFlags & (LCMAP_UPPERCASE | LCMAP_LOWERCASE))
+        win32_u16_map_case(lpSrcStr, len, lpDestStr, (dwMapFlags & LCMAP_UPPERCASE) != 0);
+    else if (lpDestStr != lpSrcStr)
+        memmove(lpDestStr, lpSrcStr, len * sizeof(uint16_t));
+    if (dwMapFlags & LCMAP_BYTEREV)
+        for (size_t i = 0; i < len; i++) lpDestStr[i] = (uint16_t)((lpDestStr[i] << 8) | (lpDestStr[i] >> 8));
+    return (int)len;
 }
 int __attribute__((ms_abi)) lsw_LCMapStringW(uint32_t locale, uint32_t dwMapFlags,
         const uint16_t* lpSrcStr, int cchSrc, uint16_t* lpDestStr, int cchDest) {
@@ -12414,31 +13848,6 @@ int __attribute__((ms_abi)) lsw_CompareFileTime(const uint64_t* lpFileTime1, con
     return 0;
 }
 
-/* MoveFileWithProgressW — move file with optional progress callback */
-int __attribute__((ms_abi)) lsw_MoveFileWithProgressW(const wchar_t* lpExistingFileName,
-                                                       const wchar_t* lpNewFileName,
-                                                       void* lpProgressRoutine,
-                                                       void* lpData, uint32_t dwFlags) {
-    (void)lpProgressRoutine; (void)lpData; (void)dwFlags;
-    if (!lpExistingFileName || !lpNewFileName) return 0;
-    char src[4096], dst[4096];
-    /* Convert wchar_t paths to multibyte */
-    wcstombs(src, lpExistingFileName, sizeof(src));
-    wcstombs(dst, lpNewFileName, sizeof(dst));
-    if (rename(src, dst) == 0) return 1;
-    /* Cross-device: copy then remove */
-    FILE* fs = fopen(src, "rb");
-    if (!fs) return 0;
-    FILE* fd = fopen(dst, "wb");
-    if (!fd) { fclose(fs); return 0; }
-    char buf[4096];
-    size_t n;
-    while ((n = fread(buf, 1, sizeof(buf), fs)) > 0) fwrite(buf, 1, n, fd);
-    fclose(fs); fclose(fd);
-    unlink(src);
-    return 1;
-}
-
 /* OpenEventW — stub returning a non-null handle */
 void* __attribute__((ms_abi)) lsw_OpenEventW(uint32_t dwDesiredAccess, int bInheritHandle, const wchar_t* lpName) {
     (void)bInheritHandle;
@@ -12702,11 +14111,13 @@ uint64_t __attribute__((ms_abi)) lsw_VerSetConditionMask(uint64_t ConditionMask,
     (void)TypeMask; (void)Condition;
     return ConditionMask;
 }
+/* CONTEXT layout used by RtlVirtualUnwind: Rax..R15 then Rip, and Xmm0..15 */
+#define LSW_CTX_OFFS_RAX   0x78
+#define LSW_CTX_OFFS_XMM0  0x1A0
+
 void* __attribute__((ms_abi)) lsw_RtlVirtualUnwind(uint32_t HandlerType, uint64_t ImageBase, uint64_t ControlPc,
                                                     void* FunctionEntry, void* ContextRecord, void** HandlerData,
                                                     uint64_t* EstablisherFrame, void* ContextPointers) {
-    (void)HandlerType; (void)ImageBase; (void)ContextPointers;
-
     lsw_RUNTIME_FUNCTION* rf = (lsw_RUNTIME_FUNCTION*)FunctionEntry;
     uint8_t* ctx = (uint8_t*)ContextRecord;
 
@@ -12714,35 +14125,38 @@ void* __attribute__((ms_abi)) lsw_RtlVirtualUnwind(uint32_t HandlerType, uint64_
     if (EstablisherFrame) *EstablisherFrame = 0;
 
     if (!rf || !ctx) return NULL;
-
-    /* Read RSP from CONTEXT (offset 0x98) */
-    uint64_t body_rsp = *(uint64_t*)(ctx + LSW_CTX_OFFS_RSP);
-
-    uint64_t caller_rip = 0, caller_rsp = 0;
-    uint64_t entry_rsp = lsw_unwind_frame(rf, body_rsp, &caller_rip, &caller_rsp);
-    if (!entry_rsp) {
-        LSW_LOG_WARN("[unwind] RtlVirtualUnwind: lsw_unwind_frame failed for rva=0x%x",
-                     rf->BeginAddress);
+    lsw_set_eh_image(ImageBase);
+
+    /* Restores the nonvolatile registers the frame saved, not just RSP/RIP */
+    win32_unwind_regs_t* regs = (win32_unwind_regs_t*)(ctx + LSW_CTX_OFFS_RAX);
+    regs->rip = ControlPc;
+    uint64_t entry_rsp = 0;
+    int rc = win32_unwind_step(ImageBase, (const win32_runtime_function_t*)rf, regs,
+                               ctx + LSW_CTX_OFFS_XMM0, (void**)ContextPointers, &entry_rsp);
+    if (rc) {
+        LSW_LOG_WARN("[unwind] RtlVirtualUnwind: cannot unwind rva=0x%x: %s",
+                     rf->BeginAddress, strerror(rc));
         return NULL;
     }
 
     if (EstablisherFrame) *EstablisherFrame = entry_rsp;
 
-    /* Update CONTEXT to caller's frame */
-    *(uint64_t*)(ctx + LSW_CTX_OFFS_RIP) = caller_rip;
-    *(uint64_t*)(ctx + LSW_CTX_OFFS_RSP) = caller_rsp;
-
-    LSW_LOG_INFO("[unwind] RtlVirtualUnwind: rva=0x%x entry_rsp=0x%llx caller_rip=0x%llx",
-                 rf->BeginAddress,
-                 (unsigned long long)entry_rsp,
-                 (unsigned long long)caller_rip);
+    LSW_LOG_DEBUG("[unwind] RtlVirtualUnwind: rva=0x%x entry_rsp=0x%llx caller_rip=0x%llx",
+                  rf->BeginAddress,
+                  (unsigned long long)entry_rsp,
+                  (unsigned long long)regs->rip);
 
-    /* Extract language-specific handler from UNWIND_INFO */
+    /* No handler applies while the prolog is still running */
+    uint32_t hflags;
     void* handler_data_ptr = NULL;
-    uint64_t handler_va = lsw_get_frame_seh_handler(rf, &handler_data_ptr);
+    uint64_t handler_va = win32_unwind_handler(ImageBase, (const win32_runtime_function_t*)rf,
+                                               &hflags, &handler_data_ptr);
+    const uint8_t* ui = (const uint8_t*)lsw_rva2va(rf->UnwindData);
+    if (!(hflags & HandlerType) || !ui || ControlPc - (ImageBase + rf->BeginAddress) < ui[1])
+        return NULL;
     if (HandlerData) *HandlerData = handler_data_ptr;
 
-    return handler_va ? (void*)handler_va : NULL;
+    return (void*)(uintptr_t)handler_va;
 }
 
 // ntdll!RtlDllShutdownInProgress — returns non-zero only if process is terminating
@@ -12750,13 +14164,16 @@ uint8_t __attribute__((ms_abi)) lsw_RtlDllShutdownInProgress(void) {
     return 0; /* Process is NOT shutting down */
 }
 
-// KERNEL32!QueueUserAPC2 — Windows 11+ extended APC; not available on older Windows
-// .NET uses it for thread interruption if available, falls back gracefully if absent
+// KERNEL32!QueueUserAPC2 — Windows 11+ extended APC.  Special user-mode APCs
+// (QUEUE_USER_APC_FLAGS_SPECIAL_USER_APC) run without an alertable wait on
+// Windows; we have no way to interrupt arbitrary user code, so report
+// ERROR_NOT_SUPPORTED for those and let .NET fall back to QueueUserAPC.
 uint32_t __attribute__((ms_abi)) lsw_QueueUserAPC2(void* apc_routine, void* thread_handle, uintptr_t data, uint32_t flags) {
-    (void)apc_routine; (void)thread_handle; (void)data; (void)flags;
-    LSW_LOG_WARN("QueueUserAPC2 called — not supported, returning ERROR_NOT_SUPPORTED");
-    /* SetLastError(ERROR_NOT_SUPPORTED = 50) */
-    return 0; /* FALSE */
+    if (flags & 0x1) { /* QUEUE_USER_APC_FLAGS_SPECIAL_USER_APC */
+        lsw_SetLastError(50); /* ERROR_NOT_SUPPORTED */
+        return 0;
+    }
+    return lsw_QueueUserAPC(apc_routine, thread_handle, data);
 }
 
 /* ----------------------------------------------------------------
@@ -12852,16 +14269,58 @@ int __attribute__((ms_abi)) lsw_GetDateFormatW(uint32_t locale, uint32_t flags,
 /* --- KERNEL32: RtlCaptureContext, RtlLookupFunctionEntry --- */
 /* NOTE: implementations are in ntdll_api.c — just need KERNEL32 alias mappings */
 extern void __attribute__((ms_abi)) lsw_RtlCaptureContext(void* ContextRecord);
-/* RtlLookupFunctionEntry — search the PE's .pdata table for the RUNTIME_FUNCTION
- * that contains 'control_pc'.  Used by .NET's own exception dispatch machinery. */
+/* RtlLookupFunctionEntry — find the RUNTIME_FUNCTION that contains 'control_pc'
+ * in any image or dynamic function table.  Used by .NET's own exception
+ * dispatch machinery.  The registry keeps a per-thread last hit, which is
+ * what the history table is for. */
 void* __attribute__((ms_abi)) lsw_RtlLookupFunctionEntry(
     uint64_t control_pc, uint64_t* image_base, void* history_table)
 {
     (void)history_table;
-    lsw_RUNTIME_FUNCTION* rf = lsw_find_rf(control_pc);
-    if (image_base)
-        *image_base = rf ? g_lsw_image_base : 0;
-    return (void*)rf;
+    return (void*)win32_ftab_lookup(control_pc, image_base, NULL);
+}
+
+/*
+ * Registers of the PE code that called us, from our frame record (the
+ * library is built with frame pointers): its return address and RSP,
+ * and its RBP, which our prologue pushed. Other nonvolatile registers
+ * only matter as frame registers and are picked up from the first
+ * frame that saved them.
+ */
+#define LSW_CALLER_REGS(regs) do {                                          \
+        uint64_t* rbp_ = (uint64_t*)__builtin_frame_address(0);             \
+        memset(&(regs), 0, sizeof(regs));                                   \
+        (regs).rip = rbp_[1];                                               \
+        (regs).gpr[WIN32_REG_RSP] = (uint64_t)(uintptr_t)(rbp_ + 2);        \
+        (regs).gpr[WIN32_REG_RBP] = rbp_[0];                                \
+    } while (0)
+
+/* RtlCaptureStackBackTrace — return addresses from the caller up, walked
+ * with the cached unwind recipes.  The hash is the sum of the addresses. */
+uint16_t __attribute__((ms_abi)) lsw_RtlCaptureStackBackTrace(
+    uint32_t frames_to_skip, uint32_t frames_to_capture, void** back_trace, uint32_t* back_trace_hash)
+{
+    win32_unwind_regs_t regs;
+    LSW_CALLER_REGS(regs);
+    if (!back_trace) frames_to_capture = 0;
+    if (frames_to_capture > 0xFFFF) frames_to_capture = 0xFFFF;
+
+    uint32_t n = win32_unwind_backtrace(&regs, frames_to_skip, frames_to_capture, back_trace);
+    if (back_trace_hash) {
+        uint32_t hash = 0;
+        for (uint32_t i = 0; i < n; i++) hash += (uint32_t)(uintptr_t)back_trace[i];
+        *back_trace_hash = hash;
+    }
+    return (uint16_t)n;
+}
+
+/* RtlWalkFrameChain — Flags bits 8+ hold the number of frames to skip */
+uint32_t __attribute__((ms_abi)) lsw_RtlWalkFrameChain(void** callers, uint32_t count, uint32_t flags)
+{
+    win32_unwind_regs_t regs;
+    LSW_CALLER_REGS(regs);
+    if (!callers) return 0;
+    return win32_unwind_backtrace(&regs, flags >> 8, count, callers);
 }
 
 /* --- IPHLPAPI stubs moved to misc_api.c --- */
@@ -13206,16 +14665,28 @@ int __attribute__((ms_abi)) lsw_LoadStringA(void* hInstance, uint32_t uID, char*
     lpBuffer[out] = '\0';
     return out;
 }
+/* CharLowerW / CharUpperW — a pointer with a zero high word is a single
+ * character passed by value and the mapped character is returned. */
 wchar_t* __attribute__((ms_abi)) lsw_CharLowerW(wchar_t* lpsz) {
-    if (!lpsz) return NULL;
-    for (u16* p = (u16*)lpsz; *p; p++) *p = (u16)towlower(*p);
+    if (!((uintptr_t)lpsz >> 16)) return (wchar_t*)(uintptr_t)win32_u16_lower((u16)(uintptr_t)lpsz);
+    win32_u16_map_case((u16*)lpsz, u16_len((u16*)lpsz), (u16*)lpsz, 0);
     return lpsz;
 }
 wchar_t* __attribute__((ms_abi)) lsw_CharUpperW(wchar_t* lpsz) {
-    if (!lpsz) return NULL;
-    for (u16* p = (u16*)lpsz; *p; p++) *p = (u16)towupper(*p);
+    if (!((uintptr_t)lpsz >> 16)) return (wchar_t*)(uintptr_t)win32_u16_upper((u16)(uintptr_t)lpsz);
+    win32_u16_map_case((u16*)lpsz, u16_len((u16*)lpsz), (u16*)lpsz, 1);
     return lpsz;
 }
+uint32_t __attribute__((ms_abi)) lsw_CharLowerBuffW(wchar_t* lpsz, uint32_t cchLength) {
+    if (!lpsz) return 0;
+    win32_u16_map_case((u16*)lpsz, cchLength, (u16*)lpsz, 0);
+    return cchLength;
+}
+uint32_t __attribute__((ms_abi)) lsw_CharUpperBuffW(wchar_t* lpsz, uint32_t cchLength) {
+    if (!lpsz) return 0;
+    win32_u16_map_case((u16*)lpsz, cchLength, (u16*)lpsz, 1);
+    return cchLength;
+}
 
 /* SspiCli stubs */
 int __attribute__((ms_abi)) lsw_GetUserNameExW(int NameFormat, wchar_t* lpNameBuffer, uint32_t* nSize) {
@@ -13448,15 +14919,14 @@ int __attribute__((ms_abi)) lsw_NetpwPathType(uint16_t* PathName, uint32_t* Path
     (void)PathName; (void)Flags; if (PathType) *PathType = 0; return 0;
 }
 
-/* GetCPInfo — fill CPINFO for a given code page; report UTF-8 / no lead bytes */
+/* GetCPInfo — fill CPINFO from the code page tables (lead bytes for DBCS pages) */
 typedef struct { uint32_t MaxCharSize; uint8_t DefaultChar[2]; uint8_t LeadByte[12]; } LSW_CPINFO;
 int __attribute__((ms_abi)) lsw_GetCPInfo(uint32_t CodePage, LSW_CPINFO* lpCPInfo) {
-    (void)CodePage;
-    if (!lpCPInfo) { lsw_SetLastError(87); return 0; }
-    lpCPInfo->MaxCharSize    = 1;
-    lpCPInfo->DefaultChar[0] = '?';
-    lpCPInfo->DefaultChar[1] = 0;
-    memset(lpCPInfo->LeadByte, 0, sizeof(lpCPInfo->LeadByte));
+    win32_cpinfo_t info;
+    if (!lpCPInfo || !win32_codepage_info(CodePage, &info)) { lsw_SetLastError(87); return 0; }
+    lpCPInfo->MaxCharSize = info.max_char_size;
+    memcpy(lpCPInfo->DefaultChar, info.default_char, sizeof(lpCPInfo->DefaultChar));
+    memcpy(lpCPInfo->LeadByte, info.lead_byte, sizeof(lpCPInfo->LeadByte));
     return 1; /* TRUE */
 }
 
@@ -14596,6 +16066,8 @@ static const win32_api_mapping_t api_mappings[] = {
     {"USER32.dll", "LoadStringA",          (void*)lsw_LoadStringA},
     {"USER32.dll", "CharLowerW",           (void*)lsw_CharLowerW},
     {"USER32.dll", "CharUpperW",           (void*)lsw_CharUpperW},
+    {"USER32.dll", "CharLowerBuffW",       (void*)lsw_CharLowerBuffW},
+    {"USER32.dll", "CharUpperBuffW",       (void*)lsw_CharUpperBuffW},
     {"USER32.dll", "CharPrevExA",          (void*)lsw_CharPrevExA},
 
     // SspiCli.dll stubs (Kerberos/NTLM auth — whoami needs these)
@@ -14699,6 +16171,8 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "CreateFileW", (void*)lsw_CreateFileW},
     {"KERNEL32.dll", "DeleteFileW", (void*)lsw_DeleteFileW},
     {"KERNEL32.dll", "CopyFileW", (void*)lsw_CopyFileW},
+    {"KERNEL32.dll", "CopyFileExW", (void*)lsw_CopyFileExW},
+    {"KERNEL32.dll", "CopyFileExA", (void*)lsw_CopyFileExA},
     {"KERNEL32.dll", "CreateDirectoryW", (void*)lsw_CreateDirectoryW},
     {"KERNEL32.dll", "RemoveDirectoryW", (void*)lsw_RemoveDirectoryW},
     {"KERNEL32.dll", "GetFileAttributesW", (void*)lsw_GetFileAttributesW},
@@ -14719,6 +16193,8 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "SetEnvironmentVariableW", (void*)lsw_SetEnvironmentVariableW},
     {"KERNEL32.dll", "ExpandEnvironmentStringsA", (void*)lsw_ExpandEnvironmentStringsA},
     {"KERNEL32.dll", "ExpandEnvironmentStringsW", (void*)lsw_ExpandEnvironmentStringsW},
+    {"KERNEL32.dll", "SearchPathA",               (void*)lsw_SearchPathA},
+    {"KERNEL32.dll", "SearchPathW",               (void*)lsw_SearchPathW},
     {"KERNEL32.dll", "FindFirstFileW", (void*)lsw_FindFirstFileW},
     {"KERNEL32.dll", "FindNextFileW", (void*)lsw_FindNextFileW},
     {"KERNEL32.dll", "FindClose", (void*)lsw_FindClose},
@@ -14739,6 +16215,8 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "GetProcAddress", (void*)lsw_GetProcAddress},
     {"KERNEL32.dll", "lstrlenA", (void*)lsw_lstrlenA},
     {"KERNEL32.dll", "IsDBCSLeadByteEx", (void*)lsw_IsDBCSLeadByteEx},
+    {"KERNEL32.dll", "IsDBCSLeadByte", (void*)lsw_IsDBCSLeadByte},
+    {"KERNEL32.dll", "IsValidCodePage", (void*)lsw_IsValidCodePage},
     {"KERNEL32.dll", "MultiByteToWideChar", (void*)lsw_MultiByteToWideChar},
     {"KERNEL32.dll", "WideCharToMultiByte", (void*)lsw_WideCharToMultiByte},
     {"KERNEL32.dll", "TlsGetValue", (void*)lsw_TlsGetValue},
@@ -14767,6 +16245,14 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "FlsFree", (void*)lsw_FlsFree},
     {"KERNEL32.dll", "FlsGetValue", (void*)lsw_FlsGetValue},
     {"KERNEL32.dll", "FlsSetValue", (void*)lsw_FlsSetValue},
+    {"KERNEL32.dll", "CreateFiber", (void*)lsw_CreateFiber},
+    {"KERNEL32.dll", "CreateFiberEx", (void*)lsw_CreateFiberEx},
+    {"KERNEL32.dll", "DeleteFiber", (void*)lsw_DeleteFiber},
+    {"KERNEL32.dll", "SwitchToFiber", (void*)lsw_SwitchToFiber},
+    {"KERNEL32.dll", "ConvertThreadToFiber", (void*)lsw_ConvertThreadToFiber},
+    {"KERNEL32.dll", "ConvertThreadToFiberEx", (void*)lsw_ConvertThreadToFiberEx},
+    {"KERNEL32.dll", "ConvertFiberToThread", (void*)lsw_ConvertFiberToThread},
+    {"KERNEL32.dll", "IsThreadAFiber", (void*)lsw_IsThreadAFiber},
     {"KERNEL32.dll", "CreateMutexW", (void*)lsw_CreateMutexW},
     {"KERNEL32.dll", "CreateEventW", (void*)lsw_CreateEventW},
     {"KERNEL32.dll", "CreateFileMappingW", (void*)lsw_CreateFileMappingW},
@@ -15399,6 +16885,9 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "GetACP",                   (void*)lsw_GetACP},
     {"KERNEL32.dll", "GetOEMCP",                 (void*)lsw_GetOEMCP},
     {"KERNEL32.dll", "QueryPerformanceCounter",  (void*)lsw_QueryPerformanceCounter},
+    {"KERNEL32.dll", "QueryInterruptTime",       (void*)lsw_QueryInterruptTime},
+    {"KERNEL32.dll", "QueryInterruptTimePrecise",(void*)lsw_QueryInterruptTimePrecise},
+    {"KERNEL32.dll", "QueryUnbiasedInterruptTime",(void*)lsw_QueryUnbiasedInterruptTime},
     {"KERNEL32.dll", "QueryPerformanceFrequency",(void*)lsw_QueryPerformanceFrequency},
     {"KERNEL32.dll", "AllocConsole",             (void*)lsw_AllocConsole},
     {"KERNEL32.dll", "FreeConsole",              (void*)lsw_FreeConsole},
@@ -15427,6 +16916,9 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "GetCurrentDirectoryW",     (void*)lsw_GetCurrentDirectoryW},
     {"KERNEL32.dll", "MoveFileA",                (void*)lsw_MoveFileA},
     {"KERNEL32.dll", "MoveFileW",                (void*)lsw_MoveFileW},
+    {"KERNEL32.dll", "MoveFileExA",              (void*)lsw_MoveFileExA},
+    {"KERNEL32.dll", "MoveFileExW",              (void*)lsw_MoveFileExW},
+    {"KERNEL32.dll", "MoveFileWithProgressA",    (void*)lsw_MoveFileWithProgressA},
     {"KERNEL32.dll", "CopyFileA",                (void*)lsw_CopyFileA},
     {"KERNEL32.dll", "FindFirstFileA",           (void*)lsw_FindFirstFileA},
     {"KERNEL32.dll", "FindNextFileA",            (void*)lsw_FindNextFileA},
@@ -15442,9 +16934,11 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "CreateMutexExW",           (void*)lsw_CreateMutexExW},
     {"KERNEL32.dll", "DebugBreak",               (void*)lsw_DebugBreak},
     /* File change notifications */
+    {"KERNEL32.dll", "FindFirstChangeNotificationA", (void*)lsw_FindFirstChangeNotificationA},
     {"KERNEL32.dll", "FindFirstChangeNotificationW", (void*)lsw_FindFirstChangeNotificationW},
     {"KERNEL32.dll", "FindNextChangeNotification",   (void*)lsw_FindNextChangeNotification},
     {"KERNEL32.dll", "FindCloseChangeNotification",  (void*)lsw_FindCloseChangeNotification},
+    {"KERNEL32.dll", "ReadDirectoryChangesW",        (void*)lsw_ReadDirectoryChangesW},
     /* Resource API */
     {"KERNEL32.dll", "FindResourceExW",          (void*)lsw_FindResourceExW},
     {"KERNEL32.dll", "LoadResource",             (void*)lsw_LoadResource},
@@ -15706,6 +17200,7 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "RtlCaptureContext",        (void*)lsw_RtlCaptureContext},
     {"KERNEL32.dll", "RtlLookupFunctionEntry",   (void*)lsw_RtlLookupFunctionEntry},
     {"KERNEL32.dll", "RtlVirtualUnwind",         (void*)lsw_RtlVirtualUnwind},
+    {"KERNEL32.dll", "RtlCaptureStackBackTrace", (void*)lsw_RtlCaptureStackBackTrace},
     {"KERNEL32.dll", "GetCPInfo",                (void*)lsw_GetCPInfo},
     {"KERNEL32.dll", "ApiSetQueryApiSetPresence",(void*)lsw_ApiSetQueryApiSetPresence},
     {"KERNEL32.dll", "ResolveDelayLoadedAPI",    (void*)lsw_ResolveDelayLoadedAPI},
@@ -15713,6 +17208,8 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "PeekConsoleInputW",        (void*)lsw_PeekConsoleInputW},
     {"ntdll.dll",    "RtlCaptureContext",        (void*)lsw_RtlCaptureContext},
     {"ntdll.dll",    "RtlLookupFunctionEntry",   (void*)lsw_RtlLookupFunctionEntry},
+    {"ntdll.dll",    "RtlCaptureStackBackTrace", (void*)lsw_RtlCaptureStackBackTrace},
+    {"ntdll.dll",    "RtlWalkFrameChain",        (void*)lsw_RtlWalkFrameChain},
     /* msvcrt.dll new entries */
     {"msvcrt.dll",   "_wcsicmp",    (void*)lsw__wcsicmp},
     {"msvcrt.dll",   "_wcsnicmp",   (void*)lsw__wcsnicmp},
@@ -15819,6 +17316,10 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "RemoveVectoredExceptionHandler",(void*)lsw_RemoveVectoredExceptionHandler},
     {"KERNEL32.dll", "AddVectoredContinueHandler",   (void*)lsw_AddVectoredContinueHandler},
     {"KERNEL32.dll", "RemoveVectoredContinueHandler",(void*)lsw_RemoveVectoredContinueHandler},
+    {"ntdll.dll",    "RtlAddVectoredExceptionHandler",   (void*)lsw_AddVectoredExceptionHandler},
+    {"ntdll.dll",    "RtlRemoveVectoredExceptionHandler",(void*)lsw_RemoveVectoredExceptionHandler},
+    {"ntdll.dll",    "RtlAddVectoredContinueHandler",    (void*)lsw_AddVectoredContinueHandler},
+    {"ntdll.dll",    "RtlRemoveVectoredContinueHandler", (void*)lsw_RemoveVectoredContinueHandler},
     {"KERNEL32.dll", "InitializeSListHead",          (void*)lsw_InitializeSListHead},
     {"KERNEL32.dll", "QueryDepthSList",              (void*)lsw_QueryDepthSList},
     {"KERNEL32.dll", "InterlockedPushEntrySList",    (void*)lsw_InterlockedPushEntrySList},
@@ -15843,6 +17344,7 @@ static const win32_api_mapping_t api_mappings[] = {
     {"KERNEL32.dll", "LCMapStringW",                 (void*)lsw_LCMapStringW},
     {"KERNEL32.dll", "RtlAddFunctionTable",          (void*)lsw_RtlAddFunctionTable},
     {"KERNEL32.dll", "RtlInstallFunctionTableCallback",(void*)lsw_RtlInstallFunctionTableCallback},
+    {"KERNEL32.dll", "RtlDeleteFunctionTable",       (void*)lsw_RtlDeleteFunctionTable},
     {"KERNEL32.dll", "RtlUnwind",                    (void*)lsw_RtlUnwind},
     {"KERNEL32.dll", "RtlUnwindEx",                  (void*)lsw_RtlUnwindEx},
     {"KERNEL32.dll", "RtlPcToFileHeader",            (void*)lsw_RtlPcToFileHeader},
@@ -15981,6 +17483,12 @@ static const win32_api_mapping_t api_mappings[] = {
 
     /* api-ms-win-core-profile */
     {"api-ms-win-core-profile-l1-1-0.dll",  "QueryPerformanceCounter",(void*)lsw_QueryPerformanceCounter},
+    {"api-ms-win-core-profile-l1-1-0.dll",  "QueryPerformanceFrequency",(void*)lsw_QueryPerformanceFrequency},
+    /* api-ms-win-core-realtime */
+    {"api-ms-win-core-realtime-l1-1-0.dll", "QueryUnbiasedInterruptTime",(void*)lsw_QueryUnbiasedInterruptTime},
+    {"api-ms-win-core-realtime-l1-1-1.dll", "QueryInterruptTime",    (void*)lsw_QueryInterruptTime},
+    {"api-ms-win-core-realtime-l1-1-1.dll", "QueryInterruptTimePrecise",(void*)lsw_QueryInterruptTimePrecise},
+    {"api-ms-win-core-realtime-l1-1-1.dll", "QueryUnbiasedInterruptTime",(void*)lsw_QueryUnbiasedInterruptTime},
 
     /* api-ms-win-core-registry */
     {"api-ms-win-core-registry-l1-1-0.dll", "RegOpenKeyExW",         (void*)lsw_RegOpenKeyExW},
@@ -15991,8 +17499,12 @@ static const win32_api_mapping_t api_mappings[] = {
     {"api-ms-win-core-rtlsupport-l1-1-0.dll","RtlCompareMemory",     (void*)lsw_RtlCompareMemory},
     {"KERNEL32.dll", "RtlCompareMemory",                             (void*)lsw_RtlCompareMemory},
     {"api-ms-win-core-rtlsupport-l1-1-0.dll","RtlLookupFunctionEntry",(void*)lsw_RtlLookupFunctionEntry},
+    {"api-ms-win-core-rtlsupport-l1-2-0.dll","RtlAddGrowableFunctionTable",(void*)lsw_RtlAddGrowableFunctionTable},
+    {"api-ms-win-core-rtlsupport-l1-2-0.dll","RtlGrowFunctionTable",       (void*)lsw_RtlGrowFunctionTable},
+    {"api-ms-win-core-rtlsupport-l1-2-0.dll","RtlDeleteGrowableFunctionTable",(void*)lsw_RtlDeleteGrowableFunctionTable},
     {"api-ms-win-core-rtlsupport-l1-1-0.dll","RtlCaptureContext",    (void*)lsw_RtlCaptureContext},
     {"api-ms-win-core-rtlsupport-l1-1-0.dll","RtlVirtualUnwind",     (void*)lsw_RtlVirtualUnwind},
+    {"api-ms-win-core-rtlsupport-l1-1-0.dll","RtlCaptureStackBackTrace",(void*)lsw_RtlCaptureStackBackTrace},
 
     /* api-ms-win-core-string */
     {"api-ms-win-core-string-l1-1-0.dll",   "CompareStringW",        (void*)lsw_CompareStringW},
@@ -16090,6 +17602,7 @@ extern void lsw_dotnet_init(void); /* dotnet_host_api.c */
 
 void win32_api_init(void) {
     LSW_LOG_INFO("Initialized %zu Win32 API mappings", api_mappings_count);
+    win32_kuser_init();
     lsw_dotnet_init();
 }
 
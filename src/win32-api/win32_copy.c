@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 copy engine
+ *
+ * CopyFile used to pump every byte through an 8 KB stack buffer. The
+ * engine below lets the kernel do the work: a reflink shares the
+ * extents outright, copy_file_range copies inside the kernel (and
+ * offloads to the filesystem or NFS server where it can), sendfile
+ * still avoids the user copy between filesystems that refuse
+ * copy_file_range. Only special files and very old kernels reach the
+ * buffer loop. Every stage continues from the file offsets the previous
+ * one left behind, so a stage may give up half way.
+ *
+ * Progress and cancellation are checked every CP_CHUNK bytes; without
+ * a callback, a cancel flag or NO_BUFFERING the kernel stages move up
+ * to a gigabyte per call.
+ */
+
+#define _GNU_SOURCE  /* copy_file_range, renameat2, sync_file_range */
+
+#include "win32_copy.h"
+#include "lsw_filesystem.h"
+#include "lsw_overlay.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>           /* FICLONE */
+
+#define CP_CHUNK      (8ull << 20)  /* progress/cancel granularity */
+#define CP_BIG_CHUNK  (1ull << 30)  /* per call when nobody is watching */
+#define CP_BUF        (1u << 20)
+#define CP_ALIGN      4096
+
+typedef struct {
+    int      sfd;
+    int      dfd;
+    int      flags;
+    int      regular;               /* source size is known */
+    uint64_t total;
+    uint64_t done;
+    uint64_t next_tick;
+    uint64_t chunk;
+    win32_copy_progress_t progress;
+    void*    ctx;
+    const volatile int* cancel;
+} cp_job_t;
+
+// ============================================================================
+// SECTION: Progress
+// ============================================================================
+
+/* Report the position; nonzero aborts the copy */
+static int cp_tick(cp_job_t* j) {
+    if (j->flags & WIN32_COPY_NO_BUFFERING) {
+        /* Write the chunk back and drop both sides from the cache */
+        sync_file_range(j->dfd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE |
+                        SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        posix_fadvise(j->dfd, 0, 0, POSIX_FADV_DONTNEED);
+        posix_fadvise(j->sfd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    if (j->cancel && *j->cancel) return 1;
+    if (!j->progress) return 0;
+
+    uint32_t r = j->progress(j->total, j->done, j->ctx);
+    if (r == WIN32_COPY_QUIET) j->progress = NULL;
+    return r == WIN32_COPY_CANCEL || r == WIN32_COPY_STOP;
+}
+
+static int cp_advance(cp_job_t* j, uint64_t n) {
+    j->done += n;
+    if (!j->regular && j->done > j->total) j->total = j->done;
+    if (j->done < j->next_tick && j->done != j->total) return 0;
+    j->next_tick = j->done + CP_CHUNK;
+    return cp_tick(j);
+}
+
+/* Bytes for the next call of a kernel stage */
+static size_t cp_want(const cp_job_t* j) {
+    uint64_t left = j->total - j->done;
+    return (size_t)(left < j->chunk ? left : j->chunk);
+}
+
+// ============================================================================
+// SECTION: Stages
+// ============================================================================
+
+/*
+ * Each stage returns 0 when the data is complete, 1 when the
+ * filesystems do not support it (the next stage takes over), or an
+ * errno value.
+ */
+
+static int cp_clone(cp_job_t* j) {
+    if (j->done != 0 || ioctl(j->dfd, FICLONE, j->sfd) != 0) return 1;
+    return cp_advance(j, j->total) ? ECANCELED : 0;
+}
+
+static int cp_range(cp_job_t* j) {
+    while (j->done < j->total) {
+        ssize_t n = copy_file_range(j->sfd, NULL, j->dfd, NULL, cp_want(j), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                errno == EOPNOTSUPP || errno == EBADF)
+                return 1;
+            return errno;
+        }
+        if (n == 0) {               /* the source shrank */
+            j->total = j->done;
+            break;
+        }
+        if (cp_advance(j, (uint64_t)n)) return ECANCELED;
+    }
+    return 0;
+}
+
+static int cp_sendfile(cp_job_t* j) {
+    while (j->done < j->total) {
+        ssize_t n = sendfile(j->dfd, j->sfd, NULL, cp_want(j));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL || errno == ENOSYS) return 1;
+            return errno;
+        }
+        if (n == 0) {
+            j->total = j->done;
+            break;
+        }
+        if (cp_advance(j, (uint64_t)n)) return ECANCELED;
+    }
+    return 0;
+}
+
+static int cp_buffer(cp_job_t* j) {
+    void* buf;
+    if (posix_memalign(&buf, CP_ALIGN, CP_BUF) != 0) return ENOMEM;
+
+    int rc = 0;
+    while (!j->regular || j->done < j->total) {
+        ssize_t n = read(j->sfd, buf, CP_BUF);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { rc = errno; break; }
+        if (n == 0) { j->total = j->done; break; }
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(j->dfd, (char*)buf + off, (size_t)(n - off));
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0) { rc = errno; break; }
+            off += w;
+        }
+        if (rc) break;
+        if (cp_advance(j, (uint64_t)n)) { rc = ECANCELED; break; }
+    }
+    free(buf);
+    return rc;
+}
+
+static int cp_run(cp_job_t* j) {
+    int rc = 1;
+    if (j->regular) {
+        rc = cp_clone(j);
+        if (rc == 1) rc = cp_range(j);
+        if (rc == 1) rc = cp_sendfile(j);
+    }
+    if (rc == 1) rc = cp_buffer(j);
+    return rc;
+}
+
+// ============================================================================
+// SECTION: CopyFile / MoveFile
+// ============================================================================
+
+int win32_copy_file(const char* src, const char* dst, int flags,
+                    win32_copy_progress_t progress, void* ctx, const volatile int* cancel) {
+    int sfd = open(src, O_RDONLY | O_CLOEXEC);
+    if (sfd < 0) return errno;
+
+    struct stat st, dst_st;
+    if (fstat(sfd, &st) != 0) {
+        int err = errno;
+        close(sfd);
+        return err;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        close(sfd);
+        return EISDIR;
+    }
+    if (stat(dst, &dst_st) == 0) {
+        int err = 0;
+        if (dst_st.st_dev == st.st_dev && dst_st.st_ino == st.st_ino) err = EBUSY;
+        else if (flags & WIN32_COPY_FAIL_IF_EXISTS) err = EEXIST;
+        else if (S_ISDIR(dst_st.st_mode)) err = EISDIR;
+        if (err) {
+            close(sfd);
+            return err;
+        }
+    }
+
+    char path[LSW_MAX_PATH];
+    snprintf(path, sizeof(path), "%s", dst);
+    int dfd = -1;
+    if (lsw_overlay_copy_up(path, sizeof(path), false) == 0) {
+        int oflags = O_WRONLY | O_CREAT | O_CLOEXEC |
+                     ((flags & WIN32_COPY_FAIL_IF_EXISTS) ? O_EXCL : O_TRUNC);
+        dfd = open(path, oflags, 0600);
+    }
+    if (dfd < 0) {
+        int err = errno;
+        close(sfd);
+        return err;
+    }
+
+    cp_job_t j = {
+        .sfd = sfd, .dfd = dfd, .flags = flags,
+        /* procfs and friends report 0 bytes: read those to EOF */
+        .regular = S_ISREG(st.st_mode) && st.st_size > 0,
+        .total = S_ISREG(st.st_mode) ? (uint64_t)st.st_size : 0,
+        .next_tick = CP_CHUNK,
+        .chunk = (progress || cancel || (flags & WIN32_COPY_NO_BUFFERING)) ? CP_CHUNK : CP_BIG_CHUNK,
+        .progress = progress, .ctx = ctx, .cancel = cancel,
+    };
+    int rc = cp_tick(&j) ? ECANCELED : cp_run(&j);
+    if (rc == 0) {
+        /* Attributes live in the mode bits; CopyFile keeps the write time */
+        struct timespec times[2] = { st.st_atim, st.st_mtim };
+        if (fchmod(dfd, st.st_mode & 0777) != 0 || futimens(dfd, times) != 0)
+            LSW_LOG_WARN("CopyFile: %s: attributes not preserved: %s", path, strerror(errno));
+        if ((flags & WIN32_COPY_WRITE_THROUGH) && fsync(dfd) != 0) rc = errno;
+    }
+    if (close(dfd) != 0 && rc == 0) rc = errno;
+    close(sfd);
+
+    if (rc != 0) unlink(path);
+    lsw_fs_invalidate(path);
+    LSW_LOG_DEBUG("CopyFile: %s -> %s: %llu bytes, %s", src, path,
+                  (unsigned long long)j.done, rc ? strerror(rc) : "ok");
+    return rc;
+}
+
+int win32_move_file(const char* src, const char* dst, int flags,
+                    win32_copy_progress_t progress, void* ctx, const volatile int* cancel) {
+    int replace = flags & WIN32_MOVE_REPLACE;
+    struct stat st;
+    int rc;
+
+    if (lsw_overlay_mode() == LSW_OVERLAY_USERSPACE) {
+        /* The layered rename has no flags; check for a target first */
+        if (!replace && lstat(dst, &st) == 0) return EEXIST;
+        rc = lsw_overlay_rename(src, dst) == 0 ? 0 : errno;
+    } else {
+        rc = renameat2(AT_FDCWD, src, AT_FDCWD, dst, replace ? 0 : RENAME_NOREPLACE) == 0 ? 0 : errno;
+        if (rc == EINVAL && !replace) {
+            /* Filesystem without RENAME_NOREPLACE */
+            if (lstat(dst, &st) == 0) return EEXIST;
+            rc = rename(src, dst) == 0 ? 0 : errno;
+        }
+    }
+
+    if (rc == EXDEV && (flags & WIN32_MOVE_COPY_ALLOWED) &&
+        lstat(src, &st) == 0 && !S_ISDIR(st.st_mode)) {
+        int cflags = (replace ? 0 : WIN32_COPY_FAIL_IF_EXISTS) |
+                     ((flags & WIN32_MOVE_WRITE_THROUGH) ? WIN32_COPY_WRITE_THROUGH : 0);
+        rc = win32_copy_file(src, dst, cflags, progress, ctx, cancel);
+        if (rc == 0 && lsw_overlay_unlink(src) != 0) rc = errno;
+    }
+    if (rc == 0) {
+        lsw_fs_invalidate(src);
+        lsw_fs_invalidate(dst);
+    }
+    return rc;
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 directory enumeration engine
+ *
+ * FindFirstFile/FindNextFile and NtQueryDirectoryFile used to run their
+ * own readdir loops with a recursive matcher and a path-building stat()
+ * per entry. Recursive tree walks (build tools, backup agents) spend
+ * nearly all their time there. This engine reads entries in large
+ * getdents64 batches, matches them against a pattern compiled once per
+ * search, and stats only entries that match, relative to the directory
+ * fd, and only when the caller needs more than names.
+ *
+ * Under a userspace LSW_OVERLAY, a directory present in both layers is
+ * listed as one: the upper directory first (without its whiteouts), then
+ * base entries that are neither shadowed nor whited out.
+ */
+
+#define _GNU_SOURCE  /* fstatat, O_DIRECTORY, syscall */
+
+#include "win32_dirscan.h"
+#include "win32_unicode.h"
+#include "lsw_overlay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define DIRSCAN_BATCH        (32 * 1024)
+#define DIRSCAN_BATCH_LARGE  (256 * 1024)
+
+#define FILETIME_UNIX_EPOCH  116444736000000000ULL
+
+#define FILE_ATTRIBUTE_READONLY  0x00000001
+#define FILE_ATTRIBUTE_HIDDEN    0x00000002
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_ARCHIVE   0x00000020
+
+enum { PAT_ALL, PAT_LITERAL, PAT_SUFFIX, PAT_GLOB };
+
+/* Kernel record layout for getdents64 */
+struct linux_dirent64 {
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+struct win32_dirscan {
+    int     fd;
+    int     owns_fd;
+    int     flags;
+    win32_pattern_t pat;
+    char*   buf;
+    size_t  cap;
+    size_t  len;            /* bytes in buf from the last getdents64 */
+    size_t  pos;            /* next record */
+    int     eof;
+    int     literal_done;   /* PAT_LITERAL: direct lookup already tried */
+    int     other_fd;       /* overlay: the layer not being read, or -1 */
+    int     in_lower;       /* overlay: fd is the base directory */
+    int     replay;         /* unget: hand out `cur` once more */
+    win32_dirent_t cur;
+};
+
+// ============================================================================
+// Patterns
+// ============================================================================
+
+static inline char tolower_ascii(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c;
+}
+
+static inline int pat_eq(char a, char b, int cs) {
+    return cs ? a == b : tolower_ascii(a) == tolower_ascii(b);
+}
+
+void win32_pattern_compile(win32_pattern_t* pat, const char* pattern, int case_sensitive) {
+    memset(pat, 0, sizeof(*pat));
+    pat->case_sensitive = case_sensitive;
+
+    size_t n = 0;
+    int wild = 0, inner_wild = 0;
+    for (const char* p = pattern ? pattern : ""; *p && n < sizeof(pat->text) - 1; p++) {
+        char c = *p;
+        /* NT DOS wildcards: DOS_STAR, DOS_QM, DOS_DOT */
+        if (c == '<') c = '*';
+        else if (c == '>') c = '?';
+        else if (c == '"') c = '.';
+        if (c == '*' || c == '?') {
+            wild = 1;
+            if (n > 0) inner_wild = 1;
+        }
+        pat->text[n++] = c;
+    }
+    pat->text[n] = '\0';
+    pat->len = n;
+
+    if (n == 0 || strcmp(pat->text, "*") == 0 || strcmp(pat->text, "*.*") == 0) {
+        pat->kind = PAT_ALL;
+    } else if (!wild) {
+        pat->kind = PAT_LITERAL;
+    } else if (pat->text[0] == '*' && !inner_wild && n > 1) {
+        /* "*.ext" (or "*tail"): keep only the tail */
+        memmove(pat->text, pat->text + 1, n);
+        pat->len = n - 1;
+        pat->kind = PAT_SUFFIX;
+    } else {
+        pat->kind = PAT_GLOB;
+    }
+}
+
+static int glob_match(const char* p, size_t pn, const char* s, size_t sn, int cs) {
+    size_t pi = 0, si = 0, star = (size_t)-1, mark = 0;
+    while (si < sn) {
+        if (pi < pn && (p[pi] == '?' || pat_eq(p[pi], s[si], cs))) {
+            pi++; si++;
+        } else if (pi < pn && p[pi] == '*') {
+            star = pi++;
+            mark = si;
+        } else if (star != (size_t)-1) {
+            pi = star + 1;
+            si = ++mark;
+        } else {
+            return 0;
+        }
+    }
+    while (pi < pn && p[pi] == '*') pi++;
+    return pi == pn;
+}
+
+int win32_pattern_match(const win32_pattern_t* pat, const char* name, size_t len) {
+    int cs = pat->case_sensitive;
+    switch (pat->kind) {
+    case PAT_ALL:
+        return 1;
+    case PAT_LITERAL:
+        return len == pat->len &&
+               (cs ? memcmp(name, pat->text, len) == 0 : strncasecmp(name, pat->text, len) == 0);
+    case PAT_SUFFIX:
+        return len >= pat->len &&
+               (cs ? memcmp(name + len - pat->len, pat->text, pat->len) == 0
+                   : strncasecmp(name + len - pat->len, pat->text, pat->len) == 0);
+    default:
+        if (glob_match(pat->text, pat->len, name, len, cs)) return 1;
+        /* Windows: "name.*" also matches "name" with no extension */
+        if (pat->len >= 2 && pat->text[pat->len - 2] == '.' && pat->text[pat->len - 1] == '*' &&
+            !memchr(name, '.', len)) {
+            return glob_match(pat->text, pat->len - 2, name, len, cs);
+        }
+        return 0;
+    }
+}
+
+// ============================================================================
+// Entries
+// ============================================================================
+
+static inline int64_t ts_filetime(const struct timespec* ts) {
+    return (int64_t)((uint64_t)ts->tv_sec * 10000000ULL + (uint64_t)ts->tv_nsec / 100 +
+                     FILETIME_UNIX_EPOCH);
+}
+
+static void fill_entry(win32_dirscan_t* scan, const char* name, size_t len,
+                       uint64_t ino, unsigned char d_type, const struct stat* known) {
+    win32_dirent_t* e = &scan->cur;
+    e->name = name;
+    e->name_len = len;
+    ptrdiff_t w = win32_utf8_to_utf16((const uint8_t*)name, len, e->wname, WIN32_DIRSCAN_NAME_MAX, 0);
+    e->wname_len = w > 0 ? (uint32_t)w : 0;
+    e->file_id = ino;
+    e->have_stat = 0;
+
+    int dot_entry = name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'));
+    uint32_t hidden = (name[0] == '.' && !dot_entry) ? FILE_ATTRIBUTE_HIDDEN : 0;
+
+    struct stat st;
+    if (known) st = *known;
+    if (!(scan->flags & WIN32_DIRSCAN_NAMES_ONLY) &&
+        (known || fstatat(scan->fd, name, &st, 0) == 0 ||
+         fstatat(scan->fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)) {      /* dangling link */
+        e->have_stat = 1;
+        e->attributes = (S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE) | hidden;
+        if (!(st.st_mode & S_IWUSR)) e->attributes |= FILE_ATTRIBUTE_READONLY;
+        e->file_id       = (uint64_t)st.st_ino;
+        e->size          = S_ISDIR(st.st_mode) ? 0 : (int64_t)st.st_size;
+        e->alloc_size    = ((int64_t)st.st_blocks * 512 + 4095) & ~(int64_t)4095;
+        e->creation_time = ts_filetime(&st.st_ctim);
+        e->access_time   = ts_filetime(&st.st_atim);
+        e->write_time    = ts_filetime(&st.st_mtim);
+        e->change_time   = ts_filetime(&st.st_ctim);
+    } else {
+        e->attributes = (d_type == DT_DIR ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE) | hidden;
+        e->size = e->alloc_size = 0;
+        e->creation_time = e->access_time = e->write_time = e->change_time = 0;
+    }
+}
+
+// ============================================================================
+// Scanner
+// ============================================================================
+
+// Merge in the base directory when `path` is an upper overlay directory
+static void scan_attach_lower(win32_dirscan_t* scan, const char* path) {
+    char lower[4096];
+    if (lsw_overlay_lower_dir(path, lower, sizeof(lower))) {
+        scan->other_fd = open(lower, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+}
+
+// Skip whiteouts, and base entries shadowed or whited out by the upper layer
+static int scan_hidden(const win32_dirscan_t* scan, const char* name) {
+    if (!scan->in_lower) return lsw_overlay_is_whiteout_name(name);
+    char wh[WIN32_DIRSCAN_NAME_MAX + 8];
+    struct stat st;
+    if (fstatat(scan->other_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) return 1;
+    snprintf(wh, sizeof(wh), ".wh.%s", name);
+    return faccessat(scan->other_fd, wh, F_OK, AT_SYMLINK_NOFOLLOW) == 0;
+}
+
+// Swap the two layers' fds
+static void scan_swap_layers(win32_dirscan_t* scan) {
+    int fd = scan->fd;
+    scan->fd = scan->other_fd;
+    scan->other_fd = fd;
+    scan->in_lower = !scan->in_lower;
+}
+
+win32_dirscan_t* win32_dirscan_fdopen(int fd, const char* pattern, int flags) {
+    win32_dirscan_t* scan = calloc(1, sizeof(*scan));
+    if (!scan) return NULL;
+    scan->cap = (flags & WIN32_DIRSCAN_LARGE_FETCH) ? DIRSCAN_BATCH_LARGE : DIRSCAN_BATCH;
+    scan->buf = malloc(scan->cap);
+    if (!scan->buf) {
+        free(scan);
+        errno = ENOMEM;
+        return NULL;
+    }
+    scan->fd = fd;
+    scan->other_fd = -1;
+    scan->flags = flags;
+    win32_pattern_compile(&scan->pat, pattern, (flags & WIN32_DIRSCAN_CASE_SENSITIVE) != 0);
+    if (lsw_overlay_mode() == LSW_OVERLAY_USERSPACE && !(flags & WIN32_DIRSCAN_NO_OVERLAY)) {
+        char proc[64], path[4096];
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+        ssize_t n = readlink(proc, path, sizeof(path) - 1);
+        if (n > 0) {
+            path[n] = '\0';
+            scan_attach_lower(scan, path);
+        }
+    }
+    return scan;
+}
+
+win32_dirscan_t* win32_dirscan_open(const char* path, const char* pattern, int flags) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    win32_dirscan_t* scan = win32_dirscan_fdopen(fd, pattern, flags | WIN32_DIRSCAN_NO_OVERLAY);
+    if (!scan) {
+        close(fd);
+        return NULL;
+    }
+    scan->owns_fd = 1;
+    if (lsw_overlay_mode() == LSW_OVERLAY_USERSPACE) scan_attach_lower(scan, path);
+    return scan;
+}
+
+const win32_dirent_t* win32_dirscan_next(win32_dirscan_t* scan) {
+    if (!scan) return NULL;
+    if (scan->replay) {
+        scan->replay = 0;
+        return &scan->cur;
+    }
+
+    /* No wildcards: one lookup instead of a scan. A case mismatch falls
+     * through to the scan, which matches case-insensitively. */
+    if (scan->pat.kind == PAT_LITERAL && !scan->literal_done) {
+        scan->literal_done = 1;
+        struct stat st;
+        if (!lsw_overlay_is_whiteout_name(scan->pat.text) &&
+            (fstatat(scan->fd, scan->pat.text, &st, 0) == 0 ||
+             fstatat(scan->fd, scan->pat.text, &st, AT_SYMLINK_NOFOLLOW) == 0)) {
+            scan->eof = 1;
+            if (scan->other_fd >= 0) {
+                /* The base layer cannot add another exact match */
+                close(scan->other_fd);
+                scan->other_fd = -1;
+            }
+            fill_entry(scan, scan->pat.text, scan->pat.len, (uint64_t)st.st_ino,
+                       S_ISDIR(st.st_mode) ? DT_DIR : DT_REG, &st);
+            return &scan->cur;
+        }
+        if (scan->pat.case_sensitive && scan->other_fd < 0) scan->eof = 1;
+    }
+
+    for (;;) {
+        if (scan->pos >= scan->len) {
+            if (scan->eof) return NULL;
+            long n = syscall(SYS_getdents64, scan->fd, scan->buf, scan->cap);
+            if (n <= 0 && scan->other_fd >= 0 && !scan->in_lower) {
+                /* Upper layer done: continue with the base */
+                scan_swap_layers(scan);
+                lseek(scan->fd, 0, SEEK_SET);
+                continue;
+            }
+            if (n <= 0) {
+                scan->eof = 1;
+                return NULL;
+            }
+            scan->len = (size_t)n;
+            scan->pos = 0;
+        }
+        struct linux_dirent64* d = (struct linux_dirent64*)(void*)(scan->buf + scan->pos);
+        scan->pos += d->d_reclen;
+
+        size_t len = strlen(d->d_name);
+        if (!win32_pattern_match(&scan->pat, d->d_name, len)) continue;
+        if (scan->other_fd >= 0 && scan_hidden(scan, d->d_name)) continue;
+        if ((scan->flags & WIN32_DIRSCAN_DIRS_ONLY) &&
+            d->d_type != DT_DIR && d->d_type != DT_LNK && d->d_type != DT_UNKNOWN) {
+            continue;
+        }
+        fill_entry(scan, d->d_name, len, d->d_ino, d->d_type, NULL);
+        return &scan->cur;
+    }
+}
+
+void win32_dirscan_unget(win32_dirscan_t* scan) {
+    if (scan) scan->replay = 1;
+}
+
+void win32_dirscan_rewind(win32_dirscan_t* scan, const char* pattern) {
+    if (!scan) return;
+    if (scan->in_lower) scan_swap_layers(scan);
+    lseek(scan->fd, 0, SEEK_SET);
+    scan->len = scan->pos = 0;
+    scan->eof = scan->literal_done = scan->replay = 0;
+    if (pattern) {
+        win32_pattern_compile(&scan->pat, pattern, scan->pat.case_sensitive);
+    }
+}
+
+void win32_dirscan_close(win32_dirscan_t* scan) {
+    if (!scan) return;
+    if (scan->in_lower) scan_swap_layers(scan);
+    if (scan->owns_fd) close(scan->fd);
+    if (scan->other_fd >= 0) close(scan->other_fd);
+    free(scan->buf);
+    free(scan);
+}
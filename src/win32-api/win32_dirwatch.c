@@ -0,0 +1,665 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 directory change notifications
+ *
+ * Each watch owns an inotify instance; one watcher thread waits on all
+ * of them through epoll. Raw inotify events are translated into
+ * FILE_ACTION_* records (rename pairs are joined by cookie), filtered
+ * by the FILE_NOTIFY_CHANGE_* mask, coalesced, and queued until a
+ * reader collects them. Recursive watches add a watch per subdirectory
+ * and follow creates, renames and deletes to keep the set current.
+ *
+ * fanotify would avoid the per-directory watches but needs
+ * CAP_SYS_ADMIN, which Windows applications under LSW never have.
+ */
+
+#define _GNU_SOURCE  /* inotify_init1, epoll_create1, fstatat */
+
+#include "win32_dirwatch.h"
+#include "win32_unicode.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+
+#define DW_MAX_QUEUED  16384        /* queued records before reporting overflow */
+#define DW_READ_BUF    (64 * 1024)
+#define DW_PATH_MAX    4096
+
+typedef struct dw_event {
+    struct dw_event* next;
+    uint32_t action;
+    uint32_t len;                   /* UTF-16 units */
+    uint16_t name[];
+} dw_event_t;
+
+typedef struct {
+    int   wd;
+    char* rel;                      /* path below the root, "" for the root */
+} dw_wd_t;
+
+struct win32_dirwatch {
+    struct win32_dirwatch* next;
+    uint64_t id;                    /* epoll cookie; survives a racing close */
+    int      ifd;
+    int      recursive;
+    uint32_t filter;
+    uint32_t mask;
+    int      refs;                  /* list + blocked readers + get() callers */
+    int      closed;
+    char*    root;
+    dw_wd_t* wds;
+    size_t   nwd, capwd;
+    dw_event_t* head;
+    dw_event_t* tail;
+    size_t   queued;
+    int      overflow;
+    uint64_t seq;                   /* bumped on every new record / overflow */
+    void*    rbuf;                  /* parked asynchronous read */
+    uint32_t rlen;
+    win32_dirwatch_cb rcb;
+    void*    rctx;
+    void   (*signal)(void*);
+    void*    sctx;
+};
+
+/* A read completed under the engine lock; its callback runs after unlocking */
+typedef struct {
+    win32_dirwatch_cb cb;
+    void*    ctx;
+    uint32_t bytes;
+    int      status;
+} dw_done_t;
+
+static pthread_mutex_t g_dw_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_dw_cond = PTHREAD_COND_INITIALIZER;   /* synchronous readers */
+static pthread_once_t  g_dw_once = PTHREAD_ONCE_INIT;
+static int             g_dw_epfd = -1;
+static win32_dirwatch_t* g_dw_list;
+static uint64_t        g_dw_next_id = 1;
+
+// ============================================================================
+// Watch descriptors (engine lock held)
+// ============================================================================
+
+static int dw_wd_find(const win32_dirwatch_t* w, int wd) {
+    for (size_t i = 0; i < w->nwd; i++) {
+        if (w->wds[i].wd == wd) return (int)i;
+    }
+    return -1;
+}
+
+static void dw_wd_set(win32_dirwatch_t* w, int wd, const char* rel) {
+    char* copy = strdup(rel);
+    if (!copy) return;
+    int i = dw_wd_find(w, wd);
+    if (i >= 0) {
+        free(w->wds[i].rel);
+        w->wds[i].rel = copy;
+        return;
+    }
+    if (w->nwd == w->capwd) {
+        size_t cap = w->capwd ? w->capwd * 2 : 16;
+        dw_wd_t* grown = realloc(w->wds, cap * sizeof(*grown));
+        if (!grown) { free(copy); return; }
+        w->wds = grown;
+        w->capwd = cap;
+    }
+    w->wds[w->nwd++] = (dw_wd_t){ wd, copy };
+}
+
+static uint32_t dw_mask(int recursive, uint32_t filter) {
+    uint32_t mask = IN_EXCL_UNLINK;
+    /* Recursive watches follow directory creates/renames whatever the filter */
+    if (recursive || (filter & (WIN32_NOTIFY_CHANGE_FILE_NAME | WIN32_NOTIFY_CHANGE_DIR_NAME)))
+        mask |= IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    if (filter & (WIN32_NOTIFY_CHANGE_SIZE | WIN32_NOTIFY_CHANGE_LAST_WRITE))
+        mask |= IN_MODIFY;
+    if (filter & (WIN32_NOTIFY_CHANGE_ATTRIBUTES | WIN32_NOTIFY_CHANGE_SECURITY |
+                  WIN32_NOTIFY_CHANGE_LAST_WRITE | WIN32_NOTIFY_CHANGE_CREATION))
+        mask |= IN_ATTRIB;
+    if (filter & WIN32_NOTIFY_CHANGE_LAST_ACCESS)
+        mask |= IN_ACCESS;
+    return mask;
+}
+
+static void dw_wd_remove(win32_dirwatch_t* w, size_t i) {
+    free(w->wds[i].rel);
+    w->wds[i] = w->wds[--w->nwd];
+}
+
+static int dw_under(const char* rel, const char* prefix, size_t n) {
+    return strncmp(rel, prefix, n) == 0 && (rel[n] == '\0' || rel[n] == '/');
+}
+
+// A watched directory left the tree: forget it and everything below
+static void dw_drop_prefix(win32_dirwatch_t* w, const char* prefix) {
+    size_t n = strlen(prefix);
+    for (size_t i = 0; i < w->nwd; ) {
+        if (dw_under(w->wds[i].rel, prefix, n)) {
+            inotify_rm_watch(w->ifd, w->wds[i].wd);
+            dw_wd_remove(w, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+// A watched directory was renamed inside the tree: the wds stay valid
+static void dw_rename_prefix(win32_dirwatch_t* w, const char* from, const char* to) {
+    size_t n = strlen(from);
+    for (size_t i = 0; i < w->nwd; i++) {
+        if (!dw_under(w->wds[i].rel, from, n)) continue;
+        char rel[DW_PATH_MAX];
+        if (snprintf(rel, sizeof(rel), "%s%s", to, w->wds[i].rel + n) >= (int)sizeof(rel)) continue;
+        char* copy = strdup(rel);
+        if (!copy) continue;
+        free(w->wds[i].rel);
+        w->wds[i].rel = copy;
+    }
+}
+
+static void dw_join(char* out, size_t cap, const char* a, const char* b) {
+    if (!a[0]) snprintf(out, cap, "%s", b);
+    else       snprintf(out, cap, "%s/%s", a, b);
+}
+
+static void dw_queue(win32_dirwatch_t* w, uint32_t action, const char* rel);
+
+/*
+ * Watch `rel` and, for recursive watches, every directory below it.
+ * With `report`, entries found are queued as ADDED: for a directory that
+ * was just created they may predate its watch.
+ */
+static int dw_add_tree(win32_dirwatch_t* w, const char* rel, int report) {
+    char* path = malloc(DW_PATH_MAX);
+    if (!path) return -1;
+    dw_join(path, DW_PATH_MAX, w->root, rel);
+    if (!rel[0]) snprintf(path, DW_PATH_MAX, "%s", w->root);
+
+    /* The root may be a symlink; below it, links are not followed */
+    uint32_t mask = w->mask | IN_ONLYDIR | (rel[0] ? IN_DONT_FOLLOW : 0);
+    int wd = inotify_add_watch(w->ifd, path, mask);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            LSW_LOG_WARN("dirwatch: inotify watch limit reached under %s", w->root);
+        }
+        free(path);
+        return -1;
+    }
+    dw_wd_set(w, wd, rel);
+
+    DIR* dir = w->recursive ? opendir(path) : NULL;
+    if (dir) {
+        struct dirent* de;
+        char* sub = malloc(DW_PATH_MAX);
+        while (sub && (de = readdir(dir)) != NULL) {
+            if (de->d_name[0] == '.' &&
+                (de->d_name[1] == '\0' || (de->d_name[1] == '.' && de->d_name[2] == '\0'))) {
+                continue;
+            }
+            int is_dir = de->d_type == DT_DIR;
+            if (de->d_type == DT_UNKNOWN) {
+                struct stat st;
+                is_dir = fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+                         S_ISDIR(st.st_mode);
+            }
+            dw_join(sub, DW_PATH_MAX, rel, de->d_name);
+            if (report && (w->filter & (is_dir ? WIN32_NOTIFY_CHANGE_DIR_NAME
+                                               : WIN32_NOTIFY_CHANGE_FILE_NAME))) {
+                dw_queue(w, WIN32_FILE_ACTION_ADDED, sub);
+            }
+            if (is_dir) dw_add_tree(w, sub, report);
+        }
+        free(sub);
+        closedir(dir);
+    }
+    free(path);
+    return 0;
+}
+
+// ============================================================================
+// Event queue (engine lock held)
+// ============================================================================
+
+static void dw_clear(win32_dirwatch_t* w) {
+    dw_event_t* e = w->head;
+    while (e) { dw_event_t* n = e->next; free(e); e = n; }
+    w->head = w->tail = NULL;
+    w->queued = 0;
+}
+
+static void dw_set_overflow(win32_dirwatch_t* w) {
+    dw_clear(w);
+    w->overflow = 1;
+    w->seq++;
+}
+
+static void dw_queue(win32_dirwatch_t* w, uint32_t action, const char* rel) {
+    if (w->overflow) return;                       /* the reader rescans anyway */
+    if (w->queued >= DW_MAX_QUEUED) {
+        dw_set_overflow(w);
+        return;
+    }
+
+    size_t n = strlen(rel);
+    dw_event_t* e = malloc(sizeof(*e) + (n + 1) * sizeof(uint16_t));
+    if (!e) { dw_set_overflow(w); return; }
+    ptrdiff_t len = win32_utf8_to_utf16((const uint8_t*)rel, n, e->name, n + 1, 0);
+    e->len = len > 0 ? (uint32_t)len : 0;
+    for (uint32_t i = 0; i < e->len; i++) {
+        if (e->name[i] == '/') e->name[i] = '\\';
+    }
+    e->action = action;
+    e->next = NULL;
+
+    /* A write loop produces a MODIFIED per write(); report it once */
+    dw_event_t* t = w->tail;
+    if (action == WIN32_FILE_ACTION_MODIFIED && t && t->action == action && t->len == e->len &&
+        memcmp(t->name, e->name, e->len * sizeof(uint16_t)) == 0) {
+        free(e);
+        return;
+    }
+
+    if (t) t->next = e; else w->head = e;
+    w->tail = e;
+    w->queued++;
+    w->seq++;
+}
+
+static void dw_process(win32_dirwatch_t* w, const char* buf, size_t n) {
+    char path[DW_PATH_MAX], to[DW_PATH_MAX];
+
+    for (const char* p = buf; p < buf + n; ) {
+        const struct inotify_event* ev = (const struct inotify_event*)(const void*)p;
+        p += sizeof(*ev) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+            dw_set_overflow(w);
+            continue;
+        }
+        int idx = dw_wd_find(w, ev->wd);
+        if (ev->mask & IN_IGNORED) {
+            if (idx >= 0) dw_wd_remove(w, (size_t)idx);
+            continue;
+        }
+        if (idx < 0 || ev->len == 0) continue;     /* events on the directory itself */
+
+        dw_join(path, sizeof(path), w->wds[idx].rel, ev->name);
+        int is_dir = (ev->mask & IN_ISDIR) != 0;
+        uint32_t name_bit = is_dir ? WIN32_NOTIFY_CHANGE_DIR_NAME : WIN32_NOTIFY_CHANGE_FILE_NAME;
+        int names = (w->filter & name_bit) != 0;
+
+        if (ev->mask & IN_MOVED_FROM) {
+            /* The matching IN_MOVED_TO follows immediately when both ends are watched */
+            const struct inotify_event* nx = (p < buf + n) ? (const struct inotify_event*)(const void*)p : NULL;
+            int nidx = (nx && (nx->mask & IN_MOVED_TO) && nx->cookie == ev->cookie && nx->len)
+                       ? dw_wd_find(w, nx->wd) : -1;
+            if (nidx >= 0) {
+                p += sizeof(*nx) + nx->len;
+                dw_join(to, sizeof(to), w->wds[nidx].rel, nx->name);
+                if (names) {
+                    dw_queue(w, WIN32_FILE_ACTION_RENAMED_OLD_NAME, path);
+                    dw_queue(w, WIN32_FILE_ACTION_RENAMED_NEW_NAME, to);
+                }
+                if (is_dir && w->recursive) dw_rename_prefix(w, path, to);
+            } else {
+                if (names) dw_queue(w, WIN32_FILE_ACTION_REMOVED, path);
+                if (is_dir && w->recursive) dw_drop_prefix(w, path);
+            }
+            continue;
+        }
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+            if (names) dw_queue(w, WIN32_FILE_ACTION_ADDED, path);
+            if (is_dir && w->recursive) dw_add_tree(w, path, (ev->mask & IN_CREATE) != 0);
+            continue;
+        }
+        if (ev->mask & IN_DELETE) {
+            if (names) dw_queue(w, WIN32_FILE_ACTION_REMOVED, path);
+            continue;
+        }
+        if (is_dir) continue;                      /* MODIFIED is reported for files */
+
+        if (((ev->mask & IN_MODIFY) &&
+             (w->filter & (WIN32_NOTIFY_CHANGE_SIZE | WIN32_NOTIFY_CHANGE_LAST_WRITE))) ||
+            ((ev->mask & IN_ATTRIB) &&
+             (w->filter & (WIN32_NOTIFY_CHANGE_ATTRIBUTES | WIN32_NOTIFY_CHANGE_SECURITY |
+                           WIN32_NOTIFY_CHANGE_LAST_WRITE | WIN32_NOTIFY_CHANGE_CREATION))) ||
+            ((ev->mask & IN_ACCESS) && (w->filter & WIN32_NOTIFY_CHANGE_LAST_ACCESS))) {
+            dw_queue(w, WIN32_FILE_ACTION_MODIFIED, path);
+        }
+    }
+}
+
+/*
+ * Move queued records into `buf` as FILE_NOTIFY_INFORMATION:
+ *   DWORD NextEntryOffset; DWORD Action; DWORD FileNameLength; WCHAR FileName[]
+ * Records are DWORD aligned. If not even the first fits, the batch is
+ * dropped and reported as an overflow, like Windows.
+ */
+static int dw_format(win32_dirwatch_t* w, void* buf, uint32_t len, uint32_t* bytes) {
+    *bytes = 0;
+    if (w->overflow) {
+        w->overflow = 0;
+        return WIN32_DIRWATCH_OVERFLOW;
+    }
+
+    uint8_t* out = buf;
+    uint32_t off = 0, last = 0;
+    while (w->head) {
+        dw_event_t* e = w->head;
+        uint32_t name_bytes = e->len * 2;
+        uint32_t rec = (12 + name_bytes + 3) & ~3u;
+        if (off + 12 + name_bytes > len) break;
+
+        uint32_t hdr[3] = { 0, e->action, name_bytes };
+        memcpy(out + off, hdr, sizeof(hdr));
+        memcpy(out + off + 12, e->name, name_bytes);
+        if (off) {
+            uint32_t next = off - last;
+            memcpy(out + last, &next, sizeof(next));
+        }
+        last = off;
+        off += rec;
+
+        w->head = e->next;
+        if (!w->head) w->tail = NULL;
+        w->queued--;
+        free(e);
+    }
+    if (off == 0) {
+        dw_clear(w);
+        return WIN32_DIRWATCH_OVERFLOW;
+    }
+    *bytes = off < len ? off : len;
+    return WIN32_DIRWATCH_OK;
+}
+
+// Detach the parked read, if any, into `d` with its result
+static int dw_take_read(win32_dirwatch_t* w, dw_done_t* d, uint32_t bytes, int status) {
+    d->cb = w->rcb;
+    d->ctx = w->rctx;
+    d->bytes = bytes;
+    d->status = status;
+    w->rcb = NULL;
+    return d->cb != NULL;
+}
+
+// Run a detached read's callback; engine lock not held
+static void dw_complete(const dw_done_t* d) {
+    if (d->cb) d->cb(d->ctx, d->bytes, d->status);
+}
+
+/*
+ * New records arrived: fill a parked read into `d`, signal, wake sync
+ * readers. Returns 1 if `d` holds a completion to run after unlocking.
+ */
+static int dw_deliver(win32_dirwatch_t* w, dw_done_t* d) {
+    int done = 0;
+    if (w->rcb && (w->head || w->overflow)) {
+        uint32_t bytes;
+        int st = dw_format(w, w->rbuf, w->rlen, &bytes);
+        done = dw_take_read(w, d, bytes, st);
+    }
+    if (w->signal) w->signal(w->sctx);
+    pthread_cond_broadcast(&g_dw_cond);
+    return done;
+}
+
+// ============================================================================
+// Watcher thread
+// ============================================================================
+
+static void dw_free(win32_dirwatch_t* w) {
+    if (w->ifd >= 0) close(w->ifd);
+    for (size_t i = 0; i < w->nwd; i++) free(w->wds[i].rel);
+    free(w->wds);
+    dw_clear(w);
+    free(w->root);
+    free(w);
+}
+
+static void* dw_thread(void* arg) {
+    (void)arg;
+    char* buf = malloc(DW_READ_BUF);
+    struct epoll_event evs[16];
+    dw_done_t done[16];
+    while (buf) {
+        int n = epoll_wait(g_dw_epfd, evs, 16, -1);
+        int ndone = 0;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LSW_LOG_ERROR("dirwatch: epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        pthread_mutex_lock(&g_dw_lock);
+        for (int i = 0; i < n; i++) {
+            win32_dirwatch_t* w = g_dw_list;
+            while (w && w->id != evs[i].data.u64) w = w->next;
+            if (!w) continue;                      /* closed since epoll_wait returned */
+
+            uint64_t seq = w->seq;
+            ssize_t r;
+            while ((r = read(w->ifd, buf, DW_READ_BUF)) > 0) {
+                dw_process(w, buf, (size_t)r);
+            }
+            if (w->seq != seq && dw_deliver(w, &done[ndone])) ndone++;
+        }
+        pthread_mutex_unlock(&g_dw_lock);
+        for (int i = 0; i < ndone; i++) dw_complete(&done[i]);
+    }
+    free(buf);
+    return NULL;
+}
+
+static void dw_start(void) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        LSW_LOG_ERROR("dirwatch: epoll_create1 failed: %s", strerror(errno));
+        return;
+    }
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    g_dw_epfd = epfd;
+    if (pthread_create(&th, &attr, dw_thread, NULL) != 0) {
+        LSW_LOG_ERROR("dirwatch: watcher thread failed to start");
+        close(epfd);
+        g_dw_epfd = -1;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+win32_dirwatch_t* win32_dirwatch_open(const char* path, int recursive, uint32_t filter) {
+    pthread_once(&g_dw_once, dw_start);
+    if (g_dw_epfd < 0) { errno = ENOSYS; return NULL; }
+
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    if (!S_ISDIR(st.st_mode)) { errno = ENOTDIR; return NULL; }
+
+    win32_dirwatch_t* w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    w->root = strdup(path);
+    if (w->ifd < 0 || !w->root) {
+        int err = errno;
+        dw_free(w);
+        errno = err;
+        return NULL;
+    }
+    size_t rl = strlen(w->root);
+    while (rl > 1 && w->root[rl - 1] == '/') w->root[--rl] = '\0';
+
+    w->recursive = recursive != 0;
+    w->filter = filter;
+    w->mask = dw_mask(recursive, filter);
+    w->refs = 1;
+
+    pthread_mutex_lock(&g_dw_lock);
+    if (dw_add_tree(w, "", 0) != 0) {
+        int err = errno;
+        pthread_mutex_unlock(&g_dw_lock);
+        dw_free(w);
+        errno = err;
+        return NULL;
+    }
+    w->id = g_dw_next_id++;
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = w->id };
+    if (epoll_ctl(g_dw_epfd, EPOLL_CTL_ADD, w->ifd, &ev) != 0) {
+        int err = errno;
+        pthread_mutex_unlock(&g_dw_lock);
+        dw_free(w);
+        errno = err;
+        return NULL;
+    }
+    w->next = g_dw_list;
+    g_dw_list = w;
+    size_t nwd = w->nwd;
+    pthread_mutex_unlock(&g_dw_lock);
+
+    LSW_LOG_DEBUG("dirwatch: %s (recursive=%d filter=0x%x, %zu dirs)", path, recursive, filter, nwd);
+    return w;
+}
+
+int win32_dirwatch_configure(win32_dirwatch_t* w, int recursive, uint32_t filter) {
+    int ret = 0;
+    recursive = recursive != 0;
+    pthread_mutex_lock(&g_dw_lock);
+    if (w->closed || (w->recursive == recursive && w->filter == filter)) {
+        pthread_mutex_unlock(&g_dw_lock);
+        return 0;
+    }
+    if (w->recursive && !recursive) {
+        for (size_t i = 0; i < w->nwd; ) {
+            if (w->wds[i].rel[0]) {
+                inotify_rm_watch(w->ifd, w->wds[i].wd);
+                dw_wd_remove(w, i);
+            } else {
+                i++;
+            }
+        }
+    }
+    w->recursive = recursive;
+    w->filter = filter;
+    w->mask = dw_mask(recursive, filter);
+    /* Re-adding a watched directory replaces its mask; new subdirectories are added */
+    if (dw_add_tree(w, "", 0) != 0) ret = -1;
+    size_t nwd = w->nwd;
+    pthread_mutex_unlock(&g_dw_lock);
+
+    LSW_LOG_DEBUG("dirwatch: %s now recursive=%d filter=0x%x, %zu dirs", w->root, recursive, filter, nwd);
+    return ret;
+}
+
+void win32_dirwatch_set_signal(win32_dirwatch_t* w, void (*fn)(void* ctx), void* ctx) {
+    pthread_mutex_lock(&g_dw_lock);
+    w->signal = fn;
+    w->sctx = ctx;
+    pthread_mutex_unlock(&g_dw_lock);
+}
+
+int win32_dirwatch_read(win32_dirwatch_t* w, void* buf, uint32_t len, uint32_t* bytes,
+                        win32_dirwatch_cb cb, void* ctx) {
+    int st;
+    *bytes = 0;
+    pthread_mutex_lock(&g_dw_lock);
+    if (!w->head && !w->overflow) {
+        if (w->closed) {
+            pthread_mutex_unlock(&g_dw_lock);
+            return WIN32_DIRWATCH_CANCELLED;
+        }
+        if (cb) {
+            /* One outstanding read per handle: the older one is superseded */
+            dw_done_t old;
+            dw_take_read(w, &old, 0, WIN32_DIRWATCH_CANCELLED);
+            w->rbuf = buf;
+            w->rlen = len;
+            w->rcb = cb;
+            w->rctx = ctx;
+            pthread_mutex_unlock(&g_dw_lock);
+            dw_complete(&old);
+            return WIN32_DIRWATCH_PENDING;
+        }
+        w->refs++;
+        while (!w->head && !w->overflow && !w->closed) {
+            pthread_cond_wait(&g_dw_cond, &g_dw_lock);
+        }
+        if (--w->refs == 0) {
+            pthread_mutex_unlock(&g_dw_lock);
+            dw_free(w);
+            return WIN32_DIRWATCH_CANCELLED;
+        }
+        if (w->closed) {
+            pthread_mutex_unlock(&g_dw_lock);
+            return WIN32_DIRWATCH_CANCELLED;
+        }
+    }
+    st = dw_format(w, buf, len, bytes);
+    pthread_mutex_unlock(&g_dw_lock);
+    return st;
+}
+
+int win32_dirwatch_cancel(win32_dirwatch_t* w) {
+    dw_done_t d;
+    pthread_mutex_lock(&g_dw_lock);
+    int found = dw_take_read(w, &d, 0, WIN32_DIRWATCH_CANCELLED);
+    pthread_mutex_unlock(&g_dw_lock);
+    dw_complete(&d);
+    return found;
+}
+
+void win32_dirwatch_discard(win32_dirwatch_t* w) {
+    pthread_mutex_lock(&g_dw_lock);
+    dw_clear(w);
+    w->overflow = 0;
+    pthread_mutex_unlock(&g_dw_lock);
+}
+
+void win32_dirwatch_close(win32_dirwatch_t* w) {
+    if (!w) return;
+    pthread_mutex_lock(&g_dw_lock);
+    win32_dirwatch_t** pp = &g_dw_list;
+    while (*pp && *pp != w) pp = &(*pp)->next;
+    if (*pp) *pp = w->next;
+    epoll_ctl(g_dw_epfd, EPOLL_CTL_DEL, w->ifd, NULL);
+
+    dw_done_t d;
+    dw_take_read(w, &d, 0, WIN32_DIRWATCH_CANCELLED);
+    w->signal = NULL;
+    w->closed = 1;
+    pthread_cond_broadcast(&g_dw_cond);
+    int last = (--w->refs == 0);
+    pthread_mutex_unlock(&g_dw_lock);
+    dw_complete(&d);
+    if (last) dw_free(w);
+}
+
+void win32_dirwatch_get(win32_dirwatch_t* w) {
+    pthread_mutex_lock(&g_dw_lock);
+    w->refs++;
+    pthread_mutex_unlock(&g_dw_lock);
+}
+
+void win32_dirwatch_put(win32_dirwatch_t* w) {
+    pthread_mutex_lock(&g_dw_lock);
+    int last = (--w->refs == 0);
+    pthread_mutex_unlock(&g_dw_lock);
+    if (last) dw_free(w);
+}
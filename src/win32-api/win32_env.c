@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 process environment
+ *
+ * One sorted table of variables serves GetEnvironmentVariable,
+ * GetEnvironmentStrings, the CRT getenv family and
+ * RtlQueryEnvironmentVariable. Each entry keeps the Linux value from
+ * environ plus its Windows form, translated the first time somebody
+ * asks and cached until the variable changes; the UTF-16 form is cached
+ * the same way. Readers share a rwlock and fill the lazy fields with a
+ * compare-and-swap, so a PATH lookup no longer re-translates the whole
+ * list (into a shared static buffer) on every call.
+ *
+ * Writers replace entries under the write lock, mirror the Linux form
+ * into environ and bump the generation, which also keys the cached
+ * environment blocks and PATH directory list.
+ */
+
+#define _GNU_SOURCE  /* strcasecmp, strndup */
+
+#include "win32_env.h"
+#include "win32_unicode.h"
+#include "lsw_filesystem.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define ENV_NAME_MAX  1024          /* UTF-8 bytes of a name looked up by UTF-16 */
+#define ENV_PATH_MAX  4096
+
+enum {
+    ENV_PLAIN = 0,
+    ENV_PATH,                       /* one path, translated when absolute */
+    ENV_PATH_LIST                   /* ':' list on Linux, ';' list on Windows */
+};
+
+static const struct {
+    const char* name;
+    int kind;
+} g_translated[] = {
+    { "PATH",         ENV_PATH_LIST },
+    { "TEMP",         ENV_PATH },
+    { "TMP",          ENV_PATH },
+    { "USERPROFILE",  ENV_PATH },
+    { "APPDATA",      ENV_PATH },
+    { "LOCALAPPDATA", ENV_PATH },
+};
+
+typedef struct {
+    char*     name;
+    char*     linux_value;          /* as in environ */
+    char*     value;                /* Windows form; NULL until first read */
+    uint16_t* wvalue;               /* UTF-16 of value; NULL until first read */
+    int       kind;
+} env_var_t;
+
+static pthread_once_t   g_env_once = PTHREAD_ONCE_INIT;
+static pthread_rwlock_t g_env_lock = PTHREAD_RWLOCK_INITIALIZER;
+static env_var_t**      g_vars;
+static size_t           g_count;
+static size_t           g_cap;
+static uint64_t         g_env_gen = 1;
+
+// ============================================================================
+// SECTION: Translation
+// ============================================================================
+
+typedef struct {
+    char*  p;
+    size_t len;
+    size_t cap;
+} env_buf_t;
+
+static int eb_put(env_buf_t* b, const char* s, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap ? b->cap : 256;
+        while (cap < b->len + n + 1) cap *= 2;
+        char* p = realloc(b->p, cap);
+        if (!p) return -1;
+        b->p = p;
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, s, n);
+    b->len += n;
+    b->p[b->len] = '\0';
+    return 0;
+}
+
+static int env_kind(const char* name) {
+    for (size_t i = 0; i < sizeof(g_translated) / sizeof(g_translated[0]); i++)
+        if (strcasecmp(name, g_translated[i].name) == 0) return g_translated[i].kind;
+    return ENV_PLAIN;
+}
+
+static int env_is_drive_path(const char* s, size_t n) {
+    return n >= 2 && s[1] == ':' &&
+           ((s[0] >= 'A' && s[0] <= 'Z') || (s[0] >= 'a' && s[0] <= 'z'));
+}
+
+/* One component; anything that is not an absolute path passes unchanged */
+static int env_put_path(env_buf_t* b, const char* s, size_t n, int to_win) {
+    if (n == 0 || n >= ENV_PATH_MAX ||
+        (to_win ? s[0] != '/' : !env_is_drive_path(s, n)))
+        return eb_put(b, s, n);
+
+    char in[ENV_PATH_MAX], out[ENV_PATH_MAX];
+    memcpy(in, s, n);
+    in[n] = '\0';
+    lsw_status_t st = to_win ? lsw_fs_linux_to_win(in, out, sizeof(out))
+                             : lsw_fs_win_to_linux(in, out, sizeof(out));
+    if (st != LSW_SUCCESS) {
+        /* Outside every drive: keep the path, flip the separators */
+        for (size_t i = 0; i < n; i++)
+            if (in[i] == (to_win ? '/' : '\\')) in[i] = to_win ? '\\' : '/';
+        return eb_put(b, in, n);
+    }
+    return eb_put(b, out, strlen(out));
+}
+
+/* Translate a value of `kind` between forms; NULL on allocation failure */
+static char* env_translate(const char* value, int kind, int to_win) {
+    if (kind == ENV_PLAIN) return strdup(value);
+
+    env_buf_t b = { 0 };
+    if (eb_put(&b, "", 0) < 0) return NULL;
+    if (kind == ENV_PATH) {
+        if (env_put_path(&b, value, strlen(value), to_win) < 0) goto fail;
+        return b.p;
+    }
+
+    char from = to_win ? ':' : ';';
+    char to   = to_win ? ';' : ':';
+    const char* p = value;
+    for (;;) {
+        const char* sep = strchr(p, from);
+        size_t n = sep ? (size_t)(sep - p) : strlen(p);
+        if (env_put_path(&b, p, n, to_win) < 0) goto fail;
+        if (!sep) break;
+        if (eb_put(&b, &to, 1) < 0) goto fail;
+        p = sep + 1;
+    }
+    return b.p;
+
+fail:
+    free(b.p);
+    return NULL;
+}
+
+// ============================================================================
+// SECTION: Table
+// ============================================================================
+
+static void env_free(env_var_t* v) {
+    if (!v) return;
+    if (v->value != v->linux_value) free(v->value);
+    free(v->wvalue);
+    free(v->linux_value);
+    free(v->name);
+    free(v);
+}
+
+static env_var_t* env_new(const char* name, size_t name_len, const char* linux_value) {
+    env_var_t* v = calloc(1, sizeof(*v));
+    if (!v) return NULL;
+    v->name = strndup(name, name_len);
+    v->linux_value = strdup(linux_value);
+    if (!v->name || !v->linux_value) {
+        env_free(v);
+        return NULL;
+    }
+    v->kind = env_kind(v->name);
+    if (v->kind == ENV_PLAIN) v->value = v->linux_value;
+    return v;
+}
+
+/* Index of name, or -(insertion point) - 1 */
+static ptrdiff_t env_find(const char* name) {
+    size_t lo = 0, hi = g_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcasecmp(g_vars[mid]->name, name);
+        if (c == 0) return (ptrdiff_t)mid;
+        if (c < 0) lo = mid + 1; else hi = mid;
+    }
+    return -(ptrdiff_t)lo - 1;
+}
+
+static int env_insert_at(size_t at, env_var_t* v) {
+    if (g_count == g_cap) {
+        size_t cap = g_cap ? g_cap * 2 : 64;
+        env_var_t** vars = realloc(g_vars, cap * sizeof(*vars));
+        if (!vars) return -1;
+        g_vars = vars;
+        g_cap = cap;
+    }
+    memmove(g_vars + at + 1, g_vars + at, (g_count - at) * sizeof(*g_vars));
+    g_vars[at] = v;
+    g_count++;
+    return 0;
+}
+
+static void env_load(void) {
+    extern char** environ;
+    for (char** e = environ; e && *e; e++) {
+        const char* eq = strchr(*e, '=');
+        if (!eq || eq == *e) continue;
+        env_var_t* v = env_new(*e, (size_t)(eq - *e), eq + 1);
+        if (!v) break;
+        ptrdiff_t at = env_find(v->name);
+        /* Names differing only in case: the first one wins */
+        if (at >= 0 || env_insert_at((size_t)(-at - 1), v) < 0) env_free(v);
+    }
+}
+
+static void env_init(void) {
+    pthread_once(&g_env_once, env_load);
+}
+
+/* Windows value of v, translating it on first use; call with the lock held */
+static const char* env_value(env_var_t* v) {
+    char* value = __atomic_load_n(&v->value, __ATOMIC_ACQUIRE);
+    if (value) return value;
+
+    char* fresh = env_translate(v->linux_value, v->kind, 1);
+    if (!fresh) return v->linux_value;
+    if (!__atomic_compare_exchange_n(&v->value, &value, fresh, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(fresh);
+        return value;
+    }
+    return fresh;
+}
+
+static const uint16_t* env_wvalue(env_var_t* v) {
+    uint16_t* wvalue = __atomic_load_n(&v->wvalue, __ATOMIC_ACQUIRE);
+    if (wvalue) return wvalue;
+
+    const char* value = env_value(v);
+    size_t len = strlen(value);
+    ptrdiff_t n = win32_utf8_to_utf16((const uint8_t*)value, len, NULL, 0, 0);
+    if (n < 0) return NULL;
+    uint16_t* fresh = malloc(((size_t)n + 1) * sizeof(uint16_t));
+    if (!fresh) return NULL;
+    win32_utf8_to_utf16((const uint8_t*)value, len, fresh, (size_t)n, 0);
+    fresh[n] = 0;
+    if (!__atomic_compare_exchange_n(&v->wvalue, &wvalue, fresh, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(fresh);
+        return wvalue;
+    }
+    return fresh;
+}
+
+/* UTF-16 name to UTF-8; false if it does not fit */
+static int env_name_utf8(const uint16_t* name, ptrdiff_t name_len, char* out, size_t size) {
+    size_t len = name_len < 0 ? win32_u16_len(name) : (size_t)name_len;
+    ptrdiff_t n = win32_utf16_to_utf8(name, len, (uint8_t*)out, size - 1, 0);
+    if (n < 0) return 0;
+    out[n] = '\0';
+    return 1;
+}
+
+// ============================================================================
+// SECTION: Queries
+// ============================================================================
+
+uint64_t win32_env_generation(void) {
+    env_init();
+    return __atomic_load_n(&g_env_gen, __ATOMIC_ACQUIRE);
+}
+
+uint32_t win32_env_get(const char* name, char* buf, uint32_t size) {
+    if (!name) return 0;
+    env_init();
+
+    uint32_t ret = 0;
+    pthread_rwlock_rdlock(&g_env_lock);
+    ptrdiff_t i = env_find(name);
+    if (i >= 0) {
+        const char* value = env_value(g_vars[i]);
+        size_t len = strlen(value);
+        if (buf && len < size) {
+            memcpy(buf, value, len + 1);
+            ret = (uint32_t)len;
+        } else {
+            ret = (uint32_t)(len + 1);
+        }
+    }
+    pthread_rwlock_unlock(&g_env_lock);
+    return ret;
+}
+
+uint32_t win32_env_get_w(const uint16_t* name, ptrdiff_t name_len, uint16_t* buf, uint32_t size) {
+    char name8[ENV_NAME_MAX];
+    if (!name || !env_name_utf8(name, name_len, name8, sizeof(name8))) return 0;
+    env_init();
+
+    uint32_t ret = 0;
+    pthread_rwlock_rdlock(&g_env_lock);
+    ptrdiff_t i = env_find(name8);
+    const uint16_t* value = i >= 0 ? env_wvalue(g_vars[i]) : NULL;
+    if (value) {
+        size_t len = win32_u16_len(value);
+        if (buf && len < size) {
+            memcpy(buf, value, (len + 1) * sizeof(uint16_t));
+            ret = (uint32_t)len;
+        } else {
+            ret = (uint32_t)(len + 1);
+        }
+    }
+    pthread_rwlock_unlock(&g_env_lock);
+    return ret;
+}
+
+const char* win32_env_peek(const char* name) {
+    if (!name) return NULL;
+    env_init();
+
+    pthread_rwlock_rdlock(&g_env_lock);
+    ptrdiff_t i = env_find(name);
+    const char* value = i >= 0 ? env_value(g_vars[i]) : NULL;
+    pthread_rwlock_unlock(&g_env_lock);
+    return value;
+}
+
+const uint16_t* win32_env_peek_w(const uint16_t* name, ptrdiff_t name_len) {
+    char name8[ENV_NAME_MAX];
+    if (!name || !env_name_utf8(name, name_len, name8, sizeof(name8))) return NULL;
+    env_init();
+
+    pthread_rwlock_rdlock(&g_env_lock);
+    ptrdiff_t i = env_find(name8);
+    const uint16_t* value = i >= 0 ? env_wvalue(g_vars[i]) : NULL;
+    pthread_rwlock_unlock(&g_env_lock);
+    return value;
+}
+
+// ============================================================================
+// SECTION: Updates
+// ============================================================================
+
+int win32_env_set(const char* name, const char* value, int overwrite) {
+    /* "=C:"-style names are legal on Windows; they just never reach environ */
+    if (!name || !name[0] || strchr(name + 1, '=')) return EINVAL;
+    env_init();
+
+    env_var_t* v = NULL;
+    if (value) {
+        int kind = env_kind(name);
+        char* linux_value = env_translate(value, kind, 0);
+        if (!linux_value) return ENOMEM;
+        v = env_new(name, strlen(name), linux_value);
+        free(linux_value);
+        if (!v) return ENOMEM;
+        if (kind != ENV_PLAIN && !(v->value = strdup(value))) {
+            env_free(v);
+            return ENOMEM;
+        }
+    }
+
+    env_var_t* old = NULL;
+    int changed = 0, err = 0;
+    pthread_rwlock_wrlock(&g_env_lock);
+    ptrdiff_t i = env_find(name);
+    if (i >= 0 && v && !overwrite) {
+        old = v;                    /* keep the current value */
+    } else if (i >= 0) {
+        old = g_vars[i];
+        if (v) {
+            /* Keep the name's original spelling */
+            char* spelling = v->name;
+            v->name = old->name;
+            old->name = spelling;
+            g_vars[i] = v;
+        } else {
+            memmove(g_vars + i, g_vars + i + 1, (g_count - (size_t)i - 1) * sizeof(*g_vars));
+            g_count--;
+        }
+        changed = 1;
+    } else if (v) {
+        if (env_insert_at((size_t)(-i - 1), v) == 0) {
+            changed = 1;
+        } else {
+            old = v;
+            err = ENOMEM;
+        }
+    }
+    if (changed) {
+        if (name[0] != '=') {
+            /* Children inherit environ */
+            if (v) setenv(v->name, v->linux_value, 1);
+            else unsetenv(old->name);
+        }
+        __atomic_add_fetch(&g_env_gen, 1, __ATOMIC_RELEASE);
+    }
+    pthread_rwlock_unlock(&g_env_lock);
+
+    env_free(old);
+    return err;
+}
+
+int win32_env_set_w(const uint16_t* name, const uint16_t* value) {
+    char name8[ENV_NAME_MAX];
+    if (!name || !env_name_utf8(name, -1, name8, sizeof(name8))) return EINVAL;
+    if (!value) return win32_env_set(name8, NULL, 1);
+
+    size_t len = win32_u16_len(value);
+    ptrdiff_t n = win32_utf16_to_utf8(value, len, NULL, 0, 0);
+    char* value8 = n >= 0 ? malloc((size_t)n + 1) : NULL;
+    if (!value8) return ENOMEM;
+    win32_utf16_to_utf8(value, len, (uint8_t*)value8, (size_t)n, 0);
+    value8[n] = '\0';
+    int err = win32_env_set(name8, value8, 1);
+    free(value8);
+    return err;
+}
+
+void win32_env_reload(void) {
+    env_init();
+    pthread_rwlock_wrlock(&g_env_lock);
+    for (size_t i = 0; i < g_count; i++) env_free(g_vars[i]);
+    g_count = 0;
+    env_load();
+    __atomic_add_fetch(&g_env_gen, 1, __ATOMIC_RELEASE);
+    pthread_rwlock_unlock(&g_env_lock);
+}
+
+// ============================================================================
+// SECTION: Blocks
+// ============================================================================
+
+static pthread_mutex_t g_block_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint16_t* g_block_w;
+static size_t    g_block_w_units;
+static uint64_t  g_block_w_gen;
+static char*     g_block;
+static size_t    g_block_bytes;
+static uint64_t  g_block_gen;
+static char*     g_path;            /* pointer table + strings, one allocation */
+static size_t    g_path_bytes;
+static size_t    g_path_count;
+static uint64_t  g_path_gen;
+
+/* Rebuild the blocks' caches; call with g_block_lock held */
+static void env_build_w(uint64_t gen) {
+    pthread_rwlock_rdlock(&g_env_lock);
+    size_t units = 1;
+    for (size_t i = 0; i < g_count; i++) {
+        const uint16_t* wv = env_wvalue(g_vars[i]);
+        ptrdiff_t n = win32_utf8_to_utf16((const uint8_t*)g_vars[i]->name,
+                                          strlen(g_vars[i]->name), NULL, 0, 0);
+        units += (size_t)(n > 0 ? n : 0) + 1 + (wv ? win32_u16_len(wv) : 0) + 1;
+    }
+    uint16_t* block = malloc(units * sizeof(uint16_t));
+    if (block) {
+        uint16_t* p = block;
+        for (size_t i = 0; i < g_count; i++) {
+            const uint16_t* wv = env_wvalue(g_vars[i]);
+            ptrdiff_t n = win32_utf8_to_utf16((const uint8_t*)g_vars[i]->name,
+                                              strlen(g_vars[i]->name), p,
+                                              units - (size_t)(p - block), 0);
+            p += n > 0 ? n : 0;
+            *p++ = '=';
+            size_t vl = wv ? win32_u16_len(wv) : 0;
+            if (vl) memcpy(p, wv, vl * sizeof(uint16_t));
+            p += vl;
+            *p++ = 0;
+        }
+        *p++ = 0;
+        free(g_block_w);
+        g_block_w = block;
+        g_block_w_units = (size_t)(p - block);
+        g_block_w_gen = gen;
+    }
+    pthread_rwlock_unlock(&g_env_lock);
+}
+
+static void env_build(uint64_t gen) {
+    pthread_rwlock_rdlock(&g_env_lock);
+    env_buf_t b = { 0 };
+    int ok = 1;
+    for (size_t i = 0; ok && i < g_count; i++) {
+        const char* value = env_value(g_vars[i]);
+        ok = eb_put(&b, g_vars[i]->name, strlen(g_vars[i]->name)) == 0 &&
+             eb_put(&b, "=", 1) == 0 &&
+             eb_put(&b, value, strlen(value) + 1) == 0;
+    }
+    if (ok) ok = eb_put(&b, "", 1) == 0;
+    pthread_rwlock_unlock(&g_env_lock);
+
+    if (!ok) {
+        free(b.p);
+        return;
+    }
+    free(g_block);
+    g_block = b.p;
+    g_block_bytes = b.len;
+    g_block_gen = gen;
+}
+
+static void* env_copy(const void* src, size_t bytes) {
+    void* p = src ? malloc(bytes) : NULL;
+    if (p) memcpy(p, src, bytes);
+    return p;
+}
+
+uint16_t* win32_env_block_w(void) {
+    uint64_t gen = win32_env_generation();
+    pthread_mutex_lock(&g_block_lock);
+    if (!g_block_w || g_block_w_gen != gen) env_build_w(gen);
+    uint16_t* copy = env_copy(g_block_w, g_block_w_units * sizeof(uint16_t));
+    pthread_mutex_unlock(&g_block_lock);
+    return copy;
+}
+
+char* win32_env_block(void) {
+    uint64_t gen = win32_env_generation();
+    pthread_mutex_lock(&g_block_lock);
+    if (!g_block || g_block_gen != gen) env_build(gen);
+    char* copy = env_copy(g_block, g_block_bytes);
+    pthread_mutex_unlock(&g_block_lock);
+    return copy;
+}
+
+static void env_build_path(uint64_t gen) {
+    uint32_t need = win32_env_get("PATH", NULL, 0);
+    char* value = malloc(need ? need : 1);
+    if (!value) return;
+    if (!need || win32_env_get("PATH", value, need) >= need) value[0] = '\0';
+
+    size_t count = 0;
+    for (const char* p = value; *p; ) {
+        const char* sep = strchr(p, ';');
+        if ((sep ? sep : p + strlen(p)) > p) count++;
+        if (!sep) break;
+        p = sep + 1;
+    }
+
+    /* Directories are stored as offsets and rebased when copied out */
+    size_t bytes = count * sizeof(char*) + strlen(value) + 1;
+    char* table = malloc(bytes);
+    if (!table) {
+        free(value);
+        return;
+    }
+    char* str = table + count * sizeof(char*);
+    memcpy(str, value, strlen(value) + 1);
+    size_t n = 0;
+    for (char* p = str; *p; ) {
+        char* sep = strchr(p, ';');
+        if (sep) *sep = '\0';
+        if (*p) ((uintptr_t*)table)[n++] = (uintptr_t)(p - table);
+        if (!sep) break;
+        p = sep + 1;
+    }
+    free(value);
+    free(g_path);
+    g_path = table;
+    g_path_bytes = bytes;
+    g_path_count = count;
+    g_path_gen = gen;
+}
+
+size_t win32_env_path_dirs(char*** dirs) {
+    uint64_t gen = win32_env_generation();
+    pthread_mutex_lock(&g_block_lock);
+    if (!g_path || g_path_gen != gen) env_build_path(gen);
+    char* copy = env_copy(g_path, g_path_bytes);
+    size_t count = copy ? g_path_count : 0;
+    pthread_mutex_unlock(&g_block_lock);
+
+    for (size_t i = 0; i < count; i++)
+        ((char**)copy)[i] = copy + ((uintptr_t*)copy)[i];
+    *dirs = (char**)copy;
+    return count;
+}
+
+// ============================================================================
+// SECTION: Child environments
+// ============================================================================
+
+/* Append "name=<Linux value>\0" for one Windows-form entry */
+static int env_put_linux(env_buf_t* b, const char* entry, size_t n) {
+    const char* eq = memchr(entry + 1, '=', n > 0 ? n - 1 : 0);
+    if (!eq || entry[0] == '=') return 0;   /* "=C:=C:\dir" stays on the Windows side */
+
+    char name[ENV_NAME_MAX];
+    size_t name_len = (size_t)(eq - entry);
+    if (name_len >= sizeof(name)) return 0;
+    memcpy(name, entry, name_len);
+    name[name_len] = '\0';
+    int kind = env_kind(name);
+    if (kind == ENV_PLAIN) return eb_put(b, entry, n + 1);
+
+    char* value = strndup(eq + 1, n - name_len - 1);
+    char* linux_value = value ? env_translate(value, kind, 0) : NULL;
+    free(value);
+    int rc = linux_value &&
+             eb_put(b, entry, name_len + 1) == 0 &&
+             eb_put(b, linux_value, strlen(linux_value) + 1) == 0 ? 0 : -1;
+    free(linux_value);
+    return rc;
+}
+
+/* Every entry of a block, converted to UTF-8 first when it is UTF-16 */
+static int env_put_block(env_buf_t* b, const void* block, int unicode, size_t* count) {
+    if (!unicode) {
+        for (const char* p = block; *p; p += strlen(p) + 1) {
+            size_t before = b->len;
+            if (env_put_linux(b, p, strlen(p)) < 0) return -1;
+            if (b->len != before) (*count)++;
+        }
+        return 0;
+    }
+
+    char* entry = NULL;
+    size_t cap = 0;
+    int rc = 0;
+    for (const uint16_t* p = block; *p && rc == 0; p += win32_u16_len(p) + 1) {
+        size_t len = win32_u16_len(p);
+        ptrdiff_t n = win32_utf16_to_utf8(p, len, NULL, 0, 0);
+        if (n < 0) continue;
+        if ((size_t)n + 1 > cap) {
+            char* grown = realloc(entry, (size_t)n + 1);
+            if (!grown) { rc = -1; break; }
+            entry = grown;
+            cap = (size_t)n + 1;
+        }
+        win32_utf16_to_utf8(p, len, (uint8_t*)entry, (size_t)n, 0);
+        entry[n] = '\0';
+        size_t before = b->len;
+        rc = env_put_linux(b, entry, (size_t)n);
+        if (b->len != before) (*count)++;
+    }
+    free(entry);
+    return rc;
+}
+
+char** win32_env_linux(const void* block, int unicode) {
+    env_buf_t b = { 0 };
+    size_t count = 0;
+    if (eb_put(&b, "", 0) < 0 || env_put_block(&b, block, unicode, &count) < 0) {
+        free(b.p);
+        return NULL;
+    }
+
+    /* Pointer table first, strings after it: one free() releases both */
+    char** envp = malloc((count + 1) * sizeof(char*) + b.len);
+    if (envp) {
+        char* str = (char*)(envp + count + 1);
+        memcpy(str, b.p, b.len);
+        for (size_t i = 0; i < count; i++) {
+            envp[i] = str;
+            str += strlen(str) + 1;
+        }
+        envp[count] = NULL;
+    }
+    free(b.p);
+    return envp;
+}
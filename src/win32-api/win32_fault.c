@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 fault dispatch
+ *
+ * The signal handler used to dump every register at error level and
+ * then run each hard-coded NativeAOT pattern check in turn before
+ * looking anywhere else, so a runtime that faults on purpose paid for
+ * all of it on every fault, and AddVectoredExceptionHandler was a stub.
+ *
+ * Interceptors are now registered per code range and exception code.
+ * They sit in an array sorted by range start, with a running maximum
+ * of the range ends, so the ones covering a RIP are found by binary
+ * search. Vectored exception and continue handlers are arrays too.
+ *
+ * All three arrays are immutable once published and read under the
+ * grace-period scheme of win32_ftab.c (two reader counters and a
+ * phase bit), which is async-signal-safe: the signal handler takes no
+ * lock. Replaced arrays go on a retired list that writers free after
+ * a grace period, waiting outside the writer lock; a writer running
+ * inside a handler cannot wait for its own reader and leaves them to
+ * the next one.
+ *
+ * The EXCEPTION_RECORD and CONTEXT a vectored handler receives live in
+ * a small per-thread array indexed by nesting depth, not on the stack
+ * the fault happened on.
+ */
+
+#define _GNU_SOURCE  /* REG_* */
+
+#include "win32_fault.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define FL_NEST              3      /* nested faults with a CONTEXT of their own */
+#define FL_CTX_SIZE          0x4D0
+#define FL_CTX_FLAGS         0x30
+#define FL_CTX_MXCSR         0x34
+#define FL_CTX_SEGCS         0x38
+#define FL_CTX_SEGFS         0x3E
+#define FL_CTX_SEGGS         0x40
+#define FL_CTX_SEGSS         0x42
+#define FL_CTX_EFLAGS        0x44
+#define FL_CTX_RAX           0x78
+#define FL_CTX_RIP           0xF8
+#define FL_CTX_FLTSAVE       0x100
+#define FL_CTX_ALL           0x10000F   /* CONTROL | INTEGER | SEGMENTS | FLOATING_POINT */
+#define FL_FXSAVE_REGS       416        /* FXSAVE bytes up to the XMM registers' end */
+
+#define EXCEPTION_ACCESS_VIOLATION    0xC0000005u
+#define EXCEPTION_CONTINUE_EXECUTION  (-1)
+
+/* EXCEPTION_RECORD (x64) */
+typedef struct {
+    uint32_t code;
+    uint32_t flags;
+    void*    nested;
+    void*    address;
+    uint32_t nparams;
+    uint32_t pad;
+    uint64_t info[15];
+} fl_record_t;
+
+typedef struct {
+    fl_record_t record;
+    uint8_t     context[FL_CTX_SIZE] __attribute__((aligned(16)));
+} fl_frame_t;
+
+/* PVECTORED_EXCEPTION_HANDLER */
+typedef int32_t (__attribute__((ms_abi)) *fl_veh_fn_t)(void* exception_pointers);
+
+typedef struct fl_retired {
+    struct fl_retired* next;
+} fl_retired_t;
+
+typedef struct {
+    uint64_t begin;
+    uint64_t end;
+    uint32_t code;
+    uint64_t id;
+    win32_fault_interceptor_t fn;
+    void*    ctx;
+} fl_icpt_t;
+
+typedef struct {
+    fl_retired_t retired;
+    size_t       n;
+    uint64_t*    reach;             /* reach[i] = max end of e[0..i] */
+    fl_icpt_t    e[];
+} fl_icpt_snap_t;
+
+typedef struct {
+    uint64_t    id;
+    fl_veh_fn_t fn;
+} fl_veh_t;
+
+typedef struct {
+    fl_retired_t retired;
+    size_t       n;
+    fl_veh_t     e[];
+} fl_veh_snap_t;
+
+static fl_icpt_snap_t* g_fl_icpt;
+static fl_veh_snap_t*  g_fl_veh[2];     /* exception handlers, continue handlers */
+static fl_retired_t*   g_fl_retired;
+static uint64_t        g_fl_next_id = 1;
+static unsigned        g_fl_phase;
+static long            g_fl_readers[2];
+static pthread_mutex_t g_fl_lock = PTHREAD_MUTEX_INITIALIZER;   /* writers */
+static pthread_mutex_t g_fl_sync = PTHREAD_MUTEX_INITIALIZER;   /* grace periods */
+
+static __thread int        t_fl_readers;   /* read sections this thread holds */
+static __thread int        t_fl_nest;
+static __thread fl_frame_t t_fl_frames[FL_NEST];
+
+// ============================================================================
+// SECTION: Grace periods
+// ============================================================================
+
+static unsigned fl_read_lock(void) {
+    unsigned p = __atomic_load_n(&g_fl_phase, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&g_fl_readers[p], 1, __ATOMIC_SEQ_CST);
+    t_fl_readers++;
+    return p;
+}
+
+static void fl_read_unlock(unsigned p) {
+    t_fl_readers--;
+    __atomic_sub_fetch(&g_fl_readers[p], 1, __ATOMIC_RELEASE);
+}
+
+/* g_fl_sync held */
+static void fl_synchronize(void) {
+    for (int round = 0; round < 2; round++) {
+        unsigned p = __atomic_load_n(&g_fl_phase, __ATOMIC_SEQ_CST) & 1;
+        __atomic_store_n(&g_fl_phase, p ^ 1, __ATOMIC_SEQ_CST);
+        for (int spin = 0; __atomic_load_n(&g_fl_readers[p], __ATOMIC_SEQ_CST); spin++) {
+            if (spin > 64) sched_yield();
+            else __builtin_ia32_pause();
+        }
+    }
+}
+
+/* g_fl_lock held: `old` was just replaced */
+static void fl_retire(fl_retired_t* old) {
+    if (!old) return;
+    old->next = g_fl_retired;
+    g_fl_retired = old;
+}
+
+/*
+ * After a write, g_fl_lock released: free what was retired once no
+ * reader can see it. The wait happens outside g_fl_lock, since the
+ * readers waited for may be handlers about to register something. A
+ * writer that is itself inside a handler cannot wait for its own read
+ * section and leaves the work to the next writer.
+ */
+static void fl_reclaim(void) {
+    if (t_fl_readers > 0) return;
+    pthread_mutex_lock(&g_fl_sync);
+    pthread_mutex_lock(&g_fl_lock);
+    fl_retired_t* list = g_fl_retired;
+    g_fl_retired = NULL;
+    pthread_mutex_unlock(&g_fl_lock);
+    if (list) fl_synchronize();
+    pthread_mutex_unlock(&g_fl_sync);
+    while (list) {
+        fl_retired_t* next = list->next;
+        free(list);
+        list = next;
+    }
+}
+
+// ============================================================================
+// SECTION: Interceptors
+// ============================================================================
+
+static fl_icpt_snap_t* fl_icpt_alloc(size_t n) {
+    fl_icpt_snap_t* s = malloc(sizeof(*s) + n * sizeof(fl_icpt_t) + n * sizeof(uint64_t));
+    if (!s) return NULL;
+    s->n = n;
+    s->reach = (uint64_t*)&s->e[n];
+    return s;
+}
+
+static void fl_icpt_publish(fl_icpt_snap_t* s) {
+    uint64_t reach = 0;
+    for (size_t i = 0; i < s->n; i++) {
+        if (s->e[i].end > reach) reach = s->e[i].end;
+        s->reach[i] = reach;
+    }
+    fl_icpt_snap_t* old = __atomic_exchange_n(&g_fl_icpt, s, __ATOMIC_SEQ_CST);
+    fl_retire(old ? &old->retired : NULL);
+}
+
+int win32_fault_register(uint64_t begin, uint64_t end, uint32_t code,
+                         win32_fault_interceptor_t fn, void* ctx, void** handle) {
+    if (!fn || end <= begin) return EINVAL;
+
+    pthread_mutex_lock(&g_fl_lock);
+    const fl_icpt_snap_t* cur = g_fl_icpt;
+    size_t n = cur ? cur->n : 0, at = 0;
+    while (at < n && cur->e[at].begin <= begin) at++;
+    fl_icpt_snap_t* s = fl_icpt_alloc(n + 1);
+    if (!s) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return ENOMEM;
+    }
+    if (at) memcpy(s->e, cur->e, at * sizeof(fl_icpt_t));
+    s->e[at] = (fl_icpt_t){ .begin = begin, .end = end, .code = code,
+                            .id = g_fl_next_id++, .fn = fn, .ctx = ctx };
+    if (n > at) memcpy(&s->e[at + 1], &cur->e[at], (n - at) * sizeof(fl_icpt_t));
+    if (handle) *handle = (void*)(uintptr_t)s->e[at].id;
+    fl_icpt_publish(s);
+    pthread_mutex_unlock(&g_fl_lock);
+    fl_reclaim();
+    return 0;
+}
+
+int win32_fault_unregister(void* handle) {
+    uint64_t id = (uint64_t)(uintptr_t)handle;
+    pthread_mutex_lock(&g_fl_lock);
+    const fl_icpt_snap_t* cur = g_fl_icpt;
+    size_t n = cur ? cur->n : 0, at = 0;
+    while (at < n && cur->e[at].id != id) at++;
+    if (at == n) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return ENOENT;
+    }
+    fl_icpt_snap_t* s = fl_icpt_alloc(n - 1);
+    if (!s) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return ENOMEM;
+    }
+    memcpy(s->e, cur->e, at * sizeof(fl_icpt_t));
+    memcpy(&s->e[at], &cur->e[at + 1], (n - at - 1) * sizeof(fl_icpt_t));
+    fl_icpt_publish(s);
+    pthread_mutex_unlock(&g_fl_lock);
+    fl_reclaim();
+    return 0;
+}
+
+/* Reader section held */
+static int fl_intercept(uint32_t code, siginfo_t* si, ucontext_t* uc) {
+    const fl_icpt_snap_t* s = __atomic_load_n(&g_fl_icpt, __ATOMIC_ACQUIRE);
+    if (!s || !s->n) return 0;
+    uint64_t rip = (uint64_t)uc->uc_mcontext.gregs[REG_RIP];
+
+    /* Last range starting at or below rip, then back while ranges reach it */
+    size_t lo = 0, hi = s->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s->e[mid].begin <= rip) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t i = lo; i-- > 0 && s->reach[i] > rip; ) {
+        const fl_icpt_t* e = &s->e[i];
+        if (rip >= e->end || (e->code != WIN32_FAULT_ANY_CODE && e->code != code)) continue;
+        if (e->fn(code, si, uc, e->ctx)) return 1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Vectored handlers
+// ============================================================================
+
+void* win32_veh_add(int continue_handler, int first, void* handler) {
+    if (!handler) return NULL;
+    int k = continue_handler ? 1 : 0;
+
+    pthread_mutex_lock(&g_fl_lock);
+    const fl_veh_snap_t* cur = g_fl_veh[k];
+    size_t n = cur ? cur->n : 0;
+    fl_veh_snap_t* s = malloc(sizeof(*s) + (n + 1) * sizeof(fl_veh_t));
+    if (!s) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return NULL;
+    }
+    s->n = n + 1;
+    size_t at = first ? 0 : n;
+    if (n) {
+        if (first) memcpy(&s->e[1], cur->e, n * sizeof(fl_veh_t));
+        else memcpy(s->e, cur->e, n * sizeof(fl_veh_t));
+    }
+    s->e[at].id = g_fl_next_id++;
+    memcpy(&s->e[at].fn, &handler, sizeof(s->e[at].fn));
+    void* handle = (void*)(uintptr_t)s->e[at].id;
+    fl_veh_snap_t* old = __atomic_exchange_n(&g_fl_veh[k], s, __ATOMIC_SEQ_CST);
+    fl_retire(old ? &old->retired : NULL);
+    pthread_mutex_unlock(&g_fl_lock);
+    fl_reclaim();
+    return handle;
+}
+
+int win32_veh_remove(int continue_handler, void* handle) {
+    int k = continue_handler ? 1 : 0;
+    uint64_t id = (uint64_t)(uintptr_t)handle;
+
+    pthread_mutex_lock(&g_fl_lock);
+    const fl_veh_snap_t* cur = g_fl_veh[k];
+    size_t n = cur ? cur->n : 0, at = 0;
+    while (at < n && cur->e[at].id != id) at++;
+    if (at == n) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return ENOENT;
+    }
+    fl_veh_snap_t* s = malloc(sizeof(*s) + (n - 1) * sizeof(fl_veh_t));
+    if (!s) {
+        pthread_mutex_unlock(&g_fl_lock);
+        return ENOMEM;
+    }
+    s->n = n - 1;
+    memcpy(s->e, cur->e, at * sizeof(fl_veh_t));
+    memcpy(&s->e[at], &cur->e[at + 1], (n - at - 1) * sizeof(fl_veh_t));
+    fl_veh_snap_t* old = __atomic_exchange_n(&g_fl_veh[k], s, __ATOMIC_SEQ_CST);
+    fl_retire(&old->retired);
+    pthread_mutex_unlock(&g_fl_lock);
+    fl_reclaim();
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Translation
+// ============================================================================
+
+/* CONTEXT integer registers (Rax..R15) in ucontext order */
+static const int k_fl_gregs[16] = {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+};
+
+static void fl_context_from(uint8_t* c, const ucontext_t* uc) {
+    const greg_t* g = uc->uc_mcontext.gregs;
+    memset(c, 0, FL_CTX_SIZE);
+    *(uint32_t*)(c + FL_CTX_FLAGS)  = FL_CTX_ALL;
+    *(uint16_t*)(c + FL_CTX_SEGCS)  = (uint16_t)g[REG_CSGSFS];
+    *(uint16_t*)(c + FL_CTX_SEGGS)  = (uint16_t)(g[REG_CSGSFS] >> 16);
+    *(uint16_t*)(c + FL_CTX_SEGFS)  = (uint16_t)(g[REG_CSGSFS] >> 32);
+    *(uint16_t*)(c + FL_CTX_SEGSS)  = 0x2B;
+    *(uint32_t*)(c + FL_CTX_EFLAGS) = (uint32_t)g[REG_EFL];
+    for (int i = 0; i < 16; i++)
+        *(uint64_t*)(c + FL_CTX_RAX + 8 * i) = (uint64_t)g[k_fl_gregs[i]];
+    *(uint64_t*)(c + FL_CTX_RIP) = (uint64_t)g[REG_RIP];
+    if (uc->uc_mcontext.fpregs) {
+        /* XMM_SAVE_AREA32 is the FXSAVE image the kernel saved */
+        memcpy(c + FL_CTX_FLTSAVE, uc->uc_mcontext.fpregs, 512);
+        *(uint32_t*)(c + FL_CTX_MXCSR) = uc->uc_mcontext.fpregs->mxcsr;
+    }
+}
+
+static void fl_context_to(const uint8_t* c, ucontext_t* uc) {
+    greg_t* g = uc->uc_mcontext.gregs;
+    g[REG_EFL] = (greg_t)*(const uint32_t*)(c + FL_CTX_EFLAGS);
+    for (int i = 0; i < 16; i++)
+        g[k_fl_gregs[i]] = (greg_t)*(const uint64_t*)(c + FL_CTX_RAX + 8 * i);
+    g[REG_RIP] = (greg_t)*(const uint64_t*)(c + FL_CTX_RIP);
+    /* Not the reserved tail: the kernel keeps its XSAVE markers there */
+    if (uc->uc_mcontext.fpregs)
+        memcpy(uc->uc_mcontext.fpregs, c + FL_CTX_FLTSAVE, FL_FXSAVE_REGS);
+}
+
+static void fl_record_from(fl_record_t* r, uint32_t code, const siginfo_t* si, const ucontext_t* uc) {
+    memset(r, 0, sizeof(*r));
+    r->code    = code;
+    r->address = (void*)(uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    if (code == EXCEPTION_ACCESS_VIOLATION && si) {
+        /* Page fault error code: bit 1 write, bit 4 instruction fetch */
+        uint64_t err = (uint64_t)uc->uc_mcontext.gregs[REG_ERR];
+        r->nparams = 2;
+        r->info[0] = (err & 0x10) ? 8 : (err & 0x2) ? 1 : 0;
+        r->info[1] = (uint64_t)(uintptr_t)si->si_addr;
+    }
+}
+
+/* Reader section held: 1 when a handler asked to continue execution */
+static int fl_call_vectored(uint32_t code, siginfo_t* si, ucontext_t* uc) {
+    const fl_veh_snap_t* s = __atomic_load_n(&g_fl_veh[0], __ATOMIC_ACQUIRE);
+    if (!s || !s->n || t_fl_nest == FL_NEST) return 0;
+
+    fl_frame_t* f = &t_fl_frames[t_fl_nest++];
+    fl_record_from(&f->record, code, si, uc);
+    fl_context_from(f->context, uc);
+    void* pointers[2] = { &f->record, f->context };
+
+    int handled = 0;
+    for (size_t i = 0; i < s->n && !handled; i++)
+        handled = s->e[i].fn(pointers) == EXCEPTION_CONTINUE_EXECUTION;
+    if (handled) {
+        const fl_veh_snap_t* cs = __atomic_load_n(&g_fl_veh[1], __ATOMIC_ACQUIRE);
+        for (size_t i = 0; cs && i < cs->n; i++)
+            if (cs->e[i].fn(pointers) == EXCEPTION_CONTINUE_EXECUTION) break;
+        fl_context_to(f->context, uc);
+    }
+    t_fl_nest--;
+    return handled;
+}
+
+int win32_fault_dispatch(uint32_t code, siginfo_t* si, ucontext_t* uc) {
+    if (!uc) return 0;
+    unsigned p = fl_read_lock();
+    int handled = fl_intercept(code, si, uc) || fl_call_vectored(code, si, uc);
+    fl_read_unlock(p);
+    return handled;
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 function tables
+ *
+ * The exception code used to know one .pdata: the main image's. DLLs
+ * could not be unwound and RtlAddFunctionTable was a no-op, so nothing
+ * thrown through a loaded DLL or JIT-compiled code could be caught.
+ *
+ * The registry is an array of code ranges sorted by start address,
+ * each pointing at its RUNTIME_FUNCTION entries (or at a callback).
+ * The array is immutable once published: a writer copies it, edits the
+ * copy, swaps the pointer and waits for a grace period before freeing
+ * the old one. Readers only bump a counter on entry and exit, so
+ * unwinding on many threads never contends on a lock. The grace period
+ * uses two reader counters and a phase bit (the SRCU scheme): a writer
+ * flips the phase and waits for the old counter to drain, twice.
+ *
+ * A JIT adds a table per method batch, so writes are frequent too; a
+ * growable table (RtlAddGrowableFunctionTable) avoids the copy
+ * entirely, as its entry count is read atomically on every lookup.
+ *
+ * Each thread caches its last hit (snapshot generation, range and
+ * entry); unwinding walks the same few functions over and over.
+ */
+
+#define _GNU_SOURCE
+
+#include "win32_ftab.h"
+#include "win32_unwind.h"
+#include "lsw_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+enum {
+    FT_IMAGE,
+    FT_TABLE,
+    FT_GROWABLE,
+    FT_CALLBACK
+};
+
+typedef struct {
+    const win32_runtime_function_t* rf;
+    uint32_t count;                     /* published entries, atomic */
+    uint32_t max;
+} ft_growable_t;
+
+typedef struct {
+    uint64_t begin;                     /* covered addresses [begin, end) */
+    uint64_t end;
+    uint64_t base;                      /* RVAs are relative to this */
+    uint64_t key;
+    int      kind;
+    int      sorted;                    /* entries ordered by BeginAddress */
+    const win32_runtime_function_t* rf;
+    uint32_t count;
+    ft_growable_t* grow;
+    win32_ftab_callback_t callback;
+    void*    ctx;
+} ft_range_t;
+
+typedef struct {
+    uint64_t   gen;
+    size_t     n;
+    uint64_t*  reach;                   /* reach[i] = max end of r[0..i] */
+    ft_range_t r[];
+} ft_snap_t;
+
+static ft_snap_t*      g_ft_snap;
+static uint64_t        g_ft_gen;
+static unsigned        g_ft_phase;
+static long            g_ft_readers[2];
+static pthread_mutex_t g_ft_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread struct {
+    uint64_t gen;
+    const ft_range_t* range;
+    const win32_runtime_function_t* rf;
+} t_ft_last;
+
+// ============================================================================
+// SECTION: Grace periods
+// ============================================================================
+
+static unsigned ft_read_lock(void) {
+    unsigned p = __atomic_load_n(&g_ft_phase, __ATOMIC_SEQ_CST) & 1;
+    __atomic_add_fetch(&g_ft_readers[p], 1, __ATOMIC_SEQ_CST);
+    return p;
+}
+
+static void ft_read_unlock(unsigned p) {
+    __atomic_sub_fetch(&g_ft_readers[p], 1, __ATOMIC_RELEASE);
+}
+
+/* g_ft_lock held; returns once no reader can hold an older snapshot */
+static void ft_synchronize(void) {
+    for (int round = 0; round < 2; round++) {
+        unsigned p = __atomic_load_n(&g_ft_phase, __ATOMIC_SEQ_CST) & 1;
+        __atomic_store_n(&g_ft_phase, p ^ 1, __ATOMIC_SEQ_CST);
+        for (int spin = 0; __atomic_load_n(&g_ft_readers[p], __ATOMIC_SEQ_CST); spin++) {
+            if (spin > 64) sched_yield();
+            else __builtin_ia32_pause();
+        }
+    }
+}
+
+// ============================================================================
+// SECTION: Snapshots
+// ============================================================================
+
+static ft_snap_t* ft_snap_alloc(size_t n) {
+    ft_snap_t* s = malloc(sizeof(*s) + n * sizeof(ft_range_t) + n * sizeof(uint64_t));
+    if (!s) return NULL;
+    s->n = n;
+    s->reach = (uint64_t*)&s->r[n];
+    return s;
+}
+
+/* Publish `s` (g_ft_lock held) and retire the snapshot it replaces */
+static void ft_publish(ft_snap_t* s) {
+    uint64_t reach = 0;
+    for (size_t i = 0; i < s->n; i++) {
+        if (s->r[i].end > reach) reach = s->r[i].end;
+        s->reach[i] = reach;
+    }
+    s->gen = ++g_ft_gen;
+    ft_snap_t* old = __atomic_exchange_n(&g_ft_snap, s, __ATOMIC_SEQ_CST);
+    ft_synchronize();
+    free(old);
+}
+
+static int ft_insert(const ft_range_t* nr) {
+    pthread_mutex_lock(&g_ft_lock);
+    const ft_snap_t* cur = g_ft_snap;
+    size_t n = cur ? cur->n : 0;
+    for (size_t i = 0; i < n; i++) {
+        if (cur->r[i].key == nr->key) {
+            pthread_mutex_unlock(&g_ft_lock);
+            return EEXIST;
+        }
+    }
+    ft_snap_t* s = ft_snap_alloc(n + 1);
+    if (!s) {
+        pthread_mutex_unlock(&g_ft_lock);
+        return ENOMEM;
+    }
+    size_t at = 0;
+    while (at < n && cur->r[at].begin <= nr->begin) at++;
+    if (at) memcpy(s->r, cur->r, at * sizeof(ft_range_t));
+    s->r[at] = *nr;
+    if (n > at) memcpy(&s->r[at + 1], &cur->r[at], (n - at) * sizeof(ft_range_t));
+    ft_publish(s);
+    pthread_mutex_unlock(&g_ft_lock);
+    return 0;
+}
+
+int win32_ftab_remove(uint64_t key) {
+    pthread_mutex_lock(&g_ft_lock);
+    const ft_snap_t* cur = g_ft_snap;
+    size_t n = cur ? cur->n : 0, at = 0;
+    while (at < n && cur->r[at].key != key) at++;
+    if (at == n) {
+        pthread_mutex_unlock(&g_ft_lock);
+        return ENOENT;
+    }
+    ft_growable_t* grow = cur->r[at].grow;
+    ft_snap_t* s = ft_snap_alloc(n - 1);
+    if (!s) {
+        pthread_mutex_unlock(&g_ft_lock);
+        return ENOMEM;
+    }
+    memcpy(s->r, cur->r, at * sizeof(ft_range_t));
+    memcpy(&s->r[at], &cur->r[at + 1], (n - at - 1) * sizeof(ft_range_t));
+    ft_publish(s);                      /* after this nobody reads `grow` */
+    pthread_mutex_unlock(&g_ft_lock);
+    win32_unwind_flush();               /* the address range may be reused */
+    free(grow);
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Registration
+// ============================================================================
+
+static int ft_is_sorted(const win32_runtime_function_t* rf, uint32_t n) {
+    for (uint32_t i = 1; i < n; i++) {
+        if (rf[i].BeginAddress < rf[i - 1].BeginAddress) return 0;
+    }
+    return 1;
+}
+
+int win32_ftab_add_image(uint64_t base, uint64_t size, const void* pdata, uint32_t pdata_bytes) {
+    uint32_t count = pdata_bytes / sizeof(win32_runtime_function_t);
+    if (!base || !size || !pdata || !count) return EINVAL;
+    ft_range_t r = {
+        .begin = base, .end = base + size, .base = base, .key = base,
+        .kind = FT_IMAGE, .sorted = 1, .rf = pdata, .count = count,
+    };
+    int rc = ft_insert(&r);
+    LSW_LOG_DEBUG("[ftab] image 0x%llx+0x%llx: %u entries%s", (unsigned long long)base,
+                  (unsigned long long)size, count, rc ? " (not added)" : "");
+    return rc;
+}
+
+int win32_ftab_add_table(const win32_runtime_function_t* table, uint32_t count, uint64_t base) {
+    if (!table || !count) return EINVAL;
+    /* The covered range is what the entries span */
+    uint32_t lo = UINT32_MAX, hi = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (table[i].BeginAddress < lo) lo = table[i].BeginAddress;
+        if (table[i].EndAddress > hi) hi = table[i].EndAddress;
+    }
+    if (hi <= lo) return EINVAL;
+    ft_range_t r = {
+        .begin = base + lo, .end = base + hi, .base = base, .key = (uint64_t)(uintptr_t)table,
+        .kind = FT_TABLE, .sorted = ft_is_sorted(table, count), .rf = table, .count = count,
+    };
+    return ft_insert(&r);
+}
+
+int win32_ftab_add_growable(const win32_runtime_function_t* table, uint32_t count, uint32_t max,
+                            uint64_t range_base, uint64_t range_end, void** handle) {
+    if (!table || !handle || count > max || range_end <= range_base) return EINVAL;
+    ft_growable_t* g = malloc(sizeof(*g));
+    if (!g) return ENOMEM;
+    *g = (ft_growable_t){ .rf = table, .count = count, .max = max };
+    ft_range_t r = {
+        .begin = range_base, .end = range_end, .base = range_base, .key = (uint64_t)(uintptr_t)g,
+        .kind = FT_GROWABLE, .sorted = 1, .rf = table, .grow = g,
+    };
+    int rc = ft_insert(&r);
+    if (rc) {
+        free(g);
+        return rc;
+    }
+    *handle = g;
+    return 0;
+}
+
+void win32_ftab_grow(void* handle, uint32_t count) {
+    ft_growable_t* g = handle;
+    if (!g || count > g->max) return;
+    /* Entries are written before the count that publishes them */
+    __atomic_store_n(&g->count, count, __ATOMIC_RELEASE);
+}
+
+int win32_ftab_add_callback(uint64_t id, uint64_t base, uint32_t length,
+                            win32_ftab_callback_t callback, void* ctx) {
+    /* The identifier must have its two low bits set (RtlInstallFunctionTableCallback) */
+    if ((id & 3) != 3 || !callback || !length) return EINVAL;
+    ft_range_t r = {
+        .begin = base, .end = base + length, .base = base, .key = id,
+        .kind = FT_CALLBACK, .callback = callback, .ctx = ctx,
+    };
+    return ft_insert(&r);
+}
+
+// ============================================================================
+// SECTION: Lookup
+// ============================================================================
+
+static const win32_runtime_function_t* ft_search(const ft_range_t* r, uint64_t pc) {
+    uint32_t n = r->grow ? __atomic_load_n(&r->grow->count, __ATOMIC_ACQUIRE) : r->count;
+    uint32_t rva = (uint32_t)(pc - r->base);
+    const win32_runtime_function_t* rf = r->rf;
+    if (!r->sorted) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (rva >= rf[i].BeginAddress && rva < rf[i].EndAddress) return &rf[i];
+        }
+        return NULL;
+    }
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (rva < rf[mid].BeginAddress) hi = mid;
+        else if (rva >= rf[mid].EndAddress) lo = mid + 1;
+        else return &rf[mid];
+    }
+    return NULL;
+}
+
+const win32_runtime_function_t* win32_ftab_lookup(uint64_t pc, uint64_t* image_base, uint64_t* image_size) {
+    const win32_runtime_function_t* found = NULL;
+    const ft_range_t* hit = NULL;
+    win32_ftab_callback_t callback = NULL;
+    void* ctx = NULL;
+    uint64_t base = 0, size = 0;
+
+    unsigned p = ft_read_lock();
+    const ft_snap_t* s = __atomic_load_n(&g_ft_snap, __ATOMIC_ACQUIRE);
+    if (s && t_ft_last.gen == s->gen) {
+        const ft_range_t* r = t_ft_last.range;
+        const win32_runtime_function_t* rf = t_ft_last.rf;
+        uint64_t rva = pc - r->base;
+        if (rf && pc >= r->base && rva >= rf->BeginAddress && rva < rf->EndAddress) {
+            found = rf;
+            hit = r;
+        } else if (pc >= r->begin && pc < r->end && r->kind != FT_CALLBACK) {
+            found = ft_search(r, pc);
+            if (found) hit = r;
+        }
+    }
+    if (s && !hit && s->n) {
+        /* Last range starting at or below pc, then back while ranges reach it */
+        size_t lo = 0, hi = s->n;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (s->r[mid].begin <= pc) lo = mid + 1;
+            else hi = mid;
+        }
+        for (size_t i = lo; i-- > 0 && s->reach[i] > pc; ) {
+            const ft_range_t* r = &s->r[i];
+            if (pc < r->begin || pc >= r->end) continue;
+            if (r->kind == FT_CALLBACK) {
+                callback = r->callback;
+                ctx = r->ctx;
+                base = r->base;
+                break;
+            }
+            found = ft_search(r, pc);
+            if (found) {
+                hit = r;
+                break;
+            }
+        }
+    }
+    if (hit) {
+        base = hit->base;
+        size = hit->kind == FT_IMAGE ? hit->end - hit->begin : 0;
+        t_ft_last.gen = s->gen;
+        t_ft_last.range = hit;
+        t_ft_last.rf = found;
+    }
+    ft_read_unlock(p);
+
+    /* Callbacks run outside the read section: they may register tables */
+    if (callback) found = callback(pc, ctx);
+    if (image_base) *image_base = found ? base : 0;
+    if (image_size) *image_size = found ? size : 0;
+    return found;
+}
+
+uint64_t win32_ftab_image(uint64_t addr, uint64_t* image_size) {
+    uint64_t base = 0, size = 0;
+    unsigned p = ft_read_lock();
+    const ft_snap_t* s = __atomic_load_n(&g_ft_snap, __ATOMIC_ACQUIRE);
+    size_t lo = 0, hi = s ? s->n : 0;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s->r[mid].begin <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t i = lo; i-- > 0 && s->reach[i] > addr; ) {
+        const ft_range_t* r = &s->r[i];
+        if (r->kind == FT_IMAGE && addr < r->end) {
+            base = r->begin;
+            size = r->end - r->begin;
+            break;
+        }
+    }
+    ft_read_unlock(p);
+    if (image_size) *image_size = size;
+    return base;
+}
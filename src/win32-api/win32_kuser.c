@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 KUSER_SHARED_DATA - shared time page and monotonic clocks
+ *
+ * Windows maps one read-only page at 0x7FFE0000 into every process and
+ * the kernel keeps its clock fields current on every timer tick.
+ * Compiler-inlined code (GetTickCount in old CRTs, games, anti-cheat,
+ * profilers) reads it directly. We back it with a memfd mapped twice:
+ * read-only at the fixed address, read-write for the updater thread,
+ * which refreshes it at the default Windows tick rate of 64 Hz.
+ */
+
+#define _GNU_SOURCE  /* memfd_create, MAP_FIXED_NOREPLACE */
+
+#include "win32_kuser.h"
+#include "lsw_log.h"
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define KUSER_PAGE_SIZE     4096
+#define KUSER_TICK_NS       15625000L               /* 1/64 s */
+#define FILETIME_UNIX_EPOCH 116444736000000000ULL   /* 1601 -> 1970 in 100 ns */
+
+_Static_assert(offsetof(win32_kuser_shared_data_t, InterruptTime) == 0x008, "InterruptTime");
+_Static_assert(offsetof(win32_kuser_shared_data_t, SystemTime) == 0x014, "SystemTime");
+_Static_assert(offsetof(win32_kuser_shared_data_t, NtSystemRoot) == 0x030, "NtSystemRoot");
+_Static_assert(offsetof(win32_kuser_shared_data_t, NtMajorVersion) == 0x26c, "NtMajorVersion");
+_Static_assert(offsetof(win32_kuser_shared_data_t, QpcFrequency) == 0x300, "QpcFrequency");
+_Static_assert(offsetof(win32_kuser_shared_data_t, TickCountQuad) == 0x320, "TickCountQuad");
+_Static_assert(offsetof(win32_kuser_shared_data_t, QpcBypassEnabled) == 0x3ce, "QpcBypassEnabled");
+
+static win32_kuser_shared_data_t* kuser_rw = NULL;          /* updater's view */
+static const win32_kuser_shared_data_t* kuser_ro = NULL;    /* application view */
+static pthread_once_t kuser_once = PTHREAD_ONCE_INIT;
+
+static inline uint64_t timespec_100ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 10000000ULL + (uint64_t)ts.tv_nsec / 100;
+}
+
+/* Publish a KSYSTEM_TIME. Where the field is 8-byte aligned LowPart and
+ * High1Time go out in one store, so 64-bit readers (TickCountQuad) never
+ * see a torn value. */
+static void kuser_set_time(win32_ksystem_time_t* t, uint64_t v) {
+    __atomic_store_n(&t->High2Time, (int32_t)(v >> 32), __ATOMIC_RELEASE);
+    if (((uintptr_t)t & 7) == 0) {
+        __atomic_store_n((volatile uint64_t*)(void*)t, v, __ATOMIC_RELEASE);
+    } else {
+        __atomic_store_n(&t->LowPart, (uint32_t)v, __ATOMIC_RELEASE);
+        __atomic_store_n(&t->High1Time, (int32_t)(v >> 32), __ATOMIC_RELEASE);
+    }
+}
+
+static void kuser_update(win32_kuser_shared_data_t* k) {
+    uint64_t boot = timespec_100ns(CLOCK_BOOTTIME);
+    uint64_t ms   = boot / 10000;
+
+    kuser_set_time(&k->InterruptTime, boot);
+    kuser_set_time(&k->SystemTime, timespec_100ns(CLOCK_REALTIME) + FILETIME_UNIX_EPOCH);
+    kuser_set_time(&k->TickCount, ms);
+    k->TickCountLowDeprecated = (uint32_t)ms;
+}
+
+static void* kuser_updater(void* arg) {
+    win32_kuser_shared_data_t* k = arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;) {
+        next.tv_nsec += KUSER_TICK_NS;
+        if (next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; next.tv_sec++; }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        kuser_update(k);
+    }
+    return NULL;
+}
+
+static void kuser_fill_static(win32_kuser_shared_data_t* k) {
+    static const char root[] = "C:\\Windows";
+    for (size_t i = 0; i < sizeof(root); i++) k->NtSystemRoot[i] = (uint16_t)root[i];
+
+    /* Ticks are stored in ms, so the multiplier is 1.0 in 8.24 fixed point */
+    k->TickCountMultiplier = 1u << 24;
+    k->ImageNumberLow = k->ImageNumberHigh = 0x8664;     /* IMAGE_FILE_MACHINE_AMD64 */
+    k->NativeProcessorArchitecture = 9;                   /* PROCESSOR_ARCHITECTURE_AMD64 */
+    k->MaxStackTraceDepth = 0;
+    k->CryptoExponent = 0x10001;
+    k->TimeZoneId = 0;                                    /* TIME_ZONE_ID_UNKNOWN: UTC */
+    k->LargePageMinimum = 2 * 1024 * 1024;
+    /* Matches GetVersionEx / RtlGetVersion: Windows 10 2004 */
+    k->NtMajorVersion = 10;
+    k->NtMinorVersion = 0;
+    k->NtBuildNumber = 19041;
+    k->NtProductType = 1;                                 /* NtProductWinNt */
+    k->ProductTypeIsValid = 1;
+    /* ProcessorFeatures stays zero, consistent with IsProcessorFeaturePresent */
+
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long cpus  = sysconf(_SC_NPROCESSORS_ONLN);
+    k->NumberOfPhysicalPages = pages > 0 ? (uint32_t)pages : 0;
+    k->ActiveProcessorCount  = cpus > 0 ? (uint32_t)cpus : 1;
+    k->ActiveGroupCount      = 1;
+    k->QpcFrequency          = (int64_t)WIN32_QPC_FREQUENCY;
+    k->QpcBypassEnabled      = 0;
+}
+
+/* Map a fresh page (`fixed`: MAP_FIXED_NOREPLACE, or MAP_FIXED to replace
+ * an inherited one) and start its updater */
+static void kuser_start(int fixed) {
+    void* rw = MAP_FAILED;
+    void* ro = MAP_FAILED;
+    int fd = memfd_create("lsw-kuser", MFD_CLOEXEC);
+
+    if (fd >= 0 && ftruncate(fd, KUSER_PAGE_SIZE) == 0) {
+        rw = mmap(NULL, KUSER_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ro = mmap((void*)WIN32_KUSER_ADDRESS, KUSER_PAGE_SIZE, PROT_READ,
+                  MAP_SHARED | fixed, fd, 0);
+    }
+    if (fd >= 0) close(fd);
+
+    if (rw == MAP_FAILED) {
+        LSW_LOG_WARN("KUSER_SHARED_DATA: memfd unavailable, clocks fall back to syscalls");
+        if (ro != MAP_FAILED) munmap(ro, KUSER_PAGE_SIZE);
+        return;
+    }
+    if (ro != (void*)WIN32_KUSER_ADDRESS) {
+        /* Old kernels ignore NOREPLACE and may place the page elsewhere */
+        if (ro != MAP_FAILED) munmap(ro, KUSER_PAGE_SIZE);
+        LSW_LOG_WARN("KUSER_SHARED_DATA: 0x%lx is taken; direct page reads unavailable",
+                     WIN32_KUSER_ADDRESS);
+        ro = rw;
+    }
+
+    win32_kuser_shared_data_t* k = rw;
+    kuser_fill_static(k);
+    kuser_update(k);
+
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+    int rc = pthread_create(&th, &attr, kuser_updater, k);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        LSW_LOG_WARN("KUSER_SHARED_DATA: updater thread failed (%s)", strerror(rc));
+        return;
+    }
+
+    __atomic_store_n(&kuser_ro, (const win32_kuser_shared_data_t*)ro, __ATOMIC_RELEASE);
+    __atomic_store_n(&kuser_rw, k, __ATOMIC_RELEASE);
+    LSW_LOG_INFO("KUSER_SHARED_DATA mapped at %p", ro);
+}
+
+static void kuser_setup(void) {
+    kuser_start(MAP_FIXED_NOREPLACE);
+}
+
+int win32_kuser_init(void) {
+    pthread_once(&kuser_once, kuser_setup);
+    return __atomic_load_n(&kuser_rw, __ATOMIC_ACQUIRE) ? 0 : -1;
+}
+
+int win32_kuser_fork_child(void) {
+    win32_kuser_shared_data_t* old_rw = __atomic_load_n(&kuser_rw, __ATOMIC_ACQUIRE);
+    const win32_kuser_shared_data_t* old_ro = __atomic_load_n(&kuser_ro, __ATOMIC_ACQUIRE);
+    if (!old_rw) return -1;
+
+    /* The page is still the parent's and its updater stayed there: give
+     * the child its own, at the same address */
+    __atomic_store_n(&kuser_rw, NULL, __ATOMIC_RELEASE);
+    kuser_start(old_ro == (const void*)WIN32_KUSER_ADDRESS ? MAP_FIXED : MAP_FIXED_NOREPLACE);
+    if (!__atomic_load_n(&kuser_rw, __ATOMIC_ACQUIRE)) {
+        /* Keep reading the parent's page */
+        __atomic_store_n(&kuser_rw, old_rw, __ATOMIC_RELEASE);
+        return -1;
+    }
+    munmap(old_rw, KUSER_PAGE_SIZE);
+    return 0;
+}
+
+const win32_kuser_shared_data_t* win32_kuser_get(void) {
+    return __atomic_load_n(&kuser_ro, __ATOMIC_ACQUIRE);
+}
+
+uint64_t win32_kuser_tick_count(void) {
+    const win32_kuser_shared_data_t* k = __atomic_load_n(&kuser_rw, __ATOMIC_ACQUIRE);
+    if (k) return __atomic_load_n(&k->TickCountQuad, __ATOMIC_ACQUIRE);
+    return timespec_100ns(CLOCK_BOOTTIME) / 10000;
+}
+
+uint64_t win32_kuser_interrupt_time(void) {
+    const win32_kuser_shared_data_t* k = __atomic_load_n(&kuser_rw, __ATOMIC_ACQUIRE);
+    if (!k) return timespec_100ns(CLOCK_BOOTTIME);
+    for (;;) {
+        int32_t  hi1 = __atomic_load_n(&k->InterruptTime.High1Time, __ATOMIC_ACQUIRE);
+        uint32_t lo  = __atomic_load_n(&k->InterruptTime.LowPart, __ATOMIC_ACQUIRE);
+        int32_t  hi2 = __atomic_load_n(&k->InterruptTime.High2Time, __ATOMIC_ACQUIRE);
+        if (hi1 == hi2) return ((uint64_t)(uint32_t)hi1 << 32) | lo;
+    }
+}
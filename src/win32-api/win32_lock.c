@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 lock manager
+ *
+ * CreateFile ignored its share mode and LockFile(Ex) did nothing, so
+ * two processes could happily write the same database. Both now sit on
+ * open file description locks (F_OFD_*): they belong to the open, not
+ * to the process, so two handles in one process conflict the way two
+ * Windows handles do, and the kernel drops them with the last
+ * descriptor. No lock daemon, no shared table to clean up after a
+ * crash, and nothing outside a few fcntl calls on the open path.
+ *
+ * Share modes: every open takes a shared lock on one "access" byte per
+ * class it uses and one "deny" byte per class it does not share. An
+ * open conflicts when an access byte it denies, or a deny byte of an
+ * access it wants, is held by another open; F_OFD_GETLK answers that
+ * for the whole group in one call in the common case. Publishing comes
+ * before checking, so two racing opens may both fail but never both
+ * succeed.
+ *
+ * Byte ranges: Windows locks do not merge or split, and an unlock must
+ * name a locked range exactly. POSIX locks of one open do both, so the
+ * ranges of every handle are also recorded here; an unlock only
+ * releases the bytes no other range of the handle still covers.
+ */
+
+#define _GNU_SOURCE  /* F_OFD_SETLK */
+
+#include "win32_lock.h"
+#include "lsw_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+/* Mode bytes, far above anything an application locks */
+#define LK_MODE_BASE    0x7FFFFFFFFFFFFF00ull
+#define LK_MODE_BITS    6               /* access classes, then denied classes */
+#define LK_DENY(mask)   ((mask) << 3)
+#define LK_RANGE_LIMIT  LK_MODE_BASE    /* byte ranges are clamped here */
+
+// ============================================================================
+// SECTION: Share modes
+// ============================================================================
+
+uint32_t win32_share_classes(uint32_t access) {
+    uint32_t c = 0;
+    /* GENERIC_READ | GENERIC_EXECUTE | GENERIC_ALL | FILE_READ_DATA | FILE_EXECUTE */
+    if (access & 0xB0000021u) c |= WIN32_SHARE_READ;
+    /* GENERIC_WRITE | GENERIC_ALL | FILE_WRITE_DATA | FILE_APPEND_DATA */
+    if (access & 0x50000006u) c |= WIN32_SHARE_WRITE;
+    /* DELETE | GENERIC_ALL */
+    if (access & 0x10010000u) c |= WIN32_SHARE_DELETE;
+    return c;
+}
+
+static int lk_mode_fcntl(int fd, int cmd, short type, unsigned bit, unsigned count, struct flock* fl) {
+    memset(fl, 0, sizeof(*fl));
+    fl->l_type   = type;
+    fl->l_whence = SEEK_SET;
+    fl->l_start  = (off_t)(LK_MODE_BASE + bit);
+    fl->l_len    = count;
+    return fcntl(fd, cmd, fl);
+}
+
+/* Lowest and highest set bit of a nonzero mask */
+static unsigned lk_lo(uint32_t m) { return (unsigned)__builtin_ctz(m); }
+static unsigned lk_hi(uint32_t m) { return 31u - (unsigned)__builtin_clz(m); }
+
+/* Is a bit of `mask` held by another open? */
+static int lk_mode_held(int fd, uint32_t mask) {
+    struct flock fl;
+    unsigned lo = lk_lo(mask), hi = lk_hi(mask);
+    if (lk_mode_fcntl(fd, F_OFD_GETLK, F_WRLCK, lo, hi - lo + 1, &fl) != 0) return 0;
+    if (fl.l_type == F_UNLCK) return 0;
+    if (__builtin_popcount(mask) == 1) return 1;
+
+    /* Something in the span is held; look at the bits that matter */
+    for (uint32_t m = mask; m; m &= m - 1) {
+        if (lk_mode_fcntl(fd, F_OFD_GETLK, F_WRLCK, lk_lo(m), 1, &fl) == 0 && fl.l_type != F_UNLCK)
+            return 1;
+    }
+    return 0;
+}
+
+int win32_share_acquire(int fd, uint32_t access, uint32_t share) {
+    access &= 7;
+    /* Opens without data or delete access take no part (FILE_READ_ATTRIBUTES etc.) */
+    if (!access) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return 0;
+
+    uint32_t deny = ~share & 7;
+    uint32_t own  = access | LK_DENY(deny);
+    struct flock fl;
+
+    /* Publish, one call per run of bits */
+    for (uint32_t m = own; m; ) {
+        unsigned lo = lk_lo(m), n = 0;
+        while (m & (1u << (lo + n))) m &= ~(1u << (lo + n++));
+        if (lk_mode_fcntl(fd, F_OFD_SETLK, F_RDLCK, lo, n, &fl) != 0) {
+            /* EINVAL: no OFD locks here. EBADF: write-only open, which
+             * can still honour the others but not announce itself */
+            if (errno == EINVAL) return 0;
+            break;
+        }
+    }
+
+    uint32_t conflict = LK_DENY(access) | deny;  /* deny bytes of what we use, access bytes of what we deny */
+    if (!lk_mode_held(fd, conflict)) return 0;
+
+    lk_mode_fcntl(fd, F_OFD_SETLK, F_UNLCK, 0, LK_MODE_BITS, &fl);
+    return EBUSY;
+}
+
+int win32_share_check_delete(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+    if (fd < 0) return 0;
+    struct stat st;
+    int busy = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+               lk_mode_held(fd, LK_DENY(WIN32_SHARE_DELETE));
+    close(fd);
+    return busy ? EBUSY : 0;
+}
+
+// ============================================================================
+// SECTION: Range records
+// ============================================================================
+
+typedef struct {
+    int      fd;
+    int      excl;
+    int      pending;                   /* kernel lock not granted yet */
+    uint64_t id;
+    uint64_t off;
+    uint64_t len;
+} lk_range_t;
+
+static pthread_mutex_t g_lk_lock = PTHREAD_MUTEX_INITIALIZER;
+static lk_range_t*     g_lk_ranges;
+static size_t          g_lk_count;
+static size_t          g_lk_cap;
+static uint64_t        g_lk_seq;
+static size_t          g_lk_live;       /* lets close paths skip the lock */
+
+static uint64_t lk_end(uint64_t off, uint64_t len) {
+    return off + len < off ? UINT64_MAX : off + len;
+}
+
+/* Zero-length ranges never conflict */
+static int lk_overlap(const lk_range_t* r, uint64_t off, uint64_t len) {
+    return r->len && len && r->off < lk_end(off, len) && off < lk_end(r->off, r->len);
+}
+
+/* The part of a range the kernel sees; 0 when there is none */
+static int lk_span(uint64_t off, uint64_t len, uint64_t* start, uint64_t* end) {
+    if (!len || off >= LK_RANGE_LIMIT) return 0;
+    uint64_t e = lk_end(off, len);
+    *start = off;
+    *end   = e > LK_RANGE_LIMIT ? LK_RANGE_LIMIT : e;
+    return 1;
+}
+
+/* Claim a range for this handle; EDEADLK if the handle itself holds it */
+static int lk_reserve(int fd, uint64_t off, uint64_t len, int excl, uint64_t* id) {
+    pthread_mutex_lock(&g_lk_lock);
+    for (size_t i = 0; i < g_lk_count; i++) {
+        const lk_range_t* r = &g_lk_ranges[i];
+        if (r->fd == fd && (excl || r->excl) && lk_overlap(r, off, len)) {
+            pthread_mutex_unlock(&g_lk_lock);
+            return EDEADLK;
+        }
+    }
+    if (g_lk_count == g_lk_cap) {
+        size_t cap = g_lk_cap ? g_lk_cap * 2 : 16;
+        lk_range_t* n = realloc(g_lk_ranges, cap * sizeof(*n));
+        if (!n) {
+            pthread_mutex_unlock(&g_lk_lock);
+            return ENOMEM;
+        }
+        g_lk_ranges = n;
+        g_lk_cap = cap;
+    }
+    *id = ++g_lk_seq;
+    g_lk_ranges[g_lk_count++] = (lk_range_t){
+        .fd = fd, .excl = excl, .pending = 1, .id = *id, .off = off, .len = len,
+    };
+    __atomic_store_n(&g_lk_live, g_lk_count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lk_lock);
+    return 0;
+}
+
+/* Confirm or drop a reservation; 0 if the handle was closed meanwhile */
+static int lk_settle(uint64_t id, int granted) {
+    int found = 0;
+    pthread_mutex_lock(&g_lk_lock);
+    for (size_t i = 0; i < g_lk_count; i++) {
+        if (g_lk_ranges[i].id != id) continue;
+        if (granted) g_lk_ranges[i].pending = 0;
+        else g_lk_ranges[i] = g_lk_ranges[--g_lk_count];
+        found = 1;
+        break;
+    }
+    __atomic_store_n(&g_lk_live, g_lk_count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lk_lock);
+    return found;
+}
+
+static int lk_cmp_start(const void* a, const void* b) {
+    const uint64_t* x = a;
+    const uint64_t* y = b;
+    return x[0] < y[0] ? -1 : x[0] > y[0];
+}
+
+/*
+ * Release [start, end) in the kernel except where other ranges of the
+ * handle still need it. g_lk_lock held.
+ */
+static void lk_release(int fd, uint64_t start, uint64_t end) {
+    uint64_t (*keep)[2] = NULL;
+    size_t nkeep = 0;
+    for (size_t i = 0; i < g_lk_count; i++) {
+        const lk_range_t* r = &g_lk_ranges[i];
+        uint64_t s, e;
+        if (r->fd != fd || !lk_span(r->off, r->len, &s, &e) || e <= start || s >= end) continue;
+        if (!keep && !(keep = malloc(g_lk_count * sizeof(*keep)))) return;  /* keep everything */
+        keep[nkeep][0] = s < start ? start : s;
+        keep[nkeep][1] = e > end ? end : e;
+        nkeep++;
+    }
+    if (nkeep > 1) qsort(keep, nkeep, sizeof(*keep), lk_cmp_start);
+
+    struct flock fl = { .l_type = F_UNLCK, .l_whence = SEEK_SET };
+    uint64_t pos = start;
+    for (size_t i = 0; i <= nkeep && pos < end; i++) {
+        uint64_t gap_end = i < nkeep ? keep[i][0] : end;
+        if (gap_end > pos) {
+            fl.l_start = (off_t)pos;
+            fl.l_len   = (off_t)(gap_end - pos);
+            fcntl(fd, F_OFD_SETLK, &fl);
+        }
+        if (i < nkeep && keep[i][1] > pos) pos = keep[i][1];
+    }
+    free(keep);
+}
+
+// ============================================================================
+// SECTION: Byte-range locks
+// ============================================================================
+
+/* Take the kernel part of a range; EAGAIN when someone else holds it */
+static int lk_kernel(int fd, uint64_t off, uint64_t len, int excl, int wait) {
+    uint64_t start, end;
+    if (!lk_span(off, len, &start, &end)) return 0;
+
+    struct flock fl = {
+        .l_type = excl ? F_WRLCK : F_RDLCK, .l_whence = SEEK_SET,
+        .l_start = (off_t)start, .l_len = (off_t)(end - start),
+    };
+    for (;;) {
+        if (fcntl(fd, wait ? F_OFD_SETLKW : F_OFD_SETLK, &fl) == 0) return 0;
+        if (errno == EINTR && wait) continue;
+        /* POSIX wants read access for a shared and write access for an
+         * exclusive lock. Taking the other kind instead would silently
+         * change what the lock excludes, so refuse. */
+        if (errno == EBADF) return EACCES;
+        if (errno == EAGAIN || errno == EACCES) return EAGAIN;
+        if (errno == EINVAL) return 0;  /* no OFD locks: in-process only */
+        return errno;
+    }
+}
+
+int win32_lock_range(int fd, uint64_t off, uint64_t len, int flags) {
+    int excl = flags & WIN32_LOCK_EXCLUSIVE;
+    uint64_t id;
+    int rc = lk_reserve(fd, off, len, excl, &id);
+    if (rc) return rc == EDEADLK ? EAGAIN : rc;
+
+    rc = lk_kernel(fd, off, len, excl, flags & WIN32_LOCK_WAIT);
+    lk_settle(id, rc == 0);
+    return rc;
+}
+
+int win32_unlock_range(int fd, uint64_t off, uint64_t len) {
+    pthread_mutex_lock(&g_lk_lock);
+    size_t i = 0;
+    while (i < g_lk_count && !(g_lk_ranges[i].fd == fd && !g_lk_ranges[i].pending &&
+                               g_lk_ranges[i].off == off && g_lk_ranges[i].len == len))
+        i++;
+    if (i == g_lk_count) {
+        pthread_mutex_unlock(&g_lk_lock);
+        return ENOLCK;
+    }
+    g_lk_ranges[i] = g_lk_ranges[--g_lk_count];
+    __atomic_store_n(&g_lk_live, g_lk_count, __ATOMIC_RELEASE);
+
+    uint64_t start, end;
+    if (lk_span(off, len, &start, &end)) lk_release(fd, start, end);
+    pthread_mutex_unlock(&g_lk_lock);
+    return 0;
+}
+
+void win32_lock_forget(int fd) {
+    if (!__atomic_load_n(&g_lk_live, __ATOMIC_ACQUIRE)) return;
+    pthread_mutex_lock(&g_lk_lock);
+    for (size_t i = 0; i < g_lk_count; ) {
+        if (g_lk_ranges[i].fd == fd) g_lk_ranges[i] = g_lk_ranges[--g_lk_count];
+        else i++;
+    }
+    __atomic_store_n(&g_lk_live, g_lk_count, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&g_lk_lock);
+}
+
+// ============================================================================
+// SECTION: Waiting locks
+// ============================================================================
+
+typedef struct {
+    int      fd;                        /* dup of the handle: same open, own number */
+    int      excl;
+    uint64_t id;
+    uint64_t off;
+    uint64_t len;
+    win32_lock_done_t done;
+    void*    ctx;
+} lk_wait_t;
+
+static void* lk_wait_thread(void* arg) {
+    lk_wait_t* w = arg;
+    int rc = lk_kernel(w->fd, w->off, w->len, w->excl, 1);
+    if (!lk_settle(w->id, rc == 0) && rc == 0) {
+        /* Closed while waiting: the lock dies with our descriptor */
+        rc = ECANCELED;
+    }
+    close(w->fd);
+    w->done(w->ctx, rc);
+    free(w);
+    return NULL;
+}
+
+int win32_lock_range_async(int fd, uint64_t off, uint64_t len, int flags,
+                           win32_lock_done_t done, void* ctx) {
+    int excl = flags & WIN32_LOCK_EXCLUSIVE;
+    uint64_t id;
+    int rc = lk_reserve(fd, off, len, excl, &id);
+    if (rc) return rc == EDEADLK ? EAGAIN : rc;
+
+    rc = lk_kernel(fd, off, len, excl, 0);
+    if (rc != EAGAIN || !(flags & WIN32_LOCK_WAIT)) {
+        lk_settle(id, rc == 0);
+        return rc;
+    }
+
+    /* The waiter keeps the open alive through its own descriptor, so a
+     * close (and fd reuse) cannot redirect the lock to another file */
+    lk_wait_t* w = malloc(sizeof(*w));
+    int wfd = w ? fcntl(fd, F_DUPFD_CLOEXEC, 0) : -1;
+    if (wfd < 0) {
+        rc = w ? errno : ENOMEM;
+        free(w);
+        lk_settle(id, 0);
+        return rc;
+    }
+    *w = (lk_wait_t){ .fd = wfd, .excl = excl, .id = id, .off = off, .len = len,
+                      .done = done, .ctx = ctx };
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t th;
+    rc = pthread_create(&th, &attr, lk_wait_thread, w);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        LSW_LOG_WARN("LockFileEx: waiter thread: %s", strerror(rc));
+        close(wfd);
+        free(w);
+        lk_settle(id, 0);
+        return rc;
+    }
+    return EINPROGRESS;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 process creation
+ *
+ * CreateProcess used to fork() the loader. With the PE images, the
+ * heaps and the reserved JIT ranges mapped, fork spends most of its
+ * time copying page tables that exec throws away a moment later, and a
+ * build spawning thousands of compilers pays that every time. A
+ * vfork-style clone shares the address space until exec instead, which
+ * also means the child must not touch anything of ours: all per-child
+ * setup is a posix_spawn file action or attribute.
+ *
+ * Standard handles are first duplicated above 2 (close-on-exec) and
+ * then dup2'ed into place, so STARTUPINFO may name them in any order,
+ * including swapped. Without bInheritHandles every descriptor above the
+ * standard ones (and the resume gate) is closed in the child.
+ */
+
+#define _GNU_SOURCE  /* POSIX_SPAWN_USEVFORK, posix_spawn_file_actions_add{chdir,closefrom}_np */
+
+#include "win32_spawn.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#define SP_GATE_FD  3               /* resume gate when nothing is inherited */
+
+// ============================================================================
+// SECTION: Spawn
+// ============================================================================
+
+/* envp plus WIN32_SPAWN_RESUME_ENV=<fd>; one allocation */
+static char** sp_env_with_gate(char* const* envp, int fd) {
+    size_t n = 0;
+    while (envp[n]) n++;
+    char** out = malloc((n + 2) * sizeof(char*) + 32);
+    if (!out) return NULL;
+    char* var = (char*)(out + n + 2);
+    snprintf(var, 32, "%s=%d", WIN32_SPAWN_RESUME_ENV, fd);
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++)
+        if (strncmp(envp[i], WIN32_SPAWN_RESUME_ENV "=", sizeof(WIN32_SPAWN_RESUME_ENV)) != 0)
+            out[j++] = envp[i];
+    out[j++] = var;
+    out[j] = NULL;
+    return out;
+}
+
+int win32_spawn(const win32_spawn_t* sp, pid_t* pid, int* resume_fd) {
+    *resume_fd = -1;
+
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    int tmp[3] = { -1, -1, -1 };
+    int gate[2] = { -1, -1 };
+    int gate_child = -1;
+    char** envp = NULL;
+    int err;
+
+    if ((err = posix_spawn_file_actions_init(&fa)) != 0) return err;
+    if ((err = posix_spawnattr_init(&attr)) != 0) {
+        posix_spawn_file_actions_destroy(&fa);
+        return err;
+    }
+
+    /* A fresh signal state: the loader's handlers and ignored SIGPIPE
+     * are ours, not the child's */
+    sigset_t all, none;
+    sigfillset(&all);
+    sigemptyset(&none);
+    err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_USEVFORK | POSIX_SPAWN_SETSIGDEF |
+                                          POSIX_SPAWN_SETSIGMASK);
+    if (!err) err = posix_spawnattr_setsigdefault(&attr, &all);
+    if (!err) err = posix_spawnattr_setsigmask(&attr, &none);
+
+    for (int i = 0; i < 3 && !err; i++) {
+        if (sp->std_fd[i] == WIN32_SPAWN_NULL) {
+            err = posix_spawn_file_actions_addopen(&fa, i, "/dev/null", i ? O_WRONLY : O_RDONLY, 0);
+        } else if (sp->std_fd[i] >= 0) {
+            tmp[i] = fcntl(sp->std_fd[i], F_DUPFD_CLOEXEC, 3);
+            err = tmp[i] < 0 ? errno : posix_spawn_file_actions_adddup2(&fa, tmp[i], i);
+        }
+    }
+
+    if (!err && sp->suspended) {
+        if (pipe2(gate, O_CLOEXEC) != 0) {
+            err = errno;
+        } else if (sp->inherit) {
+            /* A number that is free in the parent is free in the child */
+            gate_child = fcntl(gate[0], F_DUPFD_CLOEXEC, 3);
+            err = gate_child < 0 ? errno : posix_spawn_file_actions_adddup2(&fa, gate[0], gate_child);
+        } else {
+            gate_child = SP_GATE_FD;
+            err = posix_spawn_file_actions_adddup2(&fa, gate[0], gate_child);
+        }
+        if (!err && !(envp = sp_env_with_gate(sp->envp ? sp->envp : environ,
+                                               sp->inherit ? gate_child : SP_GATE_FD)))
+            err = ENOMEM;
+    }
+
+    if (!err && !sp->inherit)
+        err = posix_spawn_file_actions_addclosefrom_np(&fa, sp->suspended ? SP_GATE_FD + 1 : 3);
+    if (!err && sp->cwd)
+        err = posix_spawn_file_actions_addchdir_np(&fa, sp->cwd);
+
+    if (!err)
+        err = posix_spawn(pid, sp->path, &fa, &attr, sp->argv,
+                          envp ? envp : sp->envp ? sp->envp : environ);
+
+    posix_spawn_file_actions_destroy(&fa);
+    posix_spawnattr_destroy(&attr);
+    free(envp);
+    for (int i = 0; i < 3; i++)
+        if (tmp[i] >= 0) close(tmp[i]);
+    if (gate[0] >= 0) close(gate[0]);
+    if (sp->inherit && gate_child >= 0) close(gate_child);
+    if (gate[1] >= 0) {
+        if (err) close(gate[1]);
+        else *resume_fd = gate[1];
+    }
+    if (err) LSW_LOG_WARN("spawn %s: %s", sp->path, strerror(err));
+    return err;
+}
+
+// ============================================================================
+// SECTION: Suspended start
+// ============================================================================
+
+void win32_spawn_resume(int resume_fd) {
+    if (resume_fd < 0) return;
+    char go = 1;
+    while (write(resume_fd, &go, 1) < 0 && errno == EINTR) { }
+    close(resume_fd);
+}
+
+void win32_spawn_wait_resume(void) {
+    const char* v = getenv(WIN32_SPAWN_RESUME_ENV);
+    if (!v) return;
+    char* end;
+    long fd = strtol(v, &end, 10);
+    unsetenv(WIN32_SPAWN_RESUME_ENV);
+    if (*end || fd < 0 || fd > 65535) return;
+
+    LSW_LOG_DEBUG("spawn: suspended, waiting on fd %ld", fd);
+    char go;
+    while (read((int)fd, &go, 1) < 0 && errno == EINTR) { }
+    close((int)fd);
+}
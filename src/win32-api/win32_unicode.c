@@ -0,0 +1,1488 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 Unicode - UTF-8/UTF-16 transcoding, code page tables and the
+ * UTF-16 string engine
+ *
+ * Backs MultiByteToWideChar / WideCharToMultiByte and through them every
+ * *A entry point, so the common case (ASCII runs) is vectorised:
+ * SSE2 always, AVX2 when the CPU has it. Everything else is a scalar
+ * decoder that follows the Unicode "maximal subpart" rules, which is
+ * also what Windows does when it substitutes U+FFFD.
+ *
+ * CompareString / LCMapString / CharUpper work on uint16_t buffers
+ * directly with table-driven case mapping and SSE2 ASCII blocks.
+ */
+
+#include "win32_unicode.h"
+#include "lsw_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <iconv.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LSW_UNICODE_SIMD 1
+#endif
+
+#define REPLACEMENT_CHAR 0xFFFD
+
+/* ---- ASCII fast paths -------------------------------------------------- */
+
+/* Each helper returns the length of the leading ASCII run of `s`
+ * (at most n) and, when d != NULL, copies it widened / narrowed. */
+
+static size_t ascii_widen_scalar(const uint8_t* s, size_t n, uint16_t* d) {
+    size_t i = 0;
+    while (i < n && s[i] < 0x80) {
+        if (d) d[i] = s[i];
+        i++;
+    }
+    return i;
+}
+
+static size_t ascii_narrow_scalar(const uint16_t* s, size_t n, uint8_t* d) {
+    size_t i = 0;
+    while (i < n && s[i] < 0x80) {
+        if (d) d[i] = (uint8_t)s[i];
+        i++;
+    }
+    return i;
+}
+
+#ifdef LSW_UNICODE_SIMD
+static size_t ascii_widen_sse2(const uint8_t* s, size_t n, uint16_t* d) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        if (_mm_movemask_epi8(v)) break;
+        if (d) {
+            _mm_storeu_si128((__m128i*)(d + i),     _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128((__m128i*)(d + i + 8), _mm_unpackhi_epi8(v, zero));
+        }
+    }
+    return i + ascii_widen_scalar(s + i, n - i, d ? d + i : NULL);
+}
+
+static size_t ascii_narrow_sse2(const uint16_t* s, size_t n, uint8_t* d) {
+    const __m128i high = _mm_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + i + 8));
+        __m128i hi = _mm_and_si128(_mm_or_si128(a, b), high);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(hi, _mm_setzero_si128())) != 0xFFFF) break;
+        if (d) _mm_storeu_si128((__m128i*)(d + i), _mm_packus_epi16(a, b));
+    }
+    return i + ascii_narrow_scalar(s + i, n - i, d ? d + i : NULL);
+}
+
+__attribute__((target("avx2")))
+static size_t ascii_widen_avx2(const uint8_t* s, size_t n, uint16_t* d) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        if (_mm256_movemask_epi8(v)) break;
+        if (d) {
+            _mm256_storeu_si256((__m256i*)(d + i),
+                                _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+            _mm256_storeu_si256((__m256i*)(d + i + 16),
+                                _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+        }
+    }
+    return i + ascii_widen_sse2(s + i, n - i, d ? d + i : NULL);
+}
+
+__attribute__((target("avx2")))
+static size_t ascii_narrow_avx2(const uint16_t* s, size_t n, uint8_t* d) {
+    const __m256i high = _mm256_set1_epi16((short)0xFF80);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + i + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), high)) break;
+        if (d) {
+            /* packus works per 128-bit lane; restore element order */
+            __m256i p = _mm256_packus_epi16(a, b);
+            _mm256_storeu_si256((__m256i*)(d + i), _mm256_permute4x64_epi64(p, 0xD8));
+        }
+    }
+    return i + ascii_narrow_sse2(s + i, n - i, d ? d + i : NULL);
+}
+
+static int have_avx2 = -1;
+
+static inline int cpu_has_avx2(void) {
+    int v = __atomic_load_n(&have_avx2, __ATOMIC_RELAXED);
+    if (v < 0) {
+        __builtin_cpu_init();
+        v = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&have_avx2, v, __ATOMIC_RELAXED);
+    }
+    return v;
+}
+
+static inline size_t ascii_widen(const uint8_t* s, size_t n, uint16_t* d) {
+    return cpu_has_avx2() ? ascii_widen_avx2(s, n, d) : ascii_widen_sse2(s, n, d);
+}
+
+static inline size_t ascii_narrow(const uint16_t* s, size_t n, uint8_t* d) {
+    return cpu_has_avx2() ? ascii_narrow_avx2(s, n, d) : ascii_narrow_sse2(s, n, d);
+}
+#else
+#define ascii_widen  ascii_widen_scalar
+#define ascii_narrow ascii_narrow_scalar
+#endif
+
+/* Copy (or count) the ASCII run at src[*i], bounded by the space left in dst. */
+static inline void ascii_run_widen(const uint8_t* src, size_t len, size_t* i,
+                                   uint16_t* dst, size_t cap, size_t* o) {
+    size_t n = len - *i;
+    if (dst && cap - *o < n) n = cap - *o;
+    size_t k = ascii_widen(src + *i, n, dst ? dst + *o : NULL);
+    *i += k;
+    *o += k;
+}
+
+static inline void ascii_run_narrow(const uint16_t* src, size_t len, size_t* i,
+                                    uint8_t* dst, size_t cap, size_t* o) {
+    size_t n = len - *i;
+    if (dst && cap - *o < n) n = cap - *o;
+    size_t k = ascii_narrow(src + *i, n, dst ? dst + *o : NULL);
+    *i += k;
+    *o += k;
+}
+
+/* ---- UTF-8 <-> UTF-16 -------------------------------------------------- */
+
+/* Decode one non-ASCII sequence at s[0..n). Returns bytes consumed
+ * (always >= 1); *cp is the scalar value or -1 for an ill-formed
+ * maximal subpart. */
+static inline size_t utf8_decode(const uint8_t* s, size_t n, int32_t* cp) {
+    uint8_t b0 = s[0];
+    uint8_t lo = 0x80, hi = 0xBF;
+    size_t need;
+    int32_t c;
+
+    if (b0 >= 0xC2 && b0 <= 0xDF)      { need = 1; c = b0 & 0x1F; }
+    else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        need = 2; c = b0 & 0x0F;
+        if (b0 == 0xE0) lo = 0xA0;       /* overlong */
+        if (b0 == 0xED) hi = 0x9F;       /* surrogates */
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        need = 3; c = b0 & 0x07;
+        if (b0 == 0xF0) lo = 0x90;       /* overlong */
+        if (b0 == 0xF4) hi = 0x8F;       /* > U+10FFFF */
+    } else {
+        *cp = -1;
+        return 1;
+    }
+
+    size_t k = 1;
+    for (; k <= need; k++) {
+        if (k >= n || s[k] < lo || s[k] > hi) {
+            *cp = -1;
+            return k;
+        }
+        c = (c << 6) | (s[k] & 0x3F);
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    *cp = c;
+    return k;
+}
+
+ptrdiff_t win32_utf8_to_utf16(const uint8_t* src, size_t len, uint16_t* dst, size_t cap, int strict) {
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        if (src[i] < 0x80) {
+            ascii_run_widen(src, len, &i, dst, cap, &o);
+            if (i < len && src[i] < 0x80) return WIN32_UNICODE_NOSPACE;
+            continue;
+        }
+
+        int32_t cp;
+        size_t k = utf8_decode(src + i, len - i, &cp);
+        if (cp < 0) {
+            if (strict) return WIN32_UNICODE_INVALID;
+            cp = REPLACEMENT_CHAR;
+        }
+        size_t units = cp >= 0x10000 ? 2 : 1;
+        if (dst) {
+            if (cap - o < units) return WIN32_UNICODE_NOSPACE;
+            if (units == 2) {
+                cp -= 0x10000;
+                dst[o]     = (uint16_t)(0xD800 | (cp >> 10));
+                dst[o + 1] = (uint16_t)(0xDC00 | (cp & 0x3FF));
+            } else {
+                dst[o] = (uint16_t)cp;
+            }
+        }
+        o += units;
+        i += k;
+    }
+    return (ptrdiff_t)o;
+}
+
+ptrdiff_t win32_utf16_to_utf8(const uint16_t* src, size_t len, uint8_t* dst, size_t cap, int strict) {
+    size_t i = 0, o = 0;
+
+    while (i < len) {
+        uint32_t c = src[i];
+        if (c < 0x80) {
+            ascii_run_narrow(src, len, &i, dst, cap, &o);
+            if (i < len && src[i] < 0x80) return WIN32_UNICODE_NOSPACE;
+            continue;
+        }
+
+        size_t used = 1;
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            if (c <= 0xDBFF && i + 1 < len && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+                used = 2;
+            } else if (strict) {
+                return WIN32_UNICODE_INVALID;
+            } else {
+                c = REPLACEMENT_CHAR;
+            }
+        }
+
+        size_t bytes = c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if (dst) {
+            if (cap - o < bytes) return WIN32_UNICODE_NOSPACE;
+            uint8_t* p = dst + o;
+            switch (bytes) {
+            case 2:
+                p[0] = (uint8_t)(0xC0 | (c >> 6));
+                p[1] = (uint8_t)(0x80 | (c & 0x3F));
+                break;
+            case 3:
+                p[0] = (uint8_t)(0xE0 | (c >> 12));
+                p[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                p[2] = (uint8_t)(0x80 | (c & 0x3F));
+                break;
+            default:
+                p[0] = (uint8_t)(0xF0 | (c >> 18));
+                p[1] = (uint8_t)(0x80 | ((c >> 12) & 0x3F));
+                p[2] = (uint8_t)(0x80 | ((c >> 6) & 0x3F));
+                p[3] = (uint8_t)(0x80 | (c & 0x3F));
+                break;
+            }
+        }
+        o += bytes;
+        i += used;
+    }
+    return (ptrdiff_t)o;
+}
+
+/* ---- Code page tables -------------------------------------------------- */
+
+#define CP_ACP        0
+#define CP_OEMCP      1
+#define CP_MACCP      2
+#define CP_THREAD_ACP 3
+#define CP_SYMBOL     42
+#define CP_UTF8       65001
+
+#define CP_UNDEFINED  0xFFFF   /* sb[] entry for lead / unassigned bytes */
+#define CP_MAX_TABLES 16
+
+/* Upper halves (0x80..0xFF) of the built-in single-byte pages. 1252 maps
+ * its five holes to the matching C1 control, as Windows does. */
+static const uint16_t cp1252_high[128] = {
+    0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+    0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+static const uint16_t cp437_high[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0,
+};
+
+static const uint16_t cp850_high[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00F8, 0x00A3, 0x00D8, 0x00D7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x00AE, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x00C1, 0x00C2, 0x00C0,
+    0x00A9, 0x2563, 0x2551, 0x2557, 0x255D, 0x00A2, 0x00A5, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x00E3, 0x00C3,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x00A4,
+    0x00F0, 0x00D0, 0x00CA, 0x00CB, 0x00C8, 0x0131, 0x00CD, 0x00CE,
+    0x00CF, 0x2518, 0x250C, 0x2588, 0x2584, 0x00A6, 0x00CC, 0x2580,
+    0x00D3, 0x00DF, 0x00D4, 0x00D2, 0x00F5, 0x00D5, 0x00B5, 0x00FE,
+    0x00DE, 0x00DA, 0x00DB, 0x00D9, 0x00FD, 0x00DD, 0x00AF, 0x00B4,
+    0x00AD, 0x00B1, 0x2017, 0x00BE, 0x00B6, 0x00A7, 0x00F7, 0x00B8,
+    0x00B0, 0x00A8, 0x00B7, 0x00B9, 0x00B3, 0x00B2, 0x25A0, 0x00A0,
+};
+
+typedef struct {
+    unsigned int cp;
+    int          dbcs;
+    int          ascii_identity;   /* 0x00..0x7F map to themselves */
+    uint16_t     sb[256];          /* byte -> UTF-16, CP_UNDEFINED if none */
+    uint8_t      lead[256];        /* DBCS lead byte flags */
+    uint16_t*    db;               /* [lead << 8 | trail] -> UTF-16, 0 = none */
+    uint16_t*    rev;              /* UTF-16 -> byte, or lead << 8 | trail */
+} cp_table_t;
+
+static cp_table_t* cp_tables[CP_MAX_TABLES];
+static unsigned int cp_failed[CP_MAX_TABLES];
+static pthread_mutex_t cp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int cp_build_reverse(cp_table_t* t) {
+    t->rev = calloc(65536, sizeof(uint16_t));
+    if (!t->rev) return 0;
+    /* Single bytes first so they win over double-byte aliases */
+    for (int b = 1; b < 256; b++) {
+        uint16_t u = t->sb[b];
+        if (u != CP_UNDEFINED && u && !t->rev[u]) t->rev[u] = (uint16_t)b;
+    }
+    if (t->db) {
+        for (uint32_t code = 0x100; code < 0x10000; code++) {
+            uint16_t u = t->db[code];
+            if (u && !t->rev[u]) t->rev[u] = (uint16_t)code;
+        }
+    }
+    return 1;
+}
+
+static cp_table_t* cp_build_builtin(unsigned int cp, const uint16_t* high) {
+    cp_table_t* t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->cp = cp;
+    t->ascii_identity = 1;
+    for (int b = 0; b < 256; b++) {
+        if (b < 0x80)           t->sb[b] = (uint16_t)b;
+        else if (high)          t->sb[b] = high[b - 0x80];
+        else if (cp == 20127)   t->sb[b] = CP_UNDEFINED;   /* 7-bit only */
+        else                    t->sb[b] = (uint16_t)b;
+    }
+    if (!cp_build_reverse(t)) { free(t); return NULL; }
+    return t;
+}
+
+/* Convert one byte sequence through iconv. Returns the UTF-16 unit,
+ * 0 for an incomplete sequence (lead byte), -1 if unassigned. */
+static int cp_iconv_one(iconv_t cd, const uint8_t* in, size_t n) {
+    char* ip = (char*)in;
+    uint16_t out[4];
+    char* op = (char*)out;
+    size_t il = n, ol = sizeof(out);
+
+    iconv(cd, NULL, NULL, NULL, NULL);
+    if (iconv(cd, &ip, &il, &op, &ol) == (size_t)-1)
+        return errno == EINVAL ? 0 : -1;
+    /* Characters outside the BMP have no place in these tables */
+    if (sizeof(out) - ol != 2) return -1;
+    return out[0];
+}
+
+static cp_table_t* cp_build_iconv(unsigned int cp) {
+    char name[16];
+    snprintf(name, sizeof(name), "CP%u", cp);
+    iconv_t cd = iconv_open("UTF-16LE", name);
+    if (cd == (iconv_t)-1) return NULL;
+
+    cp_table_t* t = calloc(1, sizeof(*t));
+    if (!t) { iconv_close(cd); return NULL; }
+    t->cp = cp;
+    t->ascii_identity = 1;
+
+    for (int b = 0; b < 256; b++) {
+        uint8_t byte = (uint8_t)b;
+        int u = b == 0 ? 0 : cp_iconv_one(cd, &byte, 1);
+        if (u == 0 && b != 0) {
+            t->lead[b] = 1;
+            t->dbcs = 1;
+            t->sb[b] = CP_UNDEFINED;
+        } else {
+            t->sb[b] = u < 0 ? CP_UNDEFINED : (uint16_t)u;
+        }
+        if (b < 0x80 && t->sb[b] != b) t->ascii_identity = 0;
+    }
+
+    if (t->dbcs) {
+        t->db = calloc(65536, sizeof(uint16_t));
+        if (!t->db) { iconv_close(cd); free(t); return NULL; }
+        for (int l = 0x80; l < 256; l++) {
+            if (!t->lead[l]) continue;
+            for (int tr = 0x01; tr < 256; tr++) {
+                uint8_t seq[2] = { (uint8_t)l, (uint8_t)tr };
+                int u = cp_iconv_one(cd, seq, 2);
+                if (u > 0) t->db[(l << 8) | tr] = (uint16_t)u;
+            }
+        }
+    }
+    iconv_close(cd);
+
+    if (!cp_build_reverse(t)) { free(t->db); free(t); return NULL; }
+    LSW_LOG_DEBUG("codepage: built %s table for %u", t->dbcs ? "DBCS" : "SBCS", cp);
+    return t;
+}
+
+unsigned int win32_codepage_resolve(unsigned int cp) {
+    switch (cp) {
+    case CP_ACP:
+    case CP_THREAD_ACP:
+    case CP_MACCP:      return 1252;    /* keep in sync with GetACP() */
+    case CP_OEMCP:      return 437;     /* keep in sync with GetOEMCP() */
+    default:            return cp;
+    }
+}
+
+/* Look up (building on first use) the table for an already-resolved cp.
+ * Returns NULL for UTF-8 and for code pages we cannot provide. */
+static cp_table_t* cp_table_get(unsigned int cp) {
+    for (int i = 0; i < CP_MAX_TABLES; i++) {
+        cp_table_t* t = __atomic_load_n(&cp_tables[i], __ATOMIC_ACQUIRE);
+        if (!t) break;
+        if (t->cp == cp) return t;
+    }
+    if (cp == CP_UTF8 || cp == 65000 /* UTF-7 */) return NULL;
+
+    pthread_mutex_lock(&cp_lock);
+    cp_table_t* t = NULL;
+    int slot = -1;
+    for (int i = 0; i < CP_MAX_TABLES; i++) {
+        if (cp_failed[i] == cp) goto out;
+        if (!cp_tables[i]) { slot = i; break; }
+        if (cp_tables[i]->cp == cp) { t = cp_tables[i]; goto out; }
+    }
+    if (slot < 0) goto out;
+
+    switch (cp) {
+    case 1252:  t = cp_build_builtin(cp, cp1252_high); break;
+    case 437:   t = cp_build_builtin(cp, cp437_high); break;
+    case 850:   t = cp_build_builtin(cp, cp850_high); break;
+    case 20127: /* US-ASCII, ISO-8859-1 and Symbol need no table */
+    case 28591:
+    case CP_SYMBOL:
+                t = cp_build_builtin(cp, NULL); break;
+    default:    t = cp_build_iconv(cp); break;
+    }
+    if (t) {
+        __atomic_store_n(&cp_tables[slot], t, __ATOMIC_RELEASE);
+    } else {
+        LSW_LOG_WARN("codepage: code page %u is not available", cp);
+        for (int i = 0; i < CP_MAX_TABLES; i++)
+            if (!cp_failed[i]) { cp_failed[i] = cp; break; }
+    }
+out:
+    pthread_mutex_unlock(&cp_lock);
+    return t;
+}
+
+int win32_codepage_valid(unsigned int cp) {
+    cp = win32_codepage_resolve(cp);
+    return cp == CP_UTF8 || cp_table_get(cp) != NULL;
+}
+
+int win32_codepage_info(unsigned int cp, win32_cpinfo_t* info) {
+    cp = win32_codepage_resolve(cp);
+    memset(info, 0, sizeof(*info));
+    info->default_char[0] = '?';
+
+    if (cp == CP_UTF8) {
+        info->max_char_size = 4;
+        return 1;
+    }
+    cp_table_t* t = cp_table_get(cp);
+    if (!t) return 0;
+
+    info->max_char_size = t->dbcs ? 2 : 1;
+    int n = 0;
+    for (int b = 0x80; b < 256 && n < 10; ) {
+        if (!t->lead[b]) { b++; continue; }
+        int start = b;
+        while (b < 256 && t->lead[b]) b++;
+        info->lead_byte[n++] = (uint8_t)start;
+        info->lead_byte[n++] = (uint8_t)(b - 1);
+    }
+    return 1;
+}
+
+int win32_codepage_is_lead_byte(unsigned int cp, uint8_t byte) {
+    cp = win32_codepage_resolve(cp);
+    if (cp == CP_UTF8) return 0;
+    cp_table_t* t = cp_table_get(cp);
+    return t ? t->lead[byte] : 0;
+}
+
+ptrdiff_t win32_mb_to_utf16(unsigned int cp, const uint8_t* src, size_t len,
+                            uint16_t* dst, size_t cap, int strict) {
+    cp = win32_codepage_resolve(cp);
+    if (cp == CP_UTF8) return win32_utf8_to_utf16(src, len, dst, cap, strict);
+
+    cp_table_t* t = cp_table_get(cp);
+    if (!t) return WIN32_UNICODE_INVALID;
+
+    size_t i = 0, o = 0;
+    while (i < len) {
+        if (src[i] < 0x80 && t->ascii_identity) {
+            ascii_run_widen(src, len, &i, dst, cap, &o);
+            if (i < len && src[i] < 0x80) return WIN32_UNICODE_NOSPACE;
+            continue;
+        }
+
+        uint8_t b = src[i++];
+        uint16_t u = t->sb[b];
+        if (t->lead[b]) {
+            u = i < len ? t->db[(b << 8) | src[i]] : 0;
+            if (u) i++;
+            else u = CP_UNDEFINED;
+        }
+        if (u == CP_UNDEFINED) {
+            if (strict) return WIN32_UNICODE_INVALID;
+            u = '?';
+        }
+        if (dst) {
+            if (o >= cap) return WIN32_UNICODE_NOSPACE;
+            dst[o] = u;
+        }
+        o++;
+    }
+    return (ptrdiff_t)o;
+}
+
+ptrdiff_t win32_utf16_to_mb(unsigned int cp, const uint16_t* src, size_t len,
+                            uint8_t* dst, size_t cap, const char* defchar, int* used_default) {
+    cp = win32_codepage_resolve(cp);
+    if (used_default) *used_default = 0;
+    if (cp == CP_UTF8) return win32_utf16_to_utf8(src, len, dst, cap, 0);
+
+    cp_table_t* t = cp_table_get(cp);
+    if (!t) return WIN32_UNICODE_INVALID;
+
+    uint16_t def = '?';
+    if (defchar && defchar[0]) {
+        def = (uint8_t)defchar[0];
+        if (t->dbcs && t->lead[def] && defchar[1])
+            def = (uint16_t)((def << 8) | (uint8_t)defchar[1]);
+    }
+
+    size_t i = 0, o = 0;
+    while (i < len) {
+        if (src[i] < 0x80 && t->ascii_identity) {
+            ascii_run_narrow(src, len, &i, dst, cap, &o);
+            if (i < len && src[i] < 0x80) return WIN32_UNICODE_NOSPACE;
+            continue;
+        }
+
+        uint16_t u = src[i++];
+        uint16_t code = t->rev[u];
+        if (!code && u) {
+            /* A surrogate pair is one character: one default char */
+            if (u >= 0xD800 && u <= 0xDBFF && i < len && src[i] >= 0xDC00 && src[i] <= 0xDFFF)
+                i++;
+            code = def;
+            if (used_default) *used_default = 1;
+        }
+        size_t bytes = code > 0xFF ? 2 : 1;
+        if (dst) {
+            if (cap - o < bytes) return WIN32_UNICODE_NOSPACE;
+            if (bytes == 2) {
+                dst[o]     = (uint8_t)(code >> 8);
+                dst[o + 1] = (uint8_t)code;
+            } else {
+                dst[o] = (uint8_t)code;
+            }
+        }
+        o += bytes;
+    }
+    return (ptrdiff_t)o;
+}
+
+/* ---- UTF-16 string engine ---------------------------------------------- */
+
+/* Simple case mappings from UnicodeData 14.0.0, BMP only (Windows maps
+ * case per UTF-16 unit too). Each 64-unit block of the BMP indexes a
+ * row of deltas, applied modulo 2^16; row 0 is the identity.
+ * Generated from the UCD; do not edit by hand. */
+#define CASE_BLOCK_SHIFT 6
+#define CASE_BLOCK_MASK  63
+
+static const uint8_t case_upper_index[1024] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10,  0,  0, 11, 12, 13,
+    14, 15, 16, 17, 18, 19, 20,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0, 21,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 22,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0, 23,  0,  0, 24, 25,  0, 26, 26, 27, 26, 28, 29, 30, 31,
+     0,  0,  0,  0,  0, 32, 33,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0, 34,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    35, 36, 26, 37, 38,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0, 39, 40,  0, 41, 42, 43, 44,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 45, 46,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 47,  0,  0,
+};
+
+static const uint8_t case_lower_index[1024] = {
+     0, 48,  0, 49, 50, 51, 52, 53, 54, 55,  0,  0,  0, 56, 57, 58,
+    59, 60, 61, 62, 63, 64,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0, 65, 66,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 67, 68,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0, 69,  0,  0,  0,  0,  0, 70, 70, 71, 70, 72, 73, 74, 75,
+     0,  0,  0,  0, 76, 77, 78,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0, 79, 80,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    81, 82, 70, 83,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0, 84, 85,  0, 86, 87, 88, 89,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 90,  0,  0,  0,
+};
+
+static const int16_t case_delta[91][64] = {
+    { /* 0 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 1 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,     0,     0,     0,     0,     0,
+    },
+    { /* 2 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,   743,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 3 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,     0,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   121,
+    },
+    { /* 4 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,  -232,     0,    -1,     0,    -1,     0,    -1,     0,     0,    -1,     0,    -1,     0,    -1,     0,
+    },
+    { /* 5 */
+           -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,    -1,     0,    -1,     0,    -1,  -300,
+    },
+    { /* 6 */
+          195,     0,     0,    -1,     0,    -1,     0,     0,    -1,     0,     0,     0,    -1,     0,     0,     0,
+            0,     0,    -1,     0,     0,    97,     0,     0,     0,    -1,   163,     0,     0,     0,   130,     0,
+            0,    -1,     0,    -1,     0,    -1,     0,     0,    -1,     0,     0,     0,     0,    -1,     0,     0,
+           -1,     0,     0,     0,    -1,     0,    -1,     0,     0,    -1,     0,     0,     0,    -1,     0,    56,
+    },
+    { /* 7 */
+            0,     0,     0,     0,     0,    -1,    -2,     0,    -1,    -2,     0,    -1,    -2,     0,    -1,     0,
+           -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,   -79,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,     0,    -1,    -2,     0,    -1,     0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 8 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,    -1,     0,     0, 10815,
+    },
+    { /* 9 */
+        10815,     0,    -1,     0,     0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+        10783, 10780, 10782,  -210,  -206,     0,  -205,  -205,     0,  -202,     0,  -203, -23217,     0,     0,     0,
+         -205, -23221,     0,  -207,     0, -23256, -23228,     0,  -209,  -211, -23228, 10743, -23231,     0,     0,  -211,
+            0, 10749,  -213,     0,     0,  -214,     0,     0,     0,     0,     0,     0,     0, 10727,     0,     0,
+    },
+    { /* 10 */
+         -218,     0, -23229,  -218,     0,     0,     0, -23254,  -218,   -69,  -217,  -217,   -71,     0,     0,     0,
+            0,     0,  -219,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0, -23275, -23278,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 11 */
+            0,     0,     0,     0,     0,    84,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,    -1,     0,    -1,     0,     0,     0,    -1,     0,     0,     0,   130,   130,   130,     0,     0,
+    },
+    { /* 12 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,   -38,   -37,   -37,   -37,
+            0,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+    },
+    { /* 13 */
+          -32,   -32,   -31,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -64,   -63,   -63,     0,
+          -62,   -57,     0,     0,     0,   -47,   -54,    -8,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+          -86,   -80,     7,  -116,     0,   -96,     0,     0,    -1,     0,     0,    -1,     0,     0,     0,     0,
+    },
+    { /* 14 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+    },
+    { /* 15 */
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+          -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 16 */
+            0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 17 */
+            0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,   -15,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 18 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 19 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,
+          -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,
+    },
+    { /* 20 */
+          -48,   -48,   -48,   -48,   -48,   -48,   -48,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 21 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+         3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,
+         3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,
+         3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,  3008,     0,     0,  3008,  3008,  3008,
+    },
+    { /* 22 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,     0,     0,
+    },
+    { /* 23 */
+        -6254, -6253, -6244, -6242, -6242, -6243, -6236, -6181, -30270,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 24 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0, -30204,     0,     0,     0,  3814,     0,     0,
+    },
+    { /* 25 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0, -30152,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 26 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 27 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,     0,     0,     0,     0,   -59,     0,     0,     0,     0,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 28 */
+            8,     8,     8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 29 */
+            8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     8,     0,     8,     0,     8,     0,     8,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,
+           74,    74,    86,    86,    86,    86,   100,   100,   128,   128,   112,   112,   126,   126,     0,     0,
+    },
+    { /* 30 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0, -7205,     0,
+    },
+    { /* 31 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            8,     8,     0,     0,     0,     7,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 32 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,   -28,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+          -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,   -16,
+    },
+    { /* 33 */
+            0,     0,     0,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 34 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+          -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,
+          -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,   -26,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 35 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+          -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,
+    },
+    { /* 36 */
+          -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,
+          -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,   -48,
+            0,    -1,     0,     0,     0, -10795, -10792,     0,    -1,     0,    -1,     0,    -1,     0,     0,     0,
+            0,     0,     0,    -1,     0,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 37 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,    -1,     0,    -1,     0,
+            0,     0,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 38 */
+        -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264,
+        -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264, -7264,
+        -7264, -7264, -7264, -7264, -7264, -7264,     0, -7264,     0,     0,     0,     0,     0, -7264,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 39 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 40 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 41 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 42 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,    -1,     0,    -1,     0,     0,    -1,
+    },
+    { /* 43 */
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,     0,     0,    -1,     0,     0,     0,
+            0,    -1,     0,    -1,    48,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+            0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,     0,    -1,
+    },
+    { /* 44 */
+            0,    -1,     0,    -1,     0,     0,     0,     0,    -1,     0,    -1,     0,     0,     0,     0,     0,
+            0,    -1,     0,     0,     0,     0,     0,    -1,     0,    -1,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,    -1,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 45 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,  -928,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+        26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672,
+    },
+    { /* 46 */
+        26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672,
+        26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672,
+        26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672,
+        26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672, 26672,
+    },
+    { /* 47 */
+            0,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,
+          -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,   -32,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 48 */
+            0,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+           32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 49 */
+           32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+           32,    32,    32,    32,    32,    32,    32,     0,    32,    32,    32,    32,    32,    32,    32,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 50 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+         -199,     0,     1,     0,     1,     0,     1,     0,     0,     1,     0,     1,     0,     1,     0,     1,
+    },
+    { /* 51 */
+            0,     1,     0,     1,     0,     1,     0,     1,     0,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,  -121,     1,     0,     1,     0,     1,     0,     0,
+    },
+    { /* 52 */
+            0,   210,     1,     0,     1,     0,   206,     1,     0,   205,   205,     1,     0,     0,    79,   202,
+          203,     1,     0,   205,   207,     0,   211,   209,     1,     0,     0,     0,   211,   213,     0,   214,
+            1,     0,     1,     0,     1,     0,   218,     1,     0,   218,     0,     0,     1,     0,   218,     1,
+            0,   217,   217,     1,     0,     1,     0,   219,     1,     0,     0,     0,     1,     0,     0,     0,
+    },
+    { /* 53 */
+            0,     0,     0,     0,     2,     1,     0,     2,     1,     0,     2,     1,     0,     1,     0,     1,
+            0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,     2,     1,     0,     1,     0,   -97,   -56,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 54 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+         -130,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     0,     0,     0,     0,     0,     0, 10795,     1,     0,  -163, 10792,     0,
+    },
+    { /* 55 */
+            0,     1,     0,  -195,    69,    71,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 56 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            1,     0,     1,     0,     0,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,   116,
+    },
+    { /* 57 */
+            0,     0,     0,     0,     0,     0,    38,     0,    37,    37,    37,     0,    64,     0,    63,    63,
+            0,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+           32,    32,     0,    32,    32,    32,    32,    32,    32,    32,    32,    32,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 58 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     8,
+            0,     0,     0,     0,     0,     0,     0,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,     0,     0,     0,   -60,     0,     0,     1,     0,    -7,     1,     0,     0,  -130,  -130,  -130,
+    },
+    { /* 59 */
+           80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,    80,
+           32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+           32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 60 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 61 */
+            1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 62 */
+           15,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 63 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+    },
+    { /* 64 */
+           48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+           48,    48,    48,    48,    48,    48,    48,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 65 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+         7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,
+         7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,  7264,
+    },
+    { /* 66 */
+         7264,  7264,  7264,  7264,  7264,  7264,     0,  7264,     0,     0,     0,     0,     0,  7264,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 67 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+        -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672,
+        -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672,
+    },
+    { /* 68 */
+        -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672,
+        -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672,
+        -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672, -26672,
+            8,     8,     8,     8,     8,     8,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 69 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+        -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008,
+        -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008,
+        -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008, -3008,     0,     0, -3008, -3008, -3008,
+    },
+    { /* 70 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 71 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,     0, -7615,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 72 */
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+    },
+    { /* 73 */
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,    -8,     0,    -8,     0,    -8,     0,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 74 */
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,    -8,    -8,    -8,    -8,    -8,    -8,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,   -74,   -74,    -9,     0,     0,     0,
+    },
+    { /* 75 */
+            0,     0,     0,     0,     0,     0,     0,     0,   -86,   -86,   -86,   -86,    -9,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,  -100,  -100,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,    -8,    -8,  -112,  -112,    -7,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,  -128,  -128,  -126,  -126,    -9,     0,     0,     0,
+    },
+    { /* 76 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0, -7517,     0,     0,     0, -8383, -8262,     0,     0,     0,     0,
+            0,     0,    28,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 77 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+           16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,    16,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 78 */
+            0,     0,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 79 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,
+    },
+    { /* 80 */
+           26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,    26,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 81 */
+           48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+           48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+           48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,    48,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 82 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            1,     0, -10743, -3814, -10727,     0,     0,     1,     0,     1,     0,     1,     0, -10780, -10749, -10783,
+        -10782,     0,     1,     0,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0, -10815, -10815,
+    },
+    { /* 83 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,     1,     0,     1,     0,     0,
+            0,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 84 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 85 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 86 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 87 */
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     1,     0,     1,     0, 30204,     1,     0,
+    },
+    { /* 88 */
+            1,     0,     1,     0,     1,     0,     1,     0,     0,     0,     0,     1,     0, 23256,     0,     0,
+            1,     0,     1,     0,     0,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+            1,     0,     1,     0,     1,     0,     1,     0,     1,     0, 23228, 23217, 23221, 23231, 23228,     0,
+        23278, 23254, 23275,   928,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,     1,     0,
+    },
+    { /* 89 */
+            1,     0,     1,     0,   -48, 23229, 30152,     1,     0,     1,     0,     0,     0,     0,     0,     0,
+            1,     0,     0,     0,     0,     0,     1,     0,     1,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     1,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+    },
+    { /* 90 */
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+            0,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+           32,    32,    32,    32,    32,    32,    32,    32,    32,    32,    32,     0,     0,     0,     0,     0,
+    },
+};
+
+static inline uint16_t case_map(const uint8_t* index, uint16_t c) {
+    return (uint16_t)(c + case_delta[index[c >> CASE_BLOCK_SHIFT]][c & CASE_BLOCK_MASK]);
+}
+
+uint16_t win32_u16_upper(uint16_t c) {
+    if (c < 0x80) return (c >= 'a' && c <= 'z') ? (uint16_t)(c - 0x20) : c;
+    return case_map(case_upper_index, c);
+}
+
+uint16_t win32_u16_lower(uint16_t c) {
+    if (c < 0x80) return (c >= 'A' && c <= 'Z') ? (uint16_t)(c + 0x20) : c;
+    return case_map(case_lower_index, c);
+}
+
+#ifdef LSW_UNICODE_SIMD
+/* Shift every unit in [lo, hi] by `delta`; callers only pass ASCII ranges,
+ * and signed compares are fine because such units are never negative. */
+static inline __m128i ascii_case_sse2(__m128i v, short lo, short hi, short delta) {
+    __m128i in = _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16((short)(lo - 1))),
+                               _mm_cmplt_epi16(v, _mm_set1_epi16((short)(hi + 1))));
+    return _mm_add_epi16(v, _mm_and_si128(in, _mm_set1_epi16(delta)));
+}
+
+static inline int all_ascii_sse2(__m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)),
+                                             _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+size_t win32_u16_len(const uint16_t* s) {
+    size_t i = 0;
+#ifdef LSW_UNICODE_SIMD
+    /* Aligned loads never cross into an unmapped page */
+    while (((uintptr_t)(s + i) & 15) && s[i]) i++;
+    if (((uintptr_t)(s + i) & 15) == 0 && !((uintptr_t)s & 1)) {
+        const __m128i zero = _mm_setzero_si128();
+        for (;; i += 8) {
+            int m = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i*)(s + i)), zero));
+            if (m) return i + (size_t)(__builtin_ctz((unsigned)m) >> 1);
+        }
+    }
+#endif
+    while (s[i]) i++;
+    return i;
+}
+
+/* Index of the first differing unit in a[0..n) / b[0..n), or n */
+static size_t u16_mismatch(const uint16_t* a, const uint16_t* b, size_t n) {
+    size_t i = 0;
+#ifdef LSW_UNICODE_SIMD
+    for (; i + 8 <= n; i += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(va, vb)) ^ 0xFFFFu;
+        if (m) return i + (size_t)(__builtin_ctz(m) >> 1);
+    }
+#endif
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+int win32_u16_cmp(const uint16_t* a, size_t na, const uint16_t* b, size_t nb) {
+    size_t n = na < nb ? na : nb;
+    size_t i = u16_mismatch(a, b, n);
+    if (i < n) return a[i] < b[i] ? -1 : 1;
+    return na < nb ? -1 : na > nb ? 1 : 0;
+}
+
+/* Ordinal ignore-case compares the uppercased units, which is what
+ * CompareStringOrdinal(bIgnoreCase) and .NET OrdinalIgnoreCase do. */
+int win32_u16_icmp(const uint16_t* a, size_t na, const uint16_t* b, size_t nb) {
+    size_t n = na < nb ? na : nb;
+    size_t i = 0;
+    while (i < n) {
+        size_t k = u16_mismatch(a + i, b + i, n - i);
+        i += k;
+        if (i >= n) break;
+#ifdef LSW_UNICODE_SIMD
+        /* Fold whole ASCII blocks at once; common in identifiers and paths */
+        if (i + 8 <= n) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            if (all_ascii_sse2(_mm_or_si128(va, vb))) {
+                va = ascii_case_sse2(va, 'a', 'z', -0x20);
+                vb = ascii_case_sse2(vb, 'a', 'z', -0x20);
+                unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(va, vb)) ^ 0xFFFFu;
+                if (!m) { i += 8; continue; }
+                size_t j = i + (size_t)(__builtin_ctz(m) >> 1);
+                return win32_u16_upper(a[j]) < win32_u16_upper(b[j]) ? -1 : 1;
+            }
+        }
+#endif
+        uint16_t ca = win32_u16_upper(a[i]), cb = win32_u16_upper(b[i]);
+        if (ca != cb) return ca < cb ? -1 : 1;
+        i++;
+    }
+    return na < nb ? -1 : na > nb ? 1 : 0;
+}
+
+/* A unit is "upper" for sorting if it has a distinct lowercase form */
+static inline int u16_is_upper(uint16_t c) {
+    return win32_u16_lower(c) != c;
+}
+
+int win32_u16_collate(const uint16_t* a, size_t na, const uint16_t* b, size_t nb, int ignore_case) {
+    int r = win32_u16_icmp(a, na, b, nb);
+    if (r || ignore_case) return r;
+
+    /* Equal ignoring case: the first case difference decides,
+     * lowercase before uppercase like the Windows default sort. */
+    for (size_t i = 0; i < na; ) {
+        i += u16_mismatch(a + i, b + i, na - i);
+        if (i >= na) break;
+        int ua = u16_is_upper(a[i]), ub = u16_is_upper(b[i]);
+        if (ua != ub) return ua ? 1 : -1;
+        i++;
+    }
+    return 0;
+}
+
+/* Sort key whose memcmp order matches win32_u16_collate():
+ *   primary  - uppercased units, 2 bytes (3 at the top of the BMP) so no
+ *              weight byte is ever below 0x02
+ *   0x01     - level separator
+ *   case     - one byte per unit (0x02 lower / uncased, 0x03 upper),
+ *              omitted when ignoring case
+ *   0x00     - terminator */
+size_t win32_u16_sortkey(const uint16_t* s, size_t n, uint8_t* key, size_t cap, int ignore_case) {
+    size_t o = 0;
+#define SORTKEY_PUT(b) do { if (key && o < cap) key[o] = (uint8_t)(b); o++; } while (0)
+    for (size_t i = 0; i < n; i++) {
+        uint16_t u = win32_u16_upper(s[i]);
+        if (u < 0xFD00) {
+            SORTKEY_PUT((u >> 8) + 2);
+        } else {
+            SORTKEY_PUT(0xFF);
+            SORTKEY_PUT(u >> 8);
+        }
+        SORTKEY_PUT(u & 0xFF);
+    }
+    SORTKEY_PUT(0x01);
+    if (!ignore_case)
+        for (size_t i = 0; i < n; i++) SORTKEY_PUT(u16_is_upper(s[i]) ? 0x03 : 0x02);
+    SORTKEY_PUT(0x00);
+#undef SORTKEY_PUT
+    return o;
+}
+
+void win32_u16_map_case(const uint16_t* s, size_t n, uint16_t* d, int upper) {
+    const uint8_t* index = upper ? case_upper_index : case_lower_index;
+    size_t i = 0;
+#ifdef LSW_UNICODE_SIMD
+    short lo = upper ? 'a' : 'A', hi = upper ? 'z' : 'Z', delta = upper ? -0x20 : 0x20;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        if (!all_ascii_sse2(v)) {
+            for (size_t j = i; j < i + 8; j++) d[j] = case_map(index, s[j]);
+            continue;
+        }
+        _mm_storeu_si128((__m128i*)(d + i), ascii_case_sse2(v, lo, hi, delta));
+    }
+#endif
+    for (; i < n; i++) d[i] = case_map(index, s[i]);
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2025 BarrerSoftware
+ * Licensed under BarrerSoftware License (BSL) v1.0
+ * If it's free, it's free. Period.
+ *
+ * Win32 unwinder
+ *
+ * Every frame of every unwind used to decode its UNWIND_INFO from the
+ * first code, chains included. Code that throws for control flow, or a
+ * profiler taking back traces, unwinds the same few functions millions
+ * of times, so the decode is done once per function instead: the codes
+ * of a function and of everything it chains to are folded into a
+ * recipe that says, for a frame stopped past the prolog, at which
+ * offset from the stack pointer (or from the frame register) each
+ * nonvolatile register was saved and where the return address is.
+ *
+ * Recipes live in a direct-mapped cache keyed by function address.
+ * Slots are guarded by a sequence count: readers copy a slot and retry
+ * nothing, they just treat a torn copy as a miss and decode again.
+ * Unregistering code bumps an epoch that every recipe is tagged with.
+ *
+ * Frames stopped inside a prolog (the first frame of an asynchronous
+ * unwind, or a return from __chkstk) and recipes the fast path cannot
+ * express (machine frames, chained frame registers) go through the
+ * interpreter, which applies the raw codes the way Windows does.
+ */
+
+#include "win32_unwind.h"
+#include "lsw_log.h"
+#include <string.h>
+#include <errno.h>
+
+/* Unwind opcodes */
+#define UWOP_PUSH_NONVOL      0
+#define UWOP_ALLOC_LARGE      1
+#define UWOP_ALLOC_SMALL      2
+#define UWOP_SET_FPREG        3
+#define UWOP_SAVE_NONVOL      4
+#define UWOP_SAVE_NONVOL_FAR  5
+#define UWOP_EPILOG           6     /* version 2; SAVE_XMM in version 1 */
+#define UWOP_SPARE            7
+#define UWOP_SAVE_XMM128      8
+#define UWOP_SAVE_XMM128_FAR  9
+#define UWOP_PUSH_MACHFRAME   10
+
+#define UNW_FLAG_EHANDLER     0x1
+#define UNW_FLAG_UHANDLER     0x2
+#define UNW_FLAG_CHAININFO    0x4
+
+#define UR_MAX_CHAIN          8
+#define UR_MAX_SAVES          14
+#define UR_SLOTS              1024
+
+/* Recipe flags */
+#define UR_VALID              0x1
+#define UR_SLOW               0x2   /* only the interpreter can unwind it */
+#define UR_RET_FRAME          0x4   /* return address is relative to the frame */
+
+/* Save records: offset << 8 | kind | register */
+#define UR_SAVE_XMM           0x10
+#define UR_SAVE_FRAME         0x20  /* relative to the frame, not the stack pointer */
+
+typedef struct {
+    uint64_t key;                   /* image base + BeginAddress */
+    uint32_t unwind;                /* UnwindData RVA it was built from */
+    uint32_t epoch;
+    uint32_t ret_off;               /* return address offset */
+    uint32_t rsp_ret_off;           /* same from RSP, frame registers ignored */
+    uint32_t handler;               /* language handler RVA, 0 if none */
+    uint32_t handler_data;          /* RVA of its HandlerData */
+    uint8_t  prolog;                /* SizeOfProlog of the primary info */
+    uint8_t  frame_reg;
+    uint8_t  frame_off;
+    uint8_t  flags;
+    uint8_t  hflags;
+    uint8_t  nsaves;
+    uint8_t  pad[2];
+    uint32_t saves[UR_MAX_SAVES];
+} ur_recipe_t;
+
+#define UR_WORDS (sizeof(ur_recipe_t) / sizeof(uint64_t))
+
+typedef struct {
+    uint64_t seq;                   /* odd while a writer fills the slot */
+    union {
+        ur_recipe_t r;
+        uint64_t    w[UR_WORDS];
+    } u;
+} ur_slot_t;
+
+_Static_assert(sizeof(ur_recipe_t) % sizeof(uint64_t) == 0, "recipe must be whole words");
+
+static ur_slot_t g_ur_cache[UR_SLOTS];
+static uint32_t  g_ur_epoch;
+
+static inline int ur_stack_ok(uint64_t addr) {
+    return addr >= 0x1000 && addr < 0x7FFFFFFFFF00ull;
+}
+
+// ============================================================================
+// SECTION: Decoding
+// ============================================================================
+
+/* Unwind codes (16-bit slots) taken by the code at c[i] */
+static int ur_code_slots(const uint16_t* c, int i) {
+    uint8_t op = (c[i] >> 8) & 0xF, info = (c[i] >> 12) & 0xF;
+    switch (op) {
+    case UWOP_ALLOC_LARGE:      return info ? 3 : 2;
+    case UWOP_SAVE_NONVOL:
+    case UWOP_SAVE_XMM128:
+    case UWOP_EPILOG:           return 2;
+    case UWOP_SAVE_NONVOL_FAR:
+    case UWOP_SAVE_XMM128_FAR:
+    case UWOP_SPARE:            return 3;
+    default:                    return 1;
+    }
+}
+
+/* Stack bytes released by an ALLOC code */
+static uint32_t ur_alloc_size(const uint16_t* c, int i) {
+    uint8_t op = (c[i] >> 8) & 0xF, info = (c[i] >> 12) & 0xF;
+    if (op == UWOP_ALLOC_SMALL) return 8u * (info + 1u);
+    if (info == 0) return 8u * c[i + 1];
+    uint32_t v;
+    memcpy(&v, &c[i + 1], 4);
+    return v;
+}
+
+/* Offset of a SAVE code from the frame base */
+static uint32_t ur_save_offset(const uint16_t* c, int i) {
+    uint8_t op = (c[i] >> 8) & 0xF;
+    if (op == UWOP_SAVE_NONVOL)  return 8u * c[i + 1];
+    if (op == UWOP_SAVE_XMM128)  return 16u * c[i + 1];
+    uint32_t v;
+    memcpy(&v, &c[i + 1], 4);
+    return v;
+}
+
+/*
+ * Resolve an UNWIND_INFO and check that it and its codes (plus the
+ * trailing chain entry or handler RVA) lie inside the image. JIT tables
+ * have no image size and are trusted.
+ */
+static const uint8_t* ur_info(uint64_t base, uint64_t size, uint32_t rva) {
+    if (!rva) return NULL;
+    if (size && (uint64_t)rva + 4 > size) return NULL;
+    const uint8_t* ui = (const uint8_t*)(uintptr_t)(base + rva);
+    uint8_t version = ui[0] & 7;
+    if (version != 1 && version != 2) return NULL;
+    if (size && (uint64_t)rva + 4 + (((ui[2] + 1u) & ~1u) * 2u) + 12 > size) return NULL;
+    return ui;
+}
+
+static const win32_runtime_function_t* ur_chain_entry(const uint8_t* ui) {
+    return (const win32_runtime_function_t*)(ui + 4 + ((ui[2] + 1u) & ~1u) * 2u);
+}
+
+static int ur_add_save(ur_recipe_t* r, uint32_t off, uint32_t kind) {
+    if (r->nsaves == UR_MAX_SAVES || off >= (1u << 24)) return -1;
+    r->saves[r->nsaves++] = off << 8 | kind;
+    return 0;
+}
+
+/*
+ * Fold the codes of `rf` and its chain into a recipe. Positions are
+ * tracked symbolically as an offset from either the stack pointer the
+ * frame was stopped with or the frame (frame register minus its
+ * offset); SET_FPREG switches from the first to the second.
+ */
+static int ur_build(uint64_t base, const win32_runtime_function_t* rf, ur_recipe_t* r) {
+    uint64_t size = 0;
+    win32_ftab_image(base, &size);
+
+    memset(r, 0, sizeof(*r));
+    r->key    = base + rf->BeginAddress;
+    r->unwind = rf->UnwindData;
+
+    const uint8_t* ui = ur_info(base, size, rf->UnwindData);
+    if (!ui) return ENOEXEC;
+    r->prolog    = ui[1];
+    r->frame_reg = ui[3] & 0xF;
+    r->frame_off = (uint8_t)((ui[3] >> 4) * 16);
+
+    uint32_t from_frame = 0;        /* current position is frame-relative */
+    uint32_t off = 0, total = 0;
+    uint32_t info_rva = rf->UnwindData;
+    for (int depth = 0; ; depth++) {
+        if (depth == UR_MAX_CHAIN) return ENOEXEC;
+        uint8_t flags = (ui[0] >> 3) & 0x1F;
+        int count = ui[2];
+        const uint16_t* c = (const uint16_t*)(ui + 4);
+
+        /* SAVE codes are relative to the frame (chained: the stack as the
+         * chained codes begin) */
+        uint32_t save_kind = depth == 0 ? (r->frame_reg ? UR_SAVE_FRAME : 0) : from_frame;
+        uint32_t save_base = depth == 0 ? 0 : off;
+        if (depth > 0 && (ui[3] & 0xF)) r->flags |= UR_SLOW;
+
+        for (int i = 0; i < count; i += ur_code_slots(c, i)) {
+            uint8_t op = (c[i] >> 8) & 0xF, info = (c[i] >> 12) & 0xF;
+            if (i + ur_code_slots(c, i) > count) return ENOEXEC;
+            switch (op) {
+            case UWOP_PUSH_NONVOL:
+                if (ur_add_save(r, off, from_frame | info)) r->flags |= UR_SLOW;
+                off += 8;
+                total += 8;
+                break;
+            case UWOP_ALLOC_SMALL:
+            case UWOP_ALLOC_LARGE:
+                off += ur_alloc_size(c, i);
+                total += ur_alloc_size(c, i);
+                break;
+            case UWOP_SET_FPREG:
+                if (depth > 0 || !r->frame_reg) r->flags |= UR_SLOW;
+                from_frame = UR_SAVE_FRAME;
+                off = 0;
+                break;
+            case UWOP_SAVE_NONVOL:
+            case UWOP_SAVE_NONVOL_FAR:
+                if (ur_add_save(r, save_base + ur_save_offset(c, i), save_kind | info))
+                    r->flags |= UR_SLOW;
+                break;
+            case UWOP_SAVE_XMM128:
+            case UWOP_SAVE_XMM128_FAR:
+                if (ur_add_save(r, save_base + ur_save_offset(c, i), save_kind | UR_SAVE_XMM | info))
+                    r->flags |= UR_SLOW;
+                break;
+            case UWOP_PUSH_MACHFRAME:
+                r->flags |= UR_SLOW;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (flags & UNW_FLAG_CHAININFO) {
+            const win32_runtime_function_t* chain = ur_chain_entry(ui);
+            info_rva = chain->UnwindData;
+            ui = ur_info(base, size, info_rva);
+            if (!ui) return ENOEXEC;
+            continue;
+        }
+        /* The handler is the one of the last info in the chain */
+        if (flags & (UNW_FLAG_EHANDLER | UNW_FLAG_UHANDLER)) {
+            uint32_t after = 4 + ((ui[2] + 1u) & ~1u) * 2u;
+            memcpy(&r->handler, ui + after, 4);
+            r->handler_data = r->handler ? info_rva + after + 4 : 0;
+            r->hflags = r->handler ? flags & (UNW_FLAG_EHANDLER | UNW_FLAG_UHANDLER) : 0;
+        }
+        break;
+    }
+
+    r->ret_off     = off;
+    r->rsp_ret_off = total;
+    if (from_frame) r->flags |= UR_RET_FRAME;
+    r->flags |= UR_VALID;
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Recipe cache
+// ============================================================================
+
+static ur_slot_t* ur_slot(uint64_t key) {
+    return &g_ur_cache[(key * 0x9E3779B97F4A7C15ull) >> 54];
+}
+
+static int ur_cache_get(uint64_t key, uint32_t unwind, uint32_t epoch, ur_recipe_t* out) {
+    ur_slot_t* s = ur_slot(key);
+    uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) return 0;
+    for (size_t i = 0; i < UR_WORDS; i++)
+        ((uint64_t*)out)[i] = __atomic_load_n(&s->u.w[i], __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != seq) return 0;
+    return out->key == key && out->unwind == unwind && out->epoch == epoch &&
+           (out->flags & UR_VALID);
+}
+
+static void ur_cache_put(const ur_recipe_t* r) {
+    ur_slot_t* s = ur_slot(r->key);
+    uint64_t seq = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    /* Another thread filling the slot wins; ours is only a cache entry */
+    if ((seq & 1) || !__atomic_compare_exchange_n(&s->seq, &seq, seq + 1, false,
+                                                  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < UR_WORDS; i++)
+        __atomic_store_n(&s->u.w[i], ((const uint64_t*)r)[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static int ur_recipe(uint64_t base, const win32_runtime_function_t* rf, ur_recipe_t* r) {
+    uint64_t key = base + rf->BeginAddress;
+    uint32_t epoch = __atomic_load_n(&g_ur_epoch, __ATOMIC_ACQUIRE);
+    if (ur_cache_get(key, rf->UnwindData, epoch, r)) return 0;
+
+    int rc = ur_build(base, rf, r);
+    if (rc) return rc;
+    r->epoch = epoch;
+    ur_cache_put(r);
+    return 0;
+}
+
+void win32_unwind_flush(void) {
+    __atomic_add_fetch(&g_ur_epoch, 1, __ATOMIC_RELEASE);
+}
+
+// ============================================================================
+// SECTION: Interpreter
+// ============================================================================
+
+static void ur_restore(win32_unwind_regs_t* regs, void* xmm, void** ptrs,
+                       uint32_t reg, int is_xmm, uint64_t addr) {
+    if (is_xmm) {
+        if (xmm) memcpy((uint8_t*)xmm + reg * 16, (const void*)(uintptr_t)addr, 16);
+        if (ptrs) ptrs[reg] = (void*)(uintptr_t)addr;
+    } else {
+        regs->gpr[reg] = *(const uint64_t*)(uintptr_t)addr;
+        if (ptrs) ptrs[16 + reg] = (void*)(uintptr_t)addr;
+    }
+}
+
+/* RtlVirtualUnwind proper: the codes applied one by one, skipping those
+ * of prolog instructions that have not run yet */
+static int ur_interpret(uint64_t base, const win32_runtime_function_t* rf,
+                        win32_unwind_regs_t* regs, void* xmm, void** ptrs, uint64_t* entry_rsp) {
+    uint64_t size = 0;
+    win32_ftab_image(base, &size);
+
+    uint64_t pc_off = regs->rip - (base + rf->BeginAddress);
+    uint64_t prolog_off = pc_off < (uint64_t)(rf->EndAddress - rf->BeginAddress) ? pc_off : UINT64_MAX;
+    uint64_t rsp = regs->gpr[WIN32_REG_RSP];
+    int mach = 0;
+
+    const uint8_t* ui = ur_info(base, size, rf->UnwindData);
+    for (int depth = 0; ui; depth++) {
+        if (depth == UR_MAX_CHAIN) return ENOEXEC;
+        int count = ui[2];
+        const uint16_t* c = (const uint16_t*)(ui + 4);
+        uint8_t frame_reg = ui[3] & 0xF;
+
+        uint64_t frame = rsp;
+        if (frame_reg) {
+            /* Established once its SET_FPREG has run */
+            int set = 1;
+            for (int i = 0; i < count; i += ur_code_slots(c, i))
+                if (((c[i] >> 8) & 0xF) == UWOP_SET_FPREG && (c[i] & 0xFF) > prolog_off) set = 0;
+            if (set) frame = regs->gpr[frame_reg] - (uint64_t)(ui[3] >> 4) * 16;
+        }
+
+        for (int i = 0; i < count; i += ur_code_slots(c, i)) {
+            if (i + ur_code_slots(c, i) > count) return ENOEXEC;
+            if ((c[i] & 0xFF) > prolog_off) continue;
+            uint8_t op = (c[i] >> 8) & 0xF, info = (c[i] >> 12) & 0xF;
+            switch (op) {
+            case UWOP_PUSH_NONVOL:
+                if (!ur_stack_ok(rsp)) return EFAULT;
+                ur_restore(regs, NULL, ptrs, info, 0, rsp);
+                rsp += 8;
+                break;
+            case UWOP_ALLOC_SMALL:
+            case UWOP_ALLOC_LARGE:
+                rsp += ur_alloc_size(c, i);
+                break;
+            case UWOP_SET_FPREG:
+                rsp = frame;
+                break;
+            case UWOP_SAVE_NONVOL:
+            case UWOP_SAVE_NONVOL_FAR:
+            case UWOP_SAVE_XMM128:
+            case UWOP_SAVE_XMM128_FAR: {
+                uint64_t at = frame + ur_save_offset(c, i);
+                if (!ur_stack_ok(at)) return EFAULT;
+                ur_restore(regs, xmm, ptrs, info, op >= UWOP_SAVE_XMM128, at);
+                break;
+            }
+            case UWOP_PUSH_MACHFRAME:
+                if (info) rsp += 8;     /* error code */
+                if (!ur_stack_ok(rsp)) return EFAULT;
+                *entry_rsp = rsp;
+                regs->rip = *(const uint64_t*)(uintptr_t)rsp;
+                rsp = *(const uint64_t*)(uintptr_t)(rsp + 24);
+                mach = 1;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!(((ui[0] >> 3) & 0x1F) & UNW_FLAG_CHAININFO)) break;
+        ui = ur_info(base, size, ur_chain_entry(ui)->UnwindData);
+        if (!ui) return ENOEXEC;
+        prolog_off = UINT64_MAX;        /* the chained codes have all run */
+    }
+    if (!ui) return ENOEXEC;
+
+    if (!mach) {
+        if (!ur_stack_ok(rsp)) return EFAULT;
+        *entry_rsp = rsp;
+        regs->rip = *(const uint64_t*)(uintptr_t)rsp;
+        rsp += 8;
+    }
+    regs->gpr[WIN32_REG_RSP] = rsp;
+    return 0;
+}
+
+// ============================================================================
+// SECTION: Unwinding
+// ============================================================================
+
+int win32_unwind_step(uint64_t image_base, const win32_runtime_function_t* rf,
+                      win32_unwind_regs_t* regs, void* xmm, void** ptrs, uint64_t* entry_rsp) {
+    ur_recipe_t r;
+    uint64_t dummy;
+    if (!entry_rsp) entry_rsp = &dummy;
+    int rc = ur_recipe(image_base, rf, &r);
+    if (rc) return rc;
+
+    uint64_t pc_off = regs->rip - (image_base + rf->BeginAddress);
+    if ((r.flags & UR_SLOW) || pc_off < r.prolog)
+        return ur_interpret(image_base, rf, regs, xmm, ptrs, entry_rsp);
+
+    /* Bases first: restoring may overwrite the frame register */
+    uint64_t rsp = regs->gpr[WIN32_REG_RSP];
+    uint64_t frame = r.frame_reg ? regs->gpr[r.frame_reg] - r.frame_off : rsp;
+    uint64_t ret = ((r.flags & UR_RET_FRAME) ? frame : rsp) + r.ret_off;
+    if (!ur_stack_ok(ret)) return EFAULT;
+
+    for (int i = 0; i < r.nsaves; i++) {
+        uint32_t s = r.saves[i];
+        uint64_t at = ((s & UR_SAVE_FRAME) ? frame : rsp) + (s >> 8);
+        if (!ur_stack_ok(at)) return EFAULT;
+        ur_restore(regs, xmm, ptrs, s & 0xF, (s & UR_SAVE_XMM) != 0, at);
+    }
+    *entry_rsp = ret;
+    regs->rip = *(const uint64_t*)(uintptr_t)ret;
+    regs->gpr[WIN32_REG_RSP] = ret + 8;
+    return 0;
+}
+
+uint64_t win32_unwind_rsp(uint64_t image_base, const win32_runtime_function_t* rf, uint64_t rsp,
+                          uint64_t* caller_rip, uint64_t* caller_rsp) {
+    ur_recipe_t r;
+    if (ur_recipe(image_base, rf, &r)) return 0;
+
+    /* Without alloca the frame register is RSP plus what was allocated
+     * after it was set, so this is RSP plus everything released */
+    uint64_t ret = rsp + r.rsp_ret_off;
+    if (!ur_stack_ok(ret)) return 0;
+    *caller_rip = *(const uint64_t*)(uintptr_t)ret;
+    *caller_rsp = ret + 8;
+    return ret;
+}
+
+uint64_t win32_unwind_handler(uint64_t image_base, const win32_runtime_function_t* rf,
+                              uint32_t* flags, void** data) {
+    ur_recipe_t r;
+    if (ur_recipe(image_base, rf, &r) || !r.handler) {
+        if (flags) *flags = 0;
+        if (data) *data = NULL;
+        return 0;
+    }
+    if (flags) *flags = r.hflags;
+    if (data) *data = (void*)(uintptr_t)(image_base + r.handler_data);
+    return image_base + r.handler;
+}
+
+uint32_t win32_unwind_backtrace(win32_unwind_regs_t* regs, uint32_t skip, uint32_t max, void** out) {
+    uint32_t n = 0;
+    for (uint32_t depth = 0; n < max && depth < skip + max; depth++) {
+        uint64_t pc = regs->rip;
+        if (pc < 0x1000) break;
+        if (depth >= skip) out[n++] = (void*)(uintptr_t)pc;
+
+        /* A return address: the call is the instruction before it */
+        uint64_t base;
+        const win32_runtime_function_t* rf = win32_ftab_lookup(pc - 1, &base, NULL);
+        if (!rf) break;
+        uint64_t rsp = regs->gpr[WIN32_REG_RSP], entry;
+        if (win32_unwind_step(base, rf, regs, NULL, NULL, &entry) != 0) break;
+        if (regs->gpr[WIN32_REG_RSP] <= rsp) break;    /* no progress: corrupt stack */
+    }
+    return n;
+}
@@ -0,0 +1,420 @@
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "win32_unicode.h"
+
+/* Poison value after the output capacity; a converter that reports
+ * NOSPACE must leave it untouched */
+#define GUARD16 0xA5A5
+#define GUARD8  0xA5
+
+/* Mixed 1/2/3/4-byte UTF-8: "A", U+00E9, U+20AC, U+1F600 */
+static const uint8_t mixed_utf8[] = {
+    'A', 0xC3, 0xA9, 0xE2, 0x82, 0xAC, 0xF0, 0x9F, 0x98, 0x80
+};
+static const uint16_t mixed_utf16[] = { 'A', 0x00E9, 0x20AC, 0xD83D, 0xDE00 };
+
+START_TEST(test_utf8_utf16_round_trip)
+{
+    /* Invariant: UTF-8 -> UTF-16 -> UTF-8 reproduces the input, and the
+       size queries (dst == NULL) report exactly what is written. Lengths
+       cover runs shorter and longer than the 16/32-byte vector blocks. */
+    uint8_t src[512], back[512];
+    uint16_t wide[512];
+
+    for (size_t ascii = 0; ascii <= 70; ascii++) {
+        size_t len = 0;
+        for (size_t i = 0; i < ascii; i++) src[len++] = (uint8_t)('a' + i % 26);
+        memcpy(src + len, mixed_utf8, sizeof(mixed_utf8));
+        len += sizeof(mixed_utf8);
+        for (size_t i = 0; i < ascii; i++) src[len++] = (uint8_t)('0' + i % 10);
+
+        ptrdiff_t need = win32_utf8_to_utf16(src, len, NULL, 0, 1);
+        ptrdiff_t nw = win32_utf8_to_utf16(src, len, wide, sizeof(wide) / 2, 1);
+        ck_assert_int_eq(nw, need);
+        ck_assert_int_eq(nw, (ptrdiff_t)(2 * ascii + 5));
+        ck_assert_mem_eq(wide + ascii, mixed_utf16, sizeof(mixed_utf16));
+
+        ptrdiff_t need8 = win32_utf16_to_utf8(wide, (size_t)nw, NULL, 0, 1);
+        ptrdiff_t n8 = win32_utf16_to_utf8(wide, (size_t)nw, back, sizeof(back), 1);
+        ck_assert_int_eq(n8, need8);
+        ck_assert_int_eq(n8, (ptrdiff_t)len);
+        ck_assert_mem_eq(back, src, len);
+    }
+}
+END_TEST
+
+START_TEST(test_utf8_ill_formed_strict_and_lax)
+{
+    /* Invariant: strict mode rejects every ill-formed sequence; lax mode
+       replaces each maximal subpart with exactly one U+FFFD */
+    static const struct {
+        const char* in;
+        size_t      len;
+        uint16_t    out[8];
+        size_t      out_len;
+    } cases[] = {
+        { "\x80",             1, { 0xFFFD },                     1 },  /* lone trail */
+        { "\xFF",             1, { 0xFFFD },                     1 },  /* never valid */
+        { "\xC0\x80",         2, { 0xFFFD, 0xFFFD },             2 },  /* overlong NUL */
+        { "\xE0\x80\xAF",     3, { 0xFFFD, 0xFFFD, 0xFFFD },     3 },  /* overlong */
+        { "\xED\xA0\x80",     3, { 0xFFFD, 0xFFFD, 0xFFFD },     3 },  /* surrogate */
+        { "\xF4\x90\x80\x80", 4, { 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD }, 4 },  /* > U+10FFFF */
+        { "\xE2\x82",         2, { 0xFFFD },                     1 },  /* truncated */
+        { "\xE2\x82" "A",     3, { 0xFFFD, 'A' },                2 },  /* cut short */
+        { "\xF0\x9F\x98" "x", 4, { 0xFFFD, 'x' },                2 },
+    };
+    uint16_t out[16];
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const uint8_t* in = (const uint8_t*)cases[c].in;
+
+        ck_assert_msg(win32_utf8_to_utf16(in, cases[c].len, out, 16, 1) == WIN32_UNICODE_INVALID,
+            "strict mode accepted ill-formed case %zu", c);
+        ck_assert_msg(win32_utf8_to_utf16(in, cases[c].len, NULL, 0, 1) == WIN32_UNICODE_INVALID,
+            "strict size query accepted ill-formed case %zu", c);
+
+        ptrdiff_t n = win32_utf8_to_utf16(in, cases[c].len, out, 16, 0);
+        ck_assert_msg(n == (ptrdiff_t)cases[c].out_len,
+            "lax case %zu: %td units, expected %zu", c, n, cases[c].out_len);
+        ck_assert_mem_eq(out, cases[c].out, cases[c].out_len * 2);
+    }
+}
+END_TEST
+
+START_TEST(test_utf16_lone_surrogates)
+{
+    /* Invariant: unpaired surrogates are rejected in strict mode and
+       become EF BF BD in lax mode; a valid pair is one 4-byte character */
+    static const uint16_t high_only[] = { 'a', 0xD800, 'b' };
+    static const uint16_t low_only[]  = { 0xDC00 };
+    static const uint16_t swapped[]   = { 0xDE00, 0xD83D };
+    uint8_t out[16];
+
+    ck_assert_int_eq(win32_utf16_to_utf8(high_only, 3, out, 16, 1), WIN32_UNICODE_INVALID);
+    ck_assert_int_eq(win32_utf16_to_utf8(low_only, 1, out, 16, 1), WIN32_UNICODE_INVALID);
+    ck_assert_int_eq(win32_utf16_to_utf8(swapped, 2, out, 16, 1), WIN32_UNICODE_INVALID);
+
+    ck_assert_int_eq(win32_utf16_to_utf8(high_only, 3, out, 16, 0), 5);
+    ck_assert_mem_eq(out, "a\xEF\xBF\xBD" "b", 5);
+    ck_assert_int_eq(win32_utf16_to_utf8(swapped, 2, out, 16, 0), 6);
+    ck_assert_mem_eq(out, "\xEF\xBF\xBD\xEF\xBF\xBD", 6);
+}
+END_TEST
+
+START_TEST(test_nospace_at_vector_edges)
+{
+    /* Invariant: a destination one unit short fails with NOSPACE, never
+       writes past `cap`, and only writes whole characters. Checked around
+       the 16-byte (SSE2) and 32-byte (AVX2) block edges. */
+    static const size_t edges[] = { 1, 15, 16, 17, 31, 32, 33, 48, 63, 64, 65 };
+    uint8_t src[80], out8[96];
+    uint16_t src16[80], out16[96];
+
+    for (size_t e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+        size_t n = edges[e];
+        for (size_t i = 0; i < n; i++) src[i] = src16[i] = (uint8_t)('A' + i % 26);
+
+        /* Pure ASCII: exact fit succeeds, one short fails */
+        for (size_t i = 0; i < 96; i++) out16[i] = GUARD16;
+        ck_assert_int_eq(win32_utf8_to_utf16(src, n, out16, n, 1), (ptrdiff_t)n);
+        ck_assert_uint_eq(out16[n], GUARD16);
+        ck_assert_int_eq(win32_utf8_to_utf16(src, n, out16, n - 1, 1), WIN32_UNICODE_NOSPACE);
+
+        memset(out8, GUARD8, sizeof(out8));
+        ck_assert_int_eq(win32_utf16_to_utf8(src16, n, out8, n - 1, 1), WIN32_UNICODE_NOSPACE);
+        ck_assert_uint_eq(out8[n - 1], GUARD8);
+        ck_assert_mem_eq(out8, src, n - 1);
+
+        /* ASCII run ending at the edge, then a character that does not fit:
+           U+1F600 needs two UTF-16 units / four UTF-8 bytes */
+        memcpy(src + n, "\xF0\x9F\x98\x80", 4);
+        src16[n] = 0xD83D;
+        src16[n + 1] = 0xDE00;
+
+        for (size_t i = 0; i < 96; i++) out16[i] = GUARD16;
+        ck_assert_int_eq(win32_utf8_to_utf16(src, n + 4, out16, n + 1, 1), WIN32_UNICODE_NOSPACE);
+        ck_assert_uint_eq(out16[n], GUARD16);
+        ck_assert_uint_eq(out16[n + 1], GUARD16);
+        ck_assert_int_eq(win32_utf8_to_utf16(src, n + 4, out16, n + 2, 1), (ptrdiff_t)n + 2);
+
+        memset(out8, GUARD8, sizeof(out8));
+        ck_assert_int_eq(win32_utf16_to_utf8(src16, n + 2, out8, n + 3, 1), WIN32_UNICODE_NOSPACE);
+        ck_assert_uint_eq(out8[n], GUARD8);
+        ck_assert_int_eq(win32_utf16_to_utf8(src16, n + 2, out8, n + 4, 1), (ptrdiff_t)n + 4);
+        ck_assert_mem_eq(out8, src, n + 4);
+    }
+}
+END_TEST
+
+START_TEST(test_cp1252_mapping)
+{
+    /* Invariant: CP1252 (and CP_ACP, which resolves to it) uses the
+       Windows table, including the C1 holes, and round-trips every byte */
+    static const uint8_t in[] = { 'x', 0x80, 0x81, 0x8A, 0x9F, 0xA0, 0xE9, 0xFF };
+    static const uint16_t want[] = { 'x', 0x20AC, 0x0081, 0x0160, 0x0178, 0x00A0, 0x00E9, 0x00FF };
+    uint16_t out[16];
+    uint8_t back[16];
+    int used_default = -1;
+
+    ck_assert(win32_codepage_valid(1252));
+    ck_assert_uint_eq(win32_codepage_resolve(0), 1252);
+    ck_assert_int_eq(win32_mb_to_utf16(1252, in, sizeof(in), out, 16, 1), (ptrdiff_t)sizeof(in));
+    ck_assert_mem_eq(out, want, sizeof(want));
+    ck_assert_int_eq(win32_mb_to_utf16(0, in, sizeof(in), out, 16, 1), (ptrdiff_t)sizeof(in));
+    ck_assert_mem_eq(out, want, sizeof(want));
+
+    ck_assert_int_eq(win32_utf16_to_mb(1252, want, 8, back, 16, NULL, &used_default), 8);
+    ck_assert_mem_eq(back, in, sizeof(in));
+    ck_assert_int_eq(used_default, 0);
+
+    for (int b = 1; b < 256; b++) {
+        uint8_t byte = (uint8_t)b;
+        uint16_t u;
+        ck_assert_int_eq(win32_mb_to_utf16(1252, &byte, 1, &u, 1, 1), 1);
+        ck_assert_int_eq(win32_utf16_to_mb(1252, &u, 1, back, 1, NULL, NULL), 1);
+        ck_assert_uint_eq(back[0], byte);
+    }
+
+    /* Unmappable characters take the default character */
+    static const uint16_t alien[] = { 0x0100, 'z', 0xD83D, 0xDE00 };
+    ck_assert_int_eq(win32_utf16_to_mb(1252, alien, 4, back, 16, NULL, &used_default), 3);
+    ck_assert_mem_eq(back, "?z?", 3);
+    ck_assert_int_eq(used_default, 1);
+    ck_assert_int_eq(win32_utf16_to_mb(1252, alien, 1, back, 16, "#", NULL), 1);
+    ck_assert_uint_eq(back[0], '#');
+}
+END_TEST
+
+START_TEST(test_cp932_mapping)
+{
+    /* Invariant: CP932 (Shift-JIS) decodes lead/trail pairs and
+       half-width katakana, reports its lead-byte ranges and round-trips */
+    static const uint8_t in[] = { 0x93, 0xFA, 0x96, 0x7B, 'a', 0xB1, 0x82, 0xA0 };
+    static const uint16_t want[] = { 0x65E5, 0x672C, 'a', 0xFF71, 0x3042 };
+    win32_cpinfo_t info;
+    uint16_t out[16];
+    uint8_t back[16];
+
+    ck_assert(win32_codepage_valid(932));
+    ck_assert(win32_codepage_info(932, &info));
+    ck_assert_uint_eq(info.max_char_size, 2);
+    ck_assert(win32_codepage_is_lead_byte(932, 0x81));
+    ck_assert(win32_codepage_is_lead_byte(932, 0x9F));
+    ck_assert(win32_codepage_is_lead_byte(932, 0xE0));
+    ck_assert(!win32_codepage_is_lead_byte(932, 'a'));
+    ck_assert(!win32_codepage_is_lead_byte(932, 0xA0));
+    ck_assert(!win32_codepage_is_lead_byte(932, 0xB1));
+
+    ck_assert_int_eq(win32_mb_to_utf16(932, in, sizeof(in), NULL, 0, 1), 5);
+    ck_assert_int_eq(win32_mb_to_utf16(932, in, sizeof(in), out, 16, 1), 5);
+    ck_assert_mem_eq(out, want, sizeof(want));
+
+    ck_assert_int_eq(win32_utf16_to_mb(932, want, 5, NULL, 0, NULL, NULL), (ptrdiff_t)sizeof(in));
+    ck_assert_int_eq(win32_utf16_to_mb(932, want, 5, back, 16, NULL, NULL), (ptrdiff_t)sizeof(in));
+    ck_assert_mem_eq(back, in, sizeof(in));
+
+    /* A double-byte character is never split at the end of the buffer */
+    ck_assert_int_eq(win32_utf16_to_mb(932, want, 5, back, 1, NULL, NULL), WIN32_UNICODE_NOSPACE);
+
+    /* A lead byte with nothing after it is ill-formed */
+    ck_assert_int_eq(win32_mb_to_utf16(932, in, 1, out, 16, 1), WIN32_UNICODE_INVALID);
+    ck_assert_int_eq(win32_mb_to_utf16(932, in, 1, out, 16, 0), 1);
+    ck_assert_uint_eq(out[0], '?');
+}
+END_TEST
+
+static int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/* memcmp order of two NUL-terminated sort keys */
+static int key_cmp(const uint8_t* a, size_t na, const uint8_t* b, size_t nb)
+{
+    int r = memcmp(a, b, na < nb ? na : nb);
+    return r ? sign(r) : (na > nb) - (na < nb);
+}
+
+START_TEST(test_case_mapping)
+{
+    /* Invariant: simple case mapping per unit, ASCII blocks (vector path)
+       and the rest agree, and in-place mapping is allowed */
+    static const uint16_t mixed[] = {
+        'h', 'e', 'l', 'l', 'o', '_', 'W', 'o', 'r', 'l', 'd', '1',
+        0x00E9, 0x00C9, 0x03C9, 0x03A9, 0x0451, 0x0401, 0xFF41, 0xFF21,
+        0x00DF, 0x0131, 'z', '@', '[', '`', '{'
+    };
+    static const uint16_t upper[] = {
+        'H', 'E', 'L', 'L', 'O', '_', 'W', 'O', 'R', 'L', 'D', '1',
+        0x00C9, 0x00C9, 0x03A9, 0x03A9, 0x0401, 0x0401, 0xFF21, 0xFF21,
+        0x00DF, 'I', 'Z', '@', '[', '`', '{'
+    };
+    size_t n = sizeof(mixed) / sizeof(mixed[0]);
+    uint16_t buf[32];
+
+    win32_u16_map_case(mixed, n, buf, 1);
+    ck_assert_mem_eq(buf, upper, sizeof(upper));
+    for (size_t i = 0; i < n; i++) {
+        ck_assert_uint_eq(win32_u16_upper(mixed[i]), upper[i]);
+    }
+
+    /* In place, from every offset so blocks straddle the vector edge */
+    for (size_t off = 0; off < 8; off++) {
+        memcpy(buf, upper, sizeof(upper));
+        win32_u16_map_case(buf + off, n - off, buf + off, 0);
+        for (size_t i = off; i < n; i++) {
+            ck_assert_uint_eq(buf[i], win32_u16_lower(upper[i]));
+        }
+    }
+    ck_assert_uint_eq(win32_u16_lower(0x0130), 'i');
+    ck_assert_uint_eq(win32_u16_upper(0x00FF), 0x0178);
+}
+END_TEST
+
+START_TEST(test_len_and_ordinal_compare)
+{
+    /* Invariant: length and ordinal compares do not depend on alignment
+       or on where the first difference falls relative to a vector block */
+    uint16_t a[64], b[64];
+
+    for (size_t off = 0; off < 8; off++) {
+        for (size_t len = 0; len < 40; len++) {
+            for (size_t i = 0; i < len; i++) a[off + i] = (uint16_t)('a' + i % 26);
+            a[off + len] = 0;
+            ck_assert_uint_eq(win32_u16_len(a + off), len);
+        }
+    }
+
+    for (size_t n = 1; n < 40; n++) {
+        for (size_t i = 0; i < n; i++) a[i] = b[i] = (uint16_t)('A' + i % 26);
+        ck_assert_int_eq(win32_u16_cmp(a, n, b, n), 0);
+        ck_assert_int_lt(win32_u16_cmp(a, n - 1, b, n), 0);
+        for (size_t d = 0; d < n; d++) {
+            b[d] = (uint16_t)(a[d] + 0x20);          /* same letter, lowercase */
+            ck_assert_int_lt(win32_u16_cmp(a, n, b, n), 0);
+            ck_assert_int_eq(win32_u16_icmp(a, n, b, n), 0);
+            b[d] = 0x00E9;                           /* non-ASCII difference */
+            ck_assert_int_lt(win32_u16_icmp(a, n, b, n), 0);
+            ck_assert_int_gt(win32_u16_icmp(b, n, a, n), 0);
+            b[d] = a[d];
+        }
+    }
+}
+END_TEST
+
+START_TEST(test_collate_order)
+{
+    /* Invariant: case-insensitive order first, then lowercase before
+       uppercase at the first case difference */
+    static const uint16_t lower[] = { 'a', 'b', 'c' };
+    static const uint16_t title[] = { 'A', 'b', 'c' };
+    static const uint16_t upper[] = { 'A', 'B', 'C' };
+    static const uint16_t abd[]   = { 'a', 'b', 'd' };
+
+    ck_assert_int_lt(win32_u16_collate(lower, 3, title, 3, 0), 0);
+    ck_assert_int_lt(win32_u16_collate(title, 3, upper, 3, 0), 0);
+    ck_assert_int_eq(win32_u16_collate(lower, 3, upper, 3, 1), 0);
+    ck_assert_int_lt(win32_u16_collate(upper, 3, abd, 3, 0), 0);   /* primary wins */
+    ck_assert_int_lt(win32_u16_collate(upper, 2, lower, 3, 0), 0);  /* prefix first */
+}
+END_TEST
+
+START_TEST(test_sortkey_matches_collate)
+{
+    /* Invariant: memcmp order of LCMAP_SORTKEY keys equals collate order,
+       with and without ignore-case, for every pair of a pseudo-random set */
+    static const uint16_t alphabet[] = {
+        'a', 'A', 'b', 'B', 'z', 'Z', '_', '0', 0x00E9, 0x00C9, 0x00DF,
+        0x03C9, 0x03A9, 0xFF41, 0xFF21, 0xFE30, 0xFFEE, 0xD83D, 0xDE00
+    };
+    enum { COUNT = 160, MAXLEN = 20, KEYMAX = 4 * MAXLEN + 2 };
+    static uint16_t str[COUNT][MAXLEN];
+    static size_t len[COUNT];
+    static uint8_t key[2][COUNT][KEYMAX];
+    static size_t klen[2][COUNT];
+    uint32_t seed = 12345;
+
+    for (size_t i = 0; i < COUNT; i++) {
+        seed = seed * 1103515245u + 12345u;
+        len[i] = (seed >> 16) % MAXLEN;
+        for (size_t j = 0; j < len[i]; j++) {
+            seed = seed * 1103515245u + 12345u;
+            /* Mostly a/A/b/B so many pairs differ only in case */
+            size_t pick = (seed >> 16) % (i % 3 ? 4 : sizeof(alphabet) / sizeof(alphabet[0]));
+            str[i][j] = alphabet[pick];
+        }
+        for (int ic = 0; ic < 2; ic++) {
+            klen[ic][i] = win32_u16_sortkey(str[i], len[i], key[ic][i], KEYMAX, ic);
+            ck_assert_uint_eq(klen[ic][i], win32_u16_sortkey(str[i], len[i], NULL, 0, ic));
+            ck_assert_int_le(klen[ic][i], KEYMAX);
+            ck_assert_uint_eq(key[ic][i][klen[ic][i] - 1], 0);
+        }
+    }
+
+    for (int ic = 0; ic < 2; ic++) {
+        for (size_t i = 0; i < COUNT; i++) {
+            for (size_t j = 0; j < COUNT; j++) {
+                int want = sign(win32_u16_collate(str[i], len[i], str[j], len[j], ic));
+                int got = key_cmp(key[ic][i], klen[ic][i], key[ic][j], klen[ic][j]);
+                ck_assert_msg(got == want,
+                    "sort key order %d != collate order %d (strings %zu, %zu, ignore_case %d)",
+                    got, want, i, j, ic);
+            }
+        }
+    }
+
+    /* A short buffer still reports the full key length */
+    uint8_t small[3];
+    ck_assert_uint_eq(win32_u16_sortkey(str[1], len[1], small, sizeof(small), 0), klen[0][1]);
+}
+END_TEST
+
+Suite *unicode_suite(void)
+{
+    Suite *s;
+    TCase *tc_transcode;
+    TCase *tc_codepage;
+    TCase *tc_string;
+
+    s = suite_create("Unicode");
+
+    tc_transcode = tcase_create("Transcode");
+    tcase_add_test(tc_transcode, test_utf8_utf16_round_trip);
+    tcase_add_test(tc_transcode, test_utf8_ill_formed_strict_and_lax);
+    tcase_add_test(tc_transcode, test_utf16_lone_surrogates);
+    tcase_add_test(tc_transcode, test_nospace_at_vector_edges);
+    suite_add_tcase(s, tc_transcode);
+
+    tc_codepage = tcase_create("CodePage");
+    tcase_add_test(tc_codepage, test_cp1252_mapping);
+    tcase_add_test(tc_codepage, test_cp932_mapping);
+    suite_add_tcase(s, tc_codepage);
+
+    tc_string = tcase_create("String");
+    tcase_add_test(tc_string, test_case_mapping);
+    tcase_add_test(tc_string, test_len_and_ordinal_compare);
+    tcase_add_test(tc_string, test_collate_order);
+    tcase_add_test(tc_string, test_sortkey_matches_collate);
+    suite_add_tcase(s, tc_string);
+
+    return s;
+}
+
+int main(void)
+{
+    int number_failed;
+    Suite *s;
+    SRunner *sr;
+
+    s = unicode_suite();
+    sr = srunner_create(s);
+
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}